@@ -16,6 +16,23 @@
 #import "LXRef_Impl.h"
 #import "LXSurface.h"
 #import "LXShader.h"
+#import "LXPixelBuffer.h"
+#import "LXTexture.h"
+#import "LXHalfFloat.h"
+#import "LXParallel.h"
+
+#if defined(__SSE2__)
+ #include <emmintrin.h>
+#endif
+
+
+/*
+  The GPU accumulator ping-pongs between two surfaces, adding each sample with a shader.
+
+  The CPU accumulator (kLXAccumulatorFlag_UseCPU) keeps a float32 RGBA buffer in main memory.
+  Samples are added in bands of rows on multiple threads; common source formats are decoded
+  in the same pass as the multiply-add, so the source is read only once.
+*/
 
 
 typedef struct {
@@ -36,6 +53,13 @@ typedef struct {
     LXShaderRef firstPassShader;
     LXShaderRef accShader;
     
+    // CPU accumulation
+    LXBool useCPU;
+    float *accBuf;                      // RGBA float32
+    size_t accRowFloats;
+    LXPixelBufferRef texReadPixbuf;     // textures are read into this
+    LXSurfaceRef resultSurf;
+    
 } LXAccumulatorImpl;
 
 
@@ -71,6 +95,10 @@ void LXAccumulatorRelease(LXAccumulatorRef r)
         LXShaderRelease(imp->firstPassShader);
         LXShaderRelease(imp->accShader);
         
+        _lx_free(imp->accBuf);
+        LXPixelBufferRelease(imp->texReadPixbuf);
+        LXSurfaceRelease(imp->resultSurf);
+        
         _lx_free(imp);
     }
 }
@@ -85,6 +113,19 @@ LXAccumulatorRef LXAccumulatorCreateWithSize(LXPoolRef pool, LXSize size, LXUInt
     imp->pxFormat = kLX_RGBA_FLOAT16;
     imp->numSamples = 4;   // default
     
+#if defined(LXPLATFORM_LINUX)
+    flags |= kLXAccumulatorFlag_UseCPU;
+#endif
+    if (flags & kLXAccumulatorFlag_UseCPU) {
+        if (size.w < 1 || size.h < 1) {
+            LXErrorSet(outError, 4001, "invalid size for accumulator");
+            LXAccumulatorRelease((LXAccumulatorRef)imp);
+            return NULL;
+        }
+        imp->useCPU = YES;
+        return (LXAccumulatorRef)imp;
+    }
+    
     static const char *ss_firstPass = "!!ARBfp1.0"
                      "TEMP t0;  "
                      "TEX t0, fragment.texcoord[0], texture[0], RECT;  "
@@ -128,6 +169,8 @@ void LXAccumulatorSetNumberOfSamples(LXAccumulatorRef r, LXInteger numSamples)
             if (imp->surf2) LXSurfaceRelease(imp->surf2);
             imp->surf1 = NULL;
             imp->surf2 = NULL;
+            LXSurfaceRelease(imp->resultSurf);
+            imp->resultSurf = NULL;
         }
         else if (numSamples <= 16 && imp->numSamples > 16) {
             imp->pxFormat = kLX_RGBA_FLOAT16;
@@ -135,6 +178,8 @@ void LXAccumulatorSetNumberOfSamples(LXAccumulatorRef r, LXInteger numSamples)
             if (imp->surf2) LXSurfaceRelease(imp->surf2);
             imp->surf1 = NULL;
             imp->surf2 = NULL;        
+            LXSurfaceRelease(imp->resultSurf);
+            imp->resultSurf = NULL;
         }
         
         imp->numSamples = numSamples;
@@ -164,6 +209,271 @@ LXBool LXAccumulatorMatchesSize(LXAccumulatorRef r, LXSize size)
 }
 
 
+#pragma mark --- CPU accumulation ---
+
+#define ACC_BAND_ROWS       16
+#define ACC_CHUNK_FLOATS    1024    // float16 rows are decoded in chunks of this size to stay in L1
+
+typedef struct {
+    float *acc;
+    size_t accRowFloats;
+    
+    const uint8_t *src;
+    size_t srcRowBytes;
+    LXPixelFormat srcPxFormat;
+    
+    uint32_t w, h;
+    float opacity;
+    LXBool isFirst;     // the first sample is stored instead of added, so the buffer needn't be cleared
+} LXAccumulateJob;
+
+
+// acc = src * op  or  acc += src * op
+static void accumulateFloatRow(float * LXRESTRICT acc, const float * LXRESTRICT src, size_t n, float op, LXBool isFirst)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 vop = _mm_set1_ps(op);
+    if (isFirst) {
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(acc + i, _mm_mul_ps(_mm_loadu_ps(src + i), vop));
+    } else {
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), vop)));
+    }
+#endif
+    if (isFirst) {
+        for (; i < n; i++)  acc[i] = src[i] * op;
+    } else {
+        for (; i < n; i++)  acc[i] += src[i] * op;
+    }
+}
+
+static void accumulateHalfRow(float * LXRESTRICT acc, const LXHalf * LXRESTRICT src, size_t n, float op, LXBool isFirst)
+{
+    float tmp[ACC_CHUNK_FLOATS];
+    size_t i;
+    for (i = 0; i < n; i += ACC_CHUNK_FLOATS) {
+        const size_t count = MIN(ACC_CHUNK_FLOATS, n - i);
+        LXConvertHalfToFloatArray(src + i, tmp, count);
+        accumulateFloatRow(acc + i, tmp, count, op, isFirst);
+    }
+}
+
+// 8-bit RGBA with the channels at the given byte offsets (R, G, B, A)
+#define ACC_INT8_ROW_FUNC(name_, r_, g_, b_, a_, sseShuffle_) \
+static void name_(float * LXRESTRICT acc, const uint8_t * LXRESTRICT src, uint32_t w, float op, LXBool isFirst) \
+{ \
+    const float scale = op * (1.0f / 255.0f); \
+    uint32_t x = 0; \
+    ACC_INT8_SSE2_LOOP(sseShuffle_) \
+    for (; x < w; x++) { \
+        const uint8_t *s = src + x * 4; \
+        float *d = acc + x * 4; \
+        if (isFirst) { \
+            d[0] = s[r_] * scale;  d[1] = s[g_] * scale;  d[2] = s[b_] * scale;  d[3] = s[a_] * scale; \
+        } else { \
+            d[0] += s[r_] * scale;  d[1] += s[g_] * scale;  d[2] += s[b_] * scale;  d[3] += s[a_] * scale; \
+        } \
+    } \
+}
+
+#if defined(__SSE2__)
+// four pixels at a time: each pixel is widened to 32 bits in its own register, where the channels can be reordered
+#define ACC_INT8_SSE2_PIXEL(v_, i_, shuffle_) { \
+        __m128 f_ = _mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi32(v_, shuffle_)), vscale); \
+        float *d_ = acc + (x + i_) * 4; \
+        _mm_storeu_ps(d_, (isFirst) ? f_ : _mm_add_ps(_mm_loadu_ps(d_), f_)); \
+    }
+
+#define ACC_INT8_SSE2_LOOP(shuffle_) \
+    { \
+        const __m128 vscale = _mm_set1_ps(scale); \
+        const __m128i zero = _mm_setzero_si128(); \
+        for (; x + 4 <= w; x += 4) { \
+            const __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4)); \
+            const __m128i lo = _mm_unpacklo_epi8(v, zero); \
+            const __m128i hi = _mm_unpackhi_epi8(v, zero); \
+            const __m128i p0 = _mm_unpacklo_epi16(lo, zero); \
+            const __m128i p1 = _mm_unpackhi_epi16(lo, zero); \
+            const __m128i p2 = _mm_unpacklo_epi16(hi, zero); \
+            const __m128i p3 = _mm_unpackhi_epi16(hi, zero); \
+            ACC_INT8_SSE2_PIXEL(p0, 0, shuffle_) \
+            ACC_INT8_SSE2_PIXEL(p1, 1, shuffle_) \
+            ACC_INT8_SSE2_PIXEL(p2, 2, shuffle_) \
+            ACC_INT8_SSE2_PIXEL(p3, 3, shuffle_) \
+        } \
+    }
+#else
+#define ACC_INT8_SSE2_LOOP(shuffle_)
+#endif
+
+ACC_INT8_ROW_FUNC(accumulateRGBAInt8Row, 0, 1, 2, 3, _MM_SHUFFLE(3, 2, 1, 0))
+ACC_INT8_ROW_FUNC(accumulateARGBInt8Row, 1, 2, 3, 0, _MM_SHUFFLE(0, 3, 2, 1))
+ACC_INT8_ROW_FUNC(accumulateBGRAInt8Row, 2, 1, 0, 3, _MM_SHUFFLE(3, 0, 1, 2))
+
+
+// luminance is expanded to RGB with alpha 1
+static void accumulateLuminanceRow(float * LXRESTRICT acc, const uint8_t * LXRESTRICT src, LXPixelFormat pxFormat, uint32_t w, float op, LXBool isFirst)
+{
+    uint32_t x;
+    for (x = 0; x < w; x++) {
+        float l;
+        switch (pxFormat) {
+            default:
+            case kLX_Luminance_INT8:     l = src[x] * (1.0f / 255.0f);  break;
+            case kLX_Luminance_FLOAT16:  l = LXFloatFromHalf(((const LXHalf *)src)[x]);  break;
+            case kLX_Luminance_FLOAT32:  l = ((const float *)src)[x];  break;
+        }
+        l *= op;
+        float *d = acc + x * 4;
+        if (isFirst) {
+            d[0] = l;  d[1] = l;  d[2] = l;  d[3] = op;
+        } else {
+            d[0] += l;  d[1] += l;  d[2] += l;  d[3] += op;
+        }
+    }
+}
+
+
+static LXBool canAccumulatePixelFormatDirectly(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT16:
+        case kLX_Luminance_FLOAT32:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+static void accumulateBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger bandY0, LXInteger bandY1)
+{
+    LXAccumulateJob *job = (LXAccumulateJob *)userData;
+    const uint32_t y0 = (uint32_t)bandY0;
+    const uint32_t y1 = (uint32_t)bandY1;
+    const uint32_t w = job->w;
+    uint32_t y;
+    
+    for (y = y0; y < y1; y++) {
+        float *acc = job->acc + y * job->accRowFloats;
+        const uint8_t *src = job->src + y * job->srcRowBytes;
+        
+        switch (job->srcPxFormat) {
+            case kLX_RGBA_INT8:     accumulateRGBAInt8Row(acc, src, w, job->opacity, job->isFirst);  break;
+            case kLX_ARGB_INT8:     accumulateARGBInt8Row(acc, src, w, job->opacity, job->isFirst);  break;
+            case kLX_BGRA_INT8:     accumulateBGRAInt8Row(acc, src, w, job->opacity, job->isFirst);  break;
+            case kLX_RGBA_FLOAT16:  accumulateHalfRow(acc, (const LXHalf *)src, w * 4, job->opacity, job->isFirst);  break;
+            case kLX_RGBA_FLOAT32:  accumulateFloatRow(acc, (const float *)src, w * 4, job->opacity, job->isFirst);  break;
+            default:                accumulateLuminanceRow(acc, src, job->srcPxFormat, w, job->opacity, job->isFirst);  break;
+        }
+    }
+}
+
+static void accumulatePixelBufferOnCPU(LXAccumulatorImpl *imp, LXPixelBufferRef pixbuf, LXFloat op)
+{
+    LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+    LXPixelBufferRef convPixbuf = NULL;
+    LXDECLERROR(err)
+    
+    if ( !LXPixelBufferMatchesSize(pixbuf, imp->size)) {
+        LXPrintf("** %s: pixel buffer size doesn't match accumulator (%i * %i)\n", __func__,
+                        (int)LXPixelBufferGetWidth(pixbuf), (int)LXPixelBufferGetHeight(pixbuf));
+        return;
+    }
+    
+    // other formats (YCbCr) are converted first
+    if ( !canAccumulatePixelFormatDirectly(pxFormat)) {
+        convPixbuf = LXPixelBufferCreate(NULL, imp->size.w, imp->size.h, kLX_RGBA_FLOAT32, &err);
+        if ( !convPixbuf || !LXPixelBufferCopyPixelBufferWithPixelFormatConversion(convPixbuf, pixbuf, &err)) {
+            LXPrintf("** %s: can't convert pixel format %i (error %i: %s)\n", __func__, (int)pxFormat, err.errorID, err.description);
+            LXErrorDestroyOnStack(err);
+            LXPixelBufferRelease(convPixbuf);
+            return;
+        }
+        pixbuf = convPixbuf;
+        pxFormat = kLX_RGBA_FLOAT32;
+    }
+    
+    if ( !imp->accBuf) {
+        imp->accRowFloats = (size_t)imp->size.w * 4;
+        imp->accBuf = _lx_malloc(imp->accRowFloats * (size_t)imp->size.h * sizeof(float));
+    }
+    
+    LXAccumulateJob job;
+    memset(&job, 0, sizeof(job));
+    job.acc = imp->accBuf;
+    job.accRowFloats = imp->accRowFloats;
+    job.srcPxFormat = pxFormat;
+    job.w = imp->size.w;
+    job.h = imp->size.h;
+    job.opacity = op;
+    job.isFirst = (imp->currentSample == 0);
+    
+    job.src = LXPixelBufferLockPixels(pixbuf, &job.srcRowBytes, NULL, &err);
+    if ( !job.src) {
+        LXPrintf("** %s: can't lock pixel buffer (error %i: %s)\n", __func__, err.errorID, err.description);
+        LXErrorDestroyOnStack(err);
+        LXPixelBufferRelease(convPixbuf);
+        return;
+    }
+    
+    LXParallelApplyToRowBands(job.w, job.h, ACC_BAND_ROWS, 0, accumulateBand, &job);
+    
+    LXPixelBufferUnlockPixels(pixbuf);
+    LXPixelBufferRelease(convPixbuf);
+    
+    imp->currentSample++;
+}
+
+static void accumulateTextureOnCPU(LXAccumulatorImpl *imp, LXTextureRef texture, LXFloat op)
+{
+    LXDECLERROR(err)
+    
+    if ( !imp->texReadPixbuf) {
+        imp->texReadPixbuf = LXPixelBufferCreate(NULL, imp->size.w, imp->size.h, kLX_RGBA_FLOAT32, &err);
+    }
+    if ( !imp->texReadPixbuf || !LXTextureCopyContentsIntoPixelBuffer(texture, imp->texReadPixbuf, &err)) {
+        LXPrintf("** %s: can't read texture (error %i: %s)\n", __func__, err.errorID, err.description);
+        LXErrorDestroyOnStack(err);
+        return;
+    }
+    
+    accumulatePixelBufferOnCPU(imp, imp->texReadPixbuf, op);
+}
+
+static LXSurfaceRef finishAccumulationOnCPU(LXAccumulatorImpl *imp)
+{
+    LXDECLERROR(err)
+    
+    if ( !imp->resultSurf) {
+        imp->resultSurf = LXSurfaceCreate(imp->surfPool, imp->size.w, imp->size.h, imp->pxFormat, 0, &err);
+    }
+    LXTextureRef tex = (imp->resultSurf) ? LXTextureCreateWithData(imp->size.w, imp->size.h, kLX_RGBA_FLOAT32,
+                                                                   (uint8_t *)imp->accBuf, imp->accRowFloats * sizeof(float),
+                                                                   kLXStorageHint_ClientStorage, &err)
+                                         : NULL;
+    if ( !tex) {
+        LXPrintf("** %s: can't create result (error %i: %s)\n", __func__, err.errorID, err.description);
+        LXErrorDestroyOnStack(err);
+        return NULL;
+    }
+    
+    LXSurfaceCopyTexture(imp->resultSurf, tex, NULL);
+    LXSurfaceFlush(imp->resultSurf);
+    LXTextureRelease(tex);
+    
+    return LXSurfaceRetain(imp->resultSurf);
+}
+
+
+
 #pragma mark --- accumulation ---
 
 LXBool LXAccumulatorStartAccumulation(LXAccumulatorRef r, LXError *outError)
@@ -173,6 +483,9 @@ LXBool LXAccumulatorStartAccumulation(LXAccumulatorRef r, LXError *outError)
 
     imp->currentSample = 0;
     
+    if (imp->useCPU)
+        return YES;
+    
     if ( !imp->surf1) {
         imp->surf1 = LXSurfaceCreate(imp->surfPool, imp->size.w, imp->size.h, imp->pxFormat, 0, outError);
         if ( !imp->surf1) return NO;
@@ -203,6 +516,11 @@ void LXAccumulatorAccumulateTextureWithOpacity(LXAccumulatorRef r, LXTextureRef
     if ( !texture) return;
     LXAccumulatorImpl *imp = (LXAccumulatorImpl *)r;
     
+    if (imp->useCPU) {
+        accumulateTextureOnCPU(imp, texture, op);
+        return;
+    }
+    
     const LXBool isFirstPass = (imp->currentSample == 0);
     const LXBool isEvenPass = (imp->currentSample % 2 == 0);
     LXSurfaceRef surf = (isEvenPass) ? imp->surf1 : imp->surf2;
@@ -232,6 +550,30 @@ void LXAccumulatorAccumulateTextureWithOpacity(LXAccumulatorRef r, LXTextureRef
     LXDrawContextRelease(drawCtx);
 }
 
+void LXAccumulatorAccumulatePixelBuffer(LXAccumulatorRef r, LXPixelBufferRef pixbuf)
+{
+    if ( !r) return;
+    LXAccumulatorImpl *imp = (LXAccumulatorImpl *)r;
+    
+    LXFloat opacity = (imp->numSamples <= 0) ? 1.0
+                                             : (1.0 / imp->numSamples);
+    
+    LXAccumulatorAccumulatePixelBufferWithOpacity(r, pixbuf, opacity);
+}
+
+void LXAccumulatorAccumulatePixelBufferWithOpacity(LXAccumulatorRef r, LXPixelBufferRef pixbuf, LXFloat op)
+{
+    if ( !r) return;
+    if ( !pixbuf) return;
+    LXAccumulatorImpl *imp = (LXAccumulatorImpl *)r;
+    
+    if (imp->useCPU) {
+        accumulatePixelBufferOnCPU(imp, pixbuf, op);
+    } else {
+        LXAccumulatorAccumulateTextureWithOpacity(r, LXPixelBufferGetTexture(pixbuf, NULL), op);
+    }
+}
+
 LXSurfaceRef LXAccumulatorFinishAccumulation(LXAccumulatorRef r)
 {
     if ( !r) return NULL;
@@ -241,10 +583,42 @@ LXSurfaceRef LXAccumulatorFinishAccumulation(LXAccumulatorRef r)
         return NULL;
     }
     
+    if (imp->useCPU)
+        return finishAccumulationOnCPU(imp);
+    
     const LXBool isEvenPass = (imp->currentSample % 2 == 0);
     LXSurfaceRef lastSurf = (isEvenPass) ? imp->surf2 : imp->surf1;
     
     return LXSurfaceRetain(lastSurf);
 }
 
-
+LXPixelBufferRef LXAccumulatorFinishAccumulationIntoPixelBuffer(LXAccumulatorRef r, LXPixelFormat pxFormat, LXError *outError)
+{
+    if ( !r) return NULL;
+    LXAccumulatorImpl *imp = (LXAccumulatorImpl *)r;
+    
+    if (imp->currentSample <= 0) {
+        LXErrorSet(outError, 4850, "no samples were accumulated");
+        return NULL;
+    }
+    
+    LXPixelBufferRef pixbuf = LXPixelBufferCreate(NULL, imp->size.w, imp->size.h, pxFormat, outError);
+    if ( !pixbuf)
+        return NULL;
+    
+    LXSuccess ok;
+    if (imp->useCPU) {
+        ok = LXPixelBufferWriteDataWithPixelFormatConversion(pixbuf, (const uint8_t *)imp->accBuf, imp->size.w, imp->size.h,
+                                                             imp->accRowFloats * sizeof(float), kLX_RGBA_FLOAT32, NULL, outError);
+    } else {
+        LXSurfaceRef surf = LXAccumulatorFinishAccumulation(r);
+        ok = LXSurfaceCopyContentsIntoPixelBuffer(surf, pixbuf, outError);
+        LXSurfaceRelease(surf);
+    }
+    
+    if ( !ok) {
+        LXPixelBufferRelease(pixbuf);
+        pixbuf = NULL;
+    }
+    return pixbuf;
+}
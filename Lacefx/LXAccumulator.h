@@ -20,6 +20,13 @@
 #include "LXPool.h"
 
 
+enum {
+    // accumulates into a float32 buffer in main memory instead of GPU surfaces.
+    // this is the default on platforms that use the software renderer.
+    kLXAccumulatorFlag_UseCPU = 1 << 0
+};
+
+
 #pragma mark --- LXAccumulator public API methods ---
 
 LXEXPORT const char *LXAccumulatorTypeID();
@@ -41,7 +48,13 @@ LXEXPORT LXBool LXAccumulatorStartAccumulation(LXAccumulatorRef r, LXError *outE
 LXEXPORT void LXAccumulatorAccumulateTexture(LXAccumulatorRef acc, LXTextureRef texture);
 LXEXPORT void LXAccumulatorAccumulateTextureWithOpacity(LXAccumulatorRef acc, LXTextureRef texture, LXFloat opacity);
 
+LXEXPORT void LXAccumulatorAccumulatePixelBuffer(LXAccumulatorRef acc, LXPixelBufferRef pixbuf);
+LXEXPORT void LXAccumulatorAccumulatePixelBufferWithOpacity(LXAccumulatorRef acc, LXPixelBufferRef pixbuf, LXFloat opacity);
+
 LXEXPORT LXSurfaceRef LXAccumulatorFinishAccumulation(LXAccumulatorRef acc);  // returned surface is retained
 
+// returns the accumulated image in the requested pixel format (returned pixel buffer is retained)
+LXEXPORT LXPixelBufferRef LXAccumulatorFinishAccumulationIntoPixelBuffer(LXAccumulatorRef acc, LXPixelFormat pxFormat, LXError *outError);
+
 
 #endif // _LXACCUMULATOR_H_
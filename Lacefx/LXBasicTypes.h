@@ -346,6 +346,9 @@ enum {
     kLX_Luminance_FLOAT32,
     
     kLX_YCbCr422_INT8 = 0x200,      // equal to '2vuy' QuickTime pixel format and 'UYVY' Win32 pixel format
+    kLX_YCbCr420_planar_INT8,       // 'I420': Y plane followed by half-size Cb and Cr planes
+    kLX_YCbCr420_biplanar_INT8,     // 'NV12': Y plane followed by a half-size plane of interleaved Cb/Cr pairs
+    kLX_YCbCr444_planar_INT8,       // three full-size planes (Y, Cb, Cr) as stored by unsubsampled JPEG
 
     kLX_ARGB_INT8 = 0x300,          // supported for QuickTime / CG compatibility; should only be used for textures
     kLX_BGRA_INT8,                  // Cairo only supports this format on OS X x86 so we need to support it; same caveat as above
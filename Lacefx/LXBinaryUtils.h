@@ -12,8 +12,8 @@
  
  */
 
-#ifndef _LXSHADERUTILS_H_
-#define _LXSHADERUTILS_H_
+#ifndef _LXBINARYUTILS_H_
+#define _LXBINARYUTILS_H_
 
 #include "LXBasicTypes.h"
 
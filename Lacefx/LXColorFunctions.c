@@ -39,50 +39,45 @@ static void print_matrix_4x4(float *m)
 	}
 }
 
+// color matrices are 3x3; the fourth row and column of the returned matrix are those of the identity matrix
 static void LX4x4MatrixFromGLStyleFloatMatrix(LX4x4Matrix *m, const float *inm)
 {
-        m->m11 = MAT(inm, 1, 1);
-        m->m12 = MAT(inm, 2, 1);
-        m->m13 = MAT(inm, 3, 1);
-        m->m14 = MAT(inm, 4, 1);
+        *m = *LXIdentity4x4Matrix;
         
-        m->m21 = MAT(inm, 1, 2);
-        m->m22 = MAT(inm, 2, 2);
-        m->m23 = MAT(inm, 3, 2);
-        m->m24 = MAT(inm, 4, 2);
+        m->m11 = MAT(inm, 0, 0);
+        m->m12 = MAT(inm, 0, 1);
+        m->m13 = MAT(inm, 0, 2);
         
-        m->m31 = MAT(inm, 1, 3);
-        m->m32 = MAT(inm, 2, 3);
-        m->m33 = MAT(inm, 3, 3);
-        m->m34 = MAT(inm, 4, 3);
+        m->m21 = MAT(inm, 1, 0);
+        m->m22 = MAT(inm, 1, 1);
+        m->m23 = MAT(inm, 1, 2);
         
-        m->m41 = MAT(inm, 1, 4);
-        m->m42 = MAT(inm, 2, 4);
-        m->m43 = MAT(inm, 3, 4);
-        m->m44 = MAT(inm, 4, 4);
+        m->m31 = MAT(inm, 2, 0);
+        m->m32 = MAT(inm, 2, 1);
+        m->m33 = MAT(inm, 2, 2);
 }
 
 static void LXGLStyleFloatMatrixFrom4x4Matrix(float *m, const LX4x4Matrix *inm)
 {
-        MAT(m, 1, 1) = inm->m11;
-        MAT(m, 2, 1) = inm->m12;
-        MAT(m, 3, 1) = inm->m13;
-        MAT(m, 4, 1) = inm->m14;
-
-        MAT(m, 1, 2) = inm->m21;
-        MAT(m, 2, 2) = inm->m22;
-        MAT(m, 3, 2) = inm->m23;
-        MAT(m, 4, 2) = inm->m24;
+        MAT(m, 0, 0) = inm->m11;
+        MAT(m, 0, 1) = inm->m12;
+        MAT(m, 0, 2) = inm->m13;
+        MAT(m, 0, 3) = inm->m14;
+
+        MAT(m, 1, 0) = inm->m21;
+        MAT(m, 1, 1) = inm->m22;
+        MAT(m, 1, 2) = inm->m23;
+        MAT(m, 1, 3) = inm->m24;
         
-        MAT(m, 1, 3) = inm->m31;
-        MAT(m, 2, 3) = inm->m32;
-        MAT(m, 3, 3) = inm->m33;
-        MAT(m, 4, 3) = inm->m34;
-
-        MAT(m, 1, 4) = inm->m41;
-        MAT(m, 2, 4) = inm->m42;
-        MAT(m, 3, 4) = inm->m43;
-        MAT(m, 4, 4) = inm->m44;
+        MAT(m, 2, 0) = inm->m31;
+        MAT(m, 2, 1) = inm->m32;
+        MAT(m, 2, 2) = inm->m33;
+        MAT(m, 2, 3) = inm->m34;
+
+        MAT(m, 3, 0) = inm->m41;
+        MAT(m, 3, 1) = inm->m42;
+        MAT(m, 3, 2) = inm->m43;
+        MAT(m, 3, 3) = inm->m44;
 }
 
 
@@ -193,6 +188,39 @@ void LXColorXYZfromYxy(float *outXYZ, float Y, float x, float y)
 }
 
 
+void LXColorGetWhitePointChromaticity(LXColorXYZWhitePoint white, float *outX, float *outY)
+{
+	float x, y;
+	switch (white) {
+		case kLXWhitePoint_D65:
+		default:
+			x = kLXWhitePoint_D65_x;  y = kLXWhitePoint_D65_y;  break;
+		case kLXWhitePoint_D40:
+			x = kLXWhitePoint_D40_x;  y = kLXWhitePoint_D40_y;  break;
+		case kLXWhitePoint_D45:
+			x = kLXWhitePoint_D45_x;  y = kLXWhitePoint_D45_y;  break;
+		case kLXWhitePoint_D50:
+			x = kLXWhitePoint_D50_x;  y = kLXWhitePoint_D50_y;  break;
+		case kLXWhitePoint_D55:
+			x = kLXWhitePoint_D55_x;  y = kLXWhitePoint_D55_y;  break;
+		case kLXWhitePoint_D60:
+			x = kLXWhitePoint_D60_x;  y = kLXWhitePoint_D60_y;  break;
+		case kLXWhitePoint_D70:
+			x = kLXWhitePoint_D70_x;  y = kLXWhitePoint_D70_y;  break;
+		case kLXWhitePoint_A:
+			x = kLXWhitePoint_A_x;  y = kLXWhitePoint_A_y;  break;
+		case kLXWhitePoint_B:
+			x = kLXWhitePoint_B_x;  y = kLXWhitePoint_B_y;  break;
+		case kLXWhitePoint_C:
+			x = kLXWhitePoint_C_x;  y = kLXWhitePoint_C_y;  break;
+		case kLXWhitePoint_E:
+			x = kLXWhitePoint_E_x;  y = kLXWhitePoint_E_y;  break;
+	}
+	if (outX) *outX = x;
+	if (outY) *outY = y;
+}
+
+
 void LXColorGetChromaticAdaptationMatrix(LX4x4Matrix *mOut, LXColorXYZWhitePoint srcWhite, LXColorXYZWhitePoint dstWhite)
 {
 	// this conversion math is from www.brucelindbloom.com/index.html?Eqn_ChromAdapt.html
@@ -231,41 +259,8 @@ void LXColorGetChromaticAdaptationMatrix(LX4x4Matrix *mOut, LXColorXYZWhitePoint
 		0, 0, 0, 0 };
 		
 	float src_x, src_y, dst_x, dst_y;
-	switch (srcWhite) {
-		case kLXWhitePoint_D65:
-		default:
-			src_x = kLXWhitePoint_D65_x;  src_y = kLXWhitePoint_D65_y;  break;
-		case kLXWhitePoint_D40:
-			src_x = kLXWhitePoint_D40_x;  src_y = kLXWhitePoint_D40_y;  break;
-		case kLXWhitePoint_D45:
-			src_x = kLXWhitePoint_D45_x;  src_y = kLXWhitePoint_D45_y;  break;
-		case kLXWhitePoint_D50:
-			src_x = kLXWhitePoint_D50_x;  src_y = kLXWhitePoint_D50_y;  break;
-		case kLXWhitePoint_D55:
-			src_x = kLXWhitePoint_D55_x;  src_y = kLXWhitePoint_D55_y;  break;
-		case kLXWhitePoint_D60:
-			src_x = kLXWhitePoint_D60_x;  src_y = kLXWhitePoint_D60_y;  break;
-		case kLXWhitePoint_D70:
-			src_x = kLXWhitePoint_D70_x;  src_y = kLXWhitePoint_D70_y;  break;
-	}
-
-	switch (dstWhite) {
-		case kLXWhitePoint_D65:
-		default:
-			dst_x = kLXWhitePoint_D65_x;  dst_y = kLXWhitePoint_D65_y;  break;
-		case kLXWhitePoint_D40:
-			dst_x = kLXWhitePoint_D40_x;  dst_y = kLXWhitePoint_D40_y;  break;
-		case kLXWhitePoint_D45:
-			dst_x = kLXWhitePoint_D45_x;  dst_y = kLXWhitePoint_D45_y;  break;
-		case kLXWhitePoint_D50:
-			dst_x = kLXWhitePoint_D50_x;  dst_y = kLXWhitePoint_D50_y;  break;
-		case kLXWhitePoint_D55:
-			dst_x = kLXWhitePoint_D55_x;  dst_y = kLXWhitePoint_D55_y;  break;
-		case kLXWhitePoint_D60:
-			dst_x = kLXWhitePoint_D60_x;  dst_y = kLXWhitePoint_D60_y;  break;
-		case kLXWhitePoint_D70:
-			dst_x = kLXWhitePoint_D70_x;  dst_y = kLXWhitePoint_D70_y;  break;
-	}
+	LXColorGetWhitePointChromaticity(srcWhite, &src_x, &src_y);
+	LXColorGetWhitePointChromaticity(dstWhite, &dst_x, &dst_y);
 	
 	// convert white point xy coordinates to XYZ (Y == 1.0)
 	float srcXYZ[4];
@@ -279,11 +274,12 @@ void LXColorGetChromaticAdaptationMatrix(LX4x4Matrix *mOut, LXColorXYZWhitePoint
 	///printf("src white %f %f %f --- ", srcXYZ[0], srcXYZ[1], srcXYZ[2]);
 	///printf("dst white %f %f %f\n", dstXYZ[0], dstXYZ[1], dstXYZ[2]);
 	
-	transpose_matrix_4x4(mat_MA_bradford, mat_MA_bradford);
-	transpose_matrix_4x4(mat_MAinv_bradford, mat_MAinv_bradford);
+	// transform_vector() expects a transposed matrix
+	float mat_MA_transposed[16];
+	transpose_matrix_4x4(mat_MA_transposed, mat_MA_bradford);
 	
-	transform_vector(srcConeVec, srcXYZ, mat_MA_bradford);
-	transform_vector(dstConeVec, dstXYZ, mat_MA_bradford);
+	transform_vector(srcConeVec, srcXYZ, mat_MA_transposed);
+	transform_vector(dstConeVec, dstXYZ, mat_MA_transposed);
 	
 	///printf("src cone  %f %f %f --- ", srcConeVec[0], srcConeVec[1], srcConeVec[2]);
 	///printf("dst cone  %f %f %f\n", dstConeVec[0], dstConeVec[1], dstConeVec[2]);
@@ -295,8 +291,9 @@ void LXColorGetChromaticAdaptationMatrix(LX4x4Matrix *mOut, LXColorXYZWhitePoint
 	mat_cone[5] = dstConeVec[1] / srcConeVec[1];
 	mat_cone[10] = dstConeVec[2] / srcConeVec[2];
 	
-	matmul4(mat_M, mat_cone, mat_MAinv_bradford);
-	matmul4(mat_M, mat_MA_bradford, mat_M);
+	// M = MA^-1 * cone * MA
+	matmul4(mat_M, mat_cone, mat_MA_bradford);
+	matmul4(mat_M, mat_MAinv_bradford, mat_M);
 	
 	///print_matrix_4x4(mat_M);
     
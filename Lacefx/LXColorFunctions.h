@@ -69,7 +69,8 @@ LXEXPORT void LXColorXYZfromYxy(float *outXYZ, float Y, float x, float y);
 
 // -- color matrix utilities --
 // returned matrices use LXTransform3D compatible layout,
-// (i.e. transposed compared to OpenGL layout)
+// (i.e. transposed compared to OpenGL layout), so they can be applied with LXTransform3DTransformVector().
+// the fourth row and column are those of the identity matrix
 
 LXEXPORT void LXColorRGBtoXYZTransformMatrixFromChromaticities(LX4x4Matrix *mOut,
 													  float xr, float xg, float xb,
@@ -85,6 +86,8 @@ LXEXPORT void LXColorConvertChromaticityWhitePoint_xy_to_RGB(float *rgbOut,
                                                       float xr, float xg, float xb, float xw,
                                                       float yr, float yg, float yb, float yw );
 
+LXEXPORT void LXColorGetWhitePointChromaticity(LXColorXYZWhitePoint white, float *outX, float *outY);
+
 LXEXPORT void LXColorGetChromaticAdaptationMatrix(LX4x4Matrix *mOut,
                                                   LXColorXYZWhitePoint srcWhite, LXColorXYZWhitePoint dstWhite);
 // ( more information on chromatic adaptation:
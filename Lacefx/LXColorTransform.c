@@ -0,0 +1,727 @@
+/*
+ *  LXColorTransform.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXColorTransform.h"
+#include "LXColorFunctions.h"
+#include "LXPixelBuffer.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include "LXMutex.h"
+#include "LXRef_Impl.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+enum {
+    kCurveLinear = 0,
+    kCurve_sRGB,
+    kCurveGamma,        // pure power function (AdobeRGB)
+    kCurveProPhoto      // power 1.8 with a linear segment near black (ROMM RGB)
+};
+
+typedef struct {
+    LXColorSpaceEncoding colorSpace;
+    float xr, yr, xg, yg, xb, yb;   // primaries
+    LXColorXYZWhitePoint white;
+    LXUInteger curve;
+    double gamma;
+} LXColorSpaceDesc;
+
+static const LXColorSpaceDesc s_colorSpaces[] = {
+    { kLX_CanonicalLinearRGB,   0.64f, 0.33f,    0.30f, 0.60f,    0.15f, 0.06f,     kLXWhitePoint_D65,  kCurveLinear,   1.0 },
+    { kLX_sRGB,                 0.64f, 0.33f,    0.30f, 0.60f,    0.15f, 0.06f,     kLXWhitePoint_D65,  kCurve_sRGB,    2.4 },
+    { kLX_AdobeRGB_1998,        0.64f, 0.33f,    0.21f, 0.71f,    0.15f, 0.06f,     kLXWhitePoint_D65,  kCurveGamma,    563.0 / 256.0 },
+    { kLX_ProPhotoRGB,          0.7347f, 0.2653f,  0.1596f, 0.8404f,  0.0366f, 0.0001f,  kLXWhitePoint_D50,  kCurveProPhoto, 1.8 },
+};
+
+#define NUMCOLORSPACES  (sizeof(s_colorSpaces) / sizeof(LXColorSpaceDesc))
+
+
+// the decode table is indexed by the encoded value.
+// the encode table is indexed by the square root of the linear value, which puts more of its entries
+// into the steep part of the curves near black (a pure power curve like AdobeRGB's has an infinite slope at zero).
+// both have an extra entry at the end so that interpolation at 1.0 can read the next entry.
+#define DECODE_LUTSIZE  1024
+#define ENCODE_LUTSIZE  4096
+
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    const LXColorSpaceDesc *src;
+    const LXColorSpaceDesc *dst;
+    LXBool isIdentity;
+    LXBool matrixIsIdentity;
+
+    float mat[9];       // row-major; linear source RGB -> linear destination RGB
+
+    float decode8[256];
+    float decodeLUT[DECODE_LUTSIZE + 2];
+    float encodeLUT[ENCODE_LUTSIZE + 2];
+    uint8_t encode8[ENCODE_LUTSIZE + 1];    // clamped and rounded, for 8-bit output
+} LXColorTransformImpl;
+
+
+static const LXColorSpaceDesc *descForColorSpace(LXColorSpaceEncoding colorSpace)
+{
+    LXUInteger i;
+    for (i = 0; i < NUMCOLORSPACES; i++) {
+        if (s_colorSpaces[i].colorSpace == colorSpace)
+            return s_colorSpaces + i;
+    }
+    return NULL;
+}
+
+
+#pragma mark --- transfer curves ---
+
+// the curves are extended to negative values as odd functions; above 1.0 they simply continue
+
+static double decodeValue(const LXColorSpaceDesc *cs, double v)
+{
+    if (v < 0.0) return -decodeValue(cs, -v);
+
+    switch (cs->curve) {
+        case kCurve_sRGB:       return (v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+        case kCurveGamma:       return pow(v, cs->gamma);
+        case kCurveProPhoto:    return (v < 16.0 / 512.0) ? v / 16.0 : pow(v, 1.8);
+        default:                return v;
+    }
+}
+
+static double encodeValue(const LXColorSpaceDesc *cs, double v)
+{
+    if (v < 0.0) return -encodeValue(cs, -v);
+
+    switch (cs->curve) {
+        case kCurve_sRGB:       return (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+        case kCurveGamma:       return pow(v, 1.0 / cs->gamma);
+        case kCurveProPhoto:    return (v < 1.0 / 512.0) ? v * 16.0 : pow(v, 1.0 / 1.8);
+        default:                return v;
+    }
+}
+
+
+#pragma mark --- creation ---
+
+const char *LXColorTransformTypeID()
+{
+    static const char *s = "LXColorTransform";
+    return s;
+}
+
+LXColorTransformRef LXColorTransformRetain(LXColorTransformRef r)
+{
+    if ( !r) return NULL;
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+    return r;
+}
+
+void LXColorTransformRelease(LXColorTransformRef r)
+{
+    if ( !r) return;
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+        _lx_free(imp);
+    }
+}
+
+LXBool LXColorTransformSupportsColorSpace(LXColorSpaceEncoding colorSpace)
+{
+    return (descForColorSpace(colorSpace) != NULL) ? YES : NO;
+}
+
+static void getRGBToXYZMatrix(const LXColorSpaceDesc *cs, LX4x4Matrix *m, LXBool inverse)
+{
+    float wx, wy, scale[3];
+    LXColorGetWhitePointChromaticity(cs->white, &wx, &wy);
+    LXColorConvertChromaticityWhitePoint_xy_to_RGB(scale, cs->xr, cs->xg, cs->xb, wx, cs->yr, cs->yg, cs->yb, wy);
+
+    if ( !inverse)
+        LXColorRGBtoXYZTransformMatrixFromChromaticities(m, cs->xr, cs->xg, cs->xb, cs->yr, cs->yg, cs->yb, scale[0], scale[1], scale[2]);
+    else
+        LXColorXYZtoRGBTransformMatrixFromChromaticities(m, cs->xr, cs->xg, cs->xb, cs->yr, cs->yg, cs->yb, scale[0], scale[1], scale[2]);
+}
+
+static void bakeMatrix(LXColorTransformImpl *imp)
+{
+    const LXColorSpaceDesc *src = imp->src;
+    const LXColorSpaceDesc *dst = imp->dst;
+    float *mat = imp->mat;
+
+    imp->matrixIsIdentity = (src->xr == dst->xr && src->yr == dst->yr && src->xg == dst->xg && src->yg == dst->yg
+                             && src->xb == dst->xb && src->yb == dst->yb && src->white == dst->white);
+    if (imp->matrixIsIdentity) {
+        memset(mat, 0, 9*sizeof(float));
+        mat[0] = mat[4] = mat[8] = 1.0f;
+        return;
+    }
+
+    // source RGB -> XYZ -> chromatic adaptation -> destination RGB
+    LX4x4Matrix m;
+    getRGBToXYZMatrix(src, &m, NO);
+    LXTransform3DRef trs = LXTransform3DCreateWithMatrix(&m);
+
+    if (src->white != dst->white) {
+        LXColorGetChromaticAdaptationMatrix(&m, src->white, dst->white);
+        LXTransform3DConcatMatrix(trs, &m);
+    }
+    getRGBToXYZMatrix(dst, &m, YES);
+    LXTransform3DConcatMatrix(trs, &m);
+
+    LXTransform3DGetMatrix(trs, &m);
+    LXTransform3DRelease(trs);
+
+    mat[0] = m.m11;  mat[1] = m.m12;  mat[2] = m.m13;
+    mat[3] = m.m21;  mat[4] = m.m22;  mat[5] = m.m23;
+    mat[6] = m.m31;  mat[7] = m.m32;  mat[8] = m.m33;
+}
+
+static void bakeCurves(LXColorTransformImpl *imp)
+{
+    LXInteger i;
+    for (i = 0; i < 256; i++) {
+        imp->decode8[i] = decodeValue(imp->src, (double)i / 255.0);
+    }
+    for (i = 0; i <= DECODE_LUTSIZE; i++) {
+        imp->decodeLUT[i] = decodeValue(imp->src, (double)i / DECODE_LUTSIZE);
+    }
+    imp->decodeLUT[DECODE_LUTSIZE + 1] = imp->decodeLUT[DECODE_LUTSIZE];
+
+    for (i = 0; i <= ENCODE_LUTSIZE; i++) {
+        const double u = (double)i / ENCODE_LUTSIZE;
+        imp->encodeLUT[i] = encodeValue(imp->dst, u * u);
+        imp->encode8[i] = (uint8_t)lround(MIN(1.0, MAX(0.0, imp->encodeLUT[i])) * 255.0);
+    }
+    imp->encodeLUT[ENCODE_LUTSIZE + 1] = imp->encodeLUT[ENCODE_LUTSIZE];
+}
+
+LXColorTransformRef LXColorTransformCreate(LXColorSpaceEncoding srcColorSpace, LXColorSpaceEncoding dstColorSpace, LXError *outError)
+{
+    const LXColorSpaceDesc *src = descForColorSpace(srcColorSpace);
+    const LXColorSpaceDesc *dst = descForColorSpace(dstColorSpace);
+
+    if ( !src || !dst) {
+        char msg[256];
+        sprintf(msg, "unsupported color space for transform (%lu)", (unsigned long)(( !src) ? srcColorSpace : dstColorSpace));
+        LXErrorSet(outError, kLXErrorID_ColorTransform_UnsupportedColorSpace, msg);
+        return NULL;
+    }
+
+    LXColorTransformImpl *imp = _lx_calloc(sizeof(LXColorTransformImpl), 1);
+    LXREF_INIT(imp, LXColorTransformTypeID(), LXColorTransformRetain, LXColorTransformRelease);
+
+    imp->src = src;
+    imp->dst = dst;
+    imp->isIdentity = (src == dst);
+
+    bakeMatrix(imp);
+    bakeCurves(imp);
+
+    return (LXColorTransformRef)imp;
+}
+
+LXColorTransformRef LXColorTransformGetShared(LXColorSpaceEncoding srcColorSpace, LXColorSpaceEncoding dstColorSpace)
+{
+    static LXColorTransformRef s_shared[NUMCOLORSPACES][NUMCOLORSPACES];
+    const LXColorSpaceDesc *src = descForColorSpace(srcColorSpace);
+    const LXColorSpaceDesc *dst = descForColorSpace(dstColorSpace);
+    LXColorTransformRef *pShared;
+    LXColorTransformRef t, newT;
+
+    if ( !src || !dst) return NULL;
+
+    pShared = &(s_shared[src - s_colorSpaces][dst - s_colorSpaces]);
+
+    LXMutexLock(g_lxAtomicLock);
+    t = *pShared;
+    LXMutexUnlock(g_lxAtomicLock);
+    if (t) return t;
+
+    // created outside the lock; if another thread got there first, its transform is used
+    newT = LXColorTransformCreate(srcColorSpace, dstColorSpace, NULL);
+
+    LXMutexLock(g_lxAtomicLock);
+    if ( !*pShared) {
+        *pShared = newT;
+        newT = NULL;
+    }
+    t = *pShared;
+    LXMutexUnlock(g_lxAtomicLock);
+
+    LXColorTransformRelease(newT);
+    return t;
+}
+
+
+#pragma mark --- accessors ---
+
+LXColorSpaceEncoding LXColorTransformGetSourceColorSpace(LXColorTransformRef r)
+{
+    if ( !r) return 0;
+    return ((LXColorTransformImpl *)r)->src->colorSpace;
+}
+
+LXColorSpaceEncoding LXColorTransformGetDestinationColorSpace(LXColorTransformRef r)
+{
+    if ( !r) return 0;
+    return ((LXColorTransformImpl *)r)->dst->colorSpace;
+}
+
+LXBool LXColorTransformIsIdentity(LXColorTransformRef r)
+{
+    if ( !r) return YES;
+    return ((LXColorTransformImpl *)r)->isIdentity;
+}
+
+void LXColorTransformGetMatrix(LXColorTransformRef r, LX4x4Matrix *outMatrix)
+{
+    if ( !r || !outMatrix) return;
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+    const float *mat = imp->mat;
+
+    *outMatrix = *LXIdentity4x4Matrix;
+    outMatrix->m11 = mat[0];  outMatrix->m12 = mat[1];  outMatrix->m13 = mat[2];
+    outMatrix->m21 = mat[3];  outMatrix->m22 = mat[4];  outMatrix->m23 = mat[5];
+    outMatrix->m31 = mat[6];  outMatrix->m32 = mat[7];  outMatrix->m33 = mat[8];
+}
+
+void LXColorTransformConvertRGB(LXColorTransformRef r, const float *inRGB, float *outRGB)
+{
+    if ( !r || !inRGB || !outRGB) return;
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+    const float *mat = imp->mat;
+
+    const double lr = decodeValue(imp->src, inRGB[0]);
+    const double lg = decodeValue(imp->src, inRGB[1]);
+    const double lb = decodeValue(imp->src, inRGB[2]);
+
+    outRGB[0] = encodeValue(imp->dst, mat[0]*lr + mat[1]*lg + mat[2]*lb);
+    outRGB[1] = encodeValue(imp->dst, mat[3]*lr + mat[4]*lg + mat[5]*lb);
+    outRGB[2] = encodeValue(imp->dst, mat[6]*lr + mat[7]*lg + mat[8]*lb);
+}
+
+
+#pragma mark --- pixel conversion ---
+
+// pixels are converted in chunks of planar channel arrays, so that the matrix and interpolation loops can be vectorized
+#define CT_CHUNK  64
+
+typedef struct {
+    float r[CT_CHUNK];
+    float g[CT_CHUNK];
+    float b[CT_CHUNK];
+    float a[CT_CHUNK];
+} ColorChunk;
+
+static void decodeScalar(const LXColorTransformImpl *imp, float * LXRESTRICT v, LXInteger n)
+{
+    const float *lut = imp->decodeLUT;
+    LXInteger i;
+    for (i = 0; i < n; i++) {
+        const float x = v[i];
+        if (x >= 0.0f && x <= 1.0f) {
+            const float u = x * DECODE_LUTSIZE;
+            const int k = (int)u;
+            const float f = u - (float)k;
+            v[i] = lut[k] + f * (lut[k+1] - lut[k]);
+        } else {
+            v[i] = decodeValue(imp->src, x);
+        }
+    }
+}
+
+static void encodeScalar(const LXColorTransformImpl *imp, float * LXRESTRICT v, LXInteger n)
+{
+    const float *lut = imp->encodeLUT;
+    LXInteger i;
+    for (i = 0; i < n; i++) {
+        const float x = v[i];
+        if (x >= 0.0f && x <= 1.0f) {
+            const float u = sqrtf(x) * ENCODE_LUTSIZE;
+            const int k = (int)u;
+            const float f = u - (float)k;
+            v[i] = lut[k] + f * (lut[k+1] - lut[k]);
+        } else {
+            v[i] = encodeValue(imp->dst, x);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+// interpolates the table at four positions; the tables have no gather-friendly layout, so the loads are scalar
+LXINLINE __m128 lookup4_sse2(const float *lut, __m128 u)
+{
+    const __m128i k = _mm_cvttps_epi32(u);
+    const __m128 f = _mm_sub_ps(u, _mm_cvtepi32_ps(k));
+    int32_t idx[4];
+    _mm_storeu_si128((__m128i *)idx, k);
+    const __m128 a = _mm_setr_ps(lut[idx[0]],   lut[idx[1]],   lut[idx[2]],   lut[idx[3]]);
+    const __m128 b = _mm_setr_ps(lut[idx[0]+1], lut[idx[1]+1], lut[idx[2]+1], lut[idx[3]+1]);
+    return _mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(b, a)));
+}
+
+LXINLINE LXBool isInUnitRange4_sse2(__m128 x)
+{
+    const __m128 inRange = _mm_and_ps(_mm_cmpge_ps(x, _mm_setzero_ps()), _mm_cmple_ps(x, _mm_set1_ps(1.0f)));
+    return (_mm_movemask_ps(inRange) == 0xf);
+}
+#endif
+
+// groups of four that have values outside 0-1 (or NaNs) are done by the scalar functions
+static void decodeChannel(const LXColorTransformImpl *imp, float * LXRESTRICT v, LXInteger n)
+{
+    LXInteger i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(DECODE_LUTSIZE);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(v + i);
+        if (isInUnitRange4_sse2(x))
+            _mm_storeu_ps(v + i, lookup4_sse2(imp->decodeLUT, _mm_mul_ps(x, scale)));
+        else
+            decodeScalar(imp, v + i, 4);
+    }
+#endif
+    decodeScalar(imp, v + i, n - i);
+}
+
+static void encodeChannel(const LXColorTransformImpl *imp, float * LXRESTRICT v, LXInteger n)
+{
+    LXInteger i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(ENCODE_LUTSIZE);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(v + i);
+        if (isInUnitRange4_sse2(x))
+            _mm_storeu_ps(v + i, lookup4_sse2(imp->encodeLUT, _mm_mul_ps(_mm_sqrt_ps(x), scale)));
+        else
+            encodeScalar(imp, v + i, 4);
+    }
+#endif
+    encodeScalar(imp, v + i, n - i);
+}
+
+static void applyMatrix(const LXColorTransformImpl *imp, ColorChunk *c, LXInteger n)
+{
+    const float m0 = imp->mat[0], m1 = imp->mat[1], m2 = imp->mat[2];
+    const float m3 = imp->mat[3], m4 = imp->mat[4], m5 = imp->mat[5];
+    const float m6 = imp->mat[6], m7 = imp->mat[7], m8 = imp->mat[8];
+    float * LXRESTRICT r = c->r;
+    float * LXRESTRICT g = c->g;
+    float * LXRESTRICT b = c->b;
+    LXInteger i;
+
+    if (imp->matrixIsIdentity) return;
+
+    for (i = 0; i < n; i++) {
+        const float lr = r[i], lg = g[i], lb = b[i];
+        r[i] = m0*lr + m1*lg + m2*lb;
+        g[i] = m3*lr + m4*lg + m5*lb;
+        b[i] = m6*lr + m7*lg + m8*lb;
+    }
+}
+
+// computes indexes into the 8-bit encode table (the nearest entry is close enough for 8-bit output)
+static void encodeIndexes(const float * LXRESTRICT v, int32_t * LXRESTRICT outIdx, LXInteger n)
+{
+    LXInteger i = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(ENCODE_LUTSIZE);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(v + i), zero), one);  // NaN becomes 0
+        _mm_storeu_si128((__m128i *)(outIdx + i), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(x), scale), half)));
+    }
+#endif
+    for (; i < n; i++) {
+        const float x = (v[i] > 0.0f) ? MIN(v[i], 1.0f) : 0.0f;
+        outIdx[i] = (int32_t)(sqrtf(x) * ENCODE_LUTSIZE + 0.5f);
+    }
+}
+
+// "offs" are the byte offsets of R, G and B within a pixel; alpha is left untouched
+static void convertRow_int8(const LXColorTransformImpl *imp, const uint8_t *src, uint8_t *dst, LXInteger w, const int *offs)
+{
+    const float *dec = imp->decode8;
+    const uint8_t *enc = imp->encode8;
+    const int ro = offs[0], go = offs[1], bo = offs[2], ao = offs[3];
+    ColorChunk c;
+    int32_t ir[CT_CHUNK], ig[CT_CHUNK], ib[CT_CHUNK];
+    uint8_t a[CT_CHUNK];
+    LXInteger x0, i;
+
+    for (x0 = 0; x0 < w; x0 += CT_CHUNK) {
+        const LXInteger n = MIN(CT_CHUNK, w - x0);
+        const uint8_t *s = src + 4*x0;
+        uint8_t *d = dst + 4*x0;
+
+        for (i = 0; i < n; i++) {
+            c.r[i] = dec[s[ro]];
+            c.g[i] = dec[s[go]];
+            c.b[i] = dec[s[bo]];
+            a[i] = s[ao];
+            s += 4;
+        }
+
+        applyMatrix(imp, &c, n);
+
+        encodeIndexes(c.r, ir, n);
+        encodeIndexes(c.g, ig, n);
+        encodeIndexes(c.b, ib, n);
+
+        for (i = 0; i < n; i++) {
+            d[ro] = enc[ir[i]];
+            d[go] = enc[ig[i]];
+            d[bo] = enc[ib[i]];
+            d[ao] = a[i];
+            d += 4;
+        }
+    }
+}
+
+static void convertRow_float32(const LXColorTransformImpl *imp, const float *src, float *dst, LXInteger w)
+{
+    ColorChunk c;
+    LXInteger x0, i;
+
+    for (x0 = 0; x0 < w; x0 += CT_CHUNK) {
+        const LXInteger n = MIN(CT_CHUNK, w - x0);
+        const float *s = src + 4*x0;
+        float *d = dst + 4*x0;
+
+        i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= n; i += 4) {
+            __m128 p0 = _mm_loadu_ps(s), p1 = _mm_loadu_ps(s + 4), p2 = _mm_loadu_ps(s + 8), p3 = _mm_loadu_ps(s + 12);
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            _mm_storeu_ps(c.r + i, p0);
+            _mm_storeu_ps(c.g + i, p1);
+            _mm_storeu_ps(c.b + i, p2);
+            _mm_storeu_ps(c.a + i, p3);
+            s += 16;
+        }
+#endif
+        for (; i < n; i++) {
+            c.r[i] = s[0];
+            c.g[i] = s[1];
+            c.b[i] = s[2];
+            c.a[i] = s[3];
+            s += 4;
+        }
+
+        if (imp->src->curve != kCurveLinear) {
+            decodeChannel(imp, c.r, n);
+            decodeChannel(imp, c.g, n);
+            decodeChannel(imp, c.b, n);
+        }
+        applyMatrix(imp, &c, n);
+        if (imp->dst->curve != kCurveLinear) {
+            encodeChannel(imp, c.r, n);
+            encodeChannel(imp, c.g, n);
+            encodeChannel(imp, c.b, n);
+        }
+
+        i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= n; i += 4) {
+            __m128 p0 = _mm_loadu_ps(c.r + i), p1 = _mm_loadu_ps(c.g + i), p2 = _mm_loadu_ps(c.b + i), p3 = _mm_loadu_ps(c.a + i);
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            _mm_storeu_ps(d, p0);
+            _mm_storeu_ps(d + 4, p1);
+            _mm_storeu_ps(d + 8, p2);
+            _mm_storeu_ps(d + 12, p3);
+            d += 16;
+        }
+#endif
+        for (; i < n; i++) {
+            d[0] = c.r[i];
+            d[1] = c.g[i];
+            d[2] = c.b[i];
+            d[3] = c.a[i];
+            d += 4;
+        }
+    }
+}
+
+static void convertRow_float16(const LXColorTransformImpl *imp, const LXHalf *src, LXHalf *dst, LXInteger w)
+{
+    float tmp[CT_CHUNK * 4];
+    LXInteger x0;
+
+    for (x0 = 0; x0 < w; x0 += CT_CHUNK) {
+        const LXInteger n = MIN(CT_CHUNK, w - x0);
+
+        LXConvertHalfToFloatArray(src + 4*x0, tmp, n * 4);
+        convertRow_float32(imp, tmp, tmp, n);
+        LXConvertFloatToHalfArray(tmp, dst + 4*x0, n * 4);
+    }
+}
+
+
+#pragma mark --- applying to images ---
+
+typedef struct {
+    const LXColorTransformImpl *imp;
+    const uint8_t *src;
+    size_t srcRowBytes;
+    uint8_t *dst;
+    size_t dstRowBytes;
+    LXInteger w;
+    LXPixelFormat pxFormat;
+    int offs[4];
+} LXColorTransformJob;
+
+static void convertBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    const LXColorTransformJob *job = (const LXColorTransformJob *)userData;
+    LXInteger y;
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *s = job->src + job->srcRowBytes * y;
+        uint8_t *d = job->dst + job->dstRowBytes * y;
+
+        switch (job->pxFormat) {
+            case kLX_RGBA_FLOAT32:
+                convertRow_float32(job->imp, (const float *)s, (float *)d, job->w);
+                break;
+            case kLX_RGBA_FLOAT16:
+                convertRow_float16(job->imp, (const LXHalf *)s, (LXHalf *)d, job->w);
+                break;
+            default:
+                convertRow_int8(job->imp, s, d, job->w, job->offs);
+                break;
+        }
+    }
+}
+
+static LXBool getChannelOffsets(LXPixelFormat pxFormat, int *offs)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+            offs[0] = 0;  offs[1] = 1;  offs[2] = 2;  offs[3] = 3;
+            return YES;
+        case kLX_ARGB_INT8:
+            offs[0] = 1;  offs[1] = 2;  offs[2] = 3;  offs[3] = 0;
+            return YES;
+        case kLX_BGRA_INT8:
+            offs[0] = 2;  offs[1] = 1;  offs[2] = 0;  offs[3] = 3;
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+LXSuccess LXColorTransformApplyToData(LXColorTransformRef r,
+                                      const uint8_t *srcBuf, size_t srcRowBytes,
+                                      uint8_t *dstBuf, size_t dstRowBytes,
+                                      uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                      LXError *outError)
+{
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+    LXColorTransformJob job;
+    LXInteger y;
+
+    if ( !imp || !srcBuf || !dstBuf) {
+        LXErrorSet(outError, kLXErrorID_ColorTransform_EmptyArg, "empty argument");
+        return NO;
+    }
+    memset(&job, 0, sizeof(job));
+
+    if ( !getChannelOffsets(pxFormat, job.offs)) {
+        char msg[256];
+        sprintf(msg, "unsupported pixel format for color transform (%lu)", (unsigned long)pxFormat);
+        LXErrorSet(outError, kLXErrorID_ColorTransform_UnsupportedPixelFormat, msg);
+        return NO;
+    }
+    if (w < 1 || h < 1) return YES;
+
+    if (imp->isIdentity) {
+        if (srcBuf != dstBuf) {
+            const size_t rowLen = (size_t)w * LXBytesPerPixelForPixelFormat(pxFormat);
+            for (y = 0; y < h; y++) {
+                memmove(dstBuf + dstRowBytes * y, srcBuf + srcRowBytes * y, rowLen);
+            }
+        }
+        return YES;
+    }
+
+    job.imp = imp;
+    job.src = srcBuf;
+    job.srcRowBytes = srcRowBytes;
+    job.dst = dstBuf;
+    job.dstRowBytes = dstRowBytes;
+    job.w = w;
+    job.pxFormat = pxFormat;
+
+    LXParallelApplyToRowBands(w, h, 0, 0, convertBand, &job);
+    return YES;
+}
+
+LXSuccess LXColorTransformApplyToPixelBuffer(LXColorTransformRef r,
+                                             LXPixelBufferRef srcPixbuf,
+                                             LXPixelBufferRef dstPixbuf,
+                                             LXError *outError)
+{
+    LXColorTransformImpl *imp = (LXColorTransformImpl *)r;
+
+    if ( !imp || !srcPixbuf || !dstPixbuf) {
+        LXErrorSet(outError, kLXErrorID_ColorTransform_EmptyArg, "empty argument");
+        return NO;
+    }
+
+    const uint32_t w = LXPixelBufferGetWidth(srcPixbuf);
+    const uint32_t h = LXPixelBufferGetHeight(srcPixbuf);
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(srcPixbuf);
+
+    if (w != LXPixelBufferGetWidth(dstPixbuf) || h != LXPixelBufferGetHeight(dstPixbuf)
+                || pxFormat != LXPixelBufferGetPixelFormat(dstPixbuf)) {
+        LXErrorSet(outError, kLXErrorID_ColorTransform_SizeMismatch, "pixel buffers don't have the same size and pixel format");
+        return NO;
+    }
+
+    size_t srcRowBytes = 0;
+    size_t dstRowBytes = 0;
+    uint8_t *srcBuf = LXPixelBufferLockPixels(srcPixbuf, &srcRowBytes, NULL, outError);
+    if ( !srcBuf) return NO;
+
+    uint8_t *dstBuf = (dstPixbuf == srcPixbuf) ? srcBuf : LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, NULL, outError);
+    if ( !dstBuf) {
+        LXPixelBufferUnlockPixels(srcPixbuf);
+        return NO;
+    }
+    if (dstPixbuf == srcPixbuf) dstRowBytes = srcRowBytes;
+
+    LXSuccess success = LXColorTransformApplyToData(r, srcBuf, srcRowBytes, dstBuf, dstRowBytes, w, h, pxFormat, outError);
+
+    if (dstPixbuf != srcPixbuf) LXPixelBufferUnlockPixels(dstPixbuf);
+    LXPixelBufferUnlockPixels(srcPixbuf);
+
+    if (success) {
+        LXPixelBufferSetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, imp->dst->colorSpace);
+    }
+    return success;
+}
@@ -0,0 +1,91 @@
+/*
+ *  LXColorTransform.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXCOLORTRANSFORM_H_
+#define _LXCOLORTRANSFORM_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+#include "LXTransform3D.h"  // for LX4x4Matrix
+
+
+enum {
+    kLXErrorID_ColorTransform_EmptyArg = 6701,
+    kLXErrorID_ColorTransform_UnsupportedColorSpace,
+    kLXErrorID_ColorTransform_UnsupportedPixelFormat,
+    kLXErrorID_ColorTransform_SizeMismatch
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma mark --- LXColorTransform public API methods ---
+
+/*
+  A color transform converts RGB data between two of the standard RGB color spaces:
+  kLX_CanonicalLinearRGB (sRGB primaries without a transfer curve), kLX_sRGB, kLX_AdobeRGB_1998 and kLX_ProPhotoRGB.
+
+  The conversion is baked on creation into lookup tables for the source's decode curve and the destination's encode curve,
+  and a 3x3 matrix from the source's linear RGB to the destination's (including chromatic adaptation between white points).
+  Alpha is not modified. Float data outside the 0-1 range is converted with the curves extended as odd functions.
+*/
+
+LXEXPORT const char *LXColorTransformTypeID();
+
+// returns YES if "colorSpace" is one of the RGB color spaces listed above
+LXEXPORT LXBool LXColorTransformSupportsColorSpace(LXColorSpaceEncoding colorSpace);
+
+// the returned object is retained
+LXEXPORT LXColorTransformRef LXColorTransformCreate(LXColorSpaceEncoding srcColorSpace, LXColorSpaceEncoding dstColorSpace, LXError *outError);
+
+// returns a transform shared by the whole library (e.g. for the conversions in LXPixelBuffer).
+// the returned object is not retained by the caller; NULL is returned for unsupported color spaces
+LXEXPORT LXColorTransformRef LXColorTransformGetShared(LXColorSpaceEncoding srcColorSpace, LXColorSpaceEncoding dstColorSpace);
+
+LXEXPORT LXColorTransformRef LXColorTransformRetain(LXColorTransformRef t);
+LXEXPORT void LXColorTransformRelease(LXColorTransformRef t);
+
+LXEXPORT LXColorSpaceEncoding LXColorTransformGetSourceColorSpace(LXColorTransformRef t);
+LXEXPORT LXColorSpaceEncoding LXColorTransformGetDestinationColorSpace(LXColorTransformRef t);
+
+// YES if the transform doesn't change pixel values (e.g. the color spaces are the same)
+LXEXPORT LXBool LXColorTransformIsIdentity(LXColorTransformRef t);
+
+// the matrix from source linear RGB to destination linear RGB, in LXTransform3D layout
+LXEXPORT void LXColorTransformGetMatrix(LXColorTransformRef t, LX4x4Matrix *outMatrix);
+
+// converts a single color exactly (without the lookup tables)
+LXEXPORT void LXColorTransformConvertRGB(LXColorTransformRef t, const float *inRGB, float *outRGB);
+
+// converts a w*h image of RGBA int8/float16/float32, ARGB int8 or BGRA int8 pixels.
+// "srcBuf" and "dstBuf" have the same pixel format; they can be the same buffer. large images are processed on multiple threads.
+LXEXPORT LXSuccess LXColorTransformApplyToData(LXColorTransformRef t,
+                                               const uint8_t *srcBuf, size_t srcRowBytes,
+                                               uint8_t *dstBuf, size_t dstRowBytes,
+                                               uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                               LXError *outError);
+
+// the pixel buffers must have the same size and pixel format, but they can be the same buffer.
+// the destination's color space attachment is set to the transform's destination color space.
+LXEXPORT LXSuccess LXColorTransformApplyToPixelBuffer(LXColorTransformRef t,
+                                                      LXPixelBufferRef srcPixbuf,
+                                                      LXPixelBufferRef dstPixbuf,
+                                                      LXError *outError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
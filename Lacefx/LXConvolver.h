@@ -20,6 +20,13 @@
 #include "LXPool.h"
 
 
+enum {
+    kLXErrorID_Convolver_EmptyArg = 6601,
+    kLXErrorID_Convolver_SizeMismatch,
+    kLXErrorID_Convolver_UnsupportedCombiner
+};
+
+
 #pragma pack (push, 4)
 
 typedef struct {
@@ -72,4 +79,23 @@ LXEXPORT LXSurfaceRef LXConvolverRender1DWithWidthUsingSurfaces(LXConvolverRef c
                                                                 LXError *outError);
 
 
+// -- convolution of pixel buffers on the CPU --
+//
+// the kernel is built with the same callbacks and settings as above; pixels beyond the image edge are clamped.
+// the custom combiner can be one of ADD, MUL, MIN or MAX; the custom finisher is run with LXShaderEvaluateIntoPixelBuffer.
+// "dstPixbuf" must be the same size as "srcPixbuf", but it can be the same buffer.
+LXEXPORT LXSuccess LXConvolverRender1DIntoPixelBuffer(LXConvolverRef conv,
+                                                      LXInteger width,
+                                                      LXPixelBufferRef srcPixbuf,
+                                                      LXPixelBufferRef dstPixbuf,
+                                                      LXError *outError);
+
+// applies the kernel along the sample rotation and then perpendicular to it (e.g. a Gaussian blur)
+LXEXPORT LXSuccess LXConvolverRenderSeparableIntoPixelBuffer(LXConvolverRef conv,
+                                                             LXInteger width,
+                                                             LXPixelBufferRef srcPixbuf,
+                                                             LXPixelBufferRef dstPixbuf,
+                                                             LXError *outError);
+
+
 #endif // _LXCONVOLVER_H_
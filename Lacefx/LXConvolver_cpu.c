@@ -0,0 +1,854 @@
+/*
+ *  LXConvolver_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXConvolver.h"
+#include "LXConvolver_priv.h"
+#include "LXRef_Impl.h"
+#include "LXPixelBuffer.h"
+#include "LXShader.h"
+#include "LXTexture.h"
+#include "LXTextureArray.h"
+#include "LXSurface.h"
+#include "LXPlatform.h"
+#include "LXParallel.h"
+#include "LXStringUtils.h"
+#include <math.h>
+#include <ctype.h>
+
+#if defined(__SSE2__)
+ #include <emmintrin.h>
+#endif
+
+
+/*
+  CPU convolution engine.
+
+  The kernel is built the same way as in the GPU path (LQLXConvolver): "width" is rounded up to an odd tap count,
+  the weights come from the generateWeights callback (a box by default), and the taps are spaced by the sample distance
+  along the sample rotation. Images are processed as float32 RGBA; pixels beyond the edges are clamped.
+
+  A pass along the x or y axis runs as one of:
+    - a sliding window sum, if all weights are equal (box blur); its cost doesn't depend on the width;
+    - a recursive filter (Young & van Vliet), if the kernel is wide and its weights fit a Gaussian;
+    - a direct weighted sum.
+  These work on lines of samples where each sample is a vector of floats: a pixel for row passes,
+  or a row segment of a strip of columns for column passes. Bands of rows or strips of columns are run in parallel.
+
+  Kernels at other angles, or with fractional sample distances, are sampled bilinearly (or nearest, if so configured).
+*/
+
+
+enum {
+    kConvOp_MAD = 0,
+    kConvOp_ADD,
+    kConvOp_MUL,
+    kConvOp_MIN,
+    kConvOp_MAX
+};
+
+enum {
+    kConvMethod_Direct = 0,
+    kConvMethod_Box,
+    kConvMethod_IIR,
+    kConvMethod_Sampled
+};
+
+enum {
+    kConvAxis_None = 0,
+    kConvAxis_X,
+    kConvAxis_Y
+};
+
+#define CONV_BAND_ROWS          16
+#define CONV_STRIP_W            64      // column passes run down strips of this many pixels
+
+#define CONV_IIR_MIN_RADIUS     24      // narrower Gaussians are cheap enough to convolve directly
+
+
+typedef struct {
+    int32_t ix, iy;
+    float fx, fy;
+} LXConvolverTap;
+
+typedef struct {
+    LXInteger op;
+    LXInteger radius;           // taps on each side of the center
+    float *weights;             // 2*radius+1 weights for the offsets -radius .. radius
+    double weightSum;
+    LXBool isUniform;
+    double gaussSigma;          // in taps; zero if the weights are not Gaussian
+
+    // set per pass by setKernelDirection()
+    LXInteger method;
+    LXInteger axis;
+    LXInteger step;             // whole pixels between taps (Direct, Box)
+    float iirB, iirK1, iirK2, iirK3;
+    float iirM[9];              // end condition of the anti-causal pass
+    LXConvolverTap *taps;       // sample offsets for taps (Sampled)
+    LXBool nearest;
+} LXConvolverKernel;
+
+
+#pragma mark --- vector ops ---
+
+#if defined(__SSE2__)
+
+typedef __m128 ConvVec;
+
+LXINLINE ConvVec cvLoad(const float *p)             { return _mm_loadu_ps(p); }
+LXINLINE void cvStore(float *p, ConvVec v)          { _mm_storeu_ps(p, v); }
+LXINLINE ConvVec cvSplat(float f)                   { return _mm_set1_ps(f); }
+LXINLINE ConvVec cvAdd(ConvVec a, ConvVec b)        { return _mm_add_ps(a, b); }
+LXINLINE ConvVec cvSub(ConvVec a, ConvVec b)        { return _mm_sub_ps(a, b); }
+LXINLINE ConvVec cvMul(ConvVec a, ConvVec b)        { return _mm_mul_ps(a, b); }
+LXINLINE ConvVec cvMin(ConvVec a, ConvVec b)        { return _mm_min_ps(a, b); }
+LXINLINE ConvVec cvMax(ConvVec a, ConvVec b)        { return _mm_max_ps(a, b); }
+
+#else
+
+typedef struct { float e[4]; } ConvVec;
+
+#define CONV_VECOP(name_, expr_) \
+    LXINLINE ConvVec name_(ConvVec a, ConvVec b) { ConvVec r;  int i;  for (i = 0; i < 4; i++) { float x = a.e[i], y = b.e[i];  r.e[i] = (expr_); }  return r; }
+
+LXINLINE ConvVec cvLoad(const float *p)             { ConvVec r;  memcpy(r.e, p, 4*sizeof(float));  return r; }
+LXINLINE void cvStore(float *p, ConvVec v)          { memcpy(p, v.e, 4*sizeof(float)); }
+LXINLINE ConvVec cvSplat(float f)                   { ConvVec r = {{ f, f, f, f }};  return r; }
+CONV_VECOP(cvAdd, x + y)
+CONV_VECOP(cvSub, x - y)
+CONV_VECOP(cvMul, x * y)
+CONV_VECOP(cvMin, (x < y) ? x : y)
+CONV_VECOP(cvMax, (x > y) ? x : y)
+
+#endif
+
+LXINLINE ConvVec cvCombine(LXInteger op, ConvVec acc, ConvVec v)
+{
+    switch (op) {
+        default:
+        case kConvOp_ADD:  return cvAdd(acc, v);
+        case kConvOp_MUL:  return cvMul(acc, v);
+        case kConvOp_MIN:  return cvMin(acc, v);
+        case kConvOp_MAX:  return cvMax(acc, v);
+    }
+}
+
+
+
+#pragma mark --- kernel ---
+
+// same as convolutionWidthForAmount() in LQLXConvolver
+static LXInteger tapCountForWidth(LXInteger width)
+{
+    LXInteger n = width;
+    while (n % 2 != 1 || n == 0)
+        n++;
+    return n;
+}
+
+static LXSuccess getCombinerOp(const LXConvolverSettings *settings, LXInteger *outOp, LXError *outError)
+{
+    static const struct { const char *name;  LXInteger op; } s_ops[] = {
+        { "ADD", kConvOp_ADD },  { "MUL", kConvOp_MUL },  { "MIN", kConvOp_MIN },  { "MAX", kConvOp_MAX }
+    };
+    char str[32];
+    const char *s = str;
+    LXInteger i;
+
+    *outOp = kConvOp_MAD;
+    if ( !settings->callbacks.getCustomCombinerInstruction)
+        return YES;
+
+    memset(str, 0, 32);
+    settings->callbacks.getCustomCombinerInstruction(settings->owner, str, 31, settings->callbackUserData);
+
+    while (*s && isspace(*s)) s++;
+    if ( !*s)
+        return YES;
+
+    for (i = 0; i < 4; i++) {
+        if (0 == strncmp(s, s_ops[i].name, 3) && (s[3] == 0 || isspace(s[3]) || s[3] == ';')) {
+            *outOp = s_ops[i].op;
+            return YES;
+        }
+    }
+    LXErrorSet(outError, kLXErrorID_Convolver_UnsupportedCombiner, "unsupported combiner instruction");
+    return NO;
+}
+
+// returns the standard deviation (in taps) of a Gaussian that matches the weights, or zero if there isn't one
+static double gaussianSigmaForWeights(const float *weights, LXInteger radius, double weightSum)
+{
+    double m2 = 0.0, sigma, gsum = 0.0, maxErr = 0.0;
+    LXInteger j;
+
+    if (weightSum <= 0.0) return 0.0;
+
+    for (j = -radius; j <= radius; j++) {
+        if (weights[j + radius] < 0.0f) return 0.0;
+        m2 += weights[j + radius] * (double)(j*j);
+    }
+    sigma = sqrt(m2 / weightSum);
+    if (sigma < 1.0) return 0.0;
+
+    for (j = -radius; j <= radius; j++)
+        gsum += exp(-(double)(j*j) / (2.0*sigma*sigma));
+
+    for (j = -radius; j <= radius; j++) {
+        double g = exp(-(double)(j*j) / (2.0*sigma*sigma)) / gsum;
+        maxErr = MAX(maxErr, fabs(weights[j + radius] / weightSum - g));
+    }
+
+    // the error is compared to the height of the peak
+    return (maxErr < 0.02 * (1.0 / gsum)) ? sigma : 0.0;
+}
+
+static LXSuccess initKernel(LXConvolverKernel *kernel, const LXConvolverSettings *settings, LXInteger width, LXError *outError)
+{
+    memset(kernel, 0, sizeof(LXConvolverKernel));
+
+    if ( !getCombinerOp(settings, &kernel->op, outError))
+        return NO;
+
+    const LXInteger tapCount = tapCountForWidth(width);
+    const LXInteger r = tapCount / 2;
+    double *w = _lx_calloc(tapCount, sizeof(double));
+    double sum = 0.0;
+    LXInteger j;
+
+    if (settings->callbacks.generateWeights) {
+        settings->callbacks.generateWeights(settings->owner, w, tapCount, settings->callbackUserData);
+    } else {
+        for (j = 0; j < tapCount; j++)
+            w[j] = 1.0;
+    }
+
+    for (j = 0; j < tapCount; j++)
+        sum += w[j];
+
+    double m = (settings->doNormalize && sum > 0.0) ? (1.0 / sum) : 1.0;
+
+    // the GPU path samples the offset +k with weight w[center - k]
+    kernel->radius = r;
+    kernel->weights = _lx_malloc(tapCount * sizeof(float));
+    for (j = 0; j < tapCount; j++)
+        kernel->weights[j] = w[tapCount - 1 - j] * m;
+
+    kernel->weightSum = sum * m;
+
+    kernel->isUniform = (r > 0);
+    for (j = 1; j < tapCount; j++) {
+        if (fabs(w[j] - w[0]) > 1.0e-6 * fabs(w[0]))
+            kernel->isUniform = NO;
+    }
+
+    if (r >= CONV_IIR_MIN_RADIUS && kernel->op == kConvOp_MAD && !kernel->isUniform)
+        kernel->gaussSigma = gaussianSigmaForWeights(kernel->weights, r, kernel->weightSum);
+
+    kernel->nearest = (settings->samplingType == kLXNearestSampling) ? YES : NO;
+
+    _lx_free(w);
+    return YES;
+}
+
+static void destroyKernel(LXConvolverKernel *kernel)
+{
+    _lx_free(kernel->weights);
+    _lx_free(kernel->taps);
+    memset(kernel, 0, sizeof(LXConvolverKernel));
+}
+
+static void setIIRCoefficients(LXConvolverKernel *kernel, double sigma)
+{
+    double q = (sigma >= 2.5) ? (0.98711*sigma - 0.96330) : (3.97156 - 4.14554*sqrt(1.0 - 0.26891*sigma));
+    double q2 = q*q, q3 = q2*q;
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    double b1 = 2.44413*q + 2.85619*q2 + 1.26661*q3;
+    double b2 = -(1.4281*q2 + 1.26661*q3);
+    double b3 = 0.422205*q3;
+
+    kernel->iirK1 = b1 / b0;
+    kernel->iirK2 = b2 / b0;
+    kernel->iirK3 = b3 / b0;
+    kernel->iirB = 1.0 - (b1 + b2 + b3) / b0;
+
+    // Triggs & Sdika: the anti-causal filter's state at the end of a line that continues with a constant value
+    const double a1 = kernel->iirK1, a2 = kernel->iirK2, a3 = kernel->iirK3;
+    const double m = 1.0 / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+    float *M = kernel->iirM;
+
+    M[0] = m * (-a3*a1 + 1.0 - a3*a3 - a2);
+    M[1] = m * (a3 + a1) * (a2 + a3*a1);
+    M[2] = m * a3 * (a1 + a3*a2);
+    M[3] = m * (a1 + a3*a2);
+    M[4] = -m * (a2 - 1.0) * (a2 + a3*a1);
+    M[5] = -m * a3 * (a3*a1 + a3*a3 + a2 - 1.0);
+    M[6] = m * (a3*a1 + a2 + a1*a1 - a2*a2);
+    M[7] = m * (a1*a2 + a3*a2*a2 - a1*a3*a3 - a3*a3*a3 - a3*a2 + a3);
+    M[8] = m * a3 * (a1 + a3*a2);
+}
+
+static void setKernelDirection(LXConvolverKernel *kernel, const LXConvolverSettings *settings, double rotation)
+{
+    const double dist = (fabs(settings->sampleDistance) > 0.0) ? settings->sampleDistance : 1.0;
+    const double drad = rotation * (M_PI / 180.0);
+    double dx = sin(M_PI * 0.5 - drad) * dist;
+    double dy = sin(drad) * dist;
+    LXInteger j;
+
+    if (fabs(dx - round(dx)) < 1.0e-4)  dx = round(dx);
+    if (fabs(dy - round(dy)) < 1.0e-4)  dy = round(dy);
+
+    kernel->axis = (dy == 0.0) ? kConvAxis_X : ((dx == 0.0) ? kConvAxis_Y : kConvAxis_None);
+
+    _lx_free(kernel->taps);
+    kernel->taps = NULL;
+
+    const double axisStep = (kernel->axis == kConvAxis_X) ? dx : dy;
+
+    if (kernel->axis != kConvAxis_None && kernel->gaussSigma * fabs(axisStep) >= 2.0) {
+        kernel->method = kConvMethod_IIR;
+        setIIRCoefficients(kernel, kernel->gaussSigma * fabs(axisStep));
+    }
+    else if (kernel->axis != kConvAxis_None && axisStep == round(axisStep)) {
+        kernel->step = (LXInteger)axisStep;
+        kernel->method = (kernel->isUniform && kernel->op == kConvOp_MAD && kernel->step != 0) ? kConvMethod_Box : kConvMethod_Direct;
+    }
+    else {
+        kernel->method = kConvMethod_Sampled;
+        kernel->taps = _lx_malloc((2*kernel->radius + 1) * sizeof(LXConvolverTap));
+
+        for (j = -kernel->radius; j <= kernel->radius; j++) {
+            LXConvolverTap *tap = kernel->taps + (j + kernel->radius);
+            double ox = j * dx;
+            double oy = j * dy;
+            if (kernel->nearest) {
+                // the sample point is the pixel center plus the offset
+                tap->ix = floor(ox + 0.5);
+                tap->iy = floor(oy + 0.5);
+                tap->fx = tap->fy = 0.0f;
+            } else {
+                tap->ix = floor(ox);
+                tap->iy = floor(oy);
+                tap->fx = ox - tap->ix;
+                tap->fy = oy - tap->iy;
+            }
+        }
+    }
+}
+
+
+
+#pragma mark --- line filters ---
+
+// a line is "n" samples spaced by "stride" floats; each sample is "lanes" floats (a multiple of 4, at most CONV_STRIP_W*4)
+
+LXINLINE const float *lineSampleAt(const float *line, LXInteger i, LXInteger n, size_t stride)
+{
+    i = (i < 0) ? 0 : ((i >= n) ? n - 1 : i);
+    return line + i * stride;
+}
+
+static void convolveLineDirect(const LXConvolverKernel *kernel, const float * LXRESTRICT src, float * LXRESTRICT dst,
+                               LXInteger n, size_t stride, LXInteger lanes)
+{
+    const LXInteger r = kernel->radius;
+    const LXInteger step = kernel->step;
+    const float *weights = kernel->weights;
+    LXInteger i, j, l;
+
+    for (i = 0; i < n; i++) {
+        const LXBool isInterior = (i - r*labs(step) >= 0 && i + r*labs(step) < n);
+        const float *first = (isInterior) ? src + (i - r*step) * stride : NULL;
+
+        for (l = 0; l < lanes; l += 4) {
+            ConvVec acc;
+
+            if (kernel->op == kConvOp_MAD) {
+                acc = cvSplat(0.0f);
+                if (isInterior) {
+                    const float *s = first + l;
+                    for (j = 0; j <= 2*r; j++, s += step*stride)
+                        acc = cvAdd(acc, cvMul(cvLoad(s), cvSplat(weights[j])));
+                } else {
+                    for (j = 0; j <= 2*r; j++)
+                        acc = cvAdd(acc, cvMul(cvLoad(lineSampleAt(src, i + (j - r)*step, n, stride) + l), cvSplat(weights[j])));
+                }
+            } else {
+                // the custom combiner ignores weights, as on the GPU
+                acc = cvLoad(src + i*stride + l);
+                for (j = 0; j <= 2*r; j++) {
+                    if (j != r)
+                        acc = cvCombine(kernel->op, acc, cvLoad(lineSampleAt(src, i + (j - r)*step, n, stride) + l));
+                }
+            }
+            cvStore(dst + i*stride + l, acc);
+        }
+    }
+}
+
+static void convolveLineBox(const LXConvolverKernel *kernel, const float * LXRESTRICT src, float * LXRESTRICT dst,
+                            LXInteger n, size_t stride, LXInteger lanes)
+{
+    const LXInteger r = kernel->radius;
+    const LXInteger step = labs(kernel->step);
+    const ConvVec w = cvSplat(kernel->weights[0]);
+    float sum[CONV_STRIP_W * 4];
+    LXInteger phase, i, k, l;
+
+    // samples i, i+step, i+2*step... share their windows
+    for (phase = 0; phase < step && phase < n; phase++) {
+        for (l = 0; l < lanes; l++)
+            sum[l] = 0.0f;
+
+        for (k = -r; k <= r; k++) {
+            const float *s = lineSampleAt(src, phase + k*step, n, stride);
+            for (l = 0; l < lanes; l += 4)
+                cvStore(sum + l, cvAdd(cvLoad(sum + l), cvLoad(s + l)));
+        }
+
+        for (i = phase; i < n; i += step) {
+            const float *add = lineSampleAt(src, i + (r + 1)*step, n, stride);
+            const float *sub = lineSampleAt(src, i - r*step, n, stride);
+            float *d = dst + i*stride;
+
+            for (l = 0; l < lanes; l += 4) {
+                ConvVec v = cvLoad(sum + l);
+                cvStore(d + l, cvMul(v, w));
+                cvStore(sum + l, cvSub(cvAdd(v, cvLoad(add + l)), cvLoad(sub + l)));
+            }
+        }
+    }
+}
+
+// in place; the line is assumed to continue with its edge values on both sides
+static void convolveLineIIR(const LXConvolverKernel *kernel, float *buf, LXInteger n, size_t stride, LXInteger lanes)
+{
+    const float gain = kernel->weightSum;
+    const float *M = kernel->iirM;
+    const ConvVec k1 = cvSplat(kernel->iirK1);
+    const ConvVec k2 = cvSplat(kernel->iirK2);
+    const ConvVec k3 = cvSplat(kernel->iirK3);
+    ConvVec b = cvSplat(kernel->iirB * gain);
+    float edge[CONV_STRIP_W * 4];
+    float tail[3][CONV_STRIP_W * 4];
+    LXInteger i, l;
+
+    // causal pass; before the line, the filter has settled on the first value
+    for (l = 0; l < lanes; l++) {
+        edge[l] = buf[l] * gain;
+        tail[0][l] = buf[(n - 1)*stride + l] * gain;
+    }
+
+    for (i = 0; i < n; i++) {
+        float *p = buf + i*stride;
+        const float *p1 = (i >= 1) ? p - stride : edge;
+        const float *p2 = (i >= 2) ? p - 2*stride : edge;
+        const float *p3 = (i >= 3) ? p - 3*stride : edge;
+
+        for (l = 0; l < lanes; l += 4) {
+            ConvVec v = cvMul(cvLoad(p + l), b);
+            v = cvAdd(v, cvMul(cvLoad(p1 + l), k1));
+            v = cvAdd(v, cvMul(cvLoad(p2 + l), k2));
+            v = cvAdd(v, cvMul(cvLoad(p3 + l), k3));
+            cvStore(p + l, v);
+        }
+    }
+
+    // anti-causal pass; its outputs at the last sample and the two beyond it are solved from the causal pass's last outputs
+    const float *c0 = buf + (n - 1)*stride;
+    const float *c1 = buf + MAX(n - 2, 0)*stride;
+    const float *c2 = buf + MAX(n - 3, 0)*stride;
+    float *last = buf + (n - 1)*stride;
+
+    for (l = 0; l < lanes; l++) {
+        const float xe = tail[0][l];
+        const float d0 = c0[l] - xe, d1 = c1[l] - xe, d2 = c2[l] - xe;
+        const float y0 = xe + kernel->iirB * (M[0]*d0 + M[1]*d1 + M[2]*d2);
+        tail[1][l] = xe + kernel->iirB * (M[3]*d0 + M[4]*d1 + M[5]*d2);
+        tail[2][l] = xe + kernel->iirB * (M[6]*d0 + M[7]*d1 + M[8]*d2);
+        last[l] = y0;
+    }
+
+    b = cvSplat(kernel->iirB);
+
+    for (i = n - 2; i >= 0; i--) {
+        float *p = buf + i*stride;
+        const float *p1 = p + stride;
+        const float *p2 = (i + 2 < n) ? p + 2*stride : tail[i + 2 - n + 1];
+        const float *p3 = (i + 3 < n) ? p + 3*stride : tail[i + 3 - n + 1];
+
+        for (l = 0; l < lanes; l += 4) {
+            ConvVec v = cvMul(cvLoad(p + l), b);
+            v = cvAdd(v, cvMul(cvLoad(p1 + l), k1));
+            v = cvAdd(v, cvMul(cvLoad(p2 + l), k2));
+            v = cvAdd(v, cvMul(cvLoad(p3 + l), k3));
+            cvStore(p + l, v);
+        }
+    }
+}
+
+static void convolveLine(const LXConvolverKernel *kernel, const float *src, float *dst, LXInteger n, size_t stride, LXInteger lanes)
+{
+    LXInteger i;
+
+    switch (kernel->method) {
+        case kConvMethod_Direct:  convolveLineDirect(kernel, src, dst, n, stride, lanes);  break;
+        case kConvMethod_Box:     convolveLineBox(kernel, src, dst, n, stride, lanes);  break;
+        case kConvMethod_IIR:
+            for (i = 0; i < n; i++)
+                memcpy(dst + i*stride, src + i*stride, lanes * sizeof(float));
+            convolveLineIIR(kernel, dst, n, stride, lanes);
+            break;
+    }
+}
+
+
+
+#pragma mark --- sampled kernels ---
+
+LXINLINE ConvVec samplePixel(const float *src, LXInteger x, LXInteger y, LXInteger w, LXInteger h, size_t rowFloats)
+{
+    x = (x < 0) ? 0 : ((x >= w) ? w - 1 : x);
+    y = (y < 0) ? 0 : ((y >= h) ? h - 1 : y);
+    return cvLoad(src + y*rowFloats + x*4);
+}
+
+static void convolveRowSampled(const LXConvolverKernel *kernel, const float * LXRESTRICT src, float * LXRESTRICT dst,
+                               LXInteger y, LXInteger w, LXInteger h, size_t rowFloats)
+{
+    const LXInteger tapCount = 2*kernel->radius + 1;
+    LXInteger x, j;
+
+    for (x = 0; x < w; x++) {
+        ConvVec acc = cvSplat(0.0f);
+
+        for (j = 0; j < tapCount; j++) {
+            const LXConvolverTap *tap = kernel->taps + j;
+            const LXInteger sx = x + tap->ix;
+            const LXInteger sy = y + tap->iy;
+            ConvVec v = samplePixel(src, sx, sy, w, h, rowFloats);
+
+            if ( !kernel->nearest) {
+                ConvVec v10 = samplePixel(src, sx + 1, sy, w, h, rowFloats);
+                ConvVec v01 = samplePixel(src, sx, sy + 1, w, h, rowFloats);
+                ConvVec v11 = samplePixel(src, sx + 1, sy + 1, w, h, rowFloats);
+                ConvVec fx = cvSplat(tap->fx);
+                ConvVec fy = cvSplat(tap->fy);
+                v = cvAdd(v, cvMul(cvSub(v10, v), fx));
+                v01 = cvAdd(v01, cvMul(cvSub(v11, v01), fx));
+                v = cvAdd(v, cvMul(cvSub(v01, v), fy));
+            }
+
+            if (kernel->op == kConvOp_MAD)
+                acc = cvAdd(acc, cvMul(v, cvSplat(kernel->weights[j])));
+            else
+                acc = (j == 0) ? v : cvCombine(kernel->op, acc, v);
+        }
+        cvStore(dst + y*rowFloats + x*4, acc);
+    }
+}
+
+
+
+#pragma mark --- passes ---
+
+typedef struct {
+    const LXConvolverKernel *kernel;
+    const float *src;
+    float *dst;
+    LXInteger w;
+    LXInteger h;
+    size_t rowFloats;
+} LXConvolverPassJob;
+
+
+static void convolveBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    LXConvolverPassJob *job = (LXConvolverPassJob *)userData;
+    LXInteger y;
+
+    for (y = y0; y < y1; y++) {
+        if (job->kernel->method == kConvMethod_Sampled)
+            convolveRowSampled(job->kernel, job->src, job->dst, y, job->w, job->h, job->rowFloats);
+        else
+            convolveLine(job->kernel, job->src + y*job->rowFloats, job->dst + y*job->rowFloats, job->w, 4, 4);
+    }
+}
+
+static void convolveStrip(void *userData, LXInteger workerIndex, LXInteger itemIndex)
+{
+    LXConvolverPassJob *job = (LXConvolverPassJob *)userData;
+    const LXInteger x0 = itemIndex * CONV_STRIP_W;
+    const LXInteger x1 = MIN(x0 + CONV_STRIP_W, job->w);
+
+    convolveLine(job->kernel, job->src + x0*4, job->dst + x0*4, job->h, job->rowFloats, (x1 - x0) * 4);
+}
+
+static void runPass(const LXConvolverKernel *kernel, const float *src, float *dst, LXInteger w, LXInteger h)
+{
+    LXConvolverPassJob job = { kernel, src, dst, w, h, w*4 };
+
+    if (kernel->axis == kConvAxis_Y && kernel->method != kConvMethod_Sampled)
+        LXParallelApply((w + CONV_STRIP_W - 1) / CONV_STRIP_W, (w * h < kLXParallelMinPixels) ? 1 : 0, convolveStrip, &job);
+    else
+        LXParallelApplyToRowBands(w, h, CONV_BAND_ROWS, 0, convolveBand, &job);
+}
+
+
+static LXSuccess writeResult(const LXConvolverSettings *settings, float *buf, LXInteger w, LXInteger h,
+                             LXPixelBufferRef dstPixbuf, LXError *outError)
+{
+    const size_t rowBytes = w * 4 * sizeof(float);
+    char str[256];
+
+    memset(str, 0, 256);
+    if (settings->callbacks.getCustomFinisherInstruction)
+        settings->callbacks.getCustomFinisherInstruction(settings->owner, str, 255, "acc", 3, settings->callbackUserData);
+
+    if (strlen(str) < 1)
+        return LXPixelBufferWriteDataWithPixelFormatConversion(dstPixbuf, (uint8_t *)buf, w, h, rowBytes, kLX_RGBA_FLOAT32, NULL, outError);
+
+    // the finisher is ARBfp code that reads "acc", like in the GPU path's shaders
+    char prog[512];
+    snprintf(prog, 512, "!!ARBfp1.0  TEMP tcoord, offc, v, acc;\nTEX acc, fragment.texcoord[0], texture[0], RECT;\n%s\nEND", str);
+
+    LXShaderRef shader = LXShaderCreateWithString(prog, strlen(prog), kLXShaderFormat_OpenGLARBfp, 0, outError);
+    if ( !shader)
+        return NO;
+
+    LXSuccess ok = NO;
+    LXPixelBufferRef accPixbuf = LXPixelBufferCreateForData(w, h, kLX_RGBA_FLOAT32, rowBytes, (uint8_t *)buf, kLXStorageHint_ClientStorage, outError);
+    if (accPixbuf) {
+        LXTextureArrayRef texArray = LXTextureArrayCreateWithPixelBuffers(&accPixbuf, 1);
+        LXTextureArraySetSamplingAt(texArray, 0, kLXNearestSampling);
+        LXTextureArraySetWrapModeAt(texArray, 0, kLXWrapMode_ClampToEdge);
+
+        ok = LXShaderEvaluateIntoPixelBuffer(shader, texArray, dstPixbuf, outError);
+
+        LXTextureArrayRelease(texArray);
+        LXPixelBufferRelease(accPixbuf);
+    }
+    LXShaderRelease(shader);
+    return ok;
+}
+
+static LXSuccess convolvePixelBuffer(LXConvolverRef conv, LXInteger width, LXInteger passCount,
+                                     LXPixelBufferRef srcPixbuf, LXPixelBufferRef dstPixbuf, LXError *outError)
+{
+    if ( !conv || !srcPixbuf || !dstPixbuf) {
+        LXErrorSet(outError, kLXErrorID_Convolver_EmptyArg, "no convolver or pixel buffer given");
+        return NO;
+    }
+    const LXInteger w = LXPixelBufferGetWidth(srcPixbuf);
+    const LXInteger h = LXPixelBufferGetHeight(srcPixbuf);
+    const size_t rowBytes = w * 4 * sizeof(float);
+
+    if (w != LXPixelBufferGetWidth(dstPixbuf) || h != LXPixelBufferGetHeight(dstPixbuf)) {
+        LXErrorSet(outError, kLXErrorID_Convolver_SizeMismatch, "source and destination pixel buffers are not the same size");
+        return NO;
+    }
+
+    LXConvolverSettings settings;
+    LXConvolverKernel kernel;
+    LXSuccess ok = NO;
+    LXInteger i;
+
+    LXConvolverGetSettings_(conv, &settings);
+
+    if ( !initKernel(&kernel, &settings, width, outError))
+        return NO;
+
+    float *buf1 = _lx_malloc(h * rowBytes);
+    float *buf2 = _lx_malloc(h * rowBytes);
+
+    if (LXPixelBufferGetDataWithPixelFormatConversion(srcPixbuf, (uint8_t *)buf1, w, h, rowBytes, kLX_RGBA_FLOAT32, NULL, outError)) {
+        for (i = 0; i < passCount; i++) {
+            setKernelDirection(&kernel, &settings, settings.sampleRotation + i * 90.0);
+
+            runPass(&kernel, buf1, buf2, w, h);
+
+            float *temp = buf1;
+            buf1 = buf2;
+            buf2 = temp;
+        }
+        ok = writeResult(&settings, buf1, w, h, dstPixbuf, outError);
+    }
+
+    destroyKernel(&kernel);
+    _lx_free(buf1);
+    _lx_free(buf2);
+    return ok;
+}
+
+
+
+#pragma mark --- public API ---
+
+LXSuccess LXConvolverRender1DIntoPixelBuffer(LXConvolverRef conv, LXInteger width,
+                                             LXPixelBufferRef srcPixbuf, LXPixelBufferRef dstPixbuf, LXError *outError)
+{
+    return convolvePixelBuffer(conv, width, 1, srcPixbuf, dstPixbuf, outError);
+}
+
+LXSuccess LXConvolverRenderSeparableIntoPixelBuffer(LXConvolverRef conv, LXInteger width,
+                                                    LXPixelBufferRef srcPixbuf, LXPixelBufferRef dstPixbuf, LXError *outError)
+{
+    return convolvePixelBuffer(conv, width, 2, srcPixbuf, dstPixbuf, outError);
+}
+
+
+
+#if defined(LXPLATFORM_LINUX)
+
+#pragma mark --- software renderer convolver object ---
+
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    LXConvolverSettings settings;
+
+    LXTextureRef texture;
+    LXRect outputRect;
+} LXConvolverCPUImpl;
+
+
+const char *LXConvolverTypeID()
+{
+    static const char *s = "LXConvolver";
+    return s;
+}
+
+LXConvolverRef LXConvolverRetain(LXConvolverRef r)
+{
+    if ( !r) return NULL;
+    LXConvolverCPUImpl *imp = (LXConvolverCPUImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+    return r;
+}
+
+void LXConvolverRelease(LXConvolverRef r)
+{
+    if ( !r) return;
+    LXConvolverCPUImpl *imp = (LXConvolverCPUImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+
+        _lx_free(imp);
+    }
+}
+
+LXConvolverRef LXConvolverCreate(LXPoolRef pool, LXUInteger flags, LXError *outError)
+{
+    LXConvolverCPUImpl *imp = _lx_calloc(sizeof(LXConvolverCPUImpl), 1);
+    LXREF_INIT(imp, LXConvolverTypeID(), LXConvolverRetain, LXConvolverRelease);
+
+    imp->settings.owner = (LXConvolverRef)imp;
+    imp->settings.doNormalize = YES;
+
+    return (LXConvolverRef)imp;
+}
+
+void LXConvolverGetSettings_(LXConvolverRef conv, LXConvolverSettings *outSettings)
+{
+    LXConvolverCPUImpl *imp = (LXConvolverCPUImpl *)conv;
+
+    memcpy(outSettings, &(imp->settings), sizeof(LXConvolverSettings));
+}
+
+void LXConvolverSetCallbacks(LXConvolverRef conv, LXConvolverCallbacks_v1 *callbacks, void *userData)
+{
+    if ( !conv) return;
+    LXConvolverCPUImpl *imp = (LXConvolverCPUImpl *)conv;
+
+    memcpy(&(imp->settings.callbacks), callbacks, sizeof(LXConvolverCallbacks_v1));
+
+    imp->settings.callbackUserData = userData;
+}
+
+void LXConvolverSetSampling(LXConvolverRef conv, LXUInteger samplingEnum)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->settings.samplingType = samplingEnum;
+}
+
+void LXConvolverSetSourceTexture(LXConvolverRef conv, LXTextureRef texture)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->texture = texture;
+}
+
+void LXConvolverSetOutputRect(LXConvolverRef conv, LXRect rect)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->outputRect = rect;
+}
+
+void LXConvolverSetSampleDistance(LXConvolverRef conv, LXFloat sampleDistance)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->settings.sampleDistance = sampleDistance;
+}
+
+void LXConvolverSetSampleRotation(LXConvolverRef conv, LXFloat sampleRot)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->settings.sampleRotation = sampleRot;
+}
+
+void LXConvolverSetNormalizesWeights(LXConvolverRef conv, LXBool doNormalize)
+{
+    if ( !conv) return;
+    ((LXConvolverCPUImpl *)conv)->settings.doNormalize = doNormalize;
+}
+
+// surfaces and textures are pixel buffers in the software renderer, so the whole kernel is rendered in one pass into surface1
+LXSurfaceRef LXConvolverRender1DWithWidthUsingSurfaces(LXConvolverRef conv,
+                                                       LXInteger width,
+                                                       LXSurfaceRef surface1,
+                                                       LXSurfaceRef surface2,
+                                                       int *outPassCount,
+                                                       LXError *outError)
+{
+    if ( !conv) return NULL;
+    LXConvolverCPUImpl *imp = (LXConvolverCPUImpl *)conv;
+
+    if (outPassCount) *outPassCount = 1;
+
+    if ( !surface1)
+        return NULL;
+
+    if ( !imp->texture) {
+        LXErrorSet(outError, kLXErrorID_Convolver_EmptyArg, "no source texture");
+        return NULL;
+    }
+
+    LXSurfaceBeginAccessOnThread(0);
+
+    LXPixelBufferRef srcPixbuf = (LXPixelBufferRef)LXTextureLockPlatformNativeObj(imp->texture);
+    LXPixelBufferRef dstPixbuf = (LXPixelBufferRef)LXSurfaceLockPlatformNativeObj(surface1);
+
+    LXSuccess ok = LXConvolverRender1DIntoPixelBuffer(conv, width, srcPixbuf, dstPixbuf, outError);
+
+    LXSurfaceUnlockPlatformNativeObj(surface1);
+    LXTextureUnlockPlatformNativeObj(imp->texture);
+
+    LXSurfaceEndAccessOnThread();
+
+    return (ok) ? surface1 : NULL;
+}
+
+#endif  // LXPLATFORM_LINUX
@@ -16,6 +16,7 @@
 #import "LXSurface.h"
 #import "LXPlatform.h"
 #import "LXConvolver.h"
+#import "LXConvolver_priv.h"
 #import "LXDraw_Impl.h"
 #import "LXStringUtils.h"
 
@@ -170,6 +171,21 @@ LXConvolverRef LXConvolverCreate(LXPoolRef pool, LXUInteger flags, LXError *outE
     return (LXConvolverRef)imp;
 }
 
+// used by the CPU convolution functions in LXConvolver_cpu.c
+void LXConvolverGetSettings_(LXConvolverRef conv, LXConvolverSettings *outSettings)
+{
+    LXConvolverImpl *imp = (LXConvolverImpl *)conv;
+    
+    memset(outSettings, 0, sizeof(LXConvolverSettings));
+    outSettings->owner = conv;
+    outSettings->callbacks = imp->inner->callbacks;
+    outSettings->callbackUserData = imp->inner->callbackUserData;
+    outSettings->samplingType = imp->inner->samplingType;
+    outSettings->sampleDistance = imp->inner->sampleDistance;
+    outSettings->sampleRotation = imp->inner->sampleRotation;
+    outSettings->doNormalize = imp->inner->doNormalize;
+}
+
 void LXConvolverSetCallbacks(LXConvolverRef conv, LXConvolverCallbacks_v1 *callbacks, void *userData)
 {
     if ( !conv) return;
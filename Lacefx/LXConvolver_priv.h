@@ -0,0 +1,38 @@
+/*
+ *  LXConvolver_priv.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXCONVOLVER_PRIV_H_
+#define _LXCONVOLVER_PRIV_H_
+
+#include "LXConvolver.h"
+
+
+// the kernel settings of a convolver object, as used by the CPU convolution engine (LXConvolver_cpu.c)
+typedef struct {
+    LXConvolverRef owner;
+
+    LXConvolverCallbacks_v1 callbacks;
+    void *callbackUserData;
+
+    LXUInteger samplingType;
+    double sampleDistance;
+    double sampleRotation;
+    LXBool doNormalize;
+} LXConvolverSettings;
+
+
+// implemented by the platform's convolver object
+void LXConvolverGetSettings_(LXConvolverRef conv, LXConvolverSettings *outSettings);
+
+
+#endif
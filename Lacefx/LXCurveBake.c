@@ -0,0 +1,423 @@
+/*
+ *  LXCurveBake.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXCurveBake.h"
+#include "LXCurveFunctions.h"
+#include "LXMutex.h"
+#include "LXRef_Impl.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+// each segment is first split into this many pieces, so that an S-shaped piece can't look straight
+// at the sample points; pieces are then subdivided down to MAXDEPTH levels
+#define INITIALPIECES   8
+#define MAXDEPTH        14
+
+// number of recently created bakes kept by LXCurveBakeCreateCached()
+#define CACHESIZE       16
+
+// the cache has its own lock because retain/release can use g_lxAtomicLock
+static LXMutex s_cacheMutex;
+static LXBool s_cacheMutexInited = NO;
+
+// an interval of the polyline is stored as a vector so that the batch evaluation can load it at once
+typedef struct {
+    float x;
+    float y;
+    float slope;
+    float _pad;
+} LXCurveBakeInterval;
+
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    uint64_t hash;
+    double tolerance;
+    uint8_t *curveData;         // copy of the packed segment array, for verifying cache hits
+    size_t curveDataSize;
+
+    LXInteger intervalCount;    // the last entry is the end point with a zero slope
+    LXCurveBakeInterval *intervals;
+
+    float xMin, xMax;
+    float bucketScale;          // index bucket = (x - xMin) * bucketScale
+    LXInteger bucketCount;
+    int32_t *buckets;           // index of the interval that contains each bucket's start
+} LXCurveBakeImpl;
+
+
+#pragma mark --- creation ---
+
+const char *LXCurveBakeTypeID()
+{
+    static const char *s = "LXCurveBake";
+    return s;
+}
+
+LXCurveBakeRef LXCurveBakeRetain(LXCurveBakeRef r)
+{
+    if ( !r) return NULL;
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+    return r;
+}
+
+void LXCurveBakeRelease(LXCurveBakeRef r)
+{
+    if ( !r) return;
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+        _lx_free(imp->curveData);
+        _lx_free(imp->intervals);
+        _lx_free(imp->buckets);
+        _lx_free(imp);
+    }
+}
+
+// FNV-1a
+static uint64_t hashBytes(const uint8_t *data, size_t len, uint64_t h)
+{
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static size_t packedSizeOfCurveArray(const LXCurveSegment *curves, LXUInteger curveCount)
+{
+    const uint8_t *p = (const uint8_t *)curves;
+    size_t size = 0;
+    LXUInteger i;
+    for (i = 0; i < curveCount; i++) {
+        size_t segSize = LXCurveSegmentGetPackedSize(((const LXCurveSegment *)(p + size))->type);
+        size += segSize;
+    }
+    return size;
+}
+
+static uint64_t hashForCurveData(const uint8_t *data, size_t len, double tolerance)
+{
+    uint64_t h = hashBytes(data, len, 0xcbf29ce484222325ULL);
+    return hashBytes((const uint8_t *)&tolerance, sizeof(double), h);
+}
+
+
+#pragma mark --- flattening ---
+
+// distance of "p" from the chord p0-p1 as seen by the lookup, i.e. vertically.
+// a vertical chord can only represent points directly above or below it
+static double chordError(LXPoint p0, LXPoint p1, LXPoint p)
+{
+    const double dx = p1.x - p0.x;
+    if (fabs(dx) <= 1.0e-9) {
+        return fabs(p.x - p0.x);
+    }
+    const double yc = p0.y + (p1.y - p0.y) * ((p.x - p0.x) / dx);
+    return fabs(p.y - yc);
+}
+
+static void flattenSegment(const LXCurveSegment *seg, double tolerance, LXCurvePointList *list)
+{
+    if (list->count == 0) LXCurvePointListAppend(list, seg->startPoint);
+
+    LXCurveSegmentFlatten(seg, chordError, tolerance, INITIALPIECES, MAXDEPTH, list);
+}
+
+static void buildTables(LXCurveBakeImpl *imp, LXCurvePointList *list)
+{
+    const LXInteger n = list->count;
+    LXPoint *pts = list->points;
+    LXInteger i, b;
+
+    // force x to be monotonic
+    for (i = 1; i < n; i++) {
+        if (pts[i].x < pts[i-1].x) pts[i].x = pts[i-1].x;
+    }
+
+    imp->intervalCount = n;
+    imp->intervals = _lx_calloc(n, sizeof(LXCurveBakeInterval));
+    for (i = 0; i < n; i++) {
+        LXCurveBakeInterval *iv = imp->intervals + i;
+        iv->x = pts[i].x;
+        iv->y = pts[i].y;
+        if (i < n - 1 && pts[i+1].x > pts[i].x) {
+            iv->slope = (pts[i+1].y - pts[i].y) / (pts[i+1].x - pts[i].x);
+        }
+    }
+
+    imp->xMin = pts[0].x;
+    imp->xMax = pts[n-1].x;
+
+    // about two buckets per interval keeps the forward scan in a lookup short
+    imp->bucketCount = MIN(MAX(2 * n, 16), 65536);
+    imp->bucketScale = (imp->xMax > imp->xMin) ? (float)(imp->bucketCount) / (imp->xMax - imp->xMin) : 0.0f;
+    imp->buckets = _lx_calloc(imp->bucketCount, sizeof(int32_t));
+
+    i = 0;
+    for (b = 0; b < imp->bucketCount; b++) {
+        const float x = (imp->bucketScale > 0.0f) ? imp->xMin + (float)b / imp->bucketScale : imp->xMin;
+        while (i < n - 1 && x >= imp->intervals[i+1].x) i++;
+        imp->buckets[b] = (int32_t)i;
+    }
+}
+
+LXCurveBakeRef LXCurveBakeCreate(const LXCurveSegment *curves, LXUInteger curveCount, double tolerance, LXError *outError)
+{
+    if ( !curves || curveCount < 1) {
+        LXErrorSet(outError, kLXErrorID_CurveBake_EmptyArg, "empty argument");
+        return NULL;
+    }
+    if (tolerance == 0.0) tolerance = kLXCurveBake_DefaultTolerance;
+    if ( !(tolerance > 0.0)) {
+        LXErrorSet(outError, kLXErrorID_CurveBake_InvalidTolerance, "tolerance must be positive");
+        return NULL;
+    }
+    if (curves->type & kLXCurveSegmentFlag_HasNoStartPoint) {
+        LXErrorSet(outError, kLXErrorID_CurveBake_InvalidCurve, "first curve segment must have a start point");
+        return NULL;
+    }
+
+    const uint8_t *p = (const uint8_t *)curves;
+    const size_t dataSize = packedSizeOfCurveArray(curves, curveCount);
+    LXCurvePointList list = { NULL, 0, 0 };
+    LXPoint prevEnd = LXZeroPoint;
+    LXUInteger i;
+
+    for (i = 0; i < curveCount; i++) {
+        LXCurveSegment seg;
+        const LXUInteger packedType = ((const LXCurveSegment *)p)->type;
+        const size_t segSize = LXCurveSegmentGetPackedSize(packedType);
+
+        memcpy(&seg, p, segSize);
+        p += segSize;
+
+        if (packedType & kLXCurveSegmentFlag_HasNoStartPoint) seg.startPoint = prevEnd;
+        seg.type = LXCurveSegmentTypeNoFlags(packedType);
+        prevEnd = seg.endPoint;
+
+        if (seg.type > kLXCatmullRomSegment) {
+            char msg[256];
+            sprintf(msg, "unknown curve segment type (%ld) at index %ld", (long)seg.type, (long)i);
+            LXErrorSet(outError, kLXErrorID_CurveBake_InvalidCurve, msg);
+            _lx_free(list.points);
+            return NULL;
+        }
+        flattenSegment(&seg, tolerance, &list);
+    }
+
+    LXCurveBakeImpl *imp = _lx_calloc(sizeof(LXCurveBakeImpl), 1);
+    LXREF_INIT(imp, LXCurveBakeTypeID(), LXCurveBakeRetain, LXCurveBakeRelease);
+
+    imp->tolerance = tolerance;
+    imp->curveDataSize = dataSize;
+    imp->curveData = _lx_malloc(dataSize);
+    memcpy(imp->curveData, curves, dataSize);
+    imp->hash = hashForCurveData(imp->curveData, dataSize, tolerance);
+
+    buildTables(imp, &list);
+    _lx_free(list.points);
+
+    return (LXCurveBakeRef)imp;
+}
+
+static LXMutexPtr cacheLock()
+{
+    LXMutexLock(g_lxAtomicLock);
+    if ( !s_cacheMutexInited) {
+        LXMutexInit(&s_cacheMutex);
+        s_cacheMutexInited = YES;
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+    return &s_cacheMutex;
+}
+
+LXCurveBakeRef LXCurveBakeCreateCached(const LXCurveSegment *curves, LXUInteger curveCount, double tolerance, LXError *outError)
+{
+    // most recently used first
+    static LXCurveBakeImpl *s_cache[CACHESIZE];
+    LXCurveBakeImpl *found = NULL;
+    LXCurveBakeImpl *evicted = NULL;
+    LXInteger i;
+
+    if ( !curves || curveCount < 1) {
+        LXErrorSet(outError, kLXErrorID_CurveBake_EmptyArg, "empty argument");
+        return NULL;
+    }
+    if (tolerance == 0.0) tolerance = kLXCurveBake_DefaultTolerance;
+
+    const size_t dataSize = packedSizeOfCurveArray(curves, curveCount);
+    const uint64_t hash = hashForCurveData((const uint8_t *)curves, dataSize, tolerance);
+
+    LXMutexLock(cacheLock());
+    for (i = 0; i < CACHESIZE && s_cache[i]; i++) {
+        LXCurveBakeImpl *c = s_cache[i];
+        if (c->hash == hash && c->curveDataSize == dataSize && c->tolerance == tolerance
+                    && 0 == memcmp(c->curveData, curves, dataSize)) {
+            found = c;
+            memmove(s_cache + 1, s_cache, i * sizeof(LXCurveBakeImpl *));
+            s_cache[0] = found;
+            LXCurveBakeRetain((LXCurveBakeRef)found);
+            break;
+        }
+    }
+    LXMutexUnlock(&s_cacheMutex);
+
+    if (found) return (LXCurveBakeRef)found;
+
+    // created outside the lock; if another thread makes the same bake meanwhile, both are kept in the cache
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)LXCurveBakeCreate(curves, curveCount, tolerance, outError);
+    if ( !imp) return NULL;
+
+    LXMutexLock(&s_cacheMutex);
+    evicted = s_cache[CACHESIZE - 1];
+    memmove(s_cache + 1, s_cache, (CACHESIZE - 1) * sizeof(LXCurveBakeImpl *));
+    s_cache[0] = (LXCurveBakeImpl *)LXCurveBakeRetain((LXCurveBakeRef)imp);
+    LXMutexUnlock(&s_cacheMutex);
+
+    LXCurveBakeRelease((LXCurveBakeRef)evicted);
+    return (LXCurveBakeRef)imp;
+}
+
+
+#pragma mark --- accessors ---
+
+uint64_t LXCurveBakeGetContentHash(LXCurveBakeRef r)
+{
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+    return (imp) ? imp->hash : 0;
+}
+
+void LXCurveBakeGetXRange(LXCurveBakeRef r, float *outMin, float *outMax)
+{
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+    if ( !imp) return;
+    if (outMin) *outMin = imp->xMin;
+    if (outMax) *outMax = imp->xMax;
+}
+
+LXUInteger LXCurveBakeGetPointCount(LXCurveBakeRef r)
+{
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+    return (imp) ? imp->intervalCount : 0;
+}
+
+
+#pragma mark --- evaluation ---
+
+LXINLINE float clampX(const LXCurveBakeImpl *imp, float x)
+{
+    // written so that NaN becomes xMin
+    return (x > imp->xMin) ? ((x < imp->xMax) ? x : imp->xMax) : imp->xMin;
+}
+
+// "x" must be clamped
+LXINLINE LXInteger intervalIndexForX(const LXCurveBakeImpl *imp, float x, LXInteger bucket)
+{
+    const LXCurveBakeInterval *ivs = imp->intervals;
+    const LXInteger last = imp->intervalCount - 1;
+    LXInteger i = imp->buckets[bucket];
+
+    // the bucket computed for x can be one off because of rounding, so this can also step back
+    while (i > 0 && x < ivs[i].x) i--;
+    while (i < last && x >= ivs[i+1].x) i++;
+    return i;
+}
+
+LXINLINE LXInteger bucketForX(const LXCurveBakeImpl *imp, float x)
+{
+    const LXInteger b = (LXInteger)((x - imp->xMin) * imp->bucketScale);
+    return MIN(b, imp->bucketCount - 1);
+}
+
+float LXCurveBakeEvaluate(LXCurveBakeRef r, float x)
+{
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+    if ( !imp) return 0.0f;
+
+    x = clampX(imp, x);
+    const LXCurveBakeInterval *iv = imp->intervals + intervalIndexForX(imp, x, bucketForX(imp, x));
+    return iv->y + iv->slope * (x - iv->x);
+}
+
+void LXCurveBakeEvaluateArray(LXCurveBakeRef r, const float *inX, float *outY, size_t count)
+{
+    LXCurveBakeImpl *imp = (LXCurveBakeImpl *)r;
+    size_t i = 0;
+    if ( !imp || !inX || !outY) return;
+
+#if defined(__SSE2__)
+    {
+    // the bucket arithmetic and interpolation are done four values at a time.
+    // SSE2 has no gather, so the intervals are found one lane at a time and transposed into vectors
+    const __m128 xMin = _mm_set1_ps(imp->xMin);
+    const __m128 xMax = _mm_set1_ps(imp->xMax);
+    const __m128 bucketScale = _mm_set1_ps(imp->bucketScale);
+    const __m128 maxBucket = _mm_set1_ps((float)(imp->bucketCount - 1));
+    const float *ivData = (const float *)imp->intervals;
+    float xs[4];
+    int32_t bs[4];
+
+    for (; i + 4 <= count; i += 4) {
+        // max/min return the second operand for NaN, so NaN becomes xMin as in clampX()
+        __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(inX + i), xMin), xMax);
+        __m128 b = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(x, xMin), bucketScale), maxBucket);
+
+        _mm_storeu_ps(xs, x);
+        _mm_storeu_si128((__m128i *)bs, _mm_cvttps_epi32(b));
+
+        __m128 iv0 = _mm_loadu_ps(ivData + 4 * intervalIndexForX(imp, xs[0], bs[0]));
+        __m128 iv1 = _mm_loadu_ps(ivData + 4 * intervalIndexForX(imp, xs[1], bs[1]));
+        __m128 iv2 = _mm_loadu_ps(ivData + 4 * intervalIndexForX(imp, xs[2], bs[2]));
+        __m128 iv3 = _mm_loadu_ps(ivData + 4 * intervalIndexForX(imp, xs[3], bs[3]));
+        _MM_TRANSPOSE4_PS(iv0, iv1, iv2, iv3);
+
+        // after the transpose: iv0 = x, iv1 = y, iv2 = slope
+        _mm_storeu_ps(outY + i, _mm_add_ps(iv1, _mm_mul_ps(iv2, _mm_sub_ps(x, iv0))));
+    }
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float x = clampX(imp, inX[i]);
+        const LXCurveBakeInterval *iv = imp->intervals + intervalIndexForX(imp, x, bucketForX(imp, x));
+        outY[i] = iv->y + iv->slope * (x - iv->x);
+    }
+}
+
+LXSuccess LXCurveBakeSampleUniform(LXCurveBakeRef r, float xMin, float xMax, LXUInteger count, float *outValues)
+{
+    if ( !r || !outValues || count < 1) return NO;
+
+    const float step = (count > 1) ? (xMax - xMin) / (float)(count - 1) : 0.0f;
+    LXUInteger i;
+    for (i = 0; i < count; i++) {
+        outValues[i] = xMin + step * (float)i;
+    }
+    outValues[count - 1] = (count > 1) ? xMax : xMin;
+
+    LXCurveBakeEvaluateArray(r, outValues, outValues, count);
+    return YES;
+}
@@ -0,0 +1,83 @@
+/*
+ *  LXCurveBake.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXCURVEBAKE_H_
+#define _LXCURVEBAKE_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+#include "LXCurveTypes.h"
+
+
+enum {
+    kLXErrorID_CurveBake_EmptyArg = 7101,
+    kLXErrorID_CurveBake_InvalidCurve,
+    kLXErrorID_CurveBake_InvalidTolerance
+};
+
+// used when the tolerance given to the create functions is 0
+#define kLXCurveBake_DefaultTolerance  1.0e-4
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma mark --- LXCurveBake public API methods ---
+
+/*
+  A curve bake is a y = f(x) function made from an array of curve segments (e.g. a color correction curve
+  or an animation curve), for evaluating many values without solving the segments for each one.
+
+  The segments are flattened adaptively into a polyline whose vertical distance from the curve is within the tolerance
+  (as measured at sample points between the polyline's vertices). If a segment turns back in x, x is clamped
+  so that the polyline stays monotonic. Lookups use a uniform index over the x range, so they take constant time
+  regardless of the number of vertices. x values outside the curve's range evaluate to the end values.
+
+  Segment arrays can use kLXCurveSegmentFlag_HasNoStartPoint; such a segment starts at the previous segment's end point.
+  A bake is immutable, so it can be used from many threads.
+*/
+
+LXEXPORT const char *LXCurveBakeTypeID();
+
+// the returned object is retained. "tolerance" can be 0 for the default
+LXEXPORT LXCurveBakeRef LXCurveBakeCreate(const LXCurveSegment *curves, LXUInteger curveCount, double tolerance, LXError *outError);
+
+// the same, but returns an existing bake if one was recently made from identical curve data and tolerance.
+// the returned object is retained
+LXEXPORT LXCurveBakeRef LXCurveBakeCreateCached(const LXCurveSegment *curves, LXUInteger curveCount, double tolerance, LXError *outError);
+
+LXEXPORT LXCurveBakeRef LXCurveBakeRetain(LXCurveBakeRef bake);
+LXEXPORT void LXCurveBakeRelease(LXCurveBakeRef bake);
+
+// the hash of the curve data that the bake was made from
+LXEXPORT uint64_t LXCurveBakeGetContentHash(LXCurveBakeRef bake);
+
+LXEXPORT void LXCurveBakeGetXRange(LXCurveBakeRef bake, float *outMin, float *outMax);
+
+// number of vertices in the flattened polyline
+LXEXPORT LXUInteger LXCurveBakeGetPointCount(LXCurveBakeRef bake);
+
+LXEXPORT float LXCurveBakeEvaluate(LXCurveBakeRef bake, float x);
+
+// evaluates "count" values; "inX" and "outY" can be the same array
+LXEXPORT void LXCurveBakeEvaluateArray(LXCurveBakeRef bake, const float *inX, float *outY, size_t count);
+
+// fills "outValues" with "count" samples spaced evenly over [xMin, xMax] (both ends included), e.g. for a 1D LUT texture
+LXEXPORT LXSuccess LXCurveBakeSampleUniform(LXCurveBakeRef bake, float xMin, float xMax, LXUInteger count, float *outValues);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
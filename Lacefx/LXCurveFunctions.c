@@ -431,7 +431,7 @@ LXINLINE size_t serializedSizeForCurveSegmentType(uint32_t type)
     return segSerSize;
 }
 
-LXINLINE size_t decodedSizeForCurveSegmentType(uint32_t type)
+size_t LXCurveSegmentGetPackedSize(LXUInteger type)
 {
     LXBool hasNoStartPoint = (type & kLXCurveSegmentFlag_HasNoStartPoint) ? YES : NO;
     size_t ss = sizeof(LXCurveSegment);
@@ -451,7 +451,7 @@ size_t LXCurveArrayGetSerializedDataSize(const LXCurveSegment *curves, LXUIntege
         ///LXPrintf(".. seg %i / type %i: data size %i\n", i, seg->type, serializedSizeForCurveSegmentType(seg->type));
 
         dataSize += serializedSizeForCurveSegmentType(seg->type);
-        curvesPtr += decodedSizeForCurveSegmentType(seg->type);
+        curvesPtr += LXCurveSegmentGetPackedSize(seg->type);
     }
     return dataSize;
 }
@@ -481,7 +481,7 @@ LXSuccess LXCurveArraySerialize(const LXCurveSegment *curves, LXUInteger curveCo
         LXBool hasNoStartPoint = (seg->type & kLXCurveSegmentFlag_HasNoStartPoint) ? YES : NO;
         
         size_t segSerSize = serializedSizeForCurveSegmentType(seg->type);
-        curvesPtr += decodedSizeForCurveSegmentType(seg->type);
+        curvesPtr += LXCurveSegmentGetPackedSize(seg->type);
         ///LXPrintf(" serializing %i: realtype is %i; nostartp %i; sersize %i; dataOffset %i\n", i, realType, hasNoStartPoint, segSerSize, (int)dataSize);
 
         if (dataSize+segSerSize > bufLen) {
@@ -573,7 +573,7 @@ LXSuccess LXCurveArrayCreateFromSerializedData(const uint8_t *buf, size_t dataLe
         if (dataIsFlipped)
             type = LXEndianSwap_uint32(type);
         
-        decodedDataSize += decodedSizeForCurveSegmentType(type);
+        decodedDataSize += LXCurveSegmentGetPackedSize(type);
         curveSerDataBuffer += serializedSizeForCurveSegmentType(type);
     }
     
@@ -599,7 +599,7 @@ LXSuccess LXCurveArrayCreateFromSerializedData(const uint8_t *buf, size_t dataLe
         serSeg += 4;
         
         LXCurveSegment *decSeg = (LXCurveSegment *)decBuffer;
-        decBuffer += decodedSizeForCurveSegmentType(type);
+        decBuffer += LXCurveSegmentGetPackedSize(type);
         
         LXUInteger realType = LXCurveSegmentTypeNoFlags(type);
         LXBool hasNoStartPoint = (type & kLXCurveSegmentFlag_HasNoStartPoint) ? YES : NO;
@@ -644,6 +644,60 @@ LXSuccess LXCurveArrayCreateFromSerializedData(const uint8_t *buf, size_t dataLe
 
 
 
+#pragma mark --- flattening ---
+
+void LXCurvePointListAppend(LXCurvePointList *list, LXPoint p)
+{
+    if (list->count >= list->capacity) {
+        list->capacity = (list->capacity > 0) ? list->capacity * 2 : 256;
+        list->points = _lx_realloc(list->points, list->capacity * sizeof(LXPoint));
+    }
+    list->points[list->count++] = p;
+}
+
+// appends the vertices after p0 up to and including p1
+static void flattenPiece(const LXCurveSegment *seg, LXCurveChordErrorFuncPtr chordError, double tolerance,
+                         double u0, LXPoint p0, double u1, LXPoint p1,
+                         LXInteger depth, LXInteger maxDepth, LXCurvePointList *list)
+{
+    const double du = u1 - u0;
+    const LXPoint pq1 = LXCalcCurvePointAtU(*seg, u0 + du * 0.25);
+    const LXPoint pm  = LXCalcCurvePointAtU(*seg, u0 + du * 0.5);
+    const LXPoint pq3 = LXCalcCurvePointAtU(*seg, u0 + du * 0.75);
+
+    double err = chordError(p0, p1, pm);
+    err = MAX(err, chordError(p0, p1, pq1));
+    err = MAX(err, chordError(p0, p1, pq3));
+
+    if (err <= tolerance || depth >= maxDepth) {
+        LXCurvePointListAppend(list, p1);
+    } else {
+        flattenPiece(seg, chordError, tolerance, u0, p0, u0 + du * 0.5, pm, depth + 1, maxDepth, list);
+        flattenPiece(seg, chordError, tolerance, u0 + du * 0.5, pm, u1, p1, depth + 1, maxDepth, list);
+    }
+}
+
+void LXCurveSegmentFlatten(const LXCurveSegment *seg, LXCurveChordErrorFuncPtr chordError, double tolerance,
+                           LXInteger initialPieces, LXInteger maxDepth, LXCurvePointList *list)
+{
+    LXPoint p0 = seg->startPoint;
+    LXInteger i;
+
+    if (LXCurveSegmentTypeNoFlags(seg->type) == kLXLinearSegment) {
+        LXCurvePointListAppend(list, seg->endPoint);
+        return;
+    }
+    initialPieces = MAX(1, initialPieces);
+    for (i = 0; i < initialPieces; i++) {
+        const double u0 = (double)i / initialPieces;
+        const double u1 = (double)(i + 1) / initialPieces;
+        const LXPoint p1 = (i == initialPieces - 1) ? seg->endPoint : LXCalcCurvePointAtU(*seg, u1);
+        flattenPiece(seg, chordError, tolerance, u0, p0, u1, p1, 0, maxDepth, list);
+        p0 = p1;
+    }
+}
+
+
 #pragma mark --- arcs ---
 
 static LXCurveSegment bezierCurveSegmentFromArcSegment(double xc, double yc, double radius, double angle1, double angle2)
@@ -814,13 +868,12 @@ LXSuccess LXPlotLinearSegment(LXPoint p0, LXPoint p1, LXPoint **outPixels, LXUIn
     }
     
     if (swapPoints) {
-        // swap array's direction... this is stupid, but it doesn't get called often enough to matter
-        LXPoint *oldArr = pArray;
-        pArray = _lx_malloc(pointCount * sizeof(LXPoint));
-        for (i = 0; i < pointCount; i++) {
-            pArray[i] = oldArr[pointCount-1-i];
+        // reverse the array's direction in place
+        for (i = 0; i < pointCount / 2; i++) {
+            LXPoint t = pArray[i];
+            pArray[i] = pArray[pointCount-1-i];
+            pArray[pointCount-1-i] = t;
         }
-        _lx_free(oldArr);
     }
     
     *outPixels = pArray;
@@ -55,6 +55,28 @@ LXEXPORT void LXCreateBezierCurvesForArc(LXFloat xc, LXFloat yc, LXFloat radius,
                                          LXBool isForward,
                                          LXCurveSegment **outSegs, size_t *outSegCount);
 
+// flattening curves into polylines
+//
+typedef struct {
+    LXPoint *points;
+    LXInteger count;
+    LXInteger capacity;
+} LXCurvePointList;
+
+// error of the chord p0-p1 for a point "p" on the curve, e.g. the distance of "p" from the chord
+typedef double(*LXCurveChordErrorFuncPtr)(LXPoint p0, LXPoint p1, LXPoint p);
+
+LXEXPORT void LXCurvePointListAppend(LXCurvePointList *list, LXPoint p);
+
+// appends the vertices of "seg" after its start point, up to and including its end point.
+// curved segments are first split into "initialPieces" pieces (so that an S-shaped piece can't look straight at the
+// sample points), and each piece is halved until "chordError" is within "tolerance" or "maxDepth" levels are reached
+LXEXPORT void LXCurveSegmentFlatten(const LXCurveSegment *seg, LXCurveChordErrorFuncPtr chordError, double tolerance,
+                                    LXInteger initialPieces, LXInteger maxDepth, LXCurvePointList *list);
+
+// size of a segment in a packed curve array, where segments with kLXCurveSegmentFlag_HasNoStartPoint omit the start point
+LXEXPORT size_t LXCurveSegmentGetPackedSize(LXUInteger type);
+
 // binary serialisation utility
 //
 LXEXPORT size_t LXCurveArrayGetSerializedDataSize(const LXCurveSegment *curves, LXUInteger curveCount);
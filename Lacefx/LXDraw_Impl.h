@@ -22,6 +22,10 @@
 #include <d3d9.h>
 #endif
 
+#if defined(LXPLATFORM_LINUX)
+#include "LXSurface.h"
+#endif
+
 
 typedef struct _LXDrawContextActiveState {
     LXBool didPushMVMatrix;
@@ -42,6 +46,10 @@ typedef struct _LXDrawContextActiveState {
     float projModelviewGLMatrix[16];
 #endif
 
+#if defined(LXPLATFORM_LINUX)
+    float projModelviewMatrix[16];  // row-major like LX4x4Matrix; applied to column vectors
+#endif
+
 } LXDrawContextActiveState;
 
 
@@ -82,6 +90,19 @@ void LXDrawContextApplyFixedFunctionBaseColorInsteadOfShader_(LXDrawContextRef d
 // private platform info
 LXBool LXSurfaceHasDefaultPixelOrthoProjection(LXSurfaceRef r);
 
+#if defined(LXPLATFORM_LINUX)
+// software renderer; implemented in LXDraw_cpu.c.
+// the state must have been set up with LXDrawContextBeginForSurface_()
+LXSuccess LXDrawCPURenderPrimitive_(LXPixelBufferRef dstPixbuf,
+                                    LXPrimitiveType primitiveType,
+                                    void *vertices,
+                                    LXUInteger vertexCount,
+                                    LXVertexType vertexType,
+                                    LXDrawContextRef drawCtx,
+                                    LXDrawContextActiveState *state,
+                                    LXError *outError);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
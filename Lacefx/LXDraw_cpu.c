@@ -0,0 +1,1160 @@
+/*
+ *  LXDraw_cpu.c
+ *  Lacefx private
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXDraw_Impl.h"
+#include "LXDrawContext_Impl.h"
+#include "LXDrawContext.h"
+#include "LXShader.h"
+#include "LXShader_Impl.h"
+#include "LXShaderUtils.h"
+#include "LXTransform3D.h"
+#include "LXTexture.h"
+#include "LXTextureArray.h"
+#include "LXPixelBuffer.h"
+#include "LXPixelBuffer_priv.h"
+#include "LXParallel.h"
+#include "LXMutex.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+ #include <emmintrin.h>
+#endif
+
+
+/*
+ this file contains the LXDrawContext implementation for the software renderer,
+ and the rasterizer that LXSurface_cpu.c uses to draw primitives.
+
+ drawing has two parallel passes. the front end transforms vertices by the draw context's projection and modelview,
+ clips primitives against the near and far planes, snaps them to a subpixel grid and bins the triangles into 64*64 pixel tiles.
+ the back end renders the tiles: each tile is converted to float RGBA, the triangles binned into it are scan-converted
+ in draw order (four pixels at a time with SSE2) and their fragments are shaded in batches by the CPU shader evaluator
+ (LXShader_cpu.c), then blended.
+*/
+
+#if defined(LXPLATFORM_LINUX)
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+#pragma mark --- draw context ---
+
+void LXTransform3DBeginForProjectionAndModelView_(LXTransform3DRef proj, LXTransform3DRef mv, LXDrawContextActiveState *state)
+{
+    if ( !state) return;
+
+    LXTransform3DRef trs = (mv) ? LXTransform3DCopy(mv) : LXTransform3DCreateIdentity();
+    if (proj) LXTransform3DConcat(trs, proj);  // -> proj * mv
+
+    LX4x4Matrix m;
+    LXTransform3DGetMatrix(trs, &m);
+    LXTransform3DRelease(trs);
+
+    const LXFloat *mf = (const LXFloat *)&m;
+    int i;
+    for (i = 0; i < 16; i++) {
+        state->projModelviewMatrix[i] = (float)mf[i];
+    }
+}
+
+void LXTransform3DFinishForProjectionAndModelView_(LXTransform3DRef proj, LXTransform3DRef mv, LXDrawContextActiveState *state)
+{
+}
+
+// shader and textures are read from the draw context by the rasterizer, so there's no device state to set up
+void LXTextureArrayApply_(LXTextureArrayRef array, LXDrawContextActiveState *state)
+{
+}
+
+void LXShaderApplyWithConstants_(LXShaderRef shader, float *localParams, int paramCount, LXDrawContextActiveState *state)
+{
+}
+
+void LXShaderFinishCurrent_(LXDrawContextActiveState *state)
+{
+}
+
+void LXTextureArrayFinishCurrent_(LXDrawContextActiveState *state)
+{
+}
+
+void LXDrawContextApplyFixedFunctionBaseColorInsteadOfShader_(LXDrawContextRef drawCtx)
+{
+    // the rasterizer picks the base color itself based on the draw flags (see baseColorForDrawContext)
+}
+
+
+
+#pragma mark --- fixed function ---
+
+#define RAST_MAXTEXUNITS 8
+
+// fixed function texturing modulates the base color (in program.local[0]) with each enabled texture unit
+static LXShaderRef fixedFunctionShaderForTextureUnits(uint32_t unitMask, LXError *outError)
+{
+    static LXShaderRef s_shaders[1 << RAST_MAXTEXUNITS];
+    LXShaderRef shader;
+
+    LXMutexLock(g_lxAtomicLock);
+    shader = s_shaders[unitMask];
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if (shader)
+        return shader;
+
+    char prog[1024];
+    char *s = prog;
+    int i;
+    s += sprintf(s, "!!ARBfp1.0\nTEMP c, t;\nMOV c, program.local[0];\n");
+    for (i = 0; i < RAST_MAXTEXUNITS; i++) {
+        if ( !(unitMask & (1 << i))) continue;
+        s += sprintf(s, "TEX t, fragment.texcoord[%i], texture[%i], RECT;\nMUL c, c, t;\n", i, i);
+    }
+    s += sprintf(s, "MOV result.color, c;\nEND\n");
+
+    // not created as kLXStorageHint_Final because that caches by string pointer, and this string is on the stack
+    shader = LXShaderCreateWithString(prog, strlen(prog), kLXShaderFormat_OpenGLARBfp, 0, outError);
+    if ( !shader)
+        return NULL;
+
+    LXMutexLock(g_lxAtomicLock);
+    if (s_shaders[unitMask]) {
+        LXShaderRelease(shader);
+        shader = s_shaders[unitMask];
+    } else {
+        s_shaders[unitMask] = shader;
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+    return shader;
+}
+
+static void baseColorForDrawContext(LXDrawContextImpl *ctx, LXUInteger drawFlags, float *outColor)
+{
+    outColor[0] = outColor[1] = outColor[2] = outColor[3] = 1.0f;
+
+    // same as LXDrawContextApplyFixedFunctionBaseColorInsteadOfShader_() on OpenGL
+    if (drawFlags != 0 && ctx->shader) {
+        LXShaderGetParameter4fv(ctx->shader, 0, outColor);
+    }
+}
+
+
+
+#pragma mark --- primitive setup ---
+
+#define RAST_TILE_W     64
+#define RAST_TILE_H     64
+#define RAST_SUBPIXEL_BITS  8
+#define RAST_SUBPIXEL_ONE   (1 << RAST_SUBPIXEL_BITS)
+#define RAST_GUARDBAND  (1 << 20)    // in pixels; keeps the 64-bit edge functions from overflowing
+
+#define RAST_WIDTH      LXSHADERCPU_BATCHSIZE
+
+typedef struct {
+    float x, y, z, w;   // clip space
+    float u, v;
+} RasterVertex;
+
+typedef struct {
+    int32_t x[3], y[3];             // window coordinates in subpixels
+    float z[3];                     // window depth
+    float invW[3];
+    float uw[3], vw[3];             // texcoords divided by w, for perspective-correct interpolation
+    int32_t minX, minY, maxX, maxY; // pixel bounds, inclusive
+} RasterTriangle;
+
+typedef struct {
+    int32_t w, h;
+
+    RasterTriangle *tris;
+    LXInteger triCount;
+    LXInteger triCapacity;
+} RasterSetup;
+
+
+static void addTriangle(RasterSetup *setup, const float *win0, const float *win1, const float *win2)
+{
+    const float *win[3] = { win0, win1, win2 };
+    RasterTriangle tri;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        float x = MAX(-RAST_GUARDBAND, MIN(RAST_GUARDBAND, win[i][0]));
+        float y = MAX(-RAST_GUARDBAND, MIN(RAST_GUARDBAND, win[i][1]));
+        tri.x[i] = (int32_t)lrintf(x * RAST_SUBPIXEL_ONE);
+        tri.y[i] = (int32_t)lrintf(y * RAST_SUBPIXEL_ONE);
+        tri.z[i] = win[i][2];
+        tri.invW[i] = win[i][3];
+        tri.uw[i] = win[i][4];
+        tri.vw[i] = win[i][5];
+    }
+
+    int64_t area = (int64_t)(tri.x[2] - tri.x[1]) * (tri.y[0] - tri.y[1]) - (int64_t)(tri.y[2] - tri.y[1]) * (tri.x[0] - tri.x[1]);
+    if (area == 0)
+        return;
+
+    if (area < 0) {
+        // no culling, so wind every triangle counter-clockwise for the edge functions
+        #define SWAP12(a_, t_)  { t_ tmp_ = a_[1];  a_[1] = a_[2];  a_[2] = tmp_; }
+        SWAP12(tri.x, int32_t)
+        SWAP12(tri.y, int32_t)
+        SWAP12(tri.z, float)
+        SWAP12(tri.invW, float)
+        SWAP12(tri.uw, float)
+        SWAP12(tri.vw, float)
+        #undef SWAP12
+    }
+
+    // pixel centers are at +0.5, so a pixel is inside the bounds if its center can be
+    const int32_t half = RAST_SUBPIXEL_ONE / 2;
+    int32_t minX = MIN(tri.x[0], MIN(tri.x[1], tri.x[2]));
+    int32_t maxX = MAX(tri.x[0], MAX(tri.x[1], tri.x[2]));
+    int32_t minY = MIN(tri.y[0], MIN(tri.y[1], tri.y[2]));
+    int32_t maxY = MAX(tri.y[0], MAX(tri.y[1], tri.y[2]));
+
+    tri.minX = MAX(0,           (minX - half + RAST_SUBPIXEL_ONE - 1) >> RAST_SUBPIXEL_BITS);
+    tri.maxX = MIN(setup->w - 1, (maxX - half) >> RAST_SUBPIXEL_BITS);
+    tri.minY = MAX(0,           (minY - half + RAST_SUBPIXEL_ONE - 1) >> RAST_SUBPIXEL_BITS);
+    tri.maxY = MIN(setup->h - 1, (maxY - half) >> RAST_SUBPIXEL_BITS);
+
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+        return;
+
+    if (setup->triCount >= setup->triCapacity) {
+        setup->triCapacity = MAX(64, setup->triCapacity * 2);
+        setup->tris = _lx_realloc(setup->tris, setup->triCapacity * sizeof(RasterTriangle));
+    }
+    setup->tris[setup->triCount++] = tri;
+}
+
+// window vertex layout: x, y, z, 1/w, u/w, v/w
+static void windowVertex(const RasterSetup *setup, const RasterVertex *v, float *outWin)
+{
+    const float invW = 1.0f / v->w;
+    outWin[0] = (v->x * invW + 1.0f) * 0.5f * setup->w;
+    outWin[1] = (v->y * invW + 1.0f) * 0.5f * setup->h;
+    outWin[2] = (v->z * invW + 1.0f) * 0.5f;
+    outWin[3] = invW;
+    outWin[4] = v->u * invW;
+    outWin[5] = v->v * invW;
+}
+
+static void lerpVertex(const RasterVertex *a, const RasterVertex *b, float t, RasterVertex *out)
+{
+    out->x = a->x + (b->x - a->x) * t;
+    out->y = a->y + (b->y - a->y) * t;
+    out->z = a->z + (b->z - a->z) * t;
+    out->w = a->w + (b->w - a->w) * t;
+    out->u = a->u + (b->u - a->u) * t;
+    out->v = a->v + (b->v - a->v) * t;
+}
+
+// clips against the near and far planes (like OpenGL, primitives are not clipped at the sides; the rasterizer handles that)
+static void addClippedTriangle(RasterSetup *setup, const RasterVertex *v0, const RasterVertex *v1, const RasterVertex *v2)
+{
+    RasterVertex bufA[8], bufB[8];
+    RasterVertex *poly = bufA, *out = bufB;
+    int n = 3, plane, i;
+
+    poly[0] = *v0;  poly[1] = *v1;  poly[2] = *v2;
+
+    for (plane = 0; plane < 2; plane++) {
+        const float sign = (plane == 0) ? 1.0f : -1.0f;  // near: z + w >= 0, far: w - z >= 0
+        int outN = 0;
+
+        for (i = 0; i < n; i++) {
+            const RasterVertex *a = poly + i;
+            const RasterVertex *b = poly + (i + 1) % n;
+            const float da = a->w + sign * a->z;
+            const float db = b->w + sign * b->z;
+
+            if (da >= 0.0f)
+                out[outN++] = *a;
+
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                lerpVertex(a, b, da / (da - db), out + outN);
+                outN++;
+            }
+        }
+        n = outN;
+        if (n < 3) return;
+
+        RasterVertex *tmp = poly;  poly = out;  out = tmp;
+    }
+
+    float win[8][6];
+    for (i = 0; i < n; i++) {
+        if (poly[i].w <= 0.0f) return;  // degenerate projection
+        windowVertex(setup, poly + i, win[i]);
+    }
+    for (i = 1; i < n - 1; i++) {
+        addTriangle(setup, win[0], win[i], win[i + 1]);
+    }
+}
+
+// points and lines are rasterized as one pixel wide quads in window space
+static void addWindowQuad(RasterSetup *setup, const float *a, const float *b, float dx, float dy, float ex, float ey)
+{
+    float q[4][6];
+    int i;
+    for (i = 0; i < 6; i++) {
+        q[0][i] = a[i];  q[1][i] = b[i];  q[2][i] = b[i];  q[3][i] = a[i];
+    }
+    q[0][0] += -dx - ex;  q[0][1] += -dy - ey;
+    q[1][0] += -dx + ex;  q[1][1] += -dy + ey;
+    q[2][0] +=  dx + ex;  q[2][1] +=  dy + ey;
+    q[3][0] +=  dx - ex;  q[3][1] +=  dy - ey;
+
+    addTriangle(setup, q[0], q[1], q[2]);
+    addTriangle(setup, q[0], q[2], q[3]);
+}
+
+static void addPoint(RasterSetup *setup, const RasterVertex *v)
+{
+    if (v->w <= 0.0f) return;
+    float win[6];
+    windowVertex(setup, v, win);
+
+    addWindowQuad(setup, win, win, 0.0f, 0.5f, 0.5f, 0.0f);
+}
+
+static void addLine(RasterSetup *setup, const RasterVertex *v0, const RasterVertex *v1)
+{
+    if (v0->w <= 0.0f || v1->w <= 0.0f) return;
+    float a[6], b[6];
+    windowVertex(setup, v0, a);
+    windowVertex(setup, v1, b);
+
+    float dx = b[0] - a[0];
+    float dy = b[1] - a[1];
+    float len = sqrtf(dx*dx + dy*dy);
+    if (len < 1e-6f) {
+        addWindowQuad(setup, a, a, 0.0f, 0.5f, 0.5f, 0.0f);
+        return;
+    }
+    dx *= 0.5f / len;
+    dy *= 0.5f / len;
+
+    // half pixel outwards along the line and to both sides
+    addWindowQuad(setup, a, b, -dy, dx, dx, dy);
+}
+
+static LXBool transformVertices(void *vertices, LXUInteger first, LXUInteger end, LXVertexType vertexType, const float *m, RasterVertex *outVerts)
+{
+    LXUInteger i;
+    for (i = first; i < end; i++) {
+        float x, y, z = 0.0f, w = 1.0f, u = 0.0f, v = 0.0f;
+
+        switch (vertexType) {
+            case kLXVertex_XYUV: {
+                LXVertexXYUV *vp = ((LXVertexXYUV *)vertices) + i;
+                x = vp->x;  y = vp->y;  u = vp->u;  v = vp->v;
+                break;
+            }
+            case kLXVertex_XYZW: {
+                LXVertexXYZW *vp = ((LXVertexXYZW *)vertices) + i;
+                x = vp->x;  y = vp->y;  z = vp->z;  w = vp->w;
+                break;
+            }
+            case kLXVertex_XYZWUV: {
+                LXVertexXYZWUV *vp = ((LXVertexXYZWUV *)vertices) + i;
+                x = vp->x;  y = vp->y;  z = vp->z;  w = vp->w;  u = vp->u;  v = vp->v;
+                break;
+            }
+            default:
+                return NO;
+        }
+
+        RasterVertex *ov = outVerts + i;
+        ov->x = m[0]*x  + m[1]*y  + m[2]*z  + m[3]*w;
+        ov->y = m[4]*x  + m[5]*y  + m[6]*z  + m[7]*w;
+        ov->z = m[8]*x  + m[9]*y  + m[10]*z + m[11]*w;
+        ov->w = m[12]*x + m[13]*y + m[14]*z + m[15]*w;
+        ov->u = u;
+        ov->v = v;
+    }
+    return YES;
+}
+
+static LXInteger primitiveCountForType(LXPrimitiveType primitiveType, LXUInteger vertexCount)
+{
+    switch (primitiveType) {
+        case kLXQuads:          return vertexCount / 4;
+        case kLXPoints:         return vertexCount;
+        case kLXLineStrip:      return (vertexCount > 1) ? vertexCount - 1 : 0;
+        case kLXLineLoop:       return (vertexCount > 2) ? vertexCount : ((vertexCount > 1) ? 1 : 0);
+        default:
+        case kLXTriangleFan:
+        case kLXTriangleStrip:  return (vertexCount > 2) ? vertexCount - 2 : 0;
+    }
+}
+
+// sets up primitives [firstPrim, endPrim) in draw order; the vertices must have been transformed already
+static void assemblePrimitives(RasterSetup *setup, LXPrimitiveType primitiveType, const RasterVertex *v, LXUInteger vertexCount,
+                               LXInteger firstPrim, LXInteger endPrim)
+{
+    LXInteger p;
+    for (p = firstPrim; p < endPrim; p++) {
+        switch (primitiveType) {
+            case kLXQuads: {
+                const RasterVertex *q = v + p * 4;
+                addClippedTriangle(setup, q, q + 1, q + 2);
+                addClippedTriangle(setup, q, q + 2, q + 3);
+                break;
+            }
+            default:
+            case kLXTriangleFan:
+                addClippedTriangle(setup, v, v + p + 1, v + p + 2);
+                break;
+
+            case kLXTriangleStrip:
+                if (p & 1)
+                    addClippedTriangle(setup, v + p + 1, v + p, v + p + 2);
+                else
+                    addClippedTriangle(setup, v + p, v + p + 1, v + p + 2);
+                break;
+
+            case kLXPoints:
+                addPoint(setup, v + p);
+                break;
+
+            case kLXLineStrip:
+            case kLXLineLoop:
+                if ((LXUInteger)p + 1 < vertexCount)
+                    addLine(setup, v + p, v + p + 1);
+                else
+                    addLine(setup, v + vertexCount - 1, v);  // closes the loop
+                break;
+        }
+    }
+}
+
+
+
+#pragma mark --- binning ---
+
+/*
+ the front end splits the primitives into chunks that are set up in parallel.
+ each chunk bins its triangles by tile; a tile then draws the bins of all chunks in chunk order,
+ which keeps the draw order of the original primitives.
+*/
+
+#define RAST_VERTICES_PER_BLOCK  4096
+#define RAST_MIN_PRIMS_PER_CHUNK 256
+
+typedef struct {
+    RasterSetup setup;
+
+    uint32_t *binStart;     // per tile offsets into binTris (tileCount + 1 entries)
+    uint32_t *binTris;      // triangle indices grouped by tile, in draw order
+} RasterChunk;
+
+typedef struct {
+    void *vertices;
+    LXUInteger vertexCount;
+    LXVertexType vertexType;
+    LXPrimitiveType primitiveType;
+    const float *matrix;
+
+    RasterVertex *verts;
+    LXInteger primCount;
+
+    int32_t w, h;
+    int32_t tilesPerRow;
+    LXInteger tileCount;
+
+    LXInteger chunkCount;
+    RasterChunk *chunks;
+} RasterFrontEnd;
+
+
+// conservative test against the pixel centers of a tile, so that long thin triangles aren't binned into every tile they pass by
+static LXBool triangleMayCoverTile(const RasterTriangle *tri, int32_t tx, int32_t ty)
+{
+    const int64_t half = RAST_SUBPIXEL_ONE / 2;
+    const int64_t minX = ((int64_t)tx * RAST_TILE_W << RAST_SUBPIXEL_BITS) + half;
+    const int64_t minY = ((int64_t)ty * RAST_TILE_H << RAST_SUBPIXEL_BITS) + half;
+    const int64_t maxX = minX + ((int64_t)(RAST_TILE_W - 1) << RAST_SUBPIXEL_BITS);
+    const int64_t maxY = minY + ((int64_t)(RAST_TILE_H - 1) << RAST_SUBPIXEL_BITS);
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        const int a = (k + 1) % 3,  b = (k + 2) % 3;
+        const int64_t dx = tri->x[b] - tri->x[a];
+        const int64_t dy = tri->y[b] - tri->y[a];
+
+        // the tile corner where the edge function is largest
+        const int64_t px = (dy > 0) ? minX : maxX;
+        const int64_t py = (dx > 0) ? maxY : minY;
+
+        if (dx * (py - tri->y[a]) - dy * (px - tri->x[a]) < 0)
+            return NO;
+    }
+    return YES;
+}
+
+// runs "body_" for each tile that the triangle may cover
+#define FOREACH_TILE_OF_TRIANGLE(tri_, tilesPerRow_, tileIndexVar_, body_)  { \
+        const int32_t tx0_ = (tri_)->minX / RAST_TILE_W,  tx1_ = (tri_)->maxX / RAST_TILE_W; \
+        const int32_t ty0_ = (tri_)->minY / RAST_TILE_H,  ty1_ = (tri_)->maxY / RAST_TILE_H; \
+        const LXBool needsTest_ = (tx1_ > tx0_ && ty1_ > ty0_); \
+        int32_t tx_, ty_; \
+        for (ty_ = ty0_; ty_ <= ty1_; ty_++) { \
+            for (tx_ = tx0_; tx_ <= tx1_; tx_++) { \
+                if (needsTest_ && !triangleMayCoverTile((tri_), tx_, ty_)) continue; \
+                const LXInteger tileIndexVar_ = (LXInteger)ty_ * (tilesPerRow_) + tx_; \
+                body_ \
+            } \
+        } \
+    }
+
+static void binChunk(RasterChunk *chunk, LXInteger tileCount, int32_t tilesPerRow)
+{
+    const RasterSetup *setup = &chunk->setup;
+    uint32_t *binStart = _lx_calloc(tileCount + 1, sizeof(uint32_t));
+    LXInteger i, t;
+
+    for (i = 0; i < setup->triCount; i++) {
+        FOREACH_TILE_OF_TRIANGLE(setup->tris + i, tilesPerRow, tileIndex, {
+            binStart[tileIndex + 1]++;
+        })
+    }
+    for (t = 0; t < tileCount; t++) {
+        binStart[t + 1] += binStart[t];
+    }
+
+    uint32_t *binTris = _lx_malloc(MAX(1, binStart[tileCount]) * sizeof(uint32_t));
+    uint32_t *binFill = _lx_malloc(tileCount * sizeof(uint32_t));
+    memcpy(binFill, binStart, tileCount * sizeof(uint32_t));
+
+    for (i = 0; i < setup->triCount; i++) {
+        FOREACH_TILE_OF_TRIANGLE(setup->tris + i, tilesPerRow, tileIndex, {
+            binTris[binFill[tileIndex]++] = (uint32_t)i;
+        })
+    }
+    _lx_free(binFill);
+
+    chunk->binStart = binStart;
+    chunk->binTris = binTris;
+}
+
+static void transformVertexBlock(void *userData, LXInteger workerIndex, LXInteger blockIndex)
+{
+    RasterFrontEnd *fe = (RasterFrontEnd *)userData;
+    const LXUInteger first = blockIndex * RAST_VERTICES_PER_BLOCK;
+    const LXUInteger end = MIN(fe->vertexCount, first + RAST_VERTICES_PER_BLOCK);
+
+    transformVertices(fe->vertices, first, end, fe->vertexType, fe->matrix, fe->verts);
+}
+
+static void setupChunk(void *userData, LXInteger workerIndex, LXInteger chunkIndex)
+{
+    RasterFrontEnd *fe = (RasterFrontEnd *)userData;
+    RasterChunk *chunk = fe->chunks + chunkIndex;
+    const LXInteger firstPrim = (fe->primCount * chunkIndex) / fe->chunkCount;
+    const LXInteger endPrim = (fe->primCount * (chunkIndex + 1)) / fe->chunkCount;
+
+    chunk->setup.w = fe->w;
+    chunk->setup.h = fe->h;
+    assemblePrimitives(&chunk->setup, fe->primitiveType, fe->verts, fe->vertexCount, firstPrim, endPrim);
+
+    binChunk(chunk, fe->tileCount, fe->tilesPerRow);
+}
+
+static void destroyFrontEnd(RasterFrontEnd *fe)
+{
+    LXInteger i;
+    for (i = 0; i < fe->chunkCount; i++) {
+        _lx_free(fe->chunks[i].setup.tris);
+        _lx_free(fe->chunks[i].binStart);
+        _lx_free(fe->chunks[i].binTris);
+    }
+    _lx_free(fe->chunks);
+    _lx_free(fe->verts);
+}
+
+
+
+#pragma mark --- tile rendering ---
+
+enum {
+    kRasterBlend_None = 0,
+    kRasterBlend_Premult,
+    kRasterBlend_Unpremult,
+    kRasterBlend_SrcAlpha
+};
+
+typedef struct {
+    LXShaderCPUFragmentBatch batch;
+    float *tileBuf;
+} RasterWorker;
+
+typedef struct {
+    const RasterFrontEnd *frontEnd;
+
+    void *evaluator;
+    uint32_t usedTexCoords;
+    float texCoordScale[RAST_MAXTEXUNITS][2];   // normalized uv -> texcoord; zero for units that get no texcoords
+    LXInteger blendMode;
+    LXBool clampSource;
+
+    uint8_t *dstData;
+    size_t dstRowBytes;
+    LXPixelFormat dstPxFormat;
+    size_t dstBytesPerPixel;
+
+    RasterWorker workers[kLXParallelMaxWorkers];
+    volatile int failed;
+} RasterJob;
+
+// the tile being drawn by a worker, and the fragments waiting to be shaded
+typedef struct {
+    RasterJob *job;
+    RasterWorker *worker;
+    LXInteger workerIndex;
+
+    float *tile;
+    size_t tileRowFloats;
+    int32_t tileX0, tileY0;
+
+    const RasterTriangle *tri;
+    float rcpArea;
+    int32_t laneX[RAST_WIDTH], laneY[RAST_WIDTH];
+    float bary[3][RAST_WIDTH];
+    int laneCount;
+} RasterTileState;
+
+
+static void shadeAndBlend(RasterTileState *ts)
+{
+    RasterJob *job = ts->job;
+    const RasterTriangle *tri = ts->tri;
+    LXShaderCPUFragmentBatch *batch = &ts->worker->batch;
+    const int laneCount = ts->laneCount;
+    float u[RAST_WIDTH], v[RAST_WIDTH];
+    int j, i;
+
+    ts->laneCount = 0;
+
+    // unused lanes repeat the last fragment so they always sample valid coordinates
+    for (j = 0; j < RAST_WIDTH; j++) {
+        const int k = MIN(j, laneCount - 1);
+        const float b0 = ts->bary[0][k], b1 = ts->bary[1][k], b2 = ts->bary[2][k];
+        const float q = 1.0f / (b0 * tri->invW[0] + b1 * tri->invW[1] + b2 * tri->invW[2]);
+
+        u[j] = (b0 * tri->uw[0] + b1 * tri->uw[1] + b2 * tri->uw[2]) * q;
+        v[j] = (b0 * tri->vw[0] + b1 * tri->vw[1] + b2 * tri->vw[2]) * q;
+
+        batch->position[0][j] = (float)ts->laneX[k] + 0.5f;
+        batch->position[1][j] = (float)ts->laneY[k] + 0.5f;
+        batch->position[2][j] = b0 * tri->z[0] + b1 * tri->z[1] + b2 * tri->z[2];
+    }
+    for (i = 0; i < RAST_MAXTEXUNITS; i++) {
+        if ( !(job->usedTexCoords & (1 << i))) continue;
+        const float sx = job->texCoordScale[i][0];
+        const float sy = job->texCoordScale[i][1];
+        for (j = 0; j < RAST_WIDTH; j++) {
+            batch->texCoord[i][0][j] = u[j] * sx;
+            batch->texCoord[i][1][j] = v[j] * sy;
+        }
+    }
+
+    if ( !_LXShaderCPUEvaluatorRun(job->evaluator, ts->workerIndex, batch)) {
+        job->failed = 1;
+        return;
+    }
+
+    for (j = 0; j < laneCount; j++) {
+        if (batch->killed[j]) continue;
+
+        float *d = ts->tile + (ts->laneY[j] - ts->tileY0) * ts->tileRowFloats + (ts->laneX[j] - ts->tileX0) * 4;
+        float s[4] = { batch->color[0][j], batch->color[1][j], batch->color[2][j], batch->color[3][j] };
+
+        if (job->clampSource) {
+            for (i = 0; i < 4; i++) s[i] = MAX(0.0f, MIN(1.0f, s[i]));
+        }
+
+        switch (job->blendMode) {
+            default:
+            case kRasterBlend_None:
+                d[0] = s[0];  d[1] = s[1];  d[2] = s[2];  d[3] = s[3];
+                break;
+
+            case kRasterBlend_Premult: {   // ONE, ONE_MINUS_SRC_ALPHA
+                const float ia = 1.0f - s[3];
+                for (i = 0; i < 4; i++) d[i] = s[i] + d[i] * ia;
+                break;
+            }
+            case kRasterBlend_Unpremult: {  // SRC_ALPHA, ONE_MINUS_SRC_ALPHA for color;  SRC_ALPHA, ONE for alpha
+                const float sa = s[3], ia = 1.0f - s[3];
+                for (i = 0; i < 3; i++) d[i] = s[i] * sa + d[i] * ia;
+                d[3] = sa * sa + d[3];
+                break;
+            }
+            case kRasterBlend_SrcAlpha: {   // SRC_ALPHA, ONE_MINUS_SRC_ALPHA
+                const float sa = s[3], ia = 1.0f - s[3];
+                for (i = 0; i < 4; i++) d[i] = s[i] * sa + d[i] * ia;
+                break;
+            }
+        }
+    }
+}
+
+// "e" are the unbiased edge function values at the pixel center
+LXINLINE void pushFragment(RasterTileState *ts, int32_t x, int32_t y, int64_t e0, int64_t e1, int64_t e2)
+{
+    const int n = ts->laneCount;
+    ts->laneX[n] = x;
+    ts->laneY[n] = y;
+    ts->bary[0][n] = (float)e0 * ts->rcpArea;
+    ts->bary[1][n] = (float)e1 * ts->rcpArea;
+    ts->bary[2][n] = (float)e2 * ts->rcpArea;
+
+    if (++ts->laneCount == RAST_WIDTH)
+        shadeAndBlend(ts);
+}
+
+static void rasterizeTriangleInTile(RasterTileState *ts, const RasterTriangle *tri, int32_t tileW, int32_t tileH)
+{
+    const int32_t bx0 = MAX(tri->minX, ts->tileX0);
+    const int32_t bx1 = MIN(tri->maxX, ts->tileX0 + tileW - 1);
+    const int32_t by0 = MAX(tri->minY, ts->tileY0);
+    const int32_t by1 = MIN(tri->maxY, ts->tileY0 + tileH - 1);
+    if (bx0 > bx1 || by0 > by1)
+        return;
+
+    // edge functions with the fill rule bias added, so that a pixel is inside when all three are >= 0
+    int64_t e[3], stepX[3], stepY[3], bias[3];
+    int k;
+
+    // edge k is opposite vertex k; its function is positive inside the triangle
+    const int32_t px = (bx0 << RAST_SUBPIXEL_BITS) + RAST_SUBPIXEL_ONE / 2;
+    const int32_t py = (by0 << RAST_SUBPIXEL_BITS) + RAST_SUBPIXEL_ONE / 2;
+    for (k = 0; k < 3; k++) {
+        const int a = (k + 1) % 3,  b = (k + 2) % 3;
+        const int64_t dx = tri->x[b] - tri->x[a];
+        const int64_t dy = tri->y[b] - tri->y[a];
+
+        // top-left fill rule, so that pixels on a shared edge are drawn exactly once
+        const LXBool isTopLeft = (dy < 0 || (dy == 0 && dx < 0));
+        bias[k] = (isTopLeft) ? 0 : -1;
+
+        e[k] = dx * (py - tri->y[a]) - dy * (px - tri->x[a]) + bias[k];
+        stepX[k] = -dy * RAST_SUBPIXEL_ONE;
+        stepY[k] = dx * RAST_SUBPIXEL_ONE;
+    }
+    // twice the triangle area in the same units as the edge functions
+    const int64_t area2 = (int64_t)(tri->x[2] - tri->x[1]) * (tri->y[0] - tri->y[1]) - (int64_t)(tri->y[2] - tri->y[1]) * (tri->x[0] - tri->x[1]);
+
+    ts->tri = tri;
+    ts->rcpArea = 1.0f / (float)area2;
+    ts->laneCount = 0;
+
+    int32_t x, y;
+
+    for (y = by0; y <= by1; y++) {
+        int64_t e0 = e[0], e1 = e[1], e2 = e[2];
+        x = bx0;
+
+#if defined(__SSE2__)
+        // four pixels at a time; the 64-bit edge functions take two registers per edge
+        if (bx1 - bx0 >= 3) {
+            const __m128i step4_0 = _mm_set1_epi64x(stepX[0] * 4);
+            const __m128i step4_1 = _mm_set1_epi64x(stepX[1] * 4);
+            const __m128i step4_2 = _mm_set1_epi64x(stepX[2] * 4);
+            __m128i lo0 = _mm_set_epi64x(e0 + stepX[0],   e0),  hi0 = _mm_set_epi64x(e0 + stepX[0]*3, e0 + stepX[0]*2);
+            __m128i lo1 = _mm_set_epi64x(e1 + stepX[1],   e1),  hi1 = _mm_set_epi64x(e1 + stepX[1]*3, e1 + stepX[1]*2);
+            __m128i lo2 = _mm_set_epi64x(e2 + stepX[2],   e2),  hi2 = _mm_set_epi64x(e2 + stepX[2]*3, e2 + stepX[2]*2);
+
+            for (; x + 3 <= bx1; x += 4) {
+                // sign bit is set in a lane if any of its edge functions is negative
+                const int outside = _mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(_mm_or_si128(lo0, lo1), lo2)))
+                                 | (_mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(_mm_or_si128(hi0, hi1), hi2))) << 2);
+
+                if (outside != 0xf) {
+                    int64_t ev[3][4];
+                    _mm_storeu_si128((__m128i *)(ev[0]), lo0);  _mm_storeu_si128((__m128i *)(ev[0] + 2), hi0);
+                    _mm_storeu_si128((__m128i *)(ev[1]), lo1);  _mm_storeu_si128((__m128i *)(ev[1] + 2), hi1);
+                    _mm_storeu_si128((__m128i *)(ev[2]), lo2);  _mm_storeu_si128((__m128i *)(ev[2] + 2), hi2);
+                    int j;
+                    for (j = 0; j < 4; j++) {
+                        if ( !(outside & (1 << j)))
+                            pushFragment(ts, x + j, y, ev[0][j] - bias[0], ev[1][j] - bias[1], ev[2][j] - bias[2]);
+                    }
+                }
+                lo0 = _mm_add_epi64(lo0, step4_0);  hi0 = _mm_add_epi64(hi0, step4_0);
+                lo1 = _mm_add_epi64(lo1, step4_1);  hi1 = _mm_add_epi64(hi1, step4_1);
+                lo2 = _mm_add_epi64(lo2, step4_2);  hi2 = _mm_add_epi64(hi2, step4_2);
+            }
+            e0 += stepX[0] * (x - bx0);
+            e1 += stepX[1] * (x - bx0);
+            e2 += stepX[2] * (x - bx0);
+        }
+#endif
+
+        for (; x <= bx1; x++) {
+            if ((e0 | e1 | e2) >= 0) {
+                pushFragment(ts, x, y, e0 - bias[0], e1 - bias[1], e2 - bias[2]);
+            }
+            e0 += stepX[0];  e1 += stepX[1];  e2 += stepX[2];
+        }
+        for (k = 0; k < 3; k++) e[k] += stepY[k];
+    }
+    if (ts->laneCount > 0) {
+        shadeAndBlend(ts);
+    }
+}
+
+static void rasterizeTile(void *userData, LXInteger workerIndex, LXInteger tileIndex)
+{
+    RasterJob *job = (RasterJob *)userData;
+    const RasterFrontEnd *fe = job->frontEnd;
+    LXInteger c, i;
+
+    if (job->failed) return;
+
+    LXBool hasTris = NO;
+    for (c = 0; c < fe->chunkCount && !hasTris; c++) {
+        hasTris = (fe->chunks[c].binStart[tileIndex + 1] > fe->chunks[c].binStart[tileIndex]);
+    }
+    if ( !hasTris)
+        return;
+
+    RasterTileState ts;
+    ts.job = job;
+    ts.worker = job->workers + workerIndex;
+    ts.workerIndex = workerIndex;
+    ts.tileX0 = (int32_t)(tileIndex % fe->tilesPerRow) * RAST_TILE_W;
+    ts.tileY0 = (int32_t)(tileIndex / fe->tilesPerRow) * RAST_TILE_H;
+    ts.laneCount = 0;
+
+    const int32_t tileW = MIN(RAST_TILE_W, fe->w - ts.tileX0);
+    const int32_t tileH = MIN(RAST_TILE_H, fe->h - ts.tileY0);
+
+    uint8_t *dstTile = job->dstData + ts.tileY0 * job->dstRowBytes + ts.tileX0 * job->dstBytesPerPixel;
+    const LXBool isDirect = (job->dstPxFormat == kLX_RGBA_FLOAT32);
+
+    if (isDirect) {
+        ts.tile = (float *)dstTile;
+        ts.tileRowFloats = job->dstRowBytes / sizeof(float);
+    } else {
+        if ( !ts.worker->tileBuf) {
+            ts.worker->tileBuf = _lx_malloc(RAST_TILE_W * RAST_TILE_H * 4 * sizeof(float));
+        }
+        ts.tile = ts.worker->tileBuf;
+        ts.tileRowFloats = tileW * 4;
+
+        if ( !LXPxConvert_Any_(dstTile, tileW, tileH, job->dstRowBytes, job->dstPxFormat,
+                               (uint8_t *)ts.tile, tileW, tileH, ts.tileRowFloats * sizeof(float), kLX_RGBA_FLOAT32,
+                               0, 0, 0, 0, NULL)) {
+            job->failed = 1;
+            return;
+        }
+    }
+
+    for (c = 0; c < fe->chunkCount && !job->failed; c++) {
+        const RasterChunk *chunk = fe->chunks + c;
+        const uint32_t binEnd = chunk->binStart[tileIndex + 1];
+
+        for (i = chunk->binStart[tileIndex]; i < binEnd && !job->failed; i++) {
+            rasterizeTriangleInTile(&ts, chunk->setup.tris + chunk->binTris[i], tileW, tileH);
+        }
+    }
+
+    if ( !isDirect) {
+        if ( !LXPxConvert_Any_((uint8_t *)ts.tile, tileW, tileH, ts.tileRowFloats * sizeof(float), kLX_RGBA_FLOAT32,
+                               dstTile, tileW, tileH, job->dstRowBytes, job->dstPxFormat,
+                               0, 0, 0, 0, NULL)) {
+            job->failed = 1;
+        }
+    }
+}
+
+
+
+#pragma mark --- composite quads ---
+
+#define RAST_COMPOSITE_TOLERANCE  (1.0f / 1024.0f)   // in pixels
+
+LXINLINE LXBool nearInteger(float f, int32_t *outI)
+{
+    if ( !(fabsf(f) < RAST_GUARDBAND)) return NO;
+    *outI = (int32_t)lrintf(f);
+    return (fabsf(f - (float)*outI) <= RAST_COMPOSITE_TOLERANCE);
+}
+
+static LXPixelBufferRef compositeSourceAt(LXTextureArrayRef texArray, LXInteger index)
+{
+    LXPixelBufferRef pixbuf = LXTextureArrayPixelBufferAt(texArray, index);
+    LXTextureRef texture = (pixbuf) ? NULL : LXTextureArrayAt(texArray, index);
+    if (texture) {
+        pixbuf = (LXPixelBufferRef) LXTextureLockPlatformNativeObj(texture);
+        LXTextureUnlockPlatformNativeObj(texture);
+    }
+    return pixbuf;
+}
+
+/*
+ layer compositing draws a quad with one of the LXShaderUtils composite shaders for each layer.
+ when the quad covers whole pixels and every texture's texels line up 1:1 with them, sampling can't change any values,
+ so the operation is done directly on the pixel buffers by LXShaderUtils_composite.c instead of being rasterized.
+ returns NO if the draw doesn't qualify.
+*/
+static LXBool drawCompositeQuad(LXPixelBufferRef dstPixbuf, LXPrimitiveType primitiveType, void *vertices, LXUInteger vertexCount,
+                                LXVertexType vertexType, LXShaderRef shader, LXTextureArrayRef texArray, const float *matrix)
+{
+    const LXCompositeOp op = LXCompositeOpForShader(shader);
+    if (op == kLXCompositeOp_None || vertexCount != 4 || vertexType != kLXVertex_XYUV
+            || (primitiveType != kLXQuads && primitiveType != kLXTriangleFan))
+        return NO;
+
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(dstPixbuf);
+    const LXInteger srcCount = LXCompositeOpGetSourceCount(op);
+    RasterSetup setup;
+    RasterVertex cv[4];
+    float win[4][6];
+    int32_t px[4], py[4];
+    LXInteger i, s;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.w = LXPixelBufferGetWidth(dstPixbuf);
+    setup.h = LXPixelBufferGetHeight(dstPixbuf);
+
+    transformVertices(vertices, 0, 4, vertexType, matrix, cv);
+
+    // the corners must be at pixel edges and go around an axis-aligned rectangle, without perspective
+    for (i = 0; i < 4; i++) {
+        if ( !(cv[i].w > 0.0f) || cv[i].w != cv[0].w)
+            return NO;
+        windowVertex(&setup, cv + i, win[i]);
+        if ( !nearInteger(win[i][0], px + i) || !nearInteger(win[i][1], py + i))
+            return NO;
+    }
+    for (i = 0; i < 4; i++) {
+        // edges alternate between horizontal and vertical
+        const LXInteger j = (i + 1) % 4;
+        const LXBool isHorizontal = ((i & 1) == 0) == (py[0] == py[1]);
+        if (isHorizontal ? (py[i] != py[j] || px[i] == px[j]) : (px[i] != px[j] || py[i] == py[j]))
+            return NO;
+    }
+    const int32_t x0 = MAX(0, MIN(px[0], px[2])),  x1 = MIN(setup.w, MAX(px[0], px[2]));
+    const int32_t y0 = MAX(0, MIN(py[0], py[2])),  y1 = MIN(setup.h, MAX(py[0], py[2]));
+    if (x0 >= x1 || y0 >= y1)
+        return NO;
+
+    // each texture must have the destination's pixel format, and texcoords must equal the pixel position plus a whole-texel offset
+    LXPixelBufferRef srcPixbufs[3];
+    int32_t offsetX[3], offsetY[3];
+
+    for (s = 0; s < srcCount; s++) {
+        LXPixelBufferRef pixbuf = compositeSourceAt(texArray, s);
+        if ( !pixbuf || LXPixelBufferGetPixelFormat(pixbuf) != pxFormat)
+            return NO;
+
+        const int32_t texW = LXPixelBufferGetWidth(pixbuf);
+        const int32_t texH = LXPixelBufferGetHeight(pixbuf);
+
+        for (i = 0; i < 4; i++) {
+            int32_t ox, oy;
+            if ( !nearInteger(cv[i].u * texW - win[i][0], &ox) || !nearInteger(cv[i].v * texH - win[i][1], &oy))
+                return NO;
+            if (i == 0) {
+                offsetX[s] = ox;
+                offsetY[s] = oy;
+            } else if (ox != offsetX[s] || oy != offsetY[s]) {
+                return NO;
+            }
+        }
+        if (x0 + offsetX[s] < 0 || x1 + offsetX[s] > texW || y0 + offsetY[s] < 0 || y1 + offsetY[s] > texH)
+            return NO;
+
+        // a source that is also the destination is only safe to read in place at the same pixel
+        if (pixbuf == dstPixbuf && (offsetX[s] != 0 || offsetY[s] != 0))
+            return NO;
+
+        srcPixbufs[s] = pixbuf;
+    }
+
+    float param[4];
+    LXShaderGetParameter4fv(shader, 0, param);
+
+    const size_t bytesPerPixel = LXBytesPerPixelForPixelFormat(pxFormat);
+    const uint8_t *srcData[3];
+    size_t srcRowBytes[3], dstRowBytes = 0;
+    LXInteger lockedCount = 0;
+    LXBool didDraw = NO;
+
+    uint8_t *dstData = LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, NULL, NULL);
+    if ( !dstData)
+        return NO;
+
+    for (s = 0; s < srcCount; s++) {
+        const uint8_t *data = LXPixelBufferLockPixels(srcPixbufs[s], &srcRowBytes[s], NULL, NULL);
+        if ( !data) break;
+        srcData[s] = data + (y0 + offsetY[s]) * srcRowBytes[s] + (x0 + offsetX[s]) * bytesPerPixel;
+        lockedCount++;
+    }
+    if (lockedCount == srcCount) {
+        didDraw = _LXCompositeRegion(op, pxFormat, x1 - x0, y1 - y0, dstData + y0 * dstRowBytes + x0 * bytesPerPixel, dstRowBytes,
+                                     srcData, srcRowBytes, param);
+    }
+
+    for (s = 0; s < lockedCount; s++) {
+        LXPixelBufferUnlockPixels(srcPixbufs[s]);
+    }
+    LXPixelBufferUnlockPixels(dstPixbuf);
+    return didDraw;
+}
+
+
+
+#pragma mark --- entry point ---
+
+LXSuccess LXDrawCPURenderPrimitive_(LXPixelBufferRef dstPixbuf,
+                                    LXPrimitiveType primitiveType,
+                                    void *vertices,
+                                    LXUInteger vertexCount,
+                                    LXVertexType vertexType,
+                                    LXDrawContextRef drawCtx,
+                                    LXDrawContextActiveState *state,
+                                    LXError *outError)
+{
+    LXDrawContextImpl *ctx = (LXDrawContextImpl *)drawCtx;
+    if ( !dstPixbuf || !vertices || vertexCount < 1 || !ctx || !state)
+        return NO;
+
+    if (vertexType != kLXVertex_XYUV && vertexType != kLXVertex_XYZW && vertexType != kLXVertex_XYZWUV) {
+        char msg[128];
+        sprintf(msg, "unsupported vertex type (%i)", (int)vertexType);
+        LXErrorSet(outError, 4810, msg);
+        return NO;
+    }
+
+    const LXUInteger drawFlags = ctx->flags;
+    LXTextureArrayRef texArray = ctx->texArray;
+    uint32_t texMask = 0;
+    LXInteger i;
+
+    for (i = 0; i < RAST_MAXTEXUNITS; i++) {
+        if (LXTextureArrayAt(texArray, i)) texMask |= (1 << i);
+    }
+
+    // the fixed-function flags take the base color from the shader instead of running it, as on OpenGL
+    const LXBool useFixedFunction = (ctx->shader == NULL || ((LXShaderImpl *)ctx->shader)->programStr == NULL
+                                     || (drawFlags & (kLXDrawFlag_UseFixedFunctionBlending_SourceIsPremult |
+                                                      kLXDrawFlag_UseFixedFunctionBlending_SourceIsUnpremult |
+                                                      kLXDrawFlag_UseHardwareFragmentAntialiasing)));
+    LXShaderRef shader;
+    float ffParams[LXSHADERPARAMCOUNT * 4];
+
+    if (useFixedFunction) {
+        if ( !(shader = fixedFunctionShaderForTextureUnits(texMask, outError)))
+            return NO;
+
+        memset(ffParams, 0, sizeof(ffParams));
+        baseColorForDrawContext(ctx, drawFlags, ffParams);
+    } else {
+        shader = ctx->shader;
+
+        if (drawCompositeQuad(dstPixbuf, primitiveType, vertices, vertexCount, vertexType, shader, texArray, state->projModelviewMatrix))
+            return YES;
+    }
+
+    RasterFrontEnd fe;
+    memset(&fe, 0, sizeof(fe));
+    fe.vertices = vertices;
+    fe.vertexCount = vertexCount;
+    fe.vertexType = vertexType;
+    fe.primitiveType = primitiveType;
+    fe.matrix = state->projModelviewMatrix;
+    fe.primCount = primitiveCountForType(primitiveType, vertexCount);
+    fe.w = LXPixelBufferGetWidth(dstPixbuf);
+    fe.h = LXPixelBufferGetHeight(dstPixbuf);
+    fe.tilesPerRow = (fe.w + RAST_TILE_W - 1) / RAST_TILE_W;
+    fe.tileCount = fe.tilesPerRow * ((fe.h + RAST_TILE_H - 1) / RAST_TILE_H);
+
+    if (fe.primCount < 1 || fe.tileCount < 1)
+        return YES;
+
+    // front end: transform, then set up and bin chunks of primitives
+    fe.verts = _lx_malloc(vertexCount * sizeof(RasterVertex));
+    LXParallelApply((vertexCount + RAST_VERTICES_PER_BLOCK - 1) / RAST_VERTICES_PER_BLOCK, 0, transformVertexBlock, &fe);
+
+    fe.chunkCount = MIN((fe.primCount + RAST_MIN_PRIMS_PER_CHUNK - 1) / RAST_MIN_PRIMS_PER_CHUNK, LXParallelGetWorkerCount() * 4);
+    fe.chunks = _lx_calloc(fe.chunkCount, sizeof(RasterChunk));
+    LXParallelApply(fe.chunkCount, 0, setupChunk, &fe);
+
+    RasterJob *job = _lx_calloc(1, sizeof(RasterJob));
+    LXSuccess success = NO;
+
+    job->frontEnd = &fe;
+    job->evaluator = _LXShaderCPUEvaluatorCreate(shader, (useFixedFunction) ? ffParams : NULL, texArray, dstPixbuf, outError);
+    if ( !job->evaluator)
+        goto bail;
+
+    job->usedTexCoords = _LXShaderCPUEvaluatorGetUsedTexCoords(job->evaluator);
+
+    // Lacefx texcoords are normalized, but shaders see RECT texcoords (see setGLTexCoords() in LXSurface_macgl.m)
+    for (i = 0; i < RAST_MAXTEXUNITS; i++) {
+        if (texMask & (1 << i)) {
+            LXSize texSize = LXTextureGetSize(LXTextureArrayAt(texArray, i));
+            job->texCoordScale[i][0] = texSize.w;
+            job->texCoordScale[i][1] = texSize.h;
+        }
+        else if ((texMask == 0 && i == 0) || (i == 7 && (texMask == 0 || (drawFlags & kLXDrawFlag_private1_)))) {
+            job->texCoordScale[i][0] = 1.0f;
+            job->texCoordScale[i][1] = 1.0f;
+        }
+    }
+
+    if (drawFlags & kLXDrawFlag_UseHardwareFragmentAntialiasing)
+        job->blendMode = kRasterBlend_SrcAlpha;
+    else if (drawFlags & kLXDrawFlag_UseFixedFunctionBlending_SourceIsPremult)
+        job->blendMode = kRasterBlend_Premult;
+    else if (drawFlags & kLXDrawFlag_UseFixedFunctionBlending_SourceIsUnpremult)
+        job->blendMode = kRasterBlend_Unpremult;
+    else
+        job->blendMode = kRasterBlend_None;
+
+    job->dstPxFormat = LXPixelBufferGetPixelFormat(dstPixbuf);
+    job->dstBytesPerPixel = LXBytesPerPixelForPixelFormat(job->dstPxFormat);
+    job->clampSource = (job->dstPxFormat != kLX_RGBA_FLOAT16 && job->dstPxFormat != kLX_RGBA_FLOAT32);
+
+    job->dstData = LXPixelBufferLockPixels(dstPixbuf, &job->dstRowBytes, NULL, outError);
+    if ( !job->dstData)
+        goto bail;
+
+    // back end: tiles are drawn in parallel
+    LXParallelApply(fe.tileCount, 0, rasterizeTile, job);
+
+    LXPixelBufferUnlockPixels(dstPixbuf);
+
+    if (job->failed) {
+        LXErrorSet(outError, 4811, "rasterizer failed to shade or write fragments");
+    } else {
+        success = YES;
+    }
+
+bail:
+    if (job->evaluator) _LXShaderCPUEvaluatorDestroy(job->evaluator);
+    for (i = 0; i < kLXParallelMaxWorkers; i++) {
+        _lx_free(job->workers[i].tileBuf);
+    }
+    _lx_free(job);
+    destroyFrontEnd(&fe);
+    return success;
+}
+
+
+#endif  // LXPLATFORM_LINUX
@@ -13,6 +13,7 @@
  */
 
 #include "LXFPClosure.h"
+#include "LXFPClosure_priv.h"
 #include "LXBasicTypes.h"
 #include "LXStringUtils.h"
 
@@ -21,68 +22,6 @@
 #include <string.h>
 #include <ctype.h>
 
-
-
-typedef enum {
-	FPClosureToken_NOP = 0,
-	
-	FPClosureToken_ABS,
-	FPClosureToken_ADD,
-	FPClosureToken_CMP,
-	FPClosureToken_DP3,
-	FPClosureToken_EX2,
-	FPClosureToken_FLR,
-	FPClosureToken_FRC,
-	FPClosureToken_LG2,
-	FPClosureToken_LRP,
-	
-	FPClosureToken_MAD = 10,
-	FPClosureToken_MAX,
-	FPClosureToken_MIN,
-	FPClosureToken_MOV,
-	FPClosureToken_MUL,
-	FPClosureToken_POW,
-	FPClosureToken_RCP,
-	FPClosureToken_RSQ,
-	FPClosureToken_SIN,
-	FPClosureToken_COS,
-	FPClosureToken_SUB,
-    
-    FPClosureTokenOpcodeMask = (1 << 8) - 1
-} FPClosureToken;
-
-typedef enum {
-    FPTokenModifier_SAT = 1 << 8
-} FPClosureTokenModifier;
-
-
-typedef enum {							// # of anteceding values:
-	FPClosureArg_ConstZero = 1,	  		// 0
-	FPClosureArg_ConstFloat,  			// 1 (the const as a float)
-	FPClosureArg_ConstFloatVec,			// 4 (the vector const)
-
-	FPClosureArg_Register,				// 1 (index of the register)
-} FPClosureArg;
-
-
-typedef union {
-	unsigned int arg;  // this contains both an FPClosureArg, as well as a swizzle mask in the high bits (use SWIZZLEMASK/SWIZZLESHR to access it)
-	int index;
-	float f;
-} FPClosureArgValue;
-
-
-
-
-typedef struct _FPClosure {
-	char inputsInUse[16];
-	unsigned int tokenCount;
-	FPClosureToken *tokenList;			// array of token instr strings (e.g. "MUL")
-	unsigned int tokenArgCount;		
-	FPClosureArgValue *args;			// flat array containing all arguments for all tokens (must iterate through tokenArgBytesList to find a particular argument set)
-} FPClosure;
-
-
 #define PRINT_EXEC 0
 #define PRINT_PARSE 0
 
@@ -126,391 +65,466 @@ typedef struct _FPClosure {
 enum {
     kFPClosureError_RegIndexOutOfBounds = 12005,
     kFPClosureError_InvalidDstArgument,
-    kFPClosureError_UnknownToken
+    kFPClosureError_UnknownToken,
+    kFPClosureError_TruncatedProgram,
+    kFPClosureError_ProgramTooLarge
 };
 
 
-typedef struct {
-	int err;
-	float regs[FPCLOSURE_NUM_REGS][4];
-	int lastDstRegIndex;
-} FPClosureExecState;
+#define SWZ_CHANNEL(swizzle, n)   (((swizzle) >> (SWZR - (n)*SWZ)) & SWZBITS)   // n is the dst/src lane (0 == r)
 
+#define SPLAT_VEC(v, n)                 v[0] = v[1] = v[2] = v[3] = n;
 
+#define COPY_VEC(v1, v2)                v1[0] = v2[0];  v1[1] = v2[1];  v1[2] = v2[2];  v1[3] = v2[3];
 
-#define SPLAT_VEC(v, n)  				v[0] = v[1] = v[2] = v[3] = n;
 
-#define SET_VEC(v, n1, n2, n3, n4)		v[0] = n1; v[1] = n2; v[2] = n3; v[3] = n4; 
+// token with its arguments decoded; this is the intermediate form between the arg stream and FPClosureOps
+typedef struct {
+    int op;
+    int flags;
+    int dstReg;
+    int dstMask;
+    int dstSel[4];
+    int srcReg[3];              // register index, or -1 for a constant
+    int srcSwz[3][4];
+    float srcConst[3][4];
+} FPClosureDecodedToken;
+
+
+static int GetFPClosureTokenArgCount(int op)
+{
+    switch (op) {
+        case FPClosureToken_ABS:  case FPClosureToken_COS:  case FPClosureToken_EX2:  case FPClosureToken_FLR:
+        case FPClosureToken_FRC:  case FPClosureToken_LG2:  case FPClosureToken_MOV:  case FPClosureToken_RCP:
+        case FPClosureToken_RSQ:  case FPClosureToken_SIN:
+            return 2;
 
-#define COPY_VEC_FROM_REG(v, rIndex)	{ float *reg = state->regs[rIndex];  (v)[0] = reg[0]; (v)[1] = reg[1]; (v)[2] = reg[2]; (v)[3] = reg[3]; }
+        case FPClosureToken_ADD:  case FPClosureToken_DP3:  case FPClosureToken_MAX:  case FPClosureToken_MIN:
+        case FPClosureToken_MUL:  case FPClosureToken_POW:  case FPClosureToken_SUB:
+            return 3;
 
-#define COPY_VEC(v1, v2)				v1[0] = v2[0];  v1[1] = v2[1];  v1[2] = v2[2];  v1[3] = v2[3]; 
+        case FPClosureToken_CMP:  case FPClosureToken_LRP:  case FPClosureToken_MAD:
+            return 4;
 
+        default:
+            return 0;  // NOP doesn't consume any args
+    }
+}
 
-#define ASSERT_REGINDEX(rIndex)  if (rIndex >= FPCLOSURE_NUM_REGS) { \
-                                     printf("** assert failure: reg index out of bounds (%i)", rIndex); \
-                                     state->err = kFPClosureError_RegIndexOutOfBounds;  return n; }
 
+// returns number of args consumed
+static int DecodeFPClosureToken(FPClosureToken token, const FPClosureArgValue *args, int argsLeft,
+                                FPClosureDecodedToken *dec, int *outErr)
+{
+    const int argCount = GetFPClosureTokenArgCount(token & FPClosureTokenOpcodeMask);
+    int i, k;
+    int n = 0;  // counts number of args consumed
+
+    memset(dec, 0, sizeof(FPClosureDecodedToken));
+    dec->op = token & FPClosureTokenOpcodeMask;
+    dec->flags = (token & FPTokenModifier_SAT) ? kFPClosureOpFlag_Sat : 0;
+
+    #define REQUIRE_ARGS(num_)  if (n + (num_) > argsLeft) { *outErr = kFPClosureError_TruncatedProgram;  return n; }
+
+    for (i = 0; i < argCount; i++) {
+        REQUIRE_ARGS(1);
+        unsigned int swizzle =  (args[n].arg & SWIZZLEMASK) >> SWIZZLESHIFT;
+        FPClosureArg thisArg =  (FPClosureArg) (args[n].arg & ARGMASK);
+        n++;
+
+        if (i == 0) {
+            // this is the dst argument
+            if (thisArg != FPClosureArg_Register) {
+                printf("** invalid dst argument (%i, swiz %i; argCount %i)\n", thisArg, swizzle, argCount);
+                *outErr = kFPClosureError_InvalidDstArgument;
+                return n;
+            }
+            REQUIRE_ARGS(1);
+            dec->dstReg = args[n++].index;
+
+            // result lane k goes to dst channel SWZ_CHANNEL(k); channels above 3 are not written.
+            // when several lanes target the same channel, the last one wins
+            for (k = 0; k < 4; k++) {
+                int ch = SWZ_CHANNEL(swizzle, k);
+                if (ch < 4) {
+                    dec->dstMask |= 1 << ch;
+                    dec->dstSel[ch] = k;
+                }
+            }
+        }
+        else {
+            // this is a source argument
+            const int s = i - 1;
+
+            dec->srcReg[s] = -1;
+            switch (thisArg) {
+                case FPClosureArg_ConstZero:
+                    break;
+
+                case FPClosureArg_ConstFloat:
+                    REQUIRE_ARGS(1);
+                    SPLAT_VEC(dec->srcConst[s], args[n].f);
+                    n++;
+                    break;
+
+                case FPClosureArg_ConstFloatVec:
+                    REQUIRE_ARGS(4);
+                    for (k = 0; k < 4; k++)
+                        dec->srcConst[s][k] = args[n++].f;
+                    break;
+
+                case FPClosureArg_Register:
+                    REQUIRE_ARGS(1);
+                    dec->srcReg[s] = args[n++].index;
+                    if (dec->srcReg[s] < 0 || dec->srcReg[s] >= FPCLOSURE_NUM_REGS) {
+                        printf("** src reg index out of bounds (%i)\n", dec->srcReg[s]);
+                        *outErr = kFPClosureError_RegIndexOutOfBounds;
+                        return n;
+                    }
+                    for (k = 0; k < 4; k++)
+                        dec->srcSwz[s][k] = SWZ_CHANNEL(swizzle, k) & 3;  // the parser only produces channels 0-3 for sources
+                    break;
+
+                default:
+                    printf("** unknown token in FPClosure stream (%i)\n", thisArg);
+                    *outErr = kFPClosureError_UnknownToken;
+                    return n;
+            }
+        }
+    }
+    #undef REQUIRE_ARGS
 
-//#define FPC_ASSERT_TWO_ARGS    if (arN != 2) { printf("** invalid number of args (%) for token %i, expected 2\n", arN, token);  state->err = -112;  return; }
-//#define FPC_ASSERT_THREE_ARGS  if (arN != 3) { printf("** invalid number of args (%) for token %i, expected 3\n", arN, token);  state->err = -112;  return; }
+    if (argCount > 0 && (dec->dstReg < 0 || dec->dstReg >= FPCLOSURE_NUM_REGS)) {
+        printf("** dst reg index out of bounds (%i)\n", dec->dstReg);
+        *outErr = kFPClosureError_RegIndexOutOfBounds;
+    }
+    return n;
+}
 
 
-static int ConsumeFPTokenArgs(int argCount, FPClosureArgValue *args, float argVecs[][4], int *outRegIndex, int *outRegSwizzle, float *outDstVec,
-							   FPClosureExecState *state)
+static LXBool IsFPClosureInputRegister(int reg, LXBool *outIsVector, int *outIndex)
 {
-	int i;
-	int n = 0;  // counts number of args consumed
+    if (reg >= FIRST_OPENSCALAR_INDEX && reg < FIRST_OPENSCALAR_INDEX + MAXINPUTSCALARS) {
+        *outIsVector = NO;
+        *outIndex = reg - FIRST_OPENSCALAR_INDEX;
+        return YES;
+    }
+    if (reg >= FIRST_OPENVECTOR_INDEX && reg < FIRST_OPENVECTOR_INDEX + MAXINPUTVECTORS) {
+        *outIsVector = YES;
+        *outIndex = reg - FIRST_OPENVECTOR_INDEX;
+        return YES;
+    }
+    return NO;
+}
 
-	for (i = 0; i < argCount; i++) {
-		unsigned int swizzle = 	(args[n].arg & SWIZZLEMASK) >> SWIZZLESHIFT;
-		FPClosureArg thisArg = 	(FPClosureArg) (args[n].arg & ARGMASK);
 
-#if (PRINT_EXEC)
+static void CompileFPClosure(FPClosure *fp)
 {
-				int rSwiz = (swizzle >> SWZR) & SWZBITS;
-				int gSwiz = (swizzle >> SWZG) & SWZBITS;
-				int bSwiz = (swizzle >> SWZB) & SWZBITS;
-				int aSwiz = (swizzle >> SWZA) & SWZBITS;
-		printf(" ARG %i == type %i, swz {%i, %i, %i, %i}, n %i  --- ",  i,  thisArg, rSwiz, gSwiz, bSwiz, aSwiz,  n); fflush(stdout);
-}		
-#endif		
+    const int tokenCount = fp->tokenCount;
+    FPClosureDecodedToken *decs = (FPClosureDecodedToken *) _lx_calloc(tokenCount + 1, sizeof(FPClosureDecodedToken));
+    char *keep = (char *) _lx_calloc(tokenCount + 1, 1);
+    char live[FPCLOSURE_NUM_REGS];
+    int regSlot[FPCLOSURE_NUM_REGS];
+    float (*consts)[4] = NULL;
+    int decCount = 0, constCount = 0, regSlotCount = 0, opCount = 0;
+    int argPos = 0;
+    int err = 0;
+    int i, s;
+
+    // decode the arg stream; NOP tokens don't consume args, like in the original stream executor
+    for (i = 0; i < tokenCount && !err; i++) {
+        FPClosureDecodedToken *dec = decs + decCount;
+        argPos += DecodeFPClosureToken(fp->tokenList[i], fp->args + argPos, (int)fp->tokenArgCount - argPos, dec, &err);
+
+        if (dec->op != FPClosureToken_NOP)
+            decCount++;
+    }
 
-		n++;
-		
-		if (i == 0) {
-			// this is the dst argument
-			if (thisArg != FPClosureArg_Register) {
-				printf("** invalid dst argument (%i, swiz %i; argCount %i)\n", thisArg, swizzle, argCount);
-				state->err = kFPClosureError_InvalidDstArgument;
-				return n;
-			}
-			
-			*outRegIndex = args[n++].index;
-			*outRegSwizzle = swizzle;
-			
-			#if (PRINT_EXEC)
-			printf("dst reg index %i --", *outRegIndex); fflush(stdout);
-			#endif
-			
-			ASSERT_REGINDEX(*outRegIndex);
-			COPY_VEC_FROM_REG(outDstVec, *outRegIndex);  // must copy, because dst swizzling may mean that previous reg value is not overwritten
-		}
-		else {
-			// this is a source argument
-			float *argDst = argVecs[i - 1];
-			
-			switch (thisArg) {
-				
-				case FPClosureArg_ConstZero:
-					SPLAT_VEC(argDst, 0.0f)
-					break;
-				
-				case FPClosureArg_ConstFloat: {
-					float val = args[n++].f;
-					SPLAT_VEC(argDst, val);
-					break;
-				}
-					
-				case FPClosureArg_ConstFloatVec: {
-#if (PRINT_EXEC)
-					printf(".. floatvec: { %f, %f, %f, %f }, dst %i... ", args[0].f, args[1].f, args[2].f, args[3].f, i);
-#endif
-					SET_VEC(argDst, args[n++].f, args[n++].f, args[n++].f, args[n++].f);
-					break;
-				}
-				
-				case FPClosureArg_Register: {
-					COPY_VEC_FROM_REG(argDst, args[n++].index);
-                    
-#if (PRINT_EXEC)
-                    printf(".. register, index %i: { %f, %f, %f, %f } ... ", args[n-1].index, argDst[0], argDst[1], argDst[2], argDst[3]);
+    // dead instruction elimination: walk backwards from the result register (i.e. the last instruction's dst);
+    // an instruction whose dst isn't read later can be dropped
+    memset(live, 0, sizeof(live));
+    for (i = decCount - 1; i >= 0 && !err; i--) {
+        FPClosureDecodedToken *dec = decs + i;
+
+        if (i < decCount - 1 && !live[dec->dstReg])
+            continue;
+
+        keep[i] = 1;
+        opCount++;
+
+        // a partial write keeps the previous value alive
+        live[dec->dstReg] = (dec->dstMask != 0xf);
+
+        for (s = 0; s < GetFPClosureTokenArgCount(dec->op) - 1; s++) {
+            if (dec->srcReg[s] >= 0) live[dec->srcReg[s]] = 1;
+        }
+    }
+
+    // assign register slots, then constant slots after them
+    for (i = 0; i < FPCLOSURE_NUM_REGS; i++)
+        regSlot[i] = -1;
+
+    for (i = 0; i < decCount && !err; i++) {
+        FPClosureDecodedToken *dec = decs + i;
+        if ( !keep[i]) continue;
+
+        for (s = 0; s < GetFPClosureTokenArgCount(dec->op) - 1; s++) {
+            if (dec->srcReg[s] >= 0 && regSlot[dec->srcReg[s]] < 0)
+                regSlot[dec->srcReg[s]] = regSlotCount++;
+        }
+        if (regSlot[dec->dstReg] < 0)
+            regSlot[dec->dstReg] = regSlotCount++;
+    }
+
+    if ( !err) {
+        fp->ops = (FPClosureOp *) _lx_calloc(opCount + 1, sizeof(FPClosureOp));
+        consts = (float (*)[4]) _lx_calloc(3 * opCount + 1, 4 * sizeof(float));
+    }
+
+    opCount = 0;
+    for (i = 0; i < decCount && !err; i++) {
+        FPClosureDecodedToken *dec = decs + i;
+        FPClosureOp *op = fp->ops + opCount;
+        int k;
+        if ( !keep[i]) continue;
+
+        op->op = dec->op;
+        op->flags = dec->flags;
+        op->dstMask = dec->dstMask;
+        op->dst = regSlot[dec->dstReg] * 4;
+        for (k = 0; k < 4; k++)
+            op->dstSel[k] = dec->dstSel[k];
+
+        for (s = 0; s < GetFPClosureTokenArgCount(dec->op) - 1; s++) {
+            if (dec->srcReg[s] >= 0) {
+                for (k = 0; k < 4; k++)
+                    op->src[s][k] = regSlot[dec->srcReg[s]] * 4 + dec->srcSwz[s][k];
+            } else {
+                // constants are pooled; identical vectors share a slot
+                int c;
+                for (c = 0; c < constCount; c++) {
+                    if (0 == memcmp(consts[c], dec->srcConst[s], 4 * sizeof(float)))
+                        break;
+                }
+                if (c == constCount) {
+                    COPY_VEC(consts[c], dec->srcConst[s]);
+                    constCount++;
+                }
+                for (k = 0; k < 4; k++)
+                    op->src[s][k] = (regSlotCount + c) * 4 + k;
+            }
+        }
+        opCount++;
+    }
+
+    if ( !err && (regSlotCount + constCount) * 4 > UINT16_MAX) {
+        printf("** FPClosure program is too large (%i registers, %i constants)\n", regSlotCount, constCount);
+        err = kFPClosureError_ProgramTooLarge;
+    }
+
+    if (err) {
+        _lx_free(fp->ops);
+        fp->ops = (FPClosureOp *) _lx_calloc(1, sizeof(FPClosureOp));
+        opCount = regSlotCount = constCount = 0;
+    }
+
+    fp->compileErr = err;
+    fp->opCount = opCount;
+    fp->slotCount = regSlotCount + constCount;
+    fp->regSlotCount = regSlotCount;
+    fp->slotTemplate = (float *) _lx_calloc(fp->slotCount + 1, 4 * sizeof(float));
+    if (constCount > 0)
+        memcpy(fp->slotTemplate + regSlotCount * 4, consts, constCount * 4 * sizeof(float));
+
+    fp->inputSlotCount = 0;
+    fp->inputSlots = (FPClosureInputSlot *) _lx_calloc(regSlotCount + 1, sizeof(FPClosureInputSlot));
+    for (i = 0; i < FPCLOSURE_NUM_REGS && !err; i++) {
+        LXBool isVector;
+        int index;
+        if (regSlot[i] >= 0 && IsFPClosureInputRegister(i, &isVector, &index)) {
+            FPClosureInputSlot *slot = fp->inputSlots + fp->inputSlotCount++;
+            slot->offset = regSlot[i] * 4;
+            slot->isVector = isVector;
+            slot->index = index;
+        }
+    }
+
+    fp->resultOffset = (opCount > 0) ? fp->ops[opCount - 1].dst : -1;
+
+#if (PRINT_PARSE)
+    printf("compiled FPClosure: %i tokens -> %i ops, %i register slots, %i constants, %i inputs (err %i)\n",
+                tokenCount, opCount, regSlotCount, constCount, fp->inputSlotCount, err);
 #endif
-					break;
-				}
-					
-				default:
-					printf("** unknown token in FPClosure stream (%i)\n", thisArg);
-					state->err = kFPClosureError_UnknownToken;
-					break;
-			}
-			
-			// apply swizzle
-			if (thisArg == FPClosureArg_Register) {
-				float newVec[4];
-				
-				int rSwiz = (swizzle >> SWZR) & SWZBITS;
-				int gSwiz = (swizzle >> SWZG) & SWZBITS;
-				int bSwiz = (swizzle >> SWZB) & SWZBITS;
-				int aSwiz = (swizzle >> SWZA) & SWZBITS;
-				
-				newVec[0] = argDst[rSwiz];
-				newVec[1] = argDst[gSwiz];
-				newVec[2] = argDst[bSwiz];
-				newVec[3] = argDst[aSwiz];
-				
-				COPY_VEC(argDst, newVec);
-			}
-		}		
-	}
-	return n;
+
+    _lx_free(consts);
+    _lx_free(keep);
+    _lx_free(decs);
 }
 
 
-#define CONSUME_ARGS_AND_COMP_SWIZZLE(argCount) \
-			numConsumedArgs = ConsumeFPTokenArgs(argCount, args, argVecs, &dstRegIndex, &dstRegSwizzle, dstVec, state); \
-			dstSwiz_r = (dstRegSwizzle >> SWZR) & SWZBITS; \
-			dstSwiz_g = (dstRegSwizzle >> SWZG) & SWZBITS; \
-			dstSwiz_b = (dstRegSwizzle >> SWZB) & SWZBITS; \
-			dstSwiz_a = (dstRegSwizzle >> SWZA) & SWZBITS;
-			//printf("swz %i/%i/%i/%i  ", dstSwiz_r, dstSwiz_g, dstSwiz_b, dstSwiz_a);
-			
-#define STORE_SCALAR(v) \
-			dstVec[dstSwiz_r] = v; \
-			dstVec[dstSwiz_g] = v; \
-			dstVec[dstSwiz_b] = v; \
-			dstVec[dstSwiz_a] = v;
+static void FreeFPClosureProgram(FPClosure *fp)
+{
+    _lx_free(fp->ops);
+    _lx_free(fp->slotTemplate);
+    _lx_free(fp->inputSlots);
+    fp->ops = NULL;
+    fp->slotTemplate = NULL;
+    fp->inputSlots = NULL;
+}
+
 
 
 #ifndef CLAMP_SAT_F
- #define CLAMP_SAT_F(v)  (v >= 1.0 ? 1.0 : (v < 0.0 ? 0.0 : v))	
+ #define CLAMP_SAT_F(v)  (v >= 1.0 ? 1.0 : (v < 0.0 ? 0.0 : v))
 #endif
 
-			
-						
-// returns number of args consumed
-static int ExecuteFPClosureToken(FPClosureToken token, FPClosureArgValue *args, FPClosureExecState *state)
-{
-    // separate the modifier
-    int modifier = token & ~FPClosureTokenOpcodeMask;
-    token = (FPClosureToken) ((int)token & FPClosureTokenOpcodeMask);
+// GCC and clang support computed goto, which gives each op its own indirect branch
+#if defined(__GNUC__)
+ #define FPC_THREADED_DISPATCH 1
+#else
+ #define FPC_THREADED_DISPATCH 0
+#endif
 
-	float argVecs[8][4];
-    memset(argVecs, 0, 8*4*sizeof(float));
+#define FPC_DISPATCH_TABLE(name_) \
+    static const void *name_[FPClosureToken_SUB + 1] = { \
+        [FPClosureToken_NOP] = &&op_NOP,  [FPClosureToken_ABS] = &&op_ABS,  [FPClosureToken_ADD] = &&op_ADD, \
+        [FPClosureToken_CMP] = &&op_CMP,  [FPClosureToken_DP3] = &&op_DP3,  [FPClosureToken_EX2] = &&op_EX2, \
+        [FPClosureToken_FLR] = &&op_FLR,  [FPClosureToken_FRC] = &&op_FRC,  [FPClosureToken_LG2] = &&op_LG2, \
+        [FPClosureToken_LRP] = &&op_LRP,  [FPClosureToken_MAD] = &&op_MAD,  [FPClosureToken_MAX] = &&op_MAX, \
+        [FPClosureToken_MIN] = &&op_MIN,  [FPClosureToken_MOV] = &&op_MOV,  [FPClosureToken_MUL] = &&op_MUL, \
+        [FPClosureToken_POW] = &&op_POW,  [FPClosureToken_RCP] = &&op_RCP,  [FPClosureToken_RSQ] = &&op_RSQ, \
+        [FPClosureToken_SIN] = &&op_SIN,  [FPClosureToken_COS] = &&op_COS,  [FPClosureToken_SUB] = &&op_SUB \
+    };
+
+#define LOAD_SRC(v_, s_)    v_[0] = file[op->src[s_][0]];  v_[1] = file[op->src[s_][1]];  v_[2] = file[op->src[s_][2]];  v_[3] = file[op->src[s_][3]];
+
+#define STORE_DST(v_) { \
+            float *dst = file + op->dst; \
+            const int mask = op->dstMask; \
+            if (mask & 1) dst[0] = v_[op->dstSel[0]]; \
+            if (mask & 2) dst[1] = v_[op->dstSel[1]]; \
+            if (mask & 4) dst[2] = v_[op->dstSel[2]]; \
+            if (mask & 8) dst[3] = v_[op->dstSel[3]]; \
+            if (op->flags & kFPClosureOpFlag_Sat) { \
+                dst[0] = CLAMP_SAT_F(dst[0]);  dst[1] = CLAMP_SAT_F(dst[1]);  dst[2] = CLAMP_SAT_F(dst[2]);  dst[3] = CLAMP_SAT_F(dst[3]); \
+            } \
+        }
 
-	int dstRegIndex = -1;
-	int dstRegSwizzle = 0;
-	int numConsumedArgs = 0;
-	
-	float dstVec[8] = { 0.0f };  // this vec has the extra elements as a graveyard destination for out-swizzled results
-	const float *srcVecA = argVecs[0];
-	const float *srcVecB = argVecs[1];
-	const float *srcVecC = argVecs[2];
-	
-	int dstSwiz_r = 0, dstSwiz_g = 0, dstSwiz_b = 0, dstSwiz_a = 0;
-	
-#if (PRINT_EXEC)	
-	printf("exec token: %i (modif %i) ... ", token, modifier); fflush(stdout);
-#endif
-	
-	register float v;
+#define STORE_SCALAR_DST(v_) { \
+            float sv_[4];  SPLAT_VEC(sv_, v_); \
+            STORE_DST(sv_); \
+        }
 
-	// do computation
-	switch (token)
-	{
-		case FPClosureToken_NOP:
-		default:
-			break;
-			
-		case FPClosureToken_ABS:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-			
-			dstVec[dstSwiz_r] = FABSF(srcVecA[0]);
-			dstVec[dstSwiz_g] = FABSF(srcVecA[1]);
-			dstVec[dstSwiz_b] = FABSF(srcVecA[2]);
-			dstVec[dstSwiz_a] = FABSF(srcVecA[3]);
-			break;
-			
-		case FPClosureToken_ADD: 
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
-
-			dstVec[dstSwiz_r] = srcVecA[0] + srcVecB[0];
-			dstVec[dstSwiz_g] = srcVecA[1] + srcVecB[1];
-			dstVec[dstSwiz_b] = srcVecA[2] + srcVecB[2];
-			dstVec[dstSwiz_a] = srcVecA[3] + srcVecB[3];
-			break;
-			
-		case FPClosureToken_CMP: 
-			CONSUME_ARGS_AND_COMP_SWIZZLE(4);
-			
-			// uses ARBfp order for operands -- D3D has B and C inverted
-			dstVec[dstSwiz_r] = (srcVecA[0] < 0.0f) ?  srcVecB[0] : srcVecC[0];
-			dstVec[dstSwiz_g] = (srcVecA[1] < 0.0f) ?  srcVecB[1] : srcVecC[1];
-			dstVec[dstSwiz_b] = (srcVecA[2] < 0.0f) ?  srcVecB[2] : srcVecC[2];
-			dstVec[dstSwiz_a] = (srcVecA[3] < 0.0f) ?  srcVecB[3] : srcVecC[3];
-			break;
-		
-		case FPClosureToken_COS: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
+#define VEC_OP1(expr_)      LOAD_SRC(a, 0); \
+                            res[0] = expr_(a[0]);  res[1] = expr_(a[1]);  res[2] = expr_(a[2]);  res[3] = expr_(a[3]); \
+                            STORE_DST(res);
 
-			v = srcVecA[0];  // takes only scalar input			
-			v = cosf(v);
-			STORE_SCALAR(v);
-			break;
-		}
-			
-		case FPClosureToken_DP3: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
+#define VEC_OP2(expr_)      LOAD_SRC(a, 0);  LOAD_SRC(b, 1); \
+                            res[0] = expr_(a[0], b[0]);  res[1] = expr_(a[1], b[1]);  res[2] = expr_(a[2], b[2]);  res[3] = expr_(a[3], b[3]); \
+                            STORE_DST(res);
 
-			v = (srcVecA[0] * srcVecB[0]) + (srcVecA[1] * srcVecB[1]) + (srcVecA[2] * srcVecA[2]);
-			STORE_SCALAR(v);
-			break;
-		}
-			
-		case FPClosureToken_EX2: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-			
-			v = srcVecA[0];  // takes only scalar input
-			v = powf(2.0f, v);
-			STORE_SCALAR(v);
-			break;
-		}
-		
-		case FPClosureToken_FLR:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-
-			dstVec[dstSwiz_r] = floorf(srcVecA[0]);
-			dstVec[dstSwiz_g] = floorf(srcVecA[1]);
-			dstVec[dstSwiz_b] = floorf(srcVecA[2]);
-			dstVec[dstSwiz_a] = floorf(srcVecA[3]);
-			break;
-			
-		case FPClosureToken_FRC:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-
-			dstVec[dstSwiz_r] = srcVecA[0] - floorf(srcVecA[0]);
-			dstVec[dstSwiz_g] = srcVecA[1] - floorf(srcVecA[1]);
-			dstVec[dstSwiz_b] = srcVecA[2] - floorf(srcVecA[2]);
-			dstVec[dstSwiz_a] = srcVecA[3] - floorf(srcVecA[3]);
-			break;
-			
-		case FPClosureToken_LG2: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-
-			v = srcVecA[0];  // takes only scalar input
-			v = logf(v);
-			v /= logf(2.0f);
-			STORE_SCALAR(v);
-			break;
-		}
-				
-		case FPClosureToken_LRP:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(4);
-			
-			dstVec[dstSwiz_r] = srcVecA[0] * srcVecB[0]  +  (1.0f - srcVecA[0]) * srcVecC[0];
-			dstVec[dstSwiz_g] = srcVecA[1] * srcVecB[1]  +  (1.0f - srcVecA[1]) * srcVecC[1];
-			dstVec[dstSwiz_b] = srcVecA[2] * srcVecB[2]  +  (1.0f - srcVecA[2]) * srcVecC[2];
-			dstVec[dstSwiz_a] = srcVecA[3] * srcVecB[3]  +  (1.0f - srcVecA[3]) * srcVecC[3];
-			break;
-			
-		case FPClosureToken_MAD:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(4);
-			
-			dstVec[dstSwiz_r] = srcVecA[0] * srcVecB[0] + srcVecC[0];
-			dstVec[dstSwiz_g] = srcVecA[1] * srcVecB[1] + srcVecC[1];
-			dstVec[dstSwiz_b] = srcVecA[2] * srcVecB[2] + srcVecC[2];
-			dstVec[dstSwiz_a] = srcVecA[3] * srcVecB[3] + srcVecC[3];
-			break;
-			
-		case FPClosureToken_MAX:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
-			
-			dstVec[dstSwiz_r] = MAX(srcVecA[0], srcVecB[0]);
-			dstVec[dstSwiz_g] = MAX(srcVecA[1], srcVecB[1]);
-			dstVec[dstSwiz_b] = MAX(srcVecA[3], srcVecB[2]);
-			dstVec[dstSwiz_a] = MAX(srcVecA[4], srcVecB[3]);
-			break;
-			
-		case FPClosureToken_MIN:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
-			
-			dstVec[dstSwiz_r] = MIN(srcVecA[0], srcVecB[0]);
-			dstVec[dstSwiz_g] = MIN(srcVecA[1], srcVecB[1]);
-			dstVec[dstSwiz_b] = MIN(srcVecA[3], srcVecB[2]);
-			dstVec[dstSwiz_a] = MIN(srcVecA[4], srcVecB[3]);
-			break;
-
-		case FPClosureToken_MOV:
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-			
-			dstVec[dstSwiz_r] = srcVecA[0];
-			dstVec[dstSwiz_g] = srcVecA[1];
-			dstVec[dstSwiz_b] = srcVecA[2];
-			dstVec[dstSwiz_a] = srcVecA[3];
-			break;
-			
-		case FPClosureToken_MUL: 
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
-			
-			dstVec[dstSwiz_r] = srcVecA[0] * srcVecB[0];
-			dstVec[dstSwiz_g] = srcVecA[1] * srcVecB[1];
-			dstVec[dstSwiz_b] = srcVecA[2] * srcVecB[2];
-			dstVec[dstSwiz_a] = srcVecA[3] * srcVecB[3];
-			break;
-		
-		case FPClosureToken_POW: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
+#define VEC_OP3(expr_)      LOAD_SRC(a, 0);  LOAD_SRC(b, 1);  LOAD_SRC(c, 2); \
+                            res[0] = expr_(a[0], b[0], c[0]);  res[1] = expr_(a[1], b[1], c[1]); \
+                            res[2] = expr_(a[2], b[2], c[2]);  res[3] = expr_(a[3], b[3], c[3]); \
+                            STORE_DST(res);
 
-			v = srcVecA[0];  // takes only scalar input
-			v = powf(v, srcVecB[0]);
-			STORE_SCALAR(v);
-			break;
-		}
-							
-		case FPClosureToken_RCP: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
-
-			v = srcVecA[0];  // takes only scalar input
-			v = (v == 0.0f) ? HUGE_VAL : (1.0f / v);  // div by zero is a CPU exception on x86 -- must check for it!
-			STORE_SCALAR(v);
-			break;
-		}
-		
-		case FPClosureToken_RSQ: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
+#define FPC_ADD(a_, b_)         ((a_) + (b_))
+#define FPC_SUB(a_, b_)         ((a_) - (b_))
+#define FPC_MUL(a_, b_)         ((a_) * (b_))
+#define FPC_FRC(a_)             ((a_) - floorf(a_))
+#define FPC_CMP(a_, b_, c_)     (((a_) < 0.0f) ? (b_) : (c_))   // uses ARBfp order for operands -- D3D has B and C inverted
+#define FPC_LRP(a_, b_, c_)     ((a_) * (b_)  +  (1.0f - (a_)) * (c_))
+#define FPC_MAD(a_, b_, c_)     ((a_) * (b_) + (c_))
 
-			v = srcVecA[0];  // takes only scalar input
-			v = 1.0f / sqrtf(v);	
-			STORE_SCALAR(v);
-			break;
-		}
-		
-		case FPClosureToken_SIN: {
-			CONSUME_ARGS_AND_COMP_SWIZZLE(2);
 
-			v = srcVecA[0];  // takes only scalar input
-			v = sinf(v);
-			STORE_SCALAR(v);
-			break;
-		}
-		
-		case FPClosureToken_SUB: 
-			CONSUME_ARGS_AND_COMP_SWIZZLE(3);
-
-			dstVec[dstSwiz_r] = srcVecA[0] - srcVecB[0];
-			dstVec[dstSwiz_g] = srcVecA[1] - srcVecB[1];
-			dstVec[dstSwiz_b] = srcVecA[2] - srcVecB[2];
-			dstVec[dstSwiz_a] = srcVecA[3] - srcVecB[3];
-			break;		
-	}
+static void RunFPClosureOps(const FPClosureOp * LXRESTRICT op, float * LXRESTRICT file)
+{
+    float a[4], b[4], c[4], res[4];
+    float v;
 
-#if (PRINT_EXEC)	
-	printf(".. done: %f, %f, %f, %f (nargs %i)\n", dstVec[0], dstVec[1], dstVec[2], dstVec[3], numConsumedArgs); fflush(stdout);
-#endif	
-	
-    if (modifier & FPTokenModifier_SAT) {
-        dstVec[0] = CLAMP_SAT_F(dstVec[0]);
-        dstVec[1] = CLAMP_SAT_F(dstVec[1]);
-        dstVec[2] = CLAMP_SAT_F(dstVec[2]);
-        dstVec[3] = CLAMP_SAT_F(dstVec[3]);
+#if (FPC_THREADED_DISPATCH)
+    FPC_DISPATCH_TABLE(dispatch);
+    #define FPC_OP(name_)   op_##name_:
+    #define FPC_NEXT        op++;  goto *dispatch[op->op];
+
+    goto *dispatch[op->op];
+#else
+    #define FPC_OP(name_)   case FPClosureToken_##name_:
+    #define FPC_NEXT        op++;  continue;
+
+    for (;;) switch (op->op) {
+        default:
+#endif
+
+    FPC_OP(NOP)
+        return;
+
+    FPC_OP(ABS)     VEC_OP1(FABSF);                 FPC_NEXT
+    FPC_OP(ADD)     VEC_OP2(FPC_ADD);               FPC_NEXT
+    FPC_OP(CMP)     VEC_OP3(FPC_CMP);               FPC_NEXT
+    FPC_OP(FLR)     VEC_OP1(floorf);                FPC_NEXT
+    FPC_OP(FRC)     VEC_OP1(FPC_FRC);               FPC_NEXT
+    FPC_OP(LRP)     VEC_OP3(FPC_LRP);               FPC_NEXT
+    FPC_OP(MAD)     VEC_OP3(FPC_MAD);               FPC_NEXT
+    FPC_OP(MAX)     VEC_OP2(MAX);                   FPC_NEXT
+    FPC_OP(MIN)     VEC_OP2(MIN);                   FPC_NEXT
+    FPC_OP(MUL)     VEC_OP2(FPC_MUL);               FPC_NEXT
+    FPC_OP(SUB)     VEC_OP2(FPC_SUB);               FPC_NEXT
+
+    FPC_OP(MOV)
+        LOAD_SRC(a, 0);
+        STORE_DST(a);
+        FPC_NEXT
+
+    FPC_OP(DP3)
+        LOAD_SRC(a, 0);  LOAD_SRC(b, 1);
+        v = (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    // the remaining ops take only scalar input
+    FPC_OP(COS)
+        v = cosf(file[op->src[0][0]]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(SIN)
+        v = sinf(file[op->src[0][0]]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(EX2)
+        v = powf(2.0f, file[op->src[0][0]]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(LG2)
+        v = logf(file[op->src[0][0]]);
+        v /= logf(2.0f);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(POW)
+        v = powf(file[op->src[0][0]], file[op->src[1][0]]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(RCP)
+        v = file[op->src[0][0]];
+        v = (v == 0.0f) ? HUGE_VAL : (1.0f / v);  // div by zero is a CPU exception on x86 -- must check for it!
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+    FPC_OP(RSQ)
+        v = 1.0f / sqrtf(file[op->src[0][0]]);
+        STORE_SCALAR_DST(v);
+        FPC_NEXT
+
+#if !(FPC_THREADED_DISPATCH)
     }
-    
-	// store result
-	COPY_VEC( state->regs[dstRegIndex], dstVec );
-	
-	state->lastDstRegIndex = dstRegIndex;
-	
-	return numConsumedArgs;
+#endif
+    #undef FPC_OP
+    #undef FPC_NEXT
 }
 
 
@@ -520,43 +534,298 @@ int LXFPClosureExecute_f(LXFPClosurePtr fp, float * LXRESTRICT outVector,
                                             const float * LXRESTRICT inputScalars, LXInteger inputScalarCount,
                                             const float * LXRESTRICT inputVectors, LXInteger inputVectorCount)
 {
-	LXInteger i;
-	const int c = fp->tokenCount;
-	FPClosureArgValue *argsArray = fp->args;
-	
-#if (PRINT_EXEC)
-	printf("starting fpc exec: %i tokens, %i args\n", fp->tokenCount, fp->tokenArgCount);  fflush(stdout);
+    const unsigned int slotCount = fp->slotCount;
+    float file[4 * slotCount + 4];
+    unsigned int i;
+
+    if (fp->compileErr) {
+        SPLAT_VEC(outVector, 0.0f);
+        return fp->compileErr;
+    }
+
+    // the register file template holds zeroed registers and the constant bank
+    memcpy(file, fp->slotTemplate, 4 * slotCount * sizeof(float));
+
+    // copy input values into the registers that the program reads
+    if ( !inputScalars) inputScalarCount = 0;
+    if ( !inputVectors) inputVectorCount = 0;
+
+    for (i = 0; i < fp->inputSlotCount; i++) {
+        const FPClosureInputSlot *slot = fp->inputSlots + i;
+        float *reg = file + slot->offset;
+
+        if ( !slot->isVector) {
+            if (slot->index < inputScalarCount) {
+                SPLAT_VEC(reg, inputScalars[slot->index]);
+            }
+        } else {
+            if (slot->index < inputVectorCount) {
+                const float *vec = inputVectors + slot->index*4;
+                COPY_VEC(reg, vec);
+            }
+        }
+    }
+
+    if (fp->jitFunc)
+        fp->jitFunc(file);
+    else
+        RunFPClosureOps(fp->ops, file);
+
+    // copy result to given output
+    if (fp->resultOffset >= 0) {
+        const float *result = file + fp->resultOffset;
+        COPY_VEC(outVector, result);
+    } else {
+        SPLAT_VEC(outVector, 0.0f);
+    }
+    return 0;
+}
+
+
+// --- batch execution ---
+//
+// the batch executor runs the same FPClosureOps over FPC_BATCH_WIDTH elements at a time.
+// the register file is transposed: each float offset of the scalar register file becomes a row of FPC_BATCH_WIDTH lanes,
+// so the resolved swizzle offsets can be used unchanged. every lane must compute exactly what the scalar interpreter does,
+// so the FPCV_ vector ops (in LXFPClosure_priv.h) only use correctly rounded IEEE operations and call libm per lane for the transcendentals.
+
+#define FPC_BATCH_WIDTH     16
+
+#define ROW(off_)               (file + (off_) * FPC_BATCH_WIDTH)
+
+#define BATCH_STORE_DST(res_) { \
+            int p_; \
+            for (p_ = 0; p_ < 4; p_++) { \
+                if (op->dstMask & (1 << p_)) memcpy(ROW(op->dst + p_), res_[op->dstSel[p_]], FPC_BATCH_WIDTH * sizeof(float)); \
+            } \
+            if (op->flags & kFPClosureOpFlag_Sat) { \
+                for (p_ = 0; p_ < 4; p_++) { \
+                    float *d_ = ROW(op->dst + p_); \
+                    for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) \
+                        FPCV_STORE(d_ + j, FPCV_SAT(FPCV_LOAD(d_ + j))); \
+                } \
+            } \
+        }
+
+// scalar ops write their result to lane row 0 and broadcast it to every written channel
+#define BATCH_STORE_SCALAR_DST() { \
+            int p_; \
+            for (p_ = 1; p_ < 4; p_++) memcpy(res[p_], res[0], FPC_BATCH_WIDTH * sizeof(float)); \
+            BATCH_STORE_DST(res); \
+        }
+
+#define BATCH_VEC_OP1(vop_) \
+            for (k = 0; k < 4; k++) { \
+                const float *a_ = ROW(op->src[0][k]); \
+                for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[k] + j, vop_(FPCV_LOAD(a_ + j))); \
+            } \
+            BATCH_STORE_DST(res);
+
+#define BATCH_VEC_OP2(vop_) \
+            for (k = 0; k < 4; k++) { \
+                const float *a_ = ROW(op->src[0][k]); \
+                const float *b_ = ROW(op->src[1][k]); \
+                for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[k] + j, vop_(FPCV_LOAD(a_ + j), FPCV_LOAD(b_ + j))); \
+            } \
+            BATCH_STORE_DST(res);
+
+#define BATCH_VEC_OP3(vop_) \
+            for (k = 0; k < 4; k++) { \
+                const float *a_ = ROW(op->src[0][k]); \
+                const float *b_ = ROW(op->src[1][k]); \
+                const float *c_ = ROW(op->src[2][k]); \
+                for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[k] + j, vop_(FPCV_LOAD(a_ + j), FPCV_LOAD(b_ + j), FPCV_LOAD(c_ + j))); \
+            } \
+            BATCH_STORE_DST(res);
+
+#define BATCH_SCALAR_OP1(expr_) { \
+            const float *a_ = ROW(op->src[0][0]); \
+            for (j = 0; j < FPC_BATCH_WIDTH; j++) { \
+                v = a_[j]; \
+                res[0][j] = expr_; \
+            } \
+            BATCH_STORE_SCALAR_DST(); \
+        }
+
+#define FPCV_IDENTITY(a_)       (a_)
+
+
+// 'res' is aligned scratch space for one 4-channel result
+static void RunFPClosureOpsBatch(const FPClosureOp * LXRESTRICT op, float * LXRESTRICT file, float (* LXRESTRICT res)[FPC_BATCH_WIDTH])
+{
+    float v;
+    int j, k;
+
+#if (FPC_THREADED_DISPATCH)
+    FPC_DISPATCH_TABLE(dispatch);
+    #define FPC_OP(name_)   op_##name_:
+    #define FPC_NEXT        op++;  goto *dispatch[op->op];
+
+    goto *dispatch[op->op];
+#else
+    #define FPC_OP(name_)   case FPClosureToken_##name_:
+    #define FPC_NEXT        op++;  continue;
+
+    for (;;) switch (op->op) {
+        default:
 #endif
-	
-	FPClosureExecState state;
-	memset(&state, 0, sizeof(FPClosureExecState));
-	
-	// copy input values into state registers
-	inputScalarCount = MIN(inputScalarCount, MAXINPUTSCALARS);
-	for (i = 0; i < inputScalarCount; i++) {
-		float vec[4];
-		SPLAT_VEC(vec, inputScalars[i]);
-		COPY_VEC(state.regs[FIRST_OPENSCALAR_INDEX + i], vec);
-	}
-	
-	inputVectorCount = MIN(inputVectorCount, MAXINPUTVECTORS);
-	for (i = 0; i < inputVectorCount; i++) {
-		const float *vec = inputVectors + i*4;
-		COPY_VEC(state.regs[FIRST_OPENVECTOR_INDEX + i], vec);
-	}
-		
-	// execute tokens
-	for (i = 0; i < c; i++) {
-		int numConsumedArgs = ExecuteFPClosureToken(fp->tokenList[i], argsArray, &state);
-		argsArray += numConsumedArgs;
-	}
-	
-	// copy result to given output
-	COPY_VEC( outVector, state.regs[state.lastDstRegIndex] );
-	
-	return state.err;
+
+    FPC_OP(NOP)
+        return;
+
+    FPC_OP(ABS)     BATCH_VEC_OP1(FPCV_ABS);        FPC_NEXT
+    FPC_OP(ADD)     BATCH_VEC_OP2(FPCV_ADD);        FPC_NEXT
+    FPC_OP(CMP)     BATCH_VEC_OP3(FPCV_CMP);        FPC_NEXT
+    FPC_OP(FLR)     BATCH_VEC_OP1(FPCV_FLOOR);      FPC_NEXT
+    FPC_OP(FRC)     BATCH_VEC_OP1(FPCV_FRC);        FPC_NEXT
+    FPC_OP(LRP)     BATCH_VEC_OP3(FPCV_LRP);        FPC_NEXT
+    FPC_OP(MAD)     BATCH_VEC_OP3(FPCV_MAD);        FPC_NEXT
+    FPC_OP(MAX)     BATCH_VEC_OP2(FPCV_MAX);        FPC_NEXT
+    FPC_OP(MIN)     BATCH_VEC_OP2(FPCV_MIN);        FPC_NEXT
+    FPC_OP(MOV)     BATCH_VEC_OP1(FPCV_IDENTITY);   FPC_NEXT
+    FPC_OP(MUL)     BATCH_VEC_OP2(FPCV_MUL);        FPC_NEXT
+    FPC_OP(SUB)     BATCH_VEC_OP2(FPCV_SUB);        FPC_NEXT
+
+    FPC_OP(DP3) {
+        const float *a0 = ROW(op->src[0][0]), *a1 = ROW(op->src[0][1]), *a2 = ROW(op->src[0][2]);
+        const float *b0 = ROW(op->src[1][0]), *b1 = ROW(op->src[1][1]), *b2 = ROW(op->src[1][2]);
+        for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) {
+            FPCVec d = FPCV_MUL(FPCV_LOAD(a0 + j), FPCV_LOAD(b0 + j));
+            d = FPCV_ADD(d, FPCV_MUL(FPCV_LOAD(a1 + j), FPCV_LOAD(b1 + j)));
+            d = FPCV_ADD(d, FPCV_MUL(FPCV_LOAD(a2 + j), FPCV_LOAD(b2 + j)));
+            FPCV_STORE(res[0] + j, d);
+        }
+        BATCH_STORE_SCALAR_DST();
+        FPC_NEXT
+    }
+
+    FPC_OP(RCP) {
+        const float *a0 = ROW(op->src[0][0]);
+        for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) {
+            FPCVec x = FPCV_LOAD(a0 + j);
+            FPCVec isZero = FPCV_EQ(x, FPCV_SPLAT(0.0f));
+            FPCVec r = FPCV_DIV(FPCV_SPLAT(1.0f), FPCV_SELECT(isZero, FPCV_SPLAT(1.0f), x));
+            FPCV_STORE(res[0] + j, FPCV_SELECT(isZero, FPCV_SPLAT(HUGE_VALF), r));
+        }
+        BATCH_STORE_SCALAR_DST();
+        FPC_NEXT
+    }
+
+    FPC_OP(RSQ) {
+        const float *a0 = ROW(op->src[0][0]);
+        for (j = 0; j < FPC_BATCH_WIDTH; j += FPCV_WIDTH) {
+            FPCV_STORE(res[0] + j, FPCV_DIV(FPCV_SPLAT(1.0f), FPCV_SQRT(FPCV_LOAD(a0 + j))));
+        }
+        BATCH_STORE_SCALAR_DST();
+        FPC_NEXT
+    }
+
+    // transcendentals go through libm lane by lane so that results match the scalar interpreter
+    FPC_OP(COS)     BATCH_SCALAR_OP1(cosf(v));                  FPC_NEXT
+    FPC_OP(SIN)     BATCH_SCALAR_OP1(sinf(v));                  FPC_NEXT
+    FPC_OP(EX2)     BATCH_SCALAR_OP1(powf(2.0f, v));            FPC_NEXT
+    FPC_OP(LG2)     BATCH_SCALAR_OP1(logf(v) / logf(2.0f));     FPC_NEXT
+
+    FPC_OP(POW) {
+        const float *a0 = ROW(op->src[0][0]);
+        const float *b0 = ROW(op->src[1][0]);
+        for (j = 0; j < FPC_BATCH_WIDTH; j++) {
+            res[0][j] = powf(a0[j], b0[j]);
+        }
+        BATCH_STORE_SCALAR_DST();
+        FPC_NEXT
+    }
+
+#if !(FPC_THREADED_DISPATCH)
+    }
+#endif
+    #undef FPC_OP
+    #undef FPC_NEXT
+}
+
+
+int LXFPClosureExecuteBatch(LXFPClosurePtr fp, LXInteger count, float * LXRESTRICT outVectors,
+                                            const float * LXRESTRICT inputScalars, LXInteger inputScalarCount,
+                                            const float * LXRESTRICT inputVectors, LXInteger inputVectorCount)
+{
+    const size_t rowBytes = FPC_BATCH_WIDTH * sizeof(float);
+    const unsigned int slotCount = fp->slotCount;
+    const unsigned int regRowCount = fp->regSlotCount * 4;
+    uint8_t *fileBuf;
+    float *file;
+    float (*res)[FPC_BATCH_WIDTH];
+    LXInteger n, i;
+
+    if (count < 1) return 0;
+
+    if (fp->compileErr || fp->resultOffset < 0) {
+        memset(outVectors, 0, count * 4 * sizeof(float));
+        return fp->compileErr;
+    }
+
+    if ( !inputScalars) inputScalarCount = 0;
+    if ( !inputVectors) inputVectorCount = 0;
+
+    // register file rows followed by 4 rows of result scratch, 16-byte aligned
+    fileBuf = (uint8_t *) _lx_malloc((4 * slotCount + 4) * rowBytes + 16);
+    file = (float *) (((uintptr_t)fileBuf + 15) & ~(uintptr_t)15);
+    res = (float (*)[FPC_BATCH_WIDTH]) ROW(4 * slotCount);
+
+    // the constant bank is the same for every block, so it's transposed only once
+    for (i = regRowCount; i < 4 * slotCount; i++) {
+        const float c = fp->slotTemplate[i];
+        float *row = ROW(i);
+        int j;
+        for (j = 0; j < FPC_BATCH_WIDTH; j++) row[j] = c;
+    }
+
+    for (n = 0; n < count; n += FPC_BATCH_WIDTH) {
+        const int laneCount = (int) MIN(count - n, FPC_BATCH_WIDTH);
+        int lane;
+
+        memset(file, 0, regRowCount * rowBytes);
+
+        // transpose inputs into the lanes of their registers
+        for (i = 0; i < fp->inputSlotCount; i++) {
+            const FPClosureInputSlot *slot = fp->inputSlots + i;
+            float *r0 = ROW(slot->offset),  *r1 = ROW(slot->offset + 1),  *r2 = ROW(slot->offset + 2),  *r3 = ROW(slot->offset + 3);
+
+            if ( !slot->isVector) {
+                if (slot->index >= inputScalarCount) continue;
+                for (lane = 0; lane < laneCount; lane++) {
+                    const float s = inputScalars[(n + lane) * inputScalarCount + slot->index];
+                    r0[lane] = r1[lane] = r2[lane] = r3[lane] = s;
+                }
+            } else {
+                if (slot->index >= inputVectorCount) continue;
+                for (lane = 0; lane < laneCount; lane++) {
+                    const float *vec = inputVectors + ((n + lane) * inputVectorCount + slot->index) * 4;
+                    r0[lane] = vec[0];  r1[lane] = vec[1];  r2[lane] = vec[2];  r3[lane] = vec[3];
+                }
+            }
+        }
+
+        RunFPClosureOpsBatch(fp->ops, file, res);
+
+        {
+        const float *r0 = ROW(fp->resultOffset),  *r1 = ROW(fp->resultOffset + 1),  *r2 = ROW(fp->resultOffset + 2),  *r3 = ROW(fp->resultOffset + 3);
+        float *out = outVectors + n * 4;
+        for (lane = 0; lane < laneCount; lane++) {
+            out[0] = r0[lane];  out[1] = r1[lane];  out[2] = r2[lane];  out[3] = r3[lane];
+            out += 4;
+        }
+        }
+    }
+
+    _lx_free(fileBuf);
+    return 0;
 }
 
+#undef ROW
+
 
 LXSuccess LXFPClosureExecuteWithContext(LXFPClosurePtr fp, LXRGBA *outRGBA, LXFPClosureContextPtr ctx, LXError *outError)
 {
@@ -604,11 +873,28 @@ LXSuccess LXFPClosureExecuteWithContext(LXFPClosurePtr fp, LXRGBA *outRGBA, LXFP
 }
 
 
+static LXBool s_jitEnabled = YES;
+
+void LXFPClosureSetJITEnabled(LXBool f)
+{
+    s_jitEnabled = f;
+}
+
+LXBool LXFPClosureIsJITCompiled(LXFPClosurePtr fp)
+{
+    return (fp && fp->jitFunc) ? YES : NO;
+}
+
+
 ///void DisposeFPClosure(FPClosure *fp)
 void LXFPClosureDestroy(LXFPClosurePtr fp)
 {
 	if (!fp) return;
 	
+#if (LX_HAS_FPCLOSURE_JIT)
+	LXFPClosureJITRelease(fp);
+#endif
+	FreeFPClosureProgram(fp);
 	if (fp->tokenList) _lx_free(fp->tokenList);
 	if (fp->args) _lx_free(fp->args);
 	_lx_free(fp);	
@@ -657,13 +943,16 @@ void TestFPClosure()
 	args[n++].index = 1;
 	
 	
-	c.tokenArgCount = 5;
+	c.tokenArgCount = n;
 	c.args = args;
 	
+	CompileFPClosure(&c);
 		
 	float result[4] = { -1, -1, -1, -1 };
 	
     LXFPClosureExecute_f(&c, result, NULL, 0, NULL, 0);
+    
+    FreeFPClosureProgram(&c);
 	
 	printf("\n\n---- got result: %f, %f, %f, %f\n", result[0], result[1], result[2], result[3]);
 }
@@ -1058,6 +1347,13 @@ LXFPClosurePtr LXFPClosureCreateWithString(const char *fpStr, size_t fpStrLen)
 	cls->tokenArgCount = tokenArgCount;
 	cls->args = tokenArgList;
 	
+	CompileFPClosure(cls);
+	
+#if (LX_HAS_FPCLOSURE_JIT)
+	if (s_jitEnabled && !cls->compileErr && cls->opCount > 0)
+	    LXFPClosureJITAcquire(cls, fpStr, fpStrLen);  // if this fails, the interpreter is used
+#endif
+
 	return cls;
 }
 
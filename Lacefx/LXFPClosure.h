@@ -59,6 +59,11 @@ LXEXPORT LXFPClosurePtr LXFPClosureCreateWithString(const char *fpStr, size_t fp
 
 LXEXPORT void LXFPClosureDestroy(LXFPClosurePtr fp);
 
+// on x86-64, closures are translated to native code at creation time (the interpreter is used if that fails).
+// disabling the JIT affects closures created afterwards; this is mainly useful for testing
+LXEXPORT void LXFPClosureSetJITEnabled(LXBool f);
+LXEXPORT LXBool LXFPClosureIsJITCompiled(LXFPClosurePtr fp);
+
 
 // context can be NULL
 LXEXPORT LXSuccess LXFPClosureExecuteWithContext(LXFPClosurePtr fp, LXRGBA *outRGBA, LXFPClosureContextPtr ctx, LXError *error);
@@ -68,6 +73,13 @@ LXEXPORT int LXFPClosureExecute_f(LXFPClosurePtr fp, float * LXRESTRICT outVecto
                                   const float * LXRESTRICT inputScalars, LXInteger inputScalarCount,
                                   const float * LXRESTRICT inputVectors, LXInteger inputVectorCount);
 
+// evaluates the program for 'count' elements at once; results are identical to calling LXFPClosureExecute_f() per element.
+// inputs are packed per element: element n reads inputScalarCount scalars starting at inputScalars[n * inputScalarCount]
+// and inputVectorCount vectors starting at inputVectors[n * inputVectorCount * 4]. outVectors receives count * 4 floats.
+LXEXPORT int LXFPClosureExecuteBatch(LXFPClosurePtr fp, LXInteger count, float * LXRESTRICT outVectors,
+                                  const float * LXRESTRICT inputScalars, LXInteger inputScalarCount,
+                                  const float * LXRESTRICT inputVectors, LXInteger inputVectorCount);
+
 
 #ifdef __cplusplus
 }
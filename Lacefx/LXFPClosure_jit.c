@@ -0,0 +1,528 @@
+/*
+ *  LXFPClosure_jit.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXFPClosure_priv.h"
+
+#if (LX_HAS_FPCLOSURE_JIT)
+
+#include "LXMutex.h"
+#include "LXStringUtils.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+
+/*
+  Translates a compiled FPClosure program (the FPClosureOp list) into x86-64 SSE code.
+
+  The generated function has the same contract as RunFPClosureOps(): it takes the register file in rdi and
+  evaluates every op in place. Each FPClosure register is one xmm-sized row of the file, so an op loads its sources
+  into xmm0-xmm2 (swizzles become a single shufps), computes into xmm0 and stores through the dst write mask.
+  The arithmetic is the same sequence of IEEE operations the interpreter performs, and the transcendental ops call
+  the same libm functions, so results are bit-identical.
+
+  Code buffers are shared between closures created from the same program string.
+*/
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+#define PRINT_JIT 0
+
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    LXBool failed;
+} FPCJITBuffer;
+
+typedef struct _FPCJITEntry {
+    struct _FPCJITEntry *next;
+    char *progStr;
+    size_t progStrLen;
+    int32_t refCount;
+    void *code;
+    size_t codeSize;
+} FPCJITEntry;
+
+static FPCJITEntry *s_jitCache = NULL;
+
+
+// x86 encodings used by the emitter
+enum {
+    kPrefix_None = 0,
+    kPrefix_66 = 0x66,
+    kPrefix_F3 = 0xf3,
+
+    kOp_MOVUPS_load = 0x10,
+    kOp_MOVUPS_store = 0x11,
+    kOp_MOVAPS = 0x28,
+    kOp_SQRTPS = 0x51,
+    kOp_ANDPS = 0x54,
+    kOp_ANDNPS = 0x55,
+    kOp_ORPS = 0x56,
+    kOp_XORPS = 0x57,
+    kOp_ADDPS = 0x58,
+    kOp_MULPS = 0x59,
+    kOp_SUBPS = 0x5c,
+    kOp_MINPS = 0x5d,
+    kOp_DIVPS = 0x5e,
+    kOp_MAXPS = 0x5f,
+    kOp_MOVD = 0x6e,
+    kOp_PSHUFD = 0x70,
+    kOp_CMPPS = 0xc2,
+    kOp_SHUFPS = 0xc6,
+
+    kCmp_EQ = 0,
+    kCmp_LT = 1,
+
+    kRound_Floor = 1
+};
+
+#define SHUF_IMM(a_, b_, c_, d_)    ((a_) | ((b_) << 2) | ((c_) << 4) | ((d_) << 6))
+#define SHUF_IDENTITY               SHUF_IMM(0, 1, 2, 3)
+#define SHUF_SPLAT(n_)              SHUF_IMM(n_, n_, n_, n_)
+
+
+static void emit8(FPCJITBuffer *b, uint8_t v)
+{
+    if (b->len >= b->cap) {
+        b->failed = YES;
+        return;
+    }
+    b->buf[b->len++] = v;
+}
+
+static void emit32(FPCJITBuffer *b, uint32_t v)
+{
+    emit8(b, v & 0xff);
+    emit8(b, (v >> 8) & 0xff);
+    emit8(b, (v >> 16) & 0xff);
+    emit8(b, (v >> 24) & 0xff);
+}
+
+static void emit64(FPCJITBuffer *b, uint64_t v)
+{
+    emit32(b, (uint32_t)v);
+    emit32(b, (uint32_t)(v >> 32));
+}
+
+// xmm register to xmm register
+static void emitRR(FPCJITBuffer *b, int prefix, int op, int dstXmm, int srcXmm)
+{
+    if (prefix) emit8(b, prefix);
+    emit8(b, 0x0f);
+    emit8(b, op);
+    emit8(b, 0xc0 | (dstXmm << 3) | srcXmm);
+}
+
+static void emitRRImm(FPCJITBuffer *b, int prefix, int op, int dstXmm, int srcXmm, int imm)
+{
+    emitRR(b, prefix, op, dstXmm, srcXmm);
+    emit8(b, imm);
+}
+
+// xmm register and [rbx + disp32], where the displacement is given as a float offset into the register file
+static void emitRM(FPCJITBuffer *b, int prefix, int op, int xmm, int floatOffset)
+{
+    if (prefix) emit8(b, prefix);
+    emit8(b, 0x0f);
+    emit8(b, op);
+    emit8(b, 0x80 | (xmm << 3) | 3);
+    emit32(b, floatOffset * 4);
+}
+
+// broadcasts a 32-bit constant into all lanes of an xmm register (clobbers eax)
+static void emitSplatConst(FPCJITBuffer *b, int xmm, uint32_t bits)
+{
+    emit8(b, 0xb8);  // mov eax, imm32
+    emit32(b, bits);
+    emitRR(b, kPrefix_66, kOp_MOVD, xmm, 0);
+    emitRRImm(b, kPrefix_66, kOp_PSHUFD, xmm, xmm, SHUF_SPLAT(0));
+}
+
+static void emitRoundPS(FPCJITBuffer *b, int dstXmm, int srcXmm, int mode)
+{
+    emit8(b, 0x66);
+    emit8(b, 0x0f);
+    emit8(b, 0x3a);
+    emit8(b, 0x08);
+    emit8(b, 0xc0 | (dstXmm << 3) | srcXmm);
+    emit8(b, mode);
+}
+
+static void emitCall(FPCJITBuffer *b, const void *func)
+{
+    emit8(b, 0x48);  // mov rax, imm64
+    emit8(b, 0xb8);
+    emit64(b, (uint64_t)(uintptr_t)func);
+    emit8(b, 0xff);  // call rax
+    emit8(b, 0xd0);
+}
+
+#define ONE_BITS        0x3f800000
+#define HALF_BITS       0x3f000000
+#define INF_BITS        0x7f800000
+#define ABSMASK_BITS    0x7fffffff
+
+
+static void emitLoadSource(FPCJITBuffer *b, int xmm, const uint16_t *src)
+{
+    const int base = src[0] & ~3;
+    int imm = 0;
+    int k;
+
+    // the compiler resolves each source to a single register or constant slot
+    for (k = 0; k < 4; k++) {
+        if ((src[k] & ~3) != base) {
+            b->failed = YES;
+            return;
+        }
+        imm |= (src[k] & 3) << (k * 2);
+    }
+
+    emitRM(b, kPrefix_None, kOp_MOVUPS_load, xmm, base);
+    if (imm != SHUF_IDENTITY)
+        emitRRImm(b, kPrefix_None, kOp_SHUFPS, xmm, xmm, imm);
+}
+
+// same arithmetic as CLAMP_SAT_F: ((1 + |x|) - |x - 1|) * 0.5; in/out in xmm0
+static void emitSaturate(FPCJITBuffer *b)
+{
+    emitSplatConst(b, 1, ONE_BITS);
+    emitSplatConst(b, 2, ABSMASK_BITS);
+    emitRR(b, kPrefix_None, kOp_MOVAPS, 3, 0);
+    emitRR(b, kPrefix_None, kOp_SUBPS, 3, 1);
+    emitRR(b, kPrefix_None, kOp_ANDPS, 3, 2);
+    emitRR(b, kPrefix_None, kOp_MOVAPS, 4, 0);
+    emitRR(b, kPrefix_None, kOp_ANDPS, 4, 2);
+    emitRR(b, kPrefix_None, kOp_ADDPS, 1, 4);
+    emitRR(b, kPrefix_None, kOp_SUBPS, 1, 3);
+    emitSplatConst(b, 2, HALF_BITS);
+    emitRR(b, kPrefix_None, kOp_MULPS, 1, 2);
+    emitRR(b, kPrefix_None, kOp_MOVAPS, 0, 1);
+}
+
+// result lanes are in xmm0
+static void emitStoreResult(FPCJITBuffer *b, const FPClosureOp *op)
+{
+    const int selImm = SHUF_IMM(op->dstSel[0], op->dstSel[1], op->dstSel[2], op->dstSel[3]);
+    int p;
+
+    if (op->dstMask == 0xf) {
+        if (selImm != SHUF_IDENTITY)
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, selImm);
+        emitRM(b, kPrefix_None, kOp_MOVUPS_store, 0, op->dst);
+    } else {
+        for (p = 0; p < 4; p++) {
+            if ( !(op->dstMask & (1 << p))) continue;
+
+            if (op->dstSel[p] == 0) {
+                emitRM(b, kPrefix_F3, kOp_MOVUPS_store, 0, op->dst + p);  // movss
+            } else {
+                emitRR(b, kPrefix_None, kOp_MOVAPS, 1, 0);
+                emitRRImm(b, kPrefix_None, kOp_SHUFPS, 1, 1, SHUF_SPLAT(op->dstSel[p]));
+                emitRM(b, kPrefix_F3, kOp_MOVUPS_store, 1, op->dst + p);
+            }
+        }
+    }
+
+    // like the interpreter, _SAT clamps the whole dst register
+    if (op->flags & kFPClosureOpFlag_Sat) {
+        emitRM(b, kPrefix_None, kOp_MOVUPS_load, 0, op->dst);
+        emitSaturate(b);
+        emitRM(b, kPrefix_None, kOp_MOVUPS_store, 0, op->dst);
+    }
+}
+
+
+// scalar helpers that must match the interpreter's expressions exactly
+static float fpcJIT_ex2(float v)
+{
+    return powf(2.0f, v);
+}
+
+static float fpcJIT_lg2(float v)
+{
+    v = logf(v);
+    v /= logf(2.0f);
+    return v;
+}
+
+static float fpcJIT_pow(float a, float b)
+{
+    return powf(a, b);
+}
+
+static float fpcJIT_sin(float v)
+{
+    return sinf(v);
+}
+
+static float fpcJIT_cos(float v)
+{
+    return cosf(v);
+}
+
+
+static LXBool hasSSE41()
+{
+    static int s_has = -1;
+    if (s_has < 0) {
+        __builtin_cpu_init();
+        s_has = __builtin_cpu_supports("sse4.1") ? 1 : 0;
+    }
+    return (s_has) ? YES : NO;
+}
+
+
+static LXBool emitOp(FPCJITBuffer *b, const FPClosureOp *op)
+{
+    const int argCount = (op->op == FPClosureToken_CMP || op->op == FPClosureToken_LRP || op->op == FPClosureToken_MAD) ? 3
+                       : (op->op == FPClosureToken_ADD || op->op == FPClosureToken_DP3 || op->op == FPClosureToken_MAX
+                          || op->op == FPClosureToken_MIN || op->op == FPClosureToken_MUL || op->op == FPClosureToken_POW
+                          || op->op == FPClosureToken_SUB) ? 2
+                       : 1;
+    int i;
+
+    for (i = 0; i < argCount; i++)
+        emitLoadSource(b, i, op->src[i]);
+
+    switch (op->op) {
+        case FPClosureToken_ABS:
+            emitSplatConst(b, 3, ABSMASK_BITS);
+            emitRR(b, kPrefix_None, kOp_ANDPS, 0, 3);
+            break;
+
+        case FPClosureToken_ADD:    emitRR(b, kPrefix_None, kOp_ADDPS, 0, 1);  break;
+        case FPClosureToken_SUB:    emitRR(b, kPrefix_None, kOp_SUBPS, 0, 1);  break;
+        case FPClosureToken_MUL:    emitRR(b, kPrefix_None, kOp_MULPS, 0, 1);  break;
+        case FPClosureToken_MAX:    emitRR(b, kPrefix_None, kOp_MAXPS, 0, 1);  break;  // maxps is (a > b) ? a : b
+        case FPClosureToken_MIN:    emitRR(b, kPrefix_None, kOp_MINPS, 0, 1);  break;  // minps is (a < b) ? a : b
+        case FPClosureToken_MOV:    break;
+
+        case FPClosureToken_MAD:
+            emitRR(b, kPrefix_None, kOp_MULPS, 0, 1);
+            emitRR(b, kPrefix_None, kOp_ADDPS, 0, 2);
+            break;
+
+        case FPClosureToken_LRP:  // a*b + (1 - a)*c
+            emitSplatConst(b, 3, ONE_BITS);
+            emitRR(b, kPrefix_None, kOp_SUBPS, 3, 0);
+            emitRR(b, kPrefix_None, kOp_MULPS, 3, 2);
+            emitRR(b, kPrefix_None, kOp_MULPS, 0, 1);
+            emitRR(b, kPrefix_None, kOp_ADDPS, 0, 3);
+            break;
+
+        case FPClosureToken_CMP:  // (a < 0) ? b : c
+            emitRR(b, kPrefix_None, kOp_XORPS, 3, 3);
+            emitRRImm(b, kPrefix_None, kOp_CMPPS, 0, 3, kCmp_LT);
+            emitRR(b, kPrefix_None, kOp_ANDPS, 1, 0);
+            emitRR(b, kPrefix_None, kOp_ANDNPS, 0, 2);
+            emitRR(b, kPrefix_None, kOp_ORPS, 0, 1);
+            break;
+
+        case FPClosureToken_FLR:
+            if ( !hasSSE41()) return NO;
+            emitRoundPS(b, 0, 0, kRound_Floor);
+            break;
+
+        case FPClosureToken_FRC:
+            if ( !hasSSE41()) return NO;
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 1, 0);
+            emitRoundPS(b, 1, 1, kRound_Floor);
+            emitRR(b, kPrefix_None, kOp_SUBPS, 0, 1);
+            break;
+
+        case FPClosureToken_DP3:  // ((a0*b0) + (a1*b1)) + (a2*b2)
+            emitRR(b, kPrefix_None, kOp_MULPS, 0, 1);
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 2, 0);
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 2, 2, SHUF_SPLAT(1));
+            emitRR(b, kPrefix_F3, kOp_ADDPS, 0, 2);  // addss
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 2, 0);
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 2, 2, SHUF_SPLAT(2));
+            emitRR(b, kPrefix_F3, kOp_ADDPS, 0, 2);
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));
+            break;
+
+        case FPClosureToken_RCP:  // (a == 0) ? inf : 1/a, without dividing by zero
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));
+            emitRR(b, kPrefix_None, kOp_XORPS, 2, 2);
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 3, 0);
+            emitRRImm(b, kPrefix_None, kOp_CMPPS, 3, 2, kCmp_EQ);
+            emitSplatConst(b, 1, ONE_BITS);
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 4, 3);
+            emitRR(b, kPrefix_None, kOp_ANDPS, 4, 1);
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 5, 3);
+            emitRR(b, kPrefix_None, kOp_ANDNPS, 5, 0);
+            emitRR(b, kPrefix_None, kOp_ORPS, 4, 5);
+            emitRR(b, kPrefix_None, kOp_DIVPS, 1, 4);
+            emitSplatConst(b, 5, INF_BITS);
+            emitRR(b, kPrefix_None, kOp_ANDPS, 5, 3);
+            emitRR(b, kPrefix_None, kOp_ANDNPS, 3, 1);
+            emitRR(b, kPrefix_None, kOp_ORPS, 3, 5);
+            emitRR(b, kPrefix_None, kOp_MOVAPS, 0, 3);
+            break;
+
+        case FPClosureToken_RSQ:
+            emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));
+            emitRR(b, kPrefix_None, kOp_SQRTPS, 1, 0);
+            emitSplatConst(b, 0, ONE_BITS);
+            emitRR(b, kPrefix_None, kOp_DIVPS, 0, 1);
+            break;
+
+        // scalar args are already in the low lanes of xmm0/xmm1; rbx is callee-saved, so the file pointer survives the call
+        case FPClosureToken_SIN:    emitCall(b, (const void *)fpcJIT_sin);  emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));  break;
+        case FPClosureToken_COS:    emitCall(b, (const void *)fpcJIT_cos);  emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));  break;
+        case FPClosureToken_EX2:    emitCall(b, (const void *)fpcJIT_ex2);  emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));  break;
+        case FPClosureToken_LG2:    emitCall(b, (const void *)fpcJIT_lg2);  emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));  break;
+        case FPClosureToken_POW:    emitCall(b, (const void *)fpcJIT_pow);  emitRRImm(b, kPrefix_None, kOp_SHUFPS, 0, 0, SHUF_SPLAT(0));  break;
+
+        default:
+            return NO;
+    }
+
+    emitStoreResult(b, op);
+    return !b->failed;
+}
+
+
+static void *createJITCode(const FPClosure *fp, size_t *outSize)
+{
+    FPCJITBuffer b;
+    const size_t pageSize = 4096;
+    size_t mapSize;
+    void *code;
+    unsigned int i;
+
+    memset(&b, 0, sizeof(b));
+    b.cap = 64 + fp->opCount * 256;  // the longest op (RCP_SAT with a partial dst mask) is well under this
+    b.buf = (uint8_t *) _lx_malloc(b.cap);
+
+    emit8(&b, 0x53);  // push rbx -- also aligns the stack to 16 bytes for the libm calls
+    emit8(&b, 0x48);  // mov rbx, rdi
+    emit8(&b, 0x89);
+    emit8(&b, 0xfb);
+
+    for (i = 0; i < fp->opCount; i++) {
+        if ( !emitOp(&b, fp->ops + i)) {
+            b.failed = YES;
+            break;
+        }
+    }
+
+    emit8(&b, 0x5b);  // pop rbx
+    emit8(&b, 0xc3);  // ret
+
+    if (b.failed) {
+        _lx_free(b.buf);
+        return NULL;
+    }
+
+    // write the code, then flip the pages to executable
+    mapSize = (b.len + pageSize - 1) & ~(pageSize - 1);
+    code = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (code == MAP_FAILED) {
+        _lx_free(b.buf);
+        return NULL;
+    }
+    memcpy(code, b.buf, b.len);
+    _lx_free(b.buf);
+
+    if (0 != mprotect(code, mapSize, PROT_READ | PROT_EXEC)) {
+        // e.g. hardened runtime without the JIT entitlement
+        munmap(code, mapSize);
+        return NULL;
+    }
+
+#if (PRINT_JIT)
+    printf("FPClosure JIT: %i ops -> %i bytes\n", (int)fp->opCount, (int)b.len);
+#endif
+    *outSize = mapSize;
+    return code;
+}
+
+
+LXSuccess LXFPClosureJITAcquire(FPClosure *fp, const char *fpStr, size_t fpStrLen)
+{
+    FPCJITEntry *entry;
+
+    if ( !fp || !fpStr || fp->compileErr || fp->opCount < 1)
+        return NO;
+
+    LXMutexLock(g_lxAtomicLock);
+
+    for (entry = s_jitCache; entry; entry = entry->next) {
+        if (entry->progStrLen == fpStrLen && 0 == memcmp(entry->progStr, fpStr, fpStrLen))
+            break;
+    }
+
+    if ( !entry) {
+        size_t codeSize = 0;
+        void *code = createJITCode(fp, &codeSize);
+
+        if (code) {
+            entry = (FPCJITEntry *) _lx_calloc(1, sizeof(FPCJITEntry));
+            entry->progStr = (char *) _lx_malloc(fpStrLen + 1);
+            memcpy(entry->progStr, fpStr, fpStrLen);
+            entry->progStr[fpStrLen] = '\0';
+            entry->progStrLen = fpStrLen;
+            entry->code = code;
+            entry->codeSize = codeSize;
+            entry->next = s_jitCache;
+            s_jitCache = entry;
+        }
+    }
+
+    if (entry) {
+        entry->refCount++;
+        fp->jitEntry = entry;
+        fp->jitFunc = (LXFPClosureJITFunc) entry->code;
+    }
+
+    LXMutexUnlock(g_lxAtomicLock);
+
+    return (entry) ? YES : NO;
+}
+
+
+void LXFPClosureJITRelease(FPClosure *fp)
+{
+    FPCJITEntry *entry = (fp) ? (FPCJITEntry *)fp->jitEntry : NULL;
+    if ( !entry) return;
+
+    LXMutexLock(g_lxAtomicLock);
+
+    if (--entry->refCount == 0) {
+        FPCJITEntry **prev = &s_jitCache;
+        while (*prev != entry)
+            prev = &((*prev)->next);
+        *prev = entry->next;
+    } else {
+        entry = NULL;
+    }
+
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if (entry) {
+        munmap(entry->code, entry->codeSize);
+        _lx_free(entry->progStr);
+        _lx_free(entry);
+    }
+    fp->jitEntry = NULL;
+    fp->jitFunc = NULL;
+}
+
+
+#endif  // LX_HAS_FPCLOSURE_JIT
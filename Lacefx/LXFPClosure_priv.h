@@ -0,0 +1,218 @@
+/*
+ *  LXFPClosure_priv.h
+ *  Lacefx
+ *
+ *  Copyright 2007 Lacquer oy/ltd.
+ *
+ 
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ 
+ */
+
+#ifndef _LXFPCLOSURE_PRIV_H_
+#define _LXFPCLOSURE_PRIV_H_
+
+#include "LXFPClosure.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+ #include <emmintrin.h>
+#endif
+
+// native code generation for compiled FPClosure programs is available on x86-64 Mac and Linux
+#if defined(__x86_64__) && (defined(LXPLATFORM_MAC) || defined(LXPLATFORM_LINUX)) && defined(__GNUC__)
+ #define LX_HAS_FPCLOSURE_JIT 1
+#else
+ #define LX_HAS_FPCLOSURE_JIT 0
+#endif
+
+
+// takes the register file, see LXFPClosureExecute_f()
+typedef void (*LXFPClosureJITFunc)(float *regFile);
+
+
+typedef enum {
+	FPClosureToken_NOP = 0,
+	
+	FPClosureToken_ABS,
+	FPClosureToken_ADD,
+	FPClosureToken_CMP,
+	FPClosureToken_DP3,
+	FPClosureToken_EX2,
+	FPClosureToken_FLR,
+	FPClosureToken_FRC,
+	FPClosureToken_LG2,
+	FPClosureToken_LRP,
+	
+	FPClosureToken_MAD = 10,
+	FPClosureToken_MAX,
+	FPClosureToken_MIN,
+	FPClosureToken_MOV,
+	FPClosureToken_MUL,
+	FPClosureToken_POW,
+	FPClosureToken_RCP,
+	FPClosureToken_RSQ,
+	FPClosureToken_SIN,
+	FPClosureToken_COS,
+	FPClosureToken_SUB,
+    
+    FPClosureTokenOpcodeMask = (1 << 8) - 1
+} FPClosureToken;
+
+typedef enum {
+    FPTokenModifier_SAT = 1 << 8
+} FPClosureTokenModifier;
+
+
+typedef enum {							// # of anteceding values:
+	FPClosureArg_ConstZero = 1,	  		// 0
+	FPClosureArg_ConstFloat,  			// 1 (the const as a float)
+	FPClosureArg_ConstFloatVec,			// 4 (the vector const)
+
+	FPClosureArg_Register,				// 1 (index of the register)
+} FPClosureArg;
+
+
+typedef union {
+	unsigned int arg;  // this contains both an FPClosureArg, as well as a swizzle mask in the high bits (use SWIZZLEMASK/SWIZZLESHR to access it)
+	int index;
+	float f;
+} FPClosureArgValue;
+
+
+// the token/arg stream isn't executed directly: LXFPClosureCreateWithString() lowers it into a flat list of FPClosureOps.
+// every register and constant referenced by the program gets a dense slot in a small register file (constants after registers),
+// source swizzles are resolved into per-component float offsets within that file, and the dst swizzle into a write mask + lane selectors.
+
+enum {
+    kFPClosureOpFlag_Sat = 1 << 0
+};
+
+typedef struct {
+    uint8_t op;                 // FPClosureToken opcode; NOP terminates the program
+    uint8_t flags;
+    uint8_t dstMask;            // bit n is set if dst channel n is written
+    uint8_t dstSel[4];          // result lane stored into each written dst channel
+    uint16_t dst;               // float offset of the dst register within the register file
+    uint16_t src[3][4];         // float offset of each swizzled source component
+} FPClosureOp;
+
+typedef struct {
+    uint16_t offset;            // float offset of the input register within the register file
+    uint8_t isVector;
+    uint8_t index;              // 0-based index into the caller's scalars/vectors
+} FPClosureInputSlot;
+
+
+typedef struct _FPClosure {
+	char inputsInUse[16];
+	unsigned int tokenCount;
+	FPClosureToken *tokenList;			// array of token instr strings (e.g. "MUL")
+	unsigned int tokenArgCount;
+	FPClosureArgValue *args;			// flat array containing all arguments for all tokens (must iterate through tokenArgBytesList to find a particular argument set)
+
+    // compiled program, see CompileFPClosure()
+    int compileErr;
+    unsigned int opCount;
+    FPClosureOp *ops;                   // opCount ops followed by a NOP terminator
+    unsigned int slotCount;             // registers + constants in the register file
+    unsigned int regSlotCount;          // the first regSlotCount slots are registers, the rest is the constant bank
+    float *slotTemplate;                // initial register file contents: zeroed registers followed by the constant bank
+    unsigned int inputSlotCount;
+    FPClosureInputSlot *inputSlots;
+    int resultOffset;                   // float offset of the result register, or -1 if nothing is written
+
+    // native code for the compiled program, see LXFPClosure_jit.c
+    void *jitEntry;
+    LXFPClosureJITFunc jitFunc;
+} FPClosure;
+
+
+
+// 4-wide float vector ops used by the FPClosure batch executor and the CPU shader engine (LXShader_cpu.c).
+// without SSE2, the vector is a single float.
+
+#if defined(__SSE2__)
+ typedef __m128 FPCVec;
+ #define FPCV_WIDTH             4
+ #define FPCV_LOAD(p_)          _mm_load_ps(p_)
+ #define FPCV_STORE(p_, v_)     _mm_store_ps(p_, v_)
+ #define FPCV_SPLAT(f_)         _mm_set1_ps(f_)
+ #define FPCV_ADD(a_, b_)       _mm_add_ps(a_, b_)
+ #define FPCV_SUB(a_, b_)       _mm_sub_ps(a_, b_)
+ #define FPCV_MUL(a_, b_)       _mm_mul_ps(a_, b_)
+ #define FPCV_DIV(a_, b_)       _mm_div_ps(a_, b_)
+ #define FPCV_SQRT(a_)          _mm_sqrt_ps(a_)
+ #define FPCV_MAX(a_, b_)       _mm_max_ps(a_, b_)      // same as (a > b) ? a : b, including NaNs
+ #define FPCV_MIN(a_, b_)       _mm_min_ps(a_, b_)      // same as (a < b) ? a : b
+ #define FPCV_ABS(a_)           _mm_and_ps(a_, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)))
+ #define FPCV_LT(a_, b_)        _mm_cmplt_ps(a_, b_)
+ #define FPCV_EQ(a_, b_)        _mm_cmpeq_ps(a_, b_)
+ #define FPCV_SELECT(m_, a_, b_)  _mm_or_ps(_mm_and_ps(m_, a_), _mm_andnot_ps(m_, b_))
+
+ #if defined(__SSE4_1__)
+  #include <smmintrin.h>
+  #define FPCV_FLOOR(a_)        _mm_floor_ps(a_)
+ #else
+  #define FPCV_FLOOR(a_)        floorVec_SSE2(a_)
+
+LXINLINE __m128 floorVec_SSE2(__m128 x)
+{
+    const __m128 signBit = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    const __m128 one = _mm_set1_ps(1.0f);
+    // values at or above 2^23 (and NaN/inf) are already integral
+    const __m128 isSmall = _mm_cmplt_ps(_mm_andnot_ps(signBit, x), _mm_set1_ps(8388608.0f));
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+
+    t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), one));
+    t = _mm_or_ps(t, _mm_and_ps(x, signBit));  // floorf(-0.0) == -0.0
+    return _mm_or_ps(_mm_and_ps(isSmall, t), _mm_andnot_ps(isSmall, x));
+}
+ #endif
+#else
+ typedef float FPCVec;
+ #define FPCV_WIDTH             1
+ #define FPCV_LOAD(p_)          (*(p_))
+ #define FPCV_STORE(p_, v_)     (*(p_) = (v_))
+ #define FPCV_SPLAT(f_)         (f_)
+ #define FPCV_ADD(a_, b_)       ((a_) + (b_))
+ #define FPCV_SUB(a_, b_)       ((a_) - (b_))
+ #define FPCV_MUL(a_, b_)       ((a_) * (b_))
+ #define FPCV_DIV(a_, b_)       ((a_) / (b_))
+ #define FPCV_SQRT(a_)          sqrtf(a_)
+ #define FPCV_MAX(a_, b_)       MAX(a_, b_)
+ #define FPCV_MIN(a_, b_)       MIN(a_, b_)
+ #define FPCV_ABS(a_)           FABSF(a_)
+ #define FPCV_LT(a_, b_)        ((a_) < (b_))
+ #define FPCV_EQ(a_, b_)        ((a_) == (b_))
+ #define FPCV_SELECT(m_, a_, b_)  ((m_) ? (a_) : (b_))
+ #define FPCV_FLOOR(a_)         floorf(a_)
+#endif
+
+#define FPCV_FRC(a_)            FPCV_SUB(a_, FPCV_FLOOR(a_))
+#define FPCV_CMP(a_, b_, c_)    FPCV_SELECT(FPCV_LT(a_, FPCV_SPLAT(0.0f)), b_, c_)
+#define FPCV_LRP(a_, b_, c_)    FPCV_ADD(FPCV_MUL(a_, b_), FPCV_MUL(FPCV_SUB(FPCV_SPLAT(1.0f), a_), c_))
+#define FPCV_MAD(a_, b_, c_)    FPCV_ADD(FPCV_MUL(a_, b_), c_)
+#define FPCV_SAT(a_)            FPCV_MUL(FPCV_SUB(FPCV_ADD(FPCV_SPLAT(1.0f), FPCV_ABS(a_)), FPCV_ABS(FPCV_SUB(a_, FPCV_SPLAT(1.0f)))), \
+                                         FPCV_SPLAT(0.5f))   // same arithmetic as CLAMP_SAT_F
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (LX_HAS_FPCLOSURE_JIT)
+// generates native code for fp's compiled ops, or returns a cached function for an identical program string.
+// on success, sets fp->jitFunc and fp->jitEntry; returns NO if the program can't be translated
+LXSuccess LXFPClosureJITAcquire(FPClosure *fp, const char *fpStr, size_t fpStrLen);
+
+void LXFPClosureJITRelease(FPClosure *fp);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LXFPCLOSURE_PRIV_H_
@@ -470,11 +470,11 @@ LXFUNCATTR_SSE static void LXConvertFloatToHalfArray_SSE2_blocksOf8(const float
         
         // Round off by adding 1 before shifting.  Note that if the mantissa
         // overflows, then one is added to the exponent and the mantissa becomes
-        // zero, so it still works.
+        // zero, so it still works -- but only if the parts are added rather than or'ed.
         vuint16_t shifted_m = _mm_srli_epi16(_mm_add_epi16(result_m, one_s16), 1);
         vuint16_t shifted_e = _mm_slli_epi16((vuint16_t)result_e, 10);
         
-        vuint16_t result = _mm_or_si128(shifted_m, shifted_e);
+        vuint16_t result = _mm_add_epi16(shifted_m, shifted_e);
         
         vsint16_t is_tiny = _mm_cmplt_epi16(result_e, one_s16);
 
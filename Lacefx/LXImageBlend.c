@@ -0,0 +1,705 @@
+/*
+ *  LXImageBlend.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXImageBlend.h"
+#include "LXImageFunctions.h"
+#include "LXPixelBuffer.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+enum {
+    kValueInt8 = 0,
+    kValueFloat16,
+    kValueFloat32
+};
+
+enum {
+    kBlendOp_Average = 0,
+    kBlendOp_Over
+};
+
+// outputs larger than this are written with non-temporal stores
+#define BLEND_STREAMBYTES       (4 * 1024 * 1024)
+
+// half-float rows are processed through float buffers in chunks of this many values
+#define BLEND_F16_CHUNK         1024
+
+// 8-bit weights are in 1.15 fixed point and sum to this
+#define W15_ONE                 32768
+
+#define ISALIGNED16(p_)         (((uintptr_t)(p_) & 15) == 0)
+
+
+// one plane of the images being blended
+typedef struct {
+    LXInteger op;
+    LXInteger valueType;
+    LXInteger count;
+    // inputs; for "over", 0 is the foreground and 1 the background. an odd count is padded with a zero-weight input
+    const uint8_t *src[kLXImageBlend_MaxInputs + 1];
+    size_t srcRowBytes[kLXImageBlend_MaxInputs + 1];
+    uint8_t *dst;
+    size_t dstRowBytes;
+    LXInteger samples;      // values per row
+    LXInteger rows;
+    LXInteger alphaIndex;
+    float weights[kLXImageBlend_MaxInputs + 1];
+    int16_t weights15[kLXImageBlend_MaxInputs + 1];
+    float opacity;
+    LXBool stream;
+} LXBlendJob;
+
+
+#pragma mark --- 8-bit kernels ---
+
+static void averageRow_int8(const LXBlendJob *job, const uint8_t **src, uint8_t *dst, const LXInteger n)
+{
+    const LXInteger count = job->count;
+    LXInteger x = 0, i;
+
+#if defined(__SSE2__)
+    const LXBool stream = job->stream && ISALIGNED16(dst);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd = _mm_set1_epi32(W15_ONE / 2);
+    __m128i wpairs[(kLXImageBlend_MaxInputs + 1) / 2];
+
+    // pmaddwd multiplies pairs of 16-bit values and sums them, so inputs are processed two at a time
+    for (i = 0; i < count; i += 2) {
+        wpairs[i / 2] = _mm_set1_epi32((uint16_t)job->weights15[i] | ((uint32_t)(uint16_t)job->weights15[i + 1] << 16));
+    }
+
+    for (; x + 16 <= n; x += 16) {
+        __m128i acc0 = rnd, acc1 = rnd, acc2 = rnd, acc3 = rnd;
+
+        for (i = 0; i < count; i += 2) {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(src[i] + x));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(src[i + 1] + x));
+            const __m128i alo = _mm_unpacklo_epi8(a, zero);
+            const __m128i ahi = _mm_unpackhi_epi8(a, zero);
+            const __m128i blo = _mm_unpacklo_epi8(b, zero);
+            const __m128i bhi = _mm_unpackhi_epi8(b, zero);
+            const __m128i w = wpairs[i / 2];
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), w));
+        }
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc0, 15), _mm_srai_epi32(acc1, 15));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc2, 15), _mm_srai_epi32(acc3, 15));
+        const __m128i v = _mm_packus_epi16(lo, hi);
+
+        if (stream)
+            _mm_stream_si128((__m128i *)(dst + x), v);
+        else
+            _mm_storeu_si128((__m128i *)(dst + x), v);
+    }
+#endif
+
+    for (; x < n; x++) {
+        int32_t acc = W15_ONE / 2;
+        for (i = 0; i < count; i++) {
+            acc += src[i][x] * job->weights15[i];
+        }
+        dst[x] = (uint8_t)MIN(255, acc >> 15);
+    }
+}
+
+#if defined(__SSE2__)
+// the 16 bytes of v as floats, four per vector
+LXINLINE void bytesToFloats(__m128i v, __m128 *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    out[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    out[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    out[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    out[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+#endif
+
+// computed in float and rounded once at the end, so the result is within half a step of the exact value
+static void overRow_int8(const LXBlendJob *job, const uint8_t *fg, const uint8_t *bg, uint8_t *dst, const LXInteger n)
+{
+    const LXInteger alphaIndex = job->alphaIndex;
+    const float op = job->opacity;
+    const float opAlpha = op / 255.0f;
+    LXInteger x = 0;
+
+#if defined(__SSE2__)
+    const LXBool stream = job->stream && ISALIGNED16(dst);
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)alphaIndex * 8);
+    const __m128 vop = _mm_set1_ps(op);
+    const __m128 vopAlpha = _mm_set1_ps(opAlpha);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; x + 4 <= n; x += 4) {
+        const __m128i f = _mm_loadu_si128((const __m128i *)(fg + x*4));
+        const __m128i b = _mm_loadu_si128((const __m128i *)(bg + x*4));
+        __m128 ff[4], bf[4], af[4];
+        __m128i r[4];
+        int i;
+
+        // alpha of the foreground in every byte of its pixel
+        __m128i a = _mm_and_si128(_mm_srl_epi32(f, alphaShift), byteMask);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+        bytesToFloats(f, ff);
+        bytesToFloats(b, bf);
+        bytesToFloats(a, af);
+
+        for (i = 0; i < 4; i++) {
+            const __m128 v = _mm_add_ps(_mm_mul_ps(ff[i], vop), _mm_mul_ps(bf[i], _mm_sub_ps(one, _mm_mul_ps(af[i], vopAlpha))));
+            r[i] = _mm_cvtps_epi32(v);
+        }
+        const __m128i v = _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3]));
+
+        if (stream)
+            _mm_stream_si128((__m128i *)(dst + x*4), v);
+        else
+            _mm_storeu_si128((__m128i *)(dst + x*4), v);
+    }
+#endif
+
+    for (; x < n; x++) {
+        const uint8_t *f = fg + x*4;
+        const uint8_t *b = bg + x*4;
+        const float ia = 1.0f - f[alphaIndex] * opAlpha;
+        LXInteger i;
+        for (i = 0; i < 4; i++) {
+            const long v = lrintf(f[i] * op + b[i] * ia);
+            dst[x*4 + i] = (uint8_t)MAX(0, MIN(255, v));
+        }
+    }
+}
+
+
+#pragma mark --- float kernels ---
+
+// acc = (first) ? s * w : acc + s * w
+static void accumulateRow_float32(const float *s, float *acc, const LXInteger n, const float w, const LXBool first)
+{
+    LXInteger x = 0;
+
+#if defined(__SSE2__)
+    const __m128 vw = _mm_set1_ps(w);
+    if (first) {
+        for (; x + 4 <= n; x += 4) {
+            _mm_storeu_ps(acc + x, _mm_mul_ps(_mm_loadu_ps(s + x), vw));
+        }
+    } else {
+        for (; x + 4 <= n; x += 4) {
+            _mm_storeu_ps(acc + x, _mm_add_ps(_mm_loadu_ps(acc + x), _mm_mul_ps(_mm_loadu_ps(s + x), vw)));
+        }
+    }
+#endif
+
+    for (; x < n; x++) {
+        acc[x] = (first) ? s[x] * w : acc[x] + s[x] * w;
+    }
+}
+
+static void averageRow_float32(const LXBlendJob *job, const float **src, float *dst, const LXInteger n)
+{
+    const LXInteger count = job->count;
+    LXInteger x = 0, i;
+
+#if defined(__SSE2__)
+    const LXBool stream = job->stream && ISALIGNED16(dst);
+
+    // all inputs are summed in registers, so the output is written once
+    for (; x + 8 <= n; x += 8) {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (i = 0; i < count; i++) {
+            const __m128 w = _mm_set1_ps(job->weights[i]);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(src[i] + x), w));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(src[i] + x + 4), w));
+        }
+        if (stream) {
+            _mm_stream_ps(dst + x, acc0);
+            _mm_stream_ps(dst + x + 4, acc1);
+        } else {
+            _mm_storeu_ps(dst + x, acc0);
+            _mm_storeu_ps(dst + x + 4, acc1);
+        }
+    }
+#endif
+
+    for (; x < n; x++) {
+        float acc = 0.0f;
+        for (i = 0; i < count; i++) {
+            acc += src[i][x] * job->weights[i];
+        }
+        dst[x] = acc;
+    }
+}
+
+// "n" is the number of pixels
+static void overRow_float32(const LXBlendJob *job, const float *fg, const float *bg, float *dst, const LXInteger n)
+{
+    const float op = job->opacity;
+    LXInteger x = 0;
+
+#if defined(__SSE2__)
+    const LXBool stream = job->stream && ISALIGNED16(dst);
+    const __m128 vop = _mm_set1_ps(op);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; x < n; x++) {
+        const __m128 f = _mm_mul_ps(_mm_loadu_ps(fg + x*4), vop);
+        const __m128 ia = _mm_sub_ps(one, _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 3, 3, 3)));
+        const __m128 v = _mm_add_ps(f, _mm_mul_ps(_mm_loadu_ps(bg + x*4), ia));
+        if (stream)
+            _mm_stream_ps(dst + x*4, v);
+        else
+            _mm_storeu_ps(dst + x*4, v);
+    }
+#else
+    for (; x < n; x++) {
+        const float ia = 1.0f - fg[x*4 + 3] * op;
+        LXInteger i;
+        for (i = 0; i < 4; i++) {
+            dst[x*4 + i] = fg[x*4 + i] * op + bg[x*4 + i] * ia;
+        }
+    }
+#endif
+}
+
+static void averageRow_float16(const LXBlendJob *job, const LXHalf **src, LXHalf *dst, const LXInteger n)
+{
+    float tmp[BLEND_F16_CHUNK];
+    float acc[BLEND_F16_CHUNK];
+    LXInteger x, i;
+
+    for (x = 0; x < n; x += BLEND_F16_CHUNK) {
+        const LXInteger count = MIN(BLEND_F16_CHUNK, n - x);
+        for (i = 0; i < job->count; i++) {
+            LXConvertHalfToFloatArray((LXHalf *)(src[i] + x), tmp, count);
+            accumulateRow_float32(tmp, acc, count, job->weights[i], (i == 0));
+        }
+        LXConvertFloatToHalfArray(acc, dst + x, count);
+    }
+}
+
+static void overRow_float16(const LXBlendJob *job, const LXHalf *fg, const LXHalf *bg, LXHalf *dst, const LXInteger n)
+{
+    float f[BLEND_F16_CHUNK];
+    float b[BLEND_F16_CHUNK];
+    LXInteger x;
+
+    for (x = 0; x < n; x += BLEND_F16_CHUNK / 4) {
+        const LXInteger count = MIN(BLEND_F16_CHUNK / 4, n - x);
+        LXConvertHalfToFloatArray((LXHalf *)(fg + x*4), f, count * 4);
+        LXConvertHalfToFloatArray((LXHalf *)(bg + x*4), b, count * 4);
+        overRow_float32(job, f, b, f, count);
+        LXConvertFloatToHalfArray(f, dst + x*4, count * 4);
+    }
+}
+
+
+#pragma mark --- jobs ---
+
+static void blendBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    const LXBlendJob *job = (const LXBlendJob *)userData;
+    const uint8_t *src[kLXImageBlend_MaxInputs + 1];
+    LXInteger y, i;
+
+    for (y = y0; y < y1; y++) {
+        uint8_t *dst = job->dst + job->dstRowBytes * y;
+
+        for (i = 0; i < job->count + (job->count & 1); i++) {
+            src[i] = job->src[i] + job->srcRowBytes[i] * y;
+        }
+
+        if (job->op == kBlendOp_Over) {
+            switch (job->valueType) {
+                case kValueInt8:
+                    overRow_int8(job, src[0], src[1], dst, job->samples / 4);
+                    break;
+                case kValueFloat16:
+                    overRow_float16(job, (const LXHalf *)src[0], (const LXHalf *)src[1], (LXHalf *)dst, job->samples / 4);
+                    break;
+                case kValueFloat32:
+                    overRow_float32(job, (const float *)src[0], (const float *)src[1], (float *)dst, job->samples / 4);
+                    break;
+            }
+        } else {
+            switch (job->valueType) {
+                case kValueInt8:
+                    averageRow_int8(job, src, dst, job->samples);
+                    break;
+                case kValueFloat16:
+                    averageRow_float16(job, (const LXHalf **)src, (LXHalf *)dst, job->samples);
+                    break;
+                case kValueFloat32:
+                    averageRow_float32(job, (const float **)src, (float *)dst, job->samples);
+                    break;
+            }
+        }
+    }
+
+#if defined(__SSE2__)
+    // non-temporal stores are weakly ordered, so they must be complete before the band is
+    if (job->stream) _mm_sfence();
+#endif
+}
+
+// rows are split by their RGBA pixels, i.e. groups of four values
+static void runJob(LXBlendJob *job)
+{
+    LXParallelApplyToRowBands((job->samples + 3) / 4, job->rows, 0, 0, blendBand, job);
+}
+
+
+#pragma mark --- images ---
+
+static LXInteger valueTypeForFormat(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_FLOAT16:
+        case kLX_Luminance_FLOAT16:     return kValueFloat16;
+        case kLX_RGBA_FLOAT32:
+        case kLX_Luminance_FLOAT32:     return kValueFloat32;
+        default:                        return kValueInt8;
+    }
+}
+
+// values per row and row count for each plane; returns the number of planes, or 0 for an unknown format
+static LXInteger getPlaneSizes(LXPixelFormat pxFormat, uint32_t w, uint32_t h, LXInteger *samples, LXInteger *rows)
+{
+    const LXInteger cw = (w + 1) / 2;
+    const LXInteger ch = (h + 1) / 2;
+
+    rows[0] = rows[1] = rows[2] = h;
+
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8:
+            samples[0] = (LXInteger)w * 4;
+            return 1;
+
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT16:
+        case kLX_Luminance_FLOAT32:
+            samples[0] = w;
+            return 1;
+
+        case kLX_YCbCr422_INT8:
+            samples[0] = cw * 4;
+            return 1;
+
+        case kLX_YCbCr420_planar_INT8:
+            samples[0] = w;
+            samples[1] = samples[2] = cw;
+            rows[1] = rows[2] = ch;
+            return 3;
+
+        case kLX_YCbCr420_biplanar_INT8:
+            samples[0] = w;
+            samples[1] = cw * 2;
+            rows[1] = ch;
+            return 2;
+
+        case kLX_YCbCr444_planar_INT8:
+            samples[0] = samples[1] = samples[2] = w;
+            return 3;
+    }
+    return 0;
+}
+
+static LXBool hasAlpha(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:  case kLX_RGBA_FLOAT16:  case kLX_RGBA_FLOAT32:
+        case kLX_ARGB_INT8:  case kLX_BGRA_INT8:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+// normalizes the weights into the job and drops inputs with zero weight; returns NO if the weights are invalid
+static LXBool setWeights(LXBlendJob *job, const float *weights, LXInteger count, LXInteger *outIndices)
+{
+    double sum = 0.0;
+    LXInteger i, n = 0, largest = 0, sum15 = 0;
+
+    for (i = 0; i < count; i++) {
+        const float w = (weights) ? weights[i] : 1.0f;
+        if ( !isfinite(w) || w < 0.0f) return NO;
+        sum += w;
+    }
+    if (sum <= 0.0) return NO;
+
+    for (i = 0; i < count; i++) {
+        const float w = (float)(((weights) ? weights[i] : 1.0f) / sum);
+        if (w == 0.0f) continue;
+
+        job->weights[n] = w;
+        job->weights15[n] = (int16_t)MIN(W15_ONE - 1, lroundf(w * W15_ONE));
+        sum15 += job->weights15[n];
+        if (job->weights15[n] > job->weights15[largest]) largest = n;
+        outIndices[n] = i;
+        n++;
+    }
+    job->count = n;
+
+    // the fixed point weights must sum to exactly one so that flat areas keep their value
+    if (job->weights15[largest] + W15_ONE - sum15 < W15_ONE) {
+        job->weights15[largest] += W15_ONE - sum15;
+    }
+    else if (job->valueType == kValueInt8) {
+        // the other inputs round to nothing, so this is a copy
+        outIndices[0] = outIndices[largest];
+        job->count = 1;
+    }
+    return YES;
+}
+
+static void copyPlane(const uint8_t *src, size_t srcRowBytes, uint8_t *dst, size_t dstRowBytes, size_t rowLen, LXInteger rows)
+{
+    LXInteger y;
+    if (src == dst) return;
+    for (y = 0; y < rows; y++) {
+        memcpy(dst + dstRowBytes * y, src + srcRowBytes * y, rowLen);
+    }
+}
+
+static LXSuccess blendImages(LXInteger op, const uint8_t * const *bufs, const size_t *rowBytes, const float *weights, LXInteger count,
+                             uint8_t *dstBuf, size_t dstRowBytes,
+                             uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                             float opacity,
+                             LXError *outError)
+{
+    LXBlendJob job;
+    LXInteger samples[3], rows[3], indices[kLXImageBlend_MaxInputs];
+    size_t dstOffsets[3], dstRbs[3], offsets[3], rbs[3];
+    LXInteger i, plane;
+    float overWeights[2];
+
+    if ( !bufs || !rowBytes || !dstBuf || count < 1) {
+        LXErrorSet(outError, kLXErrorID_ImageBlend_EmptyArg, "empty argument");
+        return NO;
+    }
+    for (i = 0; i < count; i++) {
+        if ( !bufs[i]) {
+            LXErrorSet(outError, kLXErrorID_ImageBlend_EmptyArg, "empty argument");
+            return NO;
+        }
+    }
+    if (count > kLXImageBlend_MaxInputs) {
+        char msg[256];
+        sprintf(msg, "too many images to blend (%ld; max is %d)", (long)count, kLXImageBlend_MaxInputs);
+        LXErrorSet(outError, kLXErrorID_ImageBlend_InvalidWeights, msg);
+        return NO;
+    }
+
+    const LXInteger planeCount = getPlaneSizes(pxFormat, w, h, samples, rows);
+    if (planeCount == 0) {
+        char msg[256];
+        sprintf(msg, "unsupported pixel format for blending (%lu)", (unsigned long)pxFormat);
+        LXErrorSet(outError, kLXErrorID_ImageBlend_UnsupportedPixelFormat, msg);
+        return NO;
+    }
+    if (w < 1 || h < 1) return YES;
+
+    memset(&job, 0, sizeof(job));
+    job.op = op;
+    job.valueType = valueTypeForFormat(pxFormat);
+    job.opacity = MAX(0.0f, MIN(1.0f, opacity));
+    job.alphaIndex = (pxFormat == kLX_ARGB_INT8) ? 0 : 3;
+
+    if (op == kBlendOp_Over && !hasAlpha(pxFormat)) {
+        // opaque foreground
+        overWeights[0] = job.opacity;
+        overWeights[1] = 1.0f - job.opacity;
+        weights = overWeights;
+        job.op = op = kBlendOp_Average;
+    }
+
+    if (op == kBlendOp_Over) {
+        job.count = 2;
+        indices[0] = 0;
+        indices[1] = 1;
+    }
+    else if ( !setWeights(&job, weights, count, indices)) {
+        LXErrorSet(outError, kLXErrorID_ImageBlend_InvalidWeights, "blend weights must be non-negative and not all zero");
+        return NO;
+    }
+
+    const size_t valueSize = (job.valueType == kValueFloat32) ? 4 : ((job.valueType == kValueFloat16) ? 2 : 1);
+    const size_t dstSize = LXPlaneLayoutForPixelFormat(pxFormat, w, h, dstRowBytes, dstOffsets, dstRbs);
+
+    // float16 rows go through float buffers, so they are written by the half conversion
+    job.stream = (dstSize >= BLEND_STREAMBYTES && job.valueType != kValueFloat16);
+
+    for (plane = 0; plane < planeCount; plane++) {
+        for (i = 0; i < job.count; i++) {
+            LXPlaneLayoutForPixelFormat(pxFormat, w, h, rowBytes[indices[i]], offsets, rbs);
+            job.src[i] = bufs[indices[i]] + offsets[plane];
+            job.srcRowBytes[i] = rbs[plane];
+        }
+        if (job.count & 1) {
+            // pmaddwd pairs: the padding input has a weight of zero
+            job.src[job.count] = job.src[job.count - 1];
+            job.srcRowBytes[job.count] = job.srcRowBytes[job.count - 1];
+            job.weights[job.count] = 0.0f;
+            job.weights15[job.count] = 0;
+        }
+        job.dst = dstBuf + dstOffsets[plane];
+        job.dstRowBytes = dstRbs[plane];
+        job.samples = samples[plane];
+        job.rows = rows[plane];
+
+        if (job.op == kBlendOp_Average && job.count == 1) {
+            copyPlane(job.src[0], job.srcRowBytes[0], job.dst, job.dstRowBytes, job.samples * valueSize, job.rows);
+        } else {
+            runJob(&job);
+        }
+    }
+    return YES;
+}
+
+LXSuccess LXImageBlendLerpData(const uint8_t *bufA, size_t rowBytesA,
+                               const uint8_t *bufB, size_t rowBytesB,
+                               uint8_t *dstBuf, size_t dstRowBytes,
+                               uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                               float t,
+                               LXError *outError)
+{
+    const uint8_t *bufs[2] = { bufA, bufB };
+    const size_t rbs[2] = { rowBytesA, rowBytesB };
+    float weights[2];
+
+    t = MAX(0.0f, MIN(1.0f, t));
+    weights[0] = 1.0f - t;
+    weights[1] = t;
+    return blendImages(kBlendOp_Average, bufs, rbs, weights, 2, dstBuf, dstRowBytes, w, h, pxFormat, 1.0f, outError);
+}
+
+LXSuccess LXImageBlendAverageData(const uint8_t * const *bufs, const size_t *rowBytes,
+                                  const float *weights, LXUInteger count,
+                                  uint8_t *dstBuf, size_t dstRowBytes,
+                                  uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                  LXError *outError)
+{
+    return blendImages(kBlendOp_Average, bufs, rowBytes, weights, count, dstBuf, dstRowBytes, w, h, pxFormat, 1.0f, outError);
+}
+
+LXSuccess LXImageBlendOverData(const uint8_t *fgBuf, size_t fgRowBytes,
+                               const uint8_t *bgBuf, size_t bgRowBytes,
+                               uint8_t *dstBuf, size_t dstRowBytes,
+                               uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                               float opacity,
+                               LXError *outError)
+{
+    const uint8_t *bufs[2] = { fgBuf, bgBuf };
+    const size_t rbs[2] = { fgRowBytes, bgRowBytes };
+
+    return blendImages(kBlendOp_Over, bufs, rbs, NULL, 2, dstBuf, dstRowBytes, w, h, pxFormat, opacity, outError);
+}
+
+
+#pragma mark --- pixel buffers ---
+
+static LXSuccess blendPixelBuffers(LXInteger op, LXPixelBufferRef *srcs, const float *weights, LXInteger count,
+                                   LXPixelBufferRef dst, float opacity,
+                                   LXError *outError)
+{
+    const uint8_t *bufs[kLXImageBlend_MaxInputs];
+    size_t rowBytes[kLXImageBlend_MaxInputs];
+    LXInteger i, locked = 0;
+    LXSuccess success = NO;
+
+    if ( !srcs || !dst || count < 1) {
+        LXErrorSet(outError, kLXErrorID_ImageBlend_EmptyArg, "empty argument");
+        return NO;
+    }
+    if (count > kLXImageBlend_MaxInputs) {
+        char msg[256];
+        sprintf(msg, "too many images to blend (%ld; max is %d)", (long)count, kLXImageBlend_MaxInputs);
+        LXErrorSet(outError, kLXErrorID_ImageBlend_InvalidWeights, msg);
+        return NO;
+    }
+
+    const uint32_t w = LXPixelBufferGetWidth(dst);
+    const uint32_t h = LXPixelBufferGetHeight(dst);
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(dst);
+
+    for (i = 0; i < count; i++) {
+        if ( !srcs[i]) {
+            LXErrorSet(outError, kLXErrorID_ImageBlend_EmptyArg, "empty argument");
+            return NO;
+        }
+        if (LXPixelBufferGetWidth(srcs[i]) != w || LXPixelBufferGetHeight(srcs[i]) != h
+                    || LXPixelBufferGetPixelFormat(srcs[i]) != pxFormat) {
+            LXErrorSet(outError, kLXErrorID_ImageBlend_SizeMismatch, "images to blend must have the same size and pixel format");
+            return NO;
+        }
+    }
+
+    size_t dstRowBytes = 0;
+    uint8_t *dstBuf = LXPixelBufferLockPixels(dst, &dstRowBytes, NULL, outError);
+    if ( !dstBuf) return NO;
+
+    for (locked = 0; locked < count; locked++) {
+        bufs[locked] = LXPixelBufferLockPixels(srcs[locked], &rowBytes[locked], NULL, outError);
+        if ( !bufs[locked]) break;
+    }
+
+    if (locked == count) {
+        success = blendImages(op, bufs, rowBytes, weights, count, dstBuf, dstRowBytes, w, h, pxFormat, opacity, outError);
+    }
+
+    for (i = 0; i < locked; i++) {
+        LXPixelBufferUnlockPixels(srcs[i]);
+    }
+    LXPixelBufferUnlockPixels(dst);
+    return success;
+}
+
+LXSuccess LXImageBlendLerp(LXPixelBufferRef a, LXPixelBufferRef b, LXPixelBufferRef dst, float t, LXError *outError)
+{
+    LXPixelBufferRef srcs[2] = { a, b };
+    float weights[2];
+
+    t = MAX(0.0f, MIN(1.0f, t));
+    weights[0] = 1.0f - t;
+    weights[1] = t;
+    return blendPixelBuffers(kBlendOp_Average, srcs, weights, 2, dst, 1.0f, outError);
+}
+
+LXSuccess LXImageBlendAverage(LXPixelBufferRef *srcs, const float *weights, LXUInteger count,
+                              LXPixelBufferRef dst, LXError *outError)
+{
+    return blendPixelBuffers(kBlendOp_Average, srcs, weights, count, dst, 1.0f, outError);
+}
+
+LXSuccess LXImageBlendOver(LXPixelBufferRef fg, LXPixelBufferRef bg, LXPixelBufferRef dst, float opacity, LXError *outError)
+{
+    LXPixelBufferRef srcs[2] = { fg, bg };
+
+    return blendPixelBuffers(kBlendOp_Over, srcs, NULL, 2, dst, opacity, outError);
+}
@@ -0,0 +1,84 @@
+/*
+ *  LXImageBlend.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXIMAGEBLEND_H_
+#define _LXIMAGEBLEND_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+
+
+enum {
+    kLXErrorID_ImageBlend_EmptyArg = 7001,
+    kLXErrorID_ImageBlend_UnsupportedPixelFormat,
+    kLXErrorID_ImageBlend_SizeMismatch,
+    kLXErrorID_ImageBlend_InvalidWeights
+};
+
+// the number of images that can be averaged in one call
+#define kLXImageBlend_MaxInputs  64
+
+
+/*
+  CPU blending of whole images. The inputs and the output have the same size and pixel format, and the output
+  can be one of the inputs. All pixel formats are supported; planar YCbCr images are blended one plane at a time.
+
+  8-bit averages are computed in fixed point and 8-bit "over" in float, both rounded once at the end.
+  Float16 data is blended through float32.
+  Large images are processed in bands on multiple threads, and large outputs are written with non-temporal stores
+  so that they don't push the inputs out of the cache.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// dst = a + (b - a) * t, so a crossfade from A to B is a sequence of these with t going from 0 to 1
+LXEXPORT LXSuccess LXImageBlendLerpData(const uint8_t *bufA, size_t rowBytesA,
+                                        const uint8_t *bufB, size_t rowBytesB,
+                                        uint8_t *dstBuf, size_t dstRowBytes,
+                                        uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                        float t,
+                                        LXError *outError);
+
+// weighted average of "count" images, e.g. for frame blending in frame rate conversion or temporal downsampling.
+// "weights" can be NULL for a plain average; otherwise they must not be negative, and they're normalized to sum to 1.
+// "rowBytes" contains a value for each input
+LXEXPORT LXSuccess LXImageBlendAverageData(const uint8_t * const *bufs, const size_t *rowBytes,
+                                           const float *weights, LXUInteger count,
+                                           uint8_t *dstBuf, size_t dstRowBytes,
+                                           uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                           LXError *outError);
+
+// "over" for premultiplied alpha: dst = fg * opacity + bg * (1 - fg.a * opacity).
+// formats without alpha are opaque, so for them this is a lerp from bg to fg
+LXEXPORT LXSuccess LXImageBlendOverData(const uint8_t *fgBuf, size_t fgRowBytes,
+                                        const uint8_t *bgBuf, size_t bgRowBytes,
+                                        uint8_t *dstBuf, size_t dstRowBytes,
+                                        uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                        float opacity,
+                                        LXError *outError);
+
+// the same for pixel buffers
+LXEXPORT LXSuccess LXImageBlendLerp(LXPixelBufferRef a, LXPixelBufferRef b, LXPixelBufferRef dst, float t, LXError *outError);
+
+LXEXPORT LXSuccess LXImageBlendAverage(LXPixelBufferRef *srcs, const float *weights, LXUInteger count,
+                                       LXPixelBufferRef dst, LXError *outError);
+
+LXEXPORT LXSuccess LXImageBlendOver(LXPixelBufferRef fg, LXPixelBufferRef bg, LXPixelBufferRef dst, float opacity, LXError *outError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,6 +16,8 @@
 #include "LXImageFunctions.h"
 #include "LXFixedPoint.h"
 #include "LXPixelBuffer.h"
+#include "LXImageStatistics.h"
+#include "LXImageBlend.h"
 #include <math.h>
 
 
@@ -626,64 +628,205 @@ void LXImageBlend_YCbCr422(uint8_t * LXRESTRICT outBuf,
                            uint8_t * LXRESTRICT buf2,
                            LXInteger w)
 {
-	LXInteger j;
-    uint32_t * LXRESTRICT yuvBuf1 = (uint32_t *)buf1;
-    uint32_t * LXRESTRICT yuvBuf2 = (uint32_t *)buf2;
-    uint32_t * LXRESTRICT dstYuvBuf = (uint32_t *)outBuf;
-
-    #define CRAM_U8(v)  (uint8_t)(v & 0xff)
-	
-	for (j = w/2; j; j--) {
-		register uint32_t v1 = yuvBuf1[0];
-		yuvBuf1++;
-		register uint32_t v2 = yuvBuf2[0];
-		yuvBuf2++;
-			
-		register uint32_t iy2_1 = ((v1 >> 24)  & 0xff);
-		register uint32_t iCr_1 = ((v1 >> 16)  & 0xff);
-		register uint32_t iy1_1 = ((v1 >> 8)   & 0xff);
-		register uint32_t iCb_1 = ((v1 >> 0)   & 0xff);
-
-		register uint32_t iy2_2 = ((v2 >> 24)  & 0xff);
-		register uint32_t iCr_2 = ((v2 >> 16)  & 0xff);
-		register uint32_t iy1_2 = ((v2 >> 8)   & 0xff);
-		register uint32_t iCb_2 = ((v2 >> 0)   & 0xff);
-
-		iy1_1 = CRAM_U8( (iy1_1 + iy1_2) >> 1 );
-		iy2_1 = CRAM_U8( (iy2_1 + iy2_2) >> 1 );
-		iCb_1 = CRAM_U8( (iCb_1 + iCb_2) >> 1 );
-		iCr_1 = CRAM_U8( (iCr_1 + iCr_2) >> 1 );
-		
-		dstYuvBuf[0] = MAKEPX_2VUY(iy1_1, iy2_1, iCb_1, iCr_1);
-		dstYuvBuf++;
-	}
-    
-    #undef CRAM_U8
+    // whole pixel pairs only
+    LXImageBlendLerpData(buf1, 0, buf2, 0, outBuf, 0, (uint32_t)(w & ~1), 1, kLX_YCbCr422_INT8, 0.5f, NULL);
+}
+
+
+#pragma mark --- premultiply ---
+
+// 255/a for unpremultiplying 8-bit values; zero alpha gives zero color
+static void setUnpremultiplyTable_int8(float *table)
+{
+    LXInteger i;
+    table[0] = 0.0f;
+    for (i = 1; i < 256; i++) {
+        table[i] = 255.0f / i;
+    }
+}
+
+// c*255/a is either an exact half or at least 1/(2a) away from one, so this bias gives correct rounding despite
+// the error in the float reciprocal
+#define UNPREMULT_ROUNDING  0.501f
+
+static void premultiplyRow_int8(const uint8_t *src, uint8_t *dst, const LXInteger n, const LXInteger alphaIndex)
+{
+    LXInteger x = 0;
+    
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i alphaMask = _mm_slli_epi32(byteMask, alphaIndex * 8);
+    const __m128i alphaShift = _mm_cvtsi32_si128(alphaIndex * 8);
+    const __m128i rnd = _mm_set1_epi16(128);
+    
+    for (; x + 4 <= n; x += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(src + x*4));
+        // alpha in every byte of its pixel
+        __m128i a = _mm_and_si128(_mm_srl_epi32(v, alphaShift), byteMask);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        // the alpha byte is multiplied by 255 instead, so it comes out unchanged
+        const __m128i c = _mm_or_si128(v, alphaMask);
+        
+        // round(c*a/255) == (t + (t >> 8)) >> 8 where t = c*a + 128
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(a, zero)), rnd);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(a, zero)), rnd);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        
+        _mm_storeu_si128((__m128i *)(dst + x*4), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; x < n; x++) {
+        const uint8_t *s = src + x*4;
+        uint8_t *d = dst + x*4;
+        const uint32_t a = s[alphaIndex];
+        LXInteger i;
+        for (i = 0; i < 4; i++) {
+            uint32_t t = s[i] * a + 128;
+            d[i] = (i == alphaIndex) ? a : ((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+static void unpremultiplyRow_int8(const uint8_t *src, uint8_t *dst, const LXInteger n, const LXInteger alphaIndex,
+                                  const float *table)
+{
+    LXInteger x = 0;
+    
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 rnd = _mm_set1_ps(UNPREMULT_ROUNDING);
+    const __m128 alphaLane = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(alphaIndex)));
+    const __m128 oneAtAlpha = _mm_and_ps(alphaLane, one);
+    
+    #define UNPREMULT_PX(v_, i_) \
+        _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v_), \
+                                               _mm_or_ps(_mm_andnot_ps(alphaLane, _mm_set1_ps(table[s[(i_)*4 + alphaIndex]])), oneAtAlpha)), \
+                                    rnd))
+    
+    for (; x + 4 <= n; x += 4) {
+        const uint8_t *s = src + x*4;
+        const __m128i v = _mm_loadu_si128((const __m128i *)s);
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        
+        // the 16-bit pack saturates values that are larger than alpha
+        __m128i p01 = _mm_packs_epi32(UNPREMULT_PX(_mm_unpacklo_epi16(lo, zero), 0), UNPREMULT_PX(_mm_unpackhi_epi16(lo, zero), 1));
+        __m128i p23 = _mm_packs_epi32(UNPREMULT_PX(_mm_unpacklo_epi16(hi, zero), 2), UNPREMULT_PX(_mm_unpackhi_epi16(hi, zero), 3));
+        
+        _mm_storeu_si128((__m128i *)(dst + x*4), _mm_packus_epi16(p01, p23));
+    }
+    #undef UNPREMULT_PX
+#endif
+
+    for (; x < n; x++) {
+        const uint8_t *s = src + x*4;
+        uint8_t *d = dst + x*4;
+        const uint8_t a = s[alphaIndex];
+        const float f = table[a];
+        LXInteger i;
+        for (i = 0; i < 4; i++) {
+            LXInteger v = (LXInteger)(s[i] * f + UNPREMULT_ROUNDING);
+            d[i] = (i == alphaIndex) ? a : MIN(v, 255);
+        }
+    }
+}
+
+static void premultiplyRow_float32(const float *src, float *dst, const LXInteger n)
+{
+    LXInteger x = 0;
+    
+#if defined(__SSE2__)
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 oneAtAlpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    
+    for (; x + 2 <= n; x += 2) {
+        __m128 v0 = _mm_loadu_ps(src + x*4);
+        __m128 v1 = _mm_loadu_ps(src + x*4 + 4);
+        __m128 a0 = _mm_shuffle_ps(v0, v0, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 a1 = _mm_shuffle_ps(v1, v1, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(dst + x*4,     _mm_mul_ps(v0, _mm_or_ps(_mm_and_ps(a0, rgbMask), oneAtAlpha)));
+        _mm_storeu_ps(dst + x*4 + 4, _mm_mul_ps(v1, _mm_or_ps(_mm_and_ps(a1, rgbMask), oneAtAlpha)));
+    }
+#endif
+
+    for (; x < n; x++) {
+        const float a = src[x*4 + 3];
+        dst[x*4 + 0] = src[x*4 + 0] * a;
+        dst[x*4 + 1] = src[x*4 + 1] * a;
+        dst[x*4 + 2] = src[x*4 + 2] * a;
+        dst[x*4 + 3] = a;
+    }
+}
+
+static void unpremultiplyRow_float32(const float *src, float *dst, const LXInteger n)
+{
+    LXInteger x = 0;
+    
+#if defined(__SSE2__)
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 oneAtAlpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    
+    for (; x + 2 <= n; x += 2) {
+        __m128 v0 = _mm_loadu_ps(src + x*4);
+        __m128 v1 = _mm_loadu_ps(src + x*4 + 4);
+        __m128 a0 = _mm_shuffle_ps(v0, v0, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 a1 = _mm_shuffle_ps(v1, v1, _MM_SHUFFLE(3, 3, 3, 3));
+        // approximate reciprocal with one Newton-Raphson step: r' = r * (2 - a*r)
+        __m128 r0 = _mm_rcp_ps(a0);
+        __m128 r1 = _mm_rcp_ps(a1);
+        r0 = _mm_mul_ps(r0, _mm_sub_ps(two, _mm_mul_ps(a0, r0)));
+        r1 = _mm_mul_ps(r1, _mm_sub_ps(two, _mm_mul_ps(a1, r1)));
+        // zero alpha gives zero color
+        r0 = _mm_and_ps(r0, _mm_and_ps(_mm_cmpneq_ps(a0, zero), rgbMask));
+        r1 = _mm_and_ps(r1, _mm_and_ps(_mm_cmpneq_ps(a1, zero), rgbMask));
+        _mm_storeu_ps(dst + x*4,     _mm_mul_ps(v0, _mm_or_ps(r0, oneAtAlpha)));
+        _mm_storeu_ps(dst + x*4 + 4, _mm_mul_ps(v1, _mm_or_ps(r1, oneAtAlpha)));
+    }
+#endif
+
+    for (; x < n; x++) {
+        const float a = src[x*4 + 3];
+        const float r = (a != 0.0f) ? 1.0f / a : 0.0f;
+        dst[x*4 + 0] = src[x*4 + 0] * r;
+        dst[x*4 + 1] = src[x*4 + 1] * r;
+        dst[x*4 + 2] = src[x*4 + 2] * r;
+        dst[x*4 + 3] = a;
+    }
+}
+
+// half-float rows are processed through a float buffer in chunks
+#define PREMULT_F16_CHUNK  256
+
+static void alphaConvertRow_float16(const LXHalf *src, LXHalf *dst, const LXInteger n, const LXBool unpremultiply)
+{
+    float tmp[PREMULT_F16_CHUNK * 4];
+    LXInteger x;
+    
+    for (x = 0; x < n; x += PREMULT_F16_CHUNK) {
+        const LXInteger count = MIN(PREMULT_F16_CHUNK, n - x);
+        LXConvertHalfToFloatArray((LXHalf *)(src + x*4), tmp, count * 4);
+        if (unpremultiply)
+            unpremultiplyRow_float32(tmp, tmp, count);
+        else
+            premultiplyRow_float32(tmp, tmp, count);
+        LXConvertFloatToHalfArray(tmp, dst + x*4, count * 4);
+    }
 }
 
 void LXImagePremultiply_RGBA_int8_inplace(const LXInteger w, const LXInteger h, 
                                           uint8_t * LXRESTRICT buf, const size_t rowBytes)
 {
-    LXInteger x, y;
+    LXInteger y;
     for (y = 0; y < h; y++) {
-        uint32_t * LXRESTRICT src = (uint32_t *) (buf + rowBytes * y);
-    
-        for (x = 0; x < w; x++) {
-            uint32_t v = *src;
-            // alpha is in range 0-255; for multiplication, convert to fixed point range 0 - 0x100FE (==1.00387, closest equal to 256/255)
-            uint32_t a = GETBYTE3(v);
-            uint32_t fa = a * ((1 << 8) + 2);
-            uint32_t r = (GETBYTE0(v) * fa) >> 16;
-            uint32_t g = (GETBYTE1(v) * fa) >> 16;
-            uint32_t b = (GETBYTE2(v) * fa) >> 16;
-            
-            uint32_t ov = 0;
-            SETBYTE0(ov, r & 0xff);
-            SETBYTE1(ov, g & 0xff);
-            SETBYTE2(ov, b & 0xff);
-            SETBYTE3(ov, a);
-            *src++ = ov;
-        }
+        uint8_t *row = buf + rowBytes * y;
+        premultiplyRow_int8(row, row, w, 3);
     }
 }
 
@@ -691,28 +834,142 @@ void LXImagePremultiply_RGBA_int8(const LXInteger w, const LXInteger h,
                                   uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
                                   uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes)
 {
-    LXInteger x, y;
+    LXInteger y;
     for (y = 0; y < h; y++) {
-        uint32_t * LXRESTRICT src = (uint32_t *) (srcBuf + srcRowBytes * y);
-        uint32_t * LXRESTRICT dst = (uint32_t *) (dstBuf + dstRowBytes * y);
-        
-        for (x = 0; x < w; x++) {
-            uint32_t v = *src++;
-            // alpha is in range 0-255; for multiplication, convert to fixed point range 0 - 0x100FE (==1.00387, closest equal to 256/255)
-            uint32_t a = GETBYTE3(v);
-            uint32_t fa = a * ((1 << 8) + 2);
-            uint32_t r = (GETBYTE0(v) * fa) >> 16;
-            uint32_t g = (GETBYTE1(v) * fa) >> 16;
-            uint32_t b = (GETBYTE2(v) * fa) >> 16;
-            
-            uint32_t ov = 0;
-            SETBYTE0(ov, r & 0xff);
-            SETBYTE1(ov, g & 0xff);
-            SETBYTE2(ov, b & 0xff);
-            SETBYTE3(ov, a);
-            *dst++ = ov;
+        premultiplyRow_int8(srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, w, 3);
+    }
+}
+
+void LXImagePremultiply_ARGB_int8(const LXInteger w, const LXInteger h,
+                                  uint8_t *srcBuf, const size_t srcRowBytes,
+                                  uint8_t *dstBuf, const size_t dstRowBytes)
+{
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        premultiplyRow_int8(srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, w, 0);
+    }
+}
+
+void LXImagePremultiply_RGBA_float16(const LXInteger w, const LXInteger h,
+                                     LXHalf *srcBuf, const size_t srcRowBytes,
+                                     LXHalf *dstBuf, const size_t dstRowBytes)
+{
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        alphaConvertRow_float16((LXHalf *)((uint8_t *)srcBuf + srcRowBytes * y), (LXHalf *)((uint8_t *)dstBuf + dstRowBytes * y), w, NO);
+    }
+}
+
+void LXImagePremultiply_RGBA_float32(const LXInteger w, const LXInteger h,
+                                     float *srcBuf, const size_t srcRowBytes,
+                                     float *dstBuf, const size_t dstRowBytes)
+{
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        premultiplyRow_float32((float *)((uint8_t *)srcBuf + srcRowBytes * y), (float *)((uint8_t *)dstBuf + dstRowBytes * y), w);
+    }
+}
+
+void LXImageUnpremultiply_RGBA_int8(const LXInteger w, const LXInteger h,
+                                    uint8_t *srcBuf, const size_t srcRowBytes,
+                                    uint8_t *dstBuf, const size_t dstRowBytes)
+{
+    float table[256];
+    LXInteger y;
+    setUnpremultiplyTable_int8(table);
+    for (y = 0; y < h; y++) {
+        unpremultiplyRow_int8(srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, w, 3, table);
+    }
+}
+
+void LXImageUnpremultiply_ARGB_int8(const LXInteger w, const LXInteger h,
+                                    uint8_t *srcBuf, const size_t srcRowBytes,
+                                    uint8_t *dstBuf, const size_t dstRowBytes)
+{
+    float table[256];
+    LXInteger y;
+    setUnpremultiplyTable_int8(table);
+    for (y = 0; y < h; y++) {
+        unpremultiplyRow_int8(srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, w, 0, table);
+    }
+}
+
+void LXImageUnpremultiply_RGBA_float16(const LXInteger w, const LXInteger h,
+                                       LXHalf *srcBuf, const size_t srcRowBytes,
+                                       LXHalf *dstBuf, const size_t dstRowBytes)
+{
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        alphaConvertRow_float16((LXHalf *)((uint8_t *)srcBuf + srcRowBytes * y), (LXHalf *)((uint8_t *)dstBuf + dstRowBytes * y), w, YES);
+    }
+}
+
+void LXImageUnpremultiply_RGBA_float32(const LXInteger w, const LXInteger h,
+                                       float *srcBuf, const size_t srcRowBytes,
+                                       float *dstBuf, const size_t dstRowBytes)
+{
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        unpremultiplyRow_float32((float *)((uint8_t *)srcBuf + srcRowBytes * y), (float *)((uint8_t *)dstBuf + dstRowBytes * y), w);
+    }
+}
+
+LXBool LXImageApplyAlphaConversion(const LXInteger w, const LXInteger h,
+                                   uint8_t *srcBuf, const size_t srcRowBytes,
+                                   uint8_t *dstBuf, const size_t dstRowBytes,
+                                   const LXPixelFormat pxFormat, const LXUInteger alphaConversion)
+{
+    const LXBool unpremultiply = (alphaConversion == kLXAlphaConversion_Unpremultiply);
+    
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:  case kLX_BGRA_INT8:  case kLX_ARGB_INT8:
+        case kLX_RGBA_FLOAT16:  case kLX_RGBA_FLOAT32:
+            break;
+        default:
+            return NO;
+    }
+    
+    if (alphaConversion == kLXAlphaConversion_None) {
+        if (srcBuf != dstBuf) {
+            const size_t rowLen = w * LXBytesPerPixelForPixelFormat(pxFormat);
+            LXInteger y;
+            for (y = 0; y < h; y++) {
+                memcpy(dstBuf + dstRowBytes * y, srcBuf + srcRowBytes * y, rowLen);
+            }
         }
+        return YES;
+    }
+    
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_BGRA_INT8:
+            if (unpremultiply)
+                LXImageUnpremultiply_RGBA_int8(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes);
+            else
+                LXImagePremultiply_RGBA_int8(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes);
+            break;
+        case kLX_ARGB_INT8:
+            if (unpremultiply)
+                LXImageUnpremultiply_ARGB_int8(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes);
+            else
+                LXImagePremultiply_ARGB_int8(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes);
+            break;
+        case kLX_RGBA_FLOAT16:
+            if (unpremultiply)
+                LXImageUnpremultiply_RGBA_float16(w, h, (LXHalf *)srcBuf, srcRowBytes, (LXHalf *)dstBuf, dstRowBytes);
+            else
+                LXImagePremultiply_RGBA_float16(w, h, (LXHalf *)srcBuf, srcRowBytes, (LXHalf *)dstBuf, dstRowBytes);
+            break;
+        case kLX_RGBA_FLOAT32:
+            if (unpremultiply)
+                LXImageUnpremultiply_RGBA_float32(w, h, (float *)srcBuf, srcRowBytes, (float *)dstBuf, dstRowBytes);
+            else
+                LXImagePremultiply_RGBA_float32(w, h, (float *)srcBuf, srcRowBytes, (float *)dstBuf, dstRowBytes);
+            break;
+        default:
+            return NO;
     }
+    return YES;
 }
 
 
@@ -899,313 +1156,755 @@ void LXPxConvert_YCbCr422_to_RGBA_float16_rawYUV(const LXInteger w, const LXInte
 
 
 
-void LXPxConvert_RGBA_to_YCbCr422(const LXInteger w, const LXInteger h,
-                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
-                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
-                                         LXColorSpaceEncoding cspace)
+#pragma mark --- planar YCbCr ---
+
+// fixed-point coefficients for YCbCr->RGB.
+// luma is pre-shifted by 7 and multiplied by a Q14 value, chroma is pre-shifted by 8 and multiplied by Q13 values,
+// so that the high half of a 16*16-bit multiply (i.e. SSE2's pmulhw) gives results with 5 fractional bits.
+typedef struct {
+    int16_t yOff;
+    int16_t yMul;
+    int16_t crMul_r;
+    int16_t crMul_g;
+    int16_t cbMul_g;
+    int16_t cbMul_b;
+} LXYCbCrFixedCoeffs;
+
+#define YCC_FRAC_BITS   5
+
+static void getYCbCrToRGBFixedCoeffs(LXYCbCrFixedCoeffs *c, LXColorSpaceEncoding cspace, LXBool fullRange)
 {
-    LXInteger i, j;
-    const float toFloatMult = (1.0f / 255.0f);
-    const float mat11 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__R : kLX_601_toY__R) * kLX_Y219_scale;
-    const float mat12 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__G : kLX_601_toY__G) * kLX_Y219_scale;
-    const float mat13 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__B : kLX_601_toY__B) * kLX_Y219_scale;
-    const float mat21 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_R : kLX_601_toPb_R) * kLX_C219_scale;
-    const float mat22 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_G : kLX_601_toPb_G) * kLX_C219_scale;
-    const float mat23 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_B : kLX_601_toPb_B) * kLX_C219_scale;
-    const float mat31 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_R : kLX_601_toPr_R) * kLX_C219_scale;
-    const float mat32 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_G : kLX_601_toPr_G) * kLX_C219_scale;
-    const float mat33 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_B : kLX_601_toPr_B) * kLX_C219_scale;
+    const double yScale = (fullRange) ? 1.0 : (255.0 / kLX_Y219_scale);
+    const double cScale = (fullRange) ? 1.0 : (255.0 / kLX_C219_scale);
+    const LXBool is709 = (cspace == kLX_YCbCr_Rec709);
     
-    for (i = 0; i < h; i++) {
-        uint32_t * LXRESTRICT yuvBuf = (uint32_t *)(dstBuf + dstRowBytes * i);
-        uint32_t * LXRESTRICT rgbaBuf = (uint32_t *)(srcBuf + srcRowBytes * i);
-        for (j = w/2; j; j--) {
-            register uint32_t iy1, iy2, iCb, iCr;
-            register float y1, y2, Cb, Cr;
-            register float r1, r2, g1, g2, b1, b2;
-            
-            r1 = (GETBYTE0(rgbaBuf[0])) * toFloatMult;
-            r2 = (GETBYTE0(rgbaBuf[1])) * toFloatMult;
-            g1 = (GETBYTE1(rgbaBuf[0])) * toFloatMult;
-            g2 = (GETBYTE1(rgbaBuf[1])) * toFloatMult;
-            b1 = (GETBYTE2(rgbaBuf[0])) * toFloatMult;
-            b2 = (GETBYTE2(rgbaBuf[1])) * toFloatMult;
-            rgbaBuf += 2;
-            
-            y1 = (float)kLX_Y219_offset + mat11*r1 + mat12*g1 + mat13*b1;
-            iy1 = ((uint32_t)y1) & 0xff;
+    c->yOff = (fullRange) ? 0 : kLX_Y219_offset;
+    c->yMul = (int16_t)lround(yScale * 16384.0);
+    c->crMul_r = (int16_t)lround(cScale * ((is709) ? kLX_709_toR__Pr : kLX_601_toR__Pr) * 8192.0);
+    c->crMul_g = (int16_t)lround(cScale * ((is709) ? kLX_709_toG__Pr : kLX_601_toG__Pr) * 8192.0);
+    c->cbMul_g = (int16_t)lround(cScale * ((is709) ? kLX_709_toG__Pb : kLX_601_toG__Pb) * 8192.0);
+    c->cbMul_b = (int16_t)lround(cScale * ((is709) ? kLX_709_toB__Pb : kLX_601_toB__Pb) * 8192.0);
+}
+
+// same arithmetic as the SIMD path (pmulhw is an arithmetic right shift of the 32-bit product)
+#define YCC_MULHI(a_, b_)   (((int32_t)(a_) * (int32_t)(b_)) >> 16)
+#define YCC_CLAMP_255(v_)   (uint8_t)(((v_) < 0) ? 0 : (((v_) > 255) ? 255 : (v_)))
+
+LXINLINE void convertYCbCrPixel_to_RGBA_int8(const LXYCbCrFixedCoeffs *c, int yv, int cb, int cr, uint8_t * LXRESTRICT dst)
+{
+    const int ys = YCC_MULHI((yv - c->yOff) << 7, c->yMul);
+    cb = (cb - 128) << 8;
+    cr = (cr - 128) << 8;
+    const int rnd = 1 << (YCC_FRAC_BITS - 1);
+    int r = (ys + YCC_MULHI(cr, c->crMul_r) + rnd) >> YCC_FRAC_BITS;
+    int g = (ys + YCC_MULHI(cr, c->crMul_g) + YCC_MULHI(cb, c->cbMul_g) + rnd) >> YCC_FRAC_BITS;
+    int b = (ys + YCC_MULHI(cb, c->cbMul_b) + rnd) >> YCC_FRAC_BITS;
+    dst[0] = YCC_CLAMP_255(r);
+    dst[1] = YCC_CLAMP_255(g);
+    dst[2] = YCC_CLAMP_255(b);
+    dst[3] = 255;
+}
+
+
+enum {
+    kYCCPlanarRow_420 = 0,      // separate half-width chroma rows
+    kYCCPlanarRow_420_interleaved,
+    kYCCPlanarRow_444
+};
+
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+
+// converts 16 pixels; luma and chroma are given as 16-bit values with offsets already removed and pre-shifted
+LXINLINE LXFUNCATTR_SSE void convertYCbCr16_to_RGBA_int8_SSE2(__m128i ylo, __m128i yhi,
+                                                              __m128i cblo, __m128i cbhi, __m128i crlo, __m128i crhi,
+                                                              const __m128i vyMul, const __m128i vcrMul_r, const __m128i vcrMul_g,
+                                                              const __m128i vcbMul_g, const __m128i vcbMul_b,
+                                                              uint8_t * LXRESTRICT dst)
+{
+    const __m128i vrnd = _mm_set1_epi16(1 << (YCC_FRAC_BITS - 1));
+    const __m128i valpha = _mm_set1_epi8((char)0xff);
+    
+    ylo = _mm_add_epi16(_mm_mulhi_epi16(ylo, vyMul), vrnd);
+    yhi = _mm_add_epi16(_mm_mulhi_epi16(yhi, vyMul), vrnd);
+    
+    __m128i rlo = _mm_adds_epi16(ylo, _mm_mulhi_epi16(crlo, vcrMul_r));
+    __m128i rhi = _mm_adds_epi16(yhi, _mm_mulhi_epi16(crhi, vcrMul_r));
+    __m128i glo = _mm_adds_epi16(_mm_adds_epi16(ylo, _mm_mulhi_epi16(crlo, vcrMul_g)), _mm_mulhi_epi16(cblo, vcbMul_g));
+    __m128i ghi = _mm_adds_epi16(_mm_adds_epi16(yhi, _mm_mulhi_epi16(crhi, vcrMul_g)), _mm_mulhi_epi16(cbhi, vcbMul_g));
+    __m128i blo = _mm_adds_epi16(ylo, _mm_mulhi_epi16(cblo, vcbMul_b));
+    __m128i bhi = _mm_adds_epi16(yhi, _mm_mulhi_epi16(cbhi, vcbMul_b));
+    
+    __m128i r = _mm_packus_epi16(_mm_srai_epi16(rlo, YCC_FRAC_BITS), _mm_srai_epi16(rhi, YCC_FRAC_BITS));
+    __m128i g = _mm_packus_epi16(_mm_srai_epi16(glo, YCC_FRAC_BITS), _mm_srai_epi16(ghi, YCC_FRAC_BITS));
+    __m128i b = _mm_packus_epi16(_mm_srai_epi16(blo, YCC_FRAC_BITS), _mm_srai_epi16(bhi, YCC_FRAC_BITS));
+    
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i ba = _mm_unpacklo_epi8(b, valpha);
+    _mm_storeu_si128((__m128i *)(dst),      _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rg, ba));
+    rg = _mm_unpackhi_epi8(r, g);
+    ba = _mm_unpackhi_epi8(b, valpha);
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(rg, ba));
+}
+
+// returns number of pixels processed
+static LXFUNCATTR_SSE LXInteger convertYCbCrPlanarRow_to_RGBA_int8_SSE2(const LXInteger w, const LXInteger layout,
+                                                                     const uint8_t * LXRESTRICT srcY, const uint8_t * LXRESTRICT srcCb, const uint8_t * LXRESTRICT srcCr,
+                                                                     uint8_t * LXRESTRICT dst,
+                                                                     const LXYCbCrFixedCoeffs *c)
+{
+    const __m128i vzero = _mm_setzero_si128();
+    const __m128i vyOff = _mm_set1_epi16(c->yOff);
+    const __m128i vcOff = _mm_set1_epi16(128);
+    const __m128i vlowMask = _mm_set1_epi16(0xff);
+    const __m128i vyMul = _mm_set1_epi16(c->yMul);
+    const __m128i vcrMul_r = _mm_set1_epi16(c->crMul_r);
+    const __m128i vcrMul_g = _mm_set1_epi16(c->crMul_g);
+    const __m128i vcbMul_g = _mm_set1_epi16(c->cbMul_g);
+    const __m128i vcbMul_b = _mm_set1_epi16(c->cbMul_b);
+    const LXInteger n = w / 16;
+    LXInteger i;
+    
+    for (i = 0; i < n; i++) {
+        __m128i yv = _mm_loadu_si128((const __m128i *)(srcY + i*16));
+        __m128i ylo = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(yv, vzero), vyOff), 7);
+        __m128i yhi = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(yv, vzero), vyOff), 7);
+        __m128i cblo, cbhi, crlo, crhi;
+        
+        if (layout == kYCCPlanarRow_444) {
+            __m128i cbv = _mm_loadu_si128((const __m128i *)(srcCb + i*16));
+            __m128i crv = _mm_loadu_si128((const __m128i *)(srcCr + i*16));
+            cblo = _mm_unpacklo_epi8(cbv, vzero);
+            cbhi = _mm_unpackhi_epi8(cbv, vzero);
+            crlo = _mm_unpacklo_epi8(crv, vzero);
+            crhi = _mm_unpackhi_epi8(crv, vzero);
+        } else {
+            __m128i cb, cr;
+            if (layout == kYCCPlanarRow_420_interleaved) {
+                __m128i cbcr = _mm_loadu_si128((const __m128i *)(srcCb + i*16));
+                cb = _mm_and_si128(cbcr, vlowMask);
+                cr = _mm_srli_epi16(cbcr, 8);
+            } else {
+                cb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(srcCb + i*8)), vzero);
+                cr = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(srcCr + i*8)), vzero);
+            }
+            // nearest-neighbour horizontal upsampling
+            cblo = _mm_unpacklo_epi16(cb, cb);
+            cbhi = _mm_unpackhi_epi16(cb, cb);
+            crlo = _mm_unpacklo_epi16(cr, cr);
+            crhi = _mm_unpackhi_epi16(cr, cr);
+        }
+        cblo = _mm_slli_epi16(_mm_sub_epi16(cblo, vcOff), 8);
+        cbhi = _mm_slli_epi16(_mm_sub_epi16(cbhi, vcOff), 8);
+        crlo = _mm_slli_epi16(_mm_sub_epi16(crlo, vcOff), 8);
+        crhi = _mm_slli_epi16(_mm_sub_epi16(crhi, vcOff), 8);
+        
+        convertYCbCr16_to_RGBA_int8_SSE2(ylo, yhi, cblo, cbhi, crlo, crhi,
+                                         vyMul, vcrMul_r, vcrMul_g, vcbMul_g, vcbMul_b,
+                                         dst + i*64);
+    }
+    return n * 16;
+}
 
-            //y2 = yFromRGB_rec601_f(r2, g2, b2);            
-            y2 = (float)kLX_Y219_offset + mat11*r2 + mat12*g2 + mat13*b2;
-            iy2 = ((uint32_t)y2) & 0xff;
+#endif  // __SSE2__
 
-            //Cb = cbFromRGB_rec601_f(r1, g1, b1);
-            Cb = (float)kLX_C219_offset + mat21*r1 + mat22*g1 + mat23*b1;
-            iCb = ((uint32_t)Cb) & 0xff;
 
-            //Cr = crFromRGB_rec601_f(r1, g1, b1);
-            Cr = (float)kLX_C219_offset + mat31*r1 + mat32*g1 + mat33*b1;
-            iCr = ((uint32_t)Cr) & 0xff;
-            
-            yuvBuf[0] = MAKEPX_2VUY(iy1, iy2, iCb, iCr);
-            yuvBuf++;
+static void convertYCbCrPlanarRow_to_RGBA_int8(const LXInteger w, const LXInteger layout,
+                                               const uint8_t * LXRESTRICT srcY, const uint8_t * LXRESTRICT srcCb, const uint8_t * LXRESTRICT srcCr,
+                                               uint8_t * LXRESTRICT dst,
+                                               const LXYCbCrFixedCoeffs *c)
+{
+    LXInteger x = 0;
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+    x = convertYCbCrPlanarRow_to_RGBA_int8_SSE2(w, layout, srcY, srcCb, srcCr, dst, c);
+#endif
+    for (; x < w; x++) {
+        int cb, cr;
+        switch (layout) {
+            case kYCCPlanarRow_444:              cb = srcCb[x];  cr = srcCr[x];  break;
+            case kYCCPlanarRow_420_interleaved:  cb = srcCb[(x >> 1) * 2];  cr = srcCb[(x >> 1) * 2 + 1];  break;
+            default:                             cb = srcCb[x >> 1];  cr = srcCr[x >> 1];  break;
         }
+        convertYCbCrPixel_to_RGBA_int8(c, srcY[x], cb, cr, dst + x*4);
     }
 }
 
-void LXPxConvert_ARGB_to_YCbCr422(const LXInteger w, const LXInteger h,
-                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
-                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
-                                         LXColorSpaceEncoding cspace)
+static void convertYCbCrPlanarRow_to_RGBA_float32(const LXInteger w, const LXInteger layout,
+                                                  const uint8_t * LXRESTRICT srcY, const uint8_t * LXRESTRICT srcCb, const uint8_t * LXRESTRICT srcCr,
+                                                  float * LXRESTRICT dst,
+                                                  LXColorSpaceEncoding cspace, LXBool fullRange)
 {
-    LXInteger i, j;
-    const float toFloatMult = (1.0f / 255.0f);
-    const float mat11 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__R : kLX_601_toY__R) * kLX_Y219_scale;
-    const float mat12 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__G : kLX_601_toY__G) * kLX_Y219_scale;
-    const float mat13 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toY__B : kLX_601_toY__B) * kLX_Y219_scale;
-    const float mat21 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_R : kLX_601_toPb_R) * kLX_C219_scale;
-    const float mat22 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_G : kLX_601_toPb_G) * kLX_C219_scale;
-    const float mat23 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPb_B : kLX_601_toPb_B) * kLX_C219_scale;
-    const float mat31 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_R : kLX_601_toPr_R) * kLX_C219_scale;
-    const float mat32 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_G : kLX_601_toPr_G) * kLX_C219_scale;
-    const float mat33 = ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toPr_B : kLX_601_toPr_B) * kLX_C219_scale;
-
-    for (i = 0; i < h; i++) {
-        uint32_t * LXRESTRICT yuvBuf = (uint32_t *)(dstBuf + dstRowBytes * i);
-        uint32_t * LXRESTRICT rgbaBuf = (uint32_t *)(srcBuf + srcRowBytes * i);
-        for (j = w/2; j; j--) {
-            register uint32_t iy1, iy2, iCb, iCr;
-            register float y1, y2, Cb, Cr;
-            register float r1, r2, g1, g2, b1, b2;
-            
-            r1 = (GETBYTE1(rgbaBuf[0])) * toFloatMult;
-            r2 = (GETBYTE1(rgbaBuf[1])) * toFloatMult;
-            g1 = (GETBYTE2(rgbaBuf[0])) * toFloatMult;
-            g2 = (GETBYTE2(rgbaBuf[1])) * toFloatMult;
-            b1 = (GETBYTE3(rgbaBuf[0])) * toFloatMult;
-            b2 = (GETBYTE3(rgbaBuf[1])) * toFloatMult;
-            rgbaBuf += 2;
-            
-            y1 = (float)kLX_Y219_offset + mat11*r1 + mat12*g1 + mat13*b1;
-            iy1 = ((uint32_t)y1) & 0xff;
-            y2 = (float)kLX_Y219_offset + mat11*r2 + mat12*g2 + mat13*b2;
-            iy2 = ((uint32_t)y2) & 0xff;
-            Cb = (float)kLX_C219_offset + mat21*r1 + mat22*g1 + mat23*b1;
-            iCb = ((uint32_t)Cb) & 0xff;
-            Cr = (float)kLX_C219_offset + mat31*r1 + mat32*g1 + mat33*b1;
-            iCr = ((uint32_t)Cr) & 0xff;
-            
-            yuvBuf[0] = MAKEPX_2VUY(iy1, iy2, iCb, iCr);
-            yuvBuf++;
+    const LXBool is709 = (cspace == kLX_YCbCr_Rec709);
+    const float yOff = (fullRange) ? 0.0f : kLX_Y219_offset;
+    const float yMul = (fullRange) ? (1.0f / 255.0f) : (1.0f / kLX_Y219_scale);
+    const float cMul = (fullRange) ? (1.0f / 255.0f) : (1.0f / kLX_C219_scale);
+    const float crMul_r = cMul * ((is709) ? kLX_709_toR__Pr : kLX_601_toR__Pr);
+    const float crMul_g = cMul * ((is709) ? kLX_709_toG__Pr : kLX_601_toG__Pr);
+    const float cbMul_g = cMul * ((is709) ? kLX_709_toG__Pb : kLX_601_toG__Pb);
+    const float cbMul_b = cMul * ((is709) ? kLX_709_toB__Pb : kLX_601_toB__Pb);
+    LXInteger x;
+    
+    // not clamped, so that superwhites survive in float
+    for (x = 0; x < w; x++) {
+        int icb, icr;
+        switch (layout) {
+            case kYCCPlanarRow_444:              icb = srcCb[x];  icr = srcCr[x];  break;
+            case kYCCPlanarRow_420_interleaved:  icb = srcCb[(x >> 1) * 2];  icr = srcCb[(x >> 1) * 2 + 1];  break;
+            default:                             icb = srcCb[x >> 1];  icr = srcCr[x >> 1];  break;
         }
+        const float ys = ((float)srcY[x] - yOff) * yMul;
+        const float cb = (float)(icb - 128);
+        const float cr = (float)(icr - 128);
+        dst[0] = ys + crMul_r * cr;
+        dst[1] = ys + crMul_g * cr + cbMul_g * cb;
+        dst[2] = ys + cbMul_b * cb;
+        dst[3] = 1.0f;
+        dst += 4;
+    }
+}
+
+static void convertYCbCrPlanar_to_RGBA(const LXInteger w, const LXInteger h, const LXInteger layout,
+                                       uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                       uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                       uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes, const LXBool dstIsFloat,
+                                       LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    const LXInteger chromaShiftY = (layout == kYCCPlanarRow_444) ? 0 : 1;
+    LXYCbCrFixedCoeffs coeffs;
+    getYCbCrToRGBFixedCoeffs(&coeffs, cspace, fullRange);
+    
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        const uint8_t *srcY = srcBuf_y + srcRowBytes_y * y;
+        const uint8_t *srcCb = srcBuf_Cb + srcRowBytes_chroma * (y >> chromaShiftY);
+        const uint8_t *srcCr = (srcBuf_Cr) ? (srcBuf_Cr + srcRowBytes_chroma * (y >> chromaShiftY)) : NULL;
+        uint8_t *dst = dstBuf + dstRowBytes * y;
+        
+        if (dstIsFloat)
+            convertYCbCrPlanarRow_to_RGBA_float32(w, layout, srcY, srcCb, srcCr, (float *)dst, cspace, fullRange);
+        else
+            convertYCbCrPlanarRow_to_RGBA_int8(w, layout, srcY, srcCb, srcCr, dst, &coeffs);
     }
 }
 
-#if defined(LXPLATFORM_MAC) && !defined(__BIG_ENDIAN__)
-#define USE_SSE2_FOR_YUV __SSE2__
-#else
-#define USE_SSE2_FOR_YUV 0
-#endif
+void LXPxConvert_YCbCr420_planar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_420, srcBuf_y, srcRowBytes_y, srcBuf_Cb, srcBuf_Cr, srcRowBytes_chroma,
+                               dstBuf, dstRowBytes, NO, cspace, fullRange);
+}
 
+void LXPxConvert_YCbCr420_biplanar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                                uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                                uint8_t * LXRESTRICT srcBuf_CbCr, const size_t srcRowBytes_chroma,
+                                                uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                                LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_420_interleaved, srcBuf_y, srcRowBytes_y, srcBuf_CbCr, NULL, srcRowBytes_chroma,
+                               dstBuf, dstRowBytes, NO, cspace, fullRange);
+}
 
-void LXPxConvert_YCbCr422_to_RGBA_int8(const LXInteger w, const LXInteger h,
-                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+void LXPxConvert_YCbCr444_planar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
                                               uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
-                                              LXColorSpaceEncoding cspace)
+                                              LXColorSpaceEncoding cspace, LXBool fullRange)
 {
-    LXInteger stride = w / 2;
-    const LXFixedNum fxd_lumaMul = FIXD_FROM_FLOAT(255.0 / kLX_Y219_scale);  // 1.164
-    const LXFixedNum fxd_crMul_r = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toR__Pr : kLX_601_toR__Pr));  // 1.596
-    const LXFixedNum fxd_crMul_g = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pr : kLX_601_toG__Pr));  // 0.813
-    const LXFixedNum fxd_cbMul_g = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pb : kLX_601_toG__Pb));  // 0.391
-    const LXFixedNum fxd_cbMul_b = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toB__Pb : kLX_601_toB__Pb));  // 2.018
-
-#if (USE_SSE2_FOR_YUV)
-    const LXBool useVec = ((srcRowBytes & 15) == 0 && (dstRowBytes & 15) == 0);
-    const LXUInteger vecN = (useVec) ? (w / 8) : 0;
-    float *tempBuf = (useVec) ? _lx_malloc(w * 4 * sizeof(float) + w * 2 * sizeof(float)) : NULL;
-    float *tempBuf1 = (useVec) ? tempBuf + w*4 : NULL;
-    float *tempBuf2 = (useVec) ? tempBuf : NULL;
-    
-    const float lumaMul = 255.0 / kLX_Y219_scale;
-    const float crMul_r = (255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toR__Pr : kLX_601_toR__Pr);
-    const float crMul_g = (255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pr : kLX_601_toG__Pr);
-    const float cbMul_g = (255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pb : kLX_601_toG__Pb);
-    const float cbMul_b = (255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toB__Pb : kLX_601_toB__Pb);
-    
-    const vfloat_t v_bias_2vuy = { -128.0, -16.0, -128.0, -16.0 };
-#endif
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_444, srcBuf_y, srcRowBytes_y, srcBuf_Cb, srcBuf_Cr, srcRowBytes_chroma,
+                               dstBuf, dstRowBytes, NO, cspace, fullRange);
+}
 
-    LXInteger y;
+void LXPxConvert_YCbCr420_planar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_420, srcBuf_y, srcRowBytes_y, srcBuf_Cb, srcBuf_Cr, srcRowBytes_chroma,
+                               (uint8_t *)dstBuf, dstRowBytes, YES, cspace, fullRange);
+}
+
+void LXPxConvert_YCbCr420_biplanar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                                uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                                uint8_t * LXRESTRICT srcBuf_CbCr, const size_t srcRowBytes_chroma,
+                                                float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                                LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_420_interleaved, srcBuf_y, srcRowBytes_y, srcBuf_CbCr, NULL, srcRowBytes_chroma,
+                               (uint8_t *)dstBuf, dstRowBytes, YES, cspace, fullRange);
+}
+
+void LXPxConvert_YCbCr444_planar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertYCbCrPlanar_to_RGBA(w, h, kYCCPlanarRow_444, srcBuf_y, srcRowBytes_y, srcBuf_Cb, srcBuf_Cr, srcRowBytes_chroma,
+                               (uint8_t *)dstBuf, dstRowBytes, YES, cspace, fullRange);
+}
+
+
+// RGBA -> planar: chroma is computed from the average of the 2x2 (or 2x1 / 1x1 at edges) RGB block
+static void convertRGBA_to_YCbCrPlanar(const LXInteger w, const LXInteger h, const LXInteger layout,
+                                       uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                       uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                       uint8_t * LXRESTRICT dstBuf_Cb, uint8_t * LXRESTRICT dstBuf_Cr, const size_t dstRowBytes_chroma,
+                                       LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    const LXBool is709 = (cspace == kLX_YCbCr_Rec709);
+    const float yScale = (fullRange) ? 255.0f : kLX_Y219_scale;
+    const float cScale = (fullRange) ? 255.0f : kLX_C219_scale;
+    const float yOff = ((fullRange) ? 0.0f : kLX_Y219_offset) + 0.5f;  // rounding included
+    const float cOff = kLX_C219_offset + 0.5f;
+    const float toFloatMult = (1.0f / 255.0f);
+    const float mat11 = ((is709) ? kLX_709_toY__R : kLX_601_toY__R) * yScale * toFloatMult;
+    const float mat12 = ((is709) ? kLX_709_toY__G : kLX_601_toY__G) * yScale * toFloatMult;
+    const float mat13 = ((is709) ? kLX_709_toY__B : kLX_601_toY__B) * yScale * toFloatMult;
+    const float mat21 = ((is709) ? kLX_709_toPb_R : kLX_601_toPb_R) * cScale * toFloatMult;
+    const float mat22 = ((is709) ? kLX_709_toPb_G : kLX_601_toPb_G) * cScale * toFloatMult;
+    const float mat23 = ((is709) ? kLX_709_toPb_B : kLX_601_toPb_B) * cScale * toFloatMult;
+    const float mat31 = ((is709) ? kLX_709_toPr_R : kLX_601_toPr_R) * cScale * toFloatMult;
+    const float mat32 = ((is709) ? kLX_709_toPr_G : kLX_601_toPr_G) * cScale * toFloatMult;
+    const float mat33 = ((is709) ? kLX_709_toPr_B : kLX_601_toPr_B) * cScale * toFloatMult;
+    const LXInteger sub = (layout == kYCCPlanarRow_444) ? 1 : 2;
+    LXInteger x, y;
+    
     for (y = 0; y < h; y++) {
-        uint8_t * LXRESTRICT src = (uint8_t *)(srcBuf + srcRowBytes * y);
-        uint8_t * LXRESTRICT dst = (uint8_t *)(dstBuf + dstRowBytes * y);
-        LXInteger n;
-
-#if (USE_SSE2_FOR_YUV)
-        LXPxConvert_int8_to_float32_withRange_SSE2(src, tempBuf1, vecN * 16,  0, 1);
-        
-        float * LXRESTRICT tempSrc = tempBuf1;
-        float * LXRESTRICT tempDst = tempBuf2;
-        for (n = 0; n < vecN * 4; n++) {
-            // TODO: should properly vectorize this algorithm (i.e. load a vector of 8 pixels straight from the source, instead of this temp buffer stuff)
-            LXVectorFloat v0;
-            v0.v = _mm_load_ps(tempSrc);
-            tempSrc += 4;
-            
-            v0.v = _mm_add_ps(v0.v, v_bias_2vuy);
-            float cb = v0.e[0];
-            float y0 = v0.e[1];
-            float cr = v0.e[2];
-            float y1 = v0.e[3];
-            
-            float sc_R = (crMul_r * cr);
-            float sc_G = (crMul_g * cr) + (cbMul_g * cb);
-            float sc_B = (cbMul_b * cb);
-            
-            float sc_y = lumaMul * y0;
-            v0.e[0] = sc_y + sc_R;
-            v0.e[1] = sc_y + sc_G;
-            v0.e[2] = sc_y + sc_B;
-            v0.e[3] = 255.0f;
-            _mm_store_ps(tempDst, v0.v);
+        uint8_t *src = srcBuf + srcRowBytes * y;
+        uint8_t *dstY = dstBuf_y + dstRowBytes_y * y;
+        for (x = 0; x < w; x++) {
+            float v = yOff + mat11*src[0] + mat12*src[1] + mat13*src[2];
+            dstY[x] = (uint8_t)MIN(255.0f, MAX(0.0f, v));
+            src += 4;
+        }
+    }
+    
+    for (y = 0; y < h; y += sub) {
+        const LXInteger rows = MIN(sub, h - y);
+        const LXInteger cy = y / sub;
+        uint8_t *dstCb = dstBuf_Cb + dstRowBytes_chroma * cy;
+        uint8_t *dstCr = (layout == kYCCPlanarRow_420_interleaved) ? (dstCb + 1) : (dstBuf_Cr + dstRowBytes_chroma * cy);
+        const LXInteger dstStep = (layout == kYCCPlanarRow_420_interleaved) ? 2 : 1;
+        
+        for (x = 0; x < w; x += sub) {
+            const LXInteger cols = MIN(sub, w - x);
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            LXInteger i, j;
+            for (j = 0; j < rows; j++) {
+                uint8_t *src = srcBuf + srcRowBytes * (y + j) + x*4;
+                for (i = 0; i < cols; i++) {
+                    r += src[0];  g += src[1];  b += src[2];
+                    src += 4;
+                }
+            }
+            const float avgMul = 1.0f / (float)(rows * cols);
+            r *= avgMul;  g *= avgMul;  b *= avgMul;
             
-            sc_y = lumaMul * y1;
-            v0.e[0] = sc_y + sc_R;
-            v0.e[1] = sc_y + sc_G;
-            v0.e[2] = sc_y + sc_B;
-            _mm_store_ps(tempDst + 4, v0.v);
-            tempDst += 8;
+            float cb = cOff + mat21*r + mat22*g + mat23*b;
+            float cr = cOff + mat31*r + mat32*g + mat33*b;
+            *dstCb = (uint8_t)MIN(255.0f, MAX(0.0f, cb));
+            *dstCr = (uint8_t)MIN(255.0f, MAX(0.0f, cr));
+            dstCb += dstStep;
+            dstCr += dstStep;
         }
+    }
+}
+
+void LXPxConvert_RGBA_to_YCbCr420_planar(const LXInteger w, const LXInteger h,
+                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                         uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                         uint8_t * LXRESTRICT dstBuf_Cb, uint8_t * LXRESTRICT dstBuf_Cr, const size_t dstRowBytes_chroma,
+                                         LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertRGBA_to_YCbCrPlanar(w, h, kYCCPlanarRow_420, srcBuf, srcRowBytes, dstBuf_y, dstRowBytes_y, dstBuf_Cb, dstBuf_Cr, dstRowBytes_chroma,
+                               cspace, fullRange);
+}
+
+void LXPxConvert_RGBA_to_YCbCr420_biplanar(const LXInteger w, const LXInteger h,
+                                           uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                           uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                           uint8_t * LXRESTRICT dstBuf_CbCr, const size_t dstRowBytes_chroma,
+                                           LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertRGBA_to_YCbCrPlanar(w, h, kYCCPlanarRow_420_interleaved, srcBuf, srcRowBytes, dstBuf_y, dstRowBytes_y, dstBuf_CbCr, NULL, dstRowBytes_chroma,
+                               cspace, fullRange);
+}
+
+void LXPxConvert_RGBA_to_YCbCr444_planar(const LXInteger w, const LXInteger h,
+                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                         uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                         uint8_t * LXRESTRICT dstBuf_Cb, uint8_t * LXRESTRICT dstBuf_Cr, const size_t dstRowBytes_chroma,
+                                         LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    convertRGBA_to_YCbCrPlanar(w, h, kYCCPlanarRow_444, srcBuf, srcRowBytes, dstBuf_y, dstRowBytes_y, dstBuf_Cb, dstBuf_Cr, dstRowBytes_chroma,
+                               cspace, fullRange);
+}
+
+
+#pragma mark --- YCbCr 4:2:2 ---
+
+// fixed-point coefficients for RGB->YCbCr.
+// RGB values are pre-shifted by 7 and multiplied by Q15 matrix values, so pmulhw results have 6 fractional bits.
+typedef struct {
+    int16_t yMat[3];
+    int16_t cbMat[3];
+    int16_t crMat[3];
+    int16_t yOff;
+} LXRGBToYCbCrFixedCoeffs;
+
+#define RGB2YCC_FRAC_BITS   6
+
+static void getRGBToYCbCrFixedCoeffs(LXRGBToYCbCrFixedCoeffs *c, LXColorSpaceEncoding cspace, LXBool fullRange)
+{
+    const double yScale = ((fullRange) ? 255.0 : kLX_Y219_scale) / 255.0 * 32768.0;
+    const double cScale = ((fullRange) ? 255.0 : kLX_C219_scale) / 255.0 * 32768.0;
+    const LXBool is709 = (cspace == kLX_YCbCr_Rec709);
+    
+    c->yMat[0] = (int16_t)lround(yScale * ((is709) ? kLX_709_toY__R : kLX_601_toY__R));
+    c->yMat[1] = (int16_t)lround(yScale * ((is709) ? kLX_709_toY__G : kLX_601_toY__G));
+    c->yMat[2] = (int16_t)lround(yScale * ((is709) ? kLX_709_toY__B : kLX_601_toY__B));
+    c->cbMat[0] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPb_R : kLX_601_toPb_R));
+    c->cbMat[1] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPb_G : kLX_601_toPb_G));
+    c->cbMat[2] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPb_B : kLX_601_toPb_B));
+    c->crMat[0] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPr_R : kLX_601_toPr_R));
+    c->crMat[1] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPr_G : kLX_601_toPr_G));
+    c->crMat[2] = (int16_t)lround(cScale * ((is709) ? kLX_709_toPr_B : kLX_601_toPr_B));
+    c->yOff = (fullRange) ? 0 : kLX_Y219_offset;
+}
+
+// returns chroma without the 128 offset (with fractional bits); the encoder filters these before rounding
+LXINLINE void rgbToYCbCrFixed(const LXRGBToYCbCrFixedCoeffs *c, const uint8_t *px, const LXBool isARGB,
+                              int *outY, int *outCb, int *outCr)
+{
+    const int r = (int)px[(isARGB) ? 1 : 0] << 7;
+    const int g = (int)px[(isARGB) ? 2 : 1] << 7;
+    const int b = (int)px[(isARGB) ? 3 : 2] << 7;
+    const int yv = YCC_MULHI(r, c->yMat[0]) + YCC_MULHI(g, c->yMat[1]) + YCC_MULHI(b, c->yMat[2])
+                        + (c->yOff << RGB2YCC_FRAC_BITS) + (1 << (RGB2YCC_FRAC_BITS - 1));
+    *outY = yv >> RGB2YCC_FRAC_BITS;
+    *outCb = YCC_MULHI(r, c->cbMat[0]) + YCC_MULHI(g, c->cbMat[1]) + YCC_MULHI(b, c->cbMat[2]);
+    *outCr = YCC_MULHI(r, c->crMat[0]) + YCC_MULHI(g, c->crMat[1]) + YCC_MULHI(b, c->crMat[2]);
+}
+
+#define RGB2YCC_CHROMA_BIAS   ((128 << RGB2YCC_FRAC_BITS) + (1 << (RGB2YCC_FRAC_BITS - 1)))
+
+
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+
+// expands 4 chroma values (in the low halves of 32-bit lanes) to 8 pixels.
+// "next" holds the following pair's chroma in lane 0, used for interpolating the last odd pixel.
+LXINLINE LXFUNCATTR_SSE __m128i upsample422Chroma_SSE2(__m128i c, __m128i next, const LXBool filterChroma)
+{
+    __m128i odd = c;
+    if (filterChroma) {
+        next = _mm_or_si128(_mm_srli_si128(c, 4), _mm_slli_si128(next, 12));
+        odd = _mm_avg_epu16(c, next);
+    }
+    return _mm_or_si128(c, _mm_slli_epi32(odd, 16));
+}
+
+// returns number of pixel pairs processed
+static LXFUNCATTR_SSE LXInteger convertYCbCr422Row_to_RGBA_int8_SSE2(const LXInteger numPairs,
+                                                                     const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst,
+                                                                     const LXYCbCrFixedCoeffs *c, const LXBool isYUY2, const LXBool filterChroma)
+{
+    const __m128i vyOff = _mm_set1_epi16(c->yOff);
+    const __m128i vcOff = _mm_set1_epi16(128);
+    const __m128i vlowMask = _mm_set1_epi16(0xff);
+    const __m128i vlowMask32 = _mm_set1_epi32(0xffff);
+    const __m128i vyMul = _mm_set1_epi16(c->yMul);
+    const __m128i vcrMul_r = _mm_set1_epi16(c->crMul_r);
+    const __m128i vcrMul_g = _mm_set1_epi16(c->crMul_g);
+    const __m128i vcbMul_g = _mm_set1_epi16(c->cbMul_g);
+    const __m128i vcbMul_b = _mm_set1_epi16(c->cbMul_b);
+    // with filtering, the chroma of the pair following each 16-pixel block is read, so the last block is left for the scalar loop
+    const LXInteger n = (filterChroma) ? (numPairs - 1) / 8 : numPairs / 8;
+    LXInteger i;
+    
+    for (i = 0; i < n; i++) {
+        const uint8_t *s = src + i*32;
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(s));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i vn = (filterChroma) ? _mm_cvtsi32_si128(*((const int32_t *)(s + 32))) : _mm_setzero_si128();
+        __m128i ylo, yhi, c0, c1, cn;
+        
+        if (isYUY2) {
+            ylo = _mm_and_si128(v0, vlowMask);
+            yhi = _mm_and_si128(v1, vlowMask);
+            c0 = _mm_srli_epi16(v0, 8);
+            c1 = _mm_srli_epi16(v1, 8);
+            cn = _mm_srli_epi16(vn, 8);
+        } else {
+            ylo = _mm_srli_epi16(v0, 8);
+            yhi = _mm_srli_epi16(v1, 8);
+            c0 = _mm_and_si128(v0, vlowMask);
+            c1 = _mm_and_si128(v1, vlowMask);
+            cn = _mm_and_si128(vn, vlowMask);
+        }
+        ylo = _mm_slli_epi16(_mm_sub_epi16(ylo, vyOff), 7);
+        yhi = _mm_slli_epi16(_mm_sub_epi16(yhi, vyOff), 7);
         
-        LXPxConvert_float32_to_int32_withRange_inplace_SSE2(tempBuf2, vecN * 16*2,  0, 1);
-        LXPxConvert_int32_to_int8_withSaturate_SSE2((int32_t *)tempBuf2, dst, vecN * 16*2);
+        // chroma is now { cb0, cr0, cb1, cr1, ... } in 16-bit lanes
+        __m128i cb0 = _mm_and_si128(c0, vlowMask32);
+        __m128i cb1 = _mm_and_si128(c1, vlowMask32);
+        __m128i cr0 = _mm_srli_epi32(c0, 16);
+        __m128i cr1 = _mm_srli_epi32(c1, 16);
         
-        stride = (w - (vecN * 8)) / 2;
-        src += vecN * 16;
-        dst += vecN * 16 * 2;
-#endif
+        __m128i cblo = upsample422Chroma_SSE2(cb0, cb1, filterChroma);
+        __m128i cbhi = upsample422Chroma_SSE2(cb1, _mm_and_si128(cn, vlowMask32), filterChroma);
+        __m128i crlo = upsample422Chroma_SSE2(cr0, cr1, filterChroma);
+        __m128i crhi = upsample422Chroma_SSE2(cr1, _mm_srli_epi32(cn, 16), filterChroma);
         
-        for (n = 0; n < stride; n++) {
-            uint32_t v = *((uint32_t *)src);
-            int cb = GETBYTE0(v);
-            int y0 = GETBYTE1(v);
-            int cr = GETBYTE2(v);
-            int y1 = GETBYTE3(v);
+        cblo = _mm_slli_epi16(_mm_sub_epi16(cblo, vcOff), 8);
+        cbhi = _mm_slli_epi16(_mm_sub_epi16(cbhi, vcOff), 8);
+        crlo = _mm_slli_epi16(_mm_sub_epi16(crlo, vcOff), 8);
+        crhi = _mm_slli_epi16(_mm_sub_epi16(crhi, vcOff), 8);
+        
+        convertYCbCr16_to_RGBA_int8_SSE2(ylo, yhi, cblo, cbhi, crlo, crhi,
+                                         vyMul, vcrMul_r, vcrMul_g, vcbMul_g, vcbMul_b,
+                                         dst + i*64);
+    }
+    return n * 8;
+}
 
-            /*  R = 1.164(Y-16) + 1.596(Cr-128)
-                G = 1.164(Y-16) - 0.813(Cr-128) - 0.391(Cb-128)
-                B = 1.164(Y-16) + 2.018(Cb-128)
-            */
-            cr = FIXD_FROM_INT(cr - 128);
-            cb = FIXD_FROM_INT(cb - 128);
-            y0 = FIXD_FROM_INT(y0 - 16);
-            y1 = FIXD_FROM_INT(y1 - 16);
-            
-            int scaled_cr_r = FIXD_MUL(fxd_crMul_r, cr);
-            int scaled_cr_g = FIXD_MUL(fxd_crMul_g, cr);
-            int scaled_cb_g = FIXD_MUL(fxd_cbMul_g, cb);
-            int scaled_cb_b = FIXD_MUL(fxd_cbMul_b, cb);
-            
-            int scaled_y = FIXD_MUL(fxd_lumaMul, y0);
-            int r = scaled_y + scaled_cr_r;
-            int g = scaled_y + scaled_cr_g + scaled_cb_g;
-            int b = scaled_y + scaled_cb_b;
-            
-            v = 0;
-            SETBYTE0(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(r)));
-            SETBYTE1(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(g)));
-            SETBYTE2(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(b)));
-            SETBYTE3(v, 255);            
-            ((uint32_t *)dst)[0] = v;
-            
-            scaled_y = FIXD_MUL(fxd_lumaMul, y1);
-            r = scaled_y + scaled_cr_r;
-            g = scaled_y + scaled_cr_g + scaled_cb_g;
-            b = scaled_y + scaled_cb_b;
-
-            v = 0;
-            SETBYTE0(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(r)));
-            SETBYTE1(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(g)));
-            SETBYTE2(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(b)));
-            SETBYTE3(v, 255);            
-            ((uint32_t *)dst)[1] = v;
-            
-            src += 4;
-            dst += 8;
+// converts 8 pixels to 16-bit Y and 16-bit chroma sums (without offset)
+LXINLINE LXFUNCATTR_SSE void convertRGBA8_to_YCbCrFixed_SSE2(__m128i v0, __m128i v1, const LXBool isARGB,
+                                                             const LXRGBToYCbCrFixedCoeffs *c, const __m128i vyBias,
+                                                             __m128i *outY, __m128i *outCb, __m128i *outCr)
+{
+    const __m128i vlowMask = _mm_set1_epi16(0xff);
+    const __m128i vlowMask32 = _mm_set1_epi32(0xffff);
+    __m128i r, g, b;
+    
+    if (isARGB) {
+        __m128i ag0 = _mm_and_si128(v0, vlowMask),  ag1 = _mm_and_si128(v1, vlowMask);
+        __m128i rb0 = _mm_srli_epi16(v0, 8),        rb1 = _mm_srli_epi16(v1, 8);
+        r = _mm_packs_epi32(_mm_and_si128(rb0, vlowMask32), _mm_and_si128(rb1, vlowMask32));
+        g = _mm_packs_epi32(_mm_srli_epi32(ag0, 16), _mm_srli_epi32(ag1, 16));
+        b = _mm_packs_epi32(_mm_srli_epi32(rb0, 16), _mm_srli_epi32(rb1, 16));
+    } else {
+        __m128i rb0 = _mm_and_si128(v0, vlowMask),  rb1 = _mm_and_si128(v1, vlowMask);
+        __m128i ga0 = _mm_srli_epi16(v0, 8),        ga1 = _mm_srli_epi16(v1, 8);
+        r = _mm_packs_epi32(_mm_and_si128(rb0, vlowMask32), _mm_and_si128(rb1, vlowMask32));
+        g = _mm_packs_epi32(_mm_and_si128(ga0, vlowMask32), _mm_and_si128(ga1, vlowMask32));
+        b = _mm_packs_epi32(_mm_srli_epi32(rb0, 16), _mm_srli_epi32(rb1, 16));
+    }
+    r = _mm_slli_epi16(r, 7);
+    g = _mm_slli_epi16(g, 7);
+    b = _mm_slli_epi16(b, 7);
+    
+    __m128i yv = _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(r, _mm_set1_epi16(c->yMat[0])),
+                                             _mm_mulhi_epi16(g, _mm_set1_epi16(c->yMat[1]))),
+                               _mm_mulhi_epi16(b, _mm_set1_epi16(c->yMat[2])));
+    *outY = _mm_srai_epi16(_mm_add_epi16(yv, vyBias), RGB2YCC_FRAC_BITS);
+    
+    *outCb = _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(r, _mm_set1_epi16(c->cbMat[0])),
+                                         _mm_mulhi_epi16(g, _mm_set1_epi16(c->cbMat[1]))),
+                           _mm_mulhi_epi16(b, _mm_set1_epi16(c->cbMat[2])));
+    *outCr = _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(r, _mm_set1_epi16(c->crMat[0])),
+                                         _mm_mulhi_epi16(g, _mm_set1_epi16(c->crMat[1]))),
+                           _mm_mulhi_epi16(b, _mm_set1_epi16(c->crMat[2])));
+}
+
+// subsamples per-pixel chroma sums to one value per pair (as 32-bit lanes).
+// "carry" holds the previous pixel's value in lane 0 and is updated for the next block.
+LXINLINE LXFUNCATTR_SSE __m128i subsample422Chroma_SSE2(__m128i cv, __m128i *carry, const LXBool filterChroma)
+{
+    const __m128i vbias = _mm_set1_epi32(RGB2YCC_CHROMA_BIAS);
+    __m128i even = _mm_srai_epi32(_mm_slli_epi32(cv, 16), 16);
+    
+    if (filterChroma) {
+        __m128i odd = _mm_srai_epi32(cv, 16);
+        __m128i prev = _mm_or_si128(_mm_slli_si128(odd, 4), *carry);
+        *carry = _mm_srli_si128(odd, 12);
+        
+        even = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(even, 1), odd), _mm_add_epi32(prev, _mm_set1_epi32(2)));
+        even = _mm_srai_epi32(even, 2);
+    }
+    return _mm_srai_epi32(_mm_add_epi32(even, vbias), RGB2YCC_FRAC_BITS);
+}
+
+// returns number of pixel pairs processed
+static LXFUNCATTR_SSE LXInteger convertRGBARow_to_YCbCr422_SSE2(const LXInteger numPairs,
+                                                                const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst,
+                                                                const LXRGBToYCbCrFixedCoeffs *c, const LXBool isARGB,
+                                                                const LXBool isYUY2, const LXBool filterChroma)
+{
+    const __m128i vyBias = _mm_set1_epi16((c->yOff << RGB2YCC_FRAC_BITS) + (1 << (RGB2YCC_FRAC_BITS - 1)));
+    const __m128i vlowMask32 = _mm_set1_epi32(0xffff);
+    const __m128i vzero = _mm_setzero_si128();
+    const __m128i vmax = _mm_set1_epi16(255);
+    const LXInteger n = numPairs / 4;  // 8 pixels (32 bytes of RGBA) per iteration
+    __m128i carryCb = vzero, carryCr = vzero;
+    LXInteger i;
+    
+    for (i = 0; i < n; i++) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(src + i*32));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(src + i*32 + 16));
+        __m128i yv, cbv, crv;
+        convertRGBA8_to_YCbCrFixed_SSE2(v0, v1, isARGB, c, vyBias, &yv, &cbv, &crv);
+        
+        if (i == 0) {
+            // the row's first pixel has no left neighbour, so it's used in place of one
+            carryCb = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(cbv, 16), 16), _mm_cvtsi32_si128(-1));
+            carryCr = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(crv, 16), 16), _mm_cvtsi32_si128(-1));
         }
+        __m128i cb = subsample422Chroma_SSE2(cbv, &carryCb, filterChroma);
+        __m128i cr = subsample422Chroma_SSE2(crv, &carryCr, filterChroma);
+        
+        __m128i cbcr = _mm_or_si128(_mm_and_si128(cb, vlowMask32), _mm_slli_epi32(cr, 16));
+        cbcr = _mm_min_epi16(_mm_max_epi16(cbcr, vzero), vmax);
+        yv = _mm_min_epi16(_mm_max_epi16(yv, vzero), vmax);
+        
+        __m128i out = (isYUY2) ? _mm_or_si128(yv, _mm_slli_epi16(cbcr, 8))
+                               : _mm_or_si128(cbcr, _mm_slli_epi16(yv, 8));
+        _mm_storeu_si128((__m128i *)(dst + i*16), out);
     }
-   
-#if (USE_SSE2_FOR_YUV)
-    _lx_free(tempBuf);
+    return n * 4;
+}
+
+#endif  // __SSE2__
+
+
+static void convertYCbCr422Row_to_RGBA_int8(const LXInteger numPairs,
+                                            const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst,
+                                            const LXYCbCrFixedCoeffs *c, const LXBool isYUY2, const LXBool filterChroma)
+{
+    const LXInteger yIdx = (isYUY2) ? 0 : 1;
+    const LXInteger cIdx = (isYUY2) ? 1 : 0;
+    LXInteger i = 0;
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+    i = convertYCbCr422Row_to_RGBA_int8_SSE2(numPairs, src, dst, c, isYUY2, filterChroma);
 #endif
+    for (; i < numPairs; i++) {
+        const uint8_t *s = src + i*4;
+        int cb = s[cIdx];
+        int cr = s[cIdx + 2];
+        convertYCbCrPixel_to_RGBA_int8(c, s[yIdx], cb, cr, dst + i*8);
+        
+        if (filterChroma && i+1 < numPairs) {
+            cb = (cb + s[4 + cIdx] + 1) >> 1;
+            cr = (cr + s[4 + cIdx + 2] + 1) >> 1;
+        }
+        convertYCbCrPixel_to_RGBA_int8(c, s[yIdx + 2], cb, cr, dst + i*8 + 4);
+    }
 }
 
-void LXPxConvert_YCbCr422_YUY2_to_RGBA_int8(const LXInteger w, const LXInteger h,
-                                                   uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
-                                                   uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
-                                                   LXColorSpaceEncoding cspace)
+static void convertRGBARow_to_YCbCr422(const LXInteger numPairs,
+                                       const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst,
+                                       const LXRGBToYCbCrFixedCoeffs *c, const LXBool isARGB,
+                                       const LXBool isYUY2, const LXBool filterChroma)
 {
+    LXInteger i = 0;
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+    i = convertRGBARow_to_YCbCr422_SSE2(numPairs, src, dst, c, isARGB, isYUY2, filterChroma);
+#endif
+    for (; i < numPairs; i++) {
+        const uint8_t *s = src + i*8;
+        uint8_t *d = dst + i*4;
+        int y0, y1, cb, cr, cb1, cr1;
+        rgbToYCbCrFixed(c, s, isARGB, &y0, &cb, &cr);
+        rgbToYCbCrFixed(c, s + 4, isARGB, &y1, &cb1, &cr1);
+        
+        if (filterChroma) {
+            int cbPrev = cb, crPrev = cr, dummy;
+            if (i > 0) rgbToYCbCrFixed(c, s - 4, isARGB, &dummy, &cbPrev, &crPrev);
+            cb = (2*cb + cb1 + cbPrev + 2) >> 2;
+            cr = (2*cr + cr1 + crPrev + 2) >> 2;
+        }
+        cb = (cb + RGB2YCC_CHROMA_BIAS) >> RGB2YCC_FRAC_BITS;
+        cr = (cr + RGB2YCC_CHROMA_BIAS) >> RGB2YCC_FRAC_BITS;
+        
+        d[(isYUY2) ? 0 : 1] = YCC_CLAMP_255(y0);
+        d[(isYUY2) ? 2 : 3] = YCC_CLAMP_255(y1);
+        d[(isYUY2) ? 1 : 0] = YCC_CLAMP_255(cb);
+        d[(isYUY2) ? 3 : 2] = YCC_CLAMP_255(cr);
+    }
+}
 
-    const LXInteger stride = w / 2;
-    const LXFixedNum fxd_lumaMul = FIXD_FROM_FLOAT(255.0 / kLX_Y219_scale);  // 1.164
-    const LXFixedNum fxd_crMul_r = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toR__Pr : kLX_601_toR__Pr));  // 1.596
-    const LXFixedNum fxd_crMul_g = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pr : kLX_601_toG__Pr));  // 0.813
-    const LXFixedNum fxd_cbMul_g = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toG__Pb : kLX_601_toG__Pb));  // 0.391
-    const LXFixedNum fxd_cbMul_b = FIXD_FROM_FLOAT((255.0 / kLX_C219_scale) * ((cspace == kLX_YCbCr_Rec709) ? kLX_709_toB__Pb : kLX_601_toB__Pb));  // 2.018
+void LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma)
+{
+    const LXBool isYUY2 = ((ycbcrFormatID & 0xff) == kLX_YCbCrFormat_YUY2);
+    LXYCbCrFixedCoeffs coeffs;
+    getYCbCrToRGBFixedCoeffs(&coeffs, cspace, (ycbcrFormatID & kLX_YCbCrFormatFlag_FullRange) ? YES : NO);
+    
+    LXInteger y;
+    for (y = 0; y < h; y++) {
+        convertYCbCr422Row_to_RGBA_int8(w / 2, srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, &coeffs, isYUY2, filterChroma);
+    }
+}
 
+static void convertToYCbCr422(const LXInteger w, const LXInteger h,
+                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma, LXBool srcIsARGB)
+{
+    const LXBool isYUY2 = ((ycbcrFormatID & 0xff) == kLX_YCbCrFormat_YUY2);
+    LXRGBToYCbCrFixedCoeffs coeffs;
+    getRGBToYCbCrFixedCoeffs(&coeffs, cspace, (ycbcrFormatID & kLX_YCbCrFormatFlag_FullRange) ? YES : NO);
+    
     LXInteger y;
     for (y = 0; y < h; y++) {
-        uint32_t * LXRESTRICT src = (uint32_t *)(srcBuf + srcRowBytes * y);
-        uint32_t * LXRESTRICT dst = (uint32_t *)(dstBuf + dstRowBytes * y);
-        LXInteger n;
-        for (n = 0; n < stride; n++) {
-            uint32_t v = *src;
-            int y0 = GETBYTE0(v);
-            int cb = GETBYTE1(v);
-            int y1 = GETBYTE2(v);
-            int cr = GETBYTE3(v);
-
-            cr = FIXD_FROM_INT(cr - 128);
-            cb = FIXD_FROM_INT(cb - 128);
-            y0 = FIXD_FROM_INT(y0 - 16);
-            y1 = FIXD_FROM_INT(y1 - 16);
-            
-            int scaled_cr_r = FIXD_MUL(fxd_crMul_r, cr);
-            int scaled_cr_g = FIXD_MUL(fxd_crMul_g, cr);
-            int scaled_cb_g = FIXD_MUL(fxd_cbMul_g, cb);
-            int scaled_cb_b = FIXD_MUL(fxd_cbMul_b, cb);
-            
-            int scaled_y = FIXD_MUL(fxd_lumaMul, y0);
-            int r = scaled_y + scaled_cr_r;
-            int g = scaled_y + scaled_cr_g + scaled_cb_g;
-            int b = scaled_y + scaled_cb_b;
-            
-            v = 0;
-            SETBYTE0(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(r)));
-            SETBYTE1(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(g)));
-            SETBYTE2(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(b)));
-            SETBYTE3(v, 255);            
-            dst[0] = v;
-            
-            scaled_y = FIXD_MUL(fxd_lumaMul, y1);
-            r = scaled_y + scaled_cr_r;
-            g = scaled_y + scaled_cr_g + scaled_cb_g;
-            b = scaled_y + scaled_cb_b;
-
-            v = 0;
-            SETBYTE0(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(r)));
-            SETBYTE1(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(g)));
-            SETBYTE2(v, (uint32_t) FIXD_TO_INT(FIXD_CLAMP_255(b)));
-            SETBYTE3(v, 255);            
-            dst[1] = v;
-            
-            src++;
-            dst += 2;
-        }
+        convertRGBARow_to_YCbCr422(w / 2, srcBuf + srcRowBytes * y, dstBuf + dstRowBytes * y, &coeffs, srcIsARGB, isYUY2, filterChroma);
     }
 }
 
+void LXPxConvert_RGBA_to_YCbCr422_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma)
+{
+    convertToYCbCr422(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, ycbcrFormatID, filterChroma, NO);
+}
+
+void LXPxConvert_ARGB_to_YCbCr422_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma)
+{
+    convertToYCbCr422(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, ycbcrFormatID, filterChroma, YES);
+}
+
+void LXPxConvert_RGBA_to_YCbCr422(const LXInteger w, const LXInteger h,
+                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                         LXColorSpaceEncoding cspace)
+{
+    convertToYCbCr422(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, kLX_YCbCrFormat_2vuy, NO, NO);
+}
+
+void LXPxConvert_ARGB_to_YCbCr422(const LXInteger w, const LXInteger h,
+                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                         LXColorSpaceEncoding cspace)
+{
+    convertToYCbCr422(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, kLX_YCbCrFormat_2vuy, NO, YES);
+}
+
+void LXPxConvert_YCbCr422_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace)
+{
+    LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, kLX_YCbCrFormat_2vuy, NO);
+}
+
+void LXPxConvert_YCbCr422_YUY2_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                                   uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                                   uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                                   LXColorSpaceEncoding cspace)
+{
+    LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(w, h, srcBuf, srcRowBytes, dstBuf, dstRowBytes, cspace, kLX_YCbCrFormat_YUY2, NO);
+}
+
 
 // --- RGBA 4-unit conversions ---
 
@@ -2022,7 +2721,7 @@ void LXPxConvert_float32_to_int8(float * LXRESTRICT srcBuf, uint8_t * LXRESTRICT
         const size_t unrolledCount = count / 16;
         int32_t *tempBuf = _lx_malloc(count * sizeof(int32_t));
     
-        memcpy(srcBuf, tempBuf, unrolledCount*16*sizeof(int32_t));
+        memcpy(tempBuf, srcBuf, unrolledCount*16*sizeof(int32_t));
 
         LXPxConvert_float32_to_int32_withSaturate_inplace_SSE2((float *)tempBuf, unrolledCount*16,  255);
         
@@ -2349,37 +3048,12 @@ void LXImageCalcHistogram_RGBA_int8(const LXInteger w, const LXInteger h,
                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
                                              uint32_t * LXRESTRICT histBuf)
 {
-    const size_t histEntries = 256;
-    
     if ( !histBuf || !srcBuf || srcRowBytes < 1) return;
     
-    memset(histBuf, 0, histEntries*4*sizeof(uint32_t));
-    
-    uint32_t * LXRESTRICT histR = histBuf;
-    uint32_t * LXRESTRICT histG = histBuf + 256;
-    uint32_t * LXRESTRICT histB = histBuf + 256*2;
-    uint32_t * LXRESTRICT histA = histBuf + 256*3;
+    // the statistics engine counts with replicated sub-histograms on multiple threads;
+    // its default 256 bins over 0-1 are the same as the 8-bit values
+    memset(histBuf, 0, 256*4*sizeof(uint32_t));
     
-    LXInteger x, y;
-
-    for (y = 0; y < h; y++) {
-        uint32_t * LXRESTRICT usrc = (uint32_t *) (srcBuf + srcRowBytes * y);
-        
-        for (x = 0; x < w; x++) {
-            uint32_t u = *usrc++;
-
-            uint32_t r = GETBYTE0(u);
-            histR[r]++;
-            
-            uint32_t g = GETBYTE1(u);
-            histG[g]++;
-
-            uint32_t b = GETBYTE2(u);
-            histB[b]++;
-
-            uint32_t a = GETBYTE3(u);            
-            histA[a]++;
-        }
-    }
+    LXImageCalcStatisticsForData(srcBuf, srcRowBytes, w, h, kLX_RGBA_INT8, NULL, NULL, histBuf, NULL);
 }
 
@@ -17,6 +17,7 @@
 
 #include "LXBasicTypes.h"
 #include "LXHalfFloat.h"
+#include "LXRefTypes.h"
 
 
 // for convenience of browing through functions,
@@ -193,6 +194,84 @@ LXEXPORT void LXPxConvert_YCbCr422_YUY2_to_RGBA_int8(const LXInteger w, const LX
                                                    uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
                                                    LXColorSpaceEncoding cspace);  // cspace must be kLX_YCbCr_Rec601 or kLX_YCbCr_Rec709
 
+// 4:2:2 conversions with explicit layout and range.
+// "ycbcrFormatID" is kLX_YCbCrFormat_2vuy or kLX_YCbCrFormat_YUY2, optionally combined with kLX_YCbCrFormatFlag_FullRange (see LXPixelBuffer.h).
+// chroma is treated as co-sited with even luma samples. with filterChroma, odd pixels get linearly interpolated chroma
+// when decoding, and the encoder applies a [1 2 1] filter instead of point-sampling.
+// the plain functions above are equivalent to these with 2vuy/YUY2 video levels and no filtering.
+LXEXPORT void LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma);
+
+LXEXPORT void LXPxConvert_RGBA_to_YCbCr422_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma);
+
+LXEXPORT void LXPxConvert_ARGB_to_YCbCr422_withFormat(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma);
+
+// planar YCbCr formats.
+// fullRange means JFIF-style 0-255 levels for both luma and chroma (otherwise 16-235 / 16-240 video levels).
+// 4:2:0 chroma is upsampled using nearest neighbour; the RGBA->4:2:0 direction averages 2x2 blocks.
+LXEXPORT void LXPxConvert_YCbCr420_planar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);  // cspace must be kLX_YCbCr_Rec601 or kLX_YCbCr_Rec709
+
+LXEXPORT void LXPxConvert_YCbCr420_biplanar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_CbCr, const size_t srcRowBytes_chroma,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_YCbCr444_planar_to_RGBA_int8(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+// float output is not clamped, so superwhites are preserved
+LXEXPORT void LXPxConvert_YCbCr420_planar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_YCbCr420_biplanar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_CbCr, const size_t srcRowBytes_chroma,
+                                              float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_YCbCr444_planar_to_RGBA_float32(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
+                                              uint8_t * LXRESTRICT srcBuf_Cb, uint8_t * LXRESTRICT srcBuf_Cr, const size_t srcRowBytes_chroma,
+                                              float * LXRESTRICT dstBuf, const size_t dstRowBytes,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_RGBA_to_YCbCr420_planar(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                              uint8_t * LXRESTRICT dstBuf_Cb, uint8_t * LXRESTRICT dstBuf_Cr, const size_t dstRowBytes_chroma,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_RGBA_to_YCbCr420_biplanar(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                              uint8_t * LXRESTRICT dstBuf_CbCr, const size_t dstRowBytes_chroma,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
+LXEXPORT void LXPxConvert_RGBA_to_YCbCr444_planar(const LXInteger w, const LXInteger h,
+                                              uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
+                                              uint8_t * LXRESTRICT dstBuf_y, const size_t dstRowBytes_y,
+                                              uint8_t * LXRESTRICT dstBuf_Cb, uint8_t * LXRESTRICT dstBuf_Cr, const size_t dstRowBytes_chroma,
+                                              LXColorSpaceEncoding cspace, LXBool fullRange);
+
 LXEXPORT void LXPxConvert_RGB_float16_to_RGB_int10(const LXInteger w, const LXInteger h, 
                                         LXHalf * LXRESTRICT srcBuf, const size_t srcRowBytes, const LXInteger srcValueStride,
                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
@@ -215,14 +294,62 @@ LXEXPORT void LXPxConvert_RGB_float32_to_RGB_int16(const LXInteger w, const LXIn
 
 // -- utilities --
 
-// multiplies RGB components by alpha
+// multiplies RGB components by alpha.
+// the int8 functions round exactly (c*a/255 to nearest); the RGBA versions also work for BGRA, which has alpha in the same place.
+// src and dst can be the same buffer in these and the unpremultiply functions below.
 LXEXPORT void LXImagePremultiply_RGBA_int8_inplace(const LXInteger w, const LXInteger h, 
                                         uint8_t * LXRESTRICT buf, const size_t rowBytes);
 LXEXPORT void LXImagePremultiply_RGBA_int8(const LXInteger w, const LXInteger h, 
                                         uint8_t * LXRESTRICT srcBuf, const size_t srcRowBytes,
                                         uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes);
-
-// blends two YCbCr 4:2:2 scanlines
+LXEXPORT void LXImagePremultiply_ARGB_int8(const LXInteger w, const LXInteger h,
+                                        uint8_t *srcBuf, const size_t srcRowBytes,
+                                        uint8_t *dstBuf, const size_t dstRowBytes);
+LXEXPORT void LXImagePremultiply_RGBA_float16(const LXInteger w, const LXInteger h,
+                                        LXHalf *srcBuf, const size_t srcRowBytes,
+                                        LXHalf *dstBuf, const size_t dstRowBytes);
+LXEXPORT void LXImagePremultiply_RGBA_float32(const LXInteger w, const LXInteger h,
+                                        float *srcBuf, const size_t srcRowBytes,
+                                        float *dstBuf, const size_t dstRowBytes);
+
+// divides RGB components by alpha; pixels with zero alpha become zero.
+// the int8 functions round exactly (c*255/a to nearest) and clamp to 255
+LXEXPORT void LXImageUnpremultiply_RGBA_int8(const LXInteger w, const LXInteger h,
+                                        uint8_t *srcBuf, const size_t srcRowBytes,
+                                        uint8_t *dstBuf, const size_t dstRowBytes);
+LXEXPORT void LXImageUnpremultiply_ARGB_int8(const LXInteger w, const LXInteger h,
+                                        uint8_t *srcBuf, const size_t srcRowBytes,
+                                        uint8_t *dstBuf, const size_t dstRowBytes);
+LXEXPORT void LXImageUnpremultiply_RGBA_float16(const LXInteger w, const LXInteger h,
+                                        LXHalf *srcBuf, const size_t srcRowBytes,
+                                        LXHalf *dstBuf, const size_t dstRowBytes);
+LXEXPORT void LXImageUnpremultiply_RGBA_float32(const LXInteger w, const LXInteger h,
+                                        float *srcBuf, const size_t srcRowBytes,
+                                        float *dstBuf, const size_t dstRowBytes);
+
+// performs one of the kLXAlphaConversion operations (below) on any RGBA-family pixel format.
+// returns NO if the pixel format doesn't have alpha
+LXEXPORT LXBool LXImageApplyAlphaConversion(const LXInteger w, const LXInteger h,
+                                        uint8_t *srcBuf, const size_t srcRowBytes,
+                                        uint8_t *dstBuf, const size_t dstRowBytes,
+                                        const LXPixelFormat pxFormat, const LXUInteger alphaConversion);
+
+// applies a 3D LUT with tetrahedral interpolation (see LXLUT3D.h); alpha is copied.
+// src and dst can be the same buffer. these are implemented in LXLUT3D.c
+LXEXPORT void LXImageApplyLUT3D_RGBA_int8(const LXInteger w, const LXInteger h,
+                                        uint8_t *srcBuf, const size_t srcRowBytes,
+                                        uint8_t *dstBuf, const size_t dstRowBytes,
+                                        LXLUT3DRef lut);
+LXEXPORT void LXImageApplyLUT3D_RGBA_float16(const LXInteger w, const LXInteger h,
+                                        LXHalf *srcBuf, const size_t srcRowBytes,
+                                        LXHalf *dstBuf, const size_t dstRowBytes,
+                                        LXLUT3DRef lut);
+LXEXPORT void LXImageApplyLUT3D_RGBA_float32(const LXInteger w, const LXInteger h,
+                                        float *srcBuf, const size_t srcRowBytes,
+                                        float *dstBuf, const size_t dstRowBytes,
+                                        LXLUT3DRef lut);
+
+// averages two YCbCr 4:2:2 scanlines; see LXImageBlend.h for blending whole images
 LXEXPORT void LXImageBlend_YCbCr422(uint8_t * LXRESTRICT outBuf,
                                     uint8_t * LXRESTRICT buf1, uint8_t * LXRESTRICT buf2,
                                     LXInteger w);
@@ -252,6 +379,14 @@ LXEXPORT void LXPxConvert_int8_to_float32_withRange_VEC(uint8_t * LXRESTRICT src
 #endif
 
 
+// alpha conversions; these are also accepted by the pixel buffer conversion functions (see LXPixelBuffer.h)
+enum {
+    kLXAlphaConversion_None = 0,
+    kLXAlphaConversion_Premultiply,
+    kLXAlphaConversion_Unpremultiply
+};
+
+
 // ---------------------------------
 // RGB<->YUV color matrix constants:
 
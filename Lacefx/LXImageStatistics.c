@@ -0,0 +1,860 @@
+/*
+ *  LXImageStatistics.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXImageStatistics.h"
+#include "LXImageFunctions.h"
+#include "LXPixelBuffer.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include <math.h>
+
+
+enum {
+    kValueInt8 = 0,
+    kValueFloat16,
+    kValueFloat32
+};
+
+// a region of an image in any of the supported formats; the planes are given from the image's origin
+typedef struct {
+    LXPixelFormat pxFormat;
+    const uint8_t *planes[3];
+    size_t rowBytes[3];
+    LXInteger x0, y0, w, h;
+} LXStatsImage;
+
+// the samples of one channel within the region: "rows" rows of "count" samples that are "stride" bytes apart
+typedef struct {
+    const uint8_t *base;
+    size_t rowBytes;
+    LXInteger count;
+    LXInteger rows;
+    LXInteger stride;
+    LXInteger valueType;
+} LXStatsChannel;
+
+
+#define STATS_CHUNK  256
+
+
+LXUInteger LXImageStatisticsChannelCountForPixelFormat(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8:
+            return 4;
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT16:
+        case kLX_Luminance_FLOAT32:
+            return 1;
+        case kLX_YCbCr422_INT8:
+        case kLX_YCbCr420_planar_INT8:
+        case kLX_YCbCr420_biplanar_INT8:
+        case kLX_YCbCr444_planar_INT8:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+static LXBool isYCbCrFormat(LXPixelFormat pxFormat)
+{
+    return (pxFormat >= kLX_YCbCr422_INT8 && pxFormat <= kLX_YCbCr444_planar_INT8) ? YES : NO;
+}
+
+static LXInteger valueTypeForFormat(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_FLOAT16:
+        case kLX_Luminance_FLOAT16:     return kValueFloat16;
+        case kLX_RGBA_FLOAT32:
+        case kLX_Luminance_FLOAT32:     return kValueFloat32;
+        default:                        return kValueInt8;
+    }
+}
+
+// byte offsets of R, G, B, A within a pixel, in units of the value size
+static void getChannelOrder(LXPixelFormat pxFormat, int *offs)
+{
+    switch (pxFormat) {
+        case kLX_ARGB_INT8:
+            offs[0] = 1;  offs[1] = 2;  offs[2] = 3;  offs[3] = 0;
+            break;
+        case kLX_BGRA_INT8:
+            offs[0] = 2;  offs[1] = 1;  offs[2] = 0;  offs[3] = 3;
+            break;
+        default:
+            offs[0] = 0;  offs[1] = 1;  offs[2] = 2;  offs[3] = 3;
+            break;
+    }
+}
+
+static LXInteger getChannels(const LXStatsImage *img, LXStatsChannel *chs)
+{
+    const LXInteger x0 = img->x0, y0 = img->y0;
+    const LXInteger type = valueTypeForFormat(img->pxFormat);
+    const LXInteger valueSize = (type == kValueFloat32) ? 4 : ((type == kValueFloat16) ? 2 : 1);
+    // chroma region for 4:2:0
+    const LXInteger cx0 = x0 / 2, cy0 = y0 / 2;
+    const LXInteger cw = (x0 + img->w + 1) / 2 - cx0;
+    const LXInteger ch = (y0 + img->h + 1) / 2 - cy0;
+    LXInteger i;
+    int offs[4];
+
+    memset(chs, 0, kLXImageStats_MaxChannels * sizeof(LXStatsChannel));
+    for (i = 0; i < kLXImageStats_MaxChannels; i++) {
+        chs[i].rowBytes = img->rowBytes[0];
+        chs[i].count = img->w;
+        chs[i].rows = img->h;
+        chs[i].valueType = type;
+    }
+
+    switch (img->pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8:
+            getChannelOrder(img->pxFormat, offs);
+            for (i = 0; i < 4; i++) {
+                chs[i].base = img->planes[0] + img->rowBytes[0] * y0 + (x0 * 4 + offs[i]) * valueSize;
+                chs[i].stride = 4 * valueSize;
+            }
+            return 4;
+
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT16:
+        case kLX_Luminance_FLOAT32:
+            chs[0].base = img->planes[0] + img->rowBytes[0] * y0 + x0 * valueSize;
+            chs[0].stride = valueSize;
+            return 1;
+
+        case kLX_YCbCr422_INT8: {
+            // bytes are Cb Y0 Cr Y1; x0 is even
+            const uint8_t *base = img->planes[0] + img->rowBytes[0] * y0 + x0 * 2;
+            chs[0].base = base + 1;
+            chs[0].stride = 2;
+            chs[1].base = base;
+            chs[2].base = base + 2;
+            chs[1].stride = chs[2].stride = 4;
+            chs[1].count = chs[2].count = img->w / 2;
+            return 3;
+        }
+
+        case kLX_YCbCr420_planar_INT8:
+        case kLX_YCbCr420_biplanar_INT8:
+        case kLX_YCbCr444_planar_INT8: {
+            const LXBool isBiplanar = (img->pxFormat == kLX_YCbCr420_biplanar_INT8);
+            const LXBool is444 = (img->pxFormat == kLX_YCbCr444_planar_INT8);
+            chs[0].base = img->planes[0] + img->rowBytes[0] * y0 + x0;
+            chs[0].stride = 1;
+            for (i = 1; i < 3; i++) {
+                const LXInteger plane = (isBiplanar) ? 1 : i;
+                const LXInteger cx = (is444) ? x0 : cx0;
+                const LXInteger cy = (is444) ? y0 : cy0;
+                chs[i].rowBytes = img->rowBytes[plane];
+                chs[i].stride = (isBiplanar) ? 2 : 1;
+                chs[i].base = img->planes[plane] + img->rowBytes[plane] * cy + cx * chs[i].stride + ((isBiplanar) ? i - 1 : 0);
+                chs[i].count = (is444) ? img->w : cw;
+                chs[i].rows = (is444) ? img->h : ch;
+            }
+            return 3;
+        }
+    }
+    return 0;
+}
+
+// clips the region to the image; returns NO if nothing is left
+static LXBool setRegion(LXStatsImage *img, uint32_t imageW, uint32_t imageH, const LXRect *region)
+{
+    LXInteger x0 = 0, y0 = 0, x1 = imageW, y1 = imageH;
+
+    if (region) {
+        x0 = MAX(0, lround(region->x));
+        y0 = MAX(0, lround(region->y));
+        x1 = MIN((LXInteger)imageW, lround(region->x + region->w));
+        y1 = MIN((LXInteger)imageH, lround(region->y + region->h));
+    }
+    if (img->pxFormat == kLX_YCbCr422_INT8) {
+        // whole pixel pairs only
+        x0 &= ~(LXInteger)1;
+        x1 = MIN((LXInteger)imageW & ~(LXInteger)1, (x1 + 1) & ~(LXInteger)1);
+    }
+    img->x0 = x0;
+    img->y0 = y0;
+    img->w = x1 - x0;
+    img->h = y1 - y0;
+    return (img->w > 0 && img->h > 0) ? YES : NO;
+}
+
+static LXBool setImageFromData(LXStatsImage *img, const uint8_t *buf, size_t rowBytes, uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                               const LXRect *region, LXError *outError)
+{
+    size_t offsets[3], rbs[3];
+    LXInteger i;
+
+    memset(img, 0, sizeof(LXStatsImage));
+
+    if (LXImageStatisticsChannelCountForPixelFormat(pxFormat) == 0) {
+        char msg[256];
+        sprintf(msg, "unsupported pixel format for image statistics (%lu)", (unsigned long)pxFormat);
+        LXErrorSet(outError, kLXErrorID_ImageStats_UnsupportedPixelFormat, msg);
+        return NO;
+    }
+    img->pxFormat = pxFormat;
+
+    LXPlaneLayoutForPixelFormat(pxFormat, w, h, rowBytes, offsets, rbs);
+    for (i = 0; i < 3; i++) {
+        img->planes[i] = buf + offsets[i];
+        img->rowBytes[i] = rbs[i];
+    }
+
+    if ( !setRegion(img, w, h, region)) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_InvalidRegion, "region is empty or outside the image");
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark --- histograms and statistics ---
+
+typedef struct {
+    uint64_t n;
+    double mean;
+    double m2;      // sum of squared differences from the mean
+    double min;
+    double max;
+} LXStatsAccum;
+
+typedef struct {
+    LXBool isUsed;
+    uint32_t *hist8;        // 8-bit data: four replicas of a 256-entry histogram per channel
+    uint32_t *hist;         // float data: binCount entries per channel
+    LXStatsAccum acc[kLXImageStats_MaxChannels];
+} LXStatsWorker;
+
+typedef struct {
+    LXStatsChannel chs[kLXImageStats_MaxChannels];
+    LXInteger channelCount;
+    LXInteger isInt8;
+    LXInteger binCount;
+    float rangeMin;
+    float binScale;
+    LXInteger h;            // rows of channel 0; the bands are in these rows
+    LXStatsWorker workers[kLXParallelMaxWorkers];
+} LXStatsJob;
+
+static void mergeAccum(LXStatsAccum *a, uint64_t nB, double meanB, double m2B, double minB, double maxB)
+{
+    if (nB == 0) return;
+    if (a->n == 0) {
+        a->n = nB;  a->mean = meanB;  a->m2 = m2B;  a->min = minB;  a->max = maxB;
+        return;
+    }
+    // parallel variance formula (Chan et al.)
+    const double n = (double)(a->n + nB);
+    const double delta = meanB - a->mean;
+    a->mean += delta * nB / n;
+    a->m2 += m2B + delta * delta * ((double)a->n * nB / n);
+    a->n += nB;
+    a->min = MIN(a->min, minB);
+    a->max = MAX(a->max, maxB);
+}
+
+// the first and last bins also collect values outside the range; NaN must be checked before this
+LXINLINE LXInteger binForValue(float v, float rangeMin, float binScale, LXInteger binCount)
+{
+    const float t = (v - rangeMin) * binScale;
+    return (t <= 0.0f) ? 0 : ((t >= (float)binCount) ? binCount - 1 : (LXInteger)t);
+}
+
+static void histogramRow_int8(const uint8_t *p, LXInteger n, LXInteger stride, uint32_t *hist)
+{
+    // the replicas break the dependency between increments of the same bin, which is common in flat image areas
+    uint32_t * LXRESTRICT h0 = hist;
+    uint32_t * LXRESTRICT h1 = hist + 256;
+    uint32_t * LXRESTRICT h2 = hist + 256*2;
+    uint32_t * LXRESTRICT h3 = hist + 256*3;
+    LXInteger x = 0;
+
+    for (; x + 4 <= n; x += 4) {
+        h0[p[0]]++;
+        h1[p[stride]]++;
+        h2[p[stride*2]]++;
+        h3[p[stride*3]]++;
+        p += stride*4;
+    }
+    for (; x < n; x++) {
+        h0[p[0]]++;
+        p += stride;
+    }
+}
+
+// all four channels of an interleaved 8-bit row in one pass; "hists" are the channels' histograms in byte order
+static void histogramRow_int8x4(const uint8_t *p, LXInteger n, uint32_t **hists)
+{
+    uint32_t * LXRESTRICT h0 = hists[0];
+    uint32_t * LXRESTRICT h1 = hists[1];
+    uint32_t * LXRESTRICT h2 = hists[2];
+    uint32_t * LXRESTRICT h3 = hists[3];
+    LXInteger x = 0;
+
+    // neighbouring pixels go to different replicas
+    for (; x + 2 <= n; x += 2) {
+        h0[p[0]]++;
+        h1[p[1]]++;
+        h2[p[2]]++;
+        h3[p[3]]++;
+        h0[256 + p[4]]++;
+        h1[256 + p[5]]++;
+        h2[256 + p[6]]++;
+        h3[256 + p[7]]++;
+        p += 8;
+    }
+    for (; x < n; x++) {
+        h0[p[0]]++;
+        h1[p[1]]++;
+        h2[p[2]]++;
+        h3[p[3]]++;
+        p += 4;
+    }
+}
+
+static void histogramRow_float(const LXStatsJob *job, const LXStatsChannel *ch, const uint8_t *p, uint32_t *hist, LXStatsAccum *acc)
+{
+    float v[STATS_CHUNK];
+    LXInteger x0, i;
+
+    for (x0 = 0; x0 < ch->count; x0 += STATS_CHUNK) {
+        const LXInteger n = MIN(STATS_CHUNK, ch->count - x0);
+        LXInteger count = 0;
+        double sum = 0.0, m2 = 0.0;
+        float vmin = 0.0f, vmax = 0.0f;
+
+        for (i = 0; i < n; i++) {
+            const float f = (ch->valueType == kValueFloat16) ? LXFloatFromHalf(*(const LXHalf *)p) : *(const float *)p;
+            p += ch->stride;
+            if (f != f) continue;
+
+            hist[binForValue(f, job->rangeMin, job->binScale, job->binCount)]++;
+
+            if (count == 0) vmin = vmax = f;
+            else {
+                vmin = MIN(vmin, f);
+                vmax = MAX(vmax, f);
+            }
+            sum += f;
+            v[count++] = f;
+        }
+        if (count == 0) continue;
+
+        // two passes over the chunk so that the variance doesn't suffer from cancellation
+        const double mean = sum / count;
+        for (i = 0; i < count; i++) {
+            const double d = v[i] - mean;
+            m2 += d * d;
+        }
+        mergeAccum(acc, count, mean, m2, vmin, vmax);
+    }
+}
+
+static void statsBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    LXStatsJob *job = (LXStatsJob *)userData;
+    LXStatsWorker *worker = job->workers + workerIndex;
+    LXInteger c, y;
+
+    if ( !worker->isUsed) {
+        // allocated by the worker itself; only one thread at a time runs with a given worker index
+        if (job->isInt8)
+            worker->hist8 = _lx_calloc(job->channelCount * 4 * 256, sizeof(uint32_t));
+        else
+            worker->hist = _lx_calloc(job->channelCount * job->binCount, sizeof(uint32_t));
+        worker->isUsed = YES;
+    }
+
+    if (job->isInt8 && job->channelCount == 4) {
+        uint32_t *hists[4];
+        const uint8_t *base = job->chs[0].base;
+        for (c = 0; c < 4; c++) {
+            base = MIN(base, job->chs[c].base);
+        }
+        for (c = 0; c < 4; c++) {
+            hists[job->chs[c].base - base] = worker->hist8 + c * 4 * 256;
+        }
+        for (y = y0; y < y1; y++) {
+            histogramRow_int8x4(base + job->chs[0].rowBytes * y, job->chs[0].count, hists);
+        }
+        return;
+    }
+
+    for (c = 0; c < job->channelCount; c++) {
+        const LXStatsChannel *ch = job->chs + c;
+        // channels with fewer rows (4:2:0 chroma) are split proportionally
+        const LXInteger r0 = y0 * ch->rows / job->h;
+        const LXInteger r1 = y1 * ch->rows / job->h;
+
+        for (y = r0; y < r1; y++) {
+            const uint8_t *p = ch->base + ch->rowBytes * y;
+            if (job->isInt8)
+                histogramRow_int8(p, ch->count, ch->stride, worker->hist8 + c * 4 * 256);
+            else
+                histogramRow_float(job, ch, p, worker->hist + c * job->binCount, worker->acc + c);
+        }
+    }
+}
+
+static LXSuccess calcStatistics(const LXStatsImage *img, const LXImageHistogramOptions *options,
+                                LXImageStatistics *outStats, uint32_t *outHistogram, LXError *outError)
+{
+    LXStatsJob *job;
+    LXInteger binCount = (options && options->binCount > 0) ? options->binCount : 256;
+    float rangeMin = 0.0f, rangeMax = 1.0f;
+    LXInteger c, i, k;
+
+    if (options && (options->rangeMin != 0.0f || options->rangeMax != 0.0f)) {
+        rangeMin = options->rangeMin;
+        rangeMax = options->rangeMax;
+    }
+    if (binCount > kLXImageStats_MaxBins || !(rangeMax > rangeMin)) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_InvalidOptions, "invalid histogram bin count or range");
+        return NO;
+    }
+
+    job = _lx_calloc(1, sizeof(LXStatsJob));
+    job->channelCount = getChannels(img, job->chs);
+    job->isInt8 = (job->chs[0].valueType == kValueInt8);
+    job->binCount = binCount;
+    job->rangeMin = rangeMin;
+    job->binScale = (float)binCount / (rangeMax - rangeMin);
+    job->h = job->chs[0].rows;
+
+    LXParallelApplyToRowBands(job->chs[0].count, job->h, 0, 0, statsBand, job);
+
+    if (outStats) {
+        memset(outStats, 0, sizeof(LXImageStatistics));
+        outStats->channelCount = job->channelCount;
+    }
+    if (outHistogram) {
+        memset(outHistogram, 0, job->channelCount * binCount * sizeof(uint32_t));
+    }
+
+    for (c = 0; c < job->channelCount; c++) {
+        LXStatsAccum acc;
+        memset(&acc, 0, sizeof(acc));
+
+        if (job->isInt8) {
+            // exact statistics from the merged 8-bit histogram
+            uint64_t counts[256];
+            memset(counts, 0, sizeof(counts));
+            for (k = 0; k < kLXParallelMaxWorkers; k++) {
+                const uint32_t *h = job->workers[k].hist8;
+                if ( !h) continue;
+                h += c * 4 * 256;
+                for (i = 0; i < 256; i++) counts[i] += (uint64_t)h[i] + h[i + 256] + h[i + 512] + h[i + 768];
+            }
+            double sum = 0.0;
+            for (i = 0; i < 256; i++) {
+                if (counts[i] == 0) continue;
+                if (acc.n == 0) acc.min = i / 255.0;
+                acc.max = i / 255.0;
+                acc.n += counts[i];
+                sum += (double)counts[i] * i;
+                if (outHistogram) {
+                    outHistogram[c * binCount + binForValue(i / 255.0f, rangeMin, job->binScale, binCount)] += (uint32_t)counts[i];
+                }
+            }
+            if (acc.n > 0) {
+                acc.mean = sum / acc.n / 255.0;
+                for (i = 0; i < 256; i++) {
+                    const double d = i / 255.0 - acc.mean;
+                    acc.m2 += d * d * counts[i];
+                }
+            }
+        } else {
+            for (k = 0; k < kLXParallelMaxWorkers; k++) {
+                const LXStatsWorker *worker = job->workers + k;
+                if ( !worker->isUsed) continue;
+                mergeAccum(&acc, worker->acc[c].n, worker->acc[c].mean, worker->acc[c].m2, worker->acc[c].min, worker->acc[c].max);
+                if (outHistogram) {
+                    const uint32_t *h = worker->hist + c * binCount;
+                    for (i = 0; i < binCount; i++) outHistogram[c * binCount + i] += h[i];
+                }
+            }
+        }
+
+        if (outStats && acc.n > 0) {
+            outStats->count[c] = acc.n;
+            outStats->min[c] = acc.min;
+            outStats->max[c] = acc.max;
+            outStats->mean[c] = acc.mean;
+            outStats->variance[c] = acc.m2 / acc.n;
+        }
+    }
+
+    for (k = 0; k < kLXParallelMaxWorkers; k++) {
+        _lx_free(job->workers[k].hist8);
+        _lx_free(job->workers[k].hist);
+    }
+    _lx_free(job);
+    return YES;
+}
+
+
+#pragma mark --- row reader for scopes ---
+
+#define VIDEO_Y(v_)  (((float)(v_) - 16.0f) * (1.0f / 219.0f))
+#define VIDEO_C(v_)  (((float)(v_) - 128.0f) * (1.0f / 224.0f))
+
+// reads pixels [x, x+n) of row y as three channels: R, G, B for RGB and luminance data,
+// or Y, Cb, Cr for YCbCr data (as video levels with chroma centered at zero)
+static void readRow3(const LXStatsImage *img, LXInteger x, LXInteger y, LXInteger n, float *c0, float *c1, float *c2)
+{
+    const uint8_t *row = img->planes[0] + img->rowBytes[0] * y;
+    LXInteger i;
+    int offs[4];
+
+    switch (img->pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8: {
+            const uint8_t *p = row + x * 4;
+            getChannelOrder(img->pxFormat, offs);
+            for (i = 0; i < n; i++) {
+                c0[i] = p[offs[0]] * (1.0f / 255.0f);
+                c1[i] = p[offs[1]] * (1.0f / 255.0f);
+                c2[i] = p[offs[2]] * (1.0f / 255.0f);
+                p += 4;
+            }
+            break;
+        }
+        case kLX_RGBA_FLOAT16: {
+            const LXHalf *p = (const LXHalf *)row + x * 4;
+            for (i = 0; i < n; i++) {
+                c0[i] = LXFloatFromHalf(p[0]);
+                c1[i] = LXFloatFromHalf(p[1]);
+                c2[i] = LXFloatFromHalf(p[2]);
+                p += 4;
+            }
+            break;
+        }
+        case kLX_RGBA_FLOAT32: {
+            const float *p = (const float *)row + x * 4;
+            for (i = 0; i < n; i++) {
+                c0[i] = p[0];
+                c1[i] = p[1];
+                c2[i] = p[2];
+                p += 4;
+            }
+            break;
+        }
+        case kLX_Luminance_INT8:
+            for (i = 0; i < n; i++) c0[i] = c1[i] = c2[i] = row[x + i] * (1.0f / 255.0f);
+            break;
+        case kLX_Luminance_FLOAT16:
+            for (i = 0; i < n; i++) c0[i] = c1[i] = c2[i] = LXFloatFromHalf(((const LXHalf *)row)[x + i]);
+            break;
+        case kLX_Luminance_FLOAT32:
+            for (i = 0; i < n; i++) c0[i] = c1[i] = c2[i] = ((const float *)row)[x + i];
+            break;
+
+        case kLX_YCbCr422_INT8:
+            for (i = 0; i < n; i++) {
+                const LXInteger xi = x + i;
+                const uint8_t *pair = row + (xi >> 1) * 4;
+                c0[i] = VIDEO_Y(row[xi * 2 + 1]);
+                c1[i] = VIDEO_C(pair[0]);
+                c2[i] = VIDEO_C(pair[2]);
+            }
+            break;
+
+        case kLX_YCbCr420_planar_INT8:
+        case kLX_YCbCr420_biplanar_INT8:
+        case kLX_YCbCr444_planar_INT8: {
+            const LXBool is444 = (img->pxFormat == kLX_YCbCr444_planar_INT8);
+            const LXBool isBiplanar = (img->pxFormat == kLX_YCbCr420_biplanar_INT8);
+            const LXInteger cy = (is444) ? y : (y >> 1);
+            const uint8_t *rowCb = img->planes[1] + img->rowBytes[1] * cy;
+            const uint8_t *rowCr = (isBiplanar) ? rowCb + 1 : img->planes[2] + img->rowBytes[2] * cy;
+            const LXInteger cstride = (isBiplanar) ? 2 : 1;
+            for (i = 0; i < n; i++) {
+                const LXInteger xi = x + i;
+                const LXInteger cx = ((is444) ? xi : (xi >> 1)) * cstride;
+                c0[i] = VIDEO_Y(row[xi]);
+                c1[i] = VIDEO_C(rowCb[cx]);
+                c2[i] = VIDEO_C(rowCr[cx]);
+            }
+            break;
+        }
+    }
+}
+
+
+#pragma mark --- waveform ---
+
+typedef struct {
+    const LXStatsImage *img;
+    LXBool isLuma;
+    LXBool isYCbCr;
+    LXInteger columns;
+    LXInteger levels;
+    float rangeMin;
+    float levelScale;
+    LXInteger stripColumns;
+    uint32_t *out;
+} LXWaveformJob;
+
+// each strip owns a range of output columns, so the strips can write the output directly
+static void waveformStrip(void *userData, LXInteger workerIndex, LXInteger stripIndex)
+{
+    const LXWaveformJob *job = (const LXWaveformJob *)userData;
+    const LXStatsImage *img = job->img;
+    const LXInteger w = img->w;
+    const LXInteger colStart = stripIndex * job->stripColumns;
+    const LXInteger colEnd = MIN(job->columns, colStart + job->stripColumns);
+    // the image columns whose output column (x * columns / w) falls in this strip
+    const LXInteger xs = (LXInteger)(((int64_t)colStart * w + job->columns - 1) / job->columns);
+    const LXInteger xe = (LXInteger)(((int64_t)colEnd * w + job->columns - 1) / job->columns);
+    const LXInteger planeSize = job->levels * job->columns;
+    float c[3][STATS_CHUNK];
+    LXInteger x0, y, i, k;
+
+    for (y = 0; y < img->h; y++) {
+        for (x0 = xs; x0 < xe; x0 += STATS_CHUNK) {
+            const LXInteger n = MIN(STATS_CHUNK, xe - x0);
+            readRow3(img, img->x0 + x0, img->y0 + y, n, c[0], c[1], c[2]);
+
+            for (i = 0; i < n; i++) {
+                const LXInteger col = (LXInteger)((int64_t)(x0 + i) * job->columns / w);
+                float v[3];
+                if (job->isLuma) {
+                    v[0] = (job->isYCbCr) ? c[0][i] : (kLX_709_toY__R * c[0][i] + kLX_709_toY__G * c[1][i] + kLX_709_toY__B * c[2][i]);
+                } else {
+                    v[0] = c[0][i];
+                    v[1] = (job->isYCbCr) ? c[1][i] + 0.5f : c[1][i];
+                    v[2] = (job->isYCbCr) ? c[2][i] + 0.5f : c[2][i];
+                }
+                for (k = 0; k < ((job->isLuma) ? 1 : 3); k++) {
+                    if (v[k] != v[k]) continue;
+                    job->out[k * planeSize + binForValue(v[k], job->rangeMin, job->levelScale, job->levels) * job->columns + col]++;
+                }
+            }
+        }
+    }
+}
+
+static LXSuccess calcWaveform(const LXStatsImage *img, LXUInteger mode, LXUInteger columns, LXUInteger levels,
+                              float rangeMin, float rangeMax, uint32_t *outWaveform, LXError *outError)
+{
+    LXWaveformJob job;
+
+    if (columns < 1 || levels < 1 || levels > kLXImageStats_MaxBins || !(rangeMax > rangeMin) || mode > kLXWaveform_Luma) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_InvalidOptions, "invalid waveform size, range or mode");
+        return NO;
+    }
+    memset(&job, 0, sizeof(job));
+    job.img = img;
+    job.isLuma = (mode == kLXWaveform_Luma);
+    job.isYCbCr = isYCbCrFormat(img->pxFormat);
+    job.columns = columns;
+    job.levels = levels;
+    job.rangeMin = rangeMin;
+    job.levelScale = (float)levels / (rangeMax - rangeMin);
+    job.out = outWaveform;
+    job.stripColumns = MAX(1, (LXInteger)columns / (LXParallelGetWorkerCount() * 4));
+
+    memset(outWaveform, 0, ((job.isLuma) ? 1 : 3) * levels * columns * sizeof(uint32_t));
+
+    // the strips are columns of the output, so the image size decides whether threads are used
+    const LXInteger stripCount = (columns + job.stripColumns - 1) / job.stripColumns;
+    LXParallelApply(stripCount, ((LXInteger)img->w * img->h < kLXParallelMinPixels) ? 1 : 0, waveformStrip, &job);
+    return YES;
+}
+
+
+#pragma mark --- vectorscope ---
+
+typedef struct {
+    const LXStatsImage *img;
+    LXBool isYCbCr;
+    LXInteger size;
+    uint32_t *grids[kLXParallelMaxWorkers];
+} LXVectorscopeJob;
+
+static void vectorscopeBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    LXVectorscopeJob *job = (LXVectorscopeJob *)userData;
+    const LXStatsImage *img = job->img;
+    const LXInteger size = job->size;
+    const float scale = (float)size;
+    float c[3][STATS_CHUNK];
+    LXInteger x0, y, i;
+
+    if ( !job->grids[workerIndex]) job->grids[workerIndex] = _lx_calloc(size * size, sizeof(uint32_t));
+    uint32_t *grid = job->grids[workerIndex];
+
+    for (y = y0; y < y1; y++) {
+        for (x0 = 0; x0 < img->w; x0 += STATS_CHUNK) {
+            const LXInteger n = MIN(STATS_CHUNK, img->w - x0);
+            readRow3(img, img->x0 + x0, img->y0 + y, n, c[0], c[1], c[2]);
+
+            for (i = 0; i < n; i++) {
+                float pb, pr;
+                if (job->isYCbCr) {
+                    pb = c[1][i];
+                    pr = c[2][i];
+                } else {
+                    pb = kLX_709_toPb_R * c[0][i] + kLX_709_toPb_G * c[1][i] + kLX_709_toPb_B * c[2][i];
+                    pr = kLX_709_toPr_R * c[0][i] + kLX_709_toPr_G * c[1][i] + kLX_709_toPr_B * c[2][i];
+                }
+                if (pb != pb || pr != pr) continue;
+                grid[binForValue(pr, -0.5f, scale, size) * size + binForValue(pb, -0.5f, scale, size)]++;
+            }
+        }
+    }
+}
+
+static LXSuccess calcVectorscope(const LXStatsImage *img, LXUInteger size, uint32_t *outScope, LXError *outError)
+{
+    LXVectorscopeJob job;
+    LXInteger i, k;
+
+    if (size < 1 || size > 4096) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_InvalidOptions, "invalid vectorscope size");
+        return NO;
+    }
+    memset(&job, 0, sizeof(job));
+    job.img = img;
+    job.isYCbCr = isYCbCrFormat(img->pxFormat);
+    job.size = size;
+
+    LXParallelApplyToRowBands(img->w, img->h, 0, 0, vectorscopeBand, &job);
+
+    memset(outScope, 0, size * size * sizeof(uint32_t));
+    for (k = 0; k < kLXParallelMaxWorkers; k++) {
+        if ( !job.grids[k]) continue;
+        for (i = 0; i < (LXInteger)(size * size); i++) outScope[i] += job.grids[k][i];
+        _lx_free(job.grids[k]);
+    }
+    return YES;
+}
+
+
+#pragma mark --- public API ---
+
+enum {
+    kStatsOp_Statistics = 0,
+    kStatsOp_Waveform,
+    kStatsOp_Vectorscope
+};
+
+typedef struct {
+    const LXImageHistogramOptions *options;
+    LXImageStatistics *outStats;
+    uint32_t *outBuf;
+    LXUInteger mode, columns, levels, size;
+    float rangeMin, rangeMax;
+} LXStatsArgs;
+
+static LXSuccess runOnPixelBuffer(LXPixelBufferRef pixbuf, const LXRect *region, LXInteger op, const LXStatsArgs *args, LXError *outError)
+{
+    LXStatsImage img;
+    size_t rowBytes = 0;
+    LXSuccess success = NO;
+
+    if ( !pixbuf || (op != kStatsOp_Statistics && !args->outBuf)) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_EmptyArg, "empty argument");
+        return NO;
+    }
+
+    uint8_t *buf = LXPixelBufferLockPixels(pixbuf, &rowBytes, NULL, outError);
+    if ( !buf) return NO;
+
+    if (setImageFromData(&img, buf, rowBytes, LXPixelBufferGetWidth(pixbuf), LXPixelBufferGetHeight(pixbuf),
+                         LXPixelBufferGetPixelFormat(pixbuf), region, outError)) {
+        switch (op) {
+            case kStatsOp_Statistics:
+                success = calcStatistics(&img, args->options, args->outStats, args->outBuf, outError);
+                break;
+            case kStatsOp_Waveform:
+                success = calcWaveform(&img, args->mode, args->columns, args->levels, args->rangeMin, args->rangeMax, args->outBuf, outError);
+                break;
+            case kStatsOp_Vectorscope:
+                success = calcVectorscope(&img, args->size, args->outBuf, outError);
+                break;
+        }
+    }
+
+    LXPixelBufferUnlockPixels(pixbuf);
+    return success;
+}
+
+LXSuccess LXImageCalcStatistics(LXPixelBufferRef pixbuf, const LXRect *region,
+                                const LXImageHistogramOptions *options,
+                                LXImageStatistics *outStats, uint32_t *outHistogram,
+                                LXError *outError)
+{
+    LXStatsArgs args;
+    memset(&args, 0, sizeof(args));
+    args.options = options;
+    args.outStats = outStats;
+    args.outBuf = outHistogram;
+    return runOnPixelBuffer(pixbuf, region, kStatsOp_Statistics, &args, outError);
+}
+
+LXSuccess LXImageCalcStatisticsForData(const uint8_t *buf, size_t rowBytes, uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                       const LXImageHistogramOptions *options,
+                                       LXImageStatistics *outStats, uint32_t *outHistogram,
+                                       LXError *outError)
+{
+    LXStatsImage img;
+
+    if ( !buf) {
+        LXErrorSet(outError, kLXErrorID_ImageStats_EmptyArg, "empty argument");
+        return NO;
+    }
+    if ( !setImageFromData(&img, buf, rowBytes, w, h, pxFormat, NULL, outError))
+        return NO;
+
+    return calcStatistics(&img, options, outStats, outHistogram, outError);
+}
+
+LXSuccess LXImageCalcWaveform(LXPixelBufferRef pixbuf, const LXRect *region, LXUInteger mode,
+                              LXUInteger columns, LXUInteger levels, float rangeMin, float rangeMax,
+                              uint32_t *outWaveform,
+                              LXError *outError)
+{
+    LXStatsArgs args;
+    memset(&args, 0, sizeof(args));
+    args.outBuf = outWaveform;
+    args.mode = mode;
+    args.columns = columns;
+    args.levels = levels;
+    args.rangeMin = rangeMin;
+    args.rangeMax = rangeMax;
+    return runOnPixelBuffer(pixbuf, region, kStatsOp_Waveform, &args, outError);
+}
+
+LXSuccess LXImageCalcVectorscope(LXPixelBufferRef pixbuf, const LXRect *region, LXUInteger size,
+                                 uint32_t *outScope,
+                                 LXError *outError)
+{
+    LXStatsArgs args;
+    memset(&args, 0, sizeof(args));
+    args.outBuf = outScope;
+    args.size = size;
+    return runOnPixelBuffer(pixbuf, region, kStatsOp_Vectorscope, &args, outError);
+}
@@ -0,0 +1,102 @@
+/*
+ *  LXImageStatistics.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXIMAGESTATISTICS_H_
+#define _LXIMAGESTATISTICS_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+
+
+enum {
+    kLXErrorID_ImageStats_EmptyArg = 6901,
+    kLXErrorID_ImageStats_UnsupportedPixelFormat,
+    kLXErrorID_ImageStats_InvalidRegion,
+    kLXErrorID_ImageStats_InvalidOptions
+};
+
+#define kLXImageStats_MaxChannels  4
+#define kLXImageStats_MaxBins      65536
+
+
+/*
+  Statistics are computed per channel. RGBA-family formats (including ARGB and BGRA) have four channels in R, G, B, A order,
+  luminance formats have one, and the YCbCr formats have three (Y, Cb, Cr) which are sampled at their own resolution.
+
+  Integer values are normalized to 0-1 (i.e. divided by 255), so results are comparable between pixel formats.
+  NaN values in float data are skipped.
+
+  Large images are processed on multiple threads, each with its own sub-histograms that are merged at the end.
+*/
+
+typedef struct {
+    LXUInteger binCount;    // histogram bins per channel; 0 means 256
+    float rangeMin;         // value range covered by the bins; values outside it are counted in the first or last bin.
+    float rangeMax;         // if both are 0, the range is 0-1
+} LXImageHistogramOptions;
+
+typedef struct {
+    LXUInteger channelCount;
+    uint64_t count[kLXImageStats_MaxChannels];     // number of samples that were included
+    double min[kLXImageStats_MaxChannels];
+    double max[kLXImageStats_MaxChannels];
+    double mean[kLXImageStats_MaxChannels];
+    double variance[kLXImageStats_MaxChannels];    // population variance
+} LXImageStatistics;
+
+enum {
+    kLXWaveform_Parade = 0,     // separate waveforms for R, G and B (or Y, Cb and Cr for YCbCr data, with chroma offset by 0.5)
+    kLXWaveform_Luma            // a single waveform of Rec.709 luma (or Y for YCbCr data)
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// returns 0 for pixel formats that are not supported
+LXEXPORT LXUInteger LXImageStatisticsChannelCountForPixelFormat(LXPixelFormat pxFormat);
+
+// "region" can be NULL for the whole pixel buffer; it's clipped to the buffer.
+// "options" can be NULL for the default 256-bin histogram. "outStats" and "outHistogram" can be NULL if not needed;
+// outHistogram must have space for channelCount * binCount values and is stored one channel after another.
+LXEXPORT LXSuccess LXImageCalcStatistics(LXPixelBufferRef pixbuf, const LXRect *region,
+                                         const LXImageHistogramOptions *options,
+                                         LXImageStatistics *outStats, uint32_t *outHistogram,
+                                         LXError *outError);
+
+// the same for data in memory; planar formats must use the layout from LXPlaneLayoutForPixelFormat()
+LXEXPORT LXSuccess LXImageCalcStatisticsForData(const uint8_t *buf, size_t rowBytes, uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                                const LXImageHistogramOptions *options,
+                                                LXImageStatistics *outStats, uint32_t *outHistogram,
+                                                LXError *outError);
+
+// waveform scope: each of "columns" output columns counts the values of its share of the image's columns in "levels" bins
+// over [rangeMin, rangeMax]. the output is laid out as [channel][level][column] with level 0 at rangeMin, for 3 channels
+// in parade mode and 1 in luma mode. YCbCr data is decoded as video levels (16-235 luma), so the scales match RGB data.
+LXEXPORT LXSuccess LXImageCalcWaveform(LXPixelBufferRef pixbuf, const LXRect *region, LXUInteger mode,
+                                       LXUInteger columns, LXUInteger levels, float rangeMin, float rangeMax,
+                                       uint32_t *outWaveform,
+                                       LXError *outError);
+
+// vectorscope: a size*size histogram of Rec.709 Pb/Pr chroma (or the Cb/Cr of YCbCr data, as video levels).
+// the column is given by Pb and the row by Pr; -0.5 to 0.5 maps onto the grid, so neutral colors land in the center.
+LXEXPORT LXSuccess LXImageCalcVectorscope(LXPixelBufferRef pixbuf, const LXRect *region, LXUInteger size,
+                                          uint32_t *outScope,
+                                          LXError *outError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
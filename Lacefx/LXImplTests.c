@@ -13,7 +13,15 @@
  */
 
 #include "Lacefx.h"
+#include "LXImageFunctions.h"
+#include "LXCurveFunctions.h"
+#include "LXRandomGen.h"
+#include "LXFPClosure.h"
+#include "LXShaderUtils.h"
+#include "LXShaderTranslation.h"
+#include "LXPixelBuffer_priv.h"
 #include <math.h>
+#include <time.h>
 
 
 #if 0
@@ -80,6 +88,515 @@ static LXShaderRef createTestPxProg_twoPointGradient()
 }
 
 
+// checks the fixed-point 4:2:2 kernels against a float reference; returns the largest per-channel error found
+static int testYCbCr422Conversions(LXColorSpaceEncoding cspace, LXUInteger ycbcrFormatID, LXBool filterChroma)
+{
+    const LXInteger w = 70;  // not a multiple of 16, so the scalar tail is exercised too
+    const LXInteger h = 4;
+    const size_t rgbaRowBytes = w * 4;
+    const size_t yuvRowBytes = w * 2;
+    uint8_t *rgba = _lx_malloc(rgbaRowBytes * h);
+    uint8_t *rgba2 = _lx_malloc(rgbaRowBytes * h);
+    uint8_t *yuv = _lx_malloc(yuvRowBytes * h);
+    const LXBool isYUY2 = ((ycbcrFormatID & 0xff) == kLX_YCbCrFormat_YUY2);
+    const LXBool fullRange = (ycbcrFormatID & kLX_YCbCrFormatFlag_FullRange) ? YES : NO;
+    const LXBool is709 = (cspace == kLX_YCbCr_Rec709);
+    const double yScale = (fullRange) ? 255.0 : kLX_Y219_scale;
+    const double cScale = (fullRange) ? 255.0 : kLX_C219_scale;
+    const double yOff = (fullRange) ? 0.0 : kLX_Y219_offset;
+    const int yIdx = (isYUY2) ? 0 : 1;
+    const int cIdx = (isYUY2) ? 1 : 0;
+    int maxErr = 0;
+    LXInteger x, y, i;
+    
+    uint32_t seed = 1234567;
+    for (i = 0; i < (LXInteger)(rgbaRowBytes * h); i++) {
+        seed = seed * 1664525 + 1013904223;
+        rgba[i] = (uint8_t)(seed >> 24);
+    }
+    
+    // RGBA -> 4:2:2
+    LXPxConvert_RGBA_to_YCbCr422_withFormat(w, h, rgba, rgbaRowBytes, yuv, yuvRowBytes, cspace, ycbcrFormatID, filterChroma);
+    
+    for (y = 0; y < h; y++) {
+        const uint8_t *s = rgba + rgbaRowBytes * y;
+        const uint8_t *d = yuv + yuvRowBytes * y;
+        double cb[w], cr[w];
+        for (x = 0; x < w; x++) {
+            const double r = s[x*4] / 255.0, g = s[x*4+1] / 255.0, b = s[x*4+2] / 255.0;
+            const double yv = yOff + yScale * ((is709) ? (kLX_709_toY__R*r + kLX_709_toY__G*g + kLX_709_toY__B*b)
+                                                       : (kLX_601_toY__R*r + kLX_601_toY__G*g + kLX_601_toY__B*b));
+            cb[x] = cScale * ((is709) ? (kLX_709_toPb_R*r + kLX_709_toPb_G*g + kLX_709_toPb_B*b)
+                                      : (kLX_601_toPb_R*r + kLX_601_toPb_G*g + kLX_601_toPb_B*b));
+            cr[x] = cScale * ((is709) ? (kLX_709_toPr_R*r + kLX_709_toPr_G*g + kLX_709_toPr_B*b)
+                                      : (kLX_601_toPr_R*r + kLX_601_toPr_G*g + kLX_601_toPr_B*b));
+            int err = abs((int)d[(x/2)*4 + yIdx + (x&1)*2] - (int)lround(MIN(255.0, MAX(0.0, yv))));
+            maxErr = MAX(maxErr, err);
+        }
+        for (x = 0; x < w; x += 2) {
+            double cbv = cb[x], crv = cr[x];
+            if (filterChroma) {
+                const LXInteger prev = (x > 0) ? x-1 : x;
+                cbv = (cb[prev] + 2*cb[x] + cb[x+1]) * 0.25;
+                crv = (cr[prev] + 2*cr[x] + cr[x+1]) * 0.25;
+            }
+            int err1 = abs((int)d[(x/2)*4 + cIdx] - (int)lround(MIN(255.0, MAX(0.0, 128.0 + cbv))));
+            int err2 = abs((int)d[(x/2)*4 + cIdx + 2] - (int)lround(MIN(255.0, MAX(0.0, 128.0 + crv))));
+            maxErr = MAX(maxErr, MAX(err1, err2));
+        }
+    }
+    
+    // 4:2:2 -> RGBA; the source is random data so that out-of-gamut values get tested too
+    for (i = 0; i < (LXInteger)(yuvRowBytes * h); i++) {
+        seed = seed * 1664525 + 1013904223;
+        yuv[i] = (uint8_t)(seed >> 24);
+    }
+    LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(w, h, yuv, yuvRowBytes, rgba2, rgbaRowBytes, cspace, ycbcrFormatID, filterChroma);
+    
+    for (y = 0; y < h; y++) {
+        const uint8_t *s = yuv + yuvRowBytes * y;
+        const uint8_t *d = rgba2 + rgbaRowBytes * y;
+        for (x = 0; x < w; x++) {
+            const LXInteger pair = x / 2;
+            int icb = s[pair*4 + cIdx];
+            int icr = s[pair*4 + cIdx + 2];
+            if ((x & 1) && filterChroma && pair+1 < w/2) {
+                icb = (icb + s[pair*4 + 4 + cIdx] + 1) / 2;
+                icr = (icr + s[pair*4 + 4 + cIdx + 2] + 1) / 2;
+            }
+            const double yv = (s[pair*4 + yIdx + (x&1)*2] - yOff) * (255.0 / yScale);
+            const double cbv = (icb - 128) * (255.0 / cScale);
+            const double crv = (icr - 128) * (255.0 / cScale);
+            const double rgb[3] = { yv + ((is709) ? kLX_709_toR__Pr : kLX_601_toR__Pr) * crv,
+                                    yv + ((is709) ? kLX_709_toG__Pr : kLX_601_toG__Pr) * crv + ((is709) ? kLX_709_toG__Pb : kLX_601_toG__Pb) * cbv,
+                                    yv + ((is709) ? kLX_709_toB__Pb : kLX_601_toB__Pb) * cbv };
+            for (i = 0; i < 3; i++) {
+                int err = abs((int)d[x*4 + i] - (int)lround(MIN(255.0, MAX(0.0, rgb[i]))));
+                maxErr = MAX(maxErr, err);
+            }
+            if (d[x*4 + 3] != 255) maxErr = MAX(maxErr, 255);
+        }
+    }
+    
+    _lx_free(rgba);
+    _lx_free(rgba2);
+    _lx_free(yuv);
+    return maxErr;
+}
+
+
+// linear congruential generator for the randomized tests, so that they are repeatable on every platform
+static int nextTestRand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return (int)(*seed >> 8);
+}
+
+// writes a random LCQfp program that reads the scalars s1-s2 and the vectors v1-v2
+static void makeRandomFPClosureProgram(char *prog, uint32_t *seed)
+{
+    static const char *opNames[20] = { "ABS", "ADD", "CMP", "DP3", "EX2", "FLR", "FRC", "LG2", "LRP", "MAD",
+                                       "MAX", "MIN", "MOV", "MUL", "POW", "RCP", "RSQ", "SIN", "COS", "SUB" };
+    static const int opSrcCounts[20] = { 1, 2, 3, 2, 1, 1, 1, 1, 3, 3,  2, 2, 1, 2, 2, 1, 1, 1, 1, 2 };
+    static const char *dstMasks[8] = { "", ".x", ".y", ".xy", ".xyz", ".w", ".yzw", ".xw" };
+    static const char *srcSwizzles[6] = { "", ".x", ".y", ".z", ".w", ".wwww" };
+    const int instrCount = 1 + nextTestRand(seed) % 12;
+    int i, j, k;
+
+    strcpy(prog, "!!LCQfp1.0\n");
+
+    for (i = 0; i < instrCount; i++) {
+        const int op = nextTestRand(seed) % 20;
+        const int sat = nextTestRand(seed) % 4;
+        const int dstReg = nextTestRand(seed) % 5;
+        const int dstMask = nextTestRand(seed) % 8;
+        sprintf(prog + strlen(prog), "%s%s r%i%s", opNames[op], (sat == 0) ? "_SAT" : "", dstReg, dstMasks[dstMask]);
+
+        for (j = 0; j < opSrcCounts[op]; j++) {
+            const int argType = nextTestRand(seed) % 5;
+            char *argStr = prog + strlen(prog);
+            if (argType == 0) {
+                sprintf(argStr, ", %.3f", (nextTestRand(seed) % 2000 - 1000) / 250.0);
+            }
+            else if (argType == 1) {
+                double c[4];
+                for (k = 0; k < 4; k++) c[k] = (nextTestRand(seed) % 800 - 400) / 100.0;
+                sprintf(argStr, ", { %.2f, %.2f, %.2f, %.2f }", c[0], c[1], c[2], c[3]);
+            }
+            else {
+                const int reg = (argType == 4) ? nextTestRand(seed) % 5 : 1 + nextTestRand(seed) % 2;
+                const int swizzle = nextTestRand(seed) % 6;
+                sprintf(argStr, ", %s%i%s", (argType == 2) ? "s" : ((argType == 3) ? "v" : "r"), reg, srcSwizzles[swizzle]);
+            }
+        }
+        strcat(prog, ";\n");
+    }
+    strcat(prog, "END\n");
+}
+
+// random program inputs with some special values mixed in
+static float makeRandomFPClosureInput(uint32_t *seed)
+{
+    static const float specialValues[6] = { 0.0f, -0.0f, 1.0f, -1.0f, 1.0e30f, -1.0e-40f };
+
+    if (nextTestRand(seed) % 4 == 0)
+        return specialValues[nextTestRand(seed) % 6];
+    else
+        return (nextTestRand(seed) % 2000 - 1000) / 77.0f;
+}
+
+LXINLINE LXBool fpClosureResultsAreIdentical(const float *a, const float *b, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        if (memcmp(&a[i], &b[i], sizeof(float)) != 0 && !(isnan(a[i]) && isnan(b[i])))
+            return NO;
+    }
+    return YES;
+}
+
+// runs random programs through the FPClosure JIT and the interpreter; returns the number of mismatching results
+static int testFPClosureJIT(int programCount)
+{
+    uint32_t seed = 7654321;
+    int mismatches = 0;
+    int n, i, j;
+
+    for (n = 0; n < programCount; n++) {
+        char prog[2048];
+        makeRandomFPClosureProgram(prog, &seed);
+
+        LXFPClosureSetJITEnabled(YES);
+        LXFPClosurePtr jitCls = LXFPClosureCreateWithString(prog, strlen(prog));
+        LXFPClosureSetJITEnabled(NO);
+        LXFPClosurePtr intCls = LXFPClosureCreateWithString(prog, strlen(prog));
+        LXFPClosureSetJITEnabled(YES);
+
+        if ( !jitCls || !intCls) {
+            printf("*** FPClosure JIT test: couldn't create closure:\n%s", prog);
+            mismatches++;
+        }
+        else {
+#if defined(__x86_64__) && (defined(LXPLATFORM_MAC) || defined(LXPLATFORM_LINUX)) && defined(__GNUC__)
+            if ( !LXFPClosureIsJITCompiled(jitCls)) {
+                if (mismatches < 3)
+                    printf("*** FPClosure JIT test: program was not compiled to native code:\n%s", prog);
+                mismatches++;
+            }
+#endif
+            for (i = 0; i < 4; i++) {
+                float scalars[2], vectors[8];
+                float jitRes[4], intRes[4];
+                for (j = 0; j < 2; j++) scalars[j] = makeRandomFPClosureInput(&seed);
+                for (j = 0; j < 8; j++) vectors[j] = makeRandomFPClosureInput(&seed);
+
+                int jitErr = LXFPClosureExecute_f(jitCls, jitRes, scalars, 2, vectors, 2);
+                int intErr = LXFPClosureExecute_f(intCls, intRes, scalars, 2, vectors, 2);
+
+                if (jitErr != intErr || !fpClosureResultsAreIdentical(jitRes, intRes, 4)) {
+                    if (mismatches < 3)
+                        printf("*** FPClosure JIT result differs from interpreter: %f %f %f %f vs. %f %f %f %f; program:\n%s",
+                                    jitRes[0], jitRes[1], jitRes[2], jitRes[3], intRes[0], intRes[1], intRes[2], intRes[3], prog);
+                    mismatches++;
+                }
+            }
+        }
+        LXFPClosureDestroy(jitCls);
+        LXFPClosureDestroy(intCls);
+    }
+    return mismatches;
+}
+
+
+// runs random programs through LXFPClosureExecuteBatch() and per element through LXFPClosureExecute_f();
+// returns the number of mismatching elements
+static int testFPClosureBatch(int programCount)
+{
+    const int count = 37;  // two full batches and a partial one
+    uint32_t seed = 1234567;
+    int mismatches = 0;
+    int n, i, j;
+
+    for (n = 0; n < programCount; n++) {
+        char prog[2048];
+        float scalars[count * 2], vectors[count * 8];
+        float batchRes[count * 4];
+        makeRandomFPClosureProgram(prog, &seed);
+
+        LXFPClosurePtr cls = LXFPClosureCreateWithString(prog, strlen(prog));
+        if ( !cls) {
+            printf("*** FPClosure batch test: couldn't create closure:\n%s", prog);
+            mismatches++;
+            continue;
+        }
+        for (j = 0; j < count * 2; j++) scalars[j] = makeRandomFPClosureInput(&seed);
+        for (j = 0; j < count * 8; j++) vectors[j] = makeRandomFPClosureInput(&seed);
+
+        int batchErr = LXFPClosureExecuteBatch(cls, count, batchRes, scalars, 2, vectors, 2);
+
+        for (i = 0; i < count; i++) {
+            float res[4];
+            int err = LXFPClosureExecute_f(cls, res, scalars + i * 2, 2, vectors + i * 8, 2);
+
+            if (err != batchErr || !fpClosureResultsAreIdentical(res, batchRes + i * 4, 4)) {
+                if (mismatches < 3)
+                    printf("*** FPClosure batch result differs from scalar at element %i: %f %f %f %f vs. %f %f %f %f; program:\n%s", i,
+                                batchRes[i*4], batchRes[i*4+1], batchRes[i*4+2], batchRes[i*4+3], res[0], res[1], res[2], res[3], prog);
+                mismatches++;
+            }
+        }
+        LXFPClosureDestroy(cls);
+    }
+    return mismatches;
+}
+
+// RGBA pixels for testing color conversions. the tests fill "exp" and "exp8" with the expected RGB values
+// for the float and 8-bit sources, and checkTestPixels() compares the converted pixels against them
+typedef struct {
+    int n;
+    float *fsrc, *fdst;
+    uint8_t *isrc, *idst;
+    float *exp, *exp8;
+} LXTestPixels;
+
+static void createTestPixels(LXTestPixels *px, int n)
+{
+    int i;
+    px->n = n;
+    px->fsrc = _lx_malloc(n * 4 * sizeof(float));
+    px->fdst = _lx_malloc(n * 4 * sizeof(float));
+    px->isrc = _lx_malloc(n * 4);
+    px->idst = _lx_malloc(n * 4);
+    px->exp = _lx_malloc(n * 3 * sizeof(float));
+    px->exp8 = _lx_malloc(n * 3 * sizeof(float));
+    for (i = 0; i < n * 4; i++) {
+        px->isrc[i] = (i * 37 + (i >> 4)) & 255;
+        px->fsrc[i] = (float)((i * 7919) % 1201) / 1000.0f - 0.1f;  // includes values outside 0-1
+    }
+}
+
+static void destroyTestPixels(LXTestPixels *px)
+{
+    _lx_free(px->fsrc);
+    _lx_free(px->fdst);
+    _lx_free(px->isrc);
+    _lx_free(px->idst);
+    _lx_free(px->exp);
+    _lx_free(px->exp8);
+}
+
+// with "relativeAboveOne", the float error is relative for expected values above 1.
+// alpha must be passed through unchanged, otherwise the 8-bit error is 255
+static void checkTestPixels(const LXTestPixels *px, LXBool relativeAboveOne, double *outMaxErr, int *outMaxErr8)
+{
+    double maxErr = 0.0;
+    int maxErr8 = 0;
+    int i, c;
+    for (i = 0; i < px->n; i++) {
+        for (c = 0; c < 3; c++) {
+            const float exp = px->exp[i*3 + c];
+            const float exp8 = px->exp8[i*3 + c];
+            const double scale = (relativeAboveOne) ? MAX(1.0, fabs(exp)) : 1.0;
+            maxErr = MAX(maxErr, fabs(px->fdst[i*4 + c] - exp) / scale);
+            maxErr8 = MAX(maxErr8, abs((int)px->idst[i*4 + c] - (int)lround(MIN(1.0f, MAX(0.0f, exp8)) * 255.0f)));
+        }
+        if (px->fdst[i*4 + 3] != px->fsrc[i*4 + 3] || px->idst[i*4 + 3] != px->isrc[i*4 + 3]) maxErr8 = 255;
+    }
+    *outMaxErr = MAX(*outMaxErr, maxErr);
+    *outMaxErr8 = MAX(*outMaxErr8, maxErr8);
+}
+
+
+// distance from "p" to the segment a-b
+static double distanceToSegment(LXPoint p, LXPoint a, LXPoint b)
+{
+    const double dx = b.x - a.x, dy = b.y - a.y;
+    const double t = MIN(1.0, MAX(0.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / (dx*dx + dy*dy)));
+    const double ex = p.x - a.x - t * dx, ey = p.y - a.y - t * dy;
+    return sqrt(ex*ex + ey*ey);
+}
+
+// distance from "p" to the arc from angle a0 to a1 (a0 < a1, within 0-2pi) around "c"
+static double distanceToArc(LXPoint p, LXPoint c, double radius, double a0, double a1)
+{
+    double a = atan2(p.y - c.y, p.x - c.x);
+    if (a < 0.0) a += 2.0 * M_PI;
+    if (a >= a0 && a <= a1) {
+        return fabs(sqrt((p.x - c.x)*(p.x - c.x) + (p.y - c.y)*(p.y - c.y)) - radius);
+    }
+    const double d0 = hypot(p.x - c.x - radius * cos(a0), p.y - c.y - radius * sin(a0));
+    const double d1 = hypot(p.x - c.x - radius * cos(a1), p.y - c.y - radius * sin(a1));
+    return MIN(d0, d1);
+}
+
+// component "c" (0 = Y, 1 = Cb, 2 = Cr) of pixel (x, y) in a 4:2:0 or 4:4:4 planar or a 4:2:2 (2vuy) buffer
+static uint8_t *testYCbCrSample(LXPixelBufferRef pb, int x, int y, int c)
+{
+    size_t rb = 0;
+    if (LXPixelBufferGetPixelFormat(pb) == kLX_YCbCr422_INT8) {
+        uint8_t *row = LXPixelBufferGetBaseAddressOfPlane(pb, 0, &rb) + rb * y;
+        return row + (x >> 1) * 4 + ((c == 0) ? 1 + (x & 1) * 2 : (c - 1) * 2);
+    }
+    if (c > 0 && LXPixelBufferGetPixelFormat(pb) == kLX_YCbCr420_planar_INT8) {
+        x /= 2;  y /= 2;
+    }
+    return LXPixelBufferGetBaseAddressOfPlane(pb, c, &rb) + rb * y + x;
+}
+
+#if LX_HAS_BUILTIN_PNG
+#include <zlib.h>
+
+// unpremultiplied RGBA sample for the PNG tests, 0-65535 (8-bit images use the high byte)
+static int testPNGSample(int x, int y, int c)
+{
+    const uint32_t hash = ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)c * 83492791u);
+    if (c == 3 && (x + y) % 7 == 0)
+        return ((x + y) % 2) ? 0 : 65535;
+    return (int)((hash >> 7) & 0xffff);
+}
+
+static uint8_t *appendTestPNGChunk(uint8_t *p, const char *type, const uint8_t *data, size_t len)
+{
+    uLong crc = crc32(0, NULL, 0);
+    p[0] = (uint8_t)(len >> 24);  p[1] = (uint8_t)(len >> 16);  p[2] = (uint8_t)(len >> 8);  p[3] = (uint8_t)len;
+    memcpy(p + 4, type, 4);
+    if (len > 0) memcpy(p + 8, data, len);
+    crc = crc32(crc, p + 4, (uInt)(4 + len));
+    p += 8 + len;
+    p[0] = (uint8_t)(crc >> 24);  p[1] = (uint8_t)(crc >> 16);  p[2] = (uint8_t)(crc >> 8);  p[3] = (uint8_t)crc;
+    return p + 4;
+}
+
+// an Adam7-interlaced RGBA image of testPNGSample() values with unfiltered rows (Lacefx's writer doesn't interlace)
+static uint8_t *createTestInterlacedPNG(int w, int h, int bitDepth, size_t *outLen)
+{
+    static const int s_x0[7] = { 0, 4, 0, 2, 0, 1, 0 },  s_y0[7] = { 0, 0, 4, 0, 2, 0, 1 };
+    static const int s_dx[7] = { 8, 8, 4, 4, 2, 2, 1 },  s_dy[7] = { 8, 8, 8, 4, 4, 2, 2 };
+    static const uint8_t s_signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    const int bpp = 4 * bitDepth / 8;
+    uint8_t *raw = _lx_malloc(w * h * bpp + 7 * h);
+    uint8_t *p = raw;
+    int pass, x, y, c;
+
+    for (pass = 0; pass < 7; pass++) {
+        for (y = s_y0[pass]; y < h && s_x0[pass] < w; y += s_dy[pass]) {
+            *p++ = 0;
+            for (x = s_x0[pass]; x < w; x += s_dx[pass]) {
+                for (c = 0; c < 4; c++) {
+                    const int v = testPNGSample(x, y, c);
+                    *p++ = (uint8_t)(v >> 8);
+                    if (bitDepth == 16) *p++ = (uint8_t)v;
+                }
+            }
+        }
+    }
+
+    uLongf zLen = compressBound(p - raw);
+    uint8_t *zData = _lx_malloc(zLen);
+    compress(zData, &zLen, raw, p - raw);
+
+    const uint8_t ihdr[13] = { w >> 24, w >> 16, w >> 8, w,  h >> 24, h >> 16, h >> 8, h,  bitDepth, 6, 0, 0, 1 };
+    uint8_t *png = _lx_malloc(8 + (12 + 13) + (12 + zLen) + 12);
+    memcpy(png, s_signature, 8);
+    p = appendTestPNGChunk(png + 8, "IHDR", ihdr, 13);
+    p = appendTestPNGChunk(p, "IDAT", zData, zLen);
+    p = appendTestPNGChunk(p, "IEND", NULL, 0);
+    *outLen = p - png;
+
+    _lx_free(raw);
+    _lx_free(zData);
+    return png;
+}
+#endif
+
+#if LX_HAS_LIBTIFF
+#include <tiffio.h>
+#include "LXHalfFloat.h"
+
+// sample for the TIFF tests, 0-65535 (8-bit files use the high byte)
+static int testTIFFSample(int x, int y, int c)
+{
+    return (int)((((uint32_t)x * 131u + (uint32_t)y * 71u + (uint32_t)c * 4099u) * 2654435761u) >> 16);
+}
+
+// writes testTIFFSample() values with libTIFF directly, so that the reader sees layouts Lacefx's writer doesn't produce.
+// "chunkSize" is the tile size for tiled files, otherwise rows per strip.
+static LXSuccess writeTestTIFF(const char *path, int w, int h, int spp, int bps, int sampleFormat, LXBool tiled, LXBool planar,
+                               int chunkSize, int photometric, int extraSample)
+{
+    TIFF *tiff = TIFFOpen(path, "w");
+    if ( !tiff) return NO;
+
+    const uint16_t extra = (uint16_t)extraSample;
+    TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t)w);
+    TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t)h);
+    TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, (uint16_t)bps);
+    TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)spp);
+    TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, (uint16_t)sampleFormat);
+    TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, (planar) ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG);
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, (uint16_t)photometric);
+    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+    if (photometric == PHOTOMETRIC_YCBCR)
+        TIFFSetField(tiff, TIFFTAG_YCBCRSUBSAMPLING, (uint16_t)1, (uint16_t)1);
+    if (spp == 4)
+        TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, (uint16_t)1, &extra);
+    if (tiled) {
+        TIFFSetField(tiff, TIFFTAG_TILEWIDTH, (uint32_t)chunkSize);
+        TIFFSetField(tiff, TIFFTAG_TILELENGTH, (uint32_t)chunkSize);
+    } else {
+        TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, (uint32_t)chunkSize);
+    }
+
+    const int chunkW = (tiled) ? chunkSize : w;
+    const int chunkSpp = (planar) ? 1 : spp;
+    const size_t bytesPerSample = bps / 8;
+    uint8_t *buf = _lx_calloc((size_t)chunkW * chunkSize * chunkSpp, bytesPerSample);
+    LXBool ok = YES;
+    int plane, x0, y0, x, y, c;
+
+    for (plane = 0; plane < ((planar) ? spp : 1); plane++) {
+        for (y0 = 0; y0 < h; y0 += chunkSize) {
+            for (x0 = 0; x0 < w; x0 += chunkW) {
+                const int rows = (tiled) ? chunkSize : MIN(chunkSize, h - y0);
+                for (y = 0; y < rows; y++) {
+                    for (x = 0; x < chunkW; x++) {
+                        for (c = 0; c < chunkSpp; c++) {
+                            const int v = testTIFFSample(x0 + x, y0 + y, (planar) ? plane : c);
+                            const size_t i = ((size_t)y * chunkW + x) * chunkSpp + c;
+                            if (bps == 8)                           buf[i] = (uint8_t)(v >> 8);
+                            else if (bps == 32)                     ((float *)buf)[i] = v / 65535.0f;
+                            else if (sampleFormat == SAMPLEFORMAT_IEEEFP)  ((LXHalf *)buf)[i] = LXHalfFromFloat(v / 65535.0f);
+                            else                                    ((uint16_t *)buf)[i] = (uint16_t)v;
+                        }
+                    }
+                }
+                const tsize_t len = (tsize_t)((size_t)chunkW * rows * chunkSpp * bytesPerSample);
+                if (tiled)
+                    ok = ok && TIFFWriteEncodedTile(tiff, TIFFComputeTile(tiff, x0, y0, 0, plane), buf, len) == len;
+                else
+                    ok = ok && TIFFWriteEncodedStrip(tiff, TIFFComputeStrip(tiff, y0, plane), buf, len) == len;
+            }
+        }
+    }
+    TIFFClose(tiff);
+    _lx_free(buf);
+    return ok;
+}
+#endif
+
+// wall-clock seconds for the benchmarks
+static double benchmarkTime()
+{
+#if defined(LXPLATFORM_WIN)
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+}
+
+
 void LXImplRunTests()
 {
     LXSuccess ok;
@@ -199,6 +716,112 @@ void LXImplRunTests()
     LXTransform3DTransformVector4Ptr(t, vec);
     LXDEBUGLOG("transformed vec: %f, %f, %f, %f (exp 35.017859, -41.87779, 37)", vec[0], vec[1], vec[2], vec[3]);
     }
+    
+    // batch transforms against the single-vector path; the count is large enough to be threaded,
+    // and the float arrays are offset by one element so they're unaligned
+    LXTransform3DConcatPerspective(t, 1.0, 1.5, 0.1, 100.0);
+    {
+    const size_t n = 70001;
+    LXFloat *vd = _lx_malloc(n * 4 * sizeof(LXFloat));
+    float *vf = (float *)_lx_malloc((n * 4 + 1) * sizeof(float)) + 1;
+    float *soa = _lx_malloc(n * 4 * sizeof(float));
+    float *proj = _lx_malloc(n * 4 * sizeof(float));
+    LXRect viewport = LXMakeRect(10, 20, 640, 480);
+    size_t i, bad = 0;
+    int j;
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < 4; j++) {
+            vd[i*4+j] = vf[i*4+j] = soa[j*n+i] = (j == 3) ? 1.0f : (float)((i * 7 + j * 13) % 101) - 50.0f;
+        }
+    }
+    LXTransform3DTransformVector4ArrayInPlace(t, vd, n);
+    LXTransform3DProjectVector4Array_f(t, vf, proj, n, viewport);
+    LXTransform3DTransformVector4ArrayInPlace_f(t, vf, n);
+    LXTransform3DTransformVectorArraySoA_f(t, soa, soa + n, soa + 2*n, NULL, soa, soa + n, soa + 2*n, soa + 3*n, n);
+    
+    for (i = 0; i < n; i += 97) {
+        LXFloat ref[4] = { (float)((i * 7) % 101) - 50.0f, (float)((i * 7 + 13) % 101) - 50.0f, (float)((i * 7 + 26) % 101) - 50.0f, 1 };
+        LXTransform3DTransformVector4Ptr(t, ref);
+        for (j = 0; j < 4; j++) {
+            double tol = 1e-4 * (1.0 + fabs(ref[j]));
+            if (fabs(vd[i*4+j] - ref[j]) > tol || fabs(vf[i*4+j] - ref[j]) > tol || fabs(soa[j*n+i] - ref[j]) > tol)
+                bad++;
+        }
+        if (fabs(ref[3]) > 1.0 && (fabs(proj[i*4+0] - (10 + 320 * (1 + ref[0]/ref[3]))) > 1e-2 || fabs(proj[i*4+1] - (20 + 240 * (1 + ref[1]/ref[3]))) > 1e-2
+                || fabs(proj[i*4+2] - 0.5 * (1 + ref[2]/ref[3])) > 1e-4 || fabs(proj[i*4+3] - 1.0/ref[3]) > 1e-4))
+            bad++;
+    }
+    if (bad)
+        printf("*** batch vector transforms differ from single-vector transform (%ld)\n", (long)bad);
+    
+    _lx_free(vd);
+    _lx_free(vf - 1);
+    _lx_free(soa);
+    _lx_free(proj);
+    }
+    
+    // matrix classes: concat with the fast paths must match the general product, and inverses must round-trip
+    {
+    LXTransform3DRef ts[6];
+    const LX4x4MatrixClass expClasses[6] = { kLX4x4MatrixClass_Identity, kLX4x4MatrixClass_Translate, kLX4x4MatrixClass_ScaleTranslate,
+                                             kLX4x4MatrixClass_Affine2D, kLX4x4MatrixClass_Affine3D, kLX4x4MatrixClass_Projective };
+    LXInteger a, b, bad = 0;
+    int i, j, k;
+    ts[0] = LXTransform3DCreateIdentity();
+    ts[1] = LXTransform3DCreateWithTranslation(3, -2, 5);
+    ts[2] = LXTransform3DCreateWithScale(2, 0.5, 4);
+    LXTransform3DTranslate(ts[2], 1, 2, 3);
+    ts[3] = LXTransform3DCreateWith2DTransform(0.8, -0.6, 0.6, 0.8, 10, 20);
+    ts[4] = LXTransform3DCreateWithRotation(0.3, 1, 1, 0);
+    LXTransform3DTranslate(ts[4], 1, 2, 3);
+    ts[5] = LXTransform3DCopy(ts[4]);
+    LXTransform3DConcatPerspective(ts[5], 1.0, 1.5, 0.1, 100.0);
+
+    for (a = 0; a < 6; a++) {
+        if (LXTransform3DGetMatrixClass(ts[a]) != expClasses[a])
+            printf("*** transform %ld: wrong matrix class %ld\n", (long)a, (long)LXTransform3DGetMatrixClass(ts[a]));
+    }
+    for (a = 0; a < 6; a++) {
+        for (b = 0; b < 6; b++) {
+            LX4x4Matrix ma, mb, mc;
+            LXFloat *fa = (LXFloat *)&ma, *fb = (LXFloat *)&mb, *fc = (LXFloat *)&mc;
+            LXTransform3DRef c = LXTransform3DCopy(ts[b]);
+            LXTransform3DConcat(c, ts[a]);
+            LXTransform3DGetMatrix(ts[a], &ma);
+            LXTransform3DGetMatrix(ts[b], &mb);
+            LXTransform3DGetMatrix(c, &mc);
+            for (i = 0; i < 4; i++) {
+                for (j = 0; j < 4; j++) {
+                    LXFloat v = 0.0;
+                    for (k = 0; k < 4; k++) v += fa[i*4+k] * fb[k*4+j];
+                    if (fabs(v - fc[i*4+j]) > 1e-5) bad++;
+                }
+            }
+            // c * inverse(c) is identity
+            if ( !LXTransform3DGetInverseMatrix(c, &ma)) {
+                bad++;
+            } else {
+                LXTransform3DConcatMatrix(c, &ma);
+                LXTransform3DGetMatrix(c, &mc);
+                for (i = 0; i < 16; i++) {
+                    if (fabs(fc[i] - ((i % 5 == 0) ? 1.0 : 0.0)) > 1e-5) bad++;
+                }
+            }
+            LXTransform3DRelease(c);
+        }
+    }
+    if ( !LXTransform3DInvert(ts[1]) || !LXTransform3DInvert(ts[1])) {
+        bad++;
+    } else {
+        LX4x4Matrix m;
+        LXTransform3DGetMatrix(ts[1], &m);
+        if (m.m14 != 3 || m.m24 != -2 || m.m34 != 5 || m.m44 != 1) bad++;
+    }
+    if (bad)
+        printf("*** matrix class fast paths differ from general matrix ops (%ld)\n", (long)bad);
+    
+    for (a = 0; a < 6; a++) LXTransform3DRelease(ts[a]);
+    }
    }
    
    /* --- pixelprogram evaluation test --- */
@@ -238,6 +861,1253 @@ void LXImplRunTests()
    }
    
 
+   /* --- YCbCr 4:2:2 fixed-point conversion accuracy --- */
+   {
+    const LXColorSpaceEncoding cspaces[2] = { kLX_YCbCr_Rec601, kLX_YCbCr_Rec709 };
+    const LXUInteger formats[4] = { kLX_YCbCrFormat_2vuy, kLX_YCbCrFormat_YUY2,
+                                    kLX_YCbCrFormat_2vuy | kLX_YCbCrFormatFlag_FullRange, kLX_YCbCrFormat_YUY2 | kLX_YCbCrFormatFlag_FullRange };
+    int i, j, filter;
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 4; j++) {
+            for (filter = 0; filter < 2; filter++) {
+                int maxErr = testYCbCr422Conversions(cspaces[i], formats[j], filter);
+                if (maxErr > 1)
+                    printf("*** YCbCr 4:2:2 conversion error too large: %i (cspace %i, format 0x%x, filter %i)\n",
+                                    maxErr, (int)cspaces[i], (int)formats[j], filter);
+            }
+        }
+    }
+   }
+
+
+   /* --- JPEG raw YCbCr round trip --- */
+#if !defined(LXPLATFORM_IOS)
+   {
+    // odd sizes, so that the last pixel pairs and chroma rows are partial
+    const int w = 37, h = 23;
+    const LXPixelFormat formats[3] = { kLX_YCbCr420_planar_INT8, kLX_YCbCr422_INT8, kLX_YCbCr444_planar_INT8 };
+    LXMapPtr props = LXMapCreateMutable();
+    int f;
+    LXMapSetDouble(props, kLXPixelBufferFormatRequestKey_CompressionQuality, 1.0);
+    LXMapSetBool(props, kLXPixelBufferFormatRequestKey_AllowYUV, YES);
+
+    for (f = 0, ok = YES; ok && f < 3; f++) {
+        LXPixelBufferRef pb = LXPixelBufferCreate(NULL, w, h, formats[f], &err);
+        LXPixelBufferRef pb2 = NULL;
+        uint8_t *jpegBuf = NULL;
+        size_t jpegBufSize = 0, jpegSize = 0;
+        int x, y, c, maxErr = 0;
+        ok = (pb && LXPixelBufferLockPixels(pb, NULL, NULL, &err));
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                *testYCbCrSample(pb, x, y, 0) = 40 + 3 * x + 2 * y;
+                *testYCbCrSample(pb, x, y, 1) = 100 + x;
+                *testYCbCrSample(pb, x, y, 2) = 150 - y;
+            }
+        }
+        if (ok) LXPixelBufferUnlockPixels(pb);
+        LXPixelBufferSetIntegerAttachment(pb, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID, kLX_YCbCrFormat_2vuy | kLX_YCbCrFormatFlag_FullRange);
+
+        ok = ok && LXPixelBufferWriteAsJPEGImageInMemory_raw422_(pb, &jpegBuf, &jpegBufSize, &jpegSize, props, &err);
+        pb2 = (ok) ? LXPixelBufferCreateFromJPEGImageInMemory(jpegBuf, jpegSize, props, &err) : NULL;
+        ok = (pb2 && LXPixelBufferGetPixelFormat(pb2) == formats[f]
+                  && LXPixelBufferGetWidth(pb2) == w && LXPixelBufferGetHeight(pb2) == h
+                  && LXPixelBufferLockPixels(pb2, NULL, NULL, &err) && LXPixelBufferLockPixels(pb, NULL, NULL, &err));
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                for (c = 0; c < 3; c++) {
+                    maxErr = MAX(maxErr, abs((int)*testYCbCrSample(pb2, x, y, c) - (int)*testYCbCrSample(pb, x, y, c)));
+                }
+            }
+        }
+        if (ok) {
+            LXPixelBufferUnlockPixels(pb);
+            LXPixelBufferUnlockPixels(pb2);
+        }
+        if ( !ok || maxErr > 4)
+            printf("*** JPEG raw YCbCr round trip is wrong (format %i: %i, %i)\n", (int)formats[f], err.errorID, maxErr);
+        _lx_free(jpegBuf);
+        LXPixelBufferRelease(pb);
+        LXPixelBufferRelease(pb2);
+    }
+    LXMapDestroy(props);
+   }
+#endif
+
+
+   /* --- JPEG file reading --- */
+#if !defined(LXPLATFORM_IOS) && !defined(LXPLATFORM_WIN)
+   {
+    const int w = 33, h = 17;
+    const char *tmpDir = (getenv("TMPDIR")) ? getenv("TMPDIR") : "/tmp";
+    char path[1024];
+    LXUnibuffer unipath = { 0, NULL };
+    LXPixelBufferRef pb = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_INT8, &err);
+    LXPixelBufferRef pb2 = NULL;
+    LXMapPtr props = LXMapCreateMutable();
+    uint8_t *out = _lx_malloc(w * h * 4);
+    size_t rb = 0;
+    uint8_t *px;
+    int x, y, c, maxErr = 0;
+
+    snprintf(path, sizeof(path), "%s/lacefx_test_%ld.jpg", tmpDir, (long)time(NULL));
+    unipath.unistr = LXStrCreateUTF16_from_UTF8(path, strlen(path), &unipath.numOfChar16);
+
+    ok = ((px = LXPixelBufferLockPixels(pb, &rb, NULL, &err)) != NULL);
+    for (y = 0; ok && y < h; y++) {
+        for (x = 0; x < w; x++) {
+            uint8_t *p = px + rb * y + x * 4;
+            p[0] = 40 + 4 * x;  p[1] = 200 - 5 * y;  p[2] = 90 + 2 * x + 3 * y;  p[3] = 255;
+        }
+    }
+    if (ok) LXPixelBufferUnlockPixels(pb);
+
+    LXMapSetDouble(props, kLXPixelBufferFormatRequestKey_CompressionQuality, 1.0);
+    ok = ok && LXPixelBufferWriteAsFileToPath(pb, unipath, props, &err);
+    pb2 = (ok) ? LXPixelBufferCreateFromFileAtPath(unipath, NULL, &err) : NULL;
+    ok = (pb2 && LXPixelBufferGetWidth(pb2) == w && LXPixelBufferGetHeight(pb2) == h
+              && LXPixelBufferGetDataWithPixelFormatConversion(pb2, out, w, h, w * 4, kLX_RGBA_INT8, NULL, &err)
+              && (px = LXPixelBufferLockPixels(pb, &rb, NULL, &err)) != NULL);
+    for (y = 0; ok && y < h; y++) {
+        for (x = 0; x < w; x++) {
+            for (c = 0; c < 4; c++) maxErr = MAX(maxErr, abs((int)out[(y * w + x) * 4 + c] - (int)px[rb * y + x * 4 + c]));
+        }
+    }
+    if (ok) LXPixelBufferUnlockPixels(pb);
+    if ( !ok || maxErr > 8)
+        printf("*** JPEG file reading is wrong (%i, %i)\n", err.errorID, maxErr);
+
+    remove(path);
+    _lx_free(unipath.unistr);
+    _lx_free(out);
+    LXMapDestroy(props);
+    LXPixelBufferRelease(pb);
+    LXPixelBufferRelease(pb2);
+   }
+#endif
+
+
+   /* --- PNG round trip --- */
+#if LX_HAS_BUILTIN_PNG
+   {
+    // the large images are written in several bands, which must join into one valid zlib stream
+    static const struct {
+        int w, h;
+        LXBool alpha;
+        LXBool is16Bit;
+    } s_cases[] = {
+        { 41, 13, NO, NO },  { 41, 13, YES, NO },  { 41, 13, YES, YES },
+        { 300, 280, YES, NO },  { 300, 280, NO, YES },
+    };
+    const char *tmpDir = (getenv("TMPDIR")) ? getenv("TMPDIR") : "/tmp";
+    char path[1024];
+    LXUnibuffer unipath = { 0, NULL };
+    LXMapPtr props = LXMapCreateMutable();
+    size_t rb = 0;
+    int i, x, y, c;
+
+    snprintf(path, sizeof(path), "%s/lacefx_test_%ld.png", tmpDir, (long)time(NULL));
+    unipath.unistr = LXStrCreateUTF16_from_UTF8(path, strlen(path), &unipath.numOfChar16);
+
+    for (i = 0, ok = YES; ok && i < (int)(sizeof(s_cases) / sizeof(s_cases[0])); i++) {
+        const int w = s_cases[i].w, h = s_cases[i].h;
+        const LXBool is16Bit = s_cases[i].is16Bit;
+        LXPixelBufferRef pb = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+        LXPixelBufferRef pb2 = NULL;
+        float *out = _lx_malloc(w * h * 4 * sizeof(float));
+        float *px;
+        double maxErr = 0.0;
+
+        ok = ((px = (float *)LXPixelBufferLockPixels(pb, &rb, NULL, &err)) != NULL);
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                float *p = px + (rb / sizeof(float)) * y + x * 4;
+                const int a = (s_cases[i].alpha) ? testPNGSample(x, y, 3) : 65535;
+                for (c = 0; c < 3; c++) {
+                    const int u = testPNGSample(x, y, c);
+                    p[c] = (is16Bit) ? (u / 65535.0f) * (a / 65535.0f) : (((u >> 8) * (a >> 8) + 127) / 255) / 255.0f;
+                }
+                p[3] = (is16Bit) ? a / 65535.0f : (a >> 8) / 255.0f;
+            }
+        }
+        if (ok) LXPixelBufferUnlockPixels(pb);
+
+        LXMapSetBool(props, kLXPixelBufferFormatRequestKey_AllowAlpha, s_cases[i].alpha);
+        LXMapSetInteger(props, kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel, (is16Bit) ? 16 : 8);
+        ok = ok && LXPixelBufferWriteAsPNGImageToPath(pb, unipath, props, &err);
+        pb2 = (ok) ? LXPixelBufferCreateFromPNGImageAtPath(unipath, NULL, &err) : NULL;
+        ok = (pb2 && LXPixelBufferGetPixelFormat(pb2) == ((is16Bit) ? kLX_RGBA_FLOAT16 : kLX_RGBA_INT8)
+                  && LXPixelBufferGetWidth(pb2) == w && LXPixelBufferGetHeight(pb2) == h
+                  && LXPixelBufferGetDataWithPixelFormatConversion(pb2, (uint8_t *)out, w, h, w * 4 * sizeof(float), kLX_RGBA_FLOAT32, NULL, &err)
+                  && (px = (float *)LXPixelBufferLockPixels(pb, &rb, NULL, &err)) != NULL);
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w * 4; x++) maxErr = MAX(maxErr, fabs(out[y * w * 4 + x] - px[(rb / sizeof(float)) * y + x]));
+        }
+        if (ok) LXPixelBufferUnlockPixels(pb);
+        if ( !ok || maxErr > ((is16Bit) ? 1.0e-3 : 1.01 / 255.0))
+            printf("*** PNG round trip is wrong (%ix%i, alpha %i, 16-bit %i: %i, %f)\n", w, h, s_cases[i].alpha, is16Bit, err.errorID, maxErr);
+
+        remove(path);
+        _lx_free(out);
+        LXPixelBufferRelease(pb);
+        LXPixelBufferRelease(pb2);
+    }
+
+    // interlaced input, read both as stored and premultiplied
+    for (i = 0; ok && i < 4; i++) {
+        const int w = 13, h = 11;
+        const int bitDepth = (i & 1) ? 16 : 8;
+        const LXBool premultiply = (i >= 2);
+        size_t pngLen = 0;
+        uint8_t *png = createTestInterlacedPNG(w, h, bitDepth, &pngLen);
+        float *out = _lx_malloc(w * h * 4 * sizeof(float));
+        double maxErr = 0.0;
+
+        LXMapSetBool(props, "leaveAlphaUnpremultiplied", !premultiply);
+        LXPixelBufferRef pb2 = LXPixelBufferCreateFromPNGImageInMemory(png, pngLen, props, &err);
+        ok = (pb2 && LXPixelBufferGetWidth(pb2) == w && LXPixelBufferGetHeight(pb2) == h
+                  && LXPixelBufferGetDataWithPixelFormatConversion(pb2, (uint8_t *)out, w, h, w * 4 * sizeof(float), kLX_RGBA_FLOAT32, NULL, &err));
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                const double scale = (bitDepth == 16) ? 65535.0 : 255.0;
+                const int shift = (bitDepth == 16) ? 0 : 8;
+                const double a = (testPNGSample(x, y, 3) >> shift) / scale;
+                for (c = 0; c < 4; c++) {
+                    double v = (testPNGSample(x, y, c) >> shift) / scale;
+                    if (premultiply && c < 3) v *= a;
+                    maxErr = MAX(maxErr, fabs(out[(y * w + x) * 4 + c] - v));
+                }
+            }
+        }
+        if ( !ok || maxErr > ((bitDepth == 16) ? 1.0e-3 : (premultiply) ? 0.51 / 255.0 : 1.0e-6))
+            printf("*** interlaced PNG reading is wrong (%i-bit, premultiplied %i: %i, %f)\n", bitDepth, premultiply, err.errorID, maxErr);
+
+        _lx_free(png);
+        _lx_free(out);
+        LXPixelBufferRelease(pb2);
+    }
+
+    _lx_free(unipath.unistr);
+    LXMapDestroy(props);
+   }
+#endif
+
+
+   /* --- TIFF reading --- */
+#if LX_HAS_LIBTIFF
+   {
+    // the reader must reject layouts it doesn't handle (error 1862), so that the native API gets to open them
+    static const struct {
+        int w, h, spp, bps, sampleFormat;
+        LXBool tiled, planar;
+        int chunkSize, photometric, extraSample;
+        int expectedErr;
+    } s_cases[] = {
+        { 37, 29, 4, 8, SAMPLEFORMAT_UINT, YES, NO, 16, PHOTOMETRIC_RGB, EXTRASAMPLE_ASSOCALPHA, 0 },
+        { 37, 29, 3, 16, SAMPLEFORMAT_UINT, NO, YES, 5, PHOTOMETRIC_RGB, 0, 0 },
+        { 520, 513, 4, 16, SAMPLEFORMAT_IEEEFP, YES, YES, 64, PHOTOMETRIC_RGB, EXTRASAMPLE_ASSOCALPHA, 0 },
+        { 37, 29, 3, 32, SAMPLEFORMAT_IEEEFP, NO, NO, 7, PHOTOMETRIC_RGB, 0, 0 },
+        { 37, 29, 3, 8, SAMPLEFORMAT_UINT, NO, NO, 8, PHOTOMETRIC_YCBCR, 0, 1862 },
+        { 37, 29, 4, 8, SAMPLEFORMAT_UINT, NO, NO, 8, PHOTOMETRIC_RGB, EXTRASAMPLE_UNASSALPHA, 1862 },
+    };
+    const char *tmpDir = (getenv("TMPDIR")) ? getenv("TMPDIR") : "/tmp";
+    char path[1024];
+    LXUnibuffer unipath = { 0, NULL };
+    int i, x, y, c;
+
+    snprintf(path, sizeof(path), "%s/lacefx_test_%ld.tif", tmpDir, (long)time(NULL));
+    unipath.unistr = LXStrCreateUTF16_from_UTF8(path, strlen(path), &unipath.numOfChar16);
+
+    for (i = 0; i < (int)(sizeof(s_cases) / sizeof(s_cases[0])); i++) {
+        const int w = s_cases[i].w, h = s_cases[i].h, bps = s_cases[i].bps;
+        float *out = _lx_malloc(w * h * 4 * sizeof(float));
+        LXPixelBufferRef pb = NULL;
+        double maxErr = 0.0;
+
+        LXErrorDestroyOnStack(err);
+        ok = writeTestTIFF(path, w, h, s_cases[i].spp, bps, s_cases[i].sampleFormat, s_cases[i].tiled, s_cases[i].planar,
+                           s_cases[i].chunkSize, s_cases[i].photometric, s_cases[i].extraSample);
+        pb = (ok) ? LXPixelBufferCreateFromTIFFImageAtPath(unipath, NULL, &err) : NULL;
+
+        if (s_cases[i].expectedErr) {
+            ok = ok && !pb && err.errorID == s_cases[i].expectedErr;
+        } else {
+            ok = (pb && LXPixelBufferGetWidth(pb) == w && LXPixelBufferGetHeight(pb) == h
+                     && LXPixelBufferGetDataWithPixelFormatConversion(pb, (uint8_t *)out, w, h, w * 4 * sizeof(float), kLX_RGBA_FLOAT32, NULL, &err));
+            for (y = 0; ok && y < h; y++) {
+                for (x = 0; x < w; x++) {
+                    for (c = 0; c < 4; c++) {
+                        const int v = testTIFFSample(x, y, c);
+                        const double expected = (c == 3 && s_cases[i].spp == 3) ? 1.0 : (bps == 8) ? (v >> 8) / 255.0 : v / 65535.0;
+                        const double e = fabs(out[(y * w + x) * 4 + c] - expected);
+                        maxErr = (isnan(e)) ? INFINITY : MAX(maxErr, e);
+                    }
+                }
+            }
+        }
+        if ( !ok || maxErr > ((bps == 16) ? 1.0e-3 : 1.0e-6))
+            printf("*** TIFF reading is wrong (case %i: %i, %f)\n", i, err.errorID, maxErr);
+
+        remove(path);
+        _lx_free(out);
+        LXPixelBufferRelease(pb);
+    }
+    _lx_free(unipath.unistr);
+   }
+
+   /* --- TIFF writing --- */
+   {
+    // Deflate and its predictors are done by Lacefx (in parallel for the large image), LZW by libTIFF;
+    // libTIFF decodes both when reading back. float samples go outside 0-1 to exercise the float predictor's sign and exponent bytes
+    static const struct {
+        int w, h, bitDepth;
+        LXBool floatSamples, alpha;
+        int compression, tileSize;
+    } s_cases[] = {
+        { 37, 29, 8, NO, YES, kLXTIFFCompression_Deflate, 0 },
+        { 37, 29, 16, NO, NO, kLXTIFFCompression_Deflate, 16 },
+        { 37, 29, 16, YES, YES, kLXTIFFCompression_Deflate, 0 },
+        { 600, 520, 16, YES, YES, kLXTIFFCompression_Deflate, 0 },
+        { 37, 29, 32, YES, NO, kLXTIFFCompression_Deflate, 16 },
+        { 37, 29, 32, YES, YES, kLXTIFFCompression_LZW, 0 },
+    };
+    const char *tmpDir = (getenv("TMPDIR")) ? getenv("TMPDIR") : "/tmp";
+    char path[1024];
+    LXUnibuffer unipath = { 0, NULL };
+    LXMapPtr props = LXMapCreateMutable();
+    size_t rb = 0;
+    int i, x, y, c;
+
+    snprintf(path, sizeof(path), "%s/lacefx_test_%ld.tif", tmpDir, (long)time(NULL));
+    unipath.unistr = LXStrCreateUTF16_from_UTF8(path, strlen(path), &unipath.numOfChar16);
+
+    for (i = 0; i < (int)(sizeof(s_cases) / sizeof(s_cases[0])); i++) {
+        const int w = s_cases[i].w, h = s_cases[i].h;
+        const LXBool is8Bit = (s_cases[i].bitDepth == 8);
+        const LXBool isFloat = (s_cases[i].floatSamples || s_cases[i].bitDepth == 32);
+        // 8-bit data is passed as int8, so that the writer gets it without a conversion
+        LXPixelBufferRef pb = LXPixelBufferCreate(NULL, w, h, (is8Bit) ? kLX_RGBA_INT8 : kLX_RGBA_FLOAT32, &err);
+        LXPixelBufferRef pb2 = NULL;
+        float *expected = _lx_malloc(w * h * 4 * sizeof(float));
+        float *out = _lx_malloc(w * h * 4 * sizeof(float));
+        uint8_t *px;
+        double maxErr = 0.0;
+
+        LXErrorDestroyOnStack(err);
+        ok = ((px = LXPixelBufferLockPixels(pb, &rb, NULL, &err)) != NULL);
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                for (c = 0; c < 4; c++) {
+                    const int sample = (c == 3 && !s_cases[i].alpha) ? 65535 : testTIFFSample(x, y, c);
+                    float *e = expected + (y * w + x) * 4 + c;
+                    if (is8Bit) {
+                        px[rb * y + x * 4 + c] = (uint8_t)(sample >> 8);
+                        *e = (sample >> 8) / 255.0f;
+                    } else {
+                        *e = (isFloat && c < 3) ? (sample / 65535.0f) * 5.0f - 1.0f : sample / 65535.0f;
+                        ((float *)(px + rb * y))[x * 4 + c] = *e;
+                    }
+                }
+            }
+        }
+        if (ok) LXPixelBufferUnlockPixels(pb);
+
+        LXMapSetInteger(props, kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel, s_cases[i].bitDepth);
+        LXMapSetBool(props, kLXPixelBufferFormatRequestKey_FloatSamples, s_cases[i].floatSamples);
+        LXMapSetBool(props, kLXPixelBufferFormatRequestKey_AllowAlpha, s_cases[i].alpha);
+        LXMapSetInteger(props, kLXPixelBufferFormatRequestKey_TIFFCompression, s_cases[i].compression);
+        LXMapSetInteger(props, kLXPixelBufferFormatRequestKey_TIFFTileSize, s_cases[i].tileSize);
+        ok = ok && LXPixelBufferWriteAsTIFFImageToPath(pb, unipath, props, &err);
+        pb2 = (ok) ? LXPixelBufferCreateFromTIFFImageAtPath(unipath, NULL, &err) : NULL;
+        ok = (pb2 && LXPixelBufferGetWidth(pb2) == w && LXPixelBufferGetHeight(pb2) == h
+                  && LXPixelBufferGetDataWithPixelFormatConversion(pb2, (uint8_t *)out, w, h, w * 4 * sizeof(float), kLX_RGBA_FLOAT32, NULL, &err));
+        for (x = 0; ok && x < w * h * 4; x++) {
+            const double e = fabs(out[x] - expected[x]) / MAX(1.0f, fabsf(expected[x]));
+            maxErr = (isnan(e)) ? INFINITY : MAX(maxErr, e);
+        }
+        if ( !ok || maxErr > ((s_cases[i].bitDepth == 16) ? 1.0e-3 : 1.0e-6))
+            printf("*** TIFF round trip is wrong (case %i: %i, %f)\n", i, err.errorID, maxErr);
+
+        remove(path);
+        _lx_free(expected);
+        _lx_free(out);
+        LXPixelBufferRelease(pb);
+        LXPixelBufferRelease(pb2);
+    }
+    _lx_free(unipath.unistr);
+    LXMapDestroy(props);
+   }
+#endif
+
+
+   /* --- FPClosure JIT vs. interpreter --- */
+   {
+    int mismatches = testFPClosureJIT(2000);
+    if (mismatches > 0)
+        printf("*** FPClosure JIT differential test failed: %i mismatches\n", mismatches);
+   }
+
+
+   /* --- FPClosure batch vs. scalar --- */
+   {
+    int mismatches = testFPClosureBatch(1000);
+    if (mismatches > 0)
+        printf("*** FPClosure batch test failed: %i mismatches\n", mismatches);
+   }
+
+
+   /* --- CPU accumulator --- */
+   {
+    const int w = 19, h = 21, numSamples = 4;
+    LXAccumulatorRef acc = LXAccumulatorCreateWithSize(NULL, LXMakeSize(w, h), kLXAccumulatorFlag_UseCPU, &err);
+    LXAccumulatorSetNumberOfSamples(acc, numSamples);
+    LXAccumulatorStartAccumulation(acc, &err);
+    
+    int i, n;
+    for (n = 0; n < numSamples; n++) {
+        LXPixelBufferRef pixbuf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_INT8, &err);
+        size_t rowBytes = 0;
+        uint8_t *buf = LXPixelBufferLockPixels(pixbuf, &rowBytes, NULL, &err);
+        for (i = 0; i < h; i++) memset(buf + rowBytes * i, n * 60, w * 4);   // 0, 60, 120, 180 -> average is 90
+        LXPixelBufferUnlockPixels(pixbuf);
+        
+        LXAccumulatorAccumulatePixelBuffer(acc, pixbuf);
+        LXPixelBufferRelease(pixbuf);
+    }
+    
+    LXPixelBufferRef result = LXAccumulatorFinishAccumulationIntoPixelBuffer(acc, kLX_RGBA_FLOAT32, &err);
+    if ( !result) {
+        printf("*** CPU accumulator returned no result (%i)\n", err.errorID);
+    } else {
+        size_t rowBytes = 0;
+        float *px = (float *)(LXPixelBufferLockPixels(result, &rowBytes, NULL, &err) + rowBytes * (h - 1)) + (w - 1) * 4;
+        if (fabsf(px[0] - 90.0f / 255.0f) > 1.0e-5f || fabsf(px[3] - 90.0f / 255.0f) > 1.0e-5f)
+            printf("*** CPU accumulator result is wrong: %f, %f (expected %f)\n", px[0], px[3], 90.0f / 255.0f);
+        LXPixelBufferUnlockPixels(result);
+        LXPixelBufferRelease(result);
+    }
+    LXAccumulatorRelease(acc);
+   }
+
+   /* --- CPU convolver --- */
+   {
+    const int w = 40, h = 30;
+    LXConvolverRef conv = LXConvolverCreate(NULL, 0, &err);
+    LXPixelBufferRef pixbuf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    size_t rowBytes = 0;
+    float *buf = (float *)LXPixelBufferLockPixels(pixbuf, &rowBytes, NULL, &err);
+    memset(buf, 0, rowBytes * h);
+    buf[(rowBytes / sizeof(float)) * 10 + 20 * 4] = 9.0f;   // impulse at (20, 10)
+    LXPixelBufferUnlockPixels(pixbuf);
+
+    // default weights are a box, so the impulse is spread evenly over a 3x3 square
+    if ( !LXConvolverRenderSeparableIntoPixelBuffer(conv, 3, pixbuf, pixbuf, &err)) {
+        printf("*** CPU convolver failed (%i)\n", err.errorID);
+    } else {
+        buf = (float *)LXPixelBufferLockPixels(pixbuf, &rowBytes, NULL, &err);
+        float inside = buf[(rowBytes / sizeof(float)) * 11 + 21 * 4];
+        float outside = buf[(rowBytes / sizeof(float)) * 12 + 20 * 4];
+        if (fabsf(inside - 1.0f) > 1.0e-5f || outside != 0.0f)
+            printf("*** CPU convolver result is wrong: %f, %f (expected 1, 0)\n", inside, outside);
+        LXPixelBufferUnlockPixels(pixbuf);
+    }
+    LXPixelBufferRelease(pixbuf);
+    LXConvolverRelease(conv);
+   }
+
+   /* --- native shader kernels --- */
+   {
+    // the composite shaders have generated kernels, which must match the interpreter exactly.
+    // a trailing space makes the program text differ from the registered one, so the copy is interpreted
+    const int w = 37, h = 5;
+    LXShaderRef shader = LXCreateCompositeShader_OverOp_Premult_Param();
+    const char *progStr = "!!ARBfp1.0\n"
+                          "TEMP t0, t1, c, s;  "
+                          "TEX t0, fragment.texcoord[0], texture[0], RECT;  "
+                          "TEX t1, fragment.texcoord[1], texture[1], RECT;  "
+                          "MUL t1, t1, program.local[0];  "
+                          "SUB_SAT s.a, 1.0, t1.a;  "
+                          "MAD c.rgb, t0, s.a, t1;  "
+                          "SUB_SAT s.a, 1.0, t0.a;  "
+                          "MAD c.a, s.a, t1.a, t0.a;  "
+                          "MOV result.color, c;  "
+                          "END ";
+    LXShaderRef interpShader = LXShaderCreateWithString(progStr, strlen(progStr), kLXShaderFormat_OpenGLARBfp, 0, &err);
+    LXPixelBufferRef srcs[2], dst1, dst2;
+    size_t rowBytes = 0;
+    int i, n;
+
+    for (n = 0; n < 2; n++) {
+        srcs[n] = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+        float *buf = (float *)LXPixelBufferLockPixels(srcs[n], &rowBytes, NULL, &err);
+        for (i = 0; i < (int)(rowBytes / sizeof(float)) * h; i++) buf[i] = (float)((i * (7 + n * 6)) % 23) / 19.0f;
+        LXPixelBufferUnlockPixels(srcs[n]);
+    }
+    LXTextureArrayRef texArray = LXTextureArrayCreateWithPixelBuffers(srcs, 2);
+    dst1 = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    dst2 = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    LXShaderSetParameter4f(shader, 0, 0.9f, 0.8f, 0.7f, 0.6f);
+    LXShaderSetParameter4f(interpShader, 0, 0.9f, 0.8f, 0.7f, 0.6f);
+
+    if ( !LXShaderHasCPUKernel(shader) || LXShaderHasCPUKernel(interpShader)) {
+        printf("*** native shader kernel lookup is wrong (%i, %i)\n", LXShaderHasCPUKernel(shader), LXShaderHasCPUKernel(interpShader));
+    }
+    else if ( !LXShaderEvaluateIntoPixelBuffer(shader, texArray, dst1, &err) || !LXShaderEvaluateIntoPixelBuffer(interpShader, texArray, dst2, &err)) {
+        printf("*** shader evaluation failed (%i)\n", err.errorID);
+    }
+    else {
+        uint8_t *buf1 = LXPixelBufferLockPixels(dst1, &rowBytes, NULL, &err);
+        uint8_t *buf2 = LXPixelBufferLockPixels(dst2, &rowBytes, NULL, &err);
+        for (i = 0; i < h; i++) {
+            if (0 != memcmp(buf1 + i * rowBytes, buf2 + i * rowBytes, w * 4 * sizeof(float))) {
+                printf("*** native shader kernel result differs from interpreter on row %i\n", i);
+                break;
+            }
+        }
+        LXPixelBufferUnlockPixels(dst1);
+        LXPixelBufferUnlockPixels(dst2);
+    }
+
+    char *kernelStr = NULL;
+    if ( !LXConvertShaderString_OpenGLARBfp_to_C_kernel(progStr, "testKernel", &kernelStr) || !strstr(kernelStr, "void testKernel(")) {
+        printf("*** ARBfp to C kernel conversion failed\n");
+    }
+    _lx_free(kernelStr);
+
+    // the same operation without a shader, composited in place over a copy of the background
+    const float opacity[4] = { 0.9f, 0.8f, 0.7f, 0.6f };
+    LXPixelBufferCopyPixelBufferWithPixelFormatConversion(dst2, srcs[0], &err);
+    LXPixelBufferRef compSrcs[2] = { dst2, srcs[1] };
+    if (LXCompositeOpForShader(shader) != kLXCompositeOp_OverOp_Premult_Param
+            || !LXCompositePixelBuffers(kLXCompositeOp_OverOp_Premult_Param, dst2, compSrcs, opacity, &err)) {
+        printf("*** composite op failed (%i)\n", err.errorID);
+    } else {
+        uint8_t *buf1 = LXPixelBufferLockPixels(dst1, &rowBytes, NULL, &err);
+        uint8_t *buf2 = LXPixelBufferLockPixels(dst2, &rowBytes, NULL, &err);
+        for (i = 0; i < h; i++) {
+            if (0 != memcmp(buf1 + i * rowBytes, buf2 + i * rowBytes, w * 4 * sizeof(float))) {
+                printf("*** composite op result differs from shader on row %i\n", i);
+                break;
+            }
+        }
+        LXPixelBufferUnlockPixels(dst1);
+        LXPixelBufferUnlockPixels(dst2);
+    }
+
+    LXPixelBufferRelease(dst1);
+    LXPixelBufferRelease(dst2);
+    LXTextureArrayRelease(texArray);
+    LXPixelBufferRelease(srcs[0]);
+    LXPixelBufferRelease(srcs[1]);
+    LXShaderRelease(interpShader);
+    LXShaderRelease(shader);
+   }
+
+   /* --- shader translation cache eviction --- */
+   {
+    // three entries of equal size with room for two: the one not used since it was stored gets evicted
+    const char *target = "test-eviction";
+    const char *progs[3] = { "!!ARBfp1.0 # A\nEND", "!!ARBfp1.0 # B\nEND", "!!ARBfp1.0 # C\nEND" };
+    char *outStr = NULL;
+    LXBool found[3];
+    int i;
+
+    LXShaderTranslationCacheClear();
+    LXShaderTranslationCacheStore_(target, progs[0], "translated", NULL);
+    const size_t entrySize = LXShaderTranslationCacheGetMemorySize();
+    LXShaderTranslationCacheSetMemoryLimit(entrySize * 2 + entrySize / 2);
+
+    LXShaderTranslationCacheStore_(target, progs[1], "translated", NULL);
+    if (LXShaderTranslationCacheLookup_(target, progs[0], &outStr, NULL)) _lx_free(outStr);
+    LXShaderTranslationCacheStore_(target, progs[2], "translated", NULL);
+
+    for (i = 0; i < 3; i++) {
+        outStr = NULL;
+        found[i] = LXShaderTranslationCacheLookup_(target, progs[i], &outStr, NULL);
+        _lx_free(outStr);
+    }
+    if ( !found[0] || found[1] || !found[2] || LXShaderTranslationCacheGetMemorySize() != entrySize * 2) {
+        printf("*** translation cache eviction is wrong (%i, %i, %i; size %ld)\n", found[0], found[1], found[2],
+                        (long)LXShaderTranslationCacheGetMemorySize());
+    }
+
+    LXShaderTranslationCacheClear();
+    LXShaderTranslationCacheSetMemoryLimit(4 * 1024 * 1024);
+    if (LXShaderTranslationCacheGetMemorySize() != 0) {
+        printf("*** translation cache not empty after clear\n");
+    }
+   }
+
+#if !defined(LXPLATFORM_IOS)
+   /* --- composite shader kernels are registered for the programs in LXShaderUtils.c --- */
+   {
+    static const struct {
+        LXShaderRef (*createFunc)(void);
+        LXCompositeOp op;
+    } s_shaders[] = {
+        { LXCreateShader_SolidColor,                            kLXCompositeOp_SolidColor },
+        { LXCreateMaskShader_MaskWithRed,                       kLXCompositeOp_MaskWithRed },
+        { LXCreateMaskShader_MaskWithAlpha,                     kLXCompositeOp_MaskWithAlpha },
+        { LXCreateMaskShader_Param,                             kLXCompositeOp_MaskParam },
+        { LXCreateCompositeShader_OverOp_Premult,               kLXCompositeOp_OverOp_Premult },
+        { LXCreateCompositeShader_OverOp_Premult_Param,         kLXCompositeOp_OverOp_Premult_Param },
+        { LXCreateCompositeShader_OverOp_Premult_MaskWithRed,   kLXCompositeOp_OverOp_Premult_MaskWithRed },
+        { LXCreateCompositeShader_OverOp_Unpremult_Param,       kLXCompositeOp_OverOp_Unpremult_Param },
+        { LXCreateCompositeShader_OverOp_Unpremult_MaskWithRed, kLXCompositeOp_OverOp_Unpremult_MaskWithRed },
+        { LXCreateCompositeShader_Add_Premult_Param,            kLXCompositeOp_Add_Premult_Param },
+        { LXCreateCompositeShader_Multiply_Premult_Param,       kLXCompositeOp_Multiply_Premult_Param },
+    };
+    int i;
+    for (i = 0; i < (int)(sizeof(s_shaders) / sizeof(s_shaders[0])); i++) {
+        LXShaderRef shader = s_shaders[i].createFunc();
+        if ( !shader || !LXShaderHasCPUKernel(shader) || LXCompositeOpForShader(shader) != s_shaders[i].op) {
+            printf("*** composite shader %i has no CPU kernel or a wrong composite op (%i, %i)\n", i,
+                            (shader) ? LXShaderHasCPUKernel(shader) : 0, (shader) ? (int)LXCompositeOpForShader(shader) : 0);
+        }
+        LXShaderRelease(shader);
+    }
+
+    // the multiply op has no other test, so check that its shader and composite op agree exactly
+    const int w = 29, h = 3;
+    LXShaderRef shader = LXCreateCompositeShader_Multiply_Premult_Param();
+    LXPixelBufferRef srcs[2], dst1, dst2;
+    size_t rowBytes = 0;
+    int n;
+
+    for (n = 0; n < 2; n++) {
+        srcs[n] = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+        float *buf = (float *)LXPixelBufferLockPixels(srcs[n], &rowBytes, NULL, &err);
+        for (i = 0; i < (int)(rowBytes / sizeof(float)) * h; i++) buf[i] = (float)((i * (5 + n * 6)) % 17) / 16.0f;
+        LXPixelBufferUnlockPixels(srcs[n]);
+    }
+    LXTextureArrayRef texArray = LXTextureArrayCreateWithPixelBuffers(srcs, 2);
+    dst1 = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    dst2 = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    LXShaderSetParameter4f(shader, 0, 0.9f, 0.8f, 0.7f, 0.6f);
+
+    const float opacity[4] = { 0.9f, 0.8f, 0.7f, 0.6f };
+    LXPixelBufferCopyPixelBufferWithPixelFormatConversion(dst2, srcs[0], &err);
+    LXPixelBufferRef compSrcs[2] = { dst2, srcs[1] };
+    if ( !LXShaderEvaluateIntoPixelBuffer(shader, texArray, dst1, &err)
+            || !LXCompositePixelBuffers(kLXCompositeOp_Multiply_Premult_Param, dst2, compSrcs, opacity, &err)) {
+        printf("*** multiply shader or composite op failed (%i)\n", err.errorID);
+    } else {
+        uint8_t *buf1 = LXPixelBufferLockPixels(dst1, &rowBytes, NULL, &err);
+        uint8_t *buf2 = LXPixelBufferLockPixels(dst2, &rowBytes, NULL, &err);
+        for (i = 0; i < h; i++) {
+            if (0 != memcmp(buf1 + i * rowBytes, buf2 + i * rowBytes, w * 4 * sizeof(float))) {
+                printf("*** multiply composite op result differs from shader on row %i\n", i);
+                break;
+            }
+        }
+        LXPixelBufferUnlockPixels(dst1);
+        LXPixelBufferUnlockPixels(dst2);
+    }
+    LXPixelBufferRelease(dst1);
+    LXPixelBufferRelease(dst2);
+    LXTextureArrayRelease(texArray);
+    LXPixelBufferRelease(srcs[0]);
+    LXPixelBufferRelease(srcs[1]);
+    LXShaderRelease(shader);
+   }
+#endif
+
+   /* --- color transforms --- */
+   {
+    const LXColorSpaceEncoding cspaces[4] = { kLX_CanonicalLinearRGB, kLX_sRGB, kLX_AdobeRGB_1998, kLX_ProPhotoRGB };
+    const int n = 4096;
+    LXTestPixels px;
+    double maxErr = 0.0;
+    int maxErr8 = 0;
+    int i, j, k, c;
+    createTestPixels(&px, n);
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            LXColorTransformRef ct = LXColorTransformCreate(cspaces[i], cspaces[j], &err);
+            LXColorTransformApplyToData(ct, (uint8_t *)px.fsrc, n * 16, (uint8_t *)px.fdst, n * 16, n, 1, kLX_RGBA_FLOAT32, &err);
+            LXColorTransformApplyToData(ct, px.isrc, 64 * 4, px.idst, 64 * 4, 64, n / 64, kLX_RGBA_INT8, &err);
+
+            for (k = 0; k < n; k++) {
+                float rgb8[3];
+                for (c = 0; c < 3; c++) rgb8[c] = px.isrc[k*4 + c] / 255.0f;
+                LXColorTransformConvertRGB(ct, px.fsrc + k*4, px.exp + k*3);
+                LXColorTransformConvertRGB(ct, rgb8, px.exp8 + k*3);
+            }
+            checkTestPixels(&px, YES, &maxErr, &maxErr8);
+            LXColorTransformRelease(ct);
+        }
+    }
+    if (maxErr > 1.0e-4 || maxErr8 > 1)
+        printf("*** color transform tables differ from exact conversion (%f, %i)\n", maxErr, maxErr8);
+
+    // sRGB mid-grey tagged on an 8-bit buffer becomes linear when copied into a float buffer tagged as linear
+    LXPixelBufferRef pb8 = LXPixelBufferCreate(NULL, 4, 4, kLX_RGBA_INT8, &err);
+    LXPixelBufferRef pbf = LXPixelBufferCreate(NULL, 4, 4, kLX_RGBA_FLOAT32, &err);
+    size_t rowBytes = 0;
+    uint8_t *buf8 = LXPixelBufferLockPixels(pb8, &rowBytes, NULL, &err);
+    memset(buf8, 128, rowBytes * 4);
+    LXPixelBufferUnlockPixels(pb8);
+    LXPixelBufferSetIntegerAttachment(pb8, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, kLX_sRGB);
+    LXPixelBufferSetIntegerAttachment(pbf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, kLX_CanonicalLinearRGB);
+    if ( !LXPixelBufferCopyPixelBufferWithPixelFormatConversion(pbf, pb8, &err)) {
+        printf("*** color space conversion failed (%i)\n", err.errorID);
+    } else {
+        float *buff = (float *)LXPixelBufferLockPixels(pbf, &rowBytes, NULL, &err);
+        if (fabsf(buff[0] - 0.2158605f) > 1.0e-5f || fabsf(buff[3] - 128.0f / 255.0f) > 1.0e-6f)
+            printf("*** sRGB to linear pixel buffer conversion is wrong: %f, %f\n", buff[0], buff[3]);
+        LXPixelBufferUnlockPixels(pbf);
+    }
+    LXPixelBufferRelease(pb8);
+    LXPixelBufferRelease(pbf);
+    destroyTestPixels(&px);
+   }
+
+   /* --- 3D LUTs --- */
+   {
+    // tetrahedral interpolation reproduces an affine function exactly, so a LUT sampled from one can be checked against it
+    static const float m[12] = { 0.8f, 0.1f, 0.05f, 0.02f,   -0.1f, 0.9f, 0.15f, 0.05f,   0.05f, -0.2f, 0.7f, 0.1f };
+    const int size = 17;
+    const int n = 4096;
+    float *lattice = _lx_malloc(size * size * size * 3 * sizeof(float));
+    LXTestPixels px;
+    double maxErr = 0.0;
+    int maxErr8 = 0;
+    int i, c;
+    for (i = 0; i < size * size * size; i++) {
+        const float rgb[3] = { (float)(i % size) / (size - 1), (float)((i / size) % size) / (size - 1), (float)(i / (size * size)) / (size - 1) };
+        for (c = 0; c < 3; c++) lattice[i*3 + c] = m[c*4] * rgb[0] + m[c*4 + 1] * rgb[1] + m[c*4 + 2] * rgb[2] + m[c*4 + 3];
+    }
+    createTestPixels(&px, n);
+    LXLUT3DRef lut = LXLUT3DCreateWithData(size, lattice, &err);
+    LXImageApplyLUT3D_RGBA_float32(n, 1, px.fsrc, n * 16, px.fdst, n * 16, lut);
+    LXImageApplyLUT3D_RGBA_int8(64, n / 64, px.isrc, 64 * 4, px.idst, 64 * 4, lut);
+    for (i = 0; i < n; i++) {
+        // the float input is clamped to the domain
+        const float *v = px.fsrc + i*4;
+        const uint8_t *v8 = px.isrc + i*4;
+        const float r = MIN(1.0f, MAX(0.0f, v[0])), g = MIN(1.0f, MAX(0.0f, v[1])), b = MIN(1.0f, MAX(0.0f, v[2]));
+        for (c = 0; c < 3; c++) {
+            px.exp[i*3 + c] = m[c*4] * r + m[c*4 + 1] * g + m[c*4 + 2] * b + m[c*4 + 3];
+            px.exp8[i*3 + c] = (m[c*4] * v8[0] + m[c*4 + 1] * v8[1] + m[c*4 + 2] * v8[2]) / 255.0f + m[c*4 + 3];
+        }
+    }
+    checkTestPixels(&px, NO, &maxErr, &maxErr8);
+    if (maxErr > 1.0e-5 || maxErr8 > 1)
+        printf("*** 3D LUT interpolation of an affine function is wrong (%f, %i)\n", maxErr, maxErr8);
+    LXLUT3DRelease(lut);
+
+    // .cube with a shaper: the 1D part maps 0.5 to 0.25, and the 3D part swaps red and blue
+    static const char *cubeText = "TITLE \"test\"\n# comment\nLUT_1D_SIZE 3\nLUT_3D_SIZE 2\n"
+                                  "0 0 0\n0.25 0.25 0.25\n1 1 1\n"
+                                  "0 0 0\n0 0 1\n0 1 0\n0 1 1\n1 0 0\n1 0 1\n1 1 0\n1 1 1\n";
+    // .3dl with 12-bit output of a lattice that inverts green
+    static const char *text3dl = "0 1023\n0 4095 0\n0 4095 4095\n0 0 0\n0 0 4095\n4095 4095 0\n4095 4095 4095\n4095 0 0\n4095 0 4095\n";
+    const float in[3] = { 0.5f, 0.75f, 1.0f };
+    float out[3] = { 0, 0, 0 };
+    lut = LXLUT3DCreateFromCubeData(cubeText, strlen(cubeText), &err);
+    if (lut) LXLUT3DLookupRGB(lut, in, out);
+    if ( !lut || fabsf(out[0] - 1.0f) > 1.0e-6f || fabsf(out[1] - 0.625f) > 1.0e-6f || fabsf(out[2] - 0.25f) > 1.0e-6f)
+        printf("*** .cube parsing failed or gave wrong values (%i: %f %f %f)\n", err.errorID, out[0], out[1], out[2]);
+    LXLUT3DRelease(lut);
+
+    lut = LXLUT3DCreateFrom3DLData(text3dl, strlen(text3dl), &err);
+    if (lut) LXLUT3DLookupRGB(lut, in, out);
+    if ( !lut || fabsf(out[0] - 0.5f) > 1.0e-6f || fabsf(out[1] - 0.25f) > 1.0e-6f || fabsf(out[2] - 1.0f) > 1.0e-6f)
+        printf("*** .3dl parsing failed or gave wrong values (%i: %f %f %f)\n", err.errorID, out[0], out[1], out[2]);
+    LXLUT3DRelease(lut);
+
+    // throughput at 4K float16 with a 33-point LUT
+    const int bw = 3840, bh = 2160, bsize = 33;
+    float *lattice33 = _lx_malloc(bsize * bsize * bsize * 3 * sizeof(float));
+    for (i = 0; i < bsize * bsize * bsize * 3; i++) lattice33[i] = (float)((i * 7919) % 1000) / 1000.0f;
+    lut = LXLUT3DCreateWithData(bsize, lattice33, &err);
+    LXPixelBufferRef pb = LXPixelBufferCreate(NULL, bw, bh, kLX_RGBA_FLOAT16, &err);
+    size_t rowBytes = 0;
+    LXHalf *hbuf = (LXHalf *)LXPixelBufferLockPixels(pb, &rowBytes, NULL, &err);
+    for (i = 0; i < bw * 4; i++) hbuf[i] = LXHalfFromFloat((float)(i % 1000) / 1000.0f);
+    for (i = 1; i < bh; i++) memcpy((uint8_t *)hbuf + rowBytes * i, hbuf, bw * 8);
+    LXPixelBufferUnlockPixels(pb);
+
+    const double t0 = benchmarkTime();
+    for (i = 0; i < 4; i++) LXLUT3DApplyToPixelBuffer(lut, pb, pb, &err);
+    printf("3D LUT benchmark: %.1f ms per 4K float16 frame\n", (benchmarkTime() - t0) * 1000.0 / 4);
+
+    LXPixelBufferRelease(pb);
+    LXLUT3DRelease(lut);
+    _lx_free(lattice33);
+    _lx_free(lattice);
+    destroyTestPixels(&px);
+   }
+
+   /* --- image statistics --- */
+   {
+    // large enough to be threaded; checked against straightforward loops
+    const int w = 512, h = 256;
+    const LXRect region = LXMakeRect(3, 5, 400, 200);
+    LXPixelBufferRef pb8 = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_INT8, &err);
+    LXPixelBufferRef pbf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    size_t rb8 = 0, rbf = 0;
+    uint8_t *buf8 = LXPixelBufferLockPixels(pb8, &rb8, NULL, &err);
+    float *buff = (float *)LXPixelBufferLockPixels(pbf, &rbf, NULL, &err);
+    int x, y, c, i;
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w * 4; x++) {
+            buf8[rb8 * y + x] = (x < 64) ? 200 : (uint8_t)((x * 31 + y * 17 + (x * y >> 5)) & 255);   // a flat area, then noise
+            buff[rbf / 4 * y + x] = (float)((x * 7919 + y * 104729) % 2003) / 1000.0f - 0.5f;
+        }
+    }
+    buff[rbf / 4 * 10 + 40] = NAN;
+    LXPixelBufferUnlockPixels(pb8);
+    LXPixelBufferUnlockPixels(pbf);
+
+    const LXImageHistogramOptions opts = { 100, -0.25f, 1.25f };
+    uint32_t *hist8 = _lx_calloc(4 * 256, sizeof(uint32_t));
+    uint32_t *histf = _lx_calloc(4 * 100, sizeof(uint32_t));
+    uint32_t *expHist = _lx_calloc(4 * 256, sizeof(uint32_t));
+    LXImageStatistics stats8, statsf;
+    double expSum[2][4], expSq[2][4];
+    int histErrors = 0;
+    double maxErr = 0.0;
+    memset(expSum, 0, sizeof(expSum));
+    memset(expSq, 0, sizeof(expSq));
+
+    ok = LXImageCalcStatistics(pb8, &region, NULL, &stats8, hist8, &err)
+      && LXImageCalcStatistics(pbf, &region, &opts, &statsf, histf, &err);
+
+    // 8-bit histogram
+    buf8 = LXPixelBufferLockPixels(pb8, &rb8, NULL, &err);
+    for (y = 5; y < 205; y++) {
+        for (x = 3; x < 403; x++) {
+            for (c = 0; c < 4; c++) {
+                const uint8_t v = buf8[rb8 * y + x*4 + c];
+                expHist[c * 256 + v]++;
+                expSum[0][c] += v / 255.0;
+                expSq[0][c] += (v / 255.0) * (v / 255.0);
+            }
+        }
+    }
+    LXPixelBufferUnlockPixels(pb8);
+    for (i = 0; i < 4 * 256; i++) if (hist8[i] != expHist[i]) histErrors++;
+
+    // float histogram with a custom range; the NaN is skipped
+    memset(expHist, 0, 4 * 256 * sizeof(uint32_t));
+    buff = (float *)LXPixelBufferLockPixels(pbf, &rbf, NULL, &err);
+    for (y = 5; y < 205; y++) {
+        for (x = 3; x < 403; x++) {
+            for (c = 0; c < 4; c++) {
+                const float v = buff[rbf / 4 * y + x*4 + c];
+                if (v != v) continue;
+                expHist[c * 100 + MIN(99, MAX(0, (int)floorf((v + 0.25f) * (100.0f / 1.5f))))]++;
+                expSum[1][c] += v;
+                expSq[1][c] += (double)v * v;
+            }
+        }
+    }
+    LXPixelBufferUnlockPixels(pbf);
+    for (i = 0; i < 4 * 100; i++) if (histf[i] != expHist[i]) histErrors++;
+
+    for (c = 0; c < 4; c++) {
+        const double n8 = 400.0 * 200.0;
+        const double nf = (c == 0) ? n8 - 1 : n8;
+        maxErr = MAX(maxErr, fabs(stats8.mean[c] - expSum[0][c] / n8));
+        maxErr = MAX(maxErr, fabs(stats8.variance[c] - (expSq[0][c] / n8 - pow(expSum[0][c] / n8, 2))));
+        maxErr = MAX(maxErr, fabs(statsf.mean[c] - expSum[1][c] / nf));
+        maxErr = MAX(maxErr, fabs(statsf.variance[c] - (expSq[1][c] / nf - pow(expSum[1][c] / nf, 2))));
+        if (statsf.count[c] != (uint64_t)nf) histErrors++;
+    }
+    if ( !ok || histErrors > 0 || maxErr > 1.0e-9)
+        printf("*** image statistics are wrong (%i, %i, %g)\n", err.errorID, histErrors, maxErr);
+
+    // scopes of a flat grey: a single waveform level, and the neutral center of the vectorscope
+    uint32_t *wave = _lx_calloc(3 * 64 * 100, sizeof(uint32_t));
+    uint32_t *scope = _lx_calloc(65 * 65, sizeof(uint32_t));
+    buff = (float *)LXPixelBufferLockPixels(pbf, &rbf, NULL, &err);
+    for (i = 0; i < (int)(rbf / 4 * h); i++) buff[i] = 0.5f;
+    LXPixelBufferUnlockPixels(pbf);
+    ok = LXImageCalcWaveform(pbf, NULL, kLXWaveform_Parade, 100, 64, 0.0f, 1.0f, wave, &err)
+      && LXImageCalcVectorscope(pbf, NULL, 65, scope, &err);
+    // 100 output columns over 512 pixels: the first gets 6 image columns and the last 5
+    if ( !ok || wave[32 * 100 + 99] != (uint32_t)(5 * h) || wave[2 * 6400 + 32 * 100] != (uint32_t)(6 * h)
+             || scope[32 * 65 + 32] != (uint32_t)(w * h))
+        printf("*** waveform or vectorscope is wrong (%i, %u, %u)\n", err.errorID, wave[32 * 100 + 99], scope[32 * 65 + 32]);
+
+    _lx_free(wave);
+    _lx_free(scope);
+    _lx_free(hist8);
+    _lx_free(histf);
+    _lx_free(expHist);
+    LXPixelBufferRelease(pb8);
+    LXPixelBufferRelease(pbf);
+   }
+
+   /* --- premultiply --- */
+   {
+    // every color/alpha pair, with and without a fused pixel format conversion
+    const int w = 256, h = 256;
+    LXPixelBufferRef pbf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT32, &err);
+    uint8_t *rgba = _lx_malloc(w * h * 4);
+    uint8_t *argb = _lx_malloc(w * h * 4);
+    uint8_t *out = _lx_malloc(w * h * 4);
+    float *fout = _lx_malloc(w * h * 4 * sizeof(float));
+    LXMapPtr props = LXMapCreateMutable();
+    size_t rbf = 0;
+    float *buff = (float *)LXPixelBufferLockPixels(pbf, &rbf, NULL, &err);
+    int c, a, i, errors = 0;
+    double maxErr = 0.0;
+    for (a = 0; a < 256; a++) {
+        for (c = 0; c < 256; c++) {
+            uint8_t *p = rgba + (a * 256 + c) * 4;
+            p[0] = c;  p[1] = 255 - c;  p[2] = c / 2;  p[3] = a;
+            argb[(a * 256 + c) * 4] = a;
+            memcpy(argb + (a * 256 + c) * 4 + 1, p, 3);
+            for (i = 0; i < 4; i++) buff[rbf / 4 * a + c * 4 + i] = p[i] / 255.0f;
+        }
+    }
+    LXPixelBufferUnlockPixels(pbf);
+
+    LXImagePremultiply_RGBA_int8(w, h, rgba, w * 4, out, w * 4);
+    LXImagePremultiply_ARGB_int8(w, h, argb, w * 4, argb, w * 4);
+    for (i = 0; i < w * h * 4; i++) {
+        const int v = rgba[i], alpha = rgba[i | 3];
+        const int exp = ((i & 3) == 3) ? alpha : (2 * v * alpha + 255) / 510;
+        if (out[i] != exp || argb[(i & ~3) + ((i + 1) & 3)] != exp) errors++;
+    }
+    // unpremultiplied premultiplied colors that can be exact, i.e. not above alpha
+    for (a = 0; a < 256; a++) {
+        for (c = 0; c < 256; c++) rgba[(a * 256 + c) * 4] = MIN(c, a);
+    }
+    LXImageUnpremultiply_RGBA_int8(w, h, rgba, w * 4, out, w * 4);
+    for (i = 0; i < w * h * 4; i += 4) {
+        const int v = rgba[i], alpha = rgba[i + 3];
+        const int exp = (alpha) ? (2 * v * 255 + alpha) / (2 * alpha) : 0;
+        if (out[i] != exp || out[i + 3] != alpha) errors++;
+    }
+
+    // premultiplied float data into 8-bit with an unpremultiply on the way, and the other way round
+    LXImagePremultiply_RGBA_float32(w, h, buff, rbf, buff, rbf);
+    LXMapSetInteger(props, kLXPixelBufferConversionKey_AlphaConversion, kLXAlphaConversion_Unpremultiply);
+    ok = LXPixelBufferGetDataWithPixelFormatConversion(pbf, out, w, h, w * 4, kLX_RGBA_INT8, props, &err);
+    for (a = 1; ok && a < 256; a++) {
+        for (c = 0; c < 256; c++) {
+            if (out[(a * 256 + c) * 4 + 1] != 255 - c) errors++;
+        }
+    }
+    LXMapSetInteger(props, kLXPixelBufferConversionKey_AlphaConversion, kLXAlphaConversion_Premultiply);
+    ok = ok && LXPixelBufferWriteDataWithPixelFormatConversion(pbf, out, w, h, w * 4, kLX_RGBA_INT8, props, &err)
+            && LXPixelBufferGetDataWithPixelFormatConversion(pbf, (uint8_t *)fout, w, h, w * 16, kLX_RGBA_FLOAT32, NULL, &err);
+    LXImageUnpremultiply_RGBA_float32(w, h, fout, w * 16, fout, w * 16);
+    for (a = 0; ok && a < 256; a++) {
+        for (c = 0; c < 256; c++) {
+            const float exp = (a) ? (255 - c) / 255.0f : 0.0f;
+            maxErr = MAX(maxErr, fabs(fout[(a * 256 + c) * 4 + 1] - exp));
+        }
+    }
+    if ( !ok || errors > 0 || maxErr > 1e-5)
+        printf("*** premultiply is wrong (%i, %i, %g)\n", err.errorID, errors, maxErr);
+
+    LXMapDestroy(props);
+    _lx_free(rgba);
+    _lx_free(argb);
+    _lx_free(out);
+    _lx_free(fout);
+    LXPixelBufferRelease(pbf);
+   }
+
+   /* --- image blending --- */
+   {
+    // large enough for threads and non-temporal stores
+    const int w = 1200, h = 1000;
+    uint8_t *bufs[3];
+    size_t rbs[3] = { w * 4, w * 4, w * 4 };
+    const float weights[3] = { 1.0f, 2.0f, 5.0f };
+    uint8_t *dst = _lx_malloc(w * h * 4);
+    int i, errors = 0;
+    double maxErr = 0.0;
+    for (i = 0; i < 3; i++) {
+        int j;
+        bufs[i] = _lx_malloc(w * h * 4);
+        for (j = 0; j < w * h * 4; j++) bufs[i][j] = (uint8_t)((j * (i + 3) + (j >> 7) * 11) & 255);
+    }
+    ok = LXImageBlendAverageData((const uint8_t * const *)bufs, rbs, weights, 3, dst, w * 4, w, h, kLX_RGBA_INT8, &err);
+    for (i = 0; ok && i < w * h * 4; i++) {
+        if (dst[i] != (bufs[0][i] + 2 * bufs[1][i] + 5 * bufs[2][i] + 4) / 8) errors++;
+    }
+
+    // premultiplied "over", i.e. fg * opacity + bg * (1 - fg.a * opacity), against a double-precision reference
+    for (i = 0; i < w * h * 4; i++) {
+        if ((i & 3) != 3) bufs[0][i] = MIN(bufs[0][i], bufs[0][i | 3]);
+    }
+    {
+        const float opacities[3] = { 1.0f, 0.37f, 0.8f };
+        int n;
+        for (n = 0; n < 3; n++) {
+            const double op = opacities[n];
+            ok = ok && LXImageBlendOverData(bufs[0], w * 4, bufs[1], w * 4, dst, w * 4, w, h, kLX_RGBA_INT8, opacities[n], &err);
+            for (i = 0; ok && i < w * h * 4; i++) {
+                const double exp = bufs[0][i] * op + bufs[1][i] * (1.0 - bufs[0][i | 3] * op / 255.0);
+                if (fabs(dst[i] - MIN(exp, 255.0)) > 0.5 + 1e-3) errors++;
+            }
+        }
+    }
+
+    // float crossfade between pixel buffers, with the output in place
+    LXPixelBufferRef pa = LXPixelBufferCreate(NULL, 300, 200, kLX_RGBA_FLOAT32, &err);
+    LXPixelBufferRef pb = LXPixelBufferCreate(NULL, 300, 200, kLX_RGBA_FLOAT32, &err);
+    size_t rba = 0, rbb = 0;
+    float *fa = (float *)LXPixelBufferLockPixels(pa, &rba, NULL, &err);
+    float *fb = (float *)LXPixelBufferLockPixels(pb, &rbb, NULL, &err);
+    for (i = 0; i < 300 * 4; i++) {
+        fa[rba / 4 * 7 + i] = i * 0.01f;
+        fb[rbb / 4 * 7 + i] = 2.0f - i * 0.03f;
+    }
+    ok = ok && LXImageBlendLerp(pa, pb, pa, 0.25f, &err);
+    for (i = 0; ok && i < 300 * 4; i++) {
+        maxErr = MAX(maxErr, fabs(fa[rba / 4 * 7 + i] - (i * 0.01f * 0.75f + (2.0f - i * 0.03f) * 0.25f)));
+    }
+    LXPixelBufferUnlockPixels(pa);
+    LXPixelBufferUnlockPixels(pb);
+    LXPixelBufferRelease(pa);
+    LXPixelBufferRelease(pb);
+
+    // planar 4:2:0 with odd dimensions: every plane is blended
+    LXPixelBufferRef ya = LXPixelBufferCreate(NULL, 101, 51, kLX_YCbCr420_planar_INT8, &err);
+    LXPixelBufferRef yb = LXPixelBufferCreate(NULL, 101, 51, kLX_YCbCr420_planar_INT8, &err);
+    size_t yrb = 0;
+    uint8_t *yp = LXPixelBufferLockPixels(ya, &yrb, NULL, &err);
+    const size_t ysize = LXPlaneLayoutForPixelFormat(kLX_YCbCr420_planar_INT8, 101, 51, yrb, NULL, NULL);
+    memset(yp, 10, ysize);
+    memset(LXPixelBufferLockPixels(yb, &yrb, NULL, &err), 30, ysize);
+    LXPixelBufferUnlockPixels(ya);
+    LXPixelBufferUnlockPixels(yb);
+    ok = ok && LXImageBlendLerp(yb, ya, ya, 0.5f, &err);
+    {
+        size_t offsets[3], prbs[3];
+        yp = LXPixelBufferLockPixels(ya, &yrb, NULL, &err);
+        LXPlaneLayoutForPixelFormat(kLX_YCbCr420_planar_INT8, 101, 51, yrb, offsets, prbs);
+        if (yp[0] != 20 || yp[yrb * 50 + 100] != 20 || yp[offsets[1] + prbs[1] * 25 + 50] != 20 || yp[offsets[2] + prbs[2] * 25 + 50] != 20)
+            errors++;
+    }
+    LXPixelBufferUnlockPixels(ya);
+    LXPixelBufferRelease(ya);
+    LXPixelBufferRelease(yb);
+
+    if ( !ok || errors > 0 || maxErr > 1e-5)
+        printf("*** image blending is wrong (%i, %i, %g)\n", err.errorID, errors, maxErr);
+
+    for (i = 0; i < 3; i++) _lx_free(bufs[i]);
+    _lx_free(dst);
+   }
+
+   /* --- curve bake --- */
+   {
+    // an S-curve in two segments; the second is packed without its start point
+    LXCurveSegment s0, s1;
+    uint8_t packed[2 * sizeof(LXCurveSegment)];
+    memset(&s0, 0, sizeof(s0));
+    memset(&s1, 0, sizeof(s1));
+    s0.type = kLXInOutBezierSegment;
+    s0.startPoint = LXMakePoint(0.0, 0.0);
+    s0.controlPoint1 = LXMakePoint(0.3, 0.0);
+    s0.controlPoint2 = LXMakePoint(0.3, 0.5);
+    s0.endPoint = LXMakePoint(0.5, 0.5);
+    s1.type = kLXInOutBezierSegment | kLXCurveSegmentFlag_HasNoStartPoint;
+    s1.controlPoint1 = LXMakePoint(0.7, 0.5);
+    s1.controlPoint2 = LXMakePoint(0.7, 1.0);
+    s1.endPoint = LXMakePoint(1.0, 1.0);
+    memcpy(packed, &s0, sizeof(s0));
+    memcpy(packed + sizeof(s0), &s1, sizeof(s1) - sizeof(LXPoint));
+
+    LXCurveBakeRef bake = LXCurveBakeCreateCached((LXCurveSegment *)packed, 2, 0.0, &err);
+    LXCurveBakeRef bake2 = LXCurveBakeCreateCached((LXCurveSegment *)packed, 2, 0.0, &err);
+    float xs[1001], ys[1001];
+    double maxErr = 0.0;
+    int i, errors = 0;
+
+    s1.type = kLXInOutBezierSegment;
+    s1.startPoint = s0.endPoint;
+    for (i = 0; bake && i <= 1000; i++) {
+        const LXPoint p = LXCalcCurvePointAtU((i < 500) ? s0 : s1, (i % 500) / 500.0);
+        xs[i] = p.x;
+        maxErr = MAX(maxErr, fabs(LXCurveBakeEvaluate(bake, p.x) - p.y));
+    }
+    LXCurveBakeEvaluateArray(bake, xs, ys, 1001);
+    for (i = 0; bake && i <= 1000; i++) {
+        if (ys[i] != LXCurveBakeEvaluate(bake, xs[i])) errors++;
+    }
+    if (bake != bake2 || LXCurveBakeEvaluate(bake, -1.0f) != 0.0f || LXCurveBakeEvaluate(bake, NAN) != 0.0f || LXCurveBakeEvaluate(bake, 2.0f) != 1.0f)
+        errors++;
+
+    if ( !bake || errors > 0 || maxErr > 2.0 * kLXCurveBake_DefaultTolerance)
+        printf("*** curve bake is wrong (%i, %i, %g)\n", err.errorID, errors, maxErr);
+
+    LXCurveBakeRelease(bake);
+    LXCurveBakeRelease(bake2);
+   }
+
+   /* --- path rasterization --- */
+   {
+    const int w = 64, h = 64;
+    float *mask = _lx_calloc(w * h, sizeof(float));
+    LXCurveSegment rect[8];
+    LXCurveSegment *arc = NULL;
+    size_t arcCount = 0;
+    LXPathRasterOptions opts;
+    double sum = 0.0;
+    int i, errors = 0;
+
+    // an outer square with an inner square wound the same way, partly outside the image on the left
+    const LXPoint pts[8] = { {-10, 2.25}, {10.5, 2.25}, {10.5, 30.75}, {-10, 30.75},
+                             {2, 10}, {6, 10}, {6, 20}, {2, 20} };
+    memset(rect, 0, sizeof(rect));
+    for (i = 0; i < 8; i++) {
+        rect[i].type = kLXLinearSegment;
+        rect[i].startPoint = pts[i];
+        rect[i].endPoint = pts[(i & 4) | ((i + 1) & 3)];
+    }
+    ok = LXPathRasterizeToData(rect, 8, NULL, (uint8_t *)mask, w * 4, w, h, kLX_Luminance_FLOAT32, &err);
+    for (i = 0; ok && i < w * h; i++) sum += mask[i];
+    if (fabs(sum - 10.5 * 28.5) > 1e-3 || mask[w * 2] != 0.75f || mask[w * 15 + 10] != 0.5f || mask[w * 15 + 4] != 1.0f)
+        errors++;
+
+    // the even-odd rule leaves a hole
+    memset(mask, 0, w * h * 4);
+    memset(&opts, 0, sizeof(opts));
+    opts.fillRule = kLXFillRule_EvenOdd;
+    opts.color = LXMakeRGBA(1, 1, 1, 1);
+    ok = ok && LXPathRasterizeToData(rect, 8, &opts, (uint8_t *)mask, w * 4, w, h, kLX_Luminance_FLOAT32, &err);
+    if (mask[w * 15 + 4] != 0.0f || mask[w * 15 + 1] != 1.0f)
+        errors++;
+
+    // a stroked line has the area of a rectangle and a half-circle cap (the other end is outside the image)
+    memset(mask, 0, w * h * 4);
+    opts.strokeWidth = 4.0;
+    opts.tolerance = 0.01;
+    ok = ok && LXPathRasterizeToData(rect, 1, &opts, (uint8_t *)mask, w * 4, w, h, kLX_Luminance_FLOAT32, &err);
+    for (sum = 0.0, i = 0; ok && i < w * h; i++) sum += mask[i];
+    if (fabs(sum - (10.5 * 4.0 + 0.5 * M_PI * 4.0)) > 0.1)
+        errors++;
+
+    // a filled circle in a buffer that's large enough for multiple bands and threads
+    LXCreateBezierCurvesForArc(200, 150, 100, 0, 2.0 * M_PI, YES, &arc, &arcCount);
+    LXPixelBufferRef pb = LXPixelBufferCreate(NULL, 400, 300, kLX_BGRA_INT8, &err);
+    size_t rb = 0;
+    uint8_t *px = LXPixelBufferLockPixels(pb, &rb, NULL, &err);
+    for (i = 0; i < 300; i++) memset(px + rb * i, 0, 400 * 4);
+    LXPixelBufferUnlockPixels(pb);
+    opts.strokeWidth = 0.0;
+    opts.color = LXMakeRGBA(1, 0, 0, 0.5);
+    ok = ok && LXPathRasterizeToPixelBuffer(arc, arcCount, &opts, pb, &err);
+    px = LXPixelBufferLockPixels(pb, &rb, NULL, &err);
+    for (sum = 0.0, i = 0; ok && i < 400 * 300; i++) sum += px[rb * (i / 400) + (i % 400) * 4 + 3];
+    if (fabs(sum / 128.0 - M_PI * 100.0 * 100.0) > 60.0 || px[rb * 150 + 200 * 4 + 2] != 128 || px[rb * 150 + 200 * 4 + 0] != 0)
+        errors++;
+    LXPixelBufferUnlockPixels(pb);
+    LXPixelBufferRelease(pb);
+
+    if ( !ok || errors > 0)
+        printf("*** path rasterization is wrong (%i, %i, %g)\n", err.errorID, errors, sum);
+
+    _lx_free(arc);
+    _lx_free(mask);
+   }
+
+   /* --- stroke coverage --- */
+   {
+    // strokes of an open arc and of sharp two-segment turns against coverage supersampled from the distance to the path
+    const int w = 64, h = 64, ss = 16;
+    const double arcA0 = 0.3, arcA1 = 4.5;
+    const LXPoint c = { 32, 32 };
+    const LXPoint turns[2][3] = { { {6, 50}, {54, 30}, {8, 18} },
+                                  { {4, 40}, {60, 32}, {4, 26} } };
+    float *mask = _lx_malloc(w * h * sizeof(float));
+    LXCurveSegment *arc = NULL;
+    size_t arcCount = 0;
+    LXCurveSegment lines[2];
+    LXPathRasterOptions opts;
+    double maxErr = 0.0;
+    int k;
+
+    LXCreateBezierCurvesForArc(c.x, c.y, 25, arcA0, arcA1, YES, &arc, &arcCount);
+    memset(lines, 0, sizeof(lines));
+    memset(&opts, 0, sizeof(opts));
+    opts.color = LXMakeRGBA(1, 1, 1, 1);
+    opts.tolerance = 0.01;
+
+    for (k = 0; ok && k < 6; k++) {
+        const int shape = k / 2;  // the arc, then the two turns
+        const double r = (k & 1) ? 4.0 : 2.0;
+        int x, y, i, j;
+        opts.strokeWidth = 2.0 * r;
+        memset(mask, 0, w * h * sizeof(float));
+        if (shape == 0) {
+            ok = LXPathRasterizeToData(arc, arcCount, &opts, (uint8_t *)mask, w * 4, w, h, kLX_Luminance_FLOAT32, &err);
+        } else {
+            for (i = 0; i < 2; i++) {
+                lines[i].type = kLXLinearSegment;
+                lines[i].startPoint = turns[shape - 1][i];
+                lines[i].endPoint = turns[shape - 1][i + 1];
+            }
+            ok = LXPathRasterizeToData(lines, 2, &opts, (uint8_t *)mask, w * 4, w, h, kLX_Luminance_FLOAT32, &err);
+        }
+        for (y = 0; ok && y < h; y++) {
+            for (x = 0; x < w; x++) {
+                int inside = 0;
+                for (j = 0; j < ss; j++) {
+                    for (i = 0; i < ss; i++) {
+                        const LXPoint p = { x + (i + 0.5) / ss, y + (j + 0.5) / ss };
+                        const double d = (shape == 0) ? distanceToArc(p, c, 25, arcA0, arcA1)
+                                                      : MIN(distanceToSegment(p, turns[shape - 1][0], turns[shape - 1][1]),
+                                                            distanceToSegment(p, turns[shape - 1][1], turns[shape - 1][2]));
+                        if (d <= r) inside++;
+                    }
+                }
+                maxErr = MAX(maxErr, fabs(mask[y * w + x] - (double)inside / (ss * ss)));
+            }
+        }
+    }
+    if ( !ok || maxErr > 0.05)
+        printf("*** stroke coverage is wrong (%i, %g)\n", err.errorID, maxErr);
+
+    _lx_free(arc);
+    _lx_free(mask);
+   }
+
+   /* --- counter-based random numbers --- */
+   {
+    // the zero-key known answer from the Philox paper's test vectors
+    uint32_t words[4];
+    float vals[1003];
+    int i, errors = 0;
+    LXRdCounterBlock(0, 0, 0, words);
+    if (words[0] != 0x6627e8d5 || words[1] != 0xe169c58d || words[2] != 0xbc57ac4c || words[3] != 0x9b00dbd8)
+        errors++;
+
+    // bulk fills starting at an unaligned index give the same values as single lookups
+    LXRdCounterFillUniform(12345, 3, 5, vals, 1003, -1.0f, 1.0f);
+    for (i = 0; i < 1003; i++) {
+        if (vals[i] != LXRdCounterUniform(12345, 3, 5 + i, -1.0f, 1.0f) || vals[i] < -1.0f || vals[i] >= 1.0f) errors++;
+    }
+    LXRdCounterFillGaussian(12345, 3, 7, vals, 1003, 0.5f, 2.0f);
+    for (i = 0; i < 1003; i++) {
+        if (vals[i] != LXRdCounterGaussian(12345, 3, 7 + i, 0.5f, 2.0f)) errors++;
+    }
+
+    // pixel noise doesn't depend on how the buffer is split between threads
+    LXPixelBufferRef pb = LXPixelBufferCreate(NULL, 300, 200, kLX_RGBA_FLOAT32, &err);
+    ok = LXRdCounterFillPixelBuffer(pb, 99, 1, kLXRdDistribution_Uniform, 0.0f, 1.0f, &err);
+    size_t rb = 0;
+    float *px = (float *)LXPixelBufferLockPixels(pb, &rb, NULL, &err);
+    if ( !ok || px[rb / 4 * 150 + 70 * 4 + 2] != LXRdCounterUniform(99, 1, (150 * 300 + 70) * 4 + 2, 0.0f, 1.0f)
+             || px[rb / 4 * 199 + 299 * 4 + 3] != 1.0f)
+        errors++;
+    LXPixelBufferUnlockPixels(pb);
+    LXPixelBufferRelease(pb);
+
+    if (errors > 0)
+        printf("*** counter-based random numbers are wrong (%i, %i)\n", err.errorID, errors);
+   }
+
+
 #if 0   
    /* --- list and shape test --- */
    {
@@ -0,0 +1,29 @@
+/*
+ *  LXImplTests_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+// command-line runner for LXImplTests on the CPU backend ("make test").
+// failed checks print lines that start with "***"
+
+#include "Lacefx.h"
+#include "LXPlatform_cpu.h"
+
+extern void LXImplRunTests();
+
+
+int main(int argc, char *argv[])
+{
+    LXPlatformInitialize();
+    LXImplRunTests();
+    LXPlatformDeinitialize();
+    return 0;
+}
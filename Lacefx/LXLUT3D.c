@@ -0,0 +1,963 @@
+/*
+ *  LXLUT3D.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXLUT3D.h"
+#include "LXImageFunctions.h"
+#include "LXPixelBuffer.h"
+#include "LXFileHandlers.h"
+#include "LXStringUtils.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include "LXRef_Impl.h"
+#include <math.h>
+#include <ctype.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// the lattice is stored with four floats per node (RGB and a zero pad) so that a node is a single vector load.
+// node (r, g, b) is at index (b * size + g) * size + r, i.e. red changes fastest as in .cube files.
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    LXInteger size;
+    float *lattice;
+
+    float domMin[3];
+    float domMax[3];
+    float coordScale[3];        // lattice coordinate = value * coordScale + coordOffset
+    float coordOffset[3];
+
+    LXInteger shaperSize;       // 0 if there's no shaper
+    float shaperMin;
+    float shaperScale;          // shaper table index = (value - shaperMin) * shaperScale
+    float *shaperValues;        // RGB triplets in the domain, as given by the caller
+    float *shaperCoords;        // the same as lattice coordinates, one plane per channel
+
+    // lattice offsets and fractions for 8-bit input; the offsets are premultiplied by the axis strides
+    int32_t offs8[3][256];
+    float frac8[3][256];
+} LXLUT3DImpl;
+
+
+#pragma mark --- creation ---
+
+const char *LXLUT3DTypeID()
+{
+    static const char *s = "LXLUT3D";
+    return s;
+}
+
+LXLUT3DRef LXLUT3DRetain(LXLUT3DRef r)
+{
+    if ( !r) return NULL;
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+    return r;
+}
+
+void LXLUT3DRelease(LXLUT3DRef r)
+{
+    if ( !r) return;
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+        _lx_free(imp->lattice);
+        _lx_free(imp->shaperValues);
+        _lx_free(imp->shaperCoords);
+        _lx_free(imp);
+    }
+}
+
+LXINLINE float clampCoord(float c, float maxCoord)
+{
+    // written so that NaN becomes zero
+    return (c > 0.0f) ? ((c < maxCoord) ? c : maxCoord) : 0.0f;
+}
+
+static void splitCoord(float c, LXInteger size, LXInteger *outIndex, float *outFrac)
+{
+    LXInteger i = (LXInteger)c;
+    if (i > size - 2) i = size - 2;
+    *outIndex = i;
+    *outFrac = c - (float)i;
+}
+
+static float shaperCoord(const LXLUT3DImpl *imp, LXInteger channel, float v)
+{
+    const float *s = imp->shaperCoords + channel * imp->shaperSize;
+    const float t = clampCoord((v - imp->shaperMin) * imp->shaperScale, (float)(imp->shaperSize - 1));
+    LXInteger i;
+    float f;
+    splitCoord(t, imp->shaperSize, &i, &f);
+    return s[i] + f * (s[i+1] - s[i]);
+}
+
+// lattice coordinates for an input color, clamped to the lattice
+LXINLINE void latticeCoords(const LXLUT3DImpl *imp, const float *rgb, float *coords)
+{
+    const float maxCoord = (float)(imp->size - 1);
+    LXInteger c;
+    if (imp->shaperSize > 0) {
+        for (c = 0; c < 3; c++) coords[c] = clampCoord(shaperCoord(imp, c, rgb[c]), maxCoord);
+    } else {
+        for (c = 0; c < 3; c++) coords[c] = clampCoord(rgb[c] * imp->coordScale[c] + imp->coordOffset[c], maxCoord);
+    }
+}
+
+// rebuilds everything that depends on the domain and shaper
+static void updateDerivedTables(LXLUT3DImpl *imp)
+{
+    const LXInteger n = imp->size;
+    const int32_t strides[3] = { 1, (int32_t)n, (int32_t)(n * n) };
+    LXInteger c, i;
+
+    for (c = 0; c < 3; c++) {
+        const float range = imp->domMax[c] - imp->domMin[c];
+        imp->coordScale[c] = (range != 0.0f) ? (float)(n - 1) / range : 0.0f;
+        imp->coordOffset[c] = -imp->domMin[c] * imp->coordScale[c];
+    }
+
+    if (imp->shaperSize > 0) {
+        for (c = 0; c < 3; c++) {
+            for (i = 0; i < imp->shaperSize; i++) {
+                imp->shaperCoords[c * imp->shaperSize + i] = imp->shaperValues[i*3 + c] * imp->coordScale[c] + imp->coordOffset[c];
+            }
+        }
+    }
+
+    for (i = 0; i < 256; i++) {
+        const float v = (float)i / 255.0f;
+        const float rgb[3] = { v, v, v };
+        float coords[3];
+        latticeCoords(imp, rgb, coords);
+
+        for (c = 0; c < 3; c++) {
+            LXInteger idx;
+            splitCoord(coords[c], n, &idx, &imp->frac8[c][i]);
+            imp->offs8[c][i] = (int32_t)idx * strides[c];
+        }
+    }
+}
+
+static LXLUT3DImpl *createLUT(LXInteger size, LXError *outError)
+{
+    if (size < 2 || size > kLXLUT3D_MaxSize) {
+        char msg[256];
+        sprintf(msg, "unsupported 3D LUT size (%ld)", (long)size);
+        LXErrorSet(outError, kLXErrorID_LUT3D_InvalidSize, msg);
+        return NULL;
+    }
+
+    LXLUT3DImpl *imp = _lx_calloc(sizeof(LXLUT3DImpl), 1);
+    LXREF_INIT(imp, LXLUT3DTypeID(), LXLUT3DRetain, LXLUT3DRelease);
+
+    imp->size = size;
+    imp->lattice = _lx_calloc(size * size * size * 4, sizeof(float));
+    imp->domMax[0] = imp->domMax[1] = imp->domMax[2] = 1.0f;
+    return imp;
+}
+
+LXLUT3DRef LXLUT3DCreateWithData(LXUInteger size, const float *rgbData, LXError *outError)
+{
+    if ( !rgbData) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NULL;
+    }
+    LXLUT3DImpl *imp = createLUT(size, outError);
+    if ( !imp) return NULL;
+
+    const LXInteger count = size * size * size;
+    LXInteger i;
+    for (i = 0; i < count; i++) {
+        imp->lattice[i*4 + 0] = rgbData[i*3 + 0];
+        imp->lattice[i*4 + 1] = rgbData[i*3 + 1];
+        imp->lattice[i*4 + 2] = rgbData[i*3 + 2];
+    }
+    updateDerivedTables(imp);
+    return (LXLUT3DRef)imp;
+}
+
+
+#pragma mark --- accessors ---
+
+LXUInteger LXLUT3DGetSize(LXLUT3DRef r)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    return (imp) ? imp->size : 0;
+}
+
+void LXLUT3DGetDomain(LXLUT3DRef r, float *outMin, float *outMax)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    if ( !imp) return;
+    if (outMin) memcpy(outMin, imp->domMin, 3 * sizeof(float));
+    if (outMax) memcpy(outMax, imp->domMax, 3 * sizeof(float));
+}
+
+void LXLUT3DSetDomain(LXLUT3DRef r, const float *minRGB, const float *maxRGB)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    if ( !imp || !minRGB || !maxRGB) return;
+    memcpy(imp->domMin, minRGB, 3 * sizeof(float));
+    memcpy(imp->domMax, maxRGB, 3 * sizeof(float));
+    updateDerivedTables(imp);
+}
+
+LXSuccess LXLUT3DSetShaper(LXLUT3DRef r, LXUInteger count, const float *values, float inMin, float inMax, LXError *outError)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    if ( !imp) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NO;
+    }
+    if (values && (count < 2 || inMax == inMin)) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_InvalidSize, "shaper must have at least two entries and a non-empty input range");
+        return NO;
+    }
+
+    _lx_free(imp->shaperValues);
+    _lx_free(imp->shaperCoords);
+    imp->shaperValues = NULL;
+    imp->shaperCoords = NULL;
+    imp->shaperSize = 0;
+
+    if (values) {
+        imp->shaperSize = count;
+        imp->shaperMin = inMin;
+        imp->shaperScale = (float)(count - 1) / (inMax - inMin);
+        imp->shaperValues = _lx_malloc(count * 3 * sizeof(float));
+        imp->shaperCoords = _lx_malloc(count * 3 * sizeof(float));
+        memcpy(imp->shaperValues, values, count * 3 * sizeof(float));
+    }
+    updateDerivedTables(imp);
+    return YES;
+}
+
+LXBool LXLUT3DHasShaper(LXLUT3DRef r)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    return (imp && imp->shaperSize > 0) ? YES : NO;
+}
+
+
+#pragma mark --- interpolation ---
+
+/*
+  tetrahedral interpolation splits the lattice cell into six tetrahedra along its black-white diagonal.
+  sorting the fractions picks the tetrahedron; its corners are black, white and the two corners reached by
+  stepping first along the largest fraction's axis and then along the second largest.
+*/
+typedef struct {
+    LXInteger base;     // node index of the cell's black corner
+    LXInteger o1, o2;   // node offsets of the two intermediate corners
+    float w0, w1, w2, w3;
+} LXTetraWeights;
+
+LXINLINE void tetraWeights(LXInteger base, float fr, float fg, float fb, LXInteger dg, LXInteger db, LXTetraWeights *t)
+{
+    float x, y, z;
+    t->base = base;
+    if (fr > fg) {
+        if (fg > fb) {
+            t->o1 = 1;   t->o2 = 1 + dg;    x = fr;  y = fg;  z = fb;
+        } else if (fr > fb) {
+            t->o1 = 1;   t->o2 = 1 + db;    x = fr;  y = fb;  z = fg;
+        } else {
+            t->o1 = db;  t->o2 = db + 1;    x = fb;  y = fr;  z = fg;
+        }
+    } else {
+        if (fb > fg) {
+            t->o1 = db;  t->o2 = db + dg;   x = fb;  y = fg;  z = fr;
+        } else if (fb > fr) {
+            t->o1 = dg;  t->o2 = dg + db;   x = fg;  y = fb;  z = fr;
+        } else {
+            t->o1 = dg;  t->o2 = dg + 1;    x = fg;  y = fr;  z = fb;
+        }
+    }
+    t->w0 = 1.0f - x;
+    t->w1 = x - y;
+    t->w2 = y - z;
+    t->w3 = z;
+}
+
+LXINLINE void tetraWeightsForCoords(const LXLUT3DImpl *imp, const float *coords, LXTetraWeights *t)
+{
+    const LXInteger n = imp->size;
+    LXInteger ir, ig, ib;
+    float fr, fg, fb;
+    splitCoord(coords[0], n, &ir, &fr);
+    splitCoord(coords[1], n, &ig, &fg);
+    splitCoord(coords[2], n, &ib, &fb);
+    tetraWeights(ir + (ig + ib * n) * n, fr, fg, fb, n, n * n, t);
+}
+
+LXINLINE void tetraInterpolate(const LXLUT3DImpl *imp, const LXTetraWeights *t, float *outRGB)
+{
+    const float *p0 = imp->lattice + t->base * 4;
+    const float *p1 = p0 + t->o1 * 4;
+    const float *p2 = p0 + t->o2 * 4;
+    const float *p3 = p0 + (1 + imp->size + imp->size * imp->size) * 4;
+    LXInteger c;
+    for (c = 0; c < 3; c++) {
+        outRGB[c] = p0[c] * t->w0 + p1[c] * t->w1 + p2[c] * t->w2 + p3[c] * t->w3;
+    }
+}
+
+#if defined(__SSE2__)
+// returns RGB in the first three lanes and zero in the fourth
+LXINLINE __m128 tetraInterpolate_sse2(const float *lattice, LXInteger diag, const LXTetraWeights *t)
+{
+    const float *p0 = lattice + t->base * 4;
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(p0), _mm_set1_ps(t->w0));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(p0 + t->o1 * 4), _mm_set1_ps(t->w1)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(p0 + t->o2 * 4), _mm_set1_ps(t->w2)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(p0 + diag * 4), _mm_set1_ps(t->w3)));
+    return v;
+}
+#endif
+
+void LXLUT3DLookupRGB(LXLUT3DRef r, const float *inRGB, float *outRGB)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+    LXTetraWeights t;
+    float coords[3];
+    if ( !imp || !inRGB || !outRGB) return;
+
+    latticeCoords(imp, inRGB, coords);
+    tetraWeightsForCoords(imp, coords, &t);
+    tetraInterpolate(imp, &t, outRGB);
+}
+
+
+#pragma mark --- rows ---
+
+#define LUT_CHUNK  64
+
+static void applyRow_int8(const LXLUT3DImpl *imp, const uint8_t *src, uint8_t *dst, LXInteger w)
+{
+    const LXInteger n = imp->size;
+    const LXInteger diag = 1 + n + n * n;
+    LXTetraWeights t;
+    LXInteger x;
+
+    for (x = 0; x < w; x++) {
+        const uint8_t *s = src + x*4;
+        uint8_t *d = dst + x*4;
+        const uint8_t alpha = s[3];
+
+        tetraWeights(imp->offs8[0][s[0]] + imp->offs8[1][s[1]] + imp->offs8[2][s[2]],
+                     imp->frac8[0][s[0]], imp->frac8[1][s[1]], imp->frac8[2][s[2]], n, n * n, &t);
+#if defined(__SSE2__)
+        __m128 v = tetraInterpolate_sse2(imp->lattice, diag, &t);
+        __m128i vi = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+        vi = _mm_packs_epi32(vi, vi);
+        vi = _mm_packus_epi16(vi, vi);
+        const uint32_t px = (uint32_t)_mm_cvtsi128_si32(vi);
+        memcpy(d, &px, 3);
+#else
+        float rgb[3];
+        LXInteger c;
+        tetraInterpolate(imp, &t, rgb);
+        for (c = 0; c < 3; c++) {
+            const float f = rgb[c] * 255.0f + 0.5f;
+            d[c] = (f > 0.0f) ? ((f < 255.0f) ? (uint8_t)f : 255) : 0;
+        }
+#endif
+        d[3] = alpha;
+    }
+}
+
+static void applyRow_float32(const LXLUT3DImpl *imp, const float *src, float *dst, LXInteger w)
+{
+    const LXInteger n = imp->size;
+    const LXInteger diag = 1 + n + n * n;
+    LXTetraWeights t;
+    float coords[3];
+    LXInteger x;
+
+#if defined(__SSE2__)
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    const __m128 scale = _mm_setr_ps(imp->coordScale[0], imp->coordScale[1], imp->coordScale[2], 0.0f);
+    const __m128 offset = _mm_setr_ps(imp->coordOffset[0], imp->coordOffset[1], imp->coordOffset[2], 0.0f);
+    const __m128 strides = _mm_setr_ps(1.0f, (float)n, (float)(n * n), 0.0f);
+    const __m128 maxCoord = _mm_set1_ps((float)(n - 1));
+    const __m128 maxIndex = _mm_set1_ps((float)(n - 2));
+    const LXBool hasShaper = (imp->shaperSize > 0);
+    float fracs[4], offs[4];
+#endif
+
+    for (x = 0; x < w; x++) {
+        const float *s = src + x*4;
+        float *d = dst + x*4;
+
+#if defined(__SSE2__)
+        const __m128 px = _mm_loadu_ps(s);
+        __m128 c;
+        if (hasShaper) {
+            latticeCoords(imp, s, coords);
+            c = _mm_setr_ps(coords[0], coords[1], coords[2], 0.0f);
+        } else {
+            // max() is first so that NaN becomes zero
+            c = _mm_add_ps(_mm_mul_ps(px, scale), offset);
+            c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), maxCoord);
+        }
+        // the index is found in float; node offsets are exact in float for the largest lattice
+        const __m128 fl = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(c)), maxIndex);
+        _mm_storeu_ps(fracs, _mm_sub_ps(c, fl));
+        _mm_storeu_ps(offs, _mm_mul_ps(fl, strides));
+
+        tetraWeights((LXInteger)(offs[0] + offs[1] + offs[2]), fracs[0], fracs[1], fracs[2], n, n * n, &t);
+
+        __m128 v = tetraInterpolate_sse2(imp->lattice, diag, &t);
+        v = _mm_or_ps(v, _mm_and_ps(px, alphaMask));  // the lattice's pad lane is zero
+        _mm_storeu_ps(d, v);
+#else
+        latticeCoords(imp, s, coords);
+        tetraWeightsForCoords(imp, coords, &t);
+        const float alpha = s[3];
+        tetraInterpolate(imp, &t, d);
+        d[3] = alpha;
+#endif
+    }
+}
+
+static void applyRow_float16(const LXLUT3DImpl *imp, const LXHalf *src, LXHalf *dst, LXInteger w)
+{
+    float tmp[LUT_CHUNK * 4];
+    LXInteger x0;
+
+    for (x0 = 0; x0 < w; x0 += LUT_CHUNK) {
+        const LXInteger n = MIN(LUT_CHUNK, w - x0);
+
+        LXConvertHalfToFloatArray(src + 4*x0, tmp, n * 4);
+        applyRow_float32(imp, tmp, tmp, n);
+        LXConvertFloatToHalfArray(tmp, dst + 4*x0, n * 4);
+    }
+}
+
+
+#pragma mark --- applying to images ---
+
+typedef struct {
+    const LXLUT3DImpl *imp;
+    const uint8_t *src;
+    size_t srcRowBytes;
+    uint8_t *dst;
+    size_t dstRowBytes;
+    LXInteger w;
+    LXPixelFormat pxFormat;
+} LXLUT3DJob;
+
+static void applyBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    const LXLUT3DJob *job = (const LXLUT3DJob *)userData;
+    LXInteger y;
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *s = job->src + job->srcRowBytes * y;
+        uint8_t *d = job->dst + job->dstRowBytes * y;
+
+        switch (job->pxFormat) {
+            case kLX_RGBA_FLOAT32:
+                applyRow_float32(job->imp, (const float *)s, (float *)d, job->w);
+                break;
+            case kLX_RGBA_FLOAT16:
+                applyRow_float16(job->imp, (const LXHalf *)s, (LXHalf *)d, job->w);
+                break;
+            default:
+                applyRow_int8(job->imp, s, d, job->w);
+                break;
+        }
+    }
+}
+
+static void applyLUT(const LXLUT3DImpl *imp, const uint8_t *srcBuf, size_t srcRowBytes, uint8_t *dstBuf, size_t dstRowBytes,
+                     LXInteger w, LXInteger h, LXPixelFormat pxFormat)
+{
+    LXLUT3DJob job;
+
+    if ( !imp || !srcBuf || !dstBuf || w < 1 || h < 1) return;
+
+    job.imp = imp;
+    job.src = srcBuf;
+    job.srcRowBytes = srcRowBytes;
+    job.dst = dstBuf;
+    job.dstRowBytes = dstRowBytes;
+    job.w = w;
+    job.pxFormat = pxFormat;
+
+    LXParallelApplyToRowBands(w, h, 0, 0, applyBand, &job);
+}
+
+void LXImageApplyLUT3D_RGBA_int8(const LXInteger w, const LXInteger h,
+                                 uint8_t *srcBuf, const size_t srcRowBytes,
+                                 uint8_t *dstBuf, const size_t dstRowBytes,
+                                 LXLUT3DRef lut)
+{
+    applyLUT((LXLUT3DImpl *)lut, srcBuf, srcRowBytes, dstBuf, dstRowBytes, w, h, kLX_RGBA_INT8);
+}
+
+void LXImageApplyLUT3D_RGBA_float16(const LXInteger w, const LXInteger h,
+                                    LXHalf *srcBuf, const size_t srcRowBytes,
+                                    LXHalf *dstBuf, const size_t dstRowBytes,
+                                    LXLUT3DRef lut)
+{
+    applyLUT((LXLUT3DImpl *)lut, (uint8_t *)srcBuf, srcRowBytes, (uint8_t *)dstBuf, dstRowBytes, w, h, kLX_RGBA_FLOAT16);
+}
+
+void LXImageApplyLUT3D_RGBA_float32(const LXInteger w, const LXInteger h,
+                                    float *srcBuf, const size_t srcRowBytes,
+                                    float *dstBuf, const size_t dstRowBytes,
+                                    LXLUT3DRef lut)
+{
+    applyLUT((LXLUT3DImpl *)lut, (uint8_t *)srcBuf, srcRowBytes, (uint8_t *)dstBuf, dstRowBytes, w, h, kLX_RGBA_FLOAT32);
+}
+
+LXSuccess LXLUT3DApplyToData(LXLUT3DRef r,
+                             const uint8_t *srcBuf, size_t srcRowBytes,
+                             uint8_t *dstBuf, size_t dstRowBytes,
+                             uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                             LXError *outError)
+{
+    LXLUT3DImpl *imp = (LXLUT3DImpl *)r;
+
+    if ( !imp || !srcBuf || !dstBuf) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NO;
+    }
+    if (pxFormat != kLX_RGBA_INT8 && pxFormat != kLX_RGBA_FLOAT16 && pxFormat != kLX_RGBA_FLOAT32) {
+        char msg[256];
+        sprintf(msg, "unsupported pixel format for 3D LUT (%lu)", (unsigned long)pxFormat);
+        LXErrorSet(outError, kLXErrorID_LUT3D_UnsupportedPixelFormat, msg);
+        return NO;
+    }
+    applyLUT(imp, srcBuf, srcRowBytes, dstBuf, dstRowBytes, w, h, pxFormat);
+    return YES;
+}
+
+LXSuccess LXLUT3DApplyToPixelBuffer(LXLUT3DRef r,
+                                    LXPixelBufferRef srcPixbuf,
+                                    LXPixelBufferRef dstPixbuf,
+                                    LXError *outError)
+{
+    if ( !r || !srcPixbuf || !dstPixbuf) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NO;
+    }
+
+    const uint32_t w = LXPixelBufferGetWidth(srcPixbuf);
+    const uint32_t h = LXPixelBufferGetHeight(srcPixbuf);
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(srcPixbuf);
+
+    if (w != LXPixelBufferGetWidth(dstPixbuf) || h != LXPixelBufferGetHeight(dstPixbuf)
+                || pxFormat != LXPixelBufferGetPixelFormat(dstPixbuf)) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_SizeMismatch, "pixel buffers don't have the same size and pixel format");
+        return NO;
+    }
+
+    size_t srcRowBytes = 0;
+    size_t dstRowBytes = 0;
+    uint8_t *srcBuf = LXPixelBufferLockPixels(srcPixbuf, &srcRowBytes, NULL, outError);
+    if ( !srcBuf) return NO;
+
+    uint8_t *dstBuf = (dstPixbuf == srcPixbuf) ? srcBuf : LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, NULL, outError);
+    if ( !dstBuf) {
+        LXPixelBufferUnlockPixels(srcPixbuf);
+        return NO;
+    }
+    if (dstPixbuf == srcPixbuf) dstRowBytes = srcRowBytes;
+
+    LXSuccess success = LXLUT3DApplyToData(r, srcBuf, srcRowBytes, dstBuf, dstRowBytes, w, h, pxFormat, outError);
+
+    if (dstPixbuf != srcPixbuf) LXPixelBufferUnlockPixels(dstPixbuf);
+    LXPixelBufferUnlockPixels(srcPixbuf);
+    return success;
+}
+
+
+#pragma mark --- file parsing ---
+
+#define MAXLINELEN  1024
+
+// copies the next line into "line" (null-terminated, leading whitespace skipped); returns NO at the end of the data
+static LXBool readLine(const char **pp, const char *end, char *line)
+{
+    const char *p = *pp;
+    size_t n = 0;
+
+    if (p >= end) return NO;
+
+    while (p < end && *p != '\n' && *p != '\r') {
+        if (n < MAXLINELEN - 1 && (n > 0 || !isspace((unsigned char)*p))) line[n++] = *p;
+        p++;
+    }
+    while (p < end && (*p == '\n' || *p == '\r')) p++;
+
+    line[n] = 0;
+    *pp = p;
+    return YES;
+}
+
+// parses up to "maxCount" numbers from a line; returns the number parsed
+static LXInteger parseNumbers(const char *str, double *values, LXInteger maxCount)
+{
+    LXInteger n = 0;
+    char *endp = NULL;
+
+    while (n < maxCount) {
+        double v = strtod(str, &endp);
+        if (endp == str) break;
+        values[n++] = v;
+        str = endp;
+    }
+    return n;
+}
+
+static LXBool keywordMatches(const char *line, const char *keyword, const char **outArgs)
+{
+    const size_t len = strlen(keyword);
+    if (strncmp(line, keyword, len) != 0 || (line[len] != 0 && !isspace((unsigned char)line[len])))
+        return NO;
+    *outArgs = line + len;
+    return YES;
+}
+
+static void setParseError(LXError *outError, LXInteger lineNum, const char *what)
+{
+    char msg[256];
+    snprintf(msg, sizeof(msg), "3D LUT parse error on line %ld: %s", (long)lineNum, what);
+    LXErrorSet(outError, kLXErrorID_LUT3D_ParseError, msg);
+}
+
+LXLUT3DRef LXLUT3DCreateFromCubeData(const char *data, size_t len, LXError *outError)
+{
+    const char *p = data;
+    const char *end = data + len;
+    char line[MAXLINELEN];
+    LXInteger lineNum = 0;
+    LXInteger size1D = 0, size3D = 0;
+    float range1D[2] = { 0.0f, 1.0f };
+    float domMin[3] = { 0.0f, 0.0f, 0.0f };
+    float domMax[3] = { 1.0f, 1.0f, 1.0f };
+    float *values = NULL;
+    LXInteger valueCount = 0, expectedCount = 0;
+    LXLUT3DImpl *imp = NULL;
+    LXInteger i, c;
+
+    if ( !data || len < 1) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NULL;
+    }
+
+    while (readLine(&p, end, line)) {
+        const char *args = NULL;
+        double v[3];
+        lineNum++;
+
+        if (line[0] == 0 || line[0] == '#') continue;
+
+        if (keywordMatches(line, "TITLE", &args)) {
+            continue;
+        }
+        else if (keywordMatches(line, "LUT_3D_SIZE", &args) || keywordMatches(line, "LUT_1D_SIZE", &args)) {
+            const LXBool is3D = (line[4] == '3');
+            if (values || parseNumbers(args, v, 1) != 1 || v[0] < 2 || v[0] > ((is3D) ? kLXLUT3D_MaxSize : 65536)) {
+                setParseError(outError, lineNum, "invalid LUT size");
+                goto bail;
+            }
+            if (is3D) size3D = (LXInteger)v[0];
+            else size1D = (LXInteger)v[0];
+        }
+        else if (keywordMatches(line, "DOMAIN_MIN", &args) || keywordMatches(line, "DOMAIN_MAX", &args)) {
+            float *dom = (line[8] == 'I') ? domMin : domMax;
+            if (parseNumbers(args, v, 3) != 3) {
+                setParseError(outError, lineNum, "invalid domain");
+                goto bail;
+            }
+            for (c = 0; c < 3; c++) dom[c] = (float)v[c];
+        }
+        else if (keywordMatches(line, "LUT_3D_INPUT_RANGE", &args) || keywordMatches(line, "LUT_1D_INPUT_RANGE", &args)) {
+            const LXBool is3D = (line[4] == '3');
+            if (parseNumbers(args, v, 2) != 2 || v[0] == v[1]) {
+                setParseError(outError, lineNum, "invalid input range");
+                goto bail;
+            }
+            if (is3D) {
+                for (c = 0; c < 3; c++) {
+                    domMin[c] = (float)v[0];
+                    domMax[c] = (float)v[1];
+                }
+            } else {
+                range1D[0] = (float)v[0];
+                range1D[1] = (float)v[1];
+            }
+        }
+        else if (isdigit((unsigned char)line[0]) || line[0] == '-' || line[0] == '+' || line[0] == '.') {
+            if ( !values) {
+                expectedCount = size1D + size3D * size3D * size3D;
+                if (expectedCount < 1) {
+                    setParseError(outError, lineNum, "data before LUT size");
+                    goto bail;
+                }
+                values = _lx_malloc(expectedCount * 3 * sizeof(float));
+            }
+            if (valueCount >= expectedCount || parseNumbers(line, v, 3) != 3) {
+                setParseError(outError, lineNum, (valueCount >= expectedCount) ? "too many entries" : "invalid entry");
+                goto bail;
+            }
+            for (c = 0; c < 3; c++) values[valueCount*3 + c] = (float)v[c];
+            valueCount++;
+        }
+        else {
+            // unknown keywords are allowed by the format (e.g. LUT_IN_VIDEO_RANGE in some exporters)
+            continue;
+        }
+    }
+
+    if ( !values || valueCount != expectedCount) {
+        char msg[128];
+        sprintf(msg, "expected %ld entries, found %ld", (long)expectedCount, (long)valueCount);
+        setParseError(outError, lineNum, msg);
+        goto bail;
+    }
+
+    if (size3D > 0) {
+        if ( !(imp = (LXLUT3DImpl *)LXLUT3DCreateWithData(size3D, values + size1D * 3, outError)))
+            goto bail;
+        memcpy(imp->domMin, domMin, sizeof(domMin));
+        memcpy(imp->domMax, domMax, sizeof(domMax));
+        if (size1D > 0) {
+            LXLUT3DSetShaper((LXLUT3DRef)imp, size1D, values, range1D[0], range1D[1], NULL);
+        }
+    } else {
+        // a 1D LUT is a shaper on an identity lattice whose domain covers the shaper's output,
+        // which tetrahedral interpolation reproduces exactly.
+        // DOMAIN_MIN/MAX describe the 1D input range in this case.
+        float lo[3] = { 0.0f, 0.0f, 0.0f };
+        float hi[3] = { 1.0f, 1.0f, 1.0f };
+        float identity[8 * 3];
+        for (i = 0; i < size1D * 3; i++) {
+            lo[i % 3] = MIN(lo[i % 3], values[i]);
+            hi[i % 3] = MAX(hi[i % 3], values[i]);
+        }
+        for (i = 0; i < 8; i++) {
+            for (c = 0; c < 3; c++) identity[i*3 + c] = (i & (1 << c)) ? 1.0f : 0.0f;
+        }
+        if ( !(imp = (LXLUT3DImpl *)LXLUT3DCreateWithData(2, identity, outError)))
+            goto bail;
+        for (i = 0; i < 8; i++) {
+            for (c = 0; c < 3; c++) imp->lattice[i*4 + c] = (i & (1 << c)) ? hi[c] : lo[c];
+        }
+        memcpy(imp->domMin, lo, sizeof(lo));
+        memcpy(imp->domMax, hi, sizeof(hi));
+        if (range1D[0] == 0.0f && range1D[1] == 1.0f) {
+            range1D[0] = domMin[0];
+            range1D[1] = domMax[0];
+        }
+        LXLUT3DSetShaper((LXLUT3DRef)imp, size1D, values, range1D[0], range1D[1], NULL);
+    }
+    updateDerivedTables(imp);
+
+bail:
+    _lx_free(values);
+    return (LXLUT3DRef)imp;
+}
+
+LXLUT3DRef LXLUT3DCreateFrom3DLData(const char *data, size_t len, LXError *outError)
+{
+    const char *p = data;
+    const char *end = data + len;
+    char line[MAXLINELEN];
+    LXInteger lineNum = 0;
+    double mesh[kLXLUT3D_MaxSize + 1];
+    LXInteger size = 0;
+    LXInteger outBits = 0;
+    float *values = NULL;
+    LXInteger valueCount = 0, expectedCount = 0;
+    double maxValue = 0.0;
+    LXLUT3DImpl *imp = NULL;
+    LXInteger i, c;
+
+    if ( !data || len < 1) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty argument");
+        return NULL;
+    }
+
+    while (readLine(&p, end, line)) {
+        const char *args = NULL;
+        double v[3];
+        lineNum++;
+
+        if (line[0] == 0 || line[0] == '#' || keywordMatches(line, "3DMESH", &args)) continue;
+
+        if (keywordMatches(line, "Mesh", &args)) {
+            // "Mesh 4 12" means a 2^4+1 point input mesh and 12-bit output values
+            if (parseNumbers(args, v, 2) != 2 || v[1] < 1 || v[1] > 16) {
+                setParseError(outError, lineNum, "invalid mesh line");
+                goto bail;
+            }
+            outBits = (LXInteger)v[1];
+        }
+        else if (isdigit((unsigned char)line[0])) {
+            if (size == 0) {
+                // the first line of numbers is the input mesh
+                size = parseNumbers(line, mesh, kLXLUT3D_MaxSize + 1);
+                if (size < 2 || size > kLXLUT3D_MaxSize) {
+                    setParseError(outError, lineNum, "invalid input mesh");
+                    goto bail;
+                }
+                expectedCount = size * size * size;
+                values = _lx_malloc(expectedCount * 3 * sizeof(float));
+                continue;
+            }
+            if (valueCount >= expectedCount || parseNumbers(line, v, 3) != 3) {
+                setParseError(outError, lineNum, (valueCount >= expectedCount) ? "too many entries" : "invalid entry");
+                goto bail;
+            }
+            // blue changes fastest in .3dl files
+            const LXInteger ib = valueCount % size;
+            const LXInteger ig = (valueCount / size) % size;
+            const LXInteger ir = valueCount / (size * size);
+            const LXInteger idx = (ib * size + ig) * size + ir;
+            for (c = 0; c < 3; c++) {
+                values[idx*3 + c] = (float)v[c];
+                maxValue = MAX(maxValue, v[c]);
+            }
+            valueCount++;
+        }
+        else {
+            setParseError(outError, lineNum, "unexpected text");
+            goto bail;
+        }
+    }
+
+    if ( !values || valueCount != expectedCount) {
+        char msg[128];
+        sprintf(msg, "expected %ld entries, found %ld", (long)expectedCount, (long)valueCount);
+        setParseError(outError, lineNum, msg);
+        goto bail;
+    }
+
+    // output scale from the Mesh line if there was one, otherwise the smallest common depth that fits the data
+    double outMax;
+    if (outBits > 0) outMax = (double)((1 << outBits) - 1);
+    else outMax = (maxValue <= 1023.0) ? 1023.0 : ((maxValue <= 4095.0) ? 4095.0 : 65535.0);
+
+    for (i = 0; i < expectedCount * 3; i++) values[i] = (float)(values[i] / outMax);
+
+    if ( !(imp = (LXLUT3DImpl *)LXLUT3DCreateWithData(size, values, outError)))
+        goto bail;
+
+    // the input mesh gives the positions of the lattice planes in input code values (e.g. 0-1023 for 10-bit)
+    double inMax = 1.0;
+    while (inMax < mesh[size - 1]) inMax = inMax * 2.0 + 1.0;
+    LXBool isUniform = YES;
+    for (i = 1; i < size; i++) {
+        const double expected = mesh[0] + (mesh[size - 1] - mesh[0]) * i / (size - 1);
+        if (mesh[i] <= mesh[i - 1]) {
+            LXLUT3DRelease((LXLUT3DRef)imp);
+            imp = NULL;
+            setParseError(outError, 1, "input mesh is not increasing");
+            goto bail;
+        }
+        if (fabs(mesh[i] - expected) > 1.0) isUniform = NO;
+    }
+
+    for (c = 0; c < 3; c++) {
+        imp->domMin[c] = (float)(mesh[0] / inMax);
+        imp->domMax[c] = (float)(mesh[size - 1] / inMax);
+    }
+
+    if ( !isUniform) {
+        // a shaper that maps each mesh position to its lattice plane, i.e. the inverse of the mesh curve
+        const LXInteger shaperSize = 1024;
+        float *shaper = _lx_malloc(shaperSize * 3 * sizeof(float));
+        LXInteger seg = 0;
+        for (i = 0; i < shaperSize; i++) {
+            const double x = inMax * i / (shaperSize - 1);
+            double d;
+            while (seg < size - 2 && x > mesh[seg + 1]) seg++;
+            d = seg + (x - mesh[seg]) / (mesh[seg + 1] - mesh[seg]);
+            d = MIN(size - 1, MAX(0.0, d));
+            for (c = 0; c < 3; c++) {
+                shaper[i*3 + c] = imp->domMin[c] + (imp->domMax[c] - imp->domMin[c]) * (float)(d / (size - 1));
+            }
+        }
+        LXLUT3DSetShaper((LXLUT3DRef)imp, shaperSize, shaper, 0.0f, 1.0f, NULL);
+        _lx_free(shaper);
+    }
+    updateDerivedTables(imp);
+
+bail:
+    _lx_free(values);
+    return (LXLUT3DRef)imp;
+}
+
+static LXBool pathHasExtension(LXUnibuffer path, const char *ext)
+{
+    const size_t extLen = strlen(ext);
+    size_t i;
+    if (path.numOfChar16 <= extLen + 1 || path.unistr[path.numOfChar16 - extLen - 1] != '.')
+        return NO;
+
+    for (i = 0; i < extLen; i++) {
+        char16_t ch = path.unistr[path.numOfChar16 - extLen + i];
+        if (ch >= 'A' && ch <= 'Z') ch += 'a' - 'A';
+        if (ch != (char16_t)ext[i]) return NO;
+    }
+    return YES;
+}
+
+LXLUT3DRef LXLUT3DCreateFromFileAtPath(LXUnibuffer path, LXError *outError)
+{
+    if ( !path.unistr || path.numOfChar16 < 1) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_EmptyArg, "empty path given");
+        return NULL;
+    }
+
+    const LXBool isCube = pathHasExtension(path, "cube");
+    if ( !isCube && !pathHasExtension(path, "3dl")) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_UnsupportedFileFormat, "unsupported 3D LUT file extension (expected .cube or .3dl)");
+        return NULL;
+    }
+
+    LXFilePtr file = NULL;
+    if ( !LXOpenFileForReadingWithUnipath(path.unistr, path.numOfChar16, &file)) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_FileReadError, "could not open file");
+        return NULL;
+    }
+
+    _lx_fseek64(file, 0, SEEK_END);
+    size_t fileLen = (size_t)_lx_ftell64(file);
+    char *fileData = _lx_malloc(fileLen + 1);
+
+    _lx_fseek64(file, 0, SEEK_SET);
+    size_t bytesRead = _lx_fread(fileData, 1, fileLen, file);
+    _lx_fclose(file);
+
+    LXLUT3DRef lut = NULL;
+    if (bytesRead != fileLen || bytesRead == 0) {
+        LXErrorSet(outError, kLXErrorID_LUT3D_FileReadError, "error reading from file");
+    } else {
+        lut = (isCube) ? LXLUT3DCreateFromCubeData(fileData, fileLen, outError)
+                       : LXLUT3DCreateFrom3DLData(fileData, fileLen, outError);
+    }
+    _lx_free(fileData);
+    return lut;
+}
@@ -0,0 +1,109 @@
+/*
+ *  LXLUT3D.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXLUT3D_H_
+#define _LXLUT3D_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+
+
+enum {
+    kLXErrorID_LUT3D_EmptyArg = 6801,
+    kLXErrorID_LUT3D_InvalidSize,
+    kLXErrorID_LUT3D_ParseError,
+    kLXErrorID_LUT3D_UnsupportedFileFormat,
+    kLXErrorID_LUT3D_FileReadError,
+    kLXErrorID_LUT3D_UnsupportedPixelFormat,
+    kLXErrorID_LUT3D_SizeMismatch
+};
+
+// the lattice size is limited to this on each axis
+#define kLXLUT3D_MaxSize  129
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma mark --- LXLUT3D public API methods ---
+
+/*
+  A 3D LUT maps RGB colors through a cubic lattice of output colors using tetrahedral interpolation.
+
+  Input values are first mapped from the LUT's domain (0-1 by default) to lattice coordinates. An optional shaper
+  is a per-channel 1D LUT applied before this, which lets a lattice of moderate size cover log or HDR input
+  (e.g. a shaper that maps scene-linear 0-16 into 0-1). Input outside the domain is clamped to the lattice's edges.
+  Alpha is not modified.
+
+  The lattice is immutable after the LUT has been created. The domain and the shaper can be changed with
+  LXLUT3DSetDomain() and LXLUT3DSetShaper(); otherwise a LUT can be applied from many threads at once.
+*/
+
+LXEXPORT const char *LXLUT3DTypeID();
+
+// "rgbData" contains size*size*size RGB triplets with red changing fastest, i.e. the same order as in .cube files.
+// the returned object is retained
+LXEXPORT LXLUT3DRef LXLUT3DCreateWithData(LXUInteger size, const float *rgbData, LXError *outError);
+
+// parses the text of an Adobe/Resolve .cube file.
+// DOMAIN_MIN/MAX and LUT_3D_INPUT_RANGE are supported. a file that also contains a 1D LUT gets that as its shaper,
+// and a file with only a 1D LUT gets a 2*2*2 identity lattice.
+LXEXPORT LXLUT3DRef LXLUT3DCreateFromCubeData(const char *data, size_t len, LXError *outError);
+
+// parses the text of an Autodesk/Lustre .3dl file.
+// the output bit depth is read from a "Mesh" line if present, otherwise it's guessed from the largest value.
+// a non-uniform input mesh becomes a shaper.
+LXEXPORT LXLUT3DRef LXLUT3DCreateFrom3DLData(const char *data, size_t len, LXError *outError);
+
+// the format is chosen based on the file extension (.cube or .3dl)
+LXEXPORT LXLUT3DRef LXLUT3DCreateFromFileAtPath(LXUnibuffer path, LXError *outError);
+
+LXEXPORT LXLUT3DRef LXLUT3DRetain(LXLUT3DRef lut);
+LXEXPORT void LXLUT3DRelease(LXLUT3DRef lut);
+
+// number of lattice points on each axis
+LXEXPORT LXUInteger LXLUT3DGetSize(LXLUT3DRef lut);
+
+LXEXPORT void LXLUT3DGetDomain(LXLUT3DRef lut, float *outMinRGB, float *outMaxRGB);
+// this must not be called while the LUT is being applied on another thread
+LXEXPORT void LXLUT3DSetDomain(LXLUT3DRef lut, const float *minRGB, const float *maxRGB);
+
+// "values" contains "count" RGB triplets that sample the shaper evenly over [inMin, inMax];
+// the outputs are in the LUT's domain. pass NULL to remove the shaper.
+// this must not be called while the LUT is being applied on another thread.
+LXEXPORT LXSuccess LXLUT3DSetShaper(LXLUT3DRef lut, LXUInteger count, const float *values, float inMin, float inMax, LXError *outError);
+LXEXPORT LXBool LXLUT3DHasShaper(LXLUT3DRef lut);
+
+// maps a single color; this is the reference implementation for the image functions
+LXEXPORT void LXLUT3DLookupRGB(LXLUT3DRef lut, const float *inRGB, float *outRGB);
+
+// applies the LUT to a w*h image of RGBA int8/float16/float32 pixels; see also LXImageApplyLUT3D_* in LXImageFunctions.h.
+// "srcBuf" and "dstBuf" have the same pixel format; they can be the same buffer. large images are processed on multiple threads.
+LXEXPORT LXSuccess LXLUT3DApplyToData(LXLUT3DRef lut,
+                                      const uint8_t *srcBuf, size_t srcRowBytes,
+                                      uint8_t *dstBuf, size_t dstRowBytes,
+                                      uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                      LXError *outError);
+
+// the pixel buffers must have the same size and pixel format, but they can be the same buffer
+LXEXPORT LXSuccess LXLUT3DApplyToPixelBuffer(LXLUT3DRef lut,
+                                             LXPixelBufferRef srcPixbuf,
+                                             LXPixelBufferRef dstPixbuf,
+                                             LXError *outError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
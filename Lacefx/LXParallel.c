@@ -0,0 +1,373 @@
+/*
+ *  LXParallel.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd. 
+ *
+ 
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ 
+ */
+
+#include "LXParallel.h"
+#include "LXMutex.h"
+
+#if defined(LXPLATFORM_WIN)
+ #include <windows.h>
+#elif defined(__APPLE__) || defined(_HAVE_PTHREAD_H)
+ #include <pthread.h>
+ #include <unistd.h>
+#endif
+
+
+/*
+  Items are scheduled with work stealing: the item range is split evenly between the workers up front,
+  each worker takes items from the front of its own range, and a worker that runs out takes
+  the back half of what remains in another worker's range. Each range has its own lock,
+  so workers don't contend on a shared counter.
+
+  With pthreads, the worker threads are created on first use and then wait for the next call.
+  If the pool is already busy (LXParallelApply called from several threads at once),
+  the call creates its own threads instead, as is always done on Windows.
+*/
+
+typedef struct {
+    LXMutex lock;
+    LXInteger begin;
+    LXInteger end;
+    char pad[64];  // keeps the ranges on separate cache lines
+} LXParallelRange;
+
+typedef struct {
+    LXParallelApplyFuncPtr func;
+    void *userData;
+    LXInteger workerCount;
+    LXParallelRange ranges[kLXParallelMaxWorkers];
+} LXParallelJob;
+
+typedef struct {
+    LXParallelJob *job;
+    LXInteger workerIndex;
+} LXParallelWorker;
+
+
+static void initJob(LXParallelJob *job, LXInteger itemCount, LXInteger workerCount, LXParallelApplyFuncPtr func, void *userData)
+{
+    LXInteger i;
+    job->func = func;
+    job->userData = userData;
+    job->workerCount = workerCount;
+
+    for (i = 0; i < workerCount; i++) {
+        LXMutexInit(&job->ranges[i].lock);
+        job->ranges[i].begin = (itemCount * i) / workerCount;
+        job->ranges[i].end = (itemCount * (i + 1)) / workerCount;
+    }
+}
+
+static void destroyJob(LXParallelJob *job)
+{
+    LXInteger i;
+    for (i = 0; i < job->workerCount; i++) {
+        LXMutexDestroy(&job->ranges[i].lock);
+    }
+}
+
+static LXBool takeOwnItem(LXParallelRange *range, LXInteger *outItem)
+{
+    LXBool found = NO;
+    LXMutexLock(&range->lock);
+    if (range->begin < range->end) {
+        *outItem = range->begin++;
+        found = YES;
+    }
+    LXMutexUnlock(&range->lock);
+    return found;
+}
+
+static LXBool stealItems(LXParallelJob *job, LXInteger thiefIndex, LXInteger *outItem)
+{
+    LXInteger i;
+    for (i = 1; i < job->workerCount; i++) {
+        LXParallelRange *victim = job->ranges + (thiefIndex + i) % job->workerCount;
+        LXInteger stolenBegin = 0, stolenEnd = 0;
+
+        LXMutexLock(&victim->lock);
+        const LXInteger remaining = victim->end - victim->begin;
+        if (remaining > 0) {
+            stolenEnd = victim->end;
+            stolenBegin = stolenEnd - (remaining + 1) / 2;
+            victim->end = stolenBegin;
+        }
+        LXMutexUnlock(&victim->lock);
+
+        if (stolenEnd > stolenBegin) {
+            // the thief's own range is empty at this point, and only the owner ever adds to it
+            LXParallelRange *own = job->ranges + thiefIndex;
+            LXMutexLock(&own->lock);
+            own->begin = stolenBegin + 1;
+            own->end = stolenEnd;
+            LXMutexUnlock(&own->lock);
+
+            *outItem = stolenBegin;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static void runWorker(LXParallelJob *job, LXInteger workerIndex)
+{
+    LXInteger item;
+
+    while (takeOwnItem(job->ranges + workerIndex, &item) || stealItems(job, workerIndex, &item)) {
+        job->func(job->userData, workerIndex, item);
+    }
+}
+
+
+static LXInteger g_lxWorkerCount = 0;
+
+LXInteger LXParallelGetWorkerCount()
+{
+    if (g_lxWorkerCount > 0)
+        return g_lxWorkerCount;
+
+    LXInteger n = 1;
+#if (LX_BUILD_SINGLETHREADED)
+    n = 1;
+#elif defined(LXPLATFORM_WIN)
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    n = sysInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    g_lxWorkerCount = MAX(1, MIN(kLXParallelMaxWorkers, n));
+    return g_lxWorkerCount;
+}
+
+
+#if (LX_BUILD_SINGLETHREADED)
+
+void LXParallelApply(LXInteger itemCount, LXInteger maxWorkers, LXParallelApplyFuncPtr func, void *userData)
+{
+    LXInteger i;
+    for (i = 0; i < itemCount; i++) {
+        func(userData, 0, i);
+    }
+}
+
+#else
+
+#if defined(LXPLATFORM_WIN)
+static DWORD WINAPI workerThreadMain(LPVOID arg)
+{
+    LXParallelWorker *worker = (LXParallelWorker *)arg;
+    runWorker(worker->job, worker->workerIndex);
+    return 0;
+}
+#else
+static void *workerThreadMain(void *arg)
+{
+    LXParallelWorker *worker = (LXParallelWorker *)arg;
+    runWorker(worker->job, worker->workerIndex);
+    return NULL;
+}
+#endif
+
+static void applyWithNewThreads(LXParallelJob *job)
+{
+    LXParallelWorker workers[kLXParallelMaxWorkers];
+#if defined(LXPLATFORM_WIN)
+    HANDLE threads[kLXParallelMaxWorkers];
+#else
+    pthread_t threads[kLXParallelMaxWorkers];
+#endif
+    LXInteger i;
+    LXInteger numStarted = 0;
+
+    for (i = 1; i < job->workerCount; i++) {
+        workers[i].job = job;
+        workers[i].workerIndex = i;
+    #if defined(LXPLATFORM_WIN)
+        threads[i] = CreateThread(NULL, 0, workerThreadMain, &workers[i], 0, NULL);
+        if ( !threads[i]) break;
+    #else
+        if (0 != pthread_create(&threads[i], NULL, workerThreadMain, &workers[i])) break;
+    #endif
+        numStarted++;
+    }
+
+    // the calling thread acts as worker 0; if threads couldn't be created, the items in their ranges get stolen
+    runWorker(job, 0);
+
+    for (i = 1; i <= numStarted; i++) {
+    #if defined(LXPLATFORM_WIN)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    #else
+        pthread_join(threads[i], NULL);
+    #endif
+    }
+}
+
+
+#if !defined(LXPLATFORM_WIN)
+
+static pthread_mutex_t s_poolBusy = PTHREAD_MUTEX_INITIALIZER;  // held for the duration of a job on the pool
+static pthread_mutex_t s_poolLock = PTHREAD_MUTEX_INITIALIZER;  // protects the state below
+static pthread_cond_t s_poolWake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t s_poolDone = PTHREAD_COND_INITIALIZER;
+
+static LXParallelJob *s_poolJob = NULL;
+static uint32_t s_poolGeneration = 0;                           // incremented for each job
+static uint32_t s_poolThreadGeneration[kLXParallelMaxWorkers];  // last job seen by each pool thread
+static LXInteger s_poolThreadCount = 0;                         // pool threads are workers 1 to s_poolThreadCount
+static LXInteger s_poolRunning = 0;                             // pool threads still working on the current job
+
+static void *poolThreadMain(void *arg)
+{
+    const LXInteger workerIndex = (LXInteger)(intptr_t)arg;
+
+    pthread_mutex_lock(&s_poolLock);
+    for (;;) {
+        while (s_poolThreadGeneration[workerIndex] == s_poolGeneration) {
+            pthread_cond_wait(&s_poolWake, &s_poolLock);
+        }
+        s_poolThreadGeneration[workerIndex] = s_poolGeneration;
+
+        LXParallelJob *job = s_poolJob;
+        if ( !job || workerIndex >= job->workerCount)
+            continue;
+
+        pthread_mutex_unlock(&s_poolLock);
+        runWorker(job, workerIndex);
+        pthread_mutex_lock(&s_poolLock);
+
+        if (--s_poolRunning == 0)
+            pthread_cond_signal(&s_poolDone);
+    }
+    return NULL;
+}
+
+static LXBool applyOnPool(LXInteger itemCount, LXInteger workerCount, LXParallelApplyFuncPtr func, void *userData)
+{
+    if (0 != pthread_mutex_trylock(&s_poolBusy))
+        return NO;
+
+    LXParallelJob job;
+
+    pthread_mutex_lock(&s_poolLock);
+    while (s_poolThreadCount < workerCount - 1) {
+        const LXInteger workerIndex = s_poolThreadCount + 1;
+        pthread_t thread;
+
+        s_poolThreadGeneration[workerIndex] = s_poolGeneration;
+        if (0 != pthread_create(&thread, NULL, poolThreadMain, (void *)(intptr_t)workerIndex))
+            break;
+        pthread_detach(thread);
+        s_poolThreadCount++;
+    }
+    workerCount = MIN(workerCount, s_poolThreadCount + 1);
+
+    initJob(&job, itemCount, workerCount, func, userData);
+
+    s_poolJob = &job;
+    s_poolRunning = workerCount - 1;
+    s_poolGeneration++;
+    pthread_cond_broadcast(&s_poolWake);
+    pthread_mutex_unlock(&s_poolLock);
+
+    runWorker(&job, 0);
+
+    pthread_mutex_lock(&s_poolLock);
+    while (s_poolRunning > 0) {
+        pthread_cond_wait(&s_poolDone, &s_poolLock);
+    }
+    s_poolJob = NULL;
+    pthread_mutex_unlock(&s_poolLock);
+
+    destroyJob(&job);
+
+    pthread_mutex_unlock(&s_poolBusy);
+    return YES;
+}
+
+#endif
+
+
+void LXParallelApply(LXInteger itemCount, LXInteger maxWorkers, LXParallelApplyFuncPtr func, void *userData)
+{
+    if ( !func || itemCount < 1) return;
+
+    LXInteger workerCount = LXParallelGetWorkerCount();
+    if (maxWorkers > 0) workerCount = MIN(workerCount, maxWorkers);
+    workerCount = MIN(workerCount, itemCount);
+
+    if (workerCount == 1) {
+        LXInteger i;
+        for (i = 0; i < itemCount; i++) {
+            func(userData, 0, i);
+        }
+        return;
+    }
+
+#if !defined(LXPLATFORM_WIN)
+    if (applyOnPool(itemCount, workerCount, func, userData))
+        return;
+#endif
+
+    LXParallelJob job;
+    initJob(&job, itemCount, workerCount, func, userData);
+
+    applyWithNewThreads(&job);
+
+    destroyJob(&job);
+}
+
+#endif
+
+
+#pragma mark --- row bands ---
+
+typedef struct {
+    LXParallelRowBandFuncPtr func;
+    void *userData;
+    LXInteger h;
+    LXInteger bandRows;
+} LXParallelRowBandJob;
+
+static void applyRowBand(void *userData, LXInteger workerIndex, LXInteger bandIndex)
+{
+    const LXParallelRowBandJob *job = (const LXParallelRowBandJob *)userData;
+    const LXInteger y0 = bandIndex * job->bandRows;
+
+    job->func(job->userData, workerIndex, bandIndex, y0, MIN(job->h, y0 + job->bandRows));
+}
+
+LXInteger LXParallelRowsPerBand(LXInteger w, LXInteger bandPixels)
+{
+    if (bandPixels < 1) bandPixels = kLXParallelBandPixels;
+    return (w > 0) ? MAX(1, (bandPixels + w - 1) / w) : 1;
+}
+
+void LXParallelApplyToRowBands(LXInteger w, LXInteger h, LXInteger bandRows, LXInteger maxWorkers,
+                               LXParallelRowBandFuncPtr func, void *userData)
+{
+    LXParallelRowBandJob job;
+
+    if ( !func || w < 1 || h < 1) return;
+
+    job.func = func;
+    job.userData = userData;
+    job.h = h;
+    job.bandRows = (bandRows > 0) ? bandRows : LXParallelRowsPerBand(w, 0);
+
+    if ((double)w * h < kLXParallelMinPixels) maxWorkers = 1;
+
+    LXParallelApply((h + job.bandRows - 1) / job.bandRows, maxWorkers, applyRowBand, &job);
+}
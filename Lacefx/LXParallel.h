@@ -0,0 +1,70 @@
+/*
+ *  LXParallel.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd. 
+ *
+ 
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ 
+ */
+
+#ifndef _LXPARALLEL_H_
+#define _LXPARALLEL_H_
+
+#include "LXBasicTypes.h"
+
+/*
+  LXParallelApply runs a function over a range of items on multiple threads.
+  
+  Items are handed out dynamically, so items of uneven cost are balanced between workers.
+  Each worker starts from its own contiguous part of the range, so neighbouring items tend to run on the same thread.
+  Each call gets the index of the worker that runs it (0 to workerCount-1), which can be used
+  to index per-worker state such as temp buffers or file handles. Worker 0 is the calling thread.
+  
+  The call returns once all items are done. Except on Windows, the workers are threads of a pool that is created
+  on first use and kept for later calls. Calls may be nested or made from several threads at once: a call made while
+  the pool is busy runs on threads started just for that call, which is correct but slower, so nesting is best avoided
+  in hot paths. On Windows, every call starts its own threads.
+
+  LXParallelApplyToRowBands splits an image into bands of whole rows and runs each band as one item.
+  Small images are processed on the calling thread, where threads would cost more than they save.
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void(*LXParallelApplyFuncPtr)(void *userData, LXInteger workerIndex, LXInteger itemIndex);
+
+// called for the rows from y0 to y1-1, which make up the band at "bandIndex"
+typedef void(*LXParallelRowBandFuncPtr)(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1);
+
+enum {
+    kLXParallelMaxWorkers = 32,
+    kLXParallelMinPixels = 256 * 256,   // LXParallelApplyToRowBands uses one thread for images smaller than this
+    kLXParallelBandPixels = 16384       // default band size for LXParallelApplyToRowBands
+};
+
+// number of worker threads that LXParallelApply will use at most (never more than kLXParallelMaxWorkers)
+LXEXPORT LXInteger LXParallelGetWorkerCount(void);
+
+// "maxWorkers" can be 0 to use the default count
+LXEXPORT void LXParallelApply(LXInteger itemCount, LXInteger maxWorkers, LXParallelApplyFuncPtr func, void *userData);
+
+// rows per band for bands of at least "bandPixels" pixels (kLXParallelBandPixels if 0) in an image "w" pixels wide
+LXEXPORT LXInteger LXParallelRowsPerBand(LXInteger w, LXInteger bandPixels);
+
+// runs "func" for bands of "bandRows" rows of an image of w * h pixels; "bandRows" can be 0 for LXParallelRowsPerBand(w, 0).
+// images of fewer than kLXParallelMinPixels pixels, or a "maxWorkers" of 1, run the bands in order on the calling thread
+LXEXPORT void LXParallelApplyToRowBands(LXInteger w, LXInteger h, LXInteger bandRows, LXInteger maxWorkers,
+                                        LXParallelRowBandFuncPtr func, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,702 @@
+/*
+ *  LXPathRaster.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXPathRaster.h"
+#include "LXCurveFunctions.h"
+#include "LXPixelBuffer.h"
+#include "LXParallel.h"
+#include <math.h>
+
+
+#define RASTER_BANDROWS         16
+
+// curves are first split into four pieces, so that a piece with an inflection can't look straight at the sample points;
+// the pieces are subdivided at most FLATTEN_MAXDEPTH times
+#define FLATTEN_INITIALPIECES   4
+#define FLATTEN_MAXDEPTH        16
+
+
+/*
+  Each edge of the flattened path adds the signed area that it covers in each pixel to an accumulation row,
+  so that a running sum along the row gives the winding-weighted coverage of each pixel.
+  Only the span of columns that edges touched is summed on each row, because the sum is zero past a closed path's
+  rightmost edge. Edges are clipped to the image horizontally; the part left of the image becomes a vertical edge
+  at x=0, which still covers the pixels to its right.
+*/
+
+typedef struct {
+    float x0, y0, x1, y1;
+} LXPathEdge;
+
+typedef struct {
+    LXPathEdge *edges;
+    LXInteger count;
+    LXInteger capacity;
+    float w;
+} LXPathEdgeList;
+
+typedef struct {
+    float *acc;                 // RASTER_BANDROWS rows of (w + 2) values
+    float *coverage;
+    LXInteger spanMin[RASTER_BANDROWS];
+    LXInteger spanMax[RASTER_BANDROWS];
+} LXPathRasterScratch;
+
+typedef struct {
+    const LXPathEdge *edges;
+    const int32_t *bandEdges;       // edge indices of each band, starting at bandStarts[band]
+    const LXInteger *bandStarts;
+    LXInteger bandCount;
+
+    uint8_t *dstBuf;
+    size_t dstRowBytes;
+    LXInteger w, h;
+    LXPixelFormat pxFormat;
+    LXBool evenOdd;
+    float color[4];                 // premultiplied
+
+    LXPathRasterScratch *scratch;   // kLXParallelMaxWorkers entries, allocated by each worker when first used
+} LXPathRasterJob;
+
+
+#pragma mark --- flattening ---
+
+static double distanceFromChord(LXPoint p0, LXPoint p1, LXPoint p)
+{
+    const double dx = p1.x - p0.x;
+    const double dy = p1.y - p0.y;
+    const double len = sqrt(dx*dx + dy*dy);
+
+    if (len < 1.0e-9) {
+        return sqrt((p.x - p0.x)*(p.x - p0.x) + (p.y - p0.y)*(p.y - p0.y));
+    }
+    return fabs((p.x - p0.x) * dy - (p.y - p0.y) * dx) / len;
+}
+
+// flattens the curves into polylines; "subpathStarts" gets the index of the first point of each subpath
+// and a final entry that is the total point count
+static LXSuccess flattenCurves(const LXCurveSegment *curves, LXUInteger curveCount, double tolerance,
+                               LXCurvePointList *points, LXInteger **outSubpathStarts, LXInteger *outSubpathCount,
+                               LXError *outError)
+{
+    const uint8_t *p = (const uint8_t *)curves;
+    LXInteger *starts = NULL;
+    LXInteger subpathCount = 0;
+    LXPoint prevEnd = LXZeroPoint;
+    LXUInteger i;
+
+    if (curves->type & kLXCurveSegmentFlag_HasNoStartPoint) {
+        LXErrorSet(outError, kLXErrorID_PathRaster_InvalidCurve, "first curve segment must have a start point");
+        return NO;
+    }
+
+    starts = _lx_malloc((curveCount + 1) * sizeof(LXInteger));
+
+    for (i = 0; i < curveCount; i++) {
+        LXCurveSegment seg;
+        const LXUInteger packedType = ((const LXCurveSegment *)p)->type;
+        const size_t segSize = LXCurveSegmentGetPackedSize(packedType);
+
+        memcpy(&seg, p, segSize);
+        p += segSize;
+
+        seg.type = LXCurveSegmentTypeNoFlags(packedType);
+        if (seg.type > kLXCatmullRomSegment) {
+            char msg[256];
+            sprintf(msg, "unknown curve segment type (%ld) at index %ld", (long)seg.type, (long)i);
+            LXErrorSet(outError, kLXErrorID_PathRaster_InvalidCurve, msg);
+            _lx_free(starts);
+            return NO;
+        }
+
+        if (packedType & kLXCurveSegmentFlag_HasNoStartPoint) {
+            seg.startPoint = prevEnd;
+        }
+        else if (i == 0 || fabs(seg.startPoint.x - prevEnd.x) > 1.0e-5 || fabs(seg.startPoint.y - prevEnd.y) > 1.0e-5) {
+            starts[subpathCount++] = points->count;
+            LXCurvePointListAppend(points, seg.startPoint);
+        }
+        prevEnd = seg.endPoint;
+
+        LXCurveSegmentFlatten(&seg, distanceFromChord, tolerance, FLATTEN_INITIALPIECES, FLATTEN_MAXDEPTH, points);
+    }
+    starts[subpathCount] = points->count;
+
+    *outSubpathStarts = starts;
+    *outSubpathCount = subpathCount;
+    return YES;
+}
+
+
+#pragma mark --- edges ---
+
+static void appendClippedEdge(LXPathEdgeList *list, double x0, double y0, double x1, double y1)
+{
+    if ((float)y0 == (float)y1) return;
+
+    if (list->count >= list->capacity) {
+        list->capacity = (list->capacity > 0) ? list->capacity * 2 : 1024;
+        list->edges = _lx_realloc(list->edges, list->capacity * sizeof(LXPathEdge));
+    }
+    LXPathEdge *e = list->edges + list->count++;
+    e->x0 = (float)MIN(MAX(x0, 0.0), (double)list->w);
+    e->y0 = (float)y0;
+    e->x1 = (float)MIN(MAX(x1, 0.0), (double)list->w);
+    e->y1 = (float)y1;
+}
+
+// edges are split where they cross the left and right sides of the image, so that clamping x keeps their coverage
+static void addEdge(LXPathEdgeList *list, LXPoint p0, LXPoint p1)
+{
+    const double w = list->w;
+    double ts[2];
+    LXInteger n = 0, i;
+
+    if (p0.y == p1.y || !isfinite(p0.x) || !isfinite(p0.y) || !isfinite(p1.x) || !isfinite(p1.y)) return;
+
+    if ((p0.x < 0.0) != (p1.x < 0.0))   ts[n++] = (0.0 - p0.x) / (p1.x - p0.x);
+    if ((p0.x > w) != (p1.x > w))       ts[n++] = (w - p0.x) / (p1.x - p0.x);
+    if (n == 2 && ts[1] < ts[0]) {
+        double t = ts[0];  ts[0] = ts[1];  ts[1] = t;
+    }
+
+    double px = p0.x, py = p0.y;
+    for (i = 0; i < n; i++) {
+        const double x = p0.x + (p1.x - p0.x) * ts[i];
+        const double y = p0.y + (p1.y - p0.y) * ts[i];
+        appendClippedEdge(list, px, py, x, y);
+        px = x;
+        py = y;
+    }
+    appendClippedEdge(list, px, py, p1.x, p1.y);
+}
+
+static void addFillEdges(LXPathEdgeList *list, const LXPoint *points, const LXInteger *starts, LXInteger subpathCount)
+{
+    LXInteger i, j;
+    for (i = 0; i < subpathCount; i++) {
+        const LXInteger first = starts[i];
+        const LXInteger last = starts[i+1] - 1;
+        for (j = first; j < last; j++) {
+            addEdge(list, points[j], points[j+1]);
+        }
+        addEdge(list, points[last], points[first]);
+    }
+}
+
+// appends the points after the arc's start, up to and including its end
+static void appendArc(LXCurvePointList *out, LXPoint c, double r, double angle, double sweep, double maxStep)
+{
+    const LXInteger steps = MAX(1, (LXInteger)ceil(fabs(sweep) / maxStep));
+    LXInteger k;
+    for (k = 1; k <= steps; k++) {
+        const double a = angle + sweep * k / steps;
+        LXCurvePointListAppend(out, LXMakePoint(c.x + r * cos(a), c.y + r * sin(a)));
+    }
+}
+
+LXINLINE LXPoint segmentNormal(LXPoint p, LXPoint q, double r)
+{
+    const double dx = q.x - p.x;
+    const double dy = q.y - p.y;
+    const double len = sqrt(dx*dx + dy*dy);
+    return LXMakePoint(-dy / len * r, dx / len * r);
+}
+
+// appends the offset of the polyline on its left side (for the normal (-dy, dx)). outer joins are round.
+// an inner join is the intersection of the two offset lines, so the outline doesn't overlap itself there.
+// the intersection may cut at most half of a segment (or all of it next to an open end), so that it can't pass the
+// neighbouring join; sharper turns between short segments go through the vertex, which overlaps inside the stroke
+static void appendOffsetSide(LXCurvePointList *out, const LXPoint *p, LXInteger n, LXBool closed, double r, double maxStep)
+{
+    const LXInteger first = (closed) ? 0 : 1;
+    const LXInteger last = (closed) ? n : n - 1;
+    LXInteger i;
+
+    if ( !closed) {
+        const LXPoint n0 = segmentNormal(p[0], p[1], r);
+        LXCurvePointListAppend(out, LXMakePoint(p[0].x + n0.x, p[0].y + n0.y));
+    }
+    for (i = first; i < last; i++) {
+        const LXPoint prev = p[(i + n - 1) % n];
+        const LXPoint next = p[(i + 1) % n];
+        const LXPoint np = segmentNormal(prev, p[i], r);
+        const LXPoint nn = segmentNormal(p[i], next, r);
+        const LXPoint dp = LXMakePoint(p[i].x - prev.x, p[i].y - prev.y);
+        const LXPoint dn = LXMakePoint(next.x - p[i].x, next.y - p[i].y);
+        const double cross = dp.x * dn.y - dp.y * dn.x;
+        const double dot = dp.x * dn.x + dp.y * dn.y;
+
+        if (cross < 0.0 || (cross == 0.0 && dot < 0.0)) {
+            // a right turn, so this side is the outside; the normals turn clockwise
+            const double a0 = atan2(np.y, np.x);
+            double sweep = atan2(nn.y, nn.x) - a0;
+            while (sweep > 0.0) sweep -= 2.0 * M_PI;
+            while (sweep <= -2.0 * M_PI) sweep += 2.0 * M_PI;
+            LXCurvePointListAppend(out, LXMakePoint(p[i].x + np.x, p[i].y + np.y));
+            appendArc(out, p[i], r, a0, sweep, maxStep);
+        }
+        else if (cross == 0.0) {
+            // straight on, so both offsets are the same point
+            LXCurvePointListAppend(out, LXMakePoint(p[i].x + np.x, p[i].y + np.y));
+        }
+        else {
+            // the intersection is at p[i] + np + dp * a = p[i] + nn + dn * b, with a <= 0 and b >= 0
+            const double ex = nn.x - np.x, ey = nn.y - np.y;
+            const double a = (ex * dn.y - ey * dn.x) / cross;
+            const double b = (ex * dp.y - ey * dp.x) / cross;
+            const double maxA = ( !closed && i == 1) ? 1.0 : 0.5;
+            const double maxB = ( !closed && i == n - 2) ? 1.0 : 0.5;
+
+            if (-a <= maxA && b <= maxB) {
+                LXCurvePointListAppend(out, LXMakePoint(p[i].x + np.x + dp.x * a, p[i].y + np.y + dp.y * a));
+            } else {
+                LXCurvePointListAppend(out, LXMakePoint(p[i].x + np.x, p[i].y + np.y));
+                LXCurvePointListAppend(out, p[i]);
+                LXCurvePointListAppend(out, LXMakePoint(p[i].x + nn.x, p[i].y + nn.y));
+            }
+        }
+    }
+    if ( !closed) {
+        const LXPoint nl = segmentNormal(p[n-2], p[n-1], r);
+        LXCurvePointListAppend(out, LXMakePoint(p[n-1].x + nl.x, p[n-1].y + nl.y));
+    }
+}
+
+static void addPolygonEdges(LXPathEdgeList *list, const LXPoint *p, LXInteger n)
+{
+    LXInteger i;
+    for (i = 0; i < n; i++) {
+        addEdge(list, p[i], p[(i + 1) % n]);
+    }
+}
+
+// a subpath that ends at its start point is stroked as a closed loop: its two sides are separate polygons wound
+// in opposite directions. otherwise the outline is one polygon with round caps
+static void addStrokeEdges(LXPathEdgeList *list, const LXPoint *points, const LXInteger *starts, LXInteger subpathCount,
+                           double width, double tolerance)
+{
+    const double r = 0.5 * width;
+    const double maxStep = (r > tolerance) ? 2.0 * acos(1.0 - tolerance / r) : M_PI / 4.0;
+    LXCurvePointList pts = { NULL, 0, 0 };
+    LXCurvePointList outline = { NULL, 0, 0 };
+    LXInteger i, j;
+
+    for (i = 0; i < subpathCount; i++) {
+        // without repeated points, so that every segment has a direction
+        pts.count = 0;
+        for (j = starts[i]; j < starts[i+1]; j++) {
+            if (pts.count > 0 && fabs(points[j].x - pts.points[pts.count-1].x) < 1.0e-6
+                              && fabs(points[j].y - pts.points[pts.count-1].y) < 1.0e-6)
+                continue;
+            LXCurvePointListAppend(&pts, points[j]);
+        }
+        const LXInteger n = pts.count;
+        const LXBool closed = (n > 2 && fabs(pts.points[0].x - pts.points[n-1].x) < 1.0e-5
+                                     && fabs(pts.points[0].y - pts.points[n-1].y) < 1.0e-5);
+        outline.count = 0;
+
+        if (n == 1) {
+            appendArc(&outline, pts.points[0], r, 0.0, -2.0 * M_PI, maxStep);
+            addPolygonEdges(list, outline.points, outline.count);
+        }
+        else if (closed) {
+            appendOffsetSide(&outline, pts.points, n - 1, YES, r, maxStep);
+            addPolygonEdges(list, outline.points, outline.count);
+
+            for (j = 0; j < (n - 1) / 2; j++) {
+                LXPoint t = pts.points[j];
+                pts.points[j] = pts.points[n - 2 - j];
+                pts.points[n - 2 - j] = t;
+            }
+            outline.count = 0;
+            appendOffsetSide(&outline, pts.points, n - 1, YES, r, maxStep);
+            addPolygonEdges(list, outline.points, outline.count);
+        }
+        else {
+            LXPoint nl;
+            appendOffsetSide(&outline, pts.points, n, NO, r, maxStep);
+            nl = segmentNormal(pts.points[n-2], pts.points[n-1], r);
+            appendArc(&outline, pts.points[n-1], r, atan2(nl.y, nl.x), -M_PI, maxStep);
+
+            for (j = 0; j < n / 2; j++) {
+                LXPoint t = pts.points[j];
+                pts.points[j] = pts.points[n - 1 - j];
+                pts.points[n - 1 - j] = t;
+            }
+            appendOffsetSide(&outline, pts.points, n, NO, r, maxStep);
+            nl = segmentNormal(pts.points[n-2], pts.points[n-1], r);
+            appendArc(&outline, pts.points[n-1], r, atan2(nl.y, nl.x), -M_PI, maxStep);
+
+            addPolygonEdges(list, outline.points, outline.count);
+        }
+    }
+    _lx_free(pts.points);
+    _lx_free(outline.points);
+}
+
+
+#pragma mark --- accumulation ---
+
+static void accumulateEdge(LXPathRasterScratch *scratch, LXInteger stride, LXInteger bandY0, LXInteger bandY1,
+                           const LXPathEdge *e)
+{
+    const float maxX = (float)(stride - 2);
+    float x0 = e->x0, y0 = e->y0, x1 = e->x1, y1 = e->y1;
+    float dir = 1.0f;
+    LXInteger y;
+
+    if (y0 > y1) {
+        float t;
+        t = x0;  x0 = x1;  x1 = t;
+        t = y0;  y0 = y1;  y1 = t;
+        dir = -1.0f;
+    }
+
+    const float dxdy = (x1 - x0) / (y1 - y0);
+    const float top = MAX(y0, (float)bandY0);
+    const LXInteger yEnd = (LXInteger)ceilf(MIN(y1, (float)bandY1));
+    float x = x0 + (top - y0) * dxdy;
+
+    for (y = (LXInteger)floorf(top); y < yEnd; y++) {
+        const float dy = MIN((float)(y + 1), y1) - MAX((float)y, y0);
+        const float xNext = MIN(MAX(x + dxdy * dy, 0.0f), maxX);
+        const float d = dy * dir;
+        const LXInteger row = y - bandY0;
+        float *acc = scratch->acc + row * stride;
+        const float xa = MIN(x, xNext);
+        const float xb = MAX(x, xNext);
+        const float xaFloor = floorf(xa);
+        const LXInteger xai = (LXInteger)xaFloor;
+        const LXInteger xbi = (LXInteger)ceilf(xb);
+
+        if (xbi <= xai + 1) {
+            // the edge stays within one pixel on this row
+            const float xm = 0.5f * (x + xNext) - xaFloor;
+            acc[xai] += d - d * xm;
+            acc[xai + 1] += d * xm;
+        } else {
+            const float s = 1.0f / (xb - xa);
+            const float xaFrac = xa - xaFloor;
+            const float a0 = 0.5f * s * (1.0f - xaFrac) * (1.0f - xaFrac);
+            const float xbFrac = xb - (float)xbi + 1.0f;
+            const float am = 0.5f * s * xbFrac * xbFrac;
+
+            acc[xai] += d * a0;
+            if (xbi == xai + 2) {
+                acc[xai + 1] += d * (1.0f - a0 - am);
+            } else {
+                const float a1 = s * (1.5f - xaFrac);
+                LXInteger xi;
+                acc[xai + 1] += d * (a1 - a0);
+                for (xi = xai + 2; xi < xbi - 1; xi++) {
+                    acc[xi] += d * s;
+                }
+                const float a2 = a1 + (float)(xbi - xai - 3) * s;
+                acc[xbi - 1] += d * (1.0f - a2 - am);
+            }
+            acc[xbi] += d * am;
+        }
+
+        scratch->spanMin[row] = MIN(scratch->spanMin[row], xai);
+        scratch->spanMax[row] = MAX(scratch->spanMax[row], MAX(xbi, xai + 1));
+        x = xNext;
+    }
+}
+
+
+#pragma mark --- compositing ---
+
+static void compositeSpan(const LXPathRasterJob *job, uint8_t *dstRow, const float *coverage, LXInteger x0, LXInteger x1)
+{
+    const float *c = job->color;
+    LXInteger x;
+
+    switch (job->pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_BGRA_INT8:
+        case kLX_ARGB_INT8: {
+            // channel order of the premultiplied color in memory
+            float src[4];
+            if (job->pxFormat == kLX_RGBA_INT8) {
+                src[0] = c[0];  src[1] = c[1];  src[2] = c[2];  src[3] = c[3];
+            } else if (job->pxFormat == kLX_BGRA_INT8) {
+                src[0] = c[2];  src[1] = c[1];  src[2] = c[0];  src[3] = c[3];
+            } else {
+                src[0] = c[3];  src[1] = c[0];  src[2] = c[1];  src[3] = c[2];
+            }
+            for (x = x0; x < x1; x++) {
+                const float k = coverage[x];
+                if (k <= 0.0f) continue;
+                const float inv = 1.0f - c[3] * k;
+                uint8_t *d = dstRow + x * 4;
+                d[0] = (uint8_t)(src[0] * k * 255.0f + d[0] * inv + 0.5f);
+                d[1] = (uint8_t)(src[1] * k * 255.0f + d[1] * inv + 0.5f);
+                d[2] = (uint8_t)(src[2] * k * 255.0f + d[2] * inv + 0.5f);
+                d[3] = (uint8_t)(src[3] * k * 255.0f + d[3] * inv + 0.5f);
+            }
+            break;
+        }
+        case kLX_RGBA_FLOAT32: {
+            float *d = (float *)dstRow;
+            for (x = x0; x < x1; x++) {
+                const float k = coverage[x];
+                if (k <= 0.0f) continue;
+                const float inv = 1.0f - c[3] * k;
+                d[x*4 + 0] = c[0] * k + d[x*4 + 0] * inv;
+                d[x*4 + 1] = c[1] * k + d[x*4 + 1] * inv;
+                d[x*4 + 2] = c[2] * k + d[x*4 + 2] * inv;
+                d[x*4 + 3] = c[3] * k + d[x*4 + 3] * inv;
+            }
+            break;
+        }
+        case kLX_Luminance_INT8: {
+            for (x = x0; x < x1; x++) {
+                const float k = coverage[x] * c[3];
+                if (k <= 0.0f) continue;
+                dstRow[x] = (uint8_t)(k * 255.0f + dstRow[x] * (1.0f - k) + 0.5f);
+            }
+            break;
+        }
+        case kLX_Luminance_FLOAT32: {
+            float *d = (float *)dstRow;
+            for (x = x0; x < x1; x++) {
+                const float k = coverage[x] * c[3];
+                if (k <= 0.0f) continue;
+                d[x] = k + d[x] * (1.0f - k);
+            }
+            break;
+        }
+    }
+}
+
+static void rasterizeBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    const LXPathRasterJob *job = (const LXPathRasterJob *)userData;
+    LXPathRasterScratch *scratch = job->scratch + workerIndex;
+    const LXInteger stride = job->w + 2;
+    LXInteger i, y;
+
+    if (job->bandStarts[bandIndex] == job->bandStarts[bandIndex + 1])
+        return;
+
+    if ( !scratch->acc) {
+        scratch->acc = _lx_calloc(RASTER_BANDROWS * stride, sizeof(float));
+        scratch->coverage = _lx_malloc(stride * sizeof(float));
+    }
+
+    for (y = 0; y < y1 - y0; y++) {
+        scratch->spanMin[y] = stride;
+        scratch->spanMax[y] = -1;
+    }
+
+    for (i = job->bandStarts[bandIndex]; i < job->bandStarts[bandIndex + 1]; i++) {
+        accumulateEdge(scratch, stride, y0, y1, job->edges + job->bandEdges[i]);
+    }
+
+    for (y = 0; y < y1 - y0; y++) {
+        const LXInteger x0 = scratch->spanMin[y];
+        const LXInteger x1 = scratch->spanMax[y];
+        float *acc = scratch->acc + y * stride;
+        float *coverage = scratch->coverage;
+        float sum = 0.0f;
+        LXInteger x;
+
+        if (x1 < x0) continue;
+
+        for (x = x0; x <= x1; x++) {
+            float v;
+            sum += acc[x];
+            acc[x] = 0.0f;  // leaves the accumulator clear for the next band
+
+            v = fabsf(sum);
+            if (job->evenOdd) {
+                v -= 2.0f * floorf(v * 0.5f);
+                coverage[x] = (v > 1.0f) ? 2.0f - v : v;
+            } else {
+                coverage[x] = MIN(v, 1.0f);
+            }
+        }
+        compositeSpan(job, job->dstBuf + job->dstRowBytes * (y0 + y), coverage, x0, MIN(x1 + 1, job->w));
+    }
+}
+
+
+#pragma mark --- API ---
+
+static LXBool isSupportedFormat(LXPixelFormat pxFormat)
+{
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_BGRA_INT8:
+        case kLX_ARGB_INT8:
+        case kLX_RGBA_FLOAT32:
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT32:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+// sorts the edges into bands as lists of indices
+static void binEdges(LXPathRasterJob *job, const LXPathEdgeList *edges, int32_t **outBandEdges, LXInteger **outBandStarts)
+{
+    const LXInteger bandCount = job->bandCount;
+    LXInteger *starts = _lx_calloc(bandCount + 2, sizeof(LXInteger));
+    int32_t *indices;
+    LXInteger i, b, total = 0;
+
+    // first the count for each band, then their offsets, then the indices
+    for (i = 0; i < edges->count; i++) {
+        const LXPathEdge *e = edges->edges + i;
+        const float top = MIN(e->y0, e->y1);
+        const float bottom = MAX(e->y0, e->y1);
+        if (bottom <= 0.0f || top >= (float)job->h) continue;
+
+        const LXInteger b0 = (LXInteger)MAX(top, 0.0f) / RASTER_BANDROWS;
+        const LXInteger b1 = ((LXInteger)ceilf(MIN(bottom, (float)job->h)) - 1) / RASTER_BANDROWS;
+        for (b = b0; b <= b1; b++) starts[b + 2]++;
+    }
+    for (b = 0; b < bandCount; b++) {
+        total += starts[b + 2];
+        starts[b + 2] = total;
+    }
+    indices = _lx_malloc(MAX(total, 1) * sizeof(int32_t));
+
+    for (i = 0; i < edges->count; i++) {
+        const LXPathEdge *e = edges->edges + i;
+        const float top = MIN(e->y0, e->y1);
+        const float bottom = MAX(e->y0, e->y1);
+        if (bottom <= 0.0f || top >= (float)job->h) continue;
+
+        const LXInteger b0 = (LXInteger)MAX(top, 0.0f) / RASTER_BANDROWS;
+        const LXInteger b1 = ((LXInteger)ceilf(MIN(bottom, (float)job->h)) - 1) / RASTER_BANDROWS;
+        for (b = b0; b <= b1; b++) indices[starts[b + 1]++] = (int32_t)i;
+    }
+
+    *outBandEdges = indices;
+    *outBandStarts = starts;
+}
+
+LXSuccess LXPathRasterizeToData(const LXCurveSegment *curves, LXUInteger curveCount,
+                                const LXPathRasterOptions *options,
+                                uint8_t *dstBuf, size_t dstRowBytes,
+                                uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                LXError *outError)
+{
+    LXPathRasterOptions opts;
+    LXCurvePointList points = { NULL, 0, 0 };
+    LXPathEdgeList edges = { NULL, 0, 0, 0.0f };
+    LXInteger *subpathStarts = NULL;
+    LXInteger subpathCount = 0;
+    LXPathRasterJob job;
+    LXInteger i;
+
+    if ( !curves || curveCount < 1 || !dstBuf) {
+        LXErrorSet(outError, kLXErrorID_PathRaster_EmptyArg, "empty argument");
+        return NO;
+    }
+    if ( !isSupportedFormat(pxFormat)) {
+        char msg[256];
+        sprintf(msg, "unsupported pixel format for path rasterization (%ld)", (long)pxFormat);
+        LXErrorSet(outError, kLXErrorID_PathRaster_UnsupportedPixelFormat, msg);
+        return NO;
+    }
+
+    if (options) {
+        opts = *options;
+    } else {
+        memset(&opts, 0, sizeof(opts));
+        opts.color = LXMakeRGBA(1, 1, 1, 1);
+    }
+    if (opts.tolerance == 0.0) opts.tolerance = kLXPathRaster_DefaultTolerance;
+    if ( !(opts.tolerance > 0.0) || !(opts.strokeWidth >= 0.0) || opts.fillRule > kLXFillRule_EvenOdd) {
+        LXErrorSet(outError, kLXErrorID_PathRaster_InvalidOptions, "invalid rasterization options");
+        return NO;
+    }
+    if (w < 1 || h < 1) return YES;
+
+    if ( !flattenCurves(curves, curveCount, opts.tolerance, &points, &subpathStarts, &subpathCount, outError))
+        return NO;
+
+    edges.w = (float)w;
+    if (opts.strokeWidth > 0.0) {
+        addStrokeEdges(&edges, points.points, subpathStarts, subpathCount, opts.strokeWidth, opts.tolerance);
+    } else {
+        addFillEdges(&edges, points.points, subpathStarts, subpathCount);
+    }
+    _lx_free(points.points);
+    _lx_free(subpathStarts);
+
+    memset(&job, 0, sizeof(job));
+    job.edges = edges.edges;
+    job.bandCount = (h + RASTER_BANDROWS - 1) / RASTER_BANDROWS;
+    job.dstBuf = dstBuf;
+    job.dstRowBytes = dstRowBytes;
+    job.w = w;
+    job.h = h;
+    job.pxFormat = pxFormat;
+    job.evenOdd = (opts.strokeWidth == 0.0 && opts.fillRule == kLXFillRule_EvenOdd);
+    {
+    // float buffers can take colors outside 0-1
+    const LXBool isFloat = (pxFormat == kLX_RGBA_FLOAT32 || pxFormat == kLX_Luminance_FLOAT32);
+    const float a = MIN(MAX(opts.color.a, 0.0f), 1.0f);
+    job.color[0] = ((isFloat) ? opts.color.r : MIN(MAX(opts.color.r, 0.0f), 1.0f)) * a;
+    job.color[1] = ((isFloat) ? opts.color.g : MIN(MAX(opts.color.g, 0.0f), 1.0f)) * a;
+    job.color[2] = ((isFloat) ? opts.color.b : MIN(MAX(opts.color.b, 0.0f), 1.0f)) * a;
+    job.color[3] = a;
+    }
+
+    int32_t *bandEdges = NULL;
+    LXInteger *bandStarts = NULL;
+    binEdges(&job, &edges, &bandEdges, &bandStarts);
+    job.bandEdges = bandEdges;
+    job.bandStarts = bandStarts;
+
+    job.scratch = _lx_calloc(kLXParallelMaxWorkers, sizeof(LXPathRasterScratch));
+
+    LXParallelApplyToRowBands(w, h, RASTER_BANDROWS, 0, rasterizeBand, &job);
+
+    for (i = 0; i < kLXParallelMaxWorkers; i++) {
+        _lx_free(job.scratch[i].acc);
+        _lx_free(job.scratch[i].coverage);
+    }
+    _lx_free(job.scratch);
+    _lx_free(bandEdges);
+    _lx_free(bandStarts);
+    _lx_free(edges.edges);
+    return YES;
+}
+
+LXSuccess LXPathRasterizeToPixelBuffer(const LXCurveSegment *curves, LXUInteger curveCount,
+                                       const LXPathRasterOptions *options,
+                                       LXPixelBufferRef dst,
+                                       LXError *outError)
+{
+    if ( !dst) {
+        LXErrorSet(outError, kLXErrorID_PathRaster_EmptyArg, "empty argument");
+        return NO;
+    }
+
+    size_t dstRowBytes = 0;
+    uint8_t *dstBuf = LXPixelBufferLockPixels(dst, &dstRowBytes, NULL, outError);
+    if ( !dstBuf) return NO;
+
+    LXSuccess ok = LXPathRasterizeToData(curves, curveCount, options, dstBuf, dstRowBytes,
+                                         LXPixelBufferGetWidth(dst), LXPixelBufferGetHeight(dst), LXPixelBufferGetPixelFormat(dst),
+                                         outError);
+
+    LXPixelBufferUnlockPixels(dst);
+    return ok;
+}
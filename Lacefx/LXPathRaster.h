@@ -0,0 +1,81 @@
+/*
+ *  LXPathRaster.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#ifndef _LXPATHRASTER_H_
+#define _LXPATHRASTER_H_
+
+#include "LXBasicTypes.h"
+#include "LXRefTypes.h"
+#include "LXCurveTypes.h"
+
+
+enum {
+    kLXErrorID_PathRaster_EmptyArg = 7201,
+    kLXErrorID_PathRaster_UnsupportedPixelFormat,
+    kLXErrorID_PathRaster_InvalidCurve,
+    kLXErrorID_PathRaster_InvalidOptions
+};
+
+enum {
+    kLXFillRule_NonZero = 0,
+    kLXFillRule_EvenOdd
+};
+
+// used when the tolerance in the options is 0
+#define kLXPathRaster_DefaultTolerance  0.1
+
+
+/*
+  CPU rasterization of paths made of curve segments, with anti-aliasing computed from the exact area
+  that the flattened path covers in each pixel.
+
+  A path is an array of curve segments (e.g. from LXCreateBezierCurvesForArc()). A segment that has
+  kLXCurveSegmentFlag_HasNoStartPoint, or whose start point is the previous segment's end point, continues the current
+  subpath; otherwise it begins a new one. Filled subpaths are closed implicitly. Strokes have round joins and caps.
+
+  Coordinates are in pixels: pixel (x, y) covers the square from (x, y) to (x+1, y+1), and row 0 is the first row
+  in memory. The paint is composited "over" the existing content: RGBA-family buffers are treated as premultiplied,
+  and single-channel buffers (masks) are painted with the color's alpha.
+  Large images are rasterized in bands of scanlines on multiple threads.
+*/
+
+typedef struct {
+    LXUInteger fillRule;
+    LXFloat strokeWidth;    // 0 fills the path
+    LXRGBA color;           // not premultiplied
+    LXFloat tolerance;      // max distance in pixels between the curves and their flattened polylines
+} LXPathRasterOptions;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// "options" can be NULL for a nonzero fill with opaque white.
+// supported pixel formats are RGBA/ARGB/BGRA int8, RGBA float32 and luminance int8/float32
+LXEXPORT LXSuccess LXPathRasterizeToData(const LXCurveSegment *curves, LXUInteger curveCount,
+                                         const LXPathRasterOptions *options,
+                                         uint8_t *dstBuf, size_t dstRowBytes,
+                                         uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                                         LXError *outError);
+
+LXEXPORT LXSuccess LXPathRasterizeToPixelBuffer(const LXCurveSegment *curves, LXUInteger curveCount,
+                                                const LXPathRasterOptions *options,
+                                                LXPixelBufferRef dst,
+                                                LXError *outError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -25,6 +25,8 @@
 #include "LXBinaryUtils.h"
 #include "LXImageFunctions.h"
 #include "LXHalfFloat.h"
+#include "LXColorTransform.h"
+#include "LXParallel.h"
 
 #include <math.h>
 #include <ctype.h>
@@ -44,11 +46,18 @@ extern void *g_lxSurfaceLogFuncCbUserData;
 const char * const kLXPixelBufferAttachmentKey_ColorSpaceEncoding = "lxEnum_ColorSpaceEncoding";
 const char * const kLXPixelBufferAttachmentKey_YCbCrPixelFormatID = "lxEnum_YCbCrPixelFormatID";
 
+const char * const kLXPixelBufferConversionKey_AlphaConversion = "lxEnum_AlphaConversion";
+
 const char * const kLXPixelBufferFormatRequestKey_AllowAlpha = "allowAlpha";
 const char * const kLXPixelBufferFormatRequestKey_AllowYUV = "allowYUV";
 const char * const kLXPixelBufferFormatRequestKey_FileFormatID = "fileFormatID";
 const char * const kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel = "preferredBitsPerChannel";
 const char * const kLXPixelBufferFormatRequestKey_CompressionQuality = "compressionQuality";
+const char * const kLXPixelBufferFormatRequestKey_FloatSamples = "floatSamples";
+const char * const kLXPixelBufferFormatRequestKey_TIFFCompression = "tiffCompression";
+const char * const kLXPixelBufferFormatRequestKey_TIFFPredictor = "tiffPredictor";
+const char * const kLXPixelBufferFormatRequestKey_TIFFRowsPerStrip = "tiffRowsPerStrip";
+const char * const kLXPixelBufferFormatRequestKey_TIFFTileSize = "tiffTileSize";
 
 
 //#define DEBUGLOG(format, args...) LXPrintf(format, ## args);
@@ -150,11 +159,60 @@ LXUInteger LXBytesPerPixelForPixelFormat(LXPixelFormat pf)
         case kLX_Luminance_FLOAT32:  return 4;
         
         case kLX_YCbCr422_INT8:      return 2;
+        
+        case kLX_YCbCr420_planar_INT8:
+        case kLX_YCbCr420_biplanar_INT8:
+        case kLX_YCbCr444_planar_INT8:  return 1;  // size of luma sample
     }
     printf("** %s: unknown pixel format (%lu)\n", __func__, (unsigned long)pf);
     return 0;
 }
 
+LXUInteger LXPlaneCountForPixelFormat(LXPixelFormat pf)
+{
+    switch (pf) {
+        case kLX_YCbCr420_planar_INT8:
+        case kLX_YCbCr444_planar_INT8:      return 3;
+        case kLX_YCbCr420_biplanar_INT8:    return 2;
+        default:                            return 1;
+    }
+}
+
+size_t LXPlaneLayoutForPixelFormat(LXPixelFormat pf, uint32_t w, uint32_t h, size_t rowBytes,
+                                   size_t *outPlaneOffsets, size_t *outPlaneRowBytes)
+{
+    size_t offsets[3] = { 0, 0, 0 };
+    size_t rbs[3] = { rowBytes, 0, 0 };
+    size_t size = rowBytes * h;
+    const size_t halfH = (h + 1) / 2;
+    
+    switch (pf) {
+        case kLX_YCbCr420_planar_INT8:
+            rbs[1] = rbs[2] = (rowBytes + 1) / 2;
+            offsets[1] = size;
+            offsets[2] = offsets[1] + rbs[1] * halfH;
+            size = offsets[2] + rbs[2] * halfH;
+            break;
+            
+        case kLX_YCbCr420_biplanar_INT8:
+            rbs[1] = rowBytes;
+            offsets[1] = size;
+            size = offsets[1] + rbs[1] * halfH;
+            break;
+            
+        case kLX_YCbCr444_planar_INT8:
+            rbs[1] = rbs[2] = rowBytes;
+            offsets[1] = size;
+            offsets[2] = offsets[1] + rowBytes * h;
+            size = offsets[2] + rowBytes * h;
+            break;
+    }
+    
+    if (outPlaneOffsets)  memcpy(outPlaneOffsets, offsets, 3*sizeof(size_t));
+    if (outPlaneRowBytes)  memcpy(outPlaneRowBytes, rbs, 3*sizeof(size_t));
+    return size;
+}
+
 size_t LXAlignedRowBytes(size_t rowBytes)
 {
 #if defined(LXPLATFORM_IOS)
@@ -312,7 +370,7 @@ LXPixelBufferRef LXPixelBufferCreateWithRowBytes(LXPoolRef pool,
     imp->bytesPerPixel = (int)LXBytesPerPixelForPixelFormat(pixelFormat);
     
     imp->rowBytes = rowBytes;
-    imp->buffer = (uint8_t *)_lx_malloc(imp->rowBytes * h);
+    imp->buffer = (uint8_t *)_lx_malloc(LXPlaneLayoutForPixelFormat(pixelFormat, w, h, rowBytes, NULL, NULL));
 
 #if defined(__APPLE__)
     int64_t numTotal = OSAtomicIncrement64(&s_createCount);
@@ -337,6 +395,11 @@ LXPixelBufferRef LXPixelBufferCreate(LXPoolRef pool,
     int bytesPerPixel = (int)LXBytesPerPixelForPixelFormat(pixelFormat);
     //size_t rowBytes = ((w * bytesPerPixel) + 15) & ~15;  // 16-byte alignment
     size_t rowBytes = LXAlignedRowBytes(w * bytesPerPixel);
+    
+    if (pixelFormat == kLX_YCbCr420_planar_INT8) {
+        // chroma planes get half of the luma rowBytes, so keep them aligned as well
+        rowBytes = 2 * LXAlignedRowBytes((w + 1) / 2);
+    }
 
     ///printf("%s: size %i * %i, rowbytes %i \n", __func__, w, h, rowBytes);
 
@@ -374,6 +437,40 @@ uint32_t LXPixelBufferGetHeight(LXPixelBufferRef r)
     return imp->h;
 }
 
+LXUInteger LXPixelBufferGetPlaneCount(LXPixelBufferRef r)
+{
+    if ( !r) return 0;
+    LXPixelBufferImpl *imp = (LXPixelBufferImpl *)r;
+    return LXPlaneCountForPixelFormat(imp->pf);
+}
+
+LXSize LXPixelBufferGetSizeOfPlane(LXPixelBufferRef r, LXUInteger plane)
+{
+    if ( !r) return LXMakeSize(0, 0);
+    LXPixelBufferImpl *imp = (LXPixelBufferImpl *)r;
+    
+    if (plane >= LXPlaneCountForPixelFormat(imp->pf)) return LXMakeSize(0, 0);
+    if (plane > 0 && imp->pf != kLX_YCbCr444_planar_INT8) {
+        return LXMakeSize((imp->w + 1) / 2, (imp->h + 1) / 2);
+    }
+    return LXMakeSize(imp->w, imp->h);
+}
+
+uint8_t *LXPixelBufferGetBaseAddressOfPlane(LXPixelBufferRef r, LXUInteger plane, size_t *outRowBytes)
+{
+    if ( !r) return NULL;
+    LXPixelBufferImpl *imp = (LXPixelBufferImpl *)r;
+    
+    if (plane >= LXPlaneCountForPixelFormat(imp->pf)) return NULL;
+    
+    size_t offsets[3];
+    size_t rbs[3];
+    LXPlaneLayoutForPixelFormat(imp->pf, imp->w, imp->h, imp->rowBytes, offsets, rbs);
+    
+    if (outRowBytes) *outRowBytes = rbs[plane];
+    return imp->buffer + offsets[plane];
+}
+
 LXBool LXPixelBufferMatchesSize(LXPixelBufferRef r, LXSize size)
 {
     if ( !r) return NO;
@@ -452,6 +549,11 @@ LXTextureRef LXPixelBufferGetTexture(LXPixelBufferRef r, LXError *outError)
     LXPixelBufferImpl *imp = (LXPixelBufferImpl *)r;
 
     if (imp->texture == NULL) {
+        if (LXPlaneCountForPixelFormat(imp->pf) > 1) {
+            LXErrorSet(outError, 1003, "planar pixel formats can't be used as textures (convert to RGBA or YCbCr 4:2:2 first)");
+            return NULL;
+        }
+    
         LXError error;
         memset(&error, 0, sizeof(LXError));
     
@@ -780,6 +882,12 @@ LXPixelBufferRef LXPixelBufferCreateFromFileInMemory(const uint8_t *data, size_t
         return NULL;    
     }
     
+#if LX_HAS_BUILTIN_PNG
+    else if (imageType == kLXImage_PNG) {
+        return LXPixelBufferCreateFromPNGImageInMemory(data, len, properties, outError);
+    }
+#endif
+    
     LXMapPtr newProps = properties;
     if (properties && formatUTI) {
         LXMapPtr newProps = LXMapCreateMutable();
@@ -901,6 +1009,18 @@ LXPixelBufferRef LXPixelBufferCreateFromFileAtPath(LXUnibuffer uni, LXMapPtr pro
         }
     }
 #endif
+
+#if LX_HAS_BUILTIN_PNG
+    else if (imageType == kLXImage_PNG) {
+        newPixbuf = LXPixelBufferCreateFromPNGImageAtPath(thePath, properties, outError);
+    }
+#endif
+
+#if LX_HAS_BUILTIN_JPEG_READER
+    else if (imageType == kLXImage_JPEG) {
+        newPixbuf = LXPixelBufferCreateFromJPEGImageAtPath(thePath, properties, outError);
+    }
+#endif
     
     else {
         // call the platform-dependent implementation (handles a lot of formats on OS X)
@@ -1002,6 +1122,12 @@ LXSuccess LXPixelBufferWriteAsFileToPath(LXPixelBufferRef pixbuf, LXUnibuffer un
         retVal = LXPixelBufferWriteAsTIFFImageToPath(pixbuf, unipath, properties, outError);
     }
 #endif
+
+#if LX_HAS_BUILTIN_PNG
+    else if (imageType == kLXImage_PNG) {
+        retVal = LXPixelBufferWriteAsPNGImageToPath(pixbuf, unipath, properties, outError);
+    }
+#endif
     
     else if (imageType > 0) {
         retVal = LXPixelBufferWriteToPathUsingNativeAPI_(pixbuf, unipath, imageType, properties, outError);
@@ -1149,8 +1275,10 @@ LXPixelBufferRef LXPixelBufferCreateFromSerializedData(const uint8_t *buf, size_
         uint8_t *dstBuf = LXPixelBufferLockPixels(newPixbuf, NULL, NULL, NULL);
 
         // if data is zlib compressed, must decompress (=inflate)
+        const size_t bufSize = LXPlaneLayoutForPixelFormat(pf, w, h, rowBytes, NULL, NULL);
+    
         if (flags & kLXPixBufIsDeflated) {
-            size_t inflateBufSize = h * rowBytes + 1024;
+            size_t inflateBufSize = bufSize + 1024;
             srcBuf = (uint8_t *) _lx_malloc(inflateBufSize);
             srcNeedsFree = YES;
             size_t inflatedLen = 0;
@@ -1175,7 +1303,7 @@ LXPixelBufferRef LXPixelBufferCreateFromSerializedData(const uint8_t *buf, size_
             }
         }
         else {
-            _lx_memcpy_aligned(dstBuf, srcBuf, rowBytes * h);
+            _lx_memcpy_aligned(dstBuf, srcBuf, bufSize);
         }
         
         LXPixelBufferUnlockPixels(newPixbuf);
@@ -1191,7 +1319,7 @@ size_t LXPixelBufferGetSerializedDataSize(LXPixelBufferRef r)
     if ( !r) return 0;
     LXPixelBufferImpl *imp = (LXPixelBufferImpl *)r;
     
-    size_t bufSize = FLATHEADERSIZE + (imp->rowBytes * imp->h);
+    size_t bufSize = FLATHEADERSIZE + LXPlaneLayoutForPixelFormat(imp->pf, imp->w, imp->h, imp->rowBytes, NULL, NULL);
     
     return bufSize;
 }
@@ -1214,7 +1342,7 @@ LXSuccess LXPixelBufferSerialize(LXPixelBufferRef r, uint8_t *buf, size_t bufLen
     flat->h = imp->h;
     flat->pf = imp->pf;
     flat->rowBytes = (unsigned int)imp->rowBytes;
-    flat->imageDataSize = imp->rowBytes * imp->h;
+    flat->imageDataSize = LXPlaneLayoutForPixelFormat(imp->pf, imp->w, imp->h, imp->rowBytes, NULL, NULL);
     flat->metadataSizeInBytes = 0;
     
     memcpy(buf + FLATHEADERSIZE,  imp->buffer,  flat->imageDataSize);
@@ -1230,7 +1358,7 @@ LXSuccess LXPixelBufferSerializeDeflated(LXPixelBufferRef r, uint8_t **outBuf, s
     
     // create deflated data.
     // we just assume that the compressed data won't grow substantially in size.
-    size_t srcBufSize = imp->rowBytes * imp->h;
+    size_t srcBufSize = LXPlaneLayoutForPixelFormat(imp->pf, imp->w, imp->h, imp->rowBytes, NULL, NULL);
     size_t dstBufSize = srcBufSize + 512;
     size_t deflDataSize = 0;
     uint8_t *deflBuf = (uint8_t *) _lx_malloc(dstBufSize);
@@ -1356,20 +1484,227 @@ static void pxReorder_uint8_as_3210(uint8_t * LXRESTRICT dstBuf, const uint8_t *
 }
 
 
-// "srcYCbCrFormatID" specifies the YUV pixel layout.
-// this is a hack to allow us to put YUY2 format data into LXPixelBuffers on Win32 where it's a common format from DirectShow.
-// YUY2 is specified with a value of 1.
-// Lacefx's default YCbCr layout is called '2vuy' on Mac, 'UYVY' on Win32.
-// 
-enum {
-    kLX_YCbCrFormat_2vuy = 0,
-    kLX_YCbCrFormat_YUY2 = 1
-};
+// "srcYCbCrFormatID" specifies the YUV pixel layout (see kLX_YCbCrFormat_* in LXPixelBuffer.h).
+// it can have kLX_YCbCrFormatFlag_FullRange set.
 
-#define LXPXF_ISRGBA(pxf_)       ((pxf_) == kLX_RGBA_INT8 || (pxf_) == RGBA_FLOAT16 || (pxf_) == kLX_RGBA_FLOAT32 || (pxf_) == kLX_ARGB_INT8 || (pxf_) == kLX_BGRA_INT8)
+#define LXPXF_ISRGBA(pxf_)       ((pxf_) == kLX_RGBA_INT8 || (pxf_) == kLX_RGBA_FLOAT16 || (pxf_) == kLX_RGBA_FLOAT32 || (pxf_) == kLX_ARGB_INT8 || (pxf_) == kLX_BGRA_INT8)
 #define LXPXF_ISLUMINANCE(pxf_)  ((pxf_) == kLX_Luminance_INT8 || (pxf_) == kLX_Luminance_FLOAT16 || (pxf_) == kLX_Luminance_FLOAT32)
 
 
+static void getPlanePointers(const uint8_t *buf, LXPixelFormat pf, uint32_t w, uint32_t h, size_t rowBytes,
+                             uint8_t **outPlanes, size_t *outRowBytes)
+{
+    size_t offsets[3];
+    LXPlaneLayoutForPixelFormat(pf, w, h, rowBytes, offsets, outRowBytes);
+    outPlanes[0] = (uint8_t *)buf + offsets[0];
+    outPlanes[1] = (uint8_t *)buf + offsets[1];
+    outPlanes[2] = (uint8_t *)buf + offsets[2];
+}
+
+// conversions to/from the planar YCbCr formats.
+// anything other than RGBA_int8 / RGBA float goes through a temp RGBA_int8 image.
+static LXSuccess pxConvertPlanar_(const uint8_t * LXRESTRICT aSrcBuffer,
+                                  const uint32_t srcW, const uint32_t srcH, const size_t srcRowBytes,
+                                  const LXPixelFormat srcPxFormat,
+                                  uint8_t * LXRESTRICT aDstBuffer,
+                                  const uint32_t dstW, const uint32_t dstH, const size_t dstRowBytes,
+                                  const LXPixelFormat dstPxFormat,
+                                  LXUInteger srcColorSpaceID,
+                                  LXUInteger dstColorSpaceID,
+                                  LXUInteger srcYCbCrFormatID,
+                                  LXUInteger dstYCbCrFormatID,
+                                  LXError *outError)
+{
+    const uint32_t realW = MIN(srcW, dstW);
+    const uint32_t realH = MIN(srcH, dstH);
+    const LXUInteger srcPlaneCount = LXPlaneCountForPixelFormat(srcPxFormat);
+    uint8_t *srcPlanes[3];
+    uint8_t *dstPlanes[3];
+    size_t srcPlaneRowBytes[3];
+    size_t dstPlaneRowBytes[3];
+    LXUInteger y;
+    
+    getPlanePointers(aSrcBuffer, srcPxFormat, srcW, srcH, srcRowBytes, srcPlanes, srcPlaneRowBytes);
+    getPlanePointers(aDstBuffer, dstPxFormat, dstW, dstH, dstRowBytes, dstPlanes, dstPlaneRowBytes);
+    
+    if (srcPxFormat == dstPxFormat) {
+        LXUInteger i;
+        for (i = 0; i < srcPlaneCount; i++) {
+            const LXBool isChroma = (i > 0 && srcPxFormat != kLX_YCbCr444_planar_INT8);
+            const LXUInteger rows = (isChroma) ? (realH + 1) / 2 : realH;
+            const size_t rowLen = (isChroma && srcPxFormat == kLX_YCbCr420_planar_INT8) ? (realW + 1) / 2
+                                                : ((isChroma) ? 2 * ((realW + 1) / 2) : realW);
+            for (y = 0; y < rows; y++) {
+                memcpy(dstPlanes[i] + dstPlaneRowBytes[i] * y, srcPlanes[i] + srcPlaneRowBytes[i] * y, rowLen);
+            }
+        }
+        return YES;
+    }
+    
+    if (srcPlaneCount > 1) {
+        const LXColorSpaceEncoding cspace = (srcColorSpaceID == kLX_YCbCr_Rec709) ? kLX_YCbCr_Rec709 : kLX_YCbCr_Rec601;
+        const LXBool fullRange = (srcYCbCrFormatID & kLX_YCbCrFormatFlag_FullRange) ? YES : NO;
+        uint8_t *tempBuf = NULL;
+        uint8_t *rgbaBuf = aDstBuffer;
+        size_t rgbaRowBytes = dstRowBytes;
+        LXBool isFloat = NO;
+        
+        if (dstPxFormat == kLX_RGBA_FLOAT32 || dstPxFormat == kLX_RGBA_FLOAT16) {
+            isFloat = YES;
+            if (dstPxFormat == kLX_RGBA_FLOAT16) {
+                rgbaRowBytes = LXAlignedRowBytes(realW * 4 * sizeof(float));
+                rgbaBuf = tempBuf = _lx_malloc(rgbaRowBytes);
+            }
+        }
+        else if (dstPxFormat != kLX_RGBA_INT8) {
+            rgbaRowBytes = LXAlignedRowBytes(realW * 4);
+            rgbaBuf = tempBuf = _lx_malloc(rgbaRowBytes * realH);
+        }
+        
+        if (isFloat) {
+            // converted by row so that float16 only needs a one-row temp buffer
+            for (y = 0; y < realH; y++) {
+                const LXUInteger cy = (srcPxFormat == kLX_YCbCr444_planar_INT8) ? y : y / 2;
+                uint8_t *srcY = srcPlanes[0] + srcPlaneRowBytes[0] * y;
+                uint8_t *srcCb = srcPlanes[1] + srcPlaneRowBytes[1] * cy;
+                uint8_t *srcCr = srcPlanes[2] + srcPlaneRowBytes[2] * cy;
+                float *dst = (float *)((tempBuf) ? tempBuf : (aDstBuffer + dstRowBytes * y));
+                
+                switch (srcPxFormat) {
+                    case kLX_YCbCr420_planar_INT8:
+                        LXPxConvert_YCbCr420_planar_to_RGBA_float32(realW, 1, srcY, srcPlaneRowBytes[0], srcCb, srcCr, srcPlaneRowBytes[1],
+                                                                    dst, rgbaRowBytes, cspace, fullRange);
+                        break;
+                    case kLX_YCbCr420_biplanar_INT8:
+                        LXPxConvert_YCbCr420_biplanar_to_RGBA_float32(realW, 1, srcY, srcPlaneRowBytes[0], srcCb, srcPlaneRowBytes[1],
+                                                                      dst, rgbaRowBytes, cspace, fullRange);
+                        break;
+                    default:
+                        LXPxConvert_YCbCr444_planar_to_RGBA_float32(realW, 1, srcY, srcPlaneRowBytes[0], srcCb, srcCr, srcPlaneRowBytes[1],
+                                                                    dst, rgbaRowBytes, cspace, fullRange);
+                        break;
+                }
+                if (tempBuf) {
+                    LXConvertFloatToHalfArray(dst, (LXHalf *)(aDstBuffer + dstRowBytes * y), realW * 4);
+                }
+            }
+            _lx_free(tempBuf);
+            return YES;
+        }
+        
+        switch (srcPxFormat) {
+            case kLX_YCbCr420_planar_INT8:
+                LXPxConvert_YCbCr420_planar_to_RGBA_int8(realW, realH, srcPlanes[0], srcPlaneRowBytes[0], srcPlanes[1], srcPlanes[2], srcPlaneRowBytes[1],
+                                                         rgbaBuf, rgbaRowBytes, cspace, fullRange);
+                break;
+            case kLX_YCbCr420_biplanar_INT8:
+                LXPxConvert_YCbCr420_biplanar_to_RGBA_int8(realW, realH, srcPlanes[0], srcPlaneRowBytes[0], srcPlanes[1], srcPlaneRowBytes[1],
+                                                           rgbaBuf, rgbaRowBytes, cspace, fullRange);
+                break;
+            default:
+                LXPxConvert_YCbCr444_planar_to_RGBA_int8(realW, realH, srcPlanes[0], srcPlaneRowBytes[0], srcPlanes[1], srcPlanes[2], srcPlaneRowBytes[1],
+                                                         rgbaBuf, rgbaRowBytes, cspace, fullRange);
+                break;
+        }
+        
+        LXSuccess success = YES;
+        if (tempBuf) {
+            success = LXPxConvert_Any_(tempBuf, realW, realH, rgbaRowBytes, kLX_RGBA_INT8,
+                                       aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                                       kLX_sRGB, dstColorSpaceID, 0, dstYCbCrFormatID, outError);
+            _lx_free(tempBuf);
+        }
+        return success;
+    }
+    
+    // destination is planar
+    {
+        const LXColorSpaceEncoding cspace = (dstColorSpaceID == kLX_YCbCr_Rec709) ? kLX_YCbCr_Rec709 : kLX_YCbCr_Rec601;
+        const LXBool fullRange = (dstYCbCrFormatID & kLX_YCbCrFormatFlag_FullRange) ? YES : NO;
+        uint8_t *tempBuf = NULL;
+        uint8_t *rgbaBuf = (uint8_t *)aSrcBuffer;
+        size_t rgbaRowBytes = srcRowBytes;
+        
+        if (srcPxFormat != kLX_RGBA_INT8) {
+            rgbaRowBytes = LXAlignedRowBytes(realW * 4);
+            rgbaBuf = tempBuf = _lx_malloc(rgbaRowBytes * realH);
+            
+            if ( !LXPxConvert_Any_(aSrcBuffer, srcW, srcH, srcRowBytes, srcPxFormat,
+                                   tempBuf, realW, realH, rgbaRowBytes, kLX_RGBA_INT8,
+                                   srcColorSpaceID, 0, srcYCbCrFormatID, 0, outError)) {
+                _lx_free(tempBuf);
+                return NO;
+            }
+        }
+        
+        switch (dstPxFormat) {
+            case kLX_YCbCr420_planar_INT8:
+                LXPxConvert_RGBA_to_YCbCr420_planar(realW, realH, rgbaBuf, rgbaRowBytes,
+                                                    dstPlanes[0], dstPlaneRowBytes[0], dstPlanes[1], dstPlanes[2], dstPlaneRowBytes[1],
+                                                    cspace, fullRange);
+                break;
+            case kLX_YCbCr420_biplanar_INT8:
+                LXPxConvert_RGBA_to_YCbCr420_biplanar(realW, realH, rgbaBuf, rgbaRowBytes,
+                                                      dstPlanes[0], dstPlaneRowBytes[0], dstPlanes[1], dstPlaneRowBytes[1],
+                                                      cspace, fullRange);
+                break;
+            default:
+                LXPxConvert_RGBA_to_YCbCr444_planar(realW, realH, rgbaBuf, rgbaRowBytes,
+                                                    dstPlanes[0], dstPlaneRowBytes[0], dstPlanes[1], dstPlanes[2], dstPlaneRowBytes[1],
+                                                    cspace, fullRange);
+                break;
+        }
+        _lx_free(tempBuf);
+        return YES;
+    }
+}
+
+
+// conversion between two RGB color spaces (see LXColorTransform.h).
+// the transform is applied at the higher precision of the two formats: float destinations are converted in place after
+// the pixel format conversion, otherwise the source is first converted into a temp buffer in its own format.
+static LXSuccess pxConvertWithColorTransform_(const uint8_t * LXRESTRICT aSrcBuffer,
+                                  const uint32_t srcW, const uint32_t srcH, const size_t srcRowBytes,
+                                  const LXPixelFormat srcPxFormat,
+                                  uint8_t * LXRESTRICT aDstBuffer,
+                                  const uint32_t dstW, const uint32_t dstH, const size_t dstRowBytes,
+                                  const LXPixelFormat dstPxFormat,
+                                  LXUInteger srcColorSpaceID,
+                                  LXUInteger dstColorSpaceID,
+                                  LXUInteger srcYCbCrFormatID,
+                                  LXUInteger dstYCbCrFormatID,
+                                  LXError *outError)
+{
+    LXColorTransformRef colorTransform = LXColorTransformGetShared(srcColorSpaceID, dstColorSpaceID);
+    const uint32_t realW = MIN(srcW, dstW);
+    const uint32_t realH = MIN(srcH, dstH);
+    const LXBool dstIsFloat = (dstPxFormat == kLX_RGBA_FLOAT16 || dstPxFormat == kLX_RGBA_FLOAT32);
+    
+    if (LXPXF_ISRGBA(srcPxFormat) && !dstIsFloat) {
+        const size_t tempRowBytes = LXAlignedRowBytes(realW * LXBytesPerPixelForPixelFormat(srcPxFormat));
+        uint8_t *tempBuf = _lx_malloc(tempRowBytes * realH);
+        LXSuccess success;
+        
+        success = LXColorTransformApplyToData(colorTransform, aSrcBuffer, srcRowBytes, tempBuf, tempRowBytes, realW, realH, srcPxFormat, outError)
+               && LXPxConvert_Any_(tempBuf, realW, realH, tempRowBytes, srcPxFormat,
+                                   aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                                   0, 0, srcYCbCrFormatID, dstYCbCrFormatID, outError);
+        _lx_free(tempBuf);
+        return success;
+    }
+    
+    if ( !LXPxConvert_Any_(aSrcBuffer, srcW, srcH, srcRowBytes, srcPxFormat,
+                           aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                           0, 0, srcYCbCrFormatID, dstYCbCrFormatID, outError))
+        return NO;
+    
+    if (LXPXF_ISRGBA(dstPxFormat)) {
+        return LXColorTransformApplyToData(colorTransform, aDstBuffer, dstRowBytes, aDstBuffer, dstRowBytes, realW, realH, dstPxFormat, outError);
+    }
+    return YES;
+}
+
+
 LXSuccess LXPxConvert_Any_(const uint8_t * LXRESTRICT aSrcBuffer,
                            const uint32_t srcW, const uint32_t srcH, const size_t srcRowBytes,
                            const LXPixelFormat srcPxFormat,
@@ -1395,6 +1730,20 @@ LXSuccess LXPxConvert_Any_(const uint8_t * LXRESTRICT aSrcBuffer,
     //printf("lx pxConvert: pf %i / %i, rb %ld / %ld, color %ld / %ld, ycbcrformat %ld\n", (int)srcPxFormat, (int)dstPxFormat, (long)srcRowBytes, (long)dstRowBytes,
     //                            (long)srcColorSpaceID, (long)dstColorSpaceID, (long)srcYCbCrFormatID);
 
+    // pixels tagged with two different RGB color spaces are converted between them
+    if (srcColorSpaceID != dstColorSpaceID
+            && LXColorTransformSupportsColorSpace(srcColorSpaceID) && LXColorTransformSupportsColorSpace(dstColorSpaceID)) {
+        return pxConvertWithColorTransform_(aSrcBuffer, srcW, srcH, srcRowBytes, srcPxFormat,
+                                            aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                                            srcColorSpaceID, dstColorSpaceID, srcYCbCrFormatID, dstYCbCrFormatID, outError);
+    }
+
+    if (LXPlaneCountForPixelFormat(srcPxFormat) > 1 || LXPlaneCountForPixelFormat(dstPxFormat) > 1) {
+        return pxConvertPlanar_(aSrcBuffer, srcW, srcH, srcRowBytes, srcPxFormat,
+                                aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                                srcColorSpaceID, dstColorSpaceID, srcYCbCrFormatID, dstYCbCrFormatID, outError);
+    }
+
     if (srcPxFormat == dstPxFormat && srcRowBytes == dstRowBytes) {
         // we can only do a one-shot memcpy if the rowbytes actually matches the expected image size.
         // if this condition isn't filled, the code will fallback on the row-by-row memcpy further down in this function.
@@ -1432,24 +1781,20 @@ LXSuccess LXPxConvert_Any_(const uint8_t * LXRESTRICT aSrcBuffer,
     }
     
     else if (srcPxFormat == kLX_RGBA_INT8 && dstPxFormat == kLX_YCbCr422_INT8) {
-        LXPxConvert_RGBA_to_YCbCr422(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes, dstColorSpaceID);
+        LXPxConvert_RGBA_to_YCbCr422_withFormat(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes,
+                                                dstColorSpaceID, dstYCbCrFormatID, NO);
         return YES;
     }
     else if (srcPxFormat == kLX_ARGB_INT8 && dstPxFormat == kLX_YCbCr422_INT8) {
-        LXPxConvert_ARGB_to_YCbCr422(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes, dstColorSpaceID);
+        LXPxConvert_ARGB_to_YCbCr422_withFormat(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes,
+                                                dstColorSpaceID, dstYCbCrFormatID, NO);
         return YES;
     }
     
     else if (srcPxFormat == kLX_YCbCr422_INT8 && dstPxFormat == kLX_RGBA_INT8) {
         ///LXPrintf("%s -- will convert YUV to RGBA, srcdata %p, srcformat %i\n", __func__, aSrcBuffer, srcYCbCrFormatID);
-        switch (srcYCbCrFormatID) {
-            default:
-                LXPxConvert_YCbCr422_to_RGBA_int8(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes, dstColorSpaceID);
-                break;
-            case kLX_YCbCrFormat_YUY2:
-                LXPxConvert_YCbCr422_YUY2_to_RGBA_int8(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes, dstColorSpaceID);
-                break;
-        }
+        LXPxConvert_YCbCr422_to_RGBA_int8_withFormat(realW, realH, (uint8_t *)aSrcBuffer, srcRowBytes, aDstBuffer, dstRowBytes,
+                                                     srcColorSpaceID, srcYCbCrFormatID, NO);
         return YES;
     }
     
@@ -1708,8 +2053,9 @@ LXSuccess LXPxConvert_Any_(const uint8_t * LXRESTRICT aSrcBuffer,
                                                             (uint8_t *)tempRowBuf, tempRowBytes, (uint8_t *)dstBuf, dstRowBytes, 1,
                                                             kLX_709_toY__R, kLX_709_toY__G, kLX_709_toY__B);  // sRGB also uses 709 values, so it's the default choice
                 } else if (dstPxFormat == kLX_YCbCr422_INT8) {
-                    LXPxConvert_RGBA_to_YCbCr422(realW, 1,
-                                                 (uint8_t *)tempRowBuf, tempRowBytes, (uint8_t *)dstBuf, dstRowBytes, dstColorSpaceID);
+                    LXPxConvert_RGBA_to_YCbCr422_withFormat(realW, 1,
+                                                 (uint8_t *)tempRowBuf, tempRowBytes, (uint8_t *)dstBuf, dstRowBytes,
+                                                 dstColorSpaceID, dstYCbCrFormatID, NO);
                 } else {
                     LXPxConvert_RGBA_to_reverse_BGRA_int8(realW, 1,
                                                           (uint8_t *)tempRowBuf, tempRowBytes, (uint8_t *)dstBuf, dstRowBytes);
@@ -1735,6 +2081,161 @@ LXSuccess LXPxConvert_Any_(const uint8_t * LXRESTRICT aSrcBuffer,
 }
 
 
+// the alpha conversion is done in bands of rows, so that the pixels are still in cache when it's applied.
+// it's done on the side with more precision: either on the converted destination rows, or on a copy of the source rows
+// (e.g. when unpremultiplying float data into 8 bits, or when the destination has no alpha).
+// the bands are run on multiple threads; a band is smaller than kLXParallelMinPixels, so the conversion inside it
+// (e.g. a color transform) stays on the worker's thread
+#define ALPHACONV_BANDBYTES  (128 * 1024)
+
+typedef struct {
+    const uint8_t *srcBuf;
+    size_t srcRowBytes;
+    LXPixelFormat srcPxFormat;
+    uint8_t *dstBuf;
+    uint32_t dstW, dstH;
+    size_t dstRowBytes;
+    LXPixelFormat dstPxFormat;
+    LXUInteger srcColorSpaceID, dstColorSpaceID;
+    LXUInteger srcYCbCrFormatID, dstYCbCrFormatID;
+    LXUInteger alphaConversion;
+    uint32_t realW;
+    LXBool dstIsPlanar;
+    LXBool onSource;
+    size_t tempRowBytes;
+    uint32_t bandH;
+    uint8_t *tempBufs[kLXParallelMaxWorkers];  // allocated by each worker on first use
+    LXError errors[kLXParallelMaxWorkers];
+    volatile int32_t failed;
+} LXAlphaConversionJob;
+
+static void alphaConversionBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    LXAlphaConversionJob *job = (LXAlphaConversionJob *)userData;
+    const uint32_t n = (uint32_t)(y1 - y0);
+    const uint32_t bandDstW = (job->dstIsPlanar) ? job->dstW : job->realW;
+    const uint32_t bandDstH = (job->dstIsPlanar) ? job->dstH : n;
+    uint8_t *src = (uint8_t *)job->srcBuf + job->srcRowBytes * y0;
+    uint8_t *dst = job->dstBuf + job->dstRowBytes * y0;
+    LXError *err = job->errors + workerIndex;
+    LXSuccess success;
+
+    if (job->failed) return;
+
+    if (job->onSource) {
+        uint8_t *tempBuf = job->tempBufs[workerIndex];
+        if ( !tempBuf) {
+            tempBuf = job->tempBufs[workerIndex] = _lx_malloc(job->tempRowBytes * job->bandH);
+        }
+        LXImageApplyAlphaConversion(job->realW, n, src, job->srcRowBytes, tempBuf, job->tempRowBytes, job->srcPxFormat, job->alphaConversion);
+
+        success = LXPxConvert_Any_(tempBuf, job->realW, n, job->tempRowBytes, job->srcPxFormat,
+                                   dst, bandDstW, bandDstH, job->dstRowBytes, job->dstPxFormat,
+                                   job->srcColorSpaceID, job->dstColorSpaceID, job->srcYCbCrFormatID, job->dstYCbCrFormatID, err);
+    } else {
+        success = LXPxConvert_Any_(src, job->realW, n, job->srcRowBytes, job->srcPxFormat,
+                                   dst, job->realW, n, job->dstRowBytes, job->dstPxFormat,
+                                   job->srcColorSpaceID, job->dstColorSpaceID, job->srcYCbCrFormatID, job->dstYCbCrFormatID, err);
+        if (success) {
+            LXImageApplyAlphaConversion(job->realW, n, dst, job->dstRowBytes, dst, job->dstRowBytes, job->dstPxFormat, job->alphaConversion);
+        }
+    }
+    if ( !success) LXAtomicInc_int32(&job->failed);
+}
+
+LXSuccess LXPxConvert_Any_withAlphaConversion_(const uint8_t * LXRESTRICT aSrcBuffer,
+                                               const uint32_t srcW, const uint32_t srcH, const size_t srcRowBytes,
+                                               const LXPixelFormat srcPxFormat,
+                                               uint8_t * LXRESTRICT aDstBuffer,
+                                               const uint32_t dstW, const uint32_t dstH, const size_t dstRowBytes,
+                                               const LXPixelFormat dstPxFormat,
+                                               LXUInteger srcColorSpaceID,
+                                               LXUInteger dstColorSpaceID,
+                                               LXUInteger srcYCbCrFormatID,
+                                               LXUInteger dstYCbCrFormatID,
+                                               LXUInteger alphaConversion,
+                                               LXError *outError)
+{
+    const uint32_t realW = MIN(srcW, dstW);
+    const uint32_t realH = MIN(srcH, dstH);
+    
+    // formats without alpha are opaque, so there's nothing to do for them
+    if (alphaConversion == kLXAlphaConversion_None || !LXPXF_ISRGBA(srcPxFormat) || realW < 1 || realH < 1) {
+        return LXPxConvert_Any_(aSrcBuffer, srcW, srcH, srcRowBytes, srcPxFormat,
+                                aDstBuffer, dstW, dstH, dstRowBytes, dstPxFormat,
+                                srcColorSpaceID, dstColorSpaceID, srcYCbCrFormatID, dstYCbCrFormatID, outError);
+    }
+    
+    const size_t srcBytesPerPixel = LXBytesPerPixelForPixelFormat(srcPxFormat);
+    const size_t dstBytesPerPixel = LXBytesPerPixelForPixelFormat(dstPxFormat);
+    LXAlphaConversionJob *job = _lx_calloc(1, sizeof(LXAlphaConversionJob));
+    LXSuccess success;
+    LXBool didSetError = NO;
+    LXInteger i;
+
+    job->srcBuf = aSrcBuffer;
+    job->srcRowBytes = srcRowBytes;
+    job->srcPxFormat = srcPxFormat;
+    job->dstBuf = aDstBuffer;
+    job->dstW = dstW;
+    job->dstH = dstH;
+    job->dstRowBytes = dstRowBytes;
+    job->dstPxFormat = dstPxFormat;
+    job->srcColorSpaceID = srcColorSpaceID;
+    job->dstColorSpaceID = dstColorSpaceID;
+    job->srcYCbCrFormatID = srcYCbCrFormatID;
+    job->dstYCbCrFormatID = dstYCbCrFormatID;
+    job->alphaConversion = alphaConversion;
+    job->realW = realW;
+    job->dstIsPlanar = (LXPlaneCountForPixelFormat(dstPxFormat) > 1);
+    job->onSource = ( !LXPXF_ISRGBA(dstPxFormat) || srcBytesPerPixel > dstBytesPerPixel);
+    job->tempRowBytes = (job->onSource) ? LXAlignedRowBytes(realW * srcBytesPerPixel) : 0;
+    // the planar layout depends on the image height, so those are converted in one piece
+    job->bandH = (job->dstIsPlanar) ? realH : MIN(realH, MAX(1, ALPHACONV_BANDBYTES / (realW * MAX(srcBytesPerPixel, dstBytesPerPixel))));
+
+    // very wide rows make bands that the conversion threads by itself, so those are run in order
+    LXParallelApplyToRowBands(realW, realH, job->bandH, ((double)realW * job->bandH >= kLXParallelMinPixels) ? 1 : 0,
+                              alphaConversionBand, job);
+
+    // the first worker's error that is found is returned
+    success = (job->failed) ? NO : YES;
+    for (i = 0; i < kLXParallelMaxWorkers; i++) {
+        if ( !success && !didSetError && outError && job->errors[i].errorID != 0) {
+            *outError = job->errors[i];
+            didSetError = YES;
+        } else {
+            LXErrorDestroyOnStack(job->errors[i]);
+        }
+        _lx_free(job->tempBufs[i]);
+    }
+    if ( !success && !didSetError) {
+        LXErrorSet(outError, 2820, "pixel conversion failed");
+    }
+    _lx_free(job);
+    return success;
+}
+
+
+// the properties passed to the functions below can specify the color space of the caller's data.
+// it's only used for RGB color spaces, so that the data is converted to/from the pixel buffer's color space
+static LXUInteger colorSpaceFromProperties(LXMapPtr properties)
+{
+    LXInteger colorSpaceID = 0;
+    if (properties) {
+        LXMapGetInteger(properties, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, &colorSpaceID);
+    }
+    return (LXColorTransformSupportsColorSpace(colorSpaceID)) ? colorSpaceID : 0;
+}
+
+static LXUInteger alphaConversionFromProperties(LXMapPtr properties)
+{
+    LXInteger alphaConversion = kLXAlphaConversion_None;
+    if (properties) {
+        LXMapGetInteger(properties, kLXPixelBufferConversionKey_AlphaConversion, &alphaConversion);
+    }
+    return alphaConversion;
+}
+
 LXSuccess LXPixelBufferGetDataWithPixelFormatConversion(LXPixelBufferRef srcPixbuf,
                                                         uint8_t *dstBuf,
                                                         const uint32_t dstW, const uint32_t dstH,
@@ -1759,11 +2260,12 @@ LXSuccess LXPixelBufferGetDataWithPixelFormatConversion(LXPixelBufferRef srcPixb
     LXUInteger srcColorSpaceID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding);
     LXUInteger srcYCbCrFormatID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID);
 
-    LXSuccess success = LXPxConvert_Any_(srcBuf, srcW, srcH, srcRowBytes, srcPxFormat,
-                                         dstBuf, dstW, dstH, dstRowBytes, dstPxFormat,
-                                         srcColorSpaceID, 0,
-                                         srcYCbCrFormatID, 0,
-                                         outError);
+    LXSuccess success = LXPxConvert_Any_withAlphaConversion_(srcBuf, srcW, srcH, srcRowBytes, srcPxFormat,
+                                                             dstBuf, dstW, dstH, dstRowBytes, dstPxFormat,
+                                                             srcColorSpaceID, colorSpaceFromProperties(dstProperties),
+                                                             srcYCbCrFormatID, 0,
+                                                             alphaConversionFromProperties(dstProperties),
+                                                             outError);
                      
 	LXPixelBufferUnlockPixels(srcPixbuf);
 
@@ -1854,6 +2356,11 @@ LXSuccess LXPixelBufferGetRegionWithPixelFormatConversion(LXPixelBufferRef srcPi
     const uint32_t srcH = LXPixelBufferGetHeight(srcPixbuf);
     const LXPixelFormat srcPxFormat = LXPixelBufferGetPixelFormat(srcPixbuf);
     
+    if (LXPlaneCountForPixelFormat(srcPxFormat) > 1 || LXPlaneCountForPixelFormat(dstPxFormat) > 1) {
+        LXErrorSet(outError, 2758, "region access is not supported for planar pixel formats");
+        return NO;
+    }
+    
     int32_t regionX = lround(region.x);
     int32_t regionY = lround(region.y);
     int32_t regionW = lround(region.w);
@@ -1888,11 +2395,12 @@ LXSuccess LXPixelBufferGetRegionWithPixelFormatConversion(LXPixelBufferRef srcPi
         LXUInteger srcColorSpaceID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding);
         LXUInteger srcYCbCrFormatID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID);
 
-        success = LXPxConvert_Any_(srcRegionBuf, regionW, regionH, srcRowBytes, srcPxFormat,
-                                             fittedDstBuf, regionW, regionH, dstRowBytes, dstPxFormat,
-                                             srcColorSpaceID, 0,
-                                             srcYCbCrFormatID, 0,
-                                             outError);
+        success = LXPxConvert_Any_withAlphaConversion_(srcRegionBuf, regionW, regionH, srcRowBytes, srcPxFormat,
+                                                       fittedDstBuf, regionW, regionH, dstRowBytes, dstPxFormat,
+                                                       srcColorSpaceID, colorSpaceFromProperties(dstProperties),
+                                                       srcYCbCrFormatID, 0,
+                                                       alphaConversionFromProperties(dstProperties),
+                                                       outError);
                          
         LXPixelBufferUnlockPixels(srcPixbuf);
 
@@ -1922,6 +2430,11 @@ LXSuccess LXPixelBufferWriteRegionWithPixelFormatConversion(LXPixelBufferRef dst
     const uint32_t dstH = LXPixelBufferGetHeight(dstPixbuf);
     const LXPixelFormat dstPxFormat = LXPixelBufferGetPixelFormat(dstPixbuf);
     
+    if (LXPlaneCountForPixelFormat(srcPxFormat) > 1 || LXPlaneCountForPixelFormat(dstPxFormat) > 1) {
+        LXErrorSet(outError, 2758, "region access is not supported for planar pixel formats");
+        return NO;
+    }
+    
     const int32_t regionW = round(region.w);
     const int32_t regionH = round(region.h);
     const int32_t regionX = round(region.x);
@@ -1941,10 +2454,15 @@ LXSuccess LXPixelBufferWriteRegionWithPixelFormatConversion(LXPixelBufferRef dst
 
     uint8_t *dstRegionBuf = dstBuf + (dstRowBytes * regionY) + (dstBytesPerPixel * regionX);
 
-    LXSuccess success = LXPxConvert_Any_(srcRegionBuf, regionW, regionH, srcRowBytes, srcPxFormat,
-                                         dstRegionBuf, regionW, regionH, dstRowBytes, dstPxFormat,
-                                         0, 0, 0, 0,  // last arguments are colorspaceID, etc.
-                                         outError);
+    const LXUInteger srcColorSpaceID = colorSpaceFromProperties(srcProperties);
+    const LXUInteger dstColorSpaceID = (srcColorSpaceID) ? LXPixelBufferGetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding) : 0;
+
+    LXSuccess success = LXPxConvert_Any_withAlphaConversion_(srcRegionBuf, regionW, regionH, srcRowBytes, srcPxFormat,
+                                                             dstRegionBuf, regionW, regionH, dstRowBytes, dstPxFormat,
+                                                             srcColorSpaceID, dstColorSpaceID,
+                                                             0, 0,
+                                                             alphaConversionFromProperties(srcProperties),
+                                                             outError);
                      
 	LXPixelBufferUnlockPixels(dstPixbuf);
     
@@ -1977,10 +2495,15 @@ LXSuccess LXPixelBufferWriteDataWithPixelFormatConversion(LXPixelBufferRef dstPi
 	uint8_t *dstBuf = (uint8_t *)LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, &dstBytesPerPixel, NULL);
     #pragma unused (dstBytesPerPixel, srcBytesPerPixel)
 
-    LXSuccess success = LXPxConvert_Any_(srcBuf, srcW, srcH, srcRowBytes, srcPxFormat,
-                                         dstBuf, dstW, dstH, dstRowBytes, dstPxFormat,
-                                         0, 0, 0, 0,  // last arguments are colorspaceID, etc.
-                                         outError);
+    const LXUInteger srcColorSpaceID = colorSpaceFromProperties(srcProperties);
+    const LXUInteger dstColorSpaceID = (srcColorSpaceID) ? LXPixelBufferGetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding) : 0;
+
+    LXSuccess success = LXPxConvert_Any_withAlphaConversion_(srcBuf, srcW, srcH, srcRowBytes, srcPxFormat,
+                                                             dstBuf, dstW, dstH, dstRowBytes, dstPxFormat,
+                                                             srcColorSpaceID, dstColorSpaceID,
+                                                             0, 0,
+                                                             alphaConversionFromProperties(srcProperties),
+                                                             outError);
                      
 	LXPixelBufferUnlockPixels(dstPixbuf);
 
@@ -2018,6 +2541,8 @@ LXSuccess LXPixelBufferCopyPixelBufferWithPixelFormatConversion(LXPixelBufferRef
     
     LXUInteger srcColorSpaceID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding);
     LXUInteger srcYCbCrFormatID = LXPixelBufferGetIntegerAttachment(srcPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID);
+    LXUInteger dstColorSpaceID = LXPixelBufferGetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding);
+    LXUInteger dstYCbCrFormatID = LXPixelBufferGetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID);
     
     ///LXPrintf("%s -- pixbuf %p -- colorspace %i, yuv format %i\n", __func__, srcPixbuf, srcColorSpaceID, srcYCbCrFormatID);
     
@@ -2026,17 +2551,25 @@ LXSuccess LXPixelBufferCopyPixelBufferWithPixelFormatConversion(LXPixelBufferRef
     uint8_t *srcBuf = (uint8_t *) LXPixelBufferLockPixels(srcPixbuf, &srcRowBytes, NULL, NULL);
     uint8_t *dstBuf = (uint8_t *) LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, NULL, NULL);
     
+    // for YCbCr destinations, the dst attachments determine the matrix, layout and range.
+    // an RGB destination tagged with another RGB color space gets its pixels converted into that space
+    if (dstPxFormat != kLX_YCbCr422_INT8 && LXPlaneCountForPixelFormat(dstPxFormat) < 2) {
+        dstYCbCrFormatID = 0;
+        if ( !LXColorTransformSupportsColorSpace(dstColorSpaceID))
+            dstColorSpaceID = 0;
+    }
+    
     LXSuccess success = LXPxConvert_Any_(srcBuf, srcW, srcH, srcRowBytes, srcPxFormat,
                                          dstBuf, dstW, dstH, dstRowBytes, dstPxFormat,
-                                         srcColorSpaceID, 0,
-                                         srcYCbCrFormatID, 0,
+                                         srcColorSpaceID, dstColorSpaceID,
+                                         srcYCbCrFormatID, dstYCbCrFormatID,
                                          outError);
     
     LXPixelBufferUnlockPixels(srcPixbuf);
     LXPixelBufferUnlockPixels(dstPixbuf);
     
     // the convertAny function doesn't do yCbCr format conversion, so we must pass on this flag
-    if (dstPxFormat == kLX_YCbCr422_INT8 && srcPxFormat == kLX_YCbCr422_INT8) {
+    if (dstPxFormat == srcPxFormat && (srcPxFormat == kLX_YCbCr422_INT8 || LXPlaneCountForPixelFormat(srcPxFormat) > 1)) {
         LXPixelBufferSetIntegerAttachment(dstPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID, srcYCbCrFormatID);
     }
     
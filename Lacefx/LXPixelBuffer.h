@@ -38,11 +38,23 @@ extern "C" {
 // convenience function.
 // all LXPixelFormat values have an integer bytes-per-pixel value,
 // funky padded formats are best dealt when read/written.
+// for the planar YCbCr formats, this returns the size of a luma sample (i.e. 1).
 LXEXPORT LXUInteger LXBytesPerPixelForPixelFormat(LXPixelFormat pf);
 
 // rounds the given value up to a platform-specific boundary (usually 16-byte alignment)
 LXEXPORT size_t LXAlignedRowBytes(size_t rowBytes);
 
+// planar formats store their planes one after another in a single buffer.
+// the first plane's rowBytes is the value given for the whole buffer; chroma planes derive theirs from it
+// (half for 4:2:0 planar, equal for 4:2:0 biplanar and 4:4:4).
+// for non-planar formats the plane count is 1.
+LXEXPORT LXUInteger LXPlaneCountForPixelFormat(LXPixelFormat pf);
+
+// computes plane offsets and rowBytes into the given arrays (which must have room for 3 values; may be NULL).
+// returns the total buffer size in bytes.
+LXEXPORT size_t LXPlaneLayoutForPixelFormat(LXPixelFormat pf, uint32_t w, uint32_t h, size_t rowBytes,
+                                            size_t *outPlaneOffsets, size_t *outPlaneRowBytes);
+
 
 #pragma mark --- LXPixelBuffer public API methods ---
 
@@ -93,6 +105,12 @@ LXEXPORT void LXPixelBufferUnlockPixels(LXPixelBufferRef buffer);
 
 LXEXPORT void LXPixelBufferSetLockCallbacks(LXPixelBufferRef buffer, LXPixelBufferLockCallbacks *callbacks, void *userData);
 
+// -- planar formats --
+// the base address is only valid while the pixels are locked
+LXEXPORT LXUInteger LXPixelBufferGetPlaneCount(LXPixelBufferRef buffer);
+LXEXPORT LXSize LXPixelBufferGetSizeOfPlane(LXPixelBufferRef buffer, LXUInteger plane);
+LXEXPORT uint8_t *LXPixelBufferGetBaseAddressOfPlane(LXPixelBufferRef buffer, LXUInteger plane, size_t *outRowBytes);
+
 LXEXPORT void LXPixelBufferInvalidateCaches(LXPixelBufferRef buffer);
 
 // -- simple custom metadata --
@@ -120,6 +138,9 @@ LXEXPORT LXSuccess LXPixelBufferCopyPixelBufferWithPixelFormatConversion(LXPixel
 // functions for writing from / reading into a custom buffer.
 // "region" versions are useful for e.g. tiled rendering.
 // the 'properties' argument is intended to provide an extension mechanism (e.g. for specifying the colorspace of the data).
+// if it contains kLXPixelBufferAttachmentKey_ColorSpaceEncoding with an RGB color space and the pixel buffer is tagged with another one,
+// the pixels are converted between the two (see LXColorTransform.h).
+// kLXPixelBufferConversionKey_AlphaConversion can be used to premultiply or unpremultiply the pixels in the same pass.
 //
 LXEXPORT LXSuccess LXPixelBufferWriteDataWithPixelFormatConversion(LXPixelBufferRef dstPixbuf,
                                                                 const uint8_t *srcBuf,
@@ -155,6 +176,21 @@ LXEXPORT LXSuccess LXPixelBufferWriteAsFileToPath(LXPixelBufferRef pixbuf, LXUni
 LXEXPORT_CONSTVAR char * const kLXPixelBufferAttachmentKey_ColorSpaceEncoding;  // an LXColorSpaceEncoding value
 LXEXPORT_CONSTVAR char * const kLXPixelBufferAttachmentKey_YCbCrPixelFormatID;
 
+// conversion keys for the properties of the pixel format conversion functions
+//
+LXEXPORT_CONSTVAR char * const kLXPixelBufferConversionKey_AlphaConversion;  // integer; a kLXAlphaConversion value (see LXImageFunctions.h)
+
+// values for the YCbCrPixelFormatID attachment.
+// YUY2 is a hack to allow us to put YUY2 format data into LXPixelBuffers on Win32 where it's a common format from DirectShow;
+// Lacefx's default YCbCr layout is called '2vuy' on Mac, 'UYVY' on Win32.
+// the full range flag can be combined with either value (it also applies to the planar formats).
+enum {
+    kLX_YCbCrFormat_2vuy = 0,
+    kLX_YCbCrFormat_YUY2 = 1,
+    
+    kLX_YCbCrFormatFlag_FullRange = 0x100   // data uses 0-255 levels as in JFIF instead of 16-235 video levels
+};
+
 // format request keys (can be used for export)
 //
 LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_AllowAlpha;
@@ -162,6 +198,19 @@ LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_AllowYUV;
 LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_FileFormatID;
 LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel;
 LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_CompressionQuality;
+LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_FloatSamples;       // bool; 16 bits per channel is written as half float instead of integer
+
+// TIFF export keys
+LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_TIFFCompression;    // one of the values below
+LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_TIFFPredictor;      // bool; default is YES when compression is used
+LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_TIFFRowsPerStrip;   // integer; 0 picks a value suited for parallel compression
+LXEXPORT_CONSTVAR char * const kLXPixelBufferFormatRequestKey_TIFFTileSize;       // integer; if non-zero, tiles of this size are written instead of strips
+
+enum {
+    kLXTIFFCompression_None = 0,
+    kLXTIFFCompression_LZW,        // compressed by libTIFF on the calling thread, one strip or tile at a time
+    kLXTIFFCompression_Deflate     // compressed in parallel
+};
 
 #ifdef __cplusplus
 }
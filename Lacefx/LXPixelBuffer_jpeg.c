@@ -38,48 +38,6 @@
 #endif
 
 
-void LXPxConvert_YCbCr420_planar_to_422_convertLevelsFrom255(
-                                                const LXUInteger w, const LXUInteger h,
-                                                uint8_t * LXRESTRICT srcBuf_y, const size_t srcRowBytes_y,
-                                                uint8_t * LXRESTRICT srcBuf_Cb,
-                                                uint8_t * LXRESTRICT srcBuf_Cr,
-                                                const size_t srcRowBytes_chroma,
-                                                uint8_t * LXRESTRICT dstBuf, const size_t dstRowBytes,
-                                                const LXBool convertLevelsFrom255)
-{
-    const LXUInteger halfW = w/2;
-
-    // for 255->235 levels conversion (JFIF stores full-range YCbCr data)
-    ///const float lumaBase = 16;
-    /*const float lumaScale = (219.0 / 255.0);
-    const float chromaBase = 16;
-    const float chromaScale = (224.0 / 255.0);*/
-    // TODO: convertLevelsFrom255 is not implemented yet
-    
-    
-    LXUInteger y;
-    for (y = 0; y < h; y++) {
-        const LXUInteger chromaY = y/2;
-
-        LXUInteger x;
-        uint32_t *dst = (uint32_t *)(dstBuf + dstRowBytes * y);        
-        uint8_t *src_y = srcBuf_y + srcRowBytes_y * y;
-        uint8_t *src_Cb = srcBuf_Cb + srcRowBytes_chroma * chromaY;
-        uint8_t *src_Cr = srcBuf_Cr + srcRowBytes_chroma * chromaY;
-        
-        for (x = 0; x < halfW; x++) {
-            uint32_t y0 = src_y[0];
-            uint32_t y1 = src_y[1];
-            src_y += 2;
-            uint32_t cb = *src_Cb++;
-            uint32_t cr = *src_Cr++;
-            
-            *dst = MAKEPX_2VUY(y0, y1, cb, cr);
-            dst++;
-        }
-    }
-}
-
 void LXPxConvert_YCbCr422_to_420_planar_padY_convertLevelsTo255(
                                                 const LXUInteger w, 
                                                 uint8_t * LXRESTRICT srcBuf, const LXUInteger srcH, const size_t srcRowBytes,
@@ -303,8 +261,187 @@ static LXSuccess writeJPEGImage_YCbCr422_int8(LXPixelBufferRef pixbuf,
     return YES;
 }
 
-static LXPixelBufferRef readJPEGImage_YCbCr422_int8(const uint8_t *jpegData, size_t jpegDataLen, LXBool convertLevelsFrom255,
-                                                    LXError *outError)
+// writes the planar YCbCr formats using raw data input, so the chroma planes are compressed as-is.
+// packed 4:2:2 data is also written with its own sampling, by splitting it into planes.
+// planes are passed to libjpeg directly when they're already padded to whole DCT blocks and no levels conversion is needed;
+// otherwise rows are copied into temp storage with edge replication.
+static LXSuccess writeJPEGImage_YCbCr_planar(LXPixelBufferRef pixbuf,
+                                             LXUnibuffer unipath,
+                                             uint8_t **optionalBuffer, unsigned long *optionalBufferSize,  // size written is returned here
+                                             LXFloat jpegQualityF,
+                                             LXBool convertLevelsTo255,
+                                             LXError *outError)
+{
+    const LXUInteger w = LXPixelBufferGetWidth(pixbuf);
+    const LXUInteger h = LXPixelBufferGetHeight(pixbuf);
+    const LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+    const LXBool isPacked422 = (pxFormat == kLX_YCbCr422_INT8);
+    const LXBool isSubsampled = (pxFormat != kLX_YCbCr444_planar_INT8);
+    const LXBool isSubsampledVertically = (isSubsampled && !isPacked422);
+    const LXBool isInterleavedChroma = (pxFormat == kLX_YCbCr420_biplanar_INT8);
+
+    if (LXPixelBufferGetPlaneCount(pixbuf) < 2 && !isPacked422) {
+        LXErrorSet(outError, 1812, "invalid pixel format specified for planar JPEG writer");
+        return NO;
+    }
+    
+    const LXBool dataIsFullRange = (LXPixelBufferGetIntegerAttachment(pixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID) & kLX_YCbCrFormatFlag_FullRange) ? YES : NO;
+    const LXBool needsLevels = (convertLevelsTo255 && !dataIsFullRange);
+    
+    FILE *outfile = NULL;
+    if (unipath.unistr) {
+        if ( !LXOpenFileForWritingWithUnipath(unipath.unistr, unipath.numOfChar16, (LXFilePtr *)&outfile)) {
+            LXErrorSet(outError, 1760, "could not open file");
+            return NO;
+        }
+    }
+
+    if ( !LXPixelBufferLockPixels(pixbuf, NULL, NULL, outError)) {
+        if (outfile) _lx_fclose(outfile);
+        return NO;
+    }
+    
+    uint8_t *srcPlanes[3];
+    size_t srcRowBytes[3];
+    srcPlanes[0] = LXPixelBufferGetBaseAddressOfPlane(pixbuf, 0, &srcRowBytes[0]);
+    if (isPacked422) {
+        // all components are read from the packed rows (byte order Cb Y0 Cr Y1)
+        srcPlanes[1] = srcPlanes[2] = srcPlanes[0];
+        srcRowBytes[1] = srcRowBytes[2] = srcRowBytes[0];
+    } else {
+        srcPlanes[1] = LXPixelBufferGetBaseAddressOfPlane(pixbuf, 1, &srcRowBytes[1]);
+        srcPlanes[2] = (isInterleavedChroma) ? srcPlanes[1] : LXPixelBufferGetBaseAddressOfPlane(pixbuf, 2, &srcRowBytes[2]);
+        if (isInterleavedChroma) srcRowBytes[2] = srcRowBytes[1];
+    }
+    
+    // for 235->255 levels conversion (JFIF stores full-range YCbCr data)
+    uint8_t levelsLut[2][256];
+    if (needsLevels) {
+        LXInteger i;
+        for (i = 0; i < 256; i++) {
+            double yv = ((double)i - kLX_Y219_offset) * (255.0 / kLX_Y219_scale);
+            double cv = ((double)i - kLX_C219_offset) * (255.0 / kLX_C219_scale) + 128.0;
+            levelsLut[0][i] = (uint8_t)MIN(255.0, MAX(0.0, yv + 0.5));
+            levelsLut[1][i] = (uint8_t)MIN(255.0, MAX(0.0, cv + 0.5));
+        }
+    }
+
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    
+	cinfo.image_width = w;
+	cinfo.image_height = h;
+	cinfo.input_components = 3;
+	jpeg_set_defaults(&cinfo);
+
+	jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+    
+    jpeg_set_quality(&cinfo, MAX(0, MIN(100, (int)(jpegQualityF * 100))), FALSE);  // last argument indicates baseline compatibility
+    
+    cinfo.dct_method = JDCT_FLOAT;  // seems to be faster on modern x86
+
+	cinfo.raw_data_in = TRUE;
+	cinfo.comp_info[0].h_samp_factor = (isSubsampled) ? 2 : 1;
+	cinfo.comp_info[0].v_samp_factor = (isSubsampledVertically) ? 2 : 1;
+	cinfo.comp_info[1].h_samp_factor = 1;
+	cinfo.comp_info[1].v_samp_factor = 1;
+	cinfo.comp_info[2].h_samp_factor = 1;
+	cinfo.comp_info[2].v_samp_factor = 1;
+
+    // set up destination and start compress
+    if ( !outfile) {
+        jpeg_mem_dest(&cinfo, optionalBuffer, optionalBufferSize);
+    } else {
+        jpeg_stdio_dest(&cinfo, outfile);
+    }
+    jpeg_start_compress(&cinfo, TRUE);  // last argument indicates "complete interchange JPEG"
+    
+    const LXInteger rowsPerPass = cinfo.max_v_samp_factor * DCTSIZE;
+    LXInteger compW[3], compH[3], paddedW[3];
+    LXBool isDirect[3];
+    uint8_t *tempRows[3] = { NULL, NULL, NULL };
+    LXInteger i, j, x, y;
+    
+    for (i = 0; i < 3; i++) {
+        compW[i] = (i > 0 && isSubsampled) ? (w + 1) / 2 : w;
+        compH[i] = (i > 0 && isSubsampledVertically) ? (h + 1) / 2 : h;
+        paddedW[i] = cinfo.comp_info[i].width_in_blocks * DCTSIZE;
+        
+        isDirect[i] = ( !needsLevels && !isPacked422 && !(i > 0 && isInterleavedChroma)
+                       && paddedW[i] == compW[i] && srcRowBytes[i] >= (size_t)paddedW[i]);
+        if ( !isDirect[i]) {
+            tempRows[i] = _lx_malloc(rowsPerPass * paddedW[i]);
+        }
+    }
+    
+    JSAMPROW rowPtrs[3][16];
+    JSAMPARRAY planePtrs[3] = { rowPtrs[0], rowPtrs[1], rowPtrs[2] };
+    
+    for (y = 0; y < h; y += rowsPerPass) {
+        const LXInteger pass = y / rowsPerPass;
+        
+        for (i = 0; i < 3; i++) {
+            const LXInteger compRows = cinfo.comp_info[i].v_samp_factor * DCTSIZE;
+            
+            for (j = 0; j < compRows; j++) {
+                const LXInteger row = MIN(pass * compRows + j, compH[i] - 1);  // bottom padding repeats the last row
+                const uint8_t *src = srcPlanes[i] + srcRowBytes[i] * row;
+                
+                if (isDirect[i]) {
+                    rowPtrs[i][j] = (JSAMPROW)src;
+                    continue;
+                }
+                
+                uint8_t *dst = tempRows[i] + paddedW[i] * j;
+                if (isPacked422) {
+                    if (i == 0) {
+                        for (x = 0; x < compW[i]; x++)  dst[x] = src[(x >> 1) * 4 + 1 + (x & 1) * 2];
+                    } else {
+                        const uint8_t *s = src + (i - 1) * 2;
+                        for (x = 0; x < compW[i]; x++)  dst[x] = s[x*4];
+                    }
+                } else if (isInterleavedChroma && i > 0) {
+                    const uint8_t *s = src + (i - 1);
+                    for (x = 0; x < compW[i]; x++)  dst[x] = s[x*2];
+                } else {
+                    memcpy(dst, src, compW[i]);
+                }
+                if (needsLevels) {
+                    const uint8_t *lut = levelsLut[(i > 0) ? 1 : 0];
+                    for (x = 0; x < compW[i]; x++)  dst[x] = lut[dst[x]];
+                }
+                for (x = compW[i]; x < paddedW[i]; x++) {
+                    dst[x] = dst[compW[i] - 1];
+                }
+                rowPtrs[i][j] = dst;
+            }
+        }
+        
+        jpeg_write_raw_data(&cinfo, planePtrs, rowsPerPass);
+    }
+    
+    jpeg_finish_compress(&cinfo);
+    
+    if (outfile)
+        _lx_fclose(outfile);
+    
+    jpeg_destroy_compress(&cinfo);
+
+    for (i = 0; i < 3; i++)  _lx_free(tempRows[i]);
+    
+    LXPixelBufferUnlockPixels(pixbuf);
+    return YES;
+}
+
+// reads the raw YCbCr planes straight into a pixel buffer of the matching layout:
+// 4:2:0 files become kLX_YCbCr420_planar_INT8, 4:4:4 files kLX_YCbCr444_planar_INT8 and 4:2:2 files kLX_YCbCr422_INT8.
+// no levels conversion is done; the buffer is tagged as full range unless the caller says it was written with video levels.
+static LXPixelBufferRef readJPEGImage_YCbCr_raw(const uint8_t *jpegData, size_t jpegDataLen, LXBool dataIsVideoLevels,
+                                                LXBool *outIsUnsupportedSampling,
+                                                LXError *outError)
 {
     if ( !jpegData || jpegDataLen < 1) return NULL;
     
@@ -323,68 +460,149 @@ static LXPixelBufferRef readJPEGImage_YCbCr422_int8(const uint8_t *jpegData, siz
     cinfo.do_block_smoothing = FALSE;
     cinfo.dct_method = JDCT_FLOAT;  // seems to be fastest on modern x86
 
-	/*cinfo.comp_info[0].h_samp_factor = 2;
-	cinfo.comp_info[0].v_samp_factor = 2;
-	cinfo.comp_info[1].h_samp_factor = 1;
-	cinfo.comp_info[1].v_samp_factor = 1;
-	cinfo.comp_info[2].h_samp_factor = 1;
-	cinfo.comp_info[2].v_samp_factor = 1;*/
-
     jpeg_start_decompress(&cinfo);
     
-    LXInteger w = cinfo.output_width;
-    LXInteger h = cinfo.output_height;
-    LXInteger numChannels = cinfo.output_components;
+    const LXInteger w = cinfo.output_width;
+    const LXInteger h = cinfo.output_height;
+    const jpeg_component_info *comps = cinfo.comp_info;
+    LXPixelFormat pxFormat = 0;
     LXPixelBufferRef newPixbuf = NULL;
     
+    if (cinfo.num_components == 3
+            && comps[1].h_samp_factor == 1 && comps[1].v_samp_factor == 1
+            && comps[2].h_samp_factor == 1 && comps[2].v_samp_factor == 1) {
+        if (comps[0].h_samp_factor == 2 && comps[0].v_samp_factor == 2)
+            pxFormat = kLX_YCbCr420_planar_INT8;
+        else if (comps[0].h_samp_factor == 1 && comps[0].v_samp_factor == 1)
+            pxFormat = kLX_YCbCr444_planar_INT8;
+        else if (comps[0].h_samp_factor == 2 && comps[0].v_samp_factor == 1)
+            pxFormat = kLX_YCbCr422_INT8;
+    }
+    
     if (w < 1 || h < 1) {
         LXErrorSet(outError, 1622, "could not read JPEG data");
-    } else if (numChannels < 3 || cinfo.comp_info[0].h_samp_factor != 2 || cinfo.comp_info[1].h_samp_factor != 1 || cinfo.comp_info[1].v_samp_factor != 1) {
-        LXErrorSet(outError, 1622, "could not read JPEG data (component format is not YCC, or sampling is not 4:2:0");
-    } else {
+        jpeg_abort_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
+    }
+    if (pxFormat == 0) {
+        if (outIsUnsupportedSampling) *outIsUnsupportedSampling = YES;
+        LXErrorSet(outError, 1623, "could not read JPEG data as YCbCr (component format is not YCC, or sampling is not 4:2:0, 4:2:2 or 4:4:4)");
+        jpeg_abort_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
+    }
+    
+    // libjpeg writes full DCT blocks, so rows must be padded to the blocks' width
+    const size_t paddedW_y = comps[0].width_in_blocks * DCTSIZE;
+    const size_t paddedW_chroma = comps[1].width_in_blocks * DCTSIZE;
+    const LXInteger rowsPerPass = cinfo.max_v_samp_factor * DCTSIZE;
+    
+    uint8_t *planes[3] = { NULL, NULL, NULL };
+    size_t planeRowBytes[3] = { 0, 0, 0 };
+    LXInteger planeH[3] = { h, h, h };
+    uint8_t *tempData = NULL;
+    uint8_t *scratchRow = NULL;
+    
+    if (pxFormat == kLX_YCbCr422_INT8) {
         newPixbuf = LXPixelBufferCreate(NULL, w, h, kLX_YCbCr422_INT8, outError);
         
-        size_t dstRowBytes = 0;
-        uint8_t *dstBuf = (newPixbuf) ? LXPixelBufferLockPixels(newPixbuf, &dstRowBytes, NULL, outError) : NULL;
+        // decode into temp planes and interleave (4:2:2 is already the packed format's sampling)
+        const size_t rb = LXAlignedRowBytes(MAX(paddedW_y, paddedW_chroma));
+        tempData = _lx_malloc(3 * rowsPerPass * rb);
+        LXInteger i;
+        for (i = 0; i < 3; i++) {
+            planes[i] = tempData + i * rowsPerPass * rb;
+            planeRowBytes[i] = rb;
+        }
+    } else {
+        size_t rowBytes;
+        if (pxFormat == kLX_YCbCr420_planar_INT8) {
+            rowBytes = (MAX(paddedW_y, 2 * paddedW_chroma) + 31) & ~31;
+            planeH[1] = planeH[2] = (h + 1) / 2;
+        } else {
+            rowBytes = (MAX(paddedW_y, paddedW_chroma) + 15) & ~15;
+        }
+        newPixbuf = LXPixelBufferCreateWithRowBytes(NULL, w, h, pxFormat, rowBytes, outError);
         
-        if (dstBuf) {
-            size_t srcRowBytes_y = LXAlignedRowBytes(w);
-            size_t srcRowBytes_chroma = LXAlignedRowBytes(w / 2);
-            uint8_t *tempDataY = _lx_malloc(16 * (srcRowBytes_y + 2*srcRowBytes_chroma));
-            uint8_t *tempDataCb = tempDataY + 16*srcRowBytes_y;
-            uint8_t *tempDataCr = tempDataCb + 16*srcRowBytes_chroma;
-    
-            ///LXPrintf("... %s: size %i * %i, nc %i -- chroma rowbytes %i -- dst rb %i\n", __func__, w, h, numChannels, srcRowBytes_chroma, dstRowBytes);
-
-            JSAMPROW Y_ptr[16], Cb_ptr[16], Cr_ptr[16];
-            LXUInteger y;
-            for (y = 0; y < 16; y++) {
-                Y_ptr[y] = tempDataY + y*srcRowBytes_y;
-                Cb_ptr[y] = tempDataCb + y*srcRowBytes_chroma;
-                Cr_ptr[y] = tempDataCr + y*srcRowBytes_chroma;
+        if (newPixbuf && LXPixelBufferLockPixels(newPixbuf, NULL, NULL, outError)) {
+            LXInteger i;
+            for (i = 0; i < 3; i++) {
+                planes[i] = LXPixelBufferGetBaseAddressOfPlane(newPixbuf, i, &planeRowBytes[i]);
             }
-            JSAMPARRAY planes[3] = { Y_ptr, Cb_ptr, Cr_ptr };
-            
-            for (y = 0; y < h; y += 16) {
-                LXUInteger numLines = (y + 16 <= h) ? 16 : (h - y);
+            // rows past the end of the image are decoded into this
+            scratchRow = _lx_malloc(rowBytes);
+        }
+    }
+    
+    if (newPixbuf && planes[0]) {
+        JSAMPROW rowPtrs[3][16];
+        JSAMPARRAY planePtrs[3] = { rowPtrs[0], rowPtrs[1], rowPtrs[2] };
+        size_t dstRowBytes = 0;
+        uint8_t *dstBuf = (tempData) ? LXPixelBufferLockPixels(newPixbuf, &dstRowBytes, NULL, outError) : NULL;
+        LXInteger y, i, j;
         
-                jpeg_read_raw_data(&cinfo, planes, 16);
-                                
-                uint8_t *dst = dstBuf + dstRowBytes*y;
-                
-                LXPxConvert_YCbCr420_planar_to_422_convertLevelsFrom255(w, numLines,
-                                                                        tempDataY, srcRowBytes_y,
-                                                                        tempDataCb, tempDataCr, srcRowBytes_chroma,
-                                                                        dst, dstRowBytes,
-                                                                        convertLevelsFrom255);
+        for (y = 0; y < h; y += rowsPerPass) {
+            const LXInteger pass = y / rowsPerPass;
+            
+            for (i = 0; i < 3; i++) {
+                const LXInteger compRows = comps[i].v_samp_factor * DCTSIZE;
+                for (j = 0; j < compRows; j++) {
+                    if (tempData) {
+                        rowPtrs[i][j] = planes[i] + planeRowBytes[i] * j;
+                    } else {
+                        const LXInteger row = pass * compRows + j;
+                        rowPtrs[i][j] = (row < planeH[i]) ? (planes[i] + planeRowBytes[i] * row) : scratchRow;
+                    }
+                }
             }
             
-            _lx_free(tempDataY);
-            LXPixelBufferUnlockPixels(newPixbuf);
+            jpeg_read_raw_data(&cinfo, planePtrs, rowsPerPass);
+            
+            if (dstBuf) {
+                const LXInteger numLines = MIN(rowsPerPass, h - y);
+                const LXInteger halfW = w / 2;
+                const LXBool hasOddPixel = (w & 1);
+                for (j = 0; j < numLines; j++) {
+                    uint32_t *dst = (uint32_t *)(dstBuf + dstRowBytes * (y + j));
+                    const uint8_t *src_y = rowPtrs[0][j];
+                    const uint8_t *src_Cb = rowPtrs[1][j];
+                    const uint8_t *src_Cr = rowPtrs[2][j];
+                    LXInteger x;
+                    for (x = 0; x < halfW; x++) {
+                        uint32_t y0 = src_y[2*x];
+                        uint32_t y1 = src_y[2*x + 1];
+                        uint32_t cb = src_Cb[x];
+                        uint32_t cr = src_Cr[x];
+                        dst[x] = MAKEPX_2VUY(y0, y1, cb, cr);
+                    }
+                    // the last pixel of an odd width is alone in its pair, so it's repeated as the second luma sample
+                    if (hasOddPixel) {
+                        uint32_t y0 = src_y[2*halfW];
+                        uint32_t cb = src_Cb[halfW];
+                        uint32_t cr = src_Cr[halfW];
+                        dst[halfW] = MAKEPX_2VUY(y0, y0, cb, cr);
+                    }
+                }
+            }
         }
+        
+        LXPixelBufferUnlockPixels(newPixbuf);
+        
+        LXPixelBufferSetIntegerAttachment(newPixbuf, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, kLX_YCbCr_Rec601);
+        LXPixelBufferSetIntegerAttachment(newPixbuf, kLXPixelBufferAttachmentKey_YCbCrPixelFormatID,
+                                                     kLX_YCbCrFormat_2vuy | ((dataIsVideoLevels) ? 0 : kLX_YCbCrFormatFlag_FullRange));
+        jpeg_finish_decompress(&cinfo);
+    }
+    else {
+        LXPixelBufferRelease(newPixbuf);
+        newPixbuf = NULL;
+        jpeg_abort_decompress(&cinfo);
     }
+    
+    _lx_free(tempData);
+    _lx_free(scratchRow);
 
-    jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
     return newPixbuf;
 }
@@ -563,6 +781,10 @@ LXSuccess LXPixelBufferWriteAsJPEGImageToPath(LXPixelBufferRef pixbuf, LXUnibuff
             retVal = writeJPEGImage_YCbCr422_int8(pixbuf, unipath, NULL, NULL, jpegQuality,
                                                   YES /* convert levels to 255 */, outError);
         }
+        else if (LXPixelBufferGetPlaneCount(pixbuf) > 1 || pxFormat == kLX_YCbCr422_INT8) {
+            retVal = writeJPEGImage_YCbCr_planar(pixbuf, unipath, NULL, NULL, jpegQuality,
+                                                 YES /* convert levels to 255 */, outError);
+        }
         else {
             tempPixbuf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_INT8, outError);
             
@@ -588,8 +810,8 @@ LXSuccess LXPixelBufferWriteAsJPEGImageInMemory_raw422_(LXPixelBufferRef pixbuf,
     const LXUInteger h = LXPixelBufferGetHeight(pixbuf);
     LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
     
-    if (pxFormat != kLX_YCbCr422_INT8) {
-        LXErrorSet(outError, 1812, "invalid pixel format specified for in-memory JPEG writer (ycbcr422 expected)");
+    if (pxFormat != kLX_YCbCr422_INT8 && LXPixelBufferGetPlaneCount(pixbuf) < 2) {
+        LXErrorSet(outError, 1812, "invalid pixel format specified for in-memory JPEG writer (ycbcr422 or planar ycbcr expected)");
         return NO;
     }
     
@@ -614,10 +836,19 @@ LXSuccess LXPixelBufferWriteAsJPEGImageInMemory_raw422_(LXPixelBufferRef pixbuf,
     }
     //if ( !is601) LXPrintf("%s: data is not 601, will convert levels\n", __func__);
     
-    LXBool retVal = writeJPEGImage_YCbCr422_int8(pixbuf, LXMakeUnibuffer(0, NULL),
+    // 4:2:2 is written as 4:2:0 when the width allows it; other widths keep their 4:2:2 sampling
+    LXBool retVal;
+    if (pxFormat == kLX_YCbCr422_INT8 && (w % 16 == 0)) {
+        retVal = writeJPEGImage_YCbCr422_int8(pixbuf, LXMakeUnibuffer(0, NULL),
+                                                    &buffer, &bufferSize,
+                                                    jpegQuality,
+                                                    (writeRaw601) ? NO : YES /* convert levels to 255 */, outError);
+    } else {
+        retVal = writeJPEGImage_YCbCr_planar(pixbuf, LXMakeUnibuffer(0, NULL),
                                                     &buffer, &bufferSize,
                                                     jpegQuality,
                                                     (writeRaw601) ? NO : YES /* convert levels to 255 */, outError);
+    }
 
     if (buffer != *outBuffer) {
         LXPrintf("** %s: libjpeg did realloc our buffer (this is not always desirable due to potential allocator differences -- new size %ld, prev %ld)\n",
@@ -644,9 +875,42 @@ LXPixelBufferRef LXPixelBufferCreateFromJPEGImageInMemory(const uint8_t *jpegDat
             LXMapGetBool(properties, "uses601VideoLevels", &is601);
         }
         
-        return readJPEGImage_YCbCr422_int8(jpegData, jpegDataLen, (is601) ? NO : YES, outError);
+        LXBool isUnsupportedSampling = NO;
+        LXPixelBufferRef pixbuf = readJPEGImage_YCbCr_raw(jpegData, jpegDataLen, is601, &isUnsupportedSampling, outError);
+        
+        // e.g. grayscale or 4:1:1 data can still be read through libjpeg's own color conversion
+        if ( !pixbuf && isUnsupportedSampling) {
+            if (outError) LXErrorDestroyOnStack(*outError);
+            pixbuf = readJPEGImage_RGBA_int8(jpegData, jpegDataLen, outError);
+        }
+        return pixbuf;
     } else {
         return readJPEGImage_RGBA_int8(jpegData, jpegDataLen, outError);
     }
 }
 
+LXPixelBufferRef LXPixelBufferCreateFromJPEGImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError)
+{
+    LXFilePtr file = NULL;
+    if ( !LXOpenFileForReadingWithUnipath(unipath.unistr, unipath.numOfChar16, &file)) {
+        LXErrorSet(outError, 1760, "could not open file");
+        return NULL;
+    }
+
+    _lx_fseek64(file, 0, SEEK_END);
+    size_t fileLen = (size_t)_lx_ftell64(file);
+    uint8_t *fileData = _lx_malloc(fileLen);
+
+    _lx_fseek64(file, 0, SEEK_SET);
+    size_t bytesRead = _lx_fread(fileData, 1, fileLen, file);
+    _lx_fclose(file);
+
+    LXPixelBufferRef pixbuf = NULL;
+    if (bytesRead != fileLen || bytesRead == 0) {
+        LXErrorSet(outError, 1761, "error reading from file");
+    } else {
+        pixbuf = LXPixelBufferCreateFromJPEGImageInMemory(fileData, fileLen, properties, outError);
+    }
+    _lx_free(fileData);
+    return pixbuf;
+}
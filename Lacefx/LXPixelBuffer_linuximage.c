@@ -0,0 +1,175 @@
+/*
+ *  LXPixelBuffer_linuximage.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXBasicTypes.h"
+#include "LXPixelBuffer.h"
+#include "LXPixelBuffer_priv.h"
+#include "LXStringUtils.h"
+#include "LXFileHandlers.h"
+#include "LXColorFunctions.h"
+
+/*
+  Linux has no system image API, so the native hooks only report an error.
+  LXPixelBuffer.c handles the formats that have built-in codecs (PNG, JPEG, DPX) before it calls them.
+*/
+
+#if defined(LXPLATFORM_LINUX)
+
+#include <stdio.h>
+
+
+#pragma mark --- unicode ---
+
+char *LXStrCreateUTF8_from_UTF16(const char16_t *utf16Str, size_t utf16Len, size_t *outUTF8Len)
+{
+    if (outUTF8Len) *outUTF8Len = 0;
+    if ( !utf16Str) return NULL;
+
+    // a UTF-16 code unit encodes to at most 3 bytes (surrogate pairs are 4 bytes for 2 units)
+    char *utf8Str = (char *) _lx_malloc(utf16Len * 3 + 1);
+    uint8_t *d = (uint8_t *)utf8Str;
+    size_t i;
+
+    for (i = 0; i < utf16Len; i++) {
+        uint32_t c = utf16Str[i];
+
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < utf16Len && utf16Str[i+1] >= 0xdc00 && utf16Str[i+1] < 0xe000) {
+            c = 0x10000 + ((c - 0xd800) << 10) + (utf16Str[i+1] - 0xdc00);
+            i++;
+        }
+        else if (c >= 0xd800 && c < 0xe000) {
+            c = 0xfffd;  // unpaired surrogate
+        }
+
+        if (c < 0x80) {
+            *d++ = c;
+        } else if (c < 0x800) {
+            *d++ = 0xc0 | (c >> 6);
+            *d++ = 0x80 | (c & 0x3f);
+        } else if (c < 0x10000) {
+            *d++ = 0xe0 | (c >> 12);
+            *d++ = 0x80 | ((c >> 6) & 0x3f);
+            *d++ = 0x80 | (c & 0x3f);
+        } else {
+            *d++ = 0xf0 | (c >> 18);
+            *d++ = 0x80 | ((c >> 12) & 0x3f);
+            *d++ = 0x80 | ((c >> 6) & 0x3f);
+            *d++ = 0x80 | (c & 0x3f);
+        }
+    }
+    *d = 0;
+
+    if (outUTF8Len) *outUTF8Len = (char *)d - utf8Str;
+    return utf8Str;
+}
+
+char16_t *LXStrCreateUTF16_from_UTF8(const char *utf8Str, size_t utf8Len, size_t *outUTF16Len)
+{
+    if (outUTF16Len) *outUTF16Len = 0;
+    if ( !utf8Str) return NULL;
+
+    char16_t *utf16Str = (char16_t *) _lx_malloc((utf8Len + 1) * sizeof(char16_t));
+    const uint8_t *s = (const uint8_t *)utf8Str;
+    const uint8_t *end = s + utf8Len;
+    size_t n = 0;
+
+    while (s < end) {
+        uint32_t c = *s++;
+        int extra = 0;
+
+        if (c < 0x80)               extra = 0;
+        else if ((c & 0xe0) == 0xc0) { c &= 0x1f;  extra = 1; }
+        else if ((c & 0xf0) == 0xe0) { c &= 0x0f;  extra = 2; }
+        else if ((c & 0xf8) == 0xf0) { c &= 0x07;  extra = 3; }
+        else { utf16Str[n++] = 0xfffd;  continue; }
+
+        while (extra > 0 && s < end && (*s & 0xc0) == 0x80) {
+            c = (c << 6) | (*s++ & 0x3f);
+            extra--;
+        }
+        if (extra > 0 || c > 0x10ffff || (c >= 0xd800 && c < 0xe000)) {
+            c = 0xfffd;
+        }
+
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            utf16Str[n++] = 0xd800 + (c >> 10);
+            utf16Str[n++] = 0xdc00 + (c & 0x3ff);
+        } else {
+            utf16Str[n++] = c;
+        }
+    }
+    utf16Str[n] = 0;
+
+    if (outUTF16Len) *outUTF16Len = n;
+    return utf16Str;
+}
+
+
+
+#pragma mark --- files ---
+
+static LXSuccess openFileWithUnipath(const char16_t *pathBuf, size_t pathLen, const char *mode, LXFilePtr *outFile)
+{
+    FILE *file = NULL;
+    char *utf8Path = LXStrCreateUTF8_from_UTF16(pathBuf, pathLen, NULL);
+
+    if (utf8Path) {
+        file = fopen(utf8Path, mode);
+        _lx_free(utf8Path);
+    }
+
+    if (outFile) *outFile = file;
+    return (file) ? YES : NO;
+}
+
+// Linux implementation of this platform-independent wrapper
+LXSuccess LXOpenFileForReadingWithUnipath(const char16_t *pathBuf, size_t pathLen, LXFilePtr *outFile)
+{
+    return openFileWithUnipath(pathBuf, pathLen, "rb", outFile);
+}
+
+LXSuccess LXOpenFileForWritingWithUnipath(const char16_t *pathBuf, size_t pathLen, LXFilePtr *outFile)
+{
+    return openFileWithUnipath(pathBuf, pathLen, "wb", outFile);
+}
+
+
+
+#pragma mark --- native image API ---
+
+LXPixelBufferRef LXPixelBufferCreateFromPathUsingNativeAPI_(LXUnibuffer unipath, LXInteger imageType, LXMapPtr properties, LXError *outError)
+{
+    LXErrorSet(outError, 1629, "unsupported image format");
+    return NULL;
+}
+
+LXPixelBufferRef LXPixelBufferCreateFromFileDataUsingNativeAPI_(const uint8_t *data, size_t len, LXInteger imageType, LXMapPtr properties, LXError *outError)
+{
+    LXErrorSet(outError, 1629, "unsupported image format");
+    return NULL;
+}
+
+LXSuccess LXPixelBufferWriteToPathUsingNativeAPI_(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXUInteger lxImageType, LXMapPtr properties, LXError *outError)
+{
+    LXErrorSet(outError, 1629, "unsupported image format");
+    return NO;
+}
+
+LXSuccess LXCopyICCProfileDataForColorSpaceEncoding(LXColorSpaceEncoding colorSpaceID, uint8_t **outData, size_t *outDataLen)
+{
+    return NO;  // no color management on this platform
+}
+
+
+#endif  // LXPLATFORM_LINUX
@@ -0,0 +1,1053 @@
+/*
+ *  LXPixelBuffer_png.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXPixelBuffer.h"
+#include "LXPixelBuffer_priv.h"
+
+#include "LXImageFunctions.h"
+#include "LXHalfFloat.h"
+#include "LXColorFunctions.h"
+#include "LXParallel.h"
+#include "LXMutexAtomic.h"
+
+#include <zlib.h>
+
+#if defined(__SSE2__) && !defined(__BIG_ENDIAN__)
+ #include <emmintrin.h>
+ #define LXPNG_SSE2 1
+#endif
+
+
+/*
+  A self-contained PNG codec on top of zlib.
+
+  The reader handles all standard PNG formats (palette, greyscale and truecolor, 1-16 bits,
+  with or without alpha or a tRNS chunk, Adam7 interlaced or not). 8-bit images are returned as RGBA int8,
+  16-bit images as RGBA float16. Like the native readers, alpha is premultiplied unless the
+  "leaveAlphaUnpremultiplied" property is set.
+
+  The writer splits the image into bands that are filtered and deflated on separate threads.
+  Each band is a raw deflate stream primed with the preceding 32kB of data and terminated with
+  a sync flush, so the concatenated bands form a single valid zlib stream.
+*/
+
+static const uint8_t s_pngSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+enum {
+    kPNGColor_Grey = 0,
+    kPNGColor_RGB = 2,
+    kPNGColor_Palette = 3,
+    kPNGColor_GreyAlpha = 4,
+    kPNGColor_RGBA = 6
+};
+
+enum {
+    kPNGFilter_None = 0,
+    kPNGFilter_Sub,
+    kPNGFilter_Up,
+    kPNGFilter_Average,
+    kPNGFilter_Paeth
+};
+
+// bands aim for roughly this much filtered data
+#define PNG_WRITE_TARGET_BAND_BYTES (256 * 1024)
+
+#define PNG_DEFLATE_LEVEL           3
+#define PNG_DEFLATE_WINDOW          32768
+
+
+LXINLINE uint32_t readBE32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+LXINLINE void writeBE32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+LXINLINE uint8_t paethPredictor(const int a, const int b, const int c)
+{
+    const int pa = abs(b - c);
+    const int pb = abs(a - c);
+    const int pc = abs(a + b - 2*c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)((pb <= pc) ? b : c);
+}
+
+
+#pragma mark --- unfiltering ---
+
+static void unfilterRow_scalar(const LXInteger filter, uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev,
+                               const size_t rowBytes, const size_t bpp)
+{
+    size_t i;
+    switch (filter) {
+        case kPNGFilter_Sub:
+            for (i = bpp; i < rowBytes; i++)
+                row[i] += row[i - bpp];
+            break;
+        case kPNGFilter_Up:
+            for (i = 0; i < rowBytes; i++)
+                row[i] += prev[i];
+            break;
+        case kPNGFilter_Average:
+            for (i = 0; i < bpp; i++)
+                row[i] += prev[i] >> 1;
+            for (; i < rowBytes; i++)
+                row[i] += (uint8_t)(((int)row[i - bpp] + prev[i]) >> 1);
+            break;
+        case kPNGFilter_Paeth:
+            for (i = 0; i < bpp; i++)
+                row[i] += prev[i];
+            for (; i < rowBytes; i++)
+                row[i] += paethPredictor(row[i - bpp], prev[i], prev[i - bpp]);
+            break;
+    }
+}
+
+#if defined(LXPNG_SSE2)
+
+// Sub, Average and Paeth depend on the previous pixel, so these process one pixel of "bpp" bytes at a time
+// (unpacked to 16-bit lanes for Paeth). Up has no dependency and is done 16 bytes at a time.
+
+LXINLINE __m128i loadPixelBytes(const uint8_t *p, const size_t bpp)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, bpp);
+    return _mm_loadl_epi64((const __m128i *)&v);
+}
+
+LXINLINE void storePixelBytes(uint8_t *p, __m128i v, const size_t bpp)
+{
+    uint64_t t;
+    _mm_storel_epi64((__m128i *)&t, v);
+    memcpy(p, &t, bpp);
+}
+
+LXINLINE void unfilterRowSub_SSE2(uint8_t * LXRESTRICT row, const size_t rowBytes, const size_t bpp)
+{
+    __m128i a = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; i + bpp <= rowBytes; i += bpp) {
+        a = _mm_add_epi8(a, loadPixelBytes(row + i, bpp));
+        storePixelBytes(row + i, a, bpp);
+    }
+}
+
+LXINLINE void unfilterRowAverage_SSE2(uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev, const size_t rowBytes, const size_t bpp)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; i + bpp <= rowBytes; i += bpp) {
+        __m128i b = loadPixelBytes(prev + i, bpp);
+        // pavgb rounds up, so subtract the carried low bit to get floor((a + b) / 2)
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(loadPixelBytes(row + i, bpp), avg);
+        storePixelBytes(row + i, a, bpp);
+    }
+}
+
+LXINLINE void unfilterRowPaeth_SSE2(uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev, const size_t rowBytes, const size_t bpp)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero, c = zero;
+    size_t i;
+    for (i = 0; i + bpp <= rowBytes; i += bpp) {
+        __m128i b = _mm_unpacklo_epi8(loadPixelBytes(prev + i, bpp), zero);
+        __m128i d = _mm_unpacklo_epi8(loadPixelBytes(row + i, bpp), zero);
+
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+        pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+        pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+        __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        __m128i useA = _mm_cmpeq_epi16(pa, smallest);
+        __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(pb, smallest));
+        __m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+        __m128i nearest = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)), _mm_and_si128(useC, c));
+
+        a = _mm_and_si128(_mm_add_epi16(d, nearest), _mm_set1_epi16(0xff));
+        c = b;
+        storePixelBytes(row + i, _mm_packus_epi16(a, zero), bpp);
+    }
+}
+
+static void unfilterRowUp_SSE2(uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev, const size_t rowBytes)
+{
+    size_t i;
+    for (i = 0; i + 16 <= rowBytes; i += 16) {
+        __m128i v = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(row + i)), _mm_loadu_si128((const __m128i *)(prev + i)));
+        _mm_storeu_si128((__m128i *)(row + i), v);
+    }
+    for (; i < rowBytes; i++)
+        row[i] += prev[i];
+}
+
+#define UNFILTER_FOR_BPP(func_, bpp_)   case bpp_:  func_;  break;
+
+LXFUNCATTR_SSE static void unfilterRow(const LXInteger filter, uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev,
+                                       const size_t rowBytes, const size_t bpp)
+{
+    // the pixel-at-a-time kernels are specialized for the common pixel sizes (i.e. RGB/RGBA at 8 or 16 bits)
+    const LXBool hasKernel = (bpp == 3 || bpp == 4 || bpp == 6 || bpp == 8);
+
+    if (filter == kPNGFilter_Up) {
+        unfilterRowUp_SSE2(row, prev, rowBytes);
+    }
+    else if (filter == kPNGFilter_Sub && hasKernel) {
+        switch (bpp) {
+            UNFILTER_FOR_BPP(unfilterRowSub_SSE2(row, rowBytes, 3), 3)
+            UNFILTER_FOR_BPP(unfilterRowSub_SSE2(row, rowBytes, 4), 4)
+            UNFILTER_FOR_BPP(unfilterRowSub_SSE2(row, rowBytes, 6), 6)
+            UNFILTER_FOR_BPP(unfilterRowSub_SSE2(row, rowBytes, 8), 8)
+        }
+    }
+    else if (filter == kPNGFilter_Average && hasKernel) {
+        switch (bpp) {
+            UNFILTER_FOR_BPP(unfilterRowAverage_SSE2(row, prev, rowBytes, 3), 3)
+            UNFILTER_FOR_BPP(unfilterRowAverage_SSE2(row, prev, rowBytes, 4), 4)
+            UNFILTER_FOR_BPP(unfilterRowAverage_SSE2(row, prev, rowBytes, 6), 6)
+            UNFILTER_FOR_BPP(unfilterRowAverage_SSE2(row, prev, rowBytes, 8), 8)
+        }
+    }
+    else if (filter == kPNGFilter_Paeth && hasKernel) {
+        switch (bpp) {
+            UNFILTER_FOR_BPP(unfilterRowPaeth_SSE2(row, prev, rowBytes, 3), 3)
+            UNFILTER_FOR_BPP(unfilterRowPaeth_SSE2(row, prev, rowBytes, 4), 4)
+            UNFILTER_FOR_BPP(unfilterRowPaeth_SSE2(row, prev, rowBytes, 6), 6)
+            UNFILTER_FOR_BPP(unfilterRowPaeth_SSE2(row, prev, rowBytes, 8), 8)
+        }
+    }
+    else {
+        unfilterRow_scalar(filter, row, prev, rowBytes, bpp);
+    }
+}
+
+#else
+
+#define unfilterRow unfilterRow_scalar
+
+#endif  // LXPNG_SSE2
+
+
+#pragma mark --- read API ---
+
+typedef struct {
+    uint32_t w, h;
+    int bitDepth;
+    int colorType;
+    int interlace;
+    int channels;
+
+    uint8_t palette[256 * 4];
+    LXInteger paletteCount;
+    LXBool hasTRNS;
+    uint16_t trnsKey[3];
+} LXPNGInfo;
+
+
+// expands one unfiltered row into RGBA int8 or RGBA float (for 16-bit data).
+// sub-byte samples are unpacked first, so "src" holds one byte per sample in that case.
+static void expandPNGRowToRGBA(const LXPNGInfo *info, const uint8_t * LXRESTRICT src, void * LXRESTRICT dst, const LXInteger n)
+{
+    const int ch = info->channels;
+    LXInteger x;
+
+    if (info->bitDepth == 16) {
+        float *d = (float *)dst;
+        const float mul = 1.0f / 65535.0f;
+        for (x = 0; x < n; x++) {
+            uint16_t v[4];
+            int c;
+            for (c = 0; c < ch; c++)
+                v[c] = (uint16_t)((src[c*2] << 8) | src[c*2 + 1]);
+            src += ch * 2;
+
+            switch (info->colorType) {
+                case kPNGColor_Grey:
+                    d[0] = d[1] = d[2] = v[0] * mul;
+                    d[3] = (info->hasTRNS && v[0] == info->trnsKey[0]) ? 0.0f : 1.0f;
+                    break;
+                case kPNGColor_GreyAlpha:
+                    d[0] = d[1] = d[2] = v[0] * mul;
+                    d[3] = v[1] * mul;
+                    break;
+                case kPNGColor_RGB:
+                    d[0] = v[0] * mul;  d[1] = v[1] * mul;  d[2] = v[2] * mul;
+                    d[3] = (info->hasTRNS && v[0] == info->trnsKey[0] && v[1] == info->trnsKey[1] && v[2] == info->trnsKey[2]) ? 0.0f : 1.0f;
+                    break;
+                default:
+                    d[0] = v[0] * mul;  d[1] = v[1] * mul;  d[2] = v[2] * mul;  d[3] = v[3] * mul;
+                    break;
+            }
+            d += 4;
+        }
+        return;
+    }
+
+    uint8_t *d = (uint8_t *)dst;
+    switch (info->colorType) {
+        case kPNGColor_Palette:
+            for (x = 0; x < n; x++) {
+                memcpy(d, info->palette + src[x] * 4, 4);
+                d += 4;
+            }
+            break;
+
+        case kPNGColor_Grey: {
+            const int scale = (info->bitDepth < 8) ? (255 / ((1 << info->bitDepth) - 1)) : 1;
+            for (x = 0; x < n; x++) {
+                const uint8_t v = src[x];
+                d[0] = d[1] = d[2] = (uint8_t)(v * scale);
+                d[3] = (info->hasTRNS && v == info->trnsKey[0]) ? 0 : 255;
+                d += 4;
+            }
+            break;
+        }
+
+        case kPNGColor_GreyAlpha:
+            for (x = 0; x < n; x++) {
+                d[0] = d[1] = d[2] = src[0];
+                d[3] = src[1];
+                src += 2;
+                d += 4;
+            }
+            break;
+
+        case kPNGColor_RGB:
+            if ( !info->hasTRNS) {
+                LXPxConvert_RGB_to_RGBA_int8(n, 1, (uint8_t *)src, n*3, 3, d, n*4);
+            } else {
+                for (x = 0; x < n; x++) {
+                    d[0] = src[0];  d[1] = src[1];  d[2] = src[2];
+                    d[3] = (src[0] == info->trnsKey[0] && src[1] == info->trnsKey[1] && src[2] == info->trnsKey[2]) ? 0 : 255;
+                    src += 3;
+                    d += 4;
+                }
+            }
+            break;
+
+        default:
+            memcpy(d, src, n * 4);
+            break;
+    }
+}
+
+// unpacks 1/2/4-bit samples to one byte each
+static void unpackPNGSubByteRow(const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst, const LXInteger n, const int bitDepth)
+{
+    const int perByte = 8 / bitDepth;
+    const int mask = (1 << bitDepth) - 1;
+    LXInteger x;
+    for (x = 0; x < n; x++) {
+        const int shift = 8 - bitDepth * (1 + (x % perByte));
+        dst[x] = (src[x / perByte] >> shift) & mask;
+    }
+}
+
+static LXSuccess parsePNGHeader(const uint8_t *data, size_t len, LXPNGInfo *info, LXError *outError)
+{
+    if (len < 8 + 25 || 0 != memcmp(data, s_pngSignature, 8) || 0 != memcmp(data + 12, "IHDR", 4)) {
+        LXErrorSet(outError, 1870, "not a PNG file");
+        return NO;
+    }
+    const uint8_t *ihdr = data + 16;
+    info->w = readBE32(ihdr);
+    info->h = readBE32(ihdr + 4);
+    info->bitDepth = ihdr[8];
+    info->colorType = ihdr[9];
+    info->interlace = ihdr[12];
+
+    const int d = info->bitDepth;
+    LXBool ok = (ihdr[10] == 0 && ihdr[11] == 0 && info->interlace <= 1);
+    switch (info->colorType) {
+        case kPNGColor_Grey:        info->channels = 1;  ok = ok && (d == 1 || d == 2 || d == 4 || d == 8 || d == 16);  break;
+        case kPNGColor_Palette:     info->channels = 1;  ok = ok && (d == 1 || d == 2 || d == 4 || d == 8);  break;
+        case kPNGColor_RGB:         info->channels = 3;  ok = ok && (d == 8 || d == 16);  break;
+        case kPNGColor_GreyAlpha:   info->channels = 2;  ok = ok && (d == 8 || d == 16);  break;
+        case kPNGColor_RGBA:        info->channels = 4;  ok = ok && (d == 8 || d == 16);  break;
+        default:                    ok = NO;  break;
+    }
+    if ( !ok) {
+        LXErrorSet(outError, 1871, "unsupported PNG format");
+        return NO;
+    }
+    if (info->w < 1 || info->h < 1 || info->w > (1 << 24) || info->h > (1 << 24)) {
+        LXErrorSet(outError, 1871, "invalid PNG image size");
+        return NO;
+    }
+    return YES;
+}
+
+LXPixelBufferRef LXPixelBufferCreateFromPNGImageInMemory(const uint8_t *data, size_t len, LXMapPtr properties, LXError *outError)
+{
+    LXPNGInfo info;
+    memset(&info, 0, sizeof(info));
+
+    if ( !data || !parsePNGHeader(data, len, &info, outError))
+        return NULL;
+
+    LXBool leaveUnpremultiplied = NO;
+    if (properties) {
+        LXMapGetBool(properties, "leaveAlphaUnpremultiplied", &leaveUnpremultiplied);
+    }
+
+    const uint32_t w = info.w;
+    const uint32_t h = info.h;
+    const size_t bitsPerPixel = info.channels * info.bitDepth;
+    const size_t bpp = MAX(1, bitsPerPixel / 8);    // filter unit in bytes
+    const size_t rowBytes = (w * bitsPerPixel + 7) / 8;
+
+    // size of the inflated data; each pass of an interlaced image is a separate sub-image
+    static const int s_adam7[7][4] = {  // x0, y0, dx, dy
+        { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+    };
+    const int numPasses = (info.interlace) ? 7 : 1;
+    uint32_t passW[7], passH[7];
+    size_t rawSize = 0;
+    int p;
+    for (p = 0; p < numPasses; p++) {
+        if (info.interlace) {
+            passW[p] = (w > (uint32_t)s_adam7[p][0]) ? (w - s_adam7[p][0] + s_adam7[p][2] - 1) / s_adam7[p][2] : 0;
+            passH[p] = (h > (uint32_t)s_adam7[p][1]) ? (h - s_adam7[p][1] + s_adam7[p][3] - 1) / s_adam7[p][3] : 0;
+        } else {
+            passW[p] = w;
+            passH[p] = h;
+        }
+        if (passW[p] > 0)
+            rawSize += passH[p] * (1 + (passW[p] * bitsPerPixel + 7) / 8);
+    }
+
+    uint8_t *rawBuf = _lx_malloc(rawSize);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    inflateInit(&stream);
+    stream.next_out = rawBuf;
+    stream.avail_out = (uInt)rawSize;
+
+    // walk the chunks, feeding IDAT data straight to zlib
+    LXBool ok = YES;
+    LXBool didEnd = NO;
+    size_t pos = 8;
+    while (ok && !didEnd && pos + 12 <= len) {
+        const uint32_t chunkLen = readBE32(data + pos);
+        const uint8_t *type = data + pos + 4;
+        const uint8_t *chunk = data + pos + 8;
+        if (chunkLen > len - pos - 12) {
+            ok = NO;
+            break;
+        }
+
+        if (0 == memcmp(type, "IDAT", 4)) {
+            stream.next_in = (Bytef *)chunk;
+            stream.avail_in = chunkLen;
+            int zret = inflate(&stream, Z_NO_FLUSH);
+            if (zret == Z_STREAM_END)
+                didEnd = YES;
+            else if (zret != Z_OK && !(zret == Z_BUF_ERROR && stream.avail_out == 0))
+                ok = NO;
+        }
+        else if (0 == memcmp(type, "PLTE", 4)) {
+            LXInteger i;
+            info.paletteCount = MIN(256, chunkLen / 3);
+            for (i = 0; i < info.paletteCount; i++) {
+                info.palette[i*4 + 0] = chunk[i*3 + 0];
+                info.palette[i*4 + 1] = chunk[i*3 + 1];
+                info.palette[i*4 + 2] = chunk[i*3 + 2];
+                info.palette[i*4 + 3] = 255;
+            }
+        }
+        else if (0 == memcmp(type, "tRNS", 4)) {
+            LXInteger i;
+            info.hasTRNS = YES;
+            if (info.colorType == kPNGColor_Palette) {
+                for (i = 0; i < (LXInteger)MIN(256, chunkLen); i++)
+                    info.palette[i*4 + 3] = chunk[i];
+            } else {
+                for (i = 0; i < 3 && (i*2 + 1) < (LXInteger)chunkLen; i++)
+                    info.trnsKey[i] = (uint16_t)((chunk[i*2] << 8) | chunk[i*2 + 1]);
+                // for 8-bit data the key is compared against the sample value directly
+                if (info.bitDepth < 16 && info.colorType == kPNGColor_RGB) {
+                    for (i = 0; i < 3; i++)  info.trnsKey[i] &= 0xff;
+                }
+            }
+        }
+        else if (0 == memcmp(type, "IEND", 4)) {
+            break;
+        }
+        pos += 12 + chunkLen;
+    }
+    inflateEnd(&stream);
+
+    // a truncated stream is accepted as long as all the image data was received
+    if ( !ok || stream.avail_out != 0) {
+        LXErrorSet(outError, 1872, "PNG image data is corrupt or truncated");
+        _lx_free(rawBuf);
+        return NULL;
+    }
+
+    const LXBool hasAlpha = (info.colorType == kPNGColor_GreyAlpha || info.colorType == kPNGColor_RGBA || info.hasTRNS);
+    const LXPixelFormat pxFormat = (info.bitDepth == 16) ? kLX_RGBA_FLOAT16 : kLX_RGBA_INT8;
+
+    LXPixelBufferRef newPixbuf = LXPixelBufferCreate(NULL, w, h, pxFormat, outError);
+    size_t dstRowBytes = 0;
+    uint8_t *dstData = (newPixbuf) ? LXPixelBufferLockPixels(newPixbuf, &dstRowBytes, NULL, outError) : NULL;
+    if ( !dstData) {
+        LXPixelBufferRelease(newPixbuf);
+        _lx_free(rawBuf);
+        return NULL;
+    }
+
+    uint8_t *zeroRow = _lx_calloc(rowBytes + 16, 1);
+    uint8_t *unpackedRow = _lx_malloc(w + 16);
+    float *floatRow = (info.bitDepth == 16) ? _lx_malloc(w * 4 * sizeof(float)) : NULL;
+    uint8_t *pxRow = (info.interlace) ? _lx_malloc(w * 4 * sizeof(float)) : NULL;
+
+    uint8_t *passData = rawBuf;
+    for (p = 0; p < numPasses && ok; p++) {
+        if (passW[p] == 0 || passH[p] == 0)
+            continue;
+        const size_t passRowBytes = (passW[p] * bitsPerPixel + 7) / 8;
+        const uint8_t *prev = zeroRow;
+        uint32_t y;
+        for (y = 0; y < passH[p]; y++) {
+            uint8_t *filtered = passData + y * (1 + passRowBytes);
+            uint8_t *row = filtered + 1;
+            if (filtered[0] > kPNGFilter_Paeth) {
+                LXErrorSet(outError, 1872, "invalid PNG filter type");
+                ok = NO;
+                break;
+            }
+            unfilterRow(filtered[0], row, prev, passRowBytes, bpp);
+            prev = row;
+
+            const uint8_t *src = row;
+            if (info.bitDepth < 8) {
+                unpackPNGSubByteRow(row, unpackedRow, passW[p], info.bitDepth);
+                src = unpackedRow;
+            }
+
+            if ( !info.interlace) {
+                uint8_t *dst = dstData + dstRowBytes * y;
+                if (info.bitDepth == 16) {
+                    expandPNGRowToRGBA(&info, src, floatRow, w);
+                    if (hasAlpha && !leaveUnpremultiplied) {
+                        LXImagePremultiply_RGBA_float32(w, 1, floatRow, 0, floatRow, 0);
+                    }
+                    LXConvertFloatToHalfArray(floatRow, (LXHalf *)dst, w * 4);
+                } else {
+                    expandPNGRowToRGBA(&info, src, dst, w);
+                }
+            }
+            else {
+                // scatter the pass pixels into the image; premultiply and conversion are done at the end
+                const int x0 = s_adam7[p][0], dx = s_adam7[p][2];
+                const uint32_t dstY = s_adam7[p][1] + y * s_adam7[p][3];
+                uint32_t x;
+                expandPNGRowToRGBA(&info, src, pxRow, passW[p]);
+                for (x = 0; x < passW[p]; x++) {
+                    const size_t dstX = x0 + x * dx;
+                    if (info.bitDepth == 16) {
+                        const float *s = (const float *)pxRow + x * 4;
+                        LXHalf *d = (LXHalf *)(dstData + dstRowBytes * dstY) + dstX * 4;
+                        d[0] = LXHalfFromFloat(s[0]);
+                        d[1] = LXHalfFromFloat(s[1]);
+                        d[2] = LXHalfFromFloat(s[2]);
+                        d[3] = LXHalfFromFloat(s[3]);
+                    } else {
+                        memcpy(dstData + dstRowBytes * dstY + dstX * 4, pxRow + x * 4, 4);
+                    }
+                }
+            }
+        }
+        passData += passH[p] * (1 + passRowBytes);
+    }
+
+    if (ok && hasAlpha && !leaveUnpremultiplied) {
+        if (info.bitDepth != 16) {
+            LXImagePremultiply_RGBA_int8_inplace(w, h, dstData, dstRowBytes);
+        }
+        else if (info.interlace) {
+            LXImagePremultiply_RGBA_float16(w, h, (LXHalf *)dstData, dstRowBytes, (LXHalf *)dstData, dstRowBytes);
+        }
+    }
+
+    _lx_free(zeroRow);
+    _lx_free(unpackedRow);
+    _lx_free(floatRow);
+    _lx_free(pxRow);
+    _lx_free(rawBuf);
+
+    LXPixelBufferUnlockPixels(newPixbuf);
+    if ( !ok) {
+        LXPixelBufferRelease(newPixbuf);
+        newPixbuf = NULL;
+    }
+    return newPixbuf;
+}
+
+LXPixelBufferRef LXPixelBufferCreateFromPNGImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError)
+{
+    LXFilePtr file = NULL;
+    if ( !LXOpenFileForReadingWithUnipath(unipath.unistr, unipath.numOfChar16, &file)) {
+        LXErrorSet(outError, 1808, "unable to open file");
+        return NULL;
+    }
+
+    _lx_fseek64(file, 0, SEEK_END);
+    size_t fileLen = (size_t)_lx_ftell64(file);
+    uint8_t *fileData = _lx_malloc(fileLen);
+
+    _lx_fseek64(file, 0, SEEK_SET);
+    size_t bytesRead = _lx_fread(fileData, 1, fileLen, file);
+    _lx_fclose(file);
+
+    LXPixelBufferRef pixbuf = NULL;
+    if (bytesRead != fileLen || bytesRead == 0) {
+        LXErrorSet(outError, 1761, "error reading from file");
+    } else {
+        pixbuf = LXPixelBufferCreateFromPNGImageInMemory(fileData, fileLen, properties, outError);
+    }
+    _lx_free(fileData);
+    return pixbuf;
+}
+
+
+#pragma mark --- write API ---
+
+// sum of absolute values of the filtered bytes taken as signed; the usual heuristic for picking a filter
+static uint32_t scoreFilteredRow(const uint8_t * LXRESTRICT p, const size_t n)
+{
+    uint32_t sum = 0;
+    size_t i = 0;
+#if defined(LXPNG_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        v = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    }
+    sum = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+    for (; i < n; i++)
+        sum += (p[i] < 128) ? p[i] : (256 - p[i]);
+    return sum;
+}
+
+static void filterRowPaeth(const uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev, uint8_t * LXRESTRICT dst,
+                           const size_t rowBytes, const size_t bpp)
+{
+    size_t i;
+    for (i = 0; i < bpp; i++)
+        dst[i] = row[i] - prev[i];
+
+#if defined(LXPNG_SSE2)
+    // no dependency between outputs when encoding, so this can go 16 bytes at a time
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= rowBytes; i += 16) {
+        __m128i x8 = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i a8 = _mm_loadu_si128((const __m128i *)(row + i - bpp));
+        __m128i b8 = _mm_loadu_si128((const __m128i *)(prev + i));
+        __m128i c8 = _mm_loadu_si128((const __m128i *)(prev + i - bpp));
+        __m128i res[2];
+        int k;
+        for (k = 0; k < 2; k++) {
+            __m128i a = (k == 0) ? _mm_unpacklo_epi8(a8, zero) : _mm_unpackhi_epi8(a8, zero);
+            __m128i b = (k == 0) ? _mm_unpacklo_epi8(b8, zero) : _mm_unpackhi_epi8(b8, zero);
+            __m128i c = (k == 0) ? _mm_unpacklo_epi8(c8, zero) : _mm_unpackhi_epi8(c8, zero);
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = _mm_add_epi16(pa, pb);
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            __m128i useA = _mm_cmpeq_epi16(pa, smallest);
+            __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(pb, smallest));
+            __m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+            res[k] = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)), _mm_and_si128(useC, c));
+        }
+        __m128i pred = _mm_packus_epi16(res[0], res[1]);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_sub_epi8(x8, pred));
+    }
+#endif
+    for (; i < rowBytes; i++)
+        dst[i] = row[i] - paethPredictor(row[i - bpp], prev[i], prev[i - bpp]);
+}
+
+// picks the filter for one row among None, Sub, Up and Paeth; "dst" receives the filter byte followed by the row.
+// Average rarely wins, so it's not tried.
+static void filterRow(const uint8_t * LXRESTRICT row, const uint8_t * LXRESTRICT prev, uint8_t * LXRESTRICT dst,
+                      uint8_t * LXRESTRICT scratch, const size_t rowBytes, const size_t bpp)
+{
+    uint8_t *best = dst + 1;
+    uint8_t *cand = scratch;
+    uint32_t bestScore, score;
+    size_t i;
+
+    // the candidates are written alternately into "dst" and "scratch", keeping the best one so far
+    #define TRY_CANDIDATE(filter_) \
+        score = scoreFilteredRow(cand, rowBytes); \
+        if (score < bestScore) { \
+            uint8_t *t = best;  best = cand;  cand = t; \
+            bestScore = score;  bestFilter = filter_; \
+        }
+
+    memcpy(best, row, rowBytes);
+    bestScore = scoreFilteredRow(best, rowBytes);
+    LXInteger bestFilter = kPNGFilter_None;
+
+    for (i = 0; i < bpp; i++)  cand[i] = row[i];
+    for (; i < rowBytes; i++)  cand[i] = row[i] - row[i - bpp];
+    TRY_CANDIDATE(kPNGFilter_Sub)
+
+    if (prev) {
+        for (i = 0; i < rowBytes; i++)  cand[i] = row[i] - prev[i];
+        TRY_CANDIDATE(kPNGFilter_Up)
+
+        filterRowPaeth(row, prev, cand, rowBytes, bpp);
+        TRY_CANDIDATE(kPNGFilter_Paeth)
+    }
+    #undef TRY_CANDIDATE
+
+    if (best != dst + 1)
+        memcpy(dst + 1, best, rowBytes);
+    dst[0] = (uint8_t)bestFilter;
+}
+
+typedef struct {
+    const uint8_t *srcData;
+    size_t srcRowBytes;
+    LXBool is16Bit;
+    LXBool hasAlpha;
+    uint32_t w, h;
+    size_t rowBytes;
+    size_t bpp;
+
+    uint8_t *filteredData;      // h * (1 + rowBytes)
+    uint32_t bandH;
+
+    uint8_t **bandOutputs;
+    size_t *bandOutputSizes;
+    uLong *bandAdlers;
+
+    volatile int32_t failed;
+} LXPNGWriteJob;
+
+// converts a source row (RGBA int8 or float16, premultiplied) to PNG sample layout
+static void makePNGRow(LXPNGWriteJob *job, uint32_t y, uint8_t * LXRESTRICT dst, float * LXRESTRICT tempFloats)
+{
+    const uint8_t *src = job->srcData + job->srcRowBytes * y;
+    const uint32_t w = job->w;
+    uint32_t x;
+
+    if ( !job->is16Bit) {
+        if ( !job->hasAlpha) {
+            LXPxConvert_RGBA_to_RGB_int8(w, 1,  (uint8_t *)src, w * 4, 4,  dst, w * 3, 3);
+            return;
+        }
+        for (x = 0; x < w; x++) {
+            const unsigned int a = src[3];
+            if (a == 255 || a == 0) {
+                memcpy(dst, src, 4);
+            } else {
+                dst[0] = (uint8_t)MIN(255, (src[0] * 255 + a/2) / a);
+                dst[1] = (uint8_t)MIN(255, (src[1] * 255 + a/2) / a);
+                dst[2] = (uint8_t)MIN(255, (src[2] * 255 + a/2) / a);
+                dst[3] = (uint8_t)a;
+            }
+            src += 4;
+            dst += 4;
+        }
+        return;
+    }
+
+    LXConvertHalfToFloatArray((const LXHalf *)src, tempFloats, w * 4);
+    const int ch = (job->hasAlpha) ? 4 : 3;
+    for (x = 0; x < w; x++) {
+        const float *s = tempFloats + x * 4;
+        const float a = MIN(1.0f, MAX(0.0f, s[3]));
+        const float unpremult = (job->hasAlpha && a > 0.0f) ? (1.0f / a) : 1.0f;
+        int c;
+        for (c = 0; c < ch; c++) {
+            float f = (c == 3) ? a : (s[c] * unpremult);
+            f = MIN(1.0f, MAX(0.0f, f));
+            const uint16_t v = (uint16_t)(f * 65535.0f + 0.5f);
+            dst[0] = (uint8_t)(v >> 8);
+            dst[1] = (uint8_t)v;
+            dst += 2;
+        }
+    }
+}
+
+static void filterPNGBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger bandY0, LXInteger bandY1)
+{
+    LXPNGWriteJob *job = (LXPNGWriteJob *)userData;
+    const size_t rowBytes = job->rowBytes;
+    const uint32_t y0 = (uint32_t)bandY0;
+    const uint32_t y1 = (uint32_t)bandY1;
+
+    uint8_t *rows[2] = { _lx_malloc(rowBytes + 16), _lx_malloc(rowBytes + 16) };
+    uint8_t *scratch = _lx_malloc(rowBytes + 16);
+    float *tempFloats = (job->is16Bit) ? _lx_malloc(job->w * 4 * sizeof(float)) : NULL;
+    uint32_t y;
+
+    // the filters look at the previous row, so the band's first row needs the one above it too
+    if (y0 > 0)
+        makePNGRow(job, y0 - 1, rows[(y0 - 1) & 1], tempFloats);
+
+    for (y = y0; y < y1; y++) {
+        uint8_t *row = rows[y & 1];
+        uint8_t *prev = (y > 0) ? rows[(y - 1) & 1] : NULL;
+        makePNGRow(job, y, row, tempFloats);
+        filterRow(row, prev, job->filteredData + (1 + rowBytes) * y, scratch, rowBytes, job->bpp);
+    }
+
+    _lx_free(rows[0]);
+    _lx_free(rows[1]);
+    _lx_free(scratch);
+    _lx_free(tempFloats);
+}
+
+static void deflatePNGBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger bandY0, LXInteger bandY1)
+{
+    LXPNGWriteJob *job = (LXPNGWriteJob *)userData;
+    const size_t stride = 1 + job->rowBytes;
+    const uint32_t y0 = (uint32_t)bandY0;
+    const uint32_t y1 = (uint32_t)bandY1;
+    const LXBool isLast = (y1 == job->h);
+    uint8_t *src = job->filteredData + stride * y0;
+    const size_t srcLen = stride * (y1 - y0);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (Z_OK != deflateInit2(&stream, PNG_DEFLATE_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)) {
+        LXAtomicInc_int32(&job->failed);
+        return;
+    }
+
+    // priming with the end of the previous band keeps the compression ratio close to a single stream
+    if (y0 > 0) {
+        const size_t dictLen = MIN(PNG_DEFLATE_WINDOW, stride * y0);
+        deflateSetDictionary(&stream, src - dictLen, (uInt)dictLen);
+    }
+
+    // bound for the data plus the sync flush marker
+    const size_t outSize = deflateBound(&stream, srcLen) + 16;
+    uint8_t *out = _lx_malloc(outSize);
+
+    stream.next_in = src;
+    stream.avail_in = (uInt)srcLen;
+    stream.next_out = out;
+    stream.avail_out = (uInt)outSize;
+
+    int zret = deflate(&stream, (isLast) ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((isLast && zret != Z_STREAM_END) || ( !isLast && (zret != Z_OK || stream.avail_in != 0))) {
+        LXAtomicInc_int32(&job->failed);
+    }
+
+    job->bandOutputs[bandIndex] = out;
+    job->bandOutputSizes[bandIndex] = stream.total_out;
+    job->bandAdlers[bandIndex] = adler32(adler32(0, NULL, 0), src, (uInt)srcLen);
+
+    deflateEnd(&stream);
+}
+
+static LXSuccess writePNGChunk(LXFilePtr file, const char *type, const uint8_t *data, size_t len)
+{
+    uint8_t header[8];
+    uint8_t crcBytes[4];
+    writeBE32(header, (uint32_t)len);
+    memcpy(header + 4, type, 4);
+
+    uLong crc = crc32(0, NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    if (len > 0)
+        crc = crc32(crc, data, (uInt)len);
+    writeBE32(crcBytes, (uint32_t)crc);
+
+    if (_lx_fwrite(header, 8, 1, file) != 1)
+        return NO;
+    if (len > 0 && _lx_fwrite(data, len, 1, file) != 1)
+        return NO;
+    return (_lx_fwrite(crcBytes, 4, 1, file) == 1) ? YES : NO;
+}
+
+static LXSuccess writePNGImage(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXBool includeAlpha, LXBool is16Bit,
+                               uint8_t *iccData, size_t iccDataLen,
+                               LXError *outError)
+{
+    LXPNGWriteJob job;
+    memset(&job, 0, sizeof(job));
+    job.w = LXPixelBufferGetWidth(pixbuf);
+    job.h = LXPixelBufferGetHeight(pixbuf);
+    job.is16Bit = is16Bit;
+    job.hasAlpha = includeAlpha;
+    job.bpp = ((includeAlpha) ? 4 : 3) * ((is16Bit) ? 2 : 1);
+    job.rowBytes = job.w * job.bpp;
+
+    const LXInteger numWorkers = ((LXInteger)job.w * job.h >= kLXParallelMinPixels) ? LXParallelGetWorkerCount() : 1;
+
+    // enough bands to keep every worker busy, but not so small that priming overhead matters
+    const uint32_t rowsForWorkers = (job.h + numWorkers * 4 - 1) / (numWorkers * 4);
+    job.bandH = (uint32_t)MAX(1, PNG_WRITE_TARGET_BAND_BYTES / (1 + job.rowBytes));
+    job.bandH = MIN(job.bandH, MAX(16, rowsForWorkers));
+    job.bandH = MIN(job.bandH, job.h);
+    const LXInteger bandCount = (job.h + job.bandH - 1) / job.bandH;
+
+    job.srcData = LXPixelBufferLockPixels(pixbuf, &job.srcRowBytes, NULL, outError);
+    if ( !job.srcData) return NO;
+
+    job.filteredData = _lx_malloc((1 + job.rowBytes) * job.h);
+    job.bandOutputs = _lx_calloc(bandCount, sizeof(uint8_t *));
+    job.bandOutputSizes = _lx_calloc(bandCount, sizeof(size_t));
+    job.bandAdlers = _lx_calloc(bandCount, sizeof(uLong));
+
+    LXParallelApplyToRowBands(job.w, job.h, job.bandH, 0, filterPNGBand, &job);
+    LXParallelApplyToRowBands(job.w, job.h, job.bandH, 0, deflatePNGBand, &job);
+
+    LXPixelBufferUnlockPixels(pixbuf);
+
+    LXSuccess retVal = NO;
+    LXFilePtr file = NULL;
+    LXInteger i;
+
+    if (job.failed) {
+        LXErrorSet(outError, 1873, "PNG compression failed");
+    }
+    else if ( !LXOpenFileForWritingWithUnipath(unipath.unistr, unipath.numOfChar16, &file)) {
+        LXErrorSet(outError, 1808, "unable to open file for writing");
+    }
+    else {
+        uint8_t ihdr[13];
+        writeBE32(ihdr, job.w);
+        writeBE32(ihdr + 4, job.h);
+        ihdr[8] = (is16Bit) ? 16 : 8;
+        ihdr[9] = (includeAlpha) ? kPNGColor_RGBA : kPNGColor_RGB;
+        ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+        LXBool ok = (_lx_fwrite(s_pngSignature, 8, 1, file) == 1);
+        ok = ok && writePNGChunk(file, "IHDR", ihdr, 13);
+
+        if (ok && iccData && iccDataLen > 0) {
+            // profile name, null separator, compression method, then the zlib-compressed profile
+            const char *profileName = "ICC profile";
+            const size_t nameLen = strlen(profileName) + 2;
+            uLongf compLen = compressBound(iccDataLen);
+            uint8_t *iccp = _lx_malloc(nameLen + compLen);
+            memcpy(iccp, profileName, nameLen - 2);
+            iccp[nameLen - 2] = 0;
+            iccp[nameLen - 1] = 0;
+            if (Z_OK == compress(iccp + nameLen, &compLen, iccData, iccDataLen)) {
+                ok = writePNGChunk(file, "iCCP", iccp, nameLen + compLen);
+            }
+            _lx_free(iccp);
+        }
+
+        // each band goes into its own IDAT; the zlib header is prepended to the first and the checksum appended to the last
+        uLong adler = adler32(0, NULL, 0);
+        for (i = 0; i < bandCount && ok; i++) {
+            const size_t bandLen = MIN(job.bandH, job.h - i * job.bandH) * (1 + job.rowBytes);
+            adler = (i == 0) ? job.bandAdlers[0] : adler32_combine(adler, job.bandAdlers[i], (z_off_t)bandLen);
+
+            const LXBool isFirst = (i == 0), isLast = (i == bandCount - 1);
+            const size_t chunkLen = job.bandOutputSizes[i] + ((isFirst) ? 2 : 0) + ((isLast) ? 4 : 0);
+            uint8_t *chunk = _lx_malloc(chunkLen);
+            uint8_t *p = chunk;
+            if (isFirst) {
+                // CMF = deflate with 32k window, FLG = level hint 1 ("fast") and the check bits
+                *p++ = 0x78;
+                *p++ = 0x5e;
+            }
+            memcpy(p, job.bandOutputs[i], job.bandOutputSizes[i]);
+            p += job.bandOutputSizes[i];
+            if (isLast) {
+                writeBE32(p, (uint32_t)adler);
+            }
+            ok = writePNGChunk(file, "IDAT", chunk, chunkLen);
+            _lx_free(chunk);
+        }
+
+        ok = ok && writePNGChunk(file, "IEND", NULL, 0);
+        _lx_fclose(file);
+
+        if ( !ok) {
+            LXErrorSet(outError, 1813, "unable to write file (disk may be full)");
+        }
+        retVal = ok;
+    }
+
+    for (i = 0; i < bandCount; i++) {
+        _lx_free(job.bandOutputs[i]);
+    }
+    _lx_free(job.bandOutputs);
+    _lx_free(job.bandOutputSizes);
+    _lx_free(job.bandAdlers);
+    _lx_free(job.filteredData);
+    return retVal;
+}
+
+
+LXSuccess LXPixelBufferWriteAsPNGImageToPath(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXMapPtr properties, LXError *outError)
+{
+    if ( !pixbuf) return NO;
+
+    const LXUInteger w = LXPixelBufferGetWidth(pixbuf);
+    const LXUInteger h = LXPixelBufferGetHeight(pixbuf);
+    LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+
+    LXBool includeAlpha = NO;
+    LXInteger preferredBitDepth = 8;
+    LXInteger colorSpaceID = 0;
+    if (properties) {
+        LXMapGetBool(properties, kLXPixelBufferFormatRequestKey_AllowAlpha, &includeAlpha);
+        LXMapGetInteger(properties, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, &colorSpaceID);
+        LXMapGetInteger(properties, kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel, &preferredBitDepth);
+    }
+
+    const LXBool is16Bit = (preferredBitDepth > 8);
+    const LXPixelFormat srcPxFormat = (is16Bit) ? kLX_RGBA_FLOAT16 : kLX_RGBA_INT8;
+
+    uint8_t *iccDataBuf = NULL;
+    size_t iccDataLen = 0;
+    LXCopyICCProfileDataForColorSpaceEncoding(colorSpaceID, &iccDataBuf, &iccDataLen);
+
+    LXPixelBufferRef tempPixbuf = NULL;
+    LXSuccess retVal = NO;
+
+    if (pxFormat == srcPxFormat) {
+        retVal = writePNGImage(pixbuf, unipath, includeAlpha, is16Bit, iccDataBuf, iccDataLen, outError);
+    }
+    else {
+        tempPixbuf = LXPixelBufferCreate(NULL, w, h, srcPxFormat, outError);
+
+        if (tempPixbuf && LXPixelBufferCopyPixelBufferWithPixelFormatConversion(tempPixbuf, pixbuf, outError)) {
+            retVal = writePNGImage(tempPixbuf, unipath, includeAlpha, is16Bit, iccDataBuf, iccDataLen, outError);
+        }
+    }
+
+    LXPixelBufferRelease(tempPixbuf);
+    _lx_free(iccDataBuf);
+
+    return retVal;
+}
+
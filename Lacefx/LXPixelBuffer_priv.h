@@ -22,7 +22,19 @@
 #import <AppKit/AppKit.h>
 #endif
 
-#define LX_HAS_LIBTIFF 0
+// builds that link libtiff define this as 1 (see Makefile)
+#ifndef LX_HAS_LIBTIFF
+ #define LX_HAS_LIBTIFF 0
+#endif
+
+// platforms without a native image API use Lacefx's own PNG codec, and read JPEG files with libjpeg
+#if defined(LXPLATFORM_LINUX)
+ #define LX_HAS_BUILTIN_PNG 1
+ #define LX_HAS_BUILTIN_JPEG_READER 1
+#else
+ #define LX_HAS_BUILTIN_PNG 0
+ #define LX_HAS_BUILTIN_JPEG_READER 0
+#endif
 
 
 enum {
@@ -49,6 +61,9 @@ LXEXPORT char *LXCopyDefaultFileExtensionForImageUTI(const char *uti);
 LXEXPORT LXUInteger LXImageTypeFromUTI(const char *uti, LXUInteger *outPluginIndex);
 
 
+// creates a buffer with an explicit rowBytes (e.g. for readers that need extra padding)
+LXEXPORT LXPixelBufferRef LXPixelBufferCreateWithRowBytes(LXPoolRef pool, uint32_t w, uint32_t h, LXPixelFormat pixelFormat, size_t rowBytes, LXError *outError);
+
 // platform-dependent implementation for common formats
 LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromPathUsingNativeAPI_(LXUnibuffer unipath, LXInteger imageType, LXMapPtr properties, LXError *outError);
 
@@ -64,11 +79,18 @@ LXEXPORT LXSuccess LXPixelBufferWriteAsDPXImageToPath(LXPixelBufferRef pixbuf, L
 LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromTIFFImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
 LXEXPORT LXSuccess LXPixelBufferWriteAsTIFFImageToPath(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
 
+// PNG reader and writer (LXPixelBuffer_png.c)
+LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromPNGImageInMemory(const uint8_t *data, size_t len, LXMapPtr properties, LXError *outError);
+LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromPNGImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
+LXEXPORT LXSuccess LXPixelBufferWriteAsPNGImageToPath(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
+
 // JPEG reader and writer
 LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromJPEGImageInMemory(const uint8_t *jpegData, size_t jpegDataLen, LXMapPtr properties, LXError *outError);
+LXEXPORT LXPixelBufferRef LXPixelBufferCreateFromJPEGImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
 
 LXEXPORT LXSuccess LXPixelBufferWriteAsJPEGImageToPath(LXPixelBufferRef pixbuf, LXUnibuffer unipath, LXMapPtr properties, LXError *outError);
 
+// also accepts the planar YCbCr formats, which are written without resampling
 LXEXPORT LXSuccess LXPixelBufferWriteAsJPEGImageInMemory_raw422_(LXPixelBufferRef pixbuf, uint8_t **outBuffer, size_t *outBufferSize,
                                                         size_t *outBytesWritten,
                                                         LXMapPtr properties, LXError *outError);
@@ -88,6 +110,21 @@ LXEXPORT LXSuccess LXPxConvert_Any_(
                            LXUInteger dstYCbCrFormatID,
                            LXError *outError);
 
+// the same with a kLXAlphaConversion operation (see LXImageFunctions.h) applied to the pixels
+LXEXPORT LXSuccess LXPxConvert_Any_withAlphaConversion_(
+                           const uint8_t * LXRESTRICT aSrcBuffer,
+                           const uint32_t srcW, const uint32_t srcH, const size_t srcRowBytes,
+                           const LXPixelFormat srcPxFormat,
+                           uint8_t * LXRESTRICT aDstBuffer,
+                           const uint32_t dstW, const uint32_t dstH, const size_t dstRowBytes,
+                           const LXPixelFormat dstPxFormat,
+                           LXUInteger srcColorSpaceID,
+                           LXUInteger dstColorSpaceID,
+                           LXUInteger srcYCbCrFormatID,
+                           LXUInteger dstYCbCrFormatID,
+                           LXUInteger alphaConversion,
+                           LXError *outError);
+
 // utility used by CopyRegion/GetRegion functions.
 // modifies the region and its data pointer to fit within the source w/h, and clears the outside area to zero.
 // regionW or regionH may become zero if the region is entirely outside the source.
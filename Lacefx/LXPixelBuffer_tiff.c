@@ -19,6 +19,9 @@
 #include "LXImageFunctions.h"
 #include "LXHalfFloat.h"
 #include "LXColorFunctions.h"
+#include "LXParallel.h"
+#include "LXMutexAtomic.h"
+#include "LXBinaryUtils.h"
 
 #include <tiff.h>
 #include <tiffio.h>
@@ -59,6 +62,145 @@ static TIFF *lxTiffOpenUnipath(LXUnibuffer unibuf, const char *mode, LXError *ou
 
 #pragma mark --- read API ---
 
+// images smaller than this are decoded and encoded on the calling thread only
+#define TIFF_PARALLEL_MIN_PIXELS    (512 * 512)
+
+// state for decoding strips or tiles ("chunks") in parallel.
+// libTIFF handles can't be shared between threads, so each worker opens the file separately.
+typedef struct {
+    LXUnibuffer unipath;
+    TIFF *tiffs[kLXParallelMaxWorkers];
+    uint8_t *chunkBufs[kLXParallelMaxWorkers];
+    LXHalf *rowBufs[kLXParallelMaxWorkers];
+    
+    LXBool isTiled;
+    LXBool isSeparatePlanes;
+    uint32_t w, h;
+    uint32_t chunkW, chunkH;
+    LXInteger chunksAcross;
+    LXInteger chunksPerPlane;
+    size_t chunkSize;
+    uint16_t spp, bps, sampleFormat;
+    
+    uint8_t *dstData;
+    size_t dstRowBytes;
+    size_t dstBytesPerSample;
+    
+    volatile int32_t failed;
+} LXTIFFReadJob;
+
+
+// copies "srcSamples" samples per pixel into the RGBA destination starting at channel "firstSample".
+// 16-bit integer data must have been converted to half float before calling this.
+static void scatterTIFFRowToRGBA(const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst, const LXInteger n,
+                                 const LXInteger srcSamples, const LXInteger firstSample, const LXBool fillAlpha,
+                                 const size_t bytesPerSample)
+{
+    LXInteger x, c;
+    const LXInteger numToCopy = MIN(srcSamples, 4 - firstSample);
+    
+    if (srcSamples == 4 && firstSample == 0) {
+        memcpy(dst, src, n * 4 * bytesPerSample);
+        return;
+    }
+    
+    switch (bytesPerSample) {
+        case 1:
+            if (srcSamples == 3 && firstSample == 0) {
+                LXPxConvert_RGB_to_RGBA_int8(n, 1, (uint8_t *)src, n*3, 3, dst, n*4);
+                return;
+            }
+            for (x = 0; x < n; x++) {
+                for (c = 0; c < numToCopy; c++)  dst[x*4 + firstSample + c] = src[x*srcSamples + c];
+                if (fillAlpha)  dst[x*4 + 3] = 255;
+            }
+            break;
+        
+        case 2: {
+            const uint16_t *s = (const uint16_t *)src;
+            uint16_t *d = (uint16_t *)dst;
+            const uint16_t halfOne = 0x3c00;
+            for (x = 0; x < n; x++) {
+                for (c = 0; c < numToCopy; c++)  d[x*4 + firstSample + c] = s[x*srcSamples + c];
+                if (fillAlpha)  d[x*4 + 3] = halfOne;
+            }
+            break;
+        }
+        
+        case 4: {
+            const float *s = (const float *)src;
+            float *d = (float *)dst;
+            for (x = 0; x < n; x++) {
+                for (c = 0; c < numToCopy; c++)  d[x*4 + firstSample + c] = s[x*srcSamples + c];
+                if (fillAlpha)  d[x*4 + 3] = 1.0f;
+            }
+            break;
+        }
+    }
+}
+
+static void readTIFFChunk(void *userData, LXInteger workerIndex, LXInteger chunkIndex)
+{
+    LXTIFFReadJob *job = (LXTIFFReadJob *)userData;
+    if (job->failed) return;
+    
+    TIFF *tiff = job->tiffs[workerIndex];
+    if ( !tiff) {
+        if ( !(tiff = lxTiffOpenUnipath(job->unipath, "r", NULL))) {
+            LXAtomicInc_int32(&job->failed);
+            return;
+        }
+        job->tiffs[workerIndex] = tiff;
+    }
+    
+    const LXInteger srcSamples = (job->isSeparatePlanes) ? 1 : job->spp;
+    const size_t srcBytesPerSample = job->bps / 8;
+    const size_t srcRowBytes = job->chunkW * srcSamples * srcBytesPerSample;
+    const LXBool srcIsInt16 = (job->bps == 16 && job->sampleFormat != SAMPLEFORMAT_IEEEFP);
+    
+    if ( !job->chunkBufs[workerIndex])
+        job->chunkBufs[workerIndex] = _lx_malloc(job->chunkSize);
+    if (srcIsInt16 && !job->rowBufs[workerIndex])
+        job->rowBufs[workerIndex] = _lx_malloc(job->chunkW * srcSamples * sizeof(LXHalf));
+    
+    uint8_t *chunkBuf = job->chunkBufs[workerIndex];
+    
+    // libTIFF returns 16- and 32-bit samples in the native byte order, so swapping is not needed here
+    tsize_t readBytes = (job->isTiled) ? TIFFReadEncodedTile(tiff, (uint32_t)chunkIndex, chunkBuf, job->chunkSize)
+                                        : TIFFReadEncodedStrip(tiff, (uint32_t)chunkIndex, chunkBuf, job->chunkSize);
+    if (readBytes <= 0) {
+        printf("** TIFF reading failed at %s %ld\n", (job->isTiled) ? "tile" : "strip", (long)chunkIndex);
+        LXAtomicInc_int32(&job->failed);
+        return;
+    }
+    
+    const LXInteger plane = chunkIndex / job->chunksPerPlane;
+    const LXInteger indexInPlane = chunkIndex % job->chunksPerPlane;
+    const LXInteger x0 = (indexInPlane % job->chunksAcross) * job->chunkW;
+    const LXInteger y0 = (indexInPlane / job->chunksAcross) * job->chunkH;
+    const LXInteger cw = MIN(job->chunkW, job->w - x0);
+    LXInteger ch = MIN(job->chunkH, job->h - y0);
+    
+    // the last strip may be shorter
+    ch = MIN(ch, (LXInteger)(readBytes / srcRowBytes));
+    
+    const LXInteger firstSample = (job->isSeparatePlanes) ? plane : 0;
+    const LXBool fillAlpha = (job->spp == 3 && firstSample == 0);
+    if (firstSample > 3) return;
+    
+    LXInteger y;
+    for (y = 0; y < ch; y++) {
+        const uint8_t *src = chunkBuf + srcRowBytes * y;
+        uint8_t *dst = job->dstData + job->dstRowBytes * (y0 + y) + x0 * 4 * job->dstBytesPerSample;
+        
+        if (srcIsInt16) {
+            LXPxConvert_int16_to_float16((uint16_t *)src, job->rowBufs[workerIndex], cw * srcSamples, 65535);
+            src = (const uint8_t *)job->rowBufs[workerIndex];
+        }
+        scatterTIFFRowToRGBA(src, dst, cw, srcSamples, firstSample, fillAlpha, job->dstBytesPerSample);
+    }
+}
+
 LXPixelBufferRef LXPixelBufferCreateFromTIFFImageAtPath(LXUnibuffer unipath, LXMapPtr properties, LXError *outError)
 {
     ///NSLog(@"%s...", __func__);
@@ -68,21 +210,42 @@ LXPixelBufferRef LXPixelBufferCreateFromTIFFImageAtPath(LXUnibuffer unipath, LXM
         return NULL;
     }
     
-    // only a handful of possible TIFF formats are supported here.
+    // RGB(A) data with 8 or 16-bit integer or 16/32-bit float samples is supported here, in strips or tiles.
+    // alpha must be premultiplied, as the samples are returned as they are.
     // the caller (in LXPixelBuffer.c) will use the native API to try to open a file that we can't open.
-    uint16_t bps = 0, spp = 0;
+    uint16_t bps = 0, spp = 0, sampleFormat = SAMPLEFORMAT_UINT, planarConfig = PLANARCONFIG_CONTIG;
+    uint16_t photometric = 0, extraCount = 0;
+    uint16_t *extraTypes = NULL;
     uint32_t w, h;
-    uint32_t rowsPerStrip;
     LXBool ok = YES;
     
-    if (TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &bps) == 0 || (bps != 8 && bps != 16)) {
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planarConfig);
+    
+    if (TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &bps) == 0) {
         LXErrorSet(outError, 1862, "unsupported bit depth");
         ok = NO;
     }
+    else if ( !((sampleFormat == SAMPLEFORMAT_UINT && (bps == 8 || bps == 16))
+               || (sampleFormat == SAMPLEFORMAT_IEEEFP && (bps == 16 || bps == 32)))) {
+        LXErrorSet(outError, 1862, "unsupported bit depth or sample format");
+        ok = NO;
+    }
     if (ok && (TIFFGetField(tiff, TIFFTAG_SAMPLESPERPIXEL, &spp) == 0 || (spp != 3 && spp != 4))) {
         LXErrorSet(outError, 1862, "unsupported sample count");
         ok = NO;
     }
+    if (ok && (TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric) == 0 || photometric != PHOTOMETRIC_RGB)) {
+        LXErrorSet(outError, 1862, "unsupported photometric interpretation");
+        ok = NO;
+    }
+    if (ok) {
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_EXTRASAMPLES, &extraCount, &extraTypes);
+        if (extraCount != spp - 3 || (extraCount > 0 && ( !extraTypes || extraTypes[0] != EXTRASAMPLE_ASSOCALPHA))) {
+            LXErrorSet(outError, 1862, "unsupported extra samples (e.g. unassociated alpha)");
+            ok = NO;
+        }
+    }
     if (ok && (TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &w) == 0 || w < 1)) {
         LXErrorSet(outError, 1862, "invalid image width");
         ok = NO;
@@ -91,9 +254,48 @@ LXPixelBufferRef LXPixelBufferCreateFromTIFFImageAtPath(LXUnibuffer unipath, LXM
         LXErrorSet(outError, 1862, "invalid image height");
         ok = NO;
     }
-    if (ok && (TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip) == 0 || rowsPerStrip < 1)) {
-        LXErrorSet(outError, 1862, "invalid rows per strip value");
-        ok = NO;
+    
+    LXTIFFReadJob job;
+    memset(&job, 0, sizeof(job));
+    job.unipath = unipath;
+    job.isTiled = TIFFIsTiled(tiff) ? YES : NO;
+    job.isSeparatePlanes = (planarConfig == PLANARCONFIG_SEPARATE);
+    job.w = w;
+    job.h = h;
+    job.spp = spp;
+    job.bps = bps;
+    job.sampleFormat = sampleFormat;
+    
+    LXInteger chunkCount = 0;
+    if (ok && job.isTiled) {
+        if (TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &job.chunkW) == 0 || TIFFGetField(tiff, TIFFTAG_TILELENGTH, &job.chunkH) == 0
+                            || job.chunkW < 1 || job.chunkH < 1) {
+            LXErrorSet(outError, 1862, "invalid tile size");
+            ok = NO;
+        }
+        job.chunkSize = TIFFTileSize(tiff);
+        chunkCount = TIFFNumberOfTiles(tiff);
+    }
+    else if (ok) {
+        uint32_t rowsPerStrip = 0;
+        if (TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip) == 0 || rowsPerStrip < 1) {
+            LXErrorSet(outError, 1862, "invalid rows per strip value");
+            ok = NO;
+        }
+        job.chunkW = w;
+        job.chunkH = MIN(rowsPerStrip, h);
+        job.chunkSize = TIFFStripSize(tiff);
+        chunkCount = TIFFNumberOfStrips(tiff);
+    }
+    if (ok) {
+        job.chunksAcross = (w + job.chunkW - 1) / job.chunkW;
+        job.chunksPerPlane = job.chunksAcross * ((h + job.chunkH - 1) / job.chunkH);
+        
+        if (chunkCount != job.chunksPerPlane * ((job.isSeparatePlanes) ? spp : 1)
+                || job.chunkSize < (size_t)job.chunkW * ((job.isSeparatePlanes) ? 1 : spp) * (bps / 8)) {
+            LXErrorSet(outError, 1862, "unexpected strip or tile layout");
+            ok = NO;
+        }
     }
     
     if ( !ok) {
@@ -101,83 +303,52 @@ LXPixelBufferRef LXPixelBufferCreateFromTIFFImageAtPath(LXUnibuffer unipath, LXM
         return NULL;
     }
     
-    LXPixelFormat pxFormat = (bps == 16) ? kLX_RGBA_FLOAT16 : kLX_RGBA_INT8;
+    LXPixelFormat pxFormat;
+    if (bps == 8)
+        pxFormat = kLX_RGBA_INT8;
+    else if (bps == 32)
+        pxFormat = kLX_RGBA_FLOAT32;
+    else
+        pxFormat = kLX_RGBA_FLOAT16;  // 16-bit integer data is converted to half float
     
     LXSuccess success = NO;
-    uint8_t *tempBuf = NULL;
     LXSuccess didLock = NO;
     LXPixelBufferRef newPixbuf = LXPixelBufferCreate(NULL, w, h, pxFormat, outError);
     if ( !newPixbuf)
         goto bail;
         
-    size_t dstRowBytes = 0;
-    uint8_t *dstData = LXPixelBufferLockPixels(newPixbuf, &dstRowBytes, NULL, outError);
-    if ( !dstData)
+    job.dstData = LXPixelBufferLockPixels(newPixbuf, &job.dstRowBytes, NULL, outError);
+    if ( !job.dstData)
         goto bail;
 
     didLock = YES;
-
-    // libTIFF's strip reading will return 16-bit pixels in the native byte order, so swapping not needed here    
-    LXInteger stripSize = TIFFStripSize(tiff);
-    LXInteger stripCount = TIFFNumberOfStrips(tiff);
-    LXInteger stripRowBytes = stripSize / rowsPerStrip;
-    
-    tempBuf = _lx_malloc(stripSize);
+    job.dstBytesPerSample = LXBytesPerPixelForPixelFormat(pxFormat) / 4;
+    job.tiffs[0] = tiff;
     
-    uint16_t *tempHalfBuf = (pxFormat == kLX_RGBA_FLOAT16) ? _lx_malloc(dstRowBytes * rowsPerStrip) : NULL;
-
-    ///NSLog(@"%s: image size %i * %i -- strip size is %i; strip count %i; rows per strip %i -> stripRowBytes %i (dst rb %i)", 
-    ///        __func__, w, h, stripSize, stripCount, rowsPerStrip, stripRowBytes, dstRowBytes);
+    ///NSLog(@"%s: image size %i * %i -- tiled %i, chunk size %i * %i (%i bytes); chunk count %i", 
+    ///        __func__, w, h, job.isTiled, job.chunkW, job.chunkH, job.chunkSize, chunkCount);
 
+    const LXInteger maxWorkers = ((LXInteger)w * h >= TIFF_PARALLEL_MIN_PIXELS) ? 0 : 1;
     
-    LXInteger y = 0;
+    LXParallelApply(chunkCount, maxWorkers, readTIFFChunk, &job);
     
-    LXInteger i;
-    for (i = 0; i < stripCount; i++) {
-        LXInteger readBytes = TIFFReadEncodedStrip(tiff, i, tempBuf, stripSize);
-        if (readBytes <= 0) {
-            printf("** TIFF reading failed at strip %ld / %ld\n", (long)i, (long)stripCount);
-            goto bail;
-        }
-        LXInteger numRowsRead = (readBytes / stripRowBytes);
-        if ((numRowsRead * stripRowBytes) != readBytes) {
-            printf("** TIFF read bytes value differs from expected (%ld / %ld): is %ld, rows %ld, striprb %ld\n", (long)i, (long)stripCount, (long)readBytes, (long)numRowsRead, (long)stripRowBytes);
-            goto bail;
-        }
-        
-        uint8_t *src = tempBuf;
-        uint8_t *dst = dstData + dstRowBytes * y;
-        
-        if (pxFormat == kLX_RGBA_INT8) {
-            if (spp == 4) {
-                LXPxCopy_RGBA_int8(w, numRowsRead,  src, stripRowBytes,  dst, dstRowBytes);
-            } else {
-                LXPxConvert_RGB_to_RGBA_int8(w, numRowsRead,  src, stripRowBytes, 3,  dst, dstRowBytes);
-            }
-        }
-        // for 16-bit formats, need to use the second temp buffer for int->float16 conversion
-        else if (pxFormat == kLX_RGBA_FLOAT16) {
-            if (spp == 4) {
-                LXPxCopy_RGBA_int16(w, numRowsRead,  (uint16_t *)src, stripRowBytes,  tempHalfBuf, dstRowBytes);
-            } else {
-                LXPxConvert_RGB_to_RGBA_int16(w, numRowsRead,  (uint16_t *)src, stripRowBytes, 3,  tempHalfBuf, dstRowBytes, 65535);
-            }
-            
-            ///NSLog(@"... strip %i: num rows read: %i", i, numRowsRead);
-            LXPxConvert_int16_to_float16(tempHalfBuf, (LXHalf *)dst, numRowsRead * dstRowBytes / sizeof(LXHalf), 65535);
-        }
-        
-        y += numRowsRead;
+    success = (job.failed) ? NO : YES;
+    if ( !success) {
+        LXErrorSet(outError, 1863, "TIFF reading failed");
     }
-    success = YES;
-    
-    if (tempHalfBuf) _lx_free(tempHalfBuf);
         
 bail:
     ///NSLog(@"%s finished, ok: %i", __func__, success);
+    {
+    LXInteger i;
+    for (i = 0; i < kLXParallelMaxWorkers; i++) {
+        if (i > 0 && job.tiffs[i]) TIFFClose(job.tiffs[i]);
+        _lx_free(job.chunkBufs[i]);
+        _lx_free(job.rowBufs[i]);
+    }
+    }
     
     if (didLock) LXPixelBufferUnlockPixels(newPixbuf);
-    _lx_free(tempBuf);
     TIFFClose(tiff);
     if ( !success) {
         LXPixelBufferRelease(newPixbuf);
@@ -189,178 +360,331 @@ bail:
 
 #pragma mark --- write API ---
 
-
-static LXSuccess writeTIFFImage_RGBA_float16_to_int16(LXPixelBufferRef pixbuf,
-                                                            LXUnibuffer unipath,
-                                                            LXBool includeAlpha,
-                                                            uint8_t *iccData, size_t iccDataLen,
-                                                            LXError *outError)
-{
-    const LXUInteger w = LXPixelBufferGetWidth(pixbuf);
-    const LXUInteger h = LXPixelBufferGetHeight(pixbuf);
-    LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
-
-    if (pxFormat != kLX_RGBA_FLOAT16) {
-        LXErrorSet(outError, 1812, "invalid pixel format specified for native API writer (float16 expected)");  // this shouldn't happen (data should be converted before)
-        return NO;
-    }
-
-    LXBool retVal = NO;
+// the automatic rows-per-strip value aims for strips of roughly this uncompressed size
+#define TIFF_WRITE_TARGET_STRIP_BYTES   (256 * 1024)
+
+enum {
+    kTIFFSamples_Int8 = 0,
+    kTIFFSamples_Int16,
+    kTIFFSamples_Float16,
+    kTIFFSamples_Float32
+};
+
+typedef struct {
+    uint8_t *rawBuf;
+    uint8_t *compBuf;
+    uint8_t *tempRow;
+    size_t rawSize;
+    size_t compSize;
+} LXTIFFWriteSlot;
+
+// state for encoding strips or tiles in parallel.
+// workers fill and compress a batch of chunks into slots, then the calling thread writes the batch out in order.
+typedef struct {
+    const uint8_t *srcData;
+    size_t srcRowBytes;
+    size_t srcBytesPerPixel;
     
-    size_t srcRowBytes = 0;
-    LXHalf *srcData = (LXHalf *) LXPixelBufferLockPixels(pixbuf, &srcRowBytes, NULL, outError);
-    if ( !srcData) return NO;
+    LXInteger sampleType;
+    LXInteger spp;
+    size_t bytesPerSample;
     
-    size_t dstRowBytes = w * (includeAlpha ? 8 : 6);
-    uint16_t *tempRowData = _lx_malloc(dstRowBytes);
-
-    const uint16_t dstWhite = 65535;
+    LXBool isTiled;
+    uint32_t w, h;
+    uint32_t chunkW, chunkH;
+    LXInteger chunksAcross;
+    size_t chunkRowBytes;
     
-
-    TIFF *tiff;
-    if ((tiff = lxTiffOpenUnipath(unipath, "w", outError))) {
-        TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t)w);
-        TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t)h);
+    LXInteger compression;
+    LXBool usePredictor;
     
-        TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, (uint16_t)16);
-        TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)((includeAlpha) ? 4 : 3));
-        
-        TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 1);
+    LXInteger firstChunk;
+    LXTIFFWriteSlot *slots;
+    size_t compBufSize;
+    
+    volatile int32_t failed;
+} LXTIFFWriteJob;
 
-        TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
-        TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-        TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
 
-        TIFFSetField(tiff, TIFFTAG_XRESOLUTION, (float)72.0);
-        TIFFSetField(tiff, TIFFTAG_YRESOLUTION, (float)72.0);
-        TIFFSetField(tiff, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH);
-    
-        TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
-  
-        if (includeAlpha) {
-            uint16_t alphaInfo = EXTRASAMPLE_ASSOCALPHA;
-            TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, (uint32_t)1, &alphaInfo);
-        }
+static void gatherTIFFRowFromRGBA(const uint8_t * LXRESTRICT src, uint8_t * LXRESTRICT dst, const LXInteger n,
+                                  const LXInteger spp, const LXInteger sampleType)
+{
+    const uint16_t dstWhite = 65535;
+    LXInteger x;
     
-        if (iccData) {
-            TIFFSetField(tiff, TIFFTAG_ICCPROFILE, (uint32_t)iccDataLen, iccData);
-        }
-  
-        /*
-        tsize_t bytesWritten = TIFFWriteEncodedStrip(tiff, 0, dstData, dstRowBytes * h);
-        //NSLog(@"libtiff bytes written: %i", bytesWritten);
-        */
-        // write out each scanline as a strip
-        LXUInteger y;
-        for (y = 0; y < h; y++) {
-            uint16_t *src = (uint16_t *)((uint8_t *)srcData + srcRowBytes * y);
-            uint16_t *dataToWrite = tempRowData;
-            
-            if (includeAlpha) {
-                LXPxConvert_float16_to_int16(src, dataToWrite, w * 4, dstWhite);
-            } else {
-                LXPxConvert_RGB_float16_to_RGB_int16(w, 1,
-                                                     src, srcRowBytes, 4,
-                                                     dataToWrite, dstRowBytes,
-                                                     dstWhite);
-            }
+    switch (sampleType) {
+        case kTIFFSamples_Int8:
+            if (spp == 4)
+                memcpy(dst, src, n * 4);
+            else
+                LXPxConvert_RGBA_to_RGB_int8(n, 1,  (uint8_t *)src, n * 4, 4,  dst, n * 3, 3);
+            break;
             
-            tsize_t bytesWritten = TIFFWriteEncodedStrip(tiff, y, dataToWrite, dstRowBytes);
+        case kTIFFSamples_Int16:
+            if (spp == 4)
+                LXPxConvert_float16_to_int16((LXHalf *)src, (uint16_t *)dst, n * 4, dstWhite);
+            else
+                LXPxConvert_RGB_float16_to_RGB_int16(n, 1,  (LXHalf *)src, n * 8, 4,  (uint16_t *)dst, n * 6,  dstWhite);
+            break;
             
-            if (bytesWritten <= 0) {
-                LXErrorSet(outError, 1813, "unable to write file (disk may be full)");
-                break;
+        default: {
+            const size_t bytesPerSample = (sampleType == kTIFFSamples_Float16) ? 2 : 4;
+            if (spp == 4) {
+                memcpy(dst, src, n * 4 * bytesPerSample);
+            } else {
+                for (x = 0; x < n; x++) {
+                    memcpy(dst, src, 3 * bytesPerSample);
+                    src += 4 * bytesPerSample;
+                    dst += 3 * bytesPerSample;
+                }
             }
+            break;
         }
-        retVal = (y == h) ? YES : NO;
-        
-        TIFFClose(tiff);
     }
-
-    _lx_free(tempRowData);
-
-    LXPixelBufferUnlockPixels(pixbuf);    
-    return retVal;
 }
 
+// TIFF predictor 2: horizontal differencing of integer samples
+static void applyTIFFHorizontalPredictor(uint8_t *row, const LXInteger n, const LXInteger spp, const size_t bytesPerSample)
+{
+    LXInteger i;
+    if (bytesPerSample == 1) {
+        for (i = n * spp - 1; i >= spp; i--)
+            row[i] -= row[i - spp];
+    } else {
+        uint16_t *r = (uint16_t *)row;
+        for (i = n * spp - 1; i >= spp; i--)
+            r[i] -= r[i - spp];
+    }
+}
 
-static LXSuccess writeTIFFImage_RGBA_int8(LXPixelBufferRef pixbuf,
-                                                            LXUnibuffer unipath,
-                                                            LXBool includeAlpha,
-                                                            uint8_t *iccData, size_t iccDataLen,
-                                                            LXError *outError)
+// TIFF predictor 3: the bytes of each float sample are split into planes (most significant first),
+// then differenced bytewise. "tempRow" must be as large as the row.
+static void applyTIFFFloatPredictor(uint8_t *row, uint8_t *tempRow, const LXInteger n, const LXInteger spp, const size_t bytesPerSample)
 {
-    const LXUInteger w = LXPixelBufferGetWidth(pixbuf);
-    const LXUInteger h = LXPixelBufferGetHeight(pixbuf);
-    LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+    const LXInteger wc = n * spp;
+    const LXInteger cc = wc * bytesPerSample;
+    LXInteger i, b;
+    
+    memcpy(tempRow, row, cc);
+    for (i = 0; i < wc; i++) {
+        for (b = 0; b < (LXInteger)bytesPerSample; b++) {
+#if defined(__BIG_ENDIAN__)
+            row[b * wc + i] = tempRow[bytesPerSample * i + b];
+#else
+            row[(bytesPerSample - b - 1) * wc + i] = tempRow[bytesPerSample * i + b];
+#endif
+        }
+    }
+    for (i = cc - 1; i >= spp; i--)
+        row[i] -= row[i - spp];
+}
 
-    if (pxFormat != kLX_RGBA_INT8) {
-        LXErrorSet(outError, 1812, "invalid pixel format specified for native API writer (int8 expected)");  // this shouldn't happen (data should be converted before)
-        return NO;
+static void prepareTIFFChunk(void *userData, LXInteger workerIndex, LXInteger itemIndex)
+{
+    LXTIFFWriteJob *job = (LXTIFFWriteJob *)userData;
+    if (job->failed) return;
+    
+    LXTIFFWriteSlot *slot = job->slots + itemIndex;
+    const LXInteger chunkIndex = job->firstChunk + itemIndex;
+    const LXInteger x0 = (chunkIndex % job->chunksAcross) * job->chunkW;
+    const LXInteger y0 = (chunkIndex / job->chunksAcross) * job->chunkH;
+    const LXInteger validW = MIN(job->chunkW, job->w - x0);
+    const LXInteger validH = MIN(job->chunkH, job->h - y0);
+    
+    // tiles are always full-size, so partial tiles at the image edges are padded with zeros
+    const LXInteger rows = (job->isTiled) ? job->chunkH : validH;
+    if (validW < job->chunkW || validH < rows)
+        memset(slot->rawBuf, 0, job->chunkRowBytes * rows);
+    
+    LXInteger y;
+    for (y = 0; y < validH; y++) {
+        const uint8_t *src = job->srcData + job->srcRowBytes * (y0 + y) + job->srcBytesPerPixel * x0;
+        gatherTIFFRowFromRGBA(src, slot->rawBuf + job->chunkRowBytes * y, validW, job->spp, job->sampleType);
+    }
+    slot->rawSize = job->chunkRowBytes * rows;
+    slot->compSize = 0;
+    
+    // LZW is left to libTIFF on the writing thread, and it also applies the predictor in that case
+    if (job->compression != kLXTIFFCompression_Deflate)
+        return;
+    
+    if (job->usePredictor) {
+        const LXBool isFloat = (job->sampleType == kTIFFSamples_Float16 || job->sampleType == kTIFFSamples_Float32);
+        for (y = 0; y < rows; y++) {
+            uint8_t *row = slot->rawBuf + job->chunkRowBytes * y;
+            if (isFloat)
+                applyTIFFFloatPredictor(row, slot->tempRow, job->chunkW, job->spp, job->bytesPerSample);
+            else
+                applyTIFFHorizontalPredictor(row, job->chunkW, job->spp, job->bytesPerSample);
+        }
+    }
+    
+    if ( !LXSimpleDeflate(slot->rawBuf, slot->rawSize, slot->compBuf, job->compBufSize, &slot->compSize)) {
+        printf("** TIFF compression failed at chunk %ld\n", (long)chunkIndex);
+        LXAtomicInc_int32(&job->failed);
     }
+}
 
+static LXSuccess writeTIFFImage(LXPixelBufferRef pixbuf,
+                                LXUnibuffer unipath,
+                                LXInteger sampleType,
+                                LXBool includeAlpha,
+                                LXInteger compression,
+                                LXBool usePredictor,
+                                LXInteger rowsPerStrip,
+                                LXInteger tileSize,
+                                uint8_t *iccData, size_t iccDataLen,
+                                LXError *outError)
+{
+    LXTIFFWriteJob job;
+    memset(&job, 0, sizeof(job));
+    job.w = LXPixelBufferGetWidth(pixbuf);
+    job.h = LXPixelBufferGetHeight(pixbuf);
+    job.sampleType = sampleType;
+    job.spp = (includeAlpha) ? 4 : 3;
+    job.bytesPerSample = (sampleType == kTIFFSamples_Int8) ? 1 : ((sampleType == kTIFFSamples_Float32) ? 4 : 2);
+    job.srcBytesPerPixel = LXBytesPerPixelForPixelFormat(LXPixelBufferGetPixelFormat(pixbuf));
+    job.compression = compression;
+    job.usePredictor = (compression != kLXTIFFCompression_None) ? usePredictor : NO;
+    
+    const LXBool isFloat = (sampleType == kTIFFSamples_Float16 || sampleType == kTIFFSamples_Float32);
+    const LXBool inParallel = ((LXInteger)job.w * job.h >= TIFF_PARALLEL_MIN_PIXELS);
+    const LXInteger numWorkers = (inParallel) ? LXParallelGetWorkerCount() : 1;
+    
+    if (tileSize > 0) {
+        // the TIFF spec requires tile dimensions to be multiples of 16
+        job.isTiled = YES;
+        job.chunkW = job.chunkH = (uint32_t)(((tileSize + 15) / 16) * 16);
+    } else {
+        if (rowsPerStrip < 1) {
+            // large enough for deflate to be effective, but small enough that every worker gets a few strips
+            const size_t rowBytes = job.w * job.spp * job.bytesPerSample;
+            const LXInteger rowsForWorkers = (job.h + numWorkers * 4 - 1) / (numWorkers * 4);
+            rowsPerStrip = MAX(1, TIFF_WRITE_TARGET_STRIP_BYTES / rowBytes);
+            rowsPerStrip = MIN(rowsPerStrip, MAX(16, rowsForWorkers));
+        }
+        job.chunkW = job.w;
+        job.chunkH = (uint32_t)MIN(rowsPerStrip, (LXInteger)job.h);
+    }
+    job.chunksAcross = (job.w + job.chunkW - 1) / job.chunkW;
+    job.chunkRowBytes = job.chunkW * job.spp * job.bytesPerSample;
+    
+    const LXInteger chunkCount = job.chunksAcross * ((job.h + job.chunkH - 1) / job.chunkH);
+    const LXInteger batchSize = MIN(chunkCount, numWorkers * 4);
+    const size_t chunkSize = job.chunkRowBytes * job.chunkH;
+    
+    // zlib's worst case expansion is well below this
+    job.compBufSize = chunkSize + chunkSize / 8 + 64;
+    
     LXBool retVal = NO;
+    LXInteger i;
     
-    size_t srcRowBytes = 0;
-    uint8_t *srcData = (uint8_t *) LXPixelBufferLockPixels(pixbuf, &srcRowBytes, NULL, outError);
-    if ( !srcData) return NO;
+    job.srcData = LXPixelBufferLockPixels(pixbuf, &job.srcRowBytes, NULL, outError);
+    if ( !job.srcData) return NO;
     
-    size_t dstRowBytes = w * (includeAlpha ? 4 : 3);
-    uint8_t *tempRowData = _lx_malloc(dstRowBytes);  // * h);
+    job.slots = _lx_calloc(batchSize, sizeof(LXTIFFWriteSlot));
+    for (i = 0; i < batchSize; i++) {
+        job.slots[i].rawBuf = _lx_malloc(chunkSize);
+        if (compression == kLXTIFFCompression_Deflate) {
+            job.slots[i].compBuf = _lx_malloc(job.compBufSize);
+            job.slots[i].tempRow = _lx_malloc(job.chunkRowBytes);
+        }
+    }
 
     TIFF *tiff;
     if ((tiff = lxTiffOpenUnipath(unipath, "w", outError))) {
-        TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, w);
-        TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, h);
+        TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t)job.w);
+        TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t)job.h);
     
-        TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
-        TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, (includeAlpha) ? 4 : 3);
+        TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, (uint16_t)(job.bytesPerSample * 8));
+        TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)job.spp);
         
-        TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 1);
+        if (job.isTiled) {
+            TIFFSetField(tiff, TIFFTAG_TILEWIDTH, (uint32_t)job.chunkW);
+            TIFFSetField(tiff, TIFFTAG_TILELENGTH, (uint32_t)job.chunkH);
+        } else {
+            TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, (uint32_t)job.chunkH);
+        }
 
-        TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);    
+        switch (compression) {
+            case kLXTIFFCompression_LZW:        TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_LZW);  break;
+            case kLXTIFFCompression_Deflate:    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);  break;
+            default:                            TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);  break;
+        }
+        // the predictor tag is only known to libTIFF after a compression scheme that uses it has been set
+        if (job.usePredictor) {
+            TIFFSetField(tiff, TIFFTAG_PREDICTOR, (isFloat) ? PREDICTOR_FLOATINGPOINT : PREDICTOR_HORIZONTAL);
+        }
+        
         TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
         TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
 
-        TIFFSetField(tiff, TIFFTAG_XRESOLUTION, 72.0);
-        TIFFSetField(tiff, TIFFTAG_YRESOLUTION, 72.0);
+        TIFFSetField(tiff, TIFFTAG_XRESOLUTION, (float)72.0);
+        TIFFSetField(tiff, TIFFTAG_YRESOLUTION, (float)72.0);
         TIFFSetField(tiff, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH);
     
-        TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
+        TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, (isFloat) ? SAMPLEFORMAT_IEEEFP : SAMPLEFORMAT_UINT);
   
         if (includeAlpha) {
             uint16_t alphaInfo = EXTRASAMPLE_ASSOCALPHA;
-            TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, (int)1, &alphaInfo);
+            TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, (uint32_t)1, &alphaInfo);
         }
     
         if (iccData) {
-            TIFFSetField(tiff, TIFFTAG_ICCPROFILE, (int)iccDataLen, iccData);
+            TIFFSetField(tiff, TIFFTAG_ICCPROFILE, (uint32_t)iccDataLen, iccData);
         }
         
-        // write out each scanline as a strip
-        LXUInteger y;
-        for (y = 0; y < h; y++) {
-            uint8_t *src = ((uint8_t *)srcData + srcRowBytes * y);
-            uint8_t *dataToWrite = src;
-            
-            if ( !includeAlpha) {
-                LXPxConvert_RGBA_to_RGB_int8(w, 1,  src, srcRowBytes, 4,  tempRowData, dstRowBytes, 3);
-                dataToWrite = tempRowData;
-            }
+        ///NSLog(@"%s: image size %i * %i -- tiled %i, chunk size %i * %i; chunk count %i, compression %i",
+        ///        __func__, job.w, job.h, job.isTiled, job.chunkW, job.chunkH, chunkCount, compression);
+        
+        LXInteger n = 0;
+        LXBool ok = YES;
+        while (ok && n < chunkCount) {
+            const LXInteger count = MIN(batchSize, chunkCount - n);
+            job.firstChunk = n;
             
-            tsize_t bytesWritten = TIFFWriteEncodedStrip(tiff, y, dataToWrite, dstRowBytes);
+            LXParallelApply(count, (inParallel) ? 0 : 1, prepareTIFFChunk, &job);
             
-            if (bytesWritten <= 0) {
-                LXErrorSet(outError, 1813, "unable to write file (disk may be full)");
+            if (job.failed) {
+                LXErrorSet(outError, 1814, "TIFF compression failed");
+                ok = NO;
                 break;
             }
+            
+            for (i = 0; i < count; i++) {
+                LXTIFFWriteSlot *slot = job.slots + i;
+                const uint32_t chunkIndex = (uint32_t)(n + i);
+                tsize_t bytesWritten;
+                
+                if (compression == kLXTIFFCompression_LZW) {
+                    bytesWritten = (job.isTiled) ? TIFFWriteEncodedTile(tiff, chunkIndex, slot->rawBuf, slot->rawSize)
+                                                 : TIFFWriteEncodedStrip(tiff, chunkIndex, slot->rawBuf, slot->rawSize);
+                } else {
+                    uint8_t *data = (compression == kLXTIFFCompression_Deflate) ? slot->compBuf : slot->rawBuf;
+                    size_t dataSize = (compression == kLXTIFFCompression_Deflate) ? slot->compSize : slot->rawSize;
+                
+                    bytesWritten = (job.isTiled) ? TIFFWriteRawTile(tiff, chunkIndex, data, dataSize)
+                                                 : TIFFWriteRawStrip(tiff, chunkIndex, data, dataSize);
+                }
+                if (bytesWritten <= 0) {
+                    LXErrorSet(outError, 1813, "unable to write file (disk may be full)");
+                    ok = NO;
+                    break;
+                }
+            }
+            n += count;
         }
-        retVal = (y == h) ? YES : NO;
+        retVal = ok;
         
         TIFFClose(tiff);
     }
 
-    _lx_free(tempRowData);
+    for (i = 0; i < batchSize; i++) {
+        _lx_free(job.slots[i].rawBuf);
+        _lx_free(job.slots[i].compBuf);
+        _lx_free(job.slots[i].tempRow);
+    }
+    _lx_free(job.slots);
 
     LXPixelBufferUnlockPixels(pixbuf);    
     return retVal;
@@ -377,12 +701,38 @@ LXSuccess LXPixelBufferWriteAsTIFFImageToPath(LXPixelBufferRef pixbuf, LXUnibuff
     LXUInteger pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
     
     LXBool includeAlpha = NO;
+    LXBool floatSamples = NO;
+    LXBool usePredictor = YES;
     LXInteger preferredBitDepth = 8;
     LXInteger colorSpaceID = 0;
+    LXInteger compression = kLXTIFFCompression_None;
+    LXInteger rowsPerStrip = 0;
+    LXInteger tileSize = 0;
     if (properties) {
         LXMapGetBool(properties, kLXPixelBufferFormatRequestKey_AllowAlpha, &includeAlpha);
         LXMapGetInteger(properties, kLXPixelBufferAttachmentKey_ColorSpaceEncoding, &colorSpaceID);
         LXMapGetInteger(properties, kLXPixelBufferFormatRequestKey_PreferredBitsPerChannel, &preferredBitDepth);
+        LXMapGetBool(properties, kLXPixelBufferFormatRequestKey_FloatSamples, &floatSamples);
+        LXMapGetInteger(properties, kLXPixelBufferFormatRequestKey_TIFFCompression, &compression);
+        LXMapGetBool(properties, kLXPixelBufferFormatRequestKey_TIFFPredictor, &usePredictor);
+        LXMapGetInteger(properties, kLXPixelBufferFormatRequestKey_TIFFRowsPerStrip, &rowsPerStrip);
+        LXMapGetInteger(properties, kLXPixelBufferFormatRequestKey_TIFFTileSize, &tileSize);
+    }
+    
+    // 32 bits per channel is always written as float; 16 bits can be either half float or integer
+    LXInteger sampleType;
+    LXPixelFormat srcPxFormat;
+    if (preferredBitDepth == 32) {
+        sampleType = kTIFFSamples_Float32;
+        srcPxFormat = kLX_RGBA_FLOAT32;
+    }
+    else if (preferredBitDepth == 16) {
+        sampleType = (floatSamples) ? kTIFFSamples_Float16 : kTIFFSamples_Int16;
+        srcPxFormat = kLX_RGBA_FLOAT16;
+    }
+    else {
+        sampleType = kTIFFSamples_Int8;
+        srcPxFormat = kLX_RGBA_INT8;
     }
     
     uint8_t *iccDataBuf = NULL;
@@ -394,28 +744,16 @@ LXSuccess LXPixelBufferWriteAsTIFFImageToPath(LXPixelBufferRef pixbuf, LXUnibuff
     LXPixelBufferRef tempPixbuf = NULL;
     LXSuccess retVal = NO;
 
-    if (preferredBitDepth == 16) {
-        if (pxFormat == kLX_RGBA_FLOAT16) {
-            retVal = writeTIFFImage_RGBA_float16_to_int16(pixbuf, unipath, includeAlpha, iccDataBuf, iccDataLen, outError);
-        }
-        else {
-            tempPixbuf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_FLOAT16, outError);
-            
-            if (tempPixbuf && LXPixelBufferCopyPixelBufferWithPixelFormatConversion(tempPixbuf, pixbuf, outError)) {
-                retVal = writeTIFFImage_RGBA_float16_to_int16(tempPixbuf, unipath, includeAlpha, iccDataBuf, iccDataLen, outError);
-            }
-        }        
+    if (pxFormat == srcPxFormat) {
+        retVal = writeTIFFImage(pixbuf, unipath, sampleType, includeAlpha, compression, usePredictor, rowsPerStrip, tileSize,
+                                iccDataBuf, iccDataLen, outError);
     }
-    else {  // write 8-bit
-        if (pxFormat == kLX_RGBA_INT8) {
-            retVal = writeTIFFImage_RGBA_int8(pixbuf, unipath, includeAlpha, iccDataBuf, iccDataLen, outError);
-        }
-        else {
-            tempPixbuf = LXPixelBufferCreate(NULL, w, h, kLX_RGBA_INT8, outError);
-            
-            if (tempPixbuf && LXPixelBufferCopyPixelBufferWithPixelFormatConversion(tempPixbuf, pixbuf, outError)) {
-                retVal = writeTIFFImage_RGBA_int8(tempPixbuf, unipath, includeAlpha, iccDataBuf, iccDataLen, outError);
-            }            
+    else {
+        tempPixbuf = LXPixelBufferCreate(NULL, w, h, srcPxFormat, outError);
+        
+        if (tempPixbuf && LXPixelBufferCopyPixelBufferWithPixelFormatConversion(tempPixbuf, pixbuf, outError)) {
+            retVal = writeTIFFImage(tempPixbuf, unipath, sampleType, includeAlpha, compression, usePredictor, rowsPerStrip, tileSize,
+                                    iccDataBuf, iccDataLen, outError);
         }
     }
             
@@ -0,0 +1,227 @@
+/*
+ *  LXPlatform_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXPlatform_cpu.h"
+#include "LXMutex.h"
+#include "LXRandomGen.h"
+#include "LXStringUtils.h"
+#include "LXPool.h"
+
+#if defined(LXPLATFORM_LINUX)
+
+#include <stdio.h>
+#include <pthread.h>
+
+
+static LXPoolRef g_lxPoolForMainThread = NULL;
+
+static LXMutex s_lxAtomicMutex;
+LXMutexPtr g_lxAtomicLock = NULL;
+LXBool g_lxLocksInited = NO;
+
+// surface access is recursive so that drawing functions can be called within a BeginAccess/EndAccess block
+static pthread_mutex_t s_lxCtxMutex;
+
+static pthread_t g_mainThread;
+static int g_lxInited = NO;
+
+
+LXVersion LXLibraryVersion()
+{
+    LXVersion ver = { LXLIBVERSION_LATEST_MAJOR, LXLIBVERSION_LATEST_MINOR, LXLIBVERSION_LATEST_MILLI, 0 };
+    return ver;
+}
+
+const char *LXPlatformGetID()
+{
+#if defined(__x86_64__)
+    return "Linux-x86_64-Software";
+#elif defined(__aarch64__)
+    return "Linux-ARM64-Software";
+#else
+    return "Linux-i386-Software";
+#endif
+}
+
+
+void LXPlatformCreateLocks_()
+{
+    if ( !g_lxAtomicLock) {
+        LXMutexInit(&s_lxAtomicMutex);
+        g_lxAtomicLock = &s_lxAtomicMutex;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&s_lxCtxMutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        g_lxLocksInited = YES;
+    }
+}
+
+
+LXSuccess LXPlatformInitialize()
+{
+    if (g_lxInited) return YES;
+
+    // --- Lacefx standard initialization ---
+
+    if (LXPoolCurrentForThread() == NULL) {
+        g_lxPoolForMainThread = LXPoolCreateForThread();
+        LXPrintf("LX platform init: created base pool\n");
+    }
+
+    LXPlatformCreateLocks_();
+
+    LXRdSeed();
+
+    g_mainThread = pthread_self();
+
+    g_lxInited = YES;
+    return YES;
+}
+
+void LXPlatformDeinitialize()
+{
+    LXPoolRelease(g_lxPoolForMainThread);
+    g_lxPoolForMainThread = NULL;
+}
+
+void LXPlatformDoPeriodicCleanUp()
+{
+    LXPoolPurge(g_lxPoolForMainThread);
+}
+
+
+
+#pragma mark --- threading ---
+
+LXBool LXPlatformCurrentThreadIsMain()
+{
+    if ( !g_lxInited) {
+        LXPlatformLogInfo("warning: LX platform was not inited");
+        return NO;
+    }
+    return (pthread_equal(pthread_self(), g_mainThread)) ? YES : NO;
+}
+
+LXSuccess LXSurfaceBeginAccessOnThread(LXUInteger flags)
+{
+    LXPlatformCreateLocks_();
+
+    pthread_mutex_lock(&s_lxCtxMutex);
+    return YES;
+}
+
+void LXSurfaceEndAccessOnThread()
+{
+    pthread_mutex_unlock(&s_lxCtxMutex);
+}
+
+
+
+#pragma mark --- native context ---
+
+void *LXPlatformSharedNativeGraphicsContext()
+{
+    return NULL;
+}
+
+uint32_t LXPlatformMainDisplayIdentifier()
+{
+    return 0;
+}
+
+
+
+#pragma mark --- device info ---
+
+void LXPlatformGetHWMaxTextureSize(int *outW, int *outH)
+{
+    // no hardware limit; this is large enough for any pixel buffer that fits in memory comfortably
+    if (outW) *outW = 16384;
+    if (outH) *outH = 16384;
+}
+
+uint32_t LXPlatformGetGPUClass()
+{
+    return kLXGPUClass_Unknown;
+}
+
+LXBool LXPlatformHWSupportsFloatRenderTargets()
+{
+    return YES;
+}
+
+LXBool LXPlatformHWSupportsFilteringForFloatTextures()
+{
+    return YES;
+}
+
+LXBool LXPlatformHWSupportsYCbCrTextures()
+{
+    return NO;
+}
+
+
+
+#pragma mark --- logging ---
+
+// on Linux, the native string type is a UTF-8 C string
+
+void LXPlatformLogInfo(void *a)
+{
+    const char *str = (const char *)a;
+    if ( !str) return;
+
+    fprintf(stdout, "%s\n", str);
+}
+
+void LXPlatformLogError(void *a)
+{
+    const char *str = (const char *)a;
+    if ( !str) return;
+
+    fprintf(stderr, "%s\n", str);
+}
+
+
+
+#pragma mark --- system info ---
+
+LXBool LXPlatformGetSystemGUID(uint8_t **outData, size_t *outDataSize)
+{
+    if ( !outData || !outDataSize) return NO;
+
+    FILE *file = fopen("/etc/machine-id", "r");
+    if ( !file) file = fopen("/var/lib/dbus/machine-id", "r");
+    if ( !file) return NO;
+
+    char buf[64];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+
+    while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r' || buf[len-1] == ' '))
+        len--;
+
+    if (len < 1) return NO;
+
+    *outData = _lx_malloc(len);
+    memcpy(*outData, buf, len);
+    *outDataSize = len;
+    return YES;
+}
+
+
+#endif  // LXPLATFORM_LINUX
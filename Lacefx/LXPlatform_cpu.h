@@ -0,0 +1,46 @@
+/*
+ *  LXPlatform_cpu.h
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+
+#ifndef _LXPLATFORM_CPU_H_
+#define _LXPLATFORM_CPU_H_
+
+#include "LXBasicTypes.h"
+#include "LXPlatform.h"
+#include "LXTexture.h"
+#include "LXSurface.h"
+#include "LXShader.h"
+#include "LXPixelBuffer.h"
+
+/*
+  The software renderer is used on Linux. Surfaces and textures are LXPixelBuffers in main memory,
+  shaders are compiled for LXShaderEvaluateIntoPixelBuffer(), and drawing is done by a multithreaded rasterizer.
+  There's no native graphics context; LXPlatformSharedNativeGraphicsContext() returns NULL.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+LXEXPORT LXSuccess LXPlatformInitialize();
+LXEXPORT void LXPlatformDeinitialize();
+
+LXEXPORT void LXPlatformDoPeriodicCleanUp();
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,12 +15,24 @@
 #define _LXRANDOMFUNCTIONS_H_
 
 #include "LXBasicTypes.h"
+#include "LXRefTypes.h"
 
 
 // forward declaration of randomizer state object
 typedef struct _lxrs_state_s *LXRdStatePtr;
 
 
+enum {
+    kLXErrorID_RandomGen_EmptyArg = 7301,
+    kLXErrorID_RandomGen_UnsupportedPixelFormat
+};
+
+enum {
+    kLXRdDistribution_Uniform = 0,      // parameters are lower and upper bounds
+    kLXRdDistribution_Gaussian          // parameters are mean and sigma
+};
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -59,6 +71,34 @@ LXEXPORT int32_t	LXRdUniform_i32(int32_t lower, int32_t upper);
 LXEXPORT int64_t	LXRdUniform_i64(int64_t lower, int64_t upper);
 
 
+// --- counter-based functions (Philox4x32-10) ---
+//
+// Each value is a pure function of (seed, stream, index), so there is no state to share between threads,
+// and the same values come out regardless of how the work is split up: e.g. per-pixel noise can use the pixel's
+// index in the image. Different streams with the same seed are independent sequences.
+// Values are generated in blocks of four, so consecutive indices are the cheapest to generate together.
+
+// the raw 128-bit output for counter block "block" (i.e. values 4*block to 4*block+3)
+LXEXPORT void		LXRdCounterBlock(uint64_t seed, uint64_t stream, uint64_t block, uint32_t outWords[4]);
+
+// uniform values are in [lower, upper); 24 bits of randomness
+LXEXPORT float		LXRdCounterUniform(uint64_t seed, uint64_t stream, uint64_t index, float lower, float upper);
+LXEXPORT float		LXRdCounterGaussian(uint64_t seed, uint64_t stream, uint64_t index, float mean, float sigma);
+
+// bulk versions: fill "count" values starting at "firstIndex"; these give the same values as the functions above
+LXEXPORT void		LXRdCounterFillUniform(uint64_t seed, uint64_t stream, uint64_t firstIndex,
+                                           float *outValues, size_t count, float lower, float upper);
+LXEXPORT void		LXRdCounterFillGaussian(uint64_t seed, uint64_t stream, uint64_t firstIndex,
+                                            float *outValues, size_t count, float mean, float sigma);
+
+// fills the color channels of a pixel buffer with noise and sets alpha to 1; "distribution" is one of the kLXRdDistribution_* values.
+// channel c of pixel (x, y) uses index (y * width + x) * 4 + c, with c in R, G, B order for all pixel formats
+// (luminance uses c = 0). int8 values are clamped to 0-1. supports RGBA/ARGB/BGRA int8, RGBA float16/32 and luminance formats.
+// large buffers are filled on multiple threads
+LXEXPORT LXSuccess	LXRdCounterFillPixelBuffer(LXPixelBufferRef pixbuf, uint64_t seed, uint64_t stream,
+                                               LXUInteger distribution, float param1, float param2,
+                                               LXError *outError);
+
 
 
 // --- macros that return an LXInteger-sized (=native-width integer) value ---
@@ -0,0 +1,375 @@
+/*
+ *  LXRandomGen_philox.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXRandomGen.h"
+#include "LXPixelBuffer.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/*
+  Philox4x32-10 from Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3" (SC11).
+  The 128-bit counter is (block low, block high, stream low, stream high) and the 64-bit key is the seed.
+*/
+
+#define PHILOX_M0   0xD2511F53u
+#define PHILOX_M1   0xCD9E8D57u
+#define PHILOX_W0   0x9E3779B9u
+#define PHILOX_W1   0xBB67AE85u
+
+// number of blocks generated at a time by the bulk functions
+#define CHUNKBLOCKS     256
+
+
+#pragma mark --- generator ---
+
+static void philoxBlock(uint64_t seed, uint64_t stream, uint64_t block, uint32_t *out)
+{
+    uint32_t c0 = (uint32_t)block, c1 = (uint32_t)(block >> 32);
+    uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    LXInteger r;
+
+    for (r = 0; r < 10; r++) {
+        const uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        const uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        const uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        const uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+#if defined(__SSE2__)
+
+// 32*32 -> 64 bit multiply of each lane; SSE2 only multiplies the even lanes, so the odd ones are shifted down
+LXINLINE void mulHiLo(__m128i a, __m128i m, __m128i *outHi, __m128i *outLo)
+{
+    const __m128i evenMask = _mm_setr_epi32(-1, 0, -1, 0);
+    const __m128i pEven = _mm_mul_epu32(a, m);
+    const __m128i pOdd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+
+    *outLo = _mm_or_si128(_mm_and_si128(pEven, evenMask), _mm_slli_epi64(pOdd, 32));
+    *outHi = _mm_or_si128(_mm_srli_epi64(pEven, 32), _mm_andnot_si128(evenMask, pOdd));
+}
+
+// four consecutive blocks at once, one block per lane
+static void philoxBlocks4(uint64_t seed, uint64_t stream, uint64_t block, uint32_t *out)
+{
+    const __m128i m0 = _mm_set1_epi32((int)PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32((int)PHILOX_M1);
+    const uint64_t b1 = block + 1, b2 = block + 2, b3 = block + 3;
+    __m128i c0 = _mm_setr_epi32((int)(uint32_t)block, (int)(uint32_t)b1, (int)(uint32_t)b2, (int)(uint32_t)b3);
+    __m128i c1 = _mm_setr_epi32((int)(uint32_t)(block >> 32), (int)(uint32_t)(b1 >> 32), (int)(uint32_t)(b2 >> 32), (int)(uint32_t)(b3 >> 32));
+    __m128i c2 = _mm_set1_epi32((int)(uint32_t)stream);
+    __m128i c3 = _mm_set1_epi32((int)(uint32_t)(stream >> 32));
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    LXInteger r;
+
+    for (r = 0; r < 10; r++) {
+        __m128i hi0, lo0, hi1, lo1;
+        mulHiLo(c0, m0, &hi0, &lo0);
+        mulHiLo(c2, m1, &hi1, &lo1);
+
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // from one word per vector to one block per vector
+    {
+    __m128 t0 = _mm_castsi128_ps(c0), t1 = _mm_castsi128_ps(c1), t2 = _mm_castsi128_ps(c2), t3 = _mm_castsi128_ps(c3);
+    _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+    _mm_storeu_ps((float *)(out + 0), t0);
+    _mm_storeu_ps((float *)(out + 4), t1);
+    _mm_storeu_ps((float *)(out + 8), t2);
+    _mm_storeu_ps((float *)(out + 12), t3);
+    }
+}
+
+#endif
+
+static void fillBlocks(uint64_t seed, uint64_t stream, uint64_t block, uint32_t *out, LXInteger blockCount)
+{
+    LXInteger i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= blockCount; i += 4) {
+        philoxBlocks4(seed, stream, block + i, out + i*4);
+    }
+#endif
+    for (; i < blockCount; i++) {
+        philoxBlock(seed, stream, block + i, out + i*4);
+    }
+}
+
+LXINLINE float unitFloat(uint32_t u)
+{
+    return (float)(u >> 8) * (1.0f / 16777216.0f);
+}
+
+// Box-Muller with both outputs; u1 is mapped to (0, 1] so that the log is finite
+LXINLINE void gaussianPair(uint32_t u1, uint32_t u2, float *outCos, float *outSin)
+{
+    const float r = sqrtf(-2.0f * logf((float)((u1 >> 8) + 1) * (1.0f / 16777216.0f)));
+    const float theta = 6.2831853f * unitFloat(u2);
+    *outCos = r * cosf(theta);
+    *outSin = r * sinf(theta);
+}
+
+
+#pragma mark --- values ---
+
+void LXRdCounterBlock(uint64_t seed, uint64_t stream, uint64_t block, uint32_t outWords[4])
+{
+    if ( !outWords) return;
+    philoxBlock(seed, stream, block, outWords);
+}
+
+float LXRdCounterUniform(uint64_t seed, uint64_t stream, uint64_t index, float lower, float upper)
+{
+    uint32_t w[4];
+    philoxBlock(seed, stream, index >> 2, w);
+    return lower + (upper - lower) * unitFloat(w[index & 3]);
+}
+
+float LXRdCounterGaussian(uint64_t seed, uint64_t stream, uint64_t index, float mean, float sigma)
+{
+    uint32_t w[4];
+    float gc, gs;
+    philoxBlock(seed, stream, index >> 2, w);
+    gaussianPair(w[index & 2], w[(index & 2) + 1], &gc, &gs);
+    return mean + sigma * ((index & 1) ? gs : gc);
+}
+
+void LXRdCounterFillUniform(uint64_t seed, uint64_t stream, uint64_t firstIndex,
+                            float *outValues, size_t count, float lower, float upper)
+{
+    uint32_t words[CHUNKBLOCKS * 4];
+    const float range = upper - lower;
+    uint64_t block = firstIndex >> 2;
+    size_t skip = (size_t)(firstIndex & 3);
+    size_t done = 0;
+
+    if ( !outValues) return;
+
+    while (done < count) {
+        const LXInteger blockCount = (LXInteger)MIN((size_t)CHUNKBLOCKS, (count - done + skip + 3) / 4);
+        const size_t n = MIN((size_t)blockCount * 4 - skip, count - done);
+        const uint32_t *src = words + skip;
+        float *dst = outValues + done;
+        size_t i = 0;
+
+        fillBlocks(seed, stream, block, words, blockCount);
+
+#if defined(__SSE2__)
+        {
+        const __m128 vLower = _mm_set1_ps(lower);
+        const __m128 vRange = _mm_set1_ps(range);
+        const __m128 vScale = _mm_set1_ps(1.0f / 16777216.0f);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i u = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(src + i)), 8);
+            _mm_storeu_ps(dst + i, _mm_add_ps(vLower, _mm_mul_ps(vRange, _mm_mul_ps(_mm_cvtepi32_ps(u), vScale))));
+        }
+        }
+#endif
+        for (; i < n; i++) {
+            dst[i] = lower + range * unitFloat(src[i]);
+        }
+
+        done += n;
+        block += blockCount;
+        skip = 0;
+    }
+}
+
+void LXRdCounterFillGaussian(uint64_t seed, uint64_t stream, uint64_t firstIndex,
+                             float *outValues, size_t count, float mean, float sigma)
+{
+    uint32_t words[CHUNKBLOCKS * 4];
+    float values[CHUNKBLOCKS * 4];
+    uint64_t block = firstIndex >> 2;
+    size_t skip = (size_t)(firstIndex & 3);
+    size_t done = 0;
+
+    if ( !outValues) return;
+
+    while (done < count) {
+        const LXInteger blockCount = (LXInteger)MIN((size_t)CHUNKBLOCKS, (count - done + skip + 3) / 4);
+        const size_t n = MIN((size_t)blockCount * 4 - skip, count - done);
+        LXInteger i;
+
+        fillBlocks(seed, stream, block, words, blockCount);
+
+        for (i = 0; i < blockCount * 4; i += 2) {
+            float gc, gs;
+            gaussianPair(words[i], words[i + 1], &gc, &gs);
+            values[i] = mean + sigma * gc;
+            values[i + 1] = mean + sigma * gs;
+        }
+        memcpy(outValues + done, values + skip, n * sizeof(float));
+
+        done += n;
+        block += blockCount;
+        skip = 0;
+    }
+}
+
+
+#pragma mark --- pixel buffers ---
+
+typedef struct {
+    uint64_t seed;
+    uint64_t stream;
+    LXUInteger distribution;
+    float param1, param2;
+
+    uint8_t *buf;
+    size_t rowBytes;
+    LXInteger w, h;
+    LXPixelFormat pxFormat;
+} LXRdFillJob;
+
+static void fillBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger y0, LXInteger y1)
+{
+    const LXRdFillJob *job = (const LXRdFillJob *)userData;
+    const LXInteger w = job->w;
+    float *row = _lx_malloc(w * 4 * sizeof(float));
+    LXInteger x, y;
+
+    for (y = y0; y < y1; y++) {
+        uint8_t *dst = job->buf + job->rowBytes * y;
+        const uint64_t firstIndex = (uint64_t)y * w * 4;
+
+        if (job->distribution == kLXRdDistribution_Gaussian) {
+            LXRdCounterFillGaussian(job->seed, job->stream, firstIndex, row, w * 4, job->param1, job->param2);
+        } else {
+            LXRdCounterFillUniform(job->seed, job->stream, firstIndex, row, w * 4, job->param1, job->param2);
+        }
+
+        switch (job->pxFormat) {
+            case kLX_RGBA_INT8:
+            case kLX_ARGB_INT8:
+            case kLX_BGRA_INT8: {
+                // byte offsets of R, G, B and A
+                const int *offs;
+                static const int rgbaOffs[4] = { 0, 1, 2, 3 };
+                static const int argbOffs[4] = { 1, 2, 3, 0 };
+                static const int bgraOffs[4] = { 2, 1, 0, 3 };
+                offs = (job->pxFormat == kLX_ARGB_INT8) ? argbOffs : ((job->pxFormat == kLX_BGRA_INT8) ? bgraOffs : rgbaOffs);
+
+                for (x = 0; x < w; x++) {
+                    const float r = MIN(MAX(row[x*4 + 0], 0.0f), 1.0f);
+                    const float g = MIN(MAX(row[x*4 + 1], 0.0f), 1.0f);
+                    const float b = MIN(MAX(row[x*4 + 2], 0.0f), 1.0f);
+                    dst[x*4 + offs[0]] = (uint8_t)(r * 255.0f + 0.5f);
+                    dst[x*4 + offs[1]] = (uint8_t)(g * 255.0f + 0.5f);
+                    dst[x*4 + offs[2]] = (uint8_t)(b * 255.0f + 0.5f);
+                    dst[x*4 + offs[3]] = 255;
+                }
+                break;
+            }
+            case kLX_RGBA_FLOAT16:
+            case kLX_RGBA_FLOAT32:
+                for (x = 0; x < w; x++) {
+                    row[x*4 + 3] = 1.0f;
+                }
+                if (job->pxFormat == kLX_RGBA_FLOAT32)
+                    memcpy(dst, row, w * 4 * sizeof(float));
+                else
+                    LXConvertFloatToHalfArray(row, (LXHalf *)dst, w * 4);
+                break;
+
+            case kLX_Luminance_INT8:
+                for (x = 0; x < w; x++) {
+                    dst[x] = (uint8_t)(MIN(MAX(row[x*4], 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+                break;
+
+            case kLX_Luminance_FLOAT16:
+            case kLX_Luminance_FLOAT32:
+                for (x = 0; x < w; x++) {
+                    row[x] = row[x*4];
+                }
+                if (job->pxFormat == kLX_Luminance_FLOAT32)
+                    memcpy(dst, row, w * sizeof(float));
+                else
+                    LXConvertFloatToHalfArray(row, (LXHalf *)dst, w);
+                break;
+        }
+    }
+    _lx_free(row);
+}
+
+LXSuccess LXRdCounterFillPixelBuffer(LXPixelBufferRef pixbuf, uint64_t seed, uint64_t stream,
+                                     LXUInteger distribution, float param1, float param2,
+                                     LXError *outError)
+{
+    LXRdFillJob job;
+
+    if ( !pixbuf) {
+        LXErrorSet(outError, kLXErrorID_RandomGen_EmptyArg, "empty argument");
+        return NO;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.seed = seed;
+    job.stream = stream;
+    job.distribution = distribution;
+    job.param1 = param1;
+    job.param2 = param2;
+    job.w = LXPixelBufferGetWidth(pixbuf);
+    job.h = LXPixelBufferGetHeight(pixbuf);
+    job.pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+
+    switch (job.pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_ARGB_INT8:
+        case kLX_BGRA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+        case kLX_Luminance_INT8:
+        case kLX_Luminance_FLOAT16:
+        case kLX_Luminance_FLOAT32:
+            break;
+        default: {
+            char msg[256];
+            sprintf(msg, "unsupported pixel format for noise fill (%ld)", (long)job.pxFormat);
+            LXErrorSet(outError, kLXErrorID_RandomGen_UnsupportedPixelFormat, msg);
+            return NO;
+        }
+    }
+
+    job.buf = LXPixelBufferLockPixels(pixbuf, &job.rowBytes, NULL, outError);
+    if ( !job.buf) return NO;
+
+    LXParallelApplyToRowBands(job.w, job.h, 0, 0, fillBand, &job);
+
+    LXPixelBufferUnlockPixels(pixbuf);
+    return YES;
+}
@@ -28,7 +28,10 @@ typedef LXRef LXTransform3DRef;
 
 // graphics types
 typedef LXRef LXAccumulatorRef;
+typedef LXRef LXColorTransformRef;
 typedef LXRef LXConvolverRef;
+typedef LXRef LXCurveBakeRef;
+typedef LXRef LXLUT3DRef;
 typedef LXRef LXDrawContextRef;
 typedef LXRef LXPixelBufferRef;
 typedef LXRef LXShaderRef;
@@ -22,7 +22,9 @@
 enum {
     kLXErrorID_Shader_EmptyArg = 6501,
     kLXErrorID_Shader_ErrorInString,
-    kLXErrorID_Shader_InvalidProgramFormat
+    kLXErrorID_Shader_InvalidProgramFormat,
+    kLXErrorID_Shader_MissingTexture,
+    kLXErrorID_Shader_UnsupportedPixelFormat
 };
 
 enum {
@@ -101,6 +103,53 @@ LXEXPORT LXSuccess LXShaderEvaluate1DArray4f(LXShaderRef r,
 LXEXPORT void LXShaderEvaluateVectorWith1SInput(LXShaderRef r,
                                         const float * LXRESTRICT inData,
                                         float * LXRESTRICT outData);
+
+// renders an ARBfp shader into every pixel of "dstPixbuf" without a GPU.
+// texture[n] samples the n-th pixel buffer of "texArray" (see LXTextureArrayCreateWithPixelBuffers) with the array's sampling and wrap modes.
+// fragment.texcoord[n] spans that source image in pixel units, as if a quad covering the destination had been drawn with RECT textures.
+// the destination can't be one of the sources.
+LXEXPORT LXSuccess LXShaderEvaluateIntoPixelBuffer(LXShaderRef r,
+                                                   LXTextureArrayRef texArray,
+                                                   LXPixelBufferRef dstPixbuf,
+                                                   LXError *outError);
+
+
+// -- native kernels for CPU evaluation --
+
+enum {
+    kLXShaderCPUKernelTexTarget_1D = 1,
+    kLXShaderCPUKernelTexTarget_2D,
+    kLXShaderCPUKernelTexTarget_RECT
+};
+
+// kernels process pixels in batches of this size; every per-pixel array below has one element per pixel
+#define LXSHADERCPU_BATCHSIZE 16
+
+// arguments for a batch of pixels. texcoords and position are in pixel units; missing components are 0 (z) and 1 (w).
+// "sample" takes coordinates in the units of the texture target (normalized for 1D/2D, texels for RECT)
+// and writes the batch's texels as four rows (one per channel).
+typedef struct {
+    const float *params;                    // program.local[n] is at params + 4*n
+    const float *texCoord[8][2];
+    const float *position[3];
+
+    void (*sample)(void *sampler, LXInteger unit, LXInteger texTarget, const float *u, const float *v,
+                   float (*outRGBA)[LXSHADERCPU_BATCHSIZE]);
+    void *sampler;
+
+    float *color[4];                        // result.color
+    uint8_t *killed;                        // set to 1 for pixels discarded with KIL
+} LXShaderCPUKernelArgs;
+
+typedef void (*LXShaderCPUKernelFuncPtr)(const LXShaderCPUKernelArgs *args);
+
+// registers a kernel for an ARBfp program (usually generated with LXConvertShaderString_OpenGLARBfp_to_C_kernel()).
+// programs with exactly the same text are then evaluated with the kernel instead of the interpreter.
+// kernels should be registered before shaders using them are first evaluated.
+LXEXPORT void LXShaderRegisterCPUKernel(const char *programStr, size_t strLen, LXShaderCPUKernelFuncPtr func);
+
+// returns YES if the shader is evaluated with a registered kernel on the CPU
+LXEXPORT LXBool LXShaderHasCPUKernel(LXShaderRef shader);
                                         
 
 // -- accessing the platform-specific object --
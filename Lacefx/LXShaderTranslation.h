@@ -52,6 +52,36 @@ LXEXPORT LXSuccess LXConvertShaderString_OpenGLARBfp_to_D3DPS(const char *str, c
 LXEXPORT LXSuccess LXConvertShaderString_OpenGLARBfp_to_ES2_function_body(const char *str,
                                                                 char **outStr);
 
+// outputs C source for a native per-pixel kernel named "funcName" (see LXShaderCPUKernelFuncPtr in LXShader.h).
+// the kernel can be compiled ahead of time and registered with LXShaderRegisterCPUKernel(),
+// after which LXShaderEvaluateIntoPixelBuffer() runs it instead of interpreting the program.
+LXEXPORT LXSuccess LXConvertShaderString_OpenGLARBfp_to_C_kernel(const char *str, const char *funcName,
+                                                                char **outStr);
+
+
+// -- translation cache --
+
+// translations are cached in memory by a hash of the program and the output format.
+// if a directory is set, entries are also written there as files, so they persist across runs.
+// pass NULL to disable the disk cache.
+LXEXPORT void LXShaderTranslationCacheSetDirectory(const char *path);
+
+// empties the in-memory cache; files in the cache directory are kept
+LXEXPORT void LXShaderTranslationCacheClear(void);
+
+// the in-memory cache drops its least recently used entries when it grows over this size (default is 4 MB).
+// entries that were written to the cache directory are read back from there when needed again.
+LXEXPORT void LXShaderTranslationCacheSetMemoryLimit(size_t bytes);
+LXEXPORT size_t LXShaderTranslationCacheGetMemorySize(void);
+
+// used by the converters. "target" identifies the output format; the returned string must be freed with _lx_free().
+// outInfo can be NULL; only numProgramLocalsInUse and regIndexForFirstProgramLocal are cached.
+LXBool LXShaderTranslationCacheLookup_(const char *target, const char *str, char **outStr, LXShaderTranslationInfo *outInfo);
+void LXShaderTranslationCacheStore_(const char *target, const char *str, const char *translatedStr, const LXShaderTranslationInfo *info);
+
+// 64-bit FNV-1a hash used for cache keys; pass 0 as "hash" to start a new one, or a previous result to continue it
+uint64_t LXShaderTranslationHash_(const char *str, size_t len, uint64_t hash);
+
 #ifdef __cplusplus
 }
 #endif
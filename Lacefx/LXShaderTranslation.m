@@ -753,6 +753,14 @@ LXSuccess LXConvertShaderString_OpenGLARBfp_to_D3DPS(const char *str, const char
 {
     if ( !str || !outStr) return NO;
     
+    // the Conduit variant depends on picker state and the register map isn't cached, so those are always converted
+    const BOOL isCacheable = ( !shaderInfo || ( !shaderInfo->shaderIsConduitFormat && !shaderInfo->psRegMapPtr));
+    char cacheTarget[64];
+    snprintf(cacheTarget, sizeof(cacheTarget), "d3d:%s", (psFormat) ? psFormat : "ps_2_0");
+    
+    if (isCacheable && LXShaderTranslationCacheLookup_(cacheTarget, str, outStr, shaderInfo))
+        return YES;
+    
     NSString *prog = [NSString stringWithUTF8String:str];
     
     LXShaderDialect dialect = LXShaderDialect_D3DPixelShader_2_0;
@@ -783,6 +791,9 @@ LXSuccess LXConvertShaderString_OpenGLARBfp_to_D3DPS(const char *str, const char
     (*outStr)[len] = 0;
     memcpy(*outStr, utf8Prog, len);
     
+    if (isCacheable)
+        LXShaderTranslationCacheStore_(cacheTarget, str, *outStr, shaderInfo);
+    
     return YES;
 }
 
@@ -1198,6 +1209,9 @@ LXSuccess LXConvertShaderString_OpenGLARBfp_to_ES2_function_body(const char *str
 {
     if ( !str || !outStr) return NO;
     
+    if (LXShaderTranslationCacheLookup_("es2", str, outStr, NULL))
+        return YES;
+    
     NSString *fp = [NSString stringWithUTF8String:str];
     
     NSArray *fpComps = GetARBFPInstructions(fp);
@@ -1232,6 +1246,8 @@ LXSuccess LXConvertShaderString_OpenGLARBfp_to_ES2_function_body(const char *str
     *outStr = _lx_malloc(len + 1);
     (*outStr)[len] = 0;
     memcpy(*outStr, utf8Prog, len);
+    
+    LXShaderTranslationCacheStore_("es2", str, *outStr, NULL);
     return YES;
 }
 
@@ -0,0 +1,436 @@
+/*
+ *  LXShaderTranslationCache.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXShaderTranslation.h"
+#include "LXMutex.h"
+#include "LXStringUtils.h"
+
+#include <stdio.h>
+
+
+/*
+  Cache for the shader converters in LXShaderTranslation.m and LXShader_cpu.c.
+
+  Entries are keyed by a 64-bit FNV-1a hash of the target and the source program.
+  The full source is kept with each entry and compared on lookup, so a hash collision is only a cache miss.
+  The in-memory cache is limited in size: entries are also kept on a list in order of last use,
+  and the least recently used ones are removed when a new entry takes the total over the limit.
+
+  On disk, each entry is a file named by its hash in hex. A file contains a header followed by
+  the target, source and translated strings; files that don't match the header are ignored.
+*/
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+#define CACHE_BUCKETS       256
+#define CACHE_DEFAULT_MEMORY_LIMIT  (4 * 1024 * 1024)
+#define CACHE_FILE_MAGIC    0x5453584c  // 'LXST'
+#define CACHE_FILE_VERSION  1
+
+
+typedef struct _ShaderTranslationEntry {
+    uint64_t hash;
+    char *target;
+    char *source;
+    char *translated;
+    int64_t numProgramLocalsInUse;
+    int64_t regIndexForFirstProgramLocal;
+    size_t memSize;
+
+    struct _ShaderTranslationEntry *next;      // in the bucket
+    struct _ShaderTranslationEntry *lruPrev;   // towards the most recently used
+    struct _ShaderTranslationEntry *lruNext;
+} ShaderTranslationEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    int64_t numProgramLocalsInUse;
+    int64_t regIndexForFirstProgramLocal;
+    uint32_t targetLen;
+    uint32_t sourceLen;
+    uint32_t translatedLen;
+    uint32_t _reserved;
+} ShaderTranslationFileHeader;
+
+
+static ShaderTranslationEntry *s_buckets[CACHE_BUCKETS];
+static ShaderTranslationEntry *s_lruHead = NULL;
+static ShaderTranslationEntry *s_lruTail = NULL;
+static size_t s_memSize = 0;
+static size_t s_memLimit = CACHE_DEFAULT_MEMORY_LIMIT;
+static char *s_cacheDir = NULL;
+
+
+uint64_t LXShaderTranslationHash_(const char *str, size_t len, uint64_t hash)
+{
+    size_t i;
+    if (hash == 0)
+        hash = 0xcbf29ce484222325ULL;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashForEntry(const char *target, const char *str)
+{
+    // the terminating zero of the target separates it from the program
+    uint64_t hash = LXShaderTranslationHash_(target, strlen(target) + 1, 0);
+    return LXShaderTranslationHash_(str, strlen(str), hash);
+}
+
+static void destroyEntry(ShaderTranslationEntry *entry)
+{
+    _lx_free(entry->target);
+    _lx_free(entry->source);
+    _lx_free(entry->translated);
+    _lx_free(entry);
+}
+
+static void destroyEntryList(ShaderTranslationEntry *list)
+{
+    while (list) {
+        ShaderTranslationEntry *next = list->next;
+        destroyEntry(list);
+        list = next;
+    }
+}
+
+static size_t memSizeForEntry(const ShaderTranslationEntry *entry)
+{
+    return sizeof(ShaderTranslationEntry) + strlen(entry->target) + strlen(entry->source) + strlen(entry->translated) + 3;
+}
+
+// must be called with the lock held
+static ShaderTranslationEntry *findEntry(uint64_t hash, const char *target, const char *str)
+{
+    ShaderTranslationEntry *entry = s_buckets[hash % CACHE_BUCKETS];
+    for (; entry; entry = entry->next) {
+        if (entry->hash == hash && 0 == strcmp(entry->target, target) && 0 == strcmp(entry->source, str))
+            return entry;
+    }
+    return NULL;
+}
+
+// must be called with the lock held
+static void unlinkFromLRU(ShaderTranslationEntry *entry)
+{
+    if (entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext;
+    else s_lruHead = entry->lruNext;
+    if (entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev;
+    else s_lruTail = entry->lruPrev;
+    entry->lruPrev = entry->lruNext = NULL;
+}
+
+static void linkToLRUHead(ShaderTranslationEntry *entry)
+{
+    entry->lruPrev = NULL;
+    entry->lruNext = s_lruHead;
+    if (s_lruHead) s_lruHead->lruPrev = entry;
+    else s_lruTail = entry;
+    s_lruHead = entry;
+}
+
+// must be called with the lock held; marks the entry as most recently used
+static void touchEntry(ShaderTranslationEntry *entry)
+{
+    if (entry != s_lruHead) {
+        unlinkFromLRU(entry);
+        linkToLRUHead(entry);
+    }
+}
+
+// must be called with the lock held. removes least recently used entries until the cache is within the limit;
+// the removed entries are returned as a list to be destroyed after the lock is released
+static ShaderTranslationEntry *evictEntries(size_t limit)
+{
+    ShaderTranslationEntry *list = NULL;
+
+    while (s_lruTail && s_memSize > limit) {
+        ShaderTranslationEntry *entry = s_lruTail;
+        ShaderTranslationEntry **pp = s_buckets + (entry->hash % CACHE_BUCKETS);
+        while (*pp != entry) pp = &(*pp)->next;
+        *pp = entry->next;
+
+        unlinkFromLRU(entry);
+        s_memSize -= entry->memSize;
+
+        entry->next = list;
+        list = entry;
+    }
+    return list;
+}
+
+// must be called with the lock held; takes ownership of the entry.
+// returns the entries evicted to make room (see evictEntries)
+static ShaderTranslationEntry *insertEntry(ShaderTranslationEntry *entry)
+{
+    ShaderTranslationEntry **bucket = s_buckets + (entry->hash % CACHE_BUCKETS);
+    entry->next = *bucket;
+    *bucket = entry;
+
+    entry->memSize = memSizeForEntry(entry);
+    s_memSize += entry->memSize;
+    linkToLRUHead(entry);
+
+    return evictEntries(s_memLimit);
+}
+
+static ShaderTranslationEntry *createEntry(uint64_t hash, const char *target, const char *str, const char *translatedStr,
+                                           int64_t numLocals, int64_t regIndex)
+{
+    ShaderTranslationEntry *entry = _lx_calloc(1, sizeof(ShaderTranslationEntry));
+    entry->hash = hash;
+    entry->target = _lx_strdup(target);
+    entry->source = _lx_strdup(str);
+    entry->translated = _lx_strdup(translatedStr);
+    entry->numProgramLocalsInUse = numLocals;
+    entry->regIndexForFirstProgramLocal = regIndex;
+    return entry;
+}
+
+
+#pragma mark --- disk cache ---
+
+static char *createPathForHash(const char *dir, uint64_t hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.lxst", (unsigned long long)hash);
+    return LXStrCreateUTF8ByAppendingPathComponent(dir, name);
+}
+
+static char *readString(FILE *file, uint32_t len)
+{
+    char *str = _lx_malloc(len + 1);
+    if (len > 0 && fread(str, 1, len, file) != len) {
+        _lx_free(str);
+        return NULL;
+    }
+    str[len] = 0;
+    return str;
+}
+
+static ShaderTranslationEntry *readEntryFromDisk(const char *dir, uint64_t hash, const char *target, const char *str)
+{
+    char *path = createPathForHash(dir, hash);
+    FILE *file = (path) ? fopen(path, "rb") : NULL;
+    ShaderTranslationEntry *entry = NULL;
+    ShaderTranslationFileHeader header;
+
+    _lx_free(path);
+    if ( !file)
+        return NULL;
+
+    if (fread(&header, sizeof(header), 1, file) == 1
+            && header.magic == CACHE_FILE_MAGIC && header.version == CACHE_FILE_VERSION && header.hash == hash
+            && header.targetLen == strlen(target) && header.sourceLen == strlen(str)) {
+        char *fileTarget = readString(file, header.targetLen);
+        char *fileSource = (fileTarget) ? readString(file, header.sourceLen) : NULL;
+        char *fileTranslated = (fileSource) ? readString(file, header.translatedLen) : NULL;
+
+        if (fileTranslated && 0 == strcmp(fileTarget, target) && 0 == strcmp(fileSource, str)) {
+            entry = _lx_calloc(1, sizeof(ShaderTranslationEntry));
+            entry->hash = hash;
+            entry->target = fileTarget;
+            entry->source = fileSource;
+            entry->translated = fileTranslated;
+            entry->numProgramLocalsInUse = header.numProgramLocalsInUse;
+            entry->regIndexForFirstProgramLocal = header.regIndexForFirstProgramLocal;
+        } else {
+            _lx_free(fileTarget);
+            _lx_free(fileSource);
+            _lx_free(fileTranslated);
+        }
+    }
+    fclose(file);
+    return entry;
+}
+
+static void writeEntryToDisk(const char *dir, const ShaderTranslationEntry *entry)
+{
+    char *path = createPathForHash(dir, entry->hash);
+    if ( !path) return;
+
+    // written under a temporary name and renamed, so that other processes never see a partial file
+    const size_t pathLen = strlen(path);
+    char *tempPath = _lx_malloc(pathLen + 8);
+    snprintf(tempPath, pathLen + 8, "%s.tmp", path);
+
+    FILE *file = fopen(tempPath, "wb");
+    if (file) {
+        ShaderTranslationFileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = CACHE_FILE_MAGIC;
+        header.version = CACHE_FILE_VERSION;
+        header.hash = entry->hash;
+        header.numProgramLocalsInUse = entry->numProgramLocalsInUse;
+        header.regIndexForFirstProgramLocal = entry->regIndexForFirstProgramLocal;
+        header.targetLen = (uint32_t) strlen(entry->target);
+        header.sourceLen = (uint32_t) strlen(entry->source);
+        header.translatedLen = (uint32_t) strlen(entry->translated);
+
+        LXBool ok = (fwrite(&header, sizeof(header), 1, file) == 1
+                    && fwrite(entry->target, 1, header.targetLen, file) == header.targetLen
+                    && fwrite(entry->source, 1, header.sourceLen, file) == header.sourceLen
+                    && fwrite(entry->translated, 1, header.translatedLen, file) == header.translatedLen);
+
+        if (0 != fclose(file))
+            ok = NO;
+
+        if ( !ok || 0 != rename(tempPath, path))
+            remove(tempPath);
+    }
+    _lx_free(tempPath);
+    _lx_free(path);
+}
+
+
+#pragma mark --- public API ---
+
+void LXShaderTranslationCacheSetDirectory(const char *path)
+{
+    char *newDir = (path && *path) ? _lx_strdup(path) : NULL;
+
+    LXMutexLock(g_lxAtomicLock);
+    char *prevDir = s_cacheDir;
+    s_cacheDir = newDir;
+    LXMutexUnlock(g_lxAtomicLock);
+
+    _lx_free(prevDir);
+}
+
+void LXShaderTranslationCacheSetMemoryLimit(size_t bytes)
+{
+    LXMutexLock(g_lxAtomicLock);
+    s_memLimit = bytes;
+    ShaderTranslationEntry *evicted = evictEntries(s_memLimit);
+    LXMutexUnlock(g_lxAtomicLock);
+
+    destroyEntryList(evicted);
+}
+
+size_t LXShaderTranslationCacheGetMemorySize()
+{
+    LXMutexLock(g_lxAtomicLock);
+    size_t size = s_memSize;
+    LXMutexUnlock(g_lxAtomicLock);
+    return size;
+}
+
+void LXShaderTranslationCacheClear()
+{
+    LXMutexLock(g_lxAtomicLock);
+    ShaderTranslationEntry *list = evictEntries(0);
+    LXMutexUnlock(g_lxAtomicLock);
+
+    destroyEntryList(list);
+}
+
+LXBool LXShaderTranslationCacheLookup_(const char *target, const char *str, char **outStr, LXShaderTranslationInfo *outInfo)
+{
+    if ( !target || !str || !outStr) return NO;
+
+    const uint64_t hash = hashForEntry(target, str);
+    char *dir = NULL;
+    char *result = NULL;
+    int64_t numLocals = 0, regIndex = 0;
+
+    LXMutexLock(g_lxAtomicLock);
+    ShaderTranslationEntry *entry = findEntry(hash, target, str);
+    if (entry) {
+        touchEntry(entry);
+        result = _lx_strdup(entry->translated);
+        numLocals = entry->numProgramLocalsInUse;
+        regIndex = entry->regIndexForFirstProgramLocal;
+    }
+    else if (s_cacheDir) {
+        dir = _lx_strdup(s_cacheDir);
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if ( !result && dir) {
+        // file I/O is done without the lock; if another thread loaded the same entry meanwhile, ours is discarded
+        entry = readEntryFromDisk(dir, hash, target, str);
+        _lx_free(dir);
+
+        if (entry) {
+            result = _lx_strdup(entry->translated);
+            numLocals = entry->numProgramLocalsInUse;
+            regIndex = entry->regIndexForFirstProgramLocal;
+
+            ShaderTranslationEntry *evicted = NULL;
+            LXMutexLock(g_lxAtomicLock);
+            if ( !findEntry(hash, target, str)) {
+                evicted = insertEntry(entry);
+                entry = NULL;
+            }
+            LXMutexUnlock(g_lxAtomicLock);
+
+            if (entry) destroyEntry(entry);
+            destroyEntryList(evicted);
+        }
+    }
+
+    if ( !result)
+        return NO;
+
+    *outStr = result;
+    if (outInfo) {
+        outInfo->numProgramLocalsInUse = (LXInteger)numLocals;
+        outInfo->regIndexForFirstProgramLocal = (LXInteger)regIndex;
+    }
+    return YES;
+}
+
+void LXShaderTranslationCacheStore_(const char *target, const char *str, const char *translatedStr, const LXShaderTranslationInfo *info)
+{
+    if ( !target || !str || !translatedStr) return;
+
+    const uint64_t hash = hashForEntry(target, str);
+    ShaderTranslationEntry *entry = createEntry(hash, target, str, translatedStr,
+                                                (info) ? info->numProgramLocalsInUse : 0,
+                                                (info) ? info->regIndexForFirstProgramLocal : 0);
+    char *dir = NULL;
+    LXBool exists;
+
+    LXMutexLock(g_lxAtomicLock);
+    exists = (findEntry(hash, target, str) != NULL);
+    if ( !exists && s_cacheDir)
+        dir = _lx_strdup(s_cacheDir);
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if (exists) {
+        destroyEntry(entry);
+        return;
+    }
+    if (dir) {
+        writeEntryToDisk(dir, entry);
+        _lx_free(dir);
+    }
+
+    ShaderTranslationEntry *evicted = NULL;
+    LXMutexLock(g_lxAtomicLock);
+    if ( !findEntry(hash, target, str)) {
+        evicted = insertEntry(entry);
+        entry = NULL;
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if (entry) destroyEntry(entry);
+    destroyEntryList(evicted);
+}
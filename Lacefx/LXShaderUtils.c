@@ -350,8 +350,8 @@ LXShaderRef LXCreateCompositeShader_Multiply_Premult_Param()
                             "TEX t1, fragment.texcoord[1], texture[1], RECT;  "
                             
                             "SUB s, {1.0, 1.0, 1.0, 1.0}, t1; "
-                            "MUL s, program.local[0]; "
-                            "MUL s.rgb, s.rgb, t1.a; "
+                            "MUL s, s, program.local[0]; "
+                            "MUL s.rgb, s, t1.a; "
                             "SUB s, {1.0, 1.0, 1.0, 1.0}, s; "
                             
                             "MUL c.rgb, t0, s;  "
@@ -58,6 +58,42 @@ LXEXPORT LXShaderRef LXCreateCompositeShader_Add_Premult_Param();
 LXEXPORT LXShaderRef LXCreateCompositeShader_Multiply_Premult_Param();
 
 
+// -- compositing without shaders --
+
+// the operations of the shaders above, for use with LXCompositePixelBuffers()
+enum {
+    kLXCompositeOp_None = 0,
+    kLXCompositeOp_SolidColor,
+    kLXCompositeOp_MaskWithRed,
+    kLXCompositeOp_MaskWithAlpha,
+    kLXCompositeOp_MaskParam,
+    kLXCompositeOp_OverOp_Premult,
+    kLXCompositeOp_OverOp_Premult_Param,
+    kLXCompositeOp_OverOp_Premult_MaskWithRed,
+    kLXCompositeOp_OverOp_Unpremult_Param,
+    kLXCompositeOp_OverOp_Unpremult_MaskWithRed,
+    kLXCompositeOp_Add_Premult_Param,
+    kLXCompositeOp_Multiply_Premult_Param
+};
+typedef LXUInteger LXCompositeOp;
+
+// returns the operation performed by a shader created with one of the functions above (or a copy of one), otherwise kLXCompositeOp_None
+LXEXPORT LXCompositeOp LXCompositeOpForShader(LXShaderRef shader);
+
+// number of textures read by the operation (A, B and C in the descriptions above)
+LXEXPORT LXInteger LXCompositeOpGetSourceCount(LXCompositeOp op);
+
+// computes the operation on the CPU, giving the same result as drawing with the shader over the whole of "dstPixbuf".
+// "srcPixbufs" are textures A, B and C in order; "param" is shader parameter 0 (can be NULL if the operation doesn't use it).
+// all buffers must have the same size and pixel format, which can be RGBA int8, float16 or float32, or BGRA int8.
+// a source can be the destination itself, so e.g. layers can be composited in place over a background.
+LXEXPORT LXSuccess LXCompositePixelBuffers(LXCompositeOp op,
+                                           LXPixelBufferRef dstPixbuf,
+                                           LXPixelBufferRef *srcPixbufs,
+                                           const float *param,
+                                           LXError *outError);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,583 @@
+/*
+ *  LXShaderUtils_composite.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXShaderUtils.h"
+#include "LXPixelBuffer.h"
+#include "LXHalfFloat.h"
+#include "LXParallel.h"
+#include "LXRef_Impl.h"
+#include "LXShader_Impl.h"
+
+#if defined(__SSE2__)
+ #include <emmintrin.h>
+#endif
+
+
+/*
+  CPU implementations of the composite shaders in LXShaderUtils.c.
+
+  Each operation is a fused per-pixel function that reads the sources and writes the result in one pass,
+  without the float conversion and shader evaluation that LXShaderEvaluateIntoPixelBuffer() does.
+  The arithmetic is done in float in the same order as the ARBfp programs, so float32 results are identical
+  to the software renderer's; int8 sources are unpacked to float and the result is saturated and rounded back.
+
+  The software renderer (LXDraw_cpu.c) uses these when a surface is drawn with one of the shaders
+  using a quad that maps every texture 1:1 onto destination pixels.
+*/
+
+
+#define COMPOSITE_MAXSOURCES    3
+#define COMPOSITE_HALFCHUNK     64      // pixels converted at a time for float16
+
+
+LXInteger LXCompositeOpGetSourceCount(LXCompositeOp op)
+{
+    switch (op) {
+        case kLXCompositeOp_SolidColor:                 return 0;
+        case kLXCompositeOp_MaskParam:                  return 1;
+        case kLXCompositeOp_MaskWithRed:
+        case kLXCompositeOp_MaskWithAlpha:
+        case kLXCompositeOp_OverOp_Premult:
+        case kLXCompositeOp_OverOp_Premult_Param:
+        case kLXCompositeOp_OverOp_Unpremult_Param:
+        case kLXCompositeOp_Add_Premult_Param:
+        case kLXCompositeOp_Multiply_Premult_Param:     return 2;
+        case kLXCompositeOp_OverOp_Premult_MaskWithRed:
+        case kLXCompositeOp_OverOp_Unpremult_MaskWithRed:  return 3;
+        default:                                        return 0;
+    }
+}
+
+LXCompositeOp LXCompositeOpForShader(LXShaderRef shader)
+{
+    if ( !shader) return kLXCompositeOp_None;
+    LXShaderImpl *imp = (LXShaderImpl *)shader;
+
+    if (imp->programType != kLXShaderFormat_OpenGLARBfp || !imp->programStr)
+        return kLXCompositeOp_None;
+
+    return _LXShaderUtilsCompositeOpForProgram(imp->programStr, imp->programStrLen);
+}
+
+
+#pragma mark --- pixel operations ---
+
+#if defined(__SSE2__)
+
+typedef struct {
+    __m128 param;
+    __m128 paramAlpha;
+    __m128 zero;
+    __m128 one;
+    __m128 rgbMask;
+} CompositeConsts;
+
+static void initConsts(CompositeConsts *k, const float *param)
+{
+    k->param = _mm_loadu_ps(param);
+    k->paramAlpha = _mm_shuffle_ps(k->param, k->param, 0xff);
+    k->zero = _mm_setzero_ps();
+    k->one = _mm_set1_ps(1.0f);
+    k->rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+}
+
+#define SPLAT_R(v_)  _mm_shuffle_ps(v_, v_, 0x00)
+#define SPLAT_A(v_)  _mm_shuffle_ps(v_, v_, 0xff)
+
+LXINLINE __m128 saturate(const CompositeConsts *k, __m128 v)
+{
+    return _mm_min_ps(_mm_max_ps(v, k->zero), k->one);
+}
+
+// rgb from the first vector, alpha from the second
+LXINLINE __m128 selectRGB_A(const CompositeConsts *k, __m128 rgb, __m128 a)
+{
+    return _mm_or_ps(_mm_and_ps(k->rgbMask, rgb), _mm_andnot_ps(k->rgbMask, a));
+}
+
+// "over" for a premultiplied B:  c.rgb = A * sat(1 - B.a) + B;  c.a = sat(1 - A.a) * B.a + A.a
+LXINLINE __m128 overPremult(const CompositeConsts *k, __m128 a, __m128 b)
+{
+    __m128 s = saturate(k, _mm_sub_ps(k->one, SPLAT_A(b)));
+    __m128 rgb = _mm_add_ps(_mm_mul_ps(a, s), b);
+    __m128 ia = saturate(k, _mm_sub_ps(k->one, SPLAT_A(a)));
+    __m128 alpha = _mm_add_ps(_mm_mul_ps(ia, b), a);
+    return selectRGB_A(k, rgb, alpha);
+}
+
+// unpremultiplied B with its alpha scaled by "opacity" (splatted):  B.a *= opacity;  B.rgb *= B.a
+LXINLINE __m128 premultiplyWithOpacity(const CompositeConsts *k, __m128 b, __m128 opacity)
+{
+    __m128 ba = _mm_mul_ps(SPLAT_A(b), opacity);
+    return selectRGB_A(k, _mm_mul_ps(b, ba), ba);
+}
+
+// "op" is constant wherever this is inlined, so the switch folds away
+LXINLINE __m128 compositePixel(const LXCompositeOp op, const CompositeConsts *k, __m128 a, __m128 b, __m128 c)
+{
+    switch (op) {
+        default:
+        case kLXCompositeOp_SolidColor:
+            return k->param;
+
+        case kLXCompositeOp_MaskWithRed: {
+            __m128 m = saturate(k, SPLAT_R(b));
+            return selectRGB_A(k, saturate(k, _mm_mul_ps(a, m)), m);
+        }
+        case kLXCompositeOp_MaskWithAlpha: {
+            __m128 m = saturate(k, SPLAT_A(b));
+            return selectRGB_A(k, saturate(k, _mm_mul_ps(a, m)), m);
+        }
+        case kLXCompositeOp_MaskParam:
+            return _mm_mul_ps(a, k->param);
+
+        case kLXCompositeOp_OverOp_Premult:
+            return overPremult(k, a, b);
+
+        case kLXCompositeOp_OverOp_Premult_Param:
+            return overPremult(k, a, _mm_mul_ps(b, k->param));
+
+        case kLXCompositeOp_OverOp_Premult_MaskWithRed:
+            return overPremult(k, a, _mm_mul_ps(b, SPLAT_R(c)));
+
+        case kLXCompositeOp_OverOp_Unpremult_Param:
+            return overPremult(k, a, premultiplyWithOpacity(k, b, k->paramAlpha));
+
+        case kLXCompositeOp_OverOp_Unpremult_MaskWithRed:
+            return overPremult(k, a, premultiplyWithOpacity(k, b, SPLAT_R(c)));
+
+        case kLXCompositeOp_Add_Premult_Param: {
+            b = _mm_mul_ps(b, k->param);
+            __m128 ia = saturate(k, _mm_sub_ps(k->one, SPLAT_A(a)));
+            return selectRGB_A(k, _mm_add_ps(a, b), _mm_add_ps(_mm_mul_ps(ia, b), a));
+        }
+        case kLXCompositeOp_Multiply_Premult_Param: {
+            // s = 1 - (1 - B) * param * B.a;  c.rgb = A * s;  c.a = A.a
+            __m128 s = _mm_mul_ps(_mm_sub_ps(k->one, b), k->param);
+            s = _mm_sub_ps(k->one, _mm_mul_ps(s, SPLAT_A(b)));
+            return selectRGB_A(k, _mm_mul_ps(a, s), a);
+        }
+    }
+}
+
+#else  // !__SSE2__
+
+typedef struct {
+    float param[4];
+} CompositeConsts;
+
+static void initConsts(CompositeConsts *k, const float *param)
+{
+    memcpy(k->param, param, 4 * sizeof(float));
+}
+
+LXINLINE float saturate(float f)
+{
+    return MIN(MAX(f, 0.0f), 1.0f);
+}
+
+LXINLINE void overPremult(const float *a, const float *b, float *out)
+{
+    const float s = saturate(1.0f - b[3]);
+    const float ia = saturate(1.0f - a[3]);
+    out[0] = a[0] * s + b[0];
+    out[1] = a[1] * s + b[1];
+    out[2] = a[2] * s + b[2];
+    out[3] = ia * b[3] + a[3];
+}
+
+LXINLINE void compositePixel(const LXCompositeOp op, const CompositeConsts *k, const float *a, const float *b, const float *c, float *out)
+{
+    const float *p = k->param;
+    float t[4], m;
+    int i;
+
+    switch (op) {
+        default:
+        case kLXCompositeOp_SolidColor:
+            for (i = 0; i < 4; i++) out[i] = p[i];
+            break;
+
+        case kLXCompositeOp_MaskWithRed:
+        case kLXCompositeOp_MaskWithAlpha:
+            m = saturate((op == kLXCompositeOp_MaskWithRed) ? b[0] : b[3]);
+            for (i = 0; i < 3; i++) out[i] = saturate(a[i] * m);
+            out[3] = m;
+            break;
+
+        case kLXCompositeOp_MaskParam:
+            for (i = 0; i < 4; i++) out[i] = a[i] * p[i];
+            break;
+
+        case kLXCompositeOp_OverOp_Premult:
+            overPremult(a, b, out);
+            break;
+
+        case kLXCompositeOp_OverOp_Premult_Param:
+        case kLXCompositeOp_OverOp_Premult_MaskWithRed:
+            for (i = 0; i < 4; i++) t[i] = b[i] * ((op == kLXCompositeOp_OverOp_Premult_Param) ? p[i] : c[0]);
+            overPremult(a, t, out);
+            break;
+
+        case kLXCompositeOp_OverOp_Unpremult_Param:
+        case kLXCompositeOp_OverOp_Unpremult_MaskWithRed:
+            t[3] = b[3] * ((op == kLXCompositeOp_OverOp_Unpremult_Param) ? p[3] : c[0]);
+            for (i = 0; i < 3; i++) t[i] = b[i] * t[3];
+            overPremult(a, t, out);
+            break;
+
+        case kLXCompositeOp_Add_Premult_Param:
+            for (i = 0; i < 4; i++) t[i] = b[i] * p[i];
+            for (i = 0; i < 3; i++) out[i] = a[i] + t[i];
+            out[3] = saturate(1.0f - a[3]) * t[3] + a[3];
+            break;
+
+        case kLXCompositeOp_Multiply_Premult_Param:
+            for (i = 0; i < 3; i++) out[i] = a[i] * (1.0f - ((1.0f - b[i]) * p[i]) * b[3]);
+            out[3] = a[3];
+            break;
+    }
+}
+
+#endif  // __SSE2__
+
+
+
+#pragma mark --- rows ---
+
+typedef struct {
+    LXCompositeOp op;
+    LXInteger srcCount;
+    LXPixelFormat pxFormat;
+    int32_t w, h;
+
+    uint8_t *dst;
+    size_t dstRowBytes;
+    const uint8_t *srcs[COMPOSITE_MAXSOURCES];
+    size_t srcRowBytes[COMPOSITE_MAXSOURCES];
+
+    CompositeConsts consts;
+} CompositeJob;
+
+
+// the source pointers for unused sources are never read, so they can be anything (e.g. NULL)
+LXINLINE void compositeRowFloat32(const LXCompositeOp op, const CompositeConsts *k, LXInteger srcCount,
+                                  float *dst, const float *a, const float *b, const float *c, int32_t n)
+{
+    int32_t x;
+#if defined(__SSE2__)
+    __m128 va = _mm_setzero_ps(), vb = va, vc = va;
+    for (x = 0; x < n; x++) {
+        if (srcCount > 0) va = _mm_loadu_ps(a + x * 4);
+        if (srcCount > 1) vb = _mm_loadu_ps(b + x * 4);
+        if (srcCount > 2) vc = _mm_loadu_ps(c + x * 4);
+        _mm_storeu_ps(dst + x * 4, compositePixel(op, k, va, vb, vc));
+    }
+#else
+    static const float s_zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (x = 0; x < n; x++) {
+        float out[4];
+        compositePixel(op, k, (srcCount > 0) ? a + x * 4 : s_zero, (srcCount > 1) ? b + x * 4 : s_zero, (srcCount > 2) ? c + x * 4 : s_zero, out);
+        memcpy(dst + x * 4, out, sizeof(out));
+    }
+#endif
+}
+
+#if defined(__SSE2__)
+
+// four int8 pixels to float; BGRA is swizzled to RGBA so that the operations only deal with one channel order
+LXINLINE void loadInt8Pixels(const uint8_t *p, LXBool isBGRA, __m128 *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    const __m128i v = _mm_loadu_si128((const __m128i *)p);
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    int i;
+
+    out[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale);
+    out[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale);
+    out[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale);
+    out[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale);
+
+    if (isBGRA) {
+        for (i = 0; i < 4; i++) out[i] = _mm_shuffle_ps(out[i], out[i], _MM_SHUFFLE(3, 0, 1, 2));
+    }
+}
+
+LXINLINE void storeInt8Pixels(uint8_t *p, LXBool isBGRA, const CompositeConsts *k, __m128 *v)
+{
+    const __m128 scale = _mm_set1_ps(255.0f);
+    __m128i iv[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        __m128 f = saturate(k, v[i]);
+        if (isBGRA) f = _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 0, 1, 2));
+        iv[i] = _mm_cvtps_epi32(_mm_mul_ps(f, scale));  // rounds to nearest
+    }
+    _mm_storeu_si128((__m128i *)p, _mm_packus_epi16(_mm_packs_epi32(iv[0], iv[1]), _mm_packs_epi32(iv[2], iv[3])));
+}
+
+LXINLINE void compositeFourInt8Pixels(const LXCompositeOp op, const CompositeConsts *k, LXInteger srcCount, LXBool isBGRA,
+                                      uint8_t *dst, const uint8_t *a, const uint8_t *b, const uint8_t *c)
+{
+    __m128 va[4], vb[4], vc[4], out[4];
+    int i;
+    for (i = 0; i < 4; i++) va[i] = vb[i] = vc[i] = _mm_setzero_ps();
+
+    if (srcCount > 0) loadInt8Pixels(a, isBGRA, va);
+    if (srcCount > 1) loadInt8Pixels(b, isBGRA, vb);
+    if (srcCount > 2) loadInt8Pixels(c, isBGRA, vc);
+
+    for (i = 0; i < 4; i++) out[i] = compositePixel(op, k, va[i], vb[i], vc[i]);
+
+    storeInt8Pixels(dst, isBGRA, k, out);
+}
+
+#endif
+
+LXINLINE void compositeRowInt8(const LXCompositeOp op, const CompositeConsts *k, LXInteger srcCount, LXBool isBGRA,
+                               uint8_t *dst, const uint8_t *a, const uint8_t *b, const uint8_t *c, int32_t n)
+{
+    int32_t x = 0;
+#if defined(__SSE2__)
+    for (; x + 4 <= n; x += 4) {
+        compositeFourInt8Pixels(op, k, srcCount, isBGRA, dst + x * 4,
+                                (srcCount > 0) ? a + x * 4 : NULL, (srcCount > 1) ? b + x * 4 : NULL, (srcCount > 2) ? c + x * 4 : NULL);
+    }
+    if (x < n) {
+        // the last pixels go through a temporary block of four
+        uint8_t ta[16], tb[16], tc[16], td[16];
+        const size_t len = (n - x) * 4;
+        memset(ta, 0, 16);  memset(tb, 0, 16);  memset(tc, 0, 16);
+        if (srcCount > 0) memcpy(ta, a + x * 4, len);
+        if (srcCount > 1) memcpy(tb, b + x * 4, len);
+        if (srcCount > 2) memcpy(tc, c + x * 4, len);
+
+        compositeFourInt8Pixels(op, k, srcCount, isBGRA, td, ta, tb, tc);
+        memcpy(dst + x * 4, td, len);
+    }
+#else
+    static const float s_zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const int rIndex = (isBGRA) ? 2 : 0;
+    const int bIndex = (isBGRA) ? 0 : 2;
+    for (; x < n; x++) {
+        const uint8_t *srcs[3] = { a, b, c };
+        float f[3][4], out[4];
+        int s;
+        for (s = 0; s < srcCount; s++) {
+            const uint8_t *p = srcs[s] + x * 4;
+            f[s][0] = p[rIndex] * (1.0f / 255.0f);
+            f[s][1] = p[1] * (1.0f / 255.0f);
+            f[s][2] = p[bIndex] * (1.0f / 255.0f);
+            f[s][3] = p[3] * (1.0f / 255.0f);
+        }
+        compositePixel(op, k, (srcCount > 0) ? f[0] : s_zero, (srcCount > 1) ? f[1] : s_zero, (srcCount > 2) ? f[2] : s_zero, out);
+
+        uint8_t *d = dst + x * 4;
+        d[rIndex] = (uint8_t)(MIN(MAX(out[0], 0.0f), 1.0f) * 255.0f + 0.5f);
+        d[1] = (uint8_t)(MIN(MAX(out[1], 0.0f), 1.0f) * 255.0f + 0.5f);
+        d[bIndex] = (uint8_t)(MIN(MAX(out[2], 0.0f), 1.0f) * 255.0f + 0.5f);
+        d[3] = (uint8_t)(MIN(MAX(out[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+#endif
+}
+
+LXINLINE void compositeRowFloat16(const LXCompositeOp op, const CompositeConsts *k, LXInteger srcCount,
+                                  LXHalf *dst, const LXHalf *a, const LXHalf *b, const LXHalf *c, int32_t n)
+{
+    // the SSE2 path of LXConvertFloatToHalfArray() needs aligned buffers, so the result is converted into a temporary first
+    typedef struct {
+        float f[COMPOSITE_MAXSOURCES + 1][COMPOSITE_HALFCHUNK * 4];
+        LXHalf h[COMPOSITE_HALFCHUNK * 4];
+    } HalfChunkBuffers;
+    uint8_t tmpStorage[sizeof(HalfChunkBuffers) + 16];
+    HalfChunkBuffers *tmp = (HalfChunkBuffers *)(((uintptr_t)tmpStorage + 15) & ~(uintptr_t)15);
+
+    const LXHalf *srcs[COMPOSITE_MAXSOURCES] = { a, b, c };
+    int32_t x, s;
+
+    for (x = 0; x < n; x += COMPOSITE_HALFCHUNK) {
+        const int32_t count = MIN(COMPOSITE_HALFCHUNK, n - x);
+
+        for (s = 0; s < srcCount; s++) {
+            LXConvertHalfToFloatArray(srcs[s] + x * 4, tmp->f[s], count * 4);
+        }
+        compositeRowFloat32(op, k, srcCount, tmp->f[3], tmp->f[0], tmp->f[1], tmp->f[2], count);
+
+        LXConvertFloatToHalfArray(tmp->f[3], tmp->h, count * 4);
+        memcpy(dst + x * 4, tmp->h, count * 4 * sizeof(LXHalf));
+    }
+}
+
+// one function per operation, so that the row loops are compiled with the operation inlined
+#define COMPOSITE_ROWS_FUNC(op_) \
+    static void compositeRows_##op_(const CompositeJob *job, int32_t y0, int32_t y1) {  \
+        const LXInteger srcCount = job->srcCount;  \
+        const uint8_t *s[COMPOSITE_MAXSOURCES];  \
+        int32_t y, i;  \
+        for (y = y0; y < y1; y++) {  \
+            uint8_t *d = job->dst + y * job->dstRowBytes;  \
+            for (i = 0; i < COMPOSITE_MAXSOURCES; i++)  \
+                s[i] = (i < srcCount) ? job->srcs[i] + y * job->srcRowBytes[i] : NULL;  \
+            switch (job->pxFormat) {  \
+                case kLX_RGBA_INT8:  \
+                    compositeRowInt8(kLXCompositeOp_##op_, &job->consts, srcCount, NO, d, s[0], s[1], s[2], job->w);  break;  \
+                case kLX_BGRA_INT8:  \
+                    compositeRowInt8(kLXCompositeOp_##op_, &job->consts, srcCount, YES, d, s[0], s[1], s[2], job->w);  break;  \
+                case kLX_RGBA_FLOAT16:  \
+                    compositeRowFloat16(kLXCompositeOp_##op_, &job->consts, srcCount, (LXHalf *)d,  \
+                                        (const LXHalf *)s[0], (const LXHalf *)s[1], (const LXHalf *)s[2], job->w);  break;  \
+                case kLX_RGBA_FLOAT32:  \
+                    compositeRowFloat32(kLXCompositeOp_##op_, &job->consts, srcCount, (float *)d,  \
+                                        (const float *)s[0], (const float *)s[1], (const float *)s[2], job->w);  break;  \
+            }  \
+        }  \
+    }
+
+COMPOSITE_ROWS_FUNC(SolidColor)
+COMPOSITE_ROWS_FUNC(MaskWithRed)
+COMPOSITE_ROWS_FUNC(MaskWithAlpha)
+COMPOSITE_ROWS_FUNC(MaskParam)
+COMPOSITE_ROWS_FUNC(OverOp_Premult)
+COMPOSITE_ROWS_FUNC(OverOp_Premult_Param)
+COMPOSITE_ROWS_FUNC(OverOp_Premult_MaskWithRed)
+COMPOSITE_ROWS_FUNC(OverOp_Unpremult_Param)
+COMPOSITE_ROWS_FUNC(OverOp_Unpremult_MaskWithRed)
+COMPOSITE_ROWS_FUNC(Add_Premult_Param)
+COMPOSITE_ROWS_FUNC(Multiply_Premult_Param)
+
+static void compositeBand(void *userData, LXInteger workerIndex, LXInteger bandIndex, LXInteger bandY0, LXInteger bandY1)
+{
+    const CompositeJob *job = (const CompositeJob *)userData;
+    const int32_t y0 = (int32_t)bandY0;
+    const int32_t y1 = (int32_t)bandY1;
+
+    #define COMPOSITE_ROWS_CASE(op_)  case kLXCompositeOp_##op_:  compositeRows_##op_(job, y0, y1);  break;
+    switch (job->op) {
+        COMPOSITE_ROWS_CASE(SolidColor)
+        COMPOSITE_ROWS_CASE(MaskWithRed)
+        COMPOSITE_ROWS_CASE(MaskWithAlpha)
+        COMPOSITE_ROWS_CASE(MaskParam)
+        COMPOSITE_ROWS_CASE(OverOp_Premult)
+        COMPOSITE_ROWS_CASE(OverOp_Premult_Param)
+        COMPOSITE_ROWS_CASE(OverOp_Premult_MaskWithRed)
+        COMPOSITE_ROWS_CASE(OverOp_Unpremult_Param)
+        COMPOSITE_ROWS_CASE(OverOp_Unpremult_MaskWithRed)
+        COMPOSITE_ROWS_CASE(Add_Premult_Param)
+        COMPOSITE_ROWS_CASE(Multiply_Premult_Param)
+    }
+    #undef COMPOSITE_ROWS_CASE
+}
+
+
+
+#pragma mark --- entry points ---
+
+static LXBool isSupportedPixelFormat(LXPixelFormat pxFormat)
+{
+    return (pxFormat == kLX_RGBA_INT8 || pxFormat == kLX_BGRA_INT8 || pxFormat == kLX_RGBA_FLOAT16 || pxFormat == kLX_RGBA_FLOAT32);
+}
+
+LXSuccess _LXCompositeRegion(LXUInteger op, LXPixelFormat pxFormat, int32_t w, int32_t h,
+                             uint8_t *dst, size_t dstRowBytes,
+                             const uint8_t **srcs, const size_t *srcRowBytes,
+                             const float *param)
+{
+    static const float s_noParam[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    CompositeJob job;
+    LXInteger i;
+
+    if (op == kLXCompositeOp_None || !isSupportedPixelFormat(pxFormat) || !dst)
+        return NO;
+    if (w < 1 || h < 1)
+        return YES;
+
+    memset(&job, 0, sizeof(job));
+    job.op = op;
+    job.srcCount = LXCompositeOpGetSourceCount(op);
+    job.pxFormat = pxFormat;
+    job.w = w;
+    job.h = h;
+    job.dst = dst;
+    job.dstRowBytes = dstRowBytes;
+
+    for (i = 0; i < job.srcCount; i++) {
+        if ( !srcs || !srcs[i]) return NO;
+        job.srcs[i] = srcs[i];
+        job.srcRowBytes[i] = srcRowBytes[i];
+    }
+    initConsts(&job.consts, (param) ? param : s_noParam);
+
+    LXParallelApplyToRowBands(w, h, 0, 0, compositeBand, &job);
+    return YES;
+}
+
+LXSuccess LXCompositePixelBuffers(LXCompositeOp op,
+                                  LXPixelBufferRef dstPixbuf,
+                                  LXPixelBufferRef *srcPixbufs,
+                                  const float *param,
+                                  LXError *outError)
+{
+    const LXInteger srcCount = LXCompositeOpGetSourceCount(op);
+    const uint8_t *srcData[COMPOSITE_MAXSOURCES] = { NULL, NULL, NULL };
+    size_t srcRowBytes[COMPOSITE_MAXSOURCES] = { 0, 0, 0 };
+    LXInteger lockedCount = 0;
+    LXSuccess success = NO;
+    LXInteger i;
+
+    if (op == kLXCompositeOp_None || !dstPixbuf || (srcCount > 0 && !srcPixbufs)) {
+        LXErrorSet(outError, kLXErrorID_Shader_EmptyArg, "no operation or destination given");
+        return NO;
+    }
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(dstPixbuf);
+    const uint32_t w = LXPixelBufferGetWidth(dstPixbuf);
+    const uint32_t h = LXPixelBufferGetHeight(dstPixbuf);
+
+    if ( !isSupportedPixelFormat(pxFormat)) {
+        LXErrorSet(outError, kLXErrorID_Shader_UnsupportedPixelFormat, "pixel format is not supported for compositing");
+        return NO;
+    }
+    for (i = 0; i < srcCount; i++) {
+        if ( !srcPixbufs[i]) {
+            LXErrorSet(outError, kLXErrorID_Shader_MissingTexture, "source pixel buffer is missing");
+            return NO;
+        }
+        if (LXPixelBufferGetPixelFormat(srcPixbufs[i]) != pxFormat
+                || LXPixelBufferGetWidth(srcPixbufs[i]) != w || LXPixelBufferGetHeight(srcPixbufs[i]) != h) {
+            LXErrorSet(outError, kLXErrorID_Shader_UnsupportedPixelFormat, "source pixel buffer doesn't match destination size and pixel format");
+            return NO;
+        }
+    }
+
+    size_t dstRowBytes = 0;
+    uint8_t *dstData = LXPixelBufferLockPixels(dstPixbuf, &dstRowBytes, NULL, outError);
+    if ( !dstData)
+        return NO;
+
+    for (i = 0; i < srcCount; i++) {
+        if ( !(srcData[i] = LXPixelBufferLockPixels(srcPixbufs[i], &srcRowBytes[i], NULL, outError)))
+            break;
+        lockedCount++;
+    }
+    if (lockedCount == srcCount) {
+        success = _LXCompositeRegion(op, pxFormat, w, h, dstData, dstRowBytes, srcData, srcRowBytes, param);
+    }
+
+    for (i = 0; i < lockedCount; i++) {
+        LXPixelBufferUnlockPixels(srcPixbufs[i]);
+    }
+    LXPixelBufferUnlockPixels(dstPixbuf);
+    return success;
+}
@@ -0,0 +1,806 @@
+/*
+ *  LXShaderUtils_kernels.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXShader.h"
+#include "LXRef_Impl.h"
+#include "LXShader_Impl.h"
+#include "LXShaderUtils.h"
+
+#include <math.h>
+
+
+/*
+  Native CPU kernels for the ARBfp shaders in LXShaderUtils.c.
+
+  The kernels were generated with LXConvertShaderString_OpenGLARBfp_to_C_kernel() and are registered by program text,
+  so if a program in LXShaderUtils.c is edited, its old kernel no longer matches and the program is interpreted
+  until the kernel is regenerated.
+
+  The same program strings identify the shaders for LXCompositeOpForShader(); that table at the end is written by hand.
+*/
+
+
+#pragma mark --- SolidColor ---
+
+static const char *s_program_SolidColor =
+    "!!ARBfp1.0MOV result.color, program.local[0];  END";
+
+#ifndef LXSHCPU_SAT
+#define LXSHCPU_SAT(x_)  ((((x_) > 0.0f) ? (x_) : 0.0f) < 1.0f ? (((x_) > 0.0f) ? (x_) : 0.0f) : 1.0f)
+#endif
+
+void _LXShaderUtilsKernel_SolidColor(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    float * const *res = args->color;
+    int i;
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = p[0];
+        const float t1 = p[1];
+        const float t2 = p[2];
+        const float t3 = p[3];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- MaskWithRed ---
+
+static const char *s_program_MaskWithRed =
+    "!!ARBfp1.0TEMP t1, t2;  TEX t1, fragment.texcoord[0], texture[0], RECT;  TEX t2, fragment.texcoord[1], texture[1], RECT;  MOV_SAT t2.r, t2.r;  MUL_SAT result.color.rgb, t1, t2.r;  MOV result.color.a, t2.r;  END";
+
+void _LXShaderUtilsKernel_MaskWithRed(const LXShaderCPUKernelArgs *args)
+{
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // MOV_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i];
+        r14[0][i] = LXSHCPU_SAT(t0);
+    }
+
+    // MUL_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r14[0][i];
+        const float t1 = r13[1][i] * r14[0][i];
+        const float t2 = r13[2][i] * r14[0][i];
+        res[0][i] = LXSHCPU_SAT(t0);
+        res[1][i] = LXSHCPU_SAT(t1);
+        res[2][i] = LXSHCPU_SAT(t2);
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r14[0][i];
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- MaskWithAlpha ---
+
+static const char *s_program_MaskWithAlpha =
+    "!!ARBfp1.0TEMP t1, t2;  TEX t1, fragment.texcoord[0], texture[0], RECT;  TEX t2, fragment.texcoord[1], texture[1], RECT;  MOV_SAT t2.a, t2.a;  MUL_SAT result.color.rgb, t1, t2.a;  MOV result.color.a, t2.a;  END";
+
+void _LXShaderUtilsKernel_MaskWithAlpha(const LXShaderCPUKernelArgs *args)
+{
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // MOV_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r14[3][i];
+        r14[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MUL_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r14[3][i];
+        const float t1 = r13[1][i] * r14[3][i];
+        const float t2 = r13[2][i] * r14[3][i];
+        res[0][i] = LXSHCPU_SAT(t0);
+        res[1][i] = LXSHCPU_SAT(t1);
+        res[2][i] = LXSHCPU_SAT(t2);
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r14[3][i];
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- MaskParam ---
+
+static const char *s_program_MaskParam =
+    "!!ARBfp1.0TEMP t1;  TEX t1, fragment.texcoord[0], texture[0], RECT;  MUL t1, t1, program.local[0];  MOV result.color, t1;  END";
+
+void _LXShaderUtilsKernel_MaskParam(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    const float * const *tc0 = args->texCoord[0];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * p[0];
+        const float t1 = r13[1][i] * p[1];
+        const float t2 = r13[2][i] * p[2];
+        const float t3 = r13[3][i] * p[3];
+        r13[0][i] = t0;
+        r13[1][i] = t1;
+        r13[2][i] = t2;
+        r13[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i];
+        const float t1 = r13[1][i];
+        const float t2 = r13[2][i];
+        const float t3 = r13[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- OverOp_Premult ---
+
+static const char *s_program_OverOp_Premult =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  SUB_SAT s.a, 1.0, t1.a;  MAD c.rgb, t0, s.a, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_OverOp_Premult(const LXShaderCPUKernelArgs *args)
+{
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r14[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r16[3][i] + r14[0][i];
+        const float t1 = r13[1][i] * r16[3][i] + r14[1][i];
+        const float t2 = r13[2][i] * r16[3][i] + r14[2][i];
+        r15[0][i] = t0;
+        r15[1][i] = t1;
+        r15[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r16[3][i] * r14[3][i] + r13[3][i];
+        r15[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r15[0][i];
+        const float t1 = r15[1][i];
+        const float t2 = r15[2][i];
+        const float t3 = r15[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- OverOp_Premult_Param ---
+
+static const char *s_program_OverOp_Premult_Param =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  MUL t1, t1, program.local[0];  SUB_SAT s.a, 1.0, t1.a;  MAD c.rgb, t0, s.a, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_OverOp_Premult_Param(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i] * p[0];
+        const float t1 = r14[1][i] * p[1];
+        const float t2 = r14[2][i] * p[2];
+        const float t3 = r14[3][i] * p[3];
+        r14[0][i] = t0;
+        r14[1][i] = t1;
+        r14[2][i] = t2;
+        r14[3][i] = t3;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r14[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r16[3][i] + r14[0][i];
+        const float t1 = r13[1][i] * r16[3][i] + r14[1][i];
+        const float t2 = r13[2][i] * r16[3][i] + r14[2][i];
+        r15[0][i] = t0;
+        r15[1][i] = t1;
+        r15[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r16[3][i] * r14[3][i] + r13[3][i];
+        r15[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r15[0][i];
+        const float t1 = r15[1][i];
+        const float t2 = r15[2][i];
+        const float t3 = r15[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- OverOp_Premult_MaskWithRed ---
+
+static const char *s_program_OverOp_Premult_MaskWithRed =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, t2, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  TEX t2, fragment.texcoord[2], texture[2], RECT;  MUL t1, t1, t2.r;  SUB_SAT s.a, 1.0, t1.a;  MAD c.rgb, t0, s.a, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_OverOp_Premult_MaskWithRed(const LXShaderCPUKernelArgs *args)
+{
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    const float * const *tc2 = args->texCoord[2];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r17[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // TEX
+    args->sample(args->sampler, 2, kLXShaderCPUKernelTexTarget_RECT, tc2[0], tc2[1], r15);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i] * r15[0][i];
+        const float t1 = r14[1][i] * r15[0][i];
+        const float t2 = r14[2][i] * r15[0][i];
+        const float t3 = r14[3][i] * r15[0][i];
+        r14[0][i] = t0;
+        r14[1][i] = t1;
+        r14[2][i] = t2;
+        r14[3][i] = t3;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r14[3][i];
+        r17[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r17[3][i] + r14[0][i];
+        const float t1 = r13[1][i] * r17[3][i] + r14[1][i];
+        const float t2 = r13[2][i] * r17[3][i] + r14[2][i];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r17[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r17[3][i] * r14[3][i] + r13[3][i];
+        r16[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r16[0][i];
+        const float t1 = r16[1][i];
+        const float t2 = r16[2][i];
+        const float t3 = r16[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- OverOp_Unpremult_Param ---
+
+static const char *s_program_OverOp_Unpremult_Param =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  MUL t1.a, t1.a, program.local[0];  MUL t1.rgb, t1, t1.a; SUB_SAT s.a, 1.0, t1.a;  MAD c.rgb, t0, s.a, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_OverOp_Unpremult_Param(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r14[3][i] * p[3];
+        r14[3][i] = t3;
+    }
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i] * r14[3][i];
+        const float t1 = r14[1][i] * r14[3][i];
+        const float t2 = r14[2][i] * r14[3][i];
+        r14[0][i] = t0;
+        r14[1][i] = t1;
+        r14[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r14[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r16[3][i] + r14[0][i];
+        const float t1 = r13[1][i] * r16[3][i] + r14[1][i];
+        const float t2 = r13[2][i] * r16[3][i] + r14[2][i];
+        r15[0][i] = t0;
+        r15[1][i] = t1;
+        r15[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r16[3][i] * r14[3][i] + r13[3][i];
+        r15[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r15[0][i];
+        const float t1 = r15[1][i];
+        const float t2 = r15[2][i];
+        const float t3 = r15[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- OverOp_Unpremult_MaskWithRed ---
+
+static const char *s_program_OverOp_Unpremult_MaskWithRed =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, t2, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  TEX t2, fragment.texcoord[2], texture[2], RECT;  MUL t1.a, t1.a, t2.r;  MUL t1.rgb, t1, t1.a; SUB_SAT s.a, 1.0, t1.a;  MAD c.rgb, t0, s.a, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_OverOp_Unpremult_MaskWithRed(const LXShaderCPUKernelArgs *args)
+{
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    const float * const *tc2 = args->texCoord[2];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r17[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // TEX
+    args->sample(args->sampler, 2, kLXShaderCPUKernelTexTarget_RECT, tc2[0], tc2[1], r15);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r14[3][i] * r15[0][i];
+        r14[3][i] = t3;
+    }
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i] * r14[3][i];
+        const float t1 = r14[1][i] * r14[3][i];
+        const float t2 = r14[2][i] * r14[3][i];
+        r14[0][i] = t0;
+        r14[1][i] = t1;
+        r14[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r14[3][i];
+        r17[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r17[3][i] + r14[0][i];
+        const float t1 = r13[1][i] * r17[3][i] + r14[1][i];
+        const float t2 = r13[2][i] * r17[3][i] + r14[2][i];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r17[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r17[3][i] * r14[3][i] + r13[3][i];
+        r16[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r16[0][i];
+        const float t1 = r16[1][i];
+        const float t2 = r16[2][i];
+        const float t3 = r16[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- Add_Premult_Param ---
+
+static const char *s_program_Add_Premult_Param =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  MUL t1, t1, program.local[0];  ADD c.rgb, t0, t1;  SUB_SAT s.a, 1.0, t0.a;  MAD c.a, s.a, t1.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_Add_Premult_Param(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r14[0][i] * p[0];
+        const float t1 = r14[1][i] * p[1];
+        const float t2 = r14[2][i] * p[2];
+        const float t3 = r14[3][i] * p[3];
+        r14[0][i] = t0;
+        r14[1][i] = t1;
+        r14[2][i] = t2;
+        r14[3][i] = t3;
+    }
+
+    // ADD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] + r14[0][i];
+        const float t1 = r13[1][i] + r14[1][i];
+        const float t2 = r13[2][i] + r14[2][i];
+        r15[0][i] = t0;
+        r15[1][i] = t1;
+        r15[2][i] = t2;
+    }
+
+    // SUB_SAT
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = 1.0f - r13[3][i];
+        r16[3][i] = LXSHCPU_SAT(t3);
+    }
+
+    // MAD
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r16[3][i] * r14[3][i] + r13[3][i];
+        r15[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r15[0][i];
+        const float t1 = r15[1][i];
+        const float t2 = r15[2][i];
+        const float t3 = r15[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- Multiply_Premult_Param ---
+
+static const char *s_program_Multiply_Premult_Param =
+    "!!ARBfp1.0\n"
+    "TEMP t0, t1, c, s;  TEX t0, fragment.texcoord[0], texture[0], RECT;  TEX t1, fragment.texcoord[1], texture[1], RECT;  SUB s, {1.0, 1.0, 1.0, 1.0}, t1; MUL s, s, program.local[0]; MUL s.rgb, s, t1.a; SUB s, {1.0, 1.0, 1.0, 1.0}, s; MUL c.rgb, t0, s;  MOV c.a, t0.a;  MOV result.color, c;  END";
+
+void _LXShaderUtilsKernel_Multiply_Premult_Param(const LXShaderCPUKernelArgs *args)
+{
+    const float *p = args->params;
+    const float * const *tc0 = args->texCoord[0];
+    const float * const *tc1 = args->texCoord[1];
+    float * const *res = args->color;
+    float r13[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r14[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r15[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    float r16[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };
+    int i;
+
+    // TEX
+    args->sample(args->sampler, 0, kLXShaderCPUKernelTexTarget_RECT, tc0[0], tc0[1], r13);
+
+    // TEX
+    args->sample(args->sampler, 1, kLXShaderCPUKernelTexTarget_RECT, tc1[0], tc1[1], r14);
+
+    // SUB
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = 1.0f - r14[0][i];
+        const float t1 = 1.0f - r14[1][i];
+        const float t2 = 1.0f - r14[2][i];
+        const float t3 = 1.0f - r14[3][i];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+        r16[3][i] = t3;
+    }
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r16[0][i] * p[0];
+        const float t1 = r16[1][i] * p[1];
+        const float t2 = r16[2][i] * p[2];
+        const float t3 = r16[3][i] * p[3];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+        r16[3][i] = t3;
+    }
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r16[0][i] * r14[3][i];
+        const float t1 = r16[1][i] * r14[3][i];
+        const float t2 = r16[2][i] * r14[3][i];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+    }
+
+    // SUB
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = 1.0f - r16[0][i];
+        const float t1 = 1.0f - r16[1][i];
+        const float t2 = 1.0f - r16[2][i];
+        const float t3 = 1.0f - r16[3][i];
+        r16[0][i] = t0;
+        r16[1][i] = t1;
+        r16[2][i] = t2;
+        r16[3][i] = t3;
+    }
+
+    // MUL
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r13[0][i] * r16[0][i];
+        const float t1 = r13[1][i] * r16[1][i];
+        const float t2 = r13[2][i] * r16[2][i];
+        r15[0][i] = t0;
+        r15[1][i] = t1;
+        r15[2][i] = t2;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t3 = r13[3][i];
+        r15[3][i] = t3;
+    }
+
+    // MOV
+    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {
+        const float t0 = r15[0][i];
+        const float t1 = r15[1][i];
+        const float t2 = r15[2][i];
+        const float t3 = r15[3][i];
+        res[0][i] = t0;
+        res[1][i] = t1;
+        res[2][i] = t2;
+        res[3][i] = t3;
+    }
+}
+
+
+#pragma mark --- registration ---
+
+void _LXShaderUtilsRegisterCPUKernels()
+{
+    LXShaderRegisterCPUKernel(s_program_SolidColor, strlen(s_program_SolidColor), _LXShaderUtilsKernel_SolidColor);
+    LXShaderRegisterCPUKernel(s_program_MaskWithRed, strlen(s_program_MaskWithRed), _LXShaderUtilsKernel_MaskWithRed);
+    LXShaderRegisterCPUKernel(s_program_MaskWithAlpha, strlen(s_program_MaskWithAlpha), _LXShaderUtilsKernel_MaskWithAlpha);
+    LXShaderRegisterCPUKernel(s_program_MaskParam, strlen(s_program_MaskParam), _LXShaderUtilsKernel_MaskParam);
+    LXShaderRegisterCPUKernel(s_program_OverOp_Premult, strlen(s_program_OverOp_Premult), _LXShaderUtilsKernel_OverOp_Premult);
+    LXShaderRegisterCPUKernel(s_program_OverOp_Premult_Param, strlen(s_program_OverOp_Premult_Param), _LXShaderUtilsKernel_OverOp_Premult_Param);
+    LXShaderRegisterCPUKernel(s_program_OverOp_Premult_MaskWithRed, strlen(s_program_OverOp_Premult_MaskWithRed), _LXShaderUtilsKernel_OverOp_Premult_MaskWithRed);
+    LXShaderRegisterCPUKernel(s_program_OverOp_Unpremult_Param, strlen(s_program_OverOp_Unpremult_Param), _LXShaderUtilsKernel_OverOp_Unpremult_Param);
+    LXShaderRegisterCPUKernel(s_program_OverOp_Unpremult_MaskWithRed, strlen(s_program_OverOp_Unpremult_MaskWithRed), _LXShaderUtilsKernel_OverOp_Unpremult_MaskWithRed);
+    LXShaderRegisterCPUKernel(s_program_Add_Premult_Param, strlen(s_program_Add_Premult_Param), _LXShaderUtilsKernel_Add_Premult_Param);
+    LXShaderRegisterCPUKernel(s_program_Multiply_Premult_Param, strlen(s_program_Multiply_Premult_Param), _LXShaderUtilsKernel_Multiply_Premult_Param);
+}
+
+
+#pragma mark --- composite operations ---
+
+LXUInteger _LXShaderUtilsCompositeOpForProgram(const char *str, size_t len)
+{
+    static const struct {
+        const char **programStr;
+        LXCompositeOp op;
+    } s_ops[] = {
+        { &s_program_SolidColor,                    kLXCompositeOp_SolidColor },
+        { &s_program_MaskWithRed,                   kLXCompositeOp_MaskWithRed },
+        { &s_program_MaskWithAlpha,                 kLXCompositeOp_MaskWithAlpha },
+        { &s_program_MaskParam,                     kLXCompositeOp_MaskParam },
+        { &s_program_OverOp_Premult,                kLXCompositeOp_OverOp_Premult },
+        { &s_program_OverOp_Premult_Param,          kLXCompositeOp_OverOp_Premult_Param },
+        { &s_program_OverOp_Premult_MaskWithRed,    kLXCompositeOp_OverOp_Premult_MaskWithRed },
+        { &s_program_OverOp_Unpremult_Param,        kLXCompositeOp_OverOp_Unpremult_Param },
+        { &s_program_OverOp_Unpremult_MaskWithRed,  kLXCompositeOp_OverOp_Unpremult_MaskWithRed },
+        { &s_program_Add_Premult_Param,             kLXCompositeOp_Add_Premult_Param },
+        { &s_program_Multiply_Premult_Param,        kLXCompositeOp_Multiply_Premult_Param },
+    };
+    LXUInteger i;
+
+    if ( !str) return kLXCompositeOp_None;
+    while (len > 0 && str[len - 1] == 0) len--;
+
+    for (i = 0; i < sizeof(s_ops) / sizeof(s_ops[0]); i++) {
+        const char *programStr = *(s_ops[i].programStr);
+        if (strlen(programStr) == len && 0 == memcmp(programStr, str, len))
+            return s_ops[i].op;
+    }
+    return kLXCompositeOp_None;
+}
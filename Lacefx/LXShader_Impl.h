@@ -20,7 +20,7 @@
 #elif defined(LXPLATFORM_IOS)
  #include "LacefxESView.h"
  #include "LXDraw_iosgles2.h"
-#else
+#elif defined(LXPLATFORM_MAC)
  #include <OpenGL/GL.h>
 #endif
 
@@ -43,13 +43,14 @@ typedef struct {
 #elif defined(LXPLATFORM_IOS)
     GLuint      programID;
     GLint       programUniformLocations[NUM_UNIFORMS];
-#else
+#elif defined(LXPLATFORM_MAC)
     GLuint      fragProgID;
 #endif
     
     LXUInteger  storageHint;
     
     void        *fpClsObj;    
+    void        *cpuProgObj;  // compiled program for LXShaderEvaluateIntoPixelBuffer(), see LXShader_cpu.c
     float       shaderParams[LXSHADERPARAMCOUNT * 4];
     
     // these are only valid for Direct3D where program locals must go into the same set of registers as temps
@@ -58,7 +59,7 @@ typedef struct {
     
     LXUInteger  sharedStorageFlags;  // used for copies of shaders declared final
     
-    void        *_reservedA[7];
+    void        *_reservedA[6];
 } LXShaderImpl;
 
 
@@ -67,6 +68,17 @@ enum {
 };
 
 
+typedef struct {
+    // inputs; texcoords are in texels (as for RECT textures), position is in window pixels
+    float texCoord[8][2][LXSHADERCPU_BATCHSIZE];
+    float position[3][LXSHADERCPU_BATCHSIZE];
+
+    // outputs
+    float color[4][LXSHADERCPU_BATCHSIZE];
+    uint8_t killed[LXSHADERCPU_BATCHSIZE];
+} LXShaderCPUFragmentBatch;
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -84,6 +96,32 @@ extern LXShaderRef _LXShaderCommonCreateWithString(const char *asciiStr,
                                                       LXUInteger storageHint,
                                                       LXError *outError);
 
+// implemented in LXShader_cpu.c
+extern void *_LXShaderCPUProgramCreate(const char *prog, size_t progLen, LXError *outError);
+extern void _LXShaderCPUProgramDestroy(void *cpuProg);
+
+// implemented in LXShaderUtils_kernels.c; registers native kernels for the shaders in LXShaderUtils.c
+extern void _LXShaderUtilsRegisterCPUKernels(void);
+
+// also in LXShaderUtils_kernels.c; returns the LXCompositeOp of a program from LXShaderUtils.c
+extern LXUInteger _LXShaderUtilsCompositeOpForProgram(const char *str, size_t len);
+
+// implemented in LXShaderUtils_composite.c; computes a composite op for a w*h region.
+// the pointers are to the region's first pixel; all buffers have the same pixel format, and "srcs[i]" can be "dst" itself
+extern LXSuccess _LXCompositeRegion(LXUInteger op, LXPixelFormat pxFormat, int32_t w, int32_t h,
+                                    uint8_t *dst, size_t dstRowBytes,
+                                    const uint8_t **srcs, const size_t *srcRowBytes,
+                                    const float *param);
+
+// fragment evaluation for the software renderer.
+// the evaluator holds the shader's program and prepared texture sources; it can be run from any LXParallel worker.
+// params can be NULL to use the shader's own parameters; sources that are the same buffer as dstPixbuf get copied.
+extern void *_LXShaderCPUEvaluatorCreate(LXShaderRef shader, const float *params, LXTextureArrayRef texArray, LXPixelBufferRef dstPixbuf,
+                                         LXError *outError);
+extern void _LXShaderCPUEvaluatorDestroy(void *evaluator);
+extern uint32_t _LXShaderCPUEvaluatorGetUsedTexCoords(void *evaluator);  // bit n is set if fragment.texcoord[n] is read
+extern LXSuccess _LXShaderCPUEvaluatorRun(void *evaluator, LXInteger workerIndex, LXShaderCPUFragmentBatch *batch);
+
 
 #if defined(LXPLATFORM_WIN)
 
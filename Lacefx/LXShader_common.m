@@ -12,7 +12,9 @@
  
  */
 
+#if defined(__OBJC__)
 #import <Foundation/Foundation.h>
+#endif
 
 #include "LXShader.h"
 #include "LXRef_Impl.h"
@@ -22,7 +24,18 @@
 
 
 
+#if defined(__OBJC__)
 static NSMutableDictionary *g_staticShadersMap = nil;
+#else
+// when built as plain C (the software renderer on Linux), static shaders are kept in a list instead
+typedef struct {
+    const char *str;
+    LXShaderRef shader;
+} LXStaticShaderEntry;
+
+static LXStaticShaderEntry *g_staticShaders = NULL;
+static LXInteger g_staticShaderCount = 0;
+#endif
 
 extern LXMutexPtr g_lxAtomicLock;
 
@@ -144,10 +157,14 @@ void _LXShaderCommonDataFree(LXShaderImpl *imp)
         if (imp->fpClsObj)
             LXFPClosureDestroy(imp->fpClsObj);
 
+        if (imp->cpuProgObj)
+            _LXShaderCPUProgramDestroy(imp->cpuProgObj);
+
         if (imp->programStr)
             _lx_free(imp->programStr);
     }
     imp->fpClsObj = NULL;
+    imp->cpuProgObj = NULL;
     imp->programStr = NULL;
 }
 
@@ -169,6 +186,7 @@ LXShaderRef _LXShaderCommonCopy(LXShaderRef r)
         newImp->programStrLen = imp->programStrLen;
         
         newImp->fpClsObj = imp->fpClsObj;
+        newImp->cpuProgObj = imp->cpuProgObj;
     }
     else {
         _LXShaderSetProgramString(newImp, imp->programStr, imp->programStrLen, imp->programType);
@@ -186,12 +204,22 @@ LXShaderRef _LXCachedShaderForStaticString(const char *asciiStr)
     
     LXMutexLock(g_lxAtomicLock);
 
+#if defined(__OBJC__)
     if (g_staticShadersMap && asciiStr) {
         // the input program string is known to be a static pointer, so check the map if we already have a cached shader
         NSValue *mapKey = [NSValue valueWithPointer:asciiStr];
     
         obj = [[g_staticShadersMap objectForKey:mapKey] pointerValue];
     }
+#else
+    LXInteger i;
+    for (i = 0; i < g_staticShaderCount && asciiStr; i++) {
+        if (g_staticShaders[i].str == asciiStr) {
+            obj = g_staticShaders[i].shader;
+            break;
+        }
+    }
+#endif
     LXMutexUnlock(g_lxAtomicLock);
     return obj;
 }
@@ -200,11 +228,12 @@ void _LXSetCachedShaderForStaticString(LXShaderRef shader, const char *asciiStr)
 {
     if ( !asciiStr) return;
     
-    NSValue *mapKey = [NSValue valueWithPointer:asciiStr];
-
     // increment the retain count so the shader never gets released
     LXShaderRetain(shader);
 
+#if defined(__OBJC__)
+    NSValue *mapKey = [NSValue valueWithPointer:asciiStr];
+
     NSCAssert(g_lxAtomicLock, @"atomic lock mutex doesn't exist");
     LXMutexLock(g_lxAtomicLock);
     
@@ -214,6 +243,16 @@ void _LXSetCachedShaderForStaticString(LXShaderRef shader, const char *asciiStr)
     [g_staticShadersMap setObject:[NSValue valueWithPointer:shader] forKey:mapKey];
     
     LXMutexUnlock(g_lxAtomicLock);
+#else
+    LXMutexLock(g_lxAtomicLock);
+
+    g_staticShaders = _lx_realloc(g_staticShaders, (g_staticShaderCount + 1) * sizeof(LXStaticShaderEntry));
+    g_staticShaders[g_staticShaderCount].str = asciiStr;
+    g_staticShaders[g_staticShaderCount].shader = shader;
+    g_staticShaderCount++;
+
+    LXMutexUnlock(g_lxAtomicLock);
+#endif
 }
 
 
@@ -294,15 +333,7 @@ LXSuccess LXShaderEvaluate1DArray4f(LXShaderRef r,
     if ( !createCachedClosure(imp))
         return NO;
         
-    //LXFloat mul = 1.0 / arrayCount;
-
-    int i;
-    for (i = 0; i < arrayCount; i++) {    
-        LXFPClosureExecute_f(imp->fpClsObj, outArray,  NULL, 0,  inArray, 1);  // no scalar inputs, 1 vector
-        
-        inArray += 4;
-        outArray += 4;
-    }
+    LXFPClosureExecuteBatch(imp->fpClsObj, arrayCount, outArray,  NULL, 0,  inArray, 1);  // no scalar inputs, 1 vector per element
         
     return YES;
 }
@@ -0,0 +1,2164 @@
+/*
+ *  LXShader_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXShader.h"
+#include "LXRef_Impl.h"
+#include "LXShader_Impl.h"
+#include "LXTextureArray.h"
+#include "LXTexture.h"
+#include "LXPixelBuffer.h"
+#include "LXPixelBuffer_priv.h"
+#include "LXParallel.h"
+#include "LXMutex.h"
+#include "LXFPClosure_priv.h"   // FPCV_ vector ops
+#include "LXShaderTranslation.h"
+
+#include <math.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+
+/*
+  CPU execution of ARBfp fragment programs over whole images.
+
+  The program is parsed into a list of ShaderCPUOps. Execution is SIMD across pixels:
+  every register is stored as 4 rows (one per channel) of SHCPU_WIDTH lanes, and each op runs over all lanes at once.
+  The destination image is split into tiles that are rendered in parallel; each worker has its own register file.
+
+  Fragment attributes are generated as if a quad covering the whole destination had been drawn:
+  fragment.texcoord[n] spans the n-th source image in pixel units (as for RECT textures),
+  fragment.position is the destination pixel center, and fragment.color is opaque white.
+
+  A program can also be converted to C source for a per-pixel kernel (LXConvertShaderString_OpenGLARBfp_to_C_kernel).
+  Compiled kernels are registered by program text; a program with a registered kernel is run natively instead of by runOps().
+*/
+
+extern LXMutexPtr g_lxAtomicLock;
+
+
+#define SHCPU_WIDTH         LXSHADERCPU_BATCHSIZE      // pixels evaluated together by each op
+#define SHCPU_TILE_W        128
+#define SHCPU_TILE_H        32
+#define SHCPU_MAXTEXUNITS   8
+#define SHCPU_MAXREGS       1024
+#define SHCPU_MAXNAMELEN    32
+#define SHCPU_CKERNEL_VERSION   1       // version of the C kernel generator's output
+
+
+typedef enum {
+    ShaderCPUOp_END = 0,
+    ShaderCPUOp_ABS,
+    ShaderCPUOp_ADD,
+    ShaderCPUOp_CMP,
+    ShaderCPUOp_COS,
+    ShaderCPUOp_DP3,
+    ShaderCPUOp_DP4,
+    ShaderCPUOp_DPH,
+    ShaderCPUOp_DST,
+    ShaderCPUOp_EX2,
+    ShaderCPUOp_FLR,
+    ShaderCPUOp_FRC,
+    ShaderCPUOp_KIL,
+    ShaderCPUOp_LG2,
+    ShaderCPUOp_LIT,
+    ShaderCPUOp_LRP,
+    ShaderCPUOp_MAD,
+    ShaderCPUOp_MAX,
+    ShaderCPUOp_MIN,
+    ShaderCPUOp_MOV,
+    ShaderCPUOp_MUL,
+    ShaderCPUOp_POW,
+    ShaderCPUOp_RCP,
+    ShaderCPUOp_RSQ,
+    ShaderCPUOp_SCS,
+    ShaderCPUOp_SGE,
+    ShaderCPUOp_SIN,
+    ShaderCPUOp_SLT,
+    ShaderCPUOp_SUB,
+    ShaderCPUOp_SWZ,
+    ShaderCPUOp_TEX,
+    ShaderCPUOp_TXB,
+    ShaderCPUOp_TXP,
+    ShaderCPUOp_XPD
+} ShaderCPUOpcode;
+
+enum {
+    kShaderCPUOpFlag_ScalarSrc = 1 << 0,    // sources are read from their first swizzle component
+    kShaderCPUOpFlag_NoDst = 1 << 1,
+    kShaderCPUOpFlag_Texture = 1 << 2
+};
+
+static const struct {
+    const char *name;
+    int srcCount;
+    int flags;
+} s_opInfo[] = {
+    { "END", 0, 0 },
+    { "ABS", 1, 0 },
+    { "ADD", 2, 0 },
+    { "CMP", 3, 0 },
+    { "COS", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "DP3", 2, 0 },
+    { "DP4", 2, 0 },
+    { "DPH", 2, 0 },
+    { "DST", 2, 0 },
+    { "EX2", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "FLR", 1, 0 },
+    { "FRC", 1, 0 },
+    { "KIL", 1, kShaderCPUOpFlag_NoDst },
+    { "LG2", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "LIT", 1, 0 },
+    { "LRP", 3, 0 },
+    { "MAD", 3, 0 },
+    { "MAX", 2, 0 },
+    { "MIN", 2, 0 },
+    { "MOV", 1, 0 },
+    { "MUL", 2, 0 },
+    { "POW", 2, kShaderCPUOpFlag_ScalarSrc },
+    { "RCP", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "RSQ", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "SCS", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "SGE", 2, 0 },
+    { "SIN", 1, kShaderCPUOpFlag_ScalarSrc },
+    { "SLT", 2, 0 },
+    { "SUB", 2, 0 },
+    { "SWZ", 1, 0 },
+    { "TEX", 1, kShaderCPUOpFlag_Texture },
+    { "TXB", 1, kShaderCPUOpFlag_Texture },
+    { "TXP", 1, kShaderCPUOpFlag_Texture },
+    { "XPD", 2, 0 },
+    { NULL, 0, 0 }
+};
+
+enum {
+    kShaderCPUTexTarget_1D = 1,
+    kShaderCPUTexTarget_2D,
+    kShaderCPUTexTarget_RECT
+};
+
+// fixed registers; program locals, temporaries and constants are allocated after these
+enum {
+    kShaderCPUReg_ResultColor = 0,
+    kShaderCPUReg_TexCoord0 = 1,
+    kShaderCPUReg_Color = kShaderCPUReg_TexCoord0 + SHCPU_MAXTEXUNITS,
+    kShaderCPUReg_Position,
+    kShaderCPUReg_SwzConst,         // (0, 1, 0, 0), read by SWZ's constant components
+    kShaderCPUReg_Discard,          // result.depth is written here
+    kShaderCPUReg_FirstAllocated
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t dstMask;
+    uint8_t sat;
+    uint8_t texUnit;
+    uint8_t texTarget;
+    uint8_t negMask[3];         // negated components of each source
+    uint16_t dst;
+    uint16_t srcRow[3][4];      // register file row read for each source component
+} ShaderCPUOp;
+
+// registers whose value is the same for every pixel: constants and program.local parameters
+typedef struct {
+    uint16_t reg;
+    int16_t localIndex;         // -1 for constants
+    float value[4];
+} ShaderCPUUniform;
+
+typedef struct {
+    ShaderCPUOp *ops;           // terminated by an END op
+    int opCount;
+    int regCount;
+
+    ShaderCPUUniform *uniforms;
+    int uniformCount;
+
+    uint32_t usedTexCoords;     // bit n is set if fragment.texcoord[n] is read
+    uint32_t usedTexUnits;      // bit n is set if texture[n] is sampled
+    LXBool usesPosition;
+    LXBool hasKill;
+
+    LXShaderCPUKernelFuncPtr nativeKernel;  // registered kernel for this program, if any
+} ShaderCPUProgram;
+
+
+#pragma mark --- parsing ---
+
+typedef struct {
+    char name[SHCPU_MAXNAMELEN];
+    uint16_t reg;
+    LXBool isWritable;
+} ShaderCPUSymbol;
+
+typedef struct {
+    ShaderCPUProgram *prog;
+
+    ShaderCPUSymbol *syms;
+    int symCount;
+    int symCapacity;
+
+    int opCapacity;
+    int uniformCapacity;
+
+    int statementIndex;
+    char errMsg[256];
+} ShaderCPUParser;
+
+
+static LXBool parseError(ShaderCPUParser *ps, const char *msg, const char *detail)
+{
+    snprintf(ps->errMsg, sizeof(ps->errMsg), "statement %i: %s%s%s", ps->statementIndex + 1, msg,
+                                        (detail) ? ": " : "",  (detail) ? detail : "");
+    return NO;
+}
+
+static void skipSpace(const char **pp)
+{
+    const char *p = *pp;
+    while (*p && isspace((unsigned char)*p)) p++;
+    *pp = p;
+}
+
+static int parseIdentifier(const char **pp, char *buf, size_t bufSize)
+{
+    const char *p = *pp;
+    size_t n = 0;
+    skipSpace(&p);
+
+    if ( !isalpha((unsigned char)*p) && *p != '_') {
+        buf[0] = 0;
+        return 0;
+    }
+    while (isalnum((unsigned char)*p) || *p == '_') {
+        if (n < bufSize - 1) buf[n++] = *p;
+        p++;
+    }
+    buf[n] = 0;
+    *pp = p;
+    return (int)n;
+}
+
+static LXBool parseChar(const char **pp, char ch)
+{
+    skipSpace(pp);
+    if (**pp != ch) return NO;
+    (*pp)++;
+    return YES;
+}
+
+static LXBool parseNumber(const char **pp, float *outValue)
+{
+    char *end = NULL;
+    skipSpace(pp);
+    *outValue = strtof(*pp, &end);
+    if ( !end || end == *pp) return NO;
+    *pp = end;
+    return YES;
+}
+
+static LXBool parseArrayIndex(const char **pp, int *outIndex)
+{
+    float f = 0.0f;
+    if ( !parseChar(pp, '[') || !parseNumber(pp, &f) || !parseChar(pp, ']'))
+        return NO;
+    *outIndex = (int)f;
+    return (f >= 0.0f && f == (float)*outIndex) ? YES : NO;
+}
+
+static int componentForChar(char ch)
+{
+    switch (ch) {
+        case 'x':  case 'r':  return 0;
+        case 'y':  case 'g':  return 1;
+        case 'z':  case 'b':  return 2;
+        case 'w':  case 'a':  return 3;
+        default:              return -1;
+    }
+}
+
+static ShaderCPUSymbol *findSymbol(ShaderCPUParser *ps, const char *name)
+{
+    int i;
+    for (i = 0; i < ps->symCount; i++) {
+        if (0 == strcmp(ps->syms[i].name, name))
+            return ps->syms + i;
+    }
+    return NULL;
+}
+
+static LXBool addSymbol(ShaderCPUParser *ps, const char *name, uint16_t reg, LXBool isWritable)
+{
+    if (findSymbol(ps, name))
+        return parseError(ps, "name is already declared", name);
+
+    if (ps->symCount >= ps->symCapacity) {
+        ps->symCapacity = MAX(32, ps->symCapacity * 2);
+        ps->syms = _lx_realloc(ps->syms, ps->symCapacity * sizeof(ShaderCPUSymbol));
+    }
+    ShaderCPUSymbol *sym = ps->syms + ps->symCount++;
+    memset(sym, 0, sizeof(ShaderCPUSymbol));
+    strncpy(sym->name, name, SHCPU_MAXNAMELEN - 1);
+    sym->reg = reg;
+    sym->isWritable = isWritable;
+    return YES;
+}
+
+static LXBool allocRegister(ShaderCPUParser *ps, uint16_t *outReg)
+{
+    if (ps->prog->regCount >= SHCPU_MAXREGS)
+        return parseError(ps, "too many registers", NULL);
+    *outReg = (uint16_t) ps->prog->regCount++;
+    return YES;
+}
+
+static LXBool addUniform(ShaderCPUParser *ps, int localIndex, const float *value, uint16_t *outReg)
+{
+    ShaderCPUProgram *prog = ps->prog;
+    int i;
+
+    // identical constants and locals share a register
+    for (i = 0; i < prog->uniformCount; i++) {
+        ShaderCPUUniform *u = prog->uniforms + i;
+        if (u->localIndex == localIndex && (localIndex >= 0 || 0 == memcmp(u->value, value, 4 * sizeof(float)))) {
+            *outReg = u->reg;
+            return YES;
+        }
+    }
+
+    uint16_t reg;
+    if ( !allocRegister(ps, &reg))
+        return NO;
+
+    if (prog->uniformCount >= ps->uniformCapacity) {
+        ps->uniformCapacity = MAX(16, ps->uniformCapacity * 2);
+        prog->uniforms = _lx_realloc(prog->uniforms, ps->uniformCapacity * sizeof(ShaderCPUUniform));
+    }
+    ShaderCPUUniform *u = prog->uniforms + prog->uniformCount++;
+    memset(u, 0, sizeof(ShaderCPUUniform));
+    u->reg = reg;
+    u->localIndex = (int16_t)localIndex;
+    if (value) memcpy(u->value, value, 4 * sizeof(float));
+
+    *outReg = reg;
+    return YES;
+}
+
+// parses a register reference without swizzle: a declared name, a constant or a program/fragment/result binding
+static LXBool parseRegister(ShaderCPUParser *ps, const char **pp, uint16_t *outReg, LXBool *outIsWritable)
+{
+    char ident[SHCPU_MAXNAMELEN];
+    char member[SHCPU_MAXNAMELEN];
+    int index = 0;
+
+    *outIsWritable = NO;
+    skipSpace(pp);
+
+    if (**pp == '{') {
+        float v[4] = { 0.0f, 0.0f, 0.0f, 1.0f };  // missing components are filled as in ARB program parameters
+        int n = 0;
+        (*pp)++;
+        do {
+            if (n >= 4 || !parseNumber(pp, v + n))
+                return parseError(ps, "invalid vector constant", NULL);
+            n++;
+        } while (parseChar(pp, ','));
+
+        if ( !parseChar(pp, '}'))
+            return parseError(ps, "invalid vector constant", NULL);
+        return addUniform(ps, -1, v, outReg);
+    }
+
+    if (isdigit((unsigned char)**pp) || **pp == '.') {
+        float v[4];
+        if ( !parseNumber(pp, v))
+            return parseError(ps, "invalid scalar constant", NULL);
+        v[1] = v[2] = v[3] = v[0];
+        return addUniform(ps, -1, v, outReg);
+    }
+
+    if ( !parseIdentifier(pp, ident, sizeof(ident)))
+        return parseError(ps, "expected a register", *pp);
+
+    if (0 == strcmp(ident, "fragment")) {
+        if ( !parseChar(pp, '.') || !parseIdentifier(pp, member, sizeof(member)))
+            return parseError(ps, "invalid fragment attribute", NULL);
+
+        if (0 == strcmp(member, "texcoord")) {
+            skipSpace(pp);
+            if (**pp == '[' && !parseArrayIndex(pp, &index))
+                return parseError(ps, "invalid texcoord index", NULL);
+            if (index >= SHCPU_MAXTEXUNITS)
+                return parseError(ps, "texcoord index is out of range", NULL);
+            ps->prog->usedTexCoords |= (1 << index);
+            *outReg = kShaderCPUReg_TexCoord0 + index;
+        }
+        else if (0 == strcmp(member, "color")) {
+            const char *p = *pp;
+            if (parseChar(&p, '.') && parseIdentifier(&p, member, sizeof(member)) && 0 == strcmp(member, "primary"))
+                *pp = p;
+            *outReg = kShaderCPUReg_Color;
+        }
+        else if (0 == strcmp(member, "position")) {
+            ps->prog->usesPosition = YES;
+            *outReg = kShaderCPUReg_Position;
+        }
+        else
+            return parseError(ps, "unsupported fragment attribute", member);
+        return YES;
+    }
+
+    if (0 == strcmp(ident, "program")) {
+        if ( !parseChar(pp, '.') || !parseIdentifier(pp, member, sizeof(member)) || 0 != strcmp(member, "local"))
+            return parseError(ps, "unsupported program parameter (only program.local is available)", NULL);
+        if ( !parseArrayIndex(pp, &index) || index >= LXSHADERPARAMCOUNT)
+            return parseError(ps, "invalid program.local index", NULL);
+        return addUniform(ps, index, NULL, outReg);
+    }
+
+    if (0 == strcmp(ident, "result")) {
+        if ( !parseChar(pp, '.') || !parseIdentifier(pp, member, sizeof(member)))
+            return parseError(ps, "invalid result binding", NULL);
+
+        if (0 == strcmp(member, "color")) {
+            *outReg = kShaderCPUReg_ResultColor;
+        } else if (0 == strcmp(member, "depth")) {
+            *outReg = kShaderCPUReg_Discard;
+        } else
+            return parseError(ps, "unsupported result binding", member);
+        *outIsWritable = YES;
+        return YES;
+    }
+
+    if (0 == strcmp(ident, "state"))
+        return parseError(ps, "state bindings are not supported", NULL);
+
+    ShaderCPUSymbol *sym = findSymbol(ps, ident);
+    if ( !sym)
+        return parseError(ps, "undeclared name", ident);
+
+    skipSpace(pp);
+    if (**pp == '[')
+        return parseError(ps, "parameter arrays are not supported", ident);
+
+    *outReg = sym->reg;
+    *outIsWritable = sym->isWritable;
+    return YES;
+}
+
+// a swizzle suffix is either one component (replicated) or four
+static LXBool parseSwizzle(ShaderCPUParser *ps, const char **pp, uint8_t *swz)
+{
+    char str[SHCPU_MAXNAMELEN];
+    const char *p = *pp;
+    int i, n;
+
+    for (i = 0; i < 4; i++) swz[i] = i;
+
+    if ( !parseChar(&p, '.'))
+        return YES;
+
+    n = parseIdentifier(&p, str, sizeof(str));
+    if (n != 1 && n != 4)
+        return parseError(ps, "invalid swizzle", str);
+
+    for (i = 0; i < 4; i++) {
+        int c = componentForChar(str[MIN(i, n - 1)]);
+        if (c < 0)
+            return parseError(ps, "invalid swizzle", str);
+        swz[i] = c;
+    }
+    *pp = p;
+    return YES;
+}
+
+static LXBool parseSrc(ShaderCPUParser *ps, const char **pp, ShaderCPUOp *op, int srcIndex)
+{
+    uint8_t swz[4];
+    uint16_t reg;
+    LXBool isWritable, isNeg = NO;
+    int i;
+
+    skipSpace(pp);
+    if (**pp == '-') {
+        isNeg = YES;
+        (*pp)++;
+    } else if (**pp == '+') {
+        (*pp)++;
+    }
+
+    if ( !parseRegister(ps, pp, &reg, &isWritable) || !parseSwizzle(ps, pp, swz))
+        return NO;
+
+    if (reg == kShaderCPUReg_ResultColor || reg == kShaderCPUReg_Discard)
+        return parseError(ps, "result can't be read", NULL);
+
+    for (i = 0; i < 4; i++)
+        op->srcRow[srcIndex][i] = reg * 4 + swz[i];
+    op->negMask[srcIndex] = (isNeg) ? 0xf : 0;
+    return YES;
+}
+
+static LXBool parseDst(ShaderCPUParser *ps, const char **pp, ShaderCPUOp *op)
+{
+    char str[SHCPU_MAXNAMELEN];
+    uint16_t reg;
+    LXBool isWritable;
+
+    if ( !parseRegister(ps, pp, &reg, &isWritable))
+        return NO;
+    if ( !isWritable)
+        return parseError(ps, "destination is not writable", NULL);
+
+    op->dst = reg;
+    op->dstMask = 0xf;
+
+    const char *p = *pp;
+    if (parseChar(&p, '.')) {
+        int i, n = parseIdentifier(&p, str, sizeof(str));
+        int prevC = -1;
+        if (n < 1 || n > 4)
+            return parseError(ps, "invalid write mask", str);
+        op->dstMask = 0;
+        for (i = 0; i < n; i++) {
+            int c = componentForChar(str[i]);
+            if (c <= prevC)
+                return parseError(ps, "invalid write mask", str);
+            op->dstMask |= (1 << c);
+            prevC = c;
+        }
+        *pp = p;
+    }
+    return YES;
+}
+
+static LXBool parseTextureOperands(ShaderCPUParser *ps, const char **pp, ShaderCPUOp *op)
+{
+    char ident[SHCPU_MAXNAMELEN];
+    int unit = 0;
+
+    if ( !parseChar(pp, ',') || !parseIdentifier(pp, ident, sizeof(ident)) || 0 != strcmp(ident, "texture"))
+        return parseError(ps, "expected a texture image unit", NULL);
+    skipSpace(pp);
+    if (**pp == '[' && !parseArrayIndex(pp, &unit))
+        return parseError(ps, "invalid texture image unit", NULL);
+    if (unit >= SHCPU_MAXTEXUNITS)
+        return parseError(ps, "texture image unit is out of range", NULL);
+
+    // target names can start with a digit, so they aren't parsed as identifiers
+    size_t n = 0;
+    if ( !parseChar(pp, ','))
+        return parseError(ps, "expected a texture target", NULL);
+    skipSpace(pp);
+    while (isalnum((unsigned char)**pp) && n < sizeof(ident) - 1)
+        ident[n++] = *(*pp)++;
+    ident[n] = 0;
+
+    if (0 == strcmp(ident, "RECT"))     op->texTarget = kShaderCPUTexTarget_RECT;
+    else if (0 == strcmp(ident, "2D"))  op->texTarget = kShaderCPUTexTarget_2D;
+    else if (0 == strcmp(ident, "1D"))  op->texTarget = kShaderCPUTexTarget_1D;
+    else
+        return parseError(ps, "unsupported texture target", ident);
+
+    op->texUnit = unit;
+    ps->prog->usedTexUnits |= (1 << unit);
+    return YES;
+}
+
+// SWZ takes an extended swizzle: four comma-separated components that can be 0, 1 or a source channel, each optionally negated
+static LXBool parseExtendedSwizzle(ShaderCPUParser *ps, const char **pp, ShaderCPUOp *op)
+{
+    char str[SHCPU_MAXNAMELEN];
+    const uint16_t reg = op->srcRow[0][0] / 4;
+    int i;
+
+    if (op->srcRow[0][0] != reg * 4 || op->srcRow[0][3] != reg * 4 + 3)
+        return parseError(ps, "SWZ source can't have a swizzle suffix", NULL);
+
+    const uint8_t srcNeg = op->negMask[0];
+    op->negMask[0] = 0;
+
+    for (i = 0; i < 4; i++) {
+        LXBool isNeg = NO;
+        if ( !parseChar(pp, ','))
+            return parseError(ps, "SWZ expects four components", NULL);
+        skipSpace(pp);
+        if (**pp == '-') {
+            isNeg = YES;
+            (*pp)++;
+        } else if (**pp == '+') {
+            (*pp)++;
+        }
+        skipSpace(pp);
+
+        if (**pp == '0' || **pp == '1') {
+            op->srcRow[0][i] = kShaderCPUReg_SwzConst * 4 + (**pp - '0');
+            (*pp)++;
+        } else {
+            int c = (parseIdentifier(pp, str, sizeof(str)) == 1) ? componentForChar(str[0]) : -1;
+            if (c < 0)
+                return parseError(ps, "invalid SWZ component", str);
+            op->srcRow[0][i] = reg * 4 + c;
+        }
+        if (isNeg != ((srcNeg >> i) & 1))
+            op->negMask[0] |= (1 << i);
+    }
+    return YES;
+}
+
+static LXBool parseDeclaration(ShaderCPUParser *ps, const char *keyword, const char *p)
+{
+    char name[SHCPU_MAXNAMELEN];
+
+    if (0 == strcmp(keyword, "TEMP")) {
+        do {
+            uint16_t reg;
+            if ( !parseIdentifier(&p, name, sizeof(name)))
+                return parseError(ps, "expected a name", p);
+            if ( !allocRegister(ps, &reg) || !addSymbol(ps, name, reg, YES))
+                return NO;
+        } while (parseChar(&p, ','));
+    }
+    else {
+        // PARAM, ATTRIB, OUTPUT and ALIAS bind a name to an existing register
+        uint16_t reg;
+        LXBool isWritable;
+        if ( !parseIdentifier(&p, name, sizeof(name)))
+            return parseError(ps, "expected a name", p);
+        if ( !parseChar(&p, '='))
+            return parseError(ps, "expected '='", name);
+        if ( !parseRegister(ps, &p, &reg, &isWritable) || !addSymbol(ps, name, reg, isWritable))
+            return NO;
+    }
+
+    skipSpace(&p);
+    return (*p == 0) ? YES : parseError(ps, "unexpected characters", p);
+}
+
+static LXBool parseInstruction(ShaderCPUParser *ps, const char *opName, const char *p)
+{
+    ShaderCPUProgram *prog = ps->prog;
+    ShaderCPUOp op;
+    char name[SHCPU_MAXNAMELEN];
+    size_t nameLen = strlen(opName);
+    int i, opcode = 0;
+
+    memset(&op, 0, sizeof(op));
+
+    strncpy(name, opName, sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    if (nameLen > 4 && 0 == strcmp(name + nameLen - 4, "_SAT")) {
+        op.sat = YES;
+        name[nameLen - 4] = 0;
+    }
+
+    for (i = 1; s_opInfo[i].name; i++) {
+        if (0 == strcmp(s_opInfo[i].name, name)) {
+            opcode = i;
+            break;
+        }
+    }
+    if (opcode == 0)
+        return parseError(ps, "unsupported instruction", opName);
+    op.op = opcode;
+
+    const int flags = s_opInfo[opcode].flags;
+    LXBool needsComma = NO;
+
+    if ( !(flags & kShaderCPUOpFlag_NoDst)) {
+        if ( !parseDst(ps, &p, &op))
+            return NO;
+        needsComma = YES;
+    } else {
+        op.dstMask = 0;
+    }
+
+    for (i = 0; i < s_opInfo[opcode].srcCount; i++) {
+        if (needsComma && !parseChar(&p, ','))
+            return parseError(ps, "expected ','", p);
+        if ( !parseSrc(ps, &p, &op, i))
+            return NO;
+        needsComma = YES;
+    }
+
+    if (flags & kShaderCPUOpFlag_Texture) {
+        if ( !parseTextureOperands(ps, &p, &op))
+            return NO;
+    }
+    else if (opcode == ShaderCPUOp_SWZ) {
+        if ( !parseExtendedSwizzle(ps, &p, &op))
+            return NO;
+    }
+    else if (opcode == ShaderCPUOp_KIL) {
+        prog->hasKill = YES;
+    }
+
+    skipSpace(&p);
+    if (*p != 0)
+        return parseError(ps, "unexpected characters", p);
+
+    if (prog->opCount + 1 >= ps->opCapacity) {
+        ps->opCapacity = MAX(32, ps->opCapacity * 2);
+        prog->ops = _lx_realloc(prog->ops, ps->opCapacity * sizeof(ShaderCPUOp));
+    }
+    prog->ops[prog->opCount++] = op;
+    return YES;
+}
+
+static LXBool parseStatement(ShaderCPUParser *ps, const char *stmt)
+{
+    char keyword[SHCPU_MAXNAMELEN];
+    const char *p = stmt;
+
+    if ( !parseIdentifier(&p, keyword, sizeof(keyword)))
+        return parseError(ps, "expected an instruction", stmt);
+
+    if (0 == strcmp(keyword, "OPTION"))
+        return YES;  // precision hints and fog options don't affect the result
+
+    if (0 == strcmp(keyword, "TEMP") || 0 == strcmp(keyword, "PARAM") || 0 == strcmp(keyword, "ATTRIB")
+                || 0 == strcmp(keyword, "OUTPUT") || 0 == strcmp(keyword, "ALIAS"))
+        return parseDeclaration(ps, keyword, p);
+
+    return parseInstruction(ps, keyword, p);
+}
+
+#pragma mark --- native kernel registry ---
+
+typedef struct {
+    uint64_t hash;
+    char *programStr;
+    size_t programStrLen;
+    LXShaderCPUKernelFuncPtr func;
+} ShaderCPUKernelEntry;
+
+static ShaderCPUKernelEntry *s_kernels = NULL;
+static LXInteger s_kernelCount = 0;
+static LXBool s_builtinKernelsRegistered = NO;
+
+void LXShaderRegisterCPUKernel(const char *programStr, size_t strLen, LXShaderCPUKernelFuncPtr func)
+{
+    if ( !programStr || !func) return;
+
+    while (strLen > 0 && programStr[strLen - 1] == 0) strLen--;
+    if (strLen < 1) return;
+
+    char *str = _lx_malloc(strLen + 1);
+    memcpy(str, programStr, strLen);
+    str[strLen] = 0;
+    const uint64_t hash = LXShaderTranslationHash_(str, strLen, 0);
+    LXInteger i;
+
+    LXMutexLock(g_lxAtomicLock);
+    for (i = 0; i < s_kernelCount; i++) {
+        ShaderCPUKernelEntry *entry = s_kernels + i;
+        if (entry->hash == hash && entry->programStrLen == strLen && 0 == memcmp(entry->programStr, str, strLen)) {
+            // a later registration replaces the earlier one
+            entry->func = func;
+            _lx_free(str);
+            str = NULL;
+            break;
+        }
+    }
+    if (str) {
+        s_kernels = _lx_realloc(s_kernels, (s_kernelCount + 1) * sizeof(ShaderCPUKernelEntry));
+        s_kernels[s_kernelCount].hash = hash;
+        s_kernels[s_kernelCount].programStr = str;
+        s_kernels[s_kernelCount].programStrLen = strLen;
+        s_kernels[s_kernelCount].func = func;
+        s_kernelCount++;
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+}
+
+static LXShaderCPUKernelFuncPtr findNativeKernel(const char *str, size_t len)
+{
+    LXShaderCPUKernelFuncPtr func = NULL;
+    LXBool needsBuiltins;
+    LXInteger i;
+
+    // the library's own kernels are registered on first use.
+    // a thread that gets here while that's in progress may miss a kernel, in which case its program is simply interpreted
+    LXMutexLock(g_lxAtomicLock);
+    needsBuiltins = !s_builtinKernelsRegistered;
+    s_builtinKernelsRegistered = YES;
+    LXMutexUnlock(g_lxAtomicLock);
+
+    if (needsBuiltins)
+        _LXShaderUtilsRegisterCPUKernels();
+
+    while (len > 0 && str[len - 1] == 0) len--;
+    const uint64_t hash = LXShaderTranslationHash_(str, len, 0);
+
+    LXMutexLock(g_lxAtomicLock);
+    for (i = 0; i < s_kernelCount; i++) {
+        const ShaderCPUKernelEntry *entry = s_kernels + i;
+        if (entry->hash == hash && entry->programStrLen == len && 0 == memcmp(entry->programStr, str, len)) {
+            func = entry->func;
+            break;
+        }
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+    return func;
+}
+
+
+static void destroyCPUProgram(ShaderCPUProgram *prog)
+{
+    if ( !prog) return;
+    _lx_free(prog->ops);
+    _lx_free(prog->uniforms);
+    _lx_free(prog);
+}
+
+void _LXShaderCPUProgramDestroy(void *cpuProg)
+{
+    destroyCPUProgram((ShaderCPUProgram *)cpuProg);
+}
+
+void *_LXShaderCPUProgramCreate(const char *str, size_t len, LXError *outError)
+{
+    static const char *header = "!!ARBfp1.0";
+    const size_t headerLen = strlen(header);
+
+    if ( !str || len < headerLen || 0 != strncmp(str, header, headerLen)) {
+        LXErrorSet(outError, kLXErrorID_Shader_InvalidProgramFormat, "program doesn't start with the ARBfp header");
+        return NULL;
+    }
+
+    // strip comments so that statements can be split on semicolons
+    char *text = _lx_malloc(len - headerLen + 1);
+    size_t i, n = 0;
+    for (i = headerLen; i < len && str[i]; i++) {
+        if (str[i] == '#') {
+            while (i < len && str[i] && str[i] != '\n') i++;
+            if (i >= len || !str[i]) break;
+        }
+        text[n++] = str[i];
+    }
+    text[n] = 0;
+
+    ShaderCPUParser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.prog = _lx_calloc(1, sizeof(ShaderCPUProgram));
+    ps.prog->regCount = kShaderCPUReg_FirstAllocated;
+
+    LXBool ok = YES;
+    LXBool foundEnd = NO;
+    char *stmt = text;
+    while (ok && !foundEnd) {
+        char *semicolon = strchr(stmt, ';');
+        char *endPtr;
+        if (semicolon) *semicolon = 0;
+
+        // the final statement is followed by END instead of a semicolon
+        for (endPtr = strstr(stmt, "END"); endPtr; endPtr = strstr(endPtr + 3, "END")) {
+            if ((endPtr == stmt || !(isalnum((unsigned char)endPtr[-1]) || endPtr[-1] == '_' || endPtr[-1] == '.'))
+                        && !(isalnum((unsigned char)endPtr[3]) || endPtr[3] == '_')) {
+                *endPtr = 0;
+                foundEnd = YES;
+                break;
+            }
+        }
+
+        const char *p = stmt;
+        skipSpace(&p);
+        if (*p) {
+            ok = parseStatement(&ps, p);
+            ps.statementIndex++;
+        }
+
+        if ( !semicolon) break;
+        stmt = semicolon + 1;
+    }
+
+    if (ok && !foundEnd) {
+        ok = parseError(&ps, "program is missing END", NULL);
+    }
+    _lx_free(text);
+    _lx_free(ps.syms);
+
+    ShaderCPUProgram *prog = ps.prog;
+    if ( !ok) {
+        LXErrorSet(outError, kLXErrorID_Shader_ErrorInString, ps.errMsg);
+        destroyCPUProgram(prog);
+        return NULL;
+    }
+
+    prog->ops = _lx_realloc(prog->ops, (prog->opCount + 1) * sizeof(ShaderCPUOp));
+    memset(prog->ops + prog->opCount, 0, sizeof(ShaderCPUOp));  // END
+
+    prog->nativeKernel = findNativeKernel(str, len);
+    return prog;
+}
+
+
+#pragma mark --- C kernel output ---
+
+/*
+  The generated kernel has the same structure as runOps(): each op is a loop over the batch,
+  and registers are rows of LXSHADERCPU_BATCHSIZE floats. Within a loop, all sources of a pixel are read
+  before its destination is written, so ops can write into their own sources.
+*/
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t capacity;
+} ShaderCPUCodeBuf;
+
+static void appendCode(ShaderCPUCodeBuf *code, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (n < 0) return;
+
+    if (code->len + n + 1 > code->capacity) {
+        code->capacity = MAX(code->capacity * 2, code->len + n + 1024);
+        code->buf = _lx_realloc(code->buf, code->capacity);
+    }
+    va_start(args, fmt);
+    vsnprintf(code->buf + code->len, n + 1, fmt, args);
+    va_end(args);
+    code->len += n;
+}
+
+// formats a float so that it reads back exactly as a C float literal
+static void formatFloatLiteral(float f, char *buf, size_t bufSize)
+{
+    if (isnan(f)) {
+        snprintf(buf, bufSize, "NAN");
+    } else if (isinf(f)) {
+        snprintf(buf, bufSize, (f > 0.0f) ? "HUGE_VALF" : "(-HUGE_VALF)");
+    } else {
+        char num[40];
+        snprintf(num, sizeof(num), "%.9g", f);
+        const char *fmt = (strpbrk(num, ".e")) ? ((f < 0.0f) ? "(%sf)" : "%sf")
+                                               : ((f < 0.0f) ? "(%s.0f)" : "%s.0f");
+        snprintf(buf, bufSize, fmt, num);
+    }
+}
+
+static const ShaderCPUUniform *uniformForReg(const ShaderCPUProgram *prog, int reg)
+{
+    int i;
+    for (i = 0; i < prog->uniformCount; i++) {
+        if (prog->uniforms[i].reg == reg)
+            return prog->uniforms + i;
+    }
+    return NULL;
+}
+
+static void formatRegName(int reg, char *buf, size_t bufSize)
+{
+    if (reg == kShaderCPUReg_ResultColor)       snprintf(buf, bufSize, "res");
+    else if (reg == kShaderCPUReg_Discard)      snprintf(buf, bufSize, "dsc");
+    else if (reg == kShaderCPUReg_Position)     snprintf(buf, bufSize, "pos");
+    else if (reg >= kShaderCPUReg_TexCoord0 && reg < kShaderCPUReg_TexCoord0 + SHCPU_MAXTEXUNITS)
+                                                snprintf(buf, bufSize, "tc%i", reg - kShaderCPUReg_TexCoord0);
+    else                                        snprintf(buf, bufSize, "r%i", reg);
+}
+
+// the row that holds a source component, or NULL if the value is the same for every pixel
+static LXBool formatSrcRow(const ShaderCPUProgram *prog, int row, char *buf, size_t bufSize)
+{
+    const int reg = row / 4;
+    const int comp = row % 4;
+    char name[16];
+
+    if (reg == kShaderCPUReg_Color || reg == kShaderCPUReg_SwzConst || uniformForReg(prog, reg))
+        return NO;
+    if (comp == 3 && (reg == kShaderCPUReg_Position || (reg >= kShaderCPUReg_TexCoord0 && reg < kShaderCPUReg_TexCoord0 + SHCPU_MAXTEXUNITS)))
+        return NO;
+    if (comp == 2 && reg >= kShaderCPUReg_TexCoord0 && reg < kShaderCPUReg_TexCoord0 + SHCPU_MAXTEXUNITS)
+        return NO;
+
+    formatRegName(reg, name, sizeof(name));
+    snprintf(buf, bufSize, "%s[%i]", name, comp);
+    return YES;
+}
+
+// C expression for one component of an op's source for pixel i
+static void formatSrc(const ShaderCPUProgram *prog, const ShaderCPUOp *op, int s, int c, char *buf, size_t bufSize)
+{
+    const int row = op->srcRow[s][c];
+    const int reg = row / 4;
+    const int comp = row % 4;
+    const LXBool isNeg = (op->negMask[s] >> c) & 1;
+    const ShaderCPUUniform *u;
+    char str[48];
+
+    if (formatSrcRow(prog, row, str, sizeof(str) - 3)) {
+        strcat(str, "[i]");
+    } else if (reg == kShaderCPUReg_SwzConst) {
+        snprintf(str, sizeof(str), (comp == 1) ? "1.0f" : "0.0f");
+    } else if ((u = uniformForReg(prog, reg))) {
+        if (u->localIndex >= 0)
+            snprintf(str, sizeof(str), "p[%i]", u->localIndex * 4 + comp);
+        else
+            formatFloatLiteral(u->value[comp], str, sizeof(str));
+    } else {
+        // fragment.color, and the constant z and w of texcoords and position
+        snprintf(str, sizeof(str), (reg != kShaderCPUReg_Color && comp == 2) ? "0.0f" : "1.0f");
+    }
+
+    snprintf(buf, bufSize, (isNeg) ? "(-%s)" : "%s", str);
+}
+
+static void appendLaneLoopStart(ShaderCPUCodeBuf *code)
+{
+    appendCode(code, "    for (i = 0; i < LXSHADERCPU_BATCHSIZE; i++) {\n");
+}
+
+static void appendOp(ShaderCPUCodeBuf *code, const ShaderCPUProgram *prog, const ShaderCPUOp *op)
+{
+    char a[4][64], b[4][64], d[4][64];
+    char dstName[16];
+    const int srcCount = s_opInfo[op->op].srcCount;
+    LXBool isScalarResult = NO;
+    int c;
+
+    for (c = 0; c < 4; c++) {
+        if (srcCount > 0) formatSrc(prog, op, 0, c, a[c], sizeof(a[c]));
+        if (srcCount > 1) formatSrc(prog, op, 1, c, b[c], sizeof(b[c]));
+        if (srcCount > 2) formatSrc(prog, op, 2, c, d[c], sizeof(d[c]));
+    }
+    formatRegName(op->dst, dstName, sizeof(dstName));
+
+    appendCode(code, "\n    // %s%s\n", s_opInfo[op->op].name, (op->sat) ? "_SAT" : "");
+
+    if (op->op == ShaderCPUOp_KIL) {
+        appendLaneLoopStart(code);
+        appendCode(code, "        if (%s < 0.0f || %s < 0.0f || %s < 0.0f || %s < 0.0f) args->killed[i] = 1;\n    }\n",
+                            a[0], a[1], a[2], a[3]);
+        return;
+    }
+
+    if (s_opInfo[op->op].flags & kShaderCPUOpFlag_Texture) {
+        const char *target = (op->texTarget == kShaderCPUTexTarget_2D) ? "kLXShaderCPUKernelTexTarget_2D"
+                           : ((op->texTarget == kShaderCPUTexTarget_1D) ? "kLXShaderCPUKernelTexTarget_1D"
+                                                                        : "kLXShaderCPUKernelTexTarget_RECT");
+        char uRow[48], vRow[48];
+
+        // coordinates are passed as rows; other sources are computed into temporary rows
+        if (op->op == ShaderCPUOp_TXP || op->negMask[0]
+                    || !formatSrcRow(prog, op->srcRow[0][0], uRow, sizeof(uRow))
+                    || !formatSrcRow(prog, op->srcRow[0][1], vRow, sizeof(vRow))) {
+            appendLaneLoopStart(code);
+            if (op->op == ShaderCPUOp_TXP)
+                appendCode(code, "        u_[i] = %s / %s;\n        v_[i] = %s / %s;\n", a[0], a[3], a[1], a[3]);
+            else
+                appendCode(code, "        u_[i] = %s;\n        v_[i] = %s;\n", a[0], a[1]);
+            appendCode(code, "    }\n");
+            strcpy(uRow, "u_");
+            strcpy(vRow, "v_");
+        }
+        if (op->dstMask == 0xf && !op->sat && op->dst >= kShaderCPUReg_FirstAllocated) {
+            // a full write to a temporary is sampled in place
+            appendCode(code, "    args->sample(args->sampler, %i, %s, %s, %s, %s);\n", (int)op->texUnit, target, uRow, vRow, dstName);
+            return;
+        }
+        appendCode(code, "    args->sample(args->sampler, %i, %s, %s, %s, tex_);\n", (int)op->texUnit, target, uRow, vRow);
+
+        for (c = 0; c < 4; c++)
+            snprintf(a[c], sizeof(a[c]), "tex_[%i][i]", c);
+    }
+
+    appendLaneLoopStart(code);
+
+    // same expressions and evaluation order as runOps()
+    switch (op->op) {
+        case ShaderCPUOp_ABS: case ShaderCPUOp_ADD: case ShaderCPUOp_CMP: case ShaderCPUOp_FLR:
+        case ShaderCPUOp_FRC: case ShaderCPUOp_LRP: case ShaderCPUOp_MAD: case ShaderCPUOp_MAX:
+        case ShaderCPUOp_MIN: case ShaderCPUOp_MOV: case ShaderCPUOp_SWZ: case ShaderCPUOp_MUL:
+        case ShaderCPUOp_SGE: case ShaderCPUOp_SLT: case ShaderCPUOp_SUB:
+        case ShaderCPUOp_TEX: case ShaderCPUOp_TXB: case ShaderCPUOp_TXP:
+            for (c = 0; c < 4; c++) {
+                if ( !(op->dstMask & (1 << c))) continue;
+                appendCode(code, "        const float t%i = ", c);
+                switch (op->op) {
+                    case ShaderCPUOp_ABS:  appendCode(code, "fabsf(%s)", a[c]);  break;
+                    case ShaderCPUOp_ADD:  appendCode(code, "%s + %s", a[c], b[c]);  break;
+                    case ShaderCPUOp_CMP:  appendCode(code, "(%s < 0.0f) ? %s : %s", a[c], b[c], d[c]);  break;
+                    case ShaderCPUOp_FLR:  appendCode(code, "floorf(%s)", a[c]);  break;
+                    case ShaderCPUOp_FRC:  appendCode(code, "%s - floorf(%s)", a[c], a[c]);  break;
+                    case ShaderCPUOp_LRP:  appendCode(code, "%s * %s + (1.0f - %s) * %s", a[c], b[c], a[c], d[c]);  break;
+                    case ShaderCPUOp_MAD:  appendCode(code, "%s * %s + %s", a[c], b[c], d[c]);  break;
+                    case ShaderCPUOp_MAX:  appendCode(code, "(%s > %s) ? %s : %s", a[c], b[c], a[c], b[c]);  break;
+                    case ShaderCPUOp_MIN:  appendCode(code, "(%s < %s) ? %s : %s", a[c], b[c], a[c], b[c]);  break;
+                    case ShaderCPUOp_MUL:  appendCode(code, "%s * %s", a[c], b[c]);  break;
+                    case ShaderCPUOp_SGE:  appendCode(code, "(%s < %s) ? 0.0f : 1.0f", a[c], b[c]);  break;
+                    case ShaderCPUOp_SLT:  appendCode(code, "(%s < %s) ? 1.0f : 0.0f", a[c], b[c]);  break;
+                    case ShaderCPUOp_SUB:  appendCode(code, "%s - %s", a[c], b[c]);  break;
+                    default:               appendCode(code, "%s", a[c]);  break;
+                }
+                appendCode(code, ";\n");
+            }
+            break;
+
+        case ShaderCPUOp_DP3:
+        case ShaderCPUOp_DP4:
+        case ShaderCPUOp_DPH:
+            appendCode(code, "        const float t0 = %s * %s + %s * %s + %s * %s", a[0], b[0], a[1], b[1], a[2], b[2]);
+            if (op->op == ShaderCPUOp_DP4)
+                appendCode(code, " + %s * %s", a[3], b[3]);
+            else if (op->op == ShaderCPUOp_DPH)
+                appendCode(code, " + %s", b[3]);
+            appendCode(code, ";\n");
+            isScalarResult = YES;
+            break;
+
+        case ShaderCPUOp_XPD:
+        case ShaderCPUOp_DST:
+        case ShaderCPUOp_LIT:
+        case ShaderCPUOp_SCS:
+            if (op->op == ShaderCPUOp_LIT) {
+                if (op->dstMask & 0x6)
+                    appendCode(code, "        const float x_ = (%s > 0.0f) ? %s : 0.0f;\n", a[0], a[0]);
+                if (op->dstMask & 0x4)
+                    appendCode(code, "        const float y_ = (%s > 0.0f) ? %s : 0.0f;\n"
+                                     "        const float w_ = (%s > -128.0f) ? ((%s < 128.0f) ? %s : 128.0f) : -128.0f;\n",
+                                        a[1], a[1], a[3], a[3], a[3]);
+            }
+            for (c = 0; c < 4; c++) {
+                if ( !(op->dstMask & (1 << c))) continue;
+                appendCode(code, "        const float t%i = ", c);
+                switch (op->op) {
+                    case ShaderCPUOp_XPD:
+                        if (c == 3)
+                            appendCode(code, "1.0f");
+                        else
+                            appendCode(code, "%s * %s - %s * %s", a[(c + 1) % 3], b[(c + 2) % 3], a[(c + 2) % 3], b[(c + 1) % 3]);
+                        break;
+                    case ShaderCPUOp_DST:
+                        if (c == 0)         appendCode(code, "1.0f");
+                        else if (c == 1)    appendCode(code, "%s * %s", a[1], b[1]);
+                        else if (c == 2)    appendCode(code, "%s", a[2]);
+                        else                appendCode(code, "%s", b[3]);
+                        break;
+                    case ShaderCPUOp_LIT:
+                        if (c == 1)         appendCode(code, "x_");
+                        else if (c == 2)    appendCode(code, "(x_ > 0.0f) ? powf(y_, w_) : 0.0f");
+                        else                appendCode(code, "1.0f");
+                        break;
+                    default:
+                        if (c == 0)         appendCode(code, "cosf(%s)", a[0]);
+                        else if (c == 1)    appendCode(code, "sinf(%s)", a[0]);
+                        else                appendCode(code, "0.0f");
+                        break;
+                }
+                appendCode(code, ";\n");
+            }
+            break;
+
+        case ShaderCPUOp_RCP:  appendCode(code, "        const float t0 = 1.0f / %s;\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_RSQ:  appendCode(code, "        const float t0 = 1.0f / sqrtf(fabsf(%s));\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_COS:  appendCode(code, "        const float t0 = cosf(%s);\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_SIN:  appendCode(code, "        const float t0 = sinf(%s);\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_EX2:  appendCode(code, "        const float t0 = exp2f(%s);\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_LG2:  appendCode(code, "        const float t0 = log2f(%s);\n", a[0]);  isScalarResult = YES;  break;
+        case ShaderCPUOp_POW:  appendCode(code, "        const float t0 = powf(%s, %s);\n", a[0], b[0]);  isScalarResult = YES;  break;
+    }
+
+    for (c = 0; c < 4; c++) {
+        if ( !(op->dstMask & (1 << c))) continue;
+        const int k = (isScalarResult) ? 0 : c;
+        if (op->sat)
+            appendCode(code, "        %s[%i][i] = LXSHCPU_SAT(t%i);\n", dstName, c, k);
+        else
+            appendCode(code, "        %s[%i][i] = t%i;\n", dstName, c, k);
+    }
+    appendCode(code, "    }\n");
+}
+
+LXSuccess LXConvertShaderString_OpenGLARBfp_to_C_kernel(const char *str, const char *funcName, char **outStr)
+{
+    if ( !str || !funcName || !*funcName || !outStr) return NO;
+
+    // the cache key includes the generator version, so that changes to the output invalidate cached files
+    char *target = _lx_malloc(strlen(funcName) + 16);
+    sprintf(target, "c%i:%s", SHCPU_CKERNEL_VERSION, funcName);
+
+    if (LXShaderTranslationCacheLookup_(target, str, outStr, NULL)) {
+        _lx_free(target);
+        return YES;
+    }
+
+    LXError err;
+    memset(&err, 0, sizeof(err));
+    ShaderCPUProgram *prog = _LXShaderCPUProgramCreate(str, strlen(str), &err);
+    if ( !prog) {
+        LXPrintf("*** %s: can't parse program (%s)\n", __func__, err.description);
+        LXErrorDestroyOnStack(err);
+        _lx_free(target);
+        return NO;
+    }
+
+    ShaderCPUCodeBuf code;
+    const ShaderCPUOp *op;
+    LXBool usesParams = NO, writesDiscard = NO, needsTexTemp = NO, hasTexCoordTemps = NO;
+    int resultMask = 0;
+    int i, c, reg;
+
+    memset(&code, 0, sizeof(code));
+
+    for (i = 0; i < prog->uniformCount; i++) {
+        if (prog->uniforms[i].localIndex >= 0) usesParams = YES;
+    }
+    for (op = prog->ops; op->op != ShaderCPUOp_END; op++) {
+        if (op->dst == kShaderCPUReg_Discard && op->dstMask) writesDiscard = YES;
+        if (op->dst == kShaderCPUReg_ResultColor) resultMask |= op->dstMask;
+        if (s_opInfo[op->op].flags & kShaderCPUOpFlag_Texture) {
+            if ( !(op->dstMask == 0xf && !op->sat && op->dst >= kShaderCPUReg_FirstAllocated))
+                needsTexTemp = YES;
+            if (op->op == ShaderCPUOp_TXP || op->negMask[0])
+                hasTexCoordTemps = YES;
+        }
+    }
+
+    appendCode(&code, "#ifndef LXSHCPU_SAT\n"
+                      "#define LXSHCPU_SAT(x_)  ((((x_) > 0.0f) ? (x_) : 0.0f) < 1.0f ? (((x_) > 0.0f) ? (x_) : 0.0f) : 1.0f)\n"
+                      "#endif\n\n");
+    appendCode(&code, "void %s(const LXShaderCPUKernelArgs *args)\n{\n", funcName);
+
+    if (usesParams)
+        appendCode(&code, "    const float *p = args->params;\n");
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        if (prog->usedTexCoords & (1 << i))
+            appendCode(&code, "    const float * const *tc%i = args->texCoord[%i];\n", i, i);
+    }
+    if (prog->usesPosition)
+        appendCode(&code, "    const float * const *pos = args->position;\n");
+    appendCode(&code, "    float * const *res = args->color;\n");
+    if (writesDiscard)
+        appendCode(&code, "    float dsc[4][LXSHADERCPU_BATCHSIZE];  // result.depth is ignored\n");
+    for (reg = kShaderCPUReg_FirstAllocated; reg < prog->regCount; reg++) {
+        if ( !uniformForReg(prog, reg))
+            appendCode(&code, "    float r%i[4][LXSHADERCPU_BATCHSIZE] = { { 0.0f } };\n", reg);
+    }
+    if (needsTexTemp)
+        appendCode(&code, "    float tex_[4][LXSHADERCPU_BATCHSIZE];\n");
+    if (hasTexCoordTemps)
+        appendCode(&code, "    float u_[LXSHADERCPU_BATCHSIZE], v_[LXSHADERCPU_BATCHSIZE];\n");
+    appendCode(&code, "    int i;\n");
+
+    if (resultMask != 0xf) {
+        appendCode(&code, "\n");
+        appendLaneLoopStart(&code);
+        for (c = 0; c < 4; c++) {
+            if ( !(resultMask & (1 << c)))
+                appendCode(&code, "        res[%i][i] = 0.0f;\n", c);
+        }
+        appendCode(&code, "    }\n");
+    }
+
+    for (op = prog->ops; op->op != ShaderCPUOp_END; op++) {
+        appendOp(&code, prog, op);
+    }
+    appendCode(&code, "}\n");
+
+    destroyCPUProgram(prog);
+
+    LXShaderTranslationCacheStore_(target, str, code.buf, NULL);
+    _lx_free(target);
+
+    *outStr = code.buf;
+    return YES;
+}
+
+#pragma mark --- sampling ---
+
+typedef struct {
+    const float *data;          // RGBA float32
+    size_t rowFloats;
+    int32_t w;
+    int32_t h;
+    LXUInteger sampling;
+    LXUInteger wrapMode;
+
+    LXPixelBufferRef lockedPixbuf;
+    float *convertedBuf;
+} ShaderCPUSource;
+
+static const float s_borderTexel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+LXINLINE int32_t texelIndex(float f)
+{
+    // also catches NaN
+    if ( !(f > -1.0e9f && f < 1.0e9f))
+        f = (f > 0.0f) ? 1.0e9f : -1.0e9f;
+
+    // floor without a libm call
+    const int32_t i = (int32_t)f;
+    return (f < (float)i) ? i - 1 : i;
+}
+
+LXINLINE const float *texelAt(const ShaderCPUSource *src, int32_t x, int32_t y)
+{
+    if (x < 0 || y < 0 || x >= src->w || y >= src->h) {
+        switch (src->wrapMode) {
+            case kLXWrapMode_ClampToBorder:
+                return s_borderTexel;
+            case kLXWrapMode_Repeat:
+                x %= src->w;  if (x < 0) x += src->w;
+                y %= src->h;  if (y < 0) y += src->h;
+                break;
+            default:
+                x = MIN(MAX(x, 0), src->w - 1);
+                y = MIN(MAX(y, 0), src->h - 1);
+                break;
+        }
+    }
+    return src->data + y * src->rowFloats + x * 4;
+}
+
+// coordinates are in texels
+LXINLINE void sampleSource(const ShaderCPUSource *src, float u, float v, float *outRGBA)
+{
+    if (src->sampling == kLXLinearSampling) {
+        const float fu = u - 0.5f;
+        const float fv = v - 0.5f;
+        const int32_t x = texelIndex(fu);
+        const int32_t y = texelIndex(fv);
+        const float ax = fu - floorf(fu);
+        const float ay = fv - floorf(fv);
+        const float *t00 = texelAt(src, x, y),      *t10 = texelAt(src, x + 1, y);
+        const float *t01 = texelAt(src, x, y + 1),  *t11 = texelAt(src, x + 1, y + 1);
+        int c;
+        for (c = 0; c < 4; c++) {
+            float top = t00[c] + (t10[c] - t00[c]) * ax;
+            float bottom = t01[c] + (t11[c] - t01[c]) * ax;
+            outRGBA[c] = top + (bottom - top) * ay;
+        }
+    }
+    else {
+        const float *t = texelAt(src, texelIndex(u), texelIndex(v));
+        outRGBA[0] = t[0];  outRGBA[1] = t[1];  outRGBA[2] = t[2];  outRGBA[3] = t[3];
+    }
+}
+
+// samples a batch of coordinates given in the units of the texture target; the result is four rows (one per channel)
+static void sampleRows(const ShaderCPUSource *src, int texTarget, const float *u, const float *v, float (*outRGBA)[SHCPU_WIDTH])
+{
+    const float su = (texTarget == kShaderCPUTexTarget_RECT) ? 1.0f : (float)src->w;
+    const float sv = (texTarget == kShaderCPUTexTarget_2D) ? (float)src->h : 1.0f;
+    float texel[4];
+    int j;
+
+    for (j = 0; j < SHCPU_WIDTH; j++) {
+        const float tu = u[j] * su;
+        const float tv = (texTarget == kShaderCPUTexTarget_1D) ? 0.5f : v[j] * sv;
+
+        if (src->sampling != kLXLinearSampling) {
+            // nearest sampling inside the image is the common case, so it's done inline
+            const int32_t x = texelIndex(tu);
+            const int32_t y = texelIndex(tv);
+            if (x >= 0 && y >= 0 && x < src->w && y < src->h) {
+                const float *t = src->data + y * src->rowFloats + x * 4;
+                outRGBA[0][j] = t[0];  outRGBA[1][j] = t[1];  outRGBA[2][j] = t[2];  outRGBA[3][j] = t[3];
+                continue;
+            }
+        }
+        sampleSource(src, tu, tv, texel);
+        outRGBA[0][j] = texel[0];  outRGBA[1][j] = texel[1];  outRGBA[2][j] = texel[2];  outRGBA[3][j] = texel[3];
+    }
+}
+
+static void sampleForNativeKernel(void *sampler, LXInteger unit, LXInteger texTarget, const float *u, const float *v,
+                                  float (*outRGBA)[LXSHADERCPU_BATCHSIZE])
+{
+    const ShaderCPUSource *sources = (const ShaderCPUSource *)sampler;
+    sampleRows(sources + unit, (int)texTarget, u, v, outRGBA);
+}
+
+#pragma mark --- execution ---
+
+typedef struct {
+    uint8_t *fileBuf;
+    float *file;                // register rows, followed by negated source rows and result rows
+    float *tileBuf;             // RGBA float32 tile for destination formats that need conversion
+    uint8_t kill[SHCPU_WIDTH];
+} ShaderCPUWorker;
+
+typedef struct {
+    const ShaderCPUProgram *prog;
+    const float *params;
+
+    ShaderCPUSource sources[SHCPU_MAXTEXUNITS];
+    float texCoordScale[SHCPU_MAXTEXUNITS][2];
+
+    int32_t dstW;
+    int32_t dstH;
+    uint8_t *dstData;
+    size_t dstRowBytes;
+    LXPixelFormat dstPxFormat;
+    size_t dstBytesPerPixel;
+
+    LXInteger tilesPerRow;
+    LXBool progIsTemporary;
+    ShaderCPUWorker workers[kLXParallelMaxWorkers];
+    volatile int32_t failed;
+} ShaderCPURenderJob;
+
+
+#define ROW(i_)     (file + (i_) * SHCPU_WIDTH)
+
+#define VEC_OP1(vop_) \
+            for (c = 0; c < 4; c++) { \
+                if ( !(op->dstMask & (1 << c))) continue; \
+                const float *a_ = src[0][c]; \
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[c] + j, vop_(FPCV_LOAD(a_ + j))); \
+            }
+
+#define VEC_OP2(vop_) \
+            for (c = 0; c < 4; c++) { \
+                if ( !(op->dstMask & (1 << c))) continue; \
+                const float *a_ = src[0][c], *b_ = src[1][c]; \
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[c] + j, vop_(FPCV_LOAD(a_ + j), FPCV_LOAD(b_ + j))); \
+            }
+
+#define VEC_OP3(vop_) \
+            for (c = 0; c < 4; c++) { \
+                if ( !(op->dstMask & (1 << c))) continue; \
+                const float *a_ = src[0][c], *b_ = src[1][c], *c_ = src[2][c]; \
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) \
+                    FPCV_STORE(res[c] + j, vop_(FPCV_LOAD(a_ + j), FPCV_LOAD(b_ + j), FPCV_LOAD(c_ + j))); \
+            }
+
+// scalar results are computed into res[0] and replicated
+#define SCALAR_LIBM_OP1(expr_) \
+            for (j = 0; j < SHCPU_WIDTH; j++) { \
+                const float x = src[0][0][j]; \
+                res[0][j] = expr_; \
+            } \
+            isScalarResult = YES;
+
+#define SHCPU_IDENTITY(a_)      (a_)
+#define SHCPU_SGE(a_, b_)       FPCV_SELECT(FPCV_LT(a_, b_), FPCV_SPLAT(0.0f), FPCV_SPLAT(1.0f))
+#define SHCPU_SLT(a_, b_)       FPCV_SELECT(FPCV_LT(a_, b_), FPCV_SPLAT(1.0f), FPCV_SPLAT(0.0f))
+
+
+// the kernel reads its inputs from and writes its result to the same rows that runOps() uses
+static void runNativeKernel(const ShaderCPURenderJob *job, ShaderCPUWorker *worker)
+{
+    float * LXRESTRICT file = worker->file;
+    LXShaderCPUKernelArgs args;
+    int i, c;
+
+    memset(&args, 0, sizeof(args));
+    args.params = job->params;
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        args.texCoord[i][0] = ROW((kShaderCPUReg_TexCoord0 + i) * 4);
+        args.texCoord[i][1] = ROW((kShaderCPUReg_TexCoord0 + i) * 4 + 1);
+    }
+    for (c = 0; c < 3; c++)
+        args.position[c] = ROW(kShaderCPUReg_Position * 4 + c);
+    for (c = 0; c < 4; c++)
+        args.color[c] = ROW(kShaderCPUReg_ResultColor * 4 + c);
+    args.sample = sampleForNativeKernel;
+    args.sampler = (void *)job->sources;
+    args.killed = worker->kill;
+
+    job->prog->nativeKernel(&args);
+}
+
+static void runOps(const ShaderCPURenderJob *job, ShaderCPUWorker *worker)
+{
+    if (job->prog->nativeKernel) {
+        runNativeKernel(job, worker);
+        return;
+    }
+
+    const ShaderCPUOp *op = job->prog->ops;
+    float * LXRESTRICT file = worker->file;
+    float *negRows = ROW(job->prog->regCount * 4);
+    float (*res)[SHCPU_WIDTH] = (float (*)[SHCPU_WIDTH]) ROW(job->prog->regCount * 4 + 12);
+    const float *src[3][4];
+    int s, c, j;
+
+    for (; op->op != ShaderCPUOp_END; op++) {
+        const int srcCount = s_opInfo[op->op].srcCount;
+        LXBool isScalarResult = NO;
+
+        for (s = 0; s < srcCount; s++) {
+            for (c = 0; c < 4; c++) {
+                const float *row = ROW(op->srcRow[s][c]);
+                if (op->negMask[s] & (1 << c)) {
+                    float *negRow = negRows + (s * 4 + c) * SHCPU_WIDTH;
+                    for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH)
+                        FPCV_STORE(negRow + j, FPCV_SUB(FPCV_SPLAT(-0.0f), FPCV_LOAD(row + j)));
+                    row = negRow;
+                }
+                src[s][c] = row;
+            }
+        }
+
+        switch (op->op) {
+            case ShaderCPUOp_ABS:   VEC_OP1(FPCV_ABS);          break;
+            case ShaderCPUOp_ADD:   VEC_OP2(FPCV_ADD);          break;
+            case ShaderCPUOp_CMP:   VEC_OP3(FPCV_CMP);          break;
+            case ShaderCPUOp_FLR:   VEC_OP1(FPCV_FLOOR);        break;
+            case ShaderCPUOp_FRC:   VEC_OP1(FPCV_FRC);          break;
+            case ShaderCPUOp_LRP:   VEC_OP3(FPCV_LRP);          break;
+            case ShaderCPUOp_MAD:   VEC_OP3(FPCV_MAD);          break;
+            case ShaderCPUOp_MAX:   VEC_OP2(FPCV_MAX);          break;
+            case ShaderCPUOp_MIN:   VEC_OP2(FPCV_MIN);          break;
+            case ShaderCPUOp_MOV:
+            case ShaderCPUOp_SWZ:   VEC_OP1(SHCPU_IDENTITY);    break;
+            case ShaderCPUOp_MUL:   VEC_OP2(FPCV_MUL);          break;
+            case ShaderCPUOp_SGE:   VEC_OP2(SHCPU_SGE);         break;
+            case ShaderCPUOp_SLT:   VEC_OP2(SHCPU_SLT);         break;
+            case ShaderCPUOp_SUB:   VEC_OP2(FPCV_SUB);          break;
+
+            case ShaderCPUOp_DP3:
+            case ShaderCPUOp_DP4:
+            case ShaderCPUOp_DPH:
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) {
+                    FPCVec d = FPCV_MUL(FPCV_LOAD(src[0][0] + j), FPCV_LOAD(src[1][0] + j));
+                    d = FPCV_ADD(d, FPCV_MUL(FPCV_LOAD(src[0][1] + j), FPCV_LOAD(src[1][1] + j)));
+                    d = FPCV_ADD(d, FPCV_MUL(FPCV_LOAD(src[0][2] + j), FPCV_LOAD(src[1][2] + j)));
+                    if (op->op == ShaderCPUOp_DP4)
+                        d = FPCV_ADD(d, FPCV_MUL(FPCV_LOAD(src[0][3] + j), FPCV_LOAD(src[1][3] + j)));
+                    else if (op->op == ShaderCPUOp_DPH)
+                        d = FPCV_ADD(d, FPCV_LOAD(src[1][3] + j));
+                    FPCV_STORE(res[0] + j, d);
+                }
+                isScalarResult = YES;
+                break;
+
+            case ShaderCPUOp_XPD:
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) {
+                    FPCVec ax = FPCV_LOAD(src[0][0] + j), ay = FPCV_LOAD(src[0][1] + j), az = FPCV_LOAD(src[0][2] + j);
+                    FPCVec bx = FPCV_LOAD(src[1][0] + j), by = FPCV_LOAD(src[1][1] + j), bz = FPCV_LOAD(src[1][2] + j);
+                    FPCV_STORE(res[0] + j, FPCV_SUB(FPCV_MUL(ay, bz), FPCV_MUL(az, by)));
+                    FPCV_STORE(res[1] + j, FPCV_SUB(FPCV_MUL(az, bx), FPCV_MUL(ax, bz)));
+                    FPCV_STORE(res[2] + j, FPCV_SUB(FPCV_MUL(ax, by), FPCV_MUL(ay, bx)));
+                    FPCV_STORE(res[3] + j, FPCV_SPLAT(1.0f));
+                }
+                break;
+
+            case ShaderCPUOp_DST:
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH) {
+                    FPCV_STORE(res[0] + j, FPCV_SPLAT(1.0f));
+                    FPCV_STORE(res[1] + j, FPCV_MUL(FPCV_LOAD(src[0][1] + j), FPCV_LOAD(src[1][1] + j)));
+                    FPCV_STORE(res[2] + j, FPCV_LOAD(src[0][2] + j));
+                    FPCV_STORE(res[3] + j, FPCV_LOAD(src[1][3] + j));
+                }
+                break;
+
+            case ShaderCPUOp_LIT:
+                for (j = 0; j < SHCPU_WIDTH; j++) {
+                    const float x = MAX(src[0][0][j], 0.0f);
+                    const float y = MAX(src[0][1][j], 0.0f);
+                    const float w = MIN(MAX(src[0][3][j], -128.0f), 128.0f);
+                    res[0][j] = 1.0f;
+                    res[1][j] = x;
+                    res[2][j] = (x > 0.0f) ? powf(y, w) : 0.0f;
+                    res[3][j] = 1.0f;
+                }
+                break;
+
+            case ShaderCPUOp_SCS:
+                for (j = 0; j < SHCPU_WIDTH; j++) {
+                    const float x = src[0][0][j];
+                    res[0][j] = cosf(x);
+                    res[1][j] = sinf(x);
+                    res[2][j] = res[3][j] = 0.0f;
+                }
+                break;
+
+            case ShaderCPUOp_RCP:
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH)
+                    FPCV_STORE(res[0] + j, FPCV_DIV(FPCV_SPLAT(1.0f), FPCV_LOAD(src[0][0] + j)));
+                isScalarResult = YES;
+                break;
+
+            case ShaderCPUOp_RSQ:
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH)
+                    FPCV_STORE(res[0] + j, FPCV_DIV(FPCV_SPLAT(1.0f), FPCV_SQRT(FPCV_ABS(FPCV_LOAD(src[0][0] + j)))));
+                isScalarResult = YES;
+                break;
+
+            case ShaderCPUOp_COS:   SCALAR_LIBM_OP1(cosf(x));       break;
+            case ShaderCPUOp_SIN:   SCALAR_LIBM_OP1(sinf(x));       break;
+            case ShaderCPUOp_EX2:   SCALAR_LIBM_OP1(exp2f(x));      break;
+            case ShaderCPUOp_LG2:   SCALAR_LIBM_OP1(log2f(x));      break;
+            case ShaderCPUOp_POW:   SCALAR_LIBM_OP1(powf(x, src[1][0][j]));  break;
+
+            case ShaderCPUOp_KIL:
+                for (j = 0; j < SHCPU_WIDTH; j++) {
+                    if (src[0][0][j] < 0.0f || src[0][1][j] < 0.0f || src[0][2][j] < 0.0f || src[0][3][j] < 0.0f)
+                        worker->kill[j] = 1;
+                }
+                continue;
+
+            case ShaderCPUOp_TEX:
+            case ShaderCPUOp_TXB:   // there are no mipmaps, so the LOD bias has no effect
+            case ShaderCPUOp_TXP: {
+                const float *u = src[0][0];
+                const float *v = src[0][1];
+                if (op->op == ShaderCPUOp_TXP) {
+                    // the projected coordinates go into result rows; each pixel's coordinates are read before its texel is written
+                    for (j = 0; j < SHCPU_WIDTH; j++) {
+                        const float q = src[0][3][j];
+                        res[2][j] = src[0][0][j] / q;
+                        res[3][j] = src[0][1][j] / q;
+                    }
+                    u = res[2];
+                    v = res[3];
+                }
+                sampleRows(job->sources + op->texUnit, op->texTarget, u, v, res);
+                break;
+            }
+        }
+
+        // write masked channels
+        for (c = 0; c < 4; c++) {
+            if ( !(op->dstMask & (1 << c))) continue;
+            const float *r = res[(isScalarResult) ? 0 : c];
+            float *d = ROW(op->dst * 4 + c);
+            if (op->sat) {
+                for (j = 0; j < SHCPU_WIDTH; j += FPCV_WIDTH)
+                    FPCV_STORE(d + j, FPCV_MIN(FPCV_MAX(FPCV_LOAD(r + j), FPCV_SPLAT(0.0f)), FPCV_SPLAT(1.0f)));
+            } else {
+                memcpy(d, r, SHCPU_WIDTH * sizeof(float));
+            }
+        }
+    }
+}
+
+static LXSuccess prepareWorker(const ShaderCPURenderJob *job, ShaderCPUWorker *worker)
+{
+    const ShaderCPUProgram *prog = job->prog;
+    const size_t rowCount = prog->regCount * 4 + 12 + 4;  // registers, negated sources, result
+    float *file;
+    int i, j, c;
+
+    worker->fileBuf = _lx_calloc(rowCount * SHCPU_WIDTH * sizeof(float) + 16, 1);
+    worker->file = file = (float *) (((uintptr_t)worker->fileBuf + 15) & ~(uintptr_t)15);
+
+    if (job->dstPxFormat != kLX_RGBA_FLOAT32) {
+        worker->tileBuf = _lx_malloc(SHCPU_TILE_W * SHCPU_TILE_H * 4 * sizeof(float));
+    }
+    if ( !worker->fileBuf || (job->dstPxFormat != kLX_RGBA_FLOAT32 && !worker->tileBuf))
+        return NO;
+
+    // rows that are the same for every pixel
+    for (i = 0; i < prog->uniformCount; i++) {
+        const ShaderCPUUniform *u = prog->uniforms + i;
+        const float *v = (u->localIndex >= 0) ? job->params + 4 * u->localIndex : u->value;
+        for (c = 0; c < 4; c++) {
+            float *row = ROW(u->reg * 4 + c);
+            for (j = 0; j < SHCPU_WIDTH; j++) row[j] = v[c];
+        }
+    }
+    for (j = 0; j < SHCPU_WIDTH; j++) {
+        ROW(kShaderCPUReg_SwzConst * 4 + 1)[j] = 1.0f;
+        ROW(kShaderCPUReg_Color * 4 + 0)[j] = 1.0f;
+        ROW(kShaderCPUReg_Color * 4 + 1)[j] = 1.0f;
+        ROW(kShaderCPUReg_Color * 4 + 2)[j] = 1.0f;
+        ROW(kShaderCPUReg_Color * 4 + 3)[j] = 1.0f;
+        ROW(kShaderCPUReg_Position * 4 + 3)[j] = 1.0f;
+        for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+            ROW((kShaderCPUReg_TexCoord0 + i) * 4 + 3)[j] = 1.0f;
+        }
+    }
+    return YES;
+}
+
+static void renderTile(void *userData, LXInteger workerIndex, LXInteger tileIndex)
+{
+    ShaderCPURenderJob *job = (ShaderCPURenderJob *)userData;
+    ShaderCPUWorker *worker = job->workers + workerIndex;
+    const ShaderCPUProgram *prog = job->prog;
+
+    if (job->failed) return;
+
+    if ( !worker->fileBuf && !prepareWorker(job, worker)) {
+        job->failed = 1;
+        return;
+    }
+    float * LXRESTRICT file = worker->file;
+    const float *result[4] = { ROW(0), ROW(1), ROW(2), ROW(3) };
+
+    const int32_t x0 = (int32_t)(tileIndex % job->tilesPerRow) * SHCPU_TILE_W;
+    const int32_t y0 = (int32_t)(tileIndex / job->tilesPerRow) * SHCPU_TILE_H;
+    const int32_t tileW = MIN(SHCPU_TILE_W, job->dstW - x0);
+    const int32_t tileH = MIN(SHCPU_TILE_H, job->dstH - y0);
+    uint8_t *dstTile = job->dstData + y0 * job->dstRowBytes + x0 * job->dstBytesPerPixel;
+    const LXBool isDirect = (job->dstPxFormat == kLX_RGBA_FLOAT32);
+    float *out = (isDirect) ? (float *)dstTile : worker->tileBuf;
+    const size_t outRowFloats = (isDirect) ? job->dstRowBytes / sizeof(float) : tileW * 4;
+    int32_t x, y, j, i;
+
+    if (prog->hasKill && !isDirect) {
+        // killed pixels keep the destination's contents
+        if ( !LXPxConvert_Any_(dstTile, tileW, tileH, job->dstRowBytes, job->dstPxFormat,
+                               (uint8_t *)out, tileW, tileH, outRowFloats * sizeof(float), kLX_RGBA_FLOAT32,
+                               0, 0, 0, 0, NULL)) {
+            job->failed = 1;
+            return;
+        }
+    }
+
+    for (y = 0; y < tileH; y++) {
+        const float fy = (float)(y0 + y) + 0.5f;
+        float *outRow = out + y * outRowFloats;
+
+        for (x = 0; x < tileW; x += SHCPU_WIDTH) {
+            const int32_t laneCount = MIN(SHCPU_WIDTH, tileW - x);
+            const float fx = (float)(x0 + x) + 0.5f;
+
+            for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+                if ( !(prog->usedTexCoords & (1 << i))) continue;
+                float *rowU = ROW((kShaderCPUReg_TexCoord0 + i) * 4);
+                float *rowV = rowU + SHCPU_WIDTH;
+                const float sx = job->texCoordScale[i][0];
+                const float sy = job->texCoordScale[i][1];
+                for (j = 0; j < SHCPU_WIDTH; j++) {
+                    rowU[j] = (fx + j) * sx;
+                    rowV[j] = fy * sy;
+                }
+            }
+            if (prog->usesPosition) {
+                float *rowX = ROW(kShaderCPUReg_Position * 4);
+                float *rowY = rowX + SHCPU_WIDTH;
+                for (j = 0; j < SHCPU_WIDTH; j++) {
+                    rowX[j] = fx + j;
+                    rowY[j] = fy;
+                }
+            }
+            if (prog->hasKill) {
+                memset(worker->kill, 0, SHCPU_WIDTH);
+            }
+
+            runOps(job, worker);
+
+            // transpose the result rows into RGBA pixels
+            float *dst = outRow + x * 4;
+            j = 0;
+#if defined(__SSE2__)
+            if ( !prog->hasKill) {
+                for (; j + 4 <= laneCount; j += 4) {
+                    __m128 r = _mm_load_ps(result[0] + j),  g = _mm_load_ps(result[1] + j);
+                    __m128 b = _mm_load_ps(result[2] + j),  a = _mm_load_ps(result[3] + j);
+                    _MM_TRANSPOSE4_PS(r, g, b, a);
+                    _mm_storeu_ps(dst + j * 4, r);
+                    _mm_storeu_ps(dst + j * 4 + 4, g);
+                    _mm_storeu_ps(dst + j * 4 + 8, b);
+                    _mm_storeu_ps(dst + j * 4 + 12, a);
+                }
+            }
+#endif
+            for (; j < laneCount; j++) {
+                if (prog->hasKill && worker->kill[j]) continue;
+                dst[j * 4 + 0] = result[0][j];
+                dst[j * 4 + 1] = result[1][j];
+                dst[j * 4 + 2] = result[2][j];
+                dst[j * 4 + 3] = result[3][j];
+            }
+        }
+    }
+
+    if ( !isDirect) {
+        if ( !LXPxConvert_Any_((uint8_t *)out, tileW, tileH, outRowFloats * sizeof(float), kLX_RGBA_FLOAT32,
+                               dstTile, tileW, tileH, job->dstRowBytes, job->dstPxFormat,
+                               0, 0, 0, 0, NULL)) {
+            job->failed = 1;
+        }
+    }
+}
+
+static LXSuccess prepareSource(ShaderCPUSource *src, LXPixelBufferRef pixbuf, LXBool mustCopy, LXError *outError)
+{
+    const LXPixelFormat pxFormat = LXPixelBufferGetPixelFormat(pixbuf);
+    size_t rowBytes = 0;
+
+    src->w = LXPixelBufferGetWidth(pixbuf);
+    src->h = LXPixelBufferGetHeight(pixbuf);
+    if (src->w < 1 || src->h < 1) {
+        LXErrorSet(outError, kLXErrorID_Shader_EmptyArg, "source pixel buffer is empty");
+        return NO;
+    }
+
+    if (pxFormat == kLX_RGBA_FLOAT32 && !mustCopy) {
+        uint8_t *data = LXPixelBufferLockPixels(pixbuf, &rowBytes, NULL, outError);
+        if ( !data) return NO;
+        src->lockedPixbuf = pixbuf;
+        src->data = (const float *)data;
+        src->rowFloats = rowBytes / sizeof(float);
+        return YES;
+    }
+
+    src->convertedBuf = _lx_malloc((size_t)src->w * src->h * 4 * sizeof(float));
+    src->data = src->convertedBuf;
+    src->rowFloats = src->w * 4;
+
+    return LXPixelBufferGetDataWithPixelFormatConversion(pixbuf, (uint8_t *)src->convertedBuf, src->w, src->h, src->rowFloats * sizeof(float),
+                                                         kLX_RGBA_FLOAT32, NULL, outError);
+}
+
+// pixel buffers in the texture array are sampled directly.
+// on the software renderer, every texture is backed by a pixel buffer which is its native object
+static LXPixelBufferRef sourcePixelBufferAt(LXTextureArrayRef texArray, LXInteger index, LXUInteger *outSampling)
+{
+    LXPixelBufferRef pixbuf = LXTextureArrayPixelBufferAt(texArray, index);
+    LXUInteger sampling = LXTextureArrayGetSamplingAt(texArray, index);
+
+#if defined(LXPLATFORM_LINUX)
+    LXTextureRef texture = (pixbuf) ? NULL : LXTextureArrayAt(texArray, index);
+    if (texture) {
+        pixbuf = (LXPixelBufferRef) LXTextureLockPlatformNativeObj(texture);
+        LXTextureUnlockPlatformNativeObj(texture);
+
+        if (sampling == kLXNotFound)
+            sampling = LXTextureGetSampling(texture);
+    }
+#endif
+    *outSampling = (sampling == kLXNotFound) ? kLXNearestSampling : sampling;
+    return pixbuf;
+}
+
+static ShaderCPUProgram *cpuProgramForShader(LXShaderImpl *imp, LXBool *outIsTemporary, LXError *outError)
+{
+    *outIsTemporary = NO;
+
+    if (imp->programType != kLXShaderFormat_OpenGLARBfp) {
+        LXErrorSet(outError, kLXErrorID_Shader_InvalidProgramFormat, "only ARBfp programs can be evaluated on the CPU");
+        return NULL;
+    }
+    if (imp->cpuProgObj)
+        return (ShaderCPUProgram *)imp->cpuProgObj;
+
+    ShaderCPUProgram *prog = _LXShaderCPUProgramCreate(imp->programStr, imp->programStrLen, outError);
+    if ( !prog)
+        return NULL;
+
+    if (imp->storageHint == kLXStorageHint_Final) {
+        // copies of static shaders don't own their data, so a program that wasn't compiled along with the original isn't cached
+        *outIsTemporary = YES;
+        return prog;
+    }
+
+    LXMutexLock(g_lxAtomicLock);
+    if ( !imp->cpuProgObj) {
+        imp->cpuProgObj = prog;
+    } else {
+        destroyCPUProgram(prog);
+    }
+    LXMutexUnlock(g_lxAtomicLock);
+
+    return (ShaderCPUProgram *)imp->cpuProgObj;
+}
+
+static void destroyRenderJob(ShaderCPURenderJob *job)
+{
+    LXInteger i;
+    if ( !job) return;
+
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        if (job->sources[i].lockedPixbuf)
+            LXPixelBufferUnlockPixels(job->sources[i].lockedPixbuf);
+        _lx_free(job->sources[i].convertedBuf);
+    }
+    for (i = 0; i < kLXParallelMaxWorkers; i++) {
+        _lx_free(job->workers[i].fileBuf);
+        _lx_free(job->workers[i].tileBuf);
+    }
+    if (job->progIsTemporary)
+        destroyCPUProgram((ShaderCPUProgram *)job->prog);
+
+    _lx_free(job);
+}
+
+// compiles the program and prepares its texture sources.
+// dstPixbuf is the image being written, if any; a source that is the same buffer gets copied
+static ShaderCPURenderJob *createRenderJob(LXShaderImpl *imp, const float *params, LXTextureArrayRef texArray, LXPixelBufferRef dstPixbuf,
+                                           LXError *outError)
+{
+    LXBool progIsTemporary = NO;
+    LXInteger i;
+
+    ShaderCPUProgram *prog = cpuProgramForShader(imp, &progIsTemporary, outError);
+    if ( !prog)
+        return NULL;
+
+    ShaderCPURenderJob *job = _lx_calloc(1, sizeof(ShaderCPURenderJob));
+    job->prog = prog;
+    job->progIsTemporary = progIsTemporary;
+    job->params = (params) ? params : imp->shaderParams;
+    job->dstPxFormat = kLX_RGBA_FLOAT32;
+
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        if ( !(prog->usedTexUnits & (1 << i))) continue;
+
+        ShaderCPUSource *src = job->sources + i;
+        LXPixelBufferRef pixbuf = sourcePixelBufferAt(texArray, i, &src->sampling);
+
+        if ( !pixbuf) {
+            char msg[256];
+            sprintf(msg, "texture unit %i is sampled but the texture array has no pixel buffer for it", (int)i);
+            LXErrorSet(outError, kLXErrorID_Shader_MissingTexture, msg);
+            destroyRenderJob(job);
+            return NULL;
+        }
+        src->wrapMode = LXTextureArrayGetWrapModeAt(texArray, i);
+
+        // the destination is written while sources are read, so it can't be sampled in place
+        if ( !prepareSource(src, pixbuf, (pixbuf == dstPixbuf), outError)) {
+            destroyRenderJob(job);
+            return NULL;
+        }
+    }
+    return job;
+}
+
+
+#pragma mark --- fragment evaluation for the software renderer ---
+
+void *_LXShaderCPUEvaluatorCreate(LXShaderRef shader, const float *params, LXTextureArrayRef texArray, LXPixelBufferRef dstPixbuf,
+                                  LXError *outError)
+{
+    if ( !shader) {
+        LXErrorSet(outError, kLXErrorID_Shader_EmptyArg, "no shader given");
+        return NULL;
+    }
+    return createRenderJob((LXShaderImpl *)shader, params, texArray, dstPixbuf, outError);
+}
+
+void _LXShaderCPUEvaluatorDestroy(void *evaluator)
+{
+    destroyRenderJob((ShaderCPURenderJob *)evaluator);
+}
+
+uint32_t _LXShaderCPUEvaluatorGetUsedTexCoords(void *evaluator)
+{
+    return (evaluator) ? ((ShaderCPURenderJob *)evaluator)->prog->usedTexCoords : 0;
+}
+
+LXSuccess _LXShaderCPUEvaluatorRun(void *evaluator, LXInteger workerIndex, LXShaderCPUFragmentBatch *batch)
+{
+    ShaderCPURenderJob *job = (ShaderCPURenderJob *)evaluator;
+    ShaderCPUWorker *worker = job->workers + workerIndex;
+    const ShaderCPUProgram *prog = job->prog;
+    int i, c;
+
+    if ( !worker->fileBuf && !prepareWorker(job, worker))
+        return NO;
+
+    float * LXRESTRICT file = worker->file;
+
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        if ( !(prog->usedTexCoords & (1 << i))) continue;
+        memcpy(ROW((kShaderCPUReg_TexCoord0 + i) * 4), batch->texCoord[i][0], SHCPU_WIDTH * sizeof(float));
+        memcpy(ROW((kShaderCPUReg_TexCoord0 + i) * 4 + 1), batch->texCoord[i][1], SHCPU_WIDTH * sizeof(float));
+    }
+    if (prog->usesPosition) {
+        for (c = 0; c < 3; c++)
+            memcpy(ROW(kShaderCPUReg_Position * 4 + c), batch->position[c], SHCPU_WIDTH * sizeof(float));
+    }
+    if (prog->hasKill) {
+        memset(worker->kill, 0, SHCPU_WIDTH);
+    }
+
+    runOps(job, worker);
+
+    for (c = 0; c < 4; c++)
+        memcpy(batch->color[c], ROW(c), SHCPU_WIDTH * sizeof(float));
+
+    if (prog->hasKill)
+        memcpy(batch->killed, worker->kill, SHCPU_WIDTH);
+    else
+        memset(batch->killed, 0, SHCPU_WIDTH);
+
+    return YES;
+}
+
+
+#pragma mark --- public API ---
+
+LXBool LXShaderHasCPUKernel(LXShaderRef r)
+{
+    if ( !r) return NO;
+    LXBool progIsTemporary = NO;
+
+    ShaderCPUProgram *prog = cpuProgramForShader((LXShaderImpl *)r, &progIsTemporary, NULL);
+    if ( !prog)
+        return NO;
+
+    LXBool hasKernel = (prog->nativeKernel != NULL);
+    if (progIsTemporary)
+        destroyCPUProgram(prog);
+    return hasKernel;
+}
+
+LXSuccess LXShaderEvaluateIntoPixelBuffer(LXShaderRef r, LXTextureArrayRef texArray, LXPixelBufferRef dstPixbuf, LXError *outError)
+{
+    if ( !r || !dstPixbuf) {
+        LXErrorSet(outError, kLXErrorID_Shader_EmptyArg, "no shader or destination given");
+        return NO;
+    }
+    const LXPixelFormat dstPxFormat = LXPixelBufferGetPixelFormat(dstPixbuf);
+    const int32_t dstW = LXPixelBufferGetWidth(dstPixbuf);
+    const int32_t dstH = LXPixelBufferGetHeight(dstPixbuf);
+    LXSuccess success;
+    LXInteger i;
+
+    if (dstW < 1 || dstH < 1) {
+        LXErrorSet(outError, kLXErrorID_Shader_EmptyArg, "destination pixel buffer is empty");
+        return NO;
+    }
+    if (LXPlaneCountForPixelFormat(dstPxFormat) > 1) {
+        LXErrorSet(outError, kLXErrorID_Shader_UnsupportedPixelFormat, "planar pixel formats are not supported as shader destination");
+        return NO;
+    }
+
+    ShaderCPURenderJob *job = createRenderJob((LXShaderImpl *)r, NULL, texArray, dstPixbuf, outError);
+    if ( !job)
+        return NO;
+
+    job->dstW = dstW;
+    job->dstH = dstH;
+    job->dstPxFormat = dstPxFormat;
+    job->dstBytesPerPixel = LXBytesPerPixelForPixelFormat(dstPxFormat);
+
+    // texcoords span the source in pixels; units without a source get destination pixel coordinates
+    for (i = 0; i < SHCPU_MAXTEXUNITS; i++) {
+        LXUInteger sampling;
+        LXPixelBufferRef pixbuf = sourcePixelBufferAt(texArray, i, &sampling);
+        job->texCoordScale[i][0] = (pixbuf) ? (float)LXPixelBufferGetWidth(pixbuf) / dstW : 1.0f;
+        job->texCoordScale[i][1] = (pixbuf) ? (float)LXPixelBufferGetHeight(pixbuf) / dstH : 1.0f;
+    }
+
+    job->dstData = LXPixelBufferLockPixels(dstPixbuf, &job->dstRowBytes, NULL, outError);
+    if ( !job->dstData) {
+        destroyRenderJob(job);
+        return NO;
+    }
+
+    job->tilesPerRow = (dstW + SHCPU_TILE_W - 1) / SHCPU_TILE_W;
+    const LXInteger tileCount = job->tilesPerRow * ((dstH + SHCPU_TILE_H - 1) / SHCPU_TILE_H);
+
+    LXParallelApply(tileCount, 0, renderTile, job);
+
+    LXPixelBufferUnlockPixels(dstPixbuf);
+
+    success = (job->failed) ? NO : YES;
+    if ( !success) {
+        LXErrorSet(outError, kLXErrorID_Shader_UnsupportedPixelFormat, "shader output couldn't be written in the destination pixel format");
+    }
+
+    destroyRenderJob(job);
+    return success;
+}
+
+
+#if defined(LXPLATFORM_LINUX)
+
+#pragma mark --- software renderer shader object ---
+
+/*
+  On the software renderer, a shader's native object is its compiled CPU program.
+*/
+
+LXShaderRef LXShaderRetain(LXShaderRef r)
+{
+    if ( !r) return NULL;
+    LXShaderImpl *imp = (LXShaderImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+    return r;
+}
+
+void LXShaderRelease(LXShaderRef r)
+{
+    if ( !r) return;
+    LXShaderImpl *imp = (LXShaderImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+
+        _LXShaderCommonDataFree(imp);
+
+        _lx_free(imp);
+    }
+}
+
+LXShaderRef LXShaderCopy(LXShaderRef orig)
+{
+    LXShaderRef newShader = _LXShaderCommonCopy(orig);
+
+    if (newShader && newShader != orig) {
+        LXShaderImpl *imp = (LXShaderImpl *)newShader;
+
+        // copies of static shaders share the original's program, which was compiled when the original was created
+        if (imp->storageHint & kLXStorageHint_Final) {
+            imp->sharedStorageFlags |= kLXShader_NativeObjectWasCopied;
+        }
+    }
+    return newShader;
+}
+
+LXShaderRef LXShaderCreateWithString(const char *asciiStr,
+                                                      size_t strLen,
+                                                      LXUInteger programFormat,
+                                                      LXUInteger storageHint,
+                                                      LXError *outError)
+{
+    return _LXShaderCommonCreateWithString(asciiStr, strLen, programFormat, storageHint, outError);
+}
+
+LXUnidentifiedNativeObj LXShaderLockPlatformNativeObj(LXShaderRef r)
+{
+    if ( !r) return (LXUnidentifiedNativeObj)NULL;
+    LXShaderImpl *imp = (LXShaderImpl *)r;
+
+    if ( !imp->cpuProgObj && imp->programStr && imp->programStrLen > 0
+            && imp->programType == kLXShaderFormat_OpenGLARBfp
+            && !(imp->sharedStorageFlags & kLXShader_NativeObjectWasCopied)) {
+        LXError error;
+        memset(&error, 0, sizeof(LXError));
+
+        ShaderCPUProgram *prog = _LXShaderCPUProgramCreate(imp->programStr, imp->programStrLen, &error);
+
+        if ( !prog && imp->programErrorWarningState == 0) {
+            LXPrintf("** %s: error while compiling program for shader %p (%s)\n", __func__, r, error.description);
+            LXPrintf("  ... erroneous program is: %s\n", imp->programStr);
+            imp->programErrorWarningState = 1;
+        }
+        LXErrorDestroyOnStack(error);
+
+        LXMutexLock(g_lxAtomicLock);
+        if ( !imp->cpuProgObj) {
+            imp->cpuProgObj = prog;
+        } else {
+            destroyCPUProgram(prog);
+        }
+        LXMutexUnlock(g_lxAtomicLock);
+    }
+
+    return (LXUnidentifiedNativeObj)imp->cpuProgObj;
+}
+
+void LXShaderUnlockPlatformNativeObj(LXShaderRef r)
+{
+}
+
+#endif  // LXPLATFORM_LINUX
@@ -0,0 +1,411 @@
+/*
+ *  LXSurface_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXSurface.h"
+#include "LXTexture.h"
+#include "LXTextureArray.h"
+#include "LXShader.h"
+#include "LXDrawContext.h"
+#include "LXPixelBuffer.h"
+#include "LXPixelBuffer_priv.h"
+
+#include "LXRef_Impl.h"
+#include "LXDraw_Impl.h"
+
+#include <math.h>
+
+/*
+  Software renderer surfaces: the surface is a pixel buffer in main memory that LXDraw_cpu.c rasterizes into.
+  The native object is the LXPixelBufferRef.
+*/
+
+#if defined(LXPLATFORM_LINUX)
+
+
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    LXPoolRef sourcePool;
+
+    int w;
+    int h;
+    LXPixelFormat pixelFormat;
+    LXBool hasZBuffer;
+
+    LXPixelBufferRef pixbuf;
+
+    LXTextureRef lxTexture;
+
+    // render properties
+    LXRect imageRegion;
+} LXSurfaceCPUImpl;
+
+
+// platform-independent parts of the class
+#define LXSURFACEIMPL LXSurfaceCPUImpl
+#include "LXSurface_baseinc.c"
+
+
+extern LXTextureRef LXTextureCreateWithSurface_(LXSurfaceRef surf);
+
+
+
+LXSurfaceRef LXSurfaceRetain(LXSurfaceRef r)
+{
+    if ( !r) return NULL;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+
+    return r;
+}
+
+void LXSurfaceRelease(LXSurfaceRef r)
+{
+    if ( !r) return;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+
+        if (imp->lxTexture) {
+            LXTextureRelease(imp->lxTexture);
+            imp->lxTexture = NULL;
+        }
+
+        LXPixelBufferRelease(imp->pixbuf);
+        imp->pixbuf = NULL;
+
+        _lx_free(imp);
+    }
+}
+
+LXSurfaceRef LXSurfaceCreate(LXPoolRef pool,
+                             uint32_t w, uint32_t h, LXPixelFormat pxFormat,
+                             uint32_t flags,
+                             LXError *outError)
+{
+    LXBool hasZBuffer = (flags & kLXSurfaceHasZBuffer) ? YES : NO;
+
+    if (w < 1 || h < 1) {
+        LXErrorSet(outError, 4001, "width or height is zero");
+        return NULL;
+    }
+
+    switch (pxFormat) {
+        case kLX_RGBA_INT8:
+        case kLX_RGBA_FLOAT16:
+        case kLX_RGBA_FLOAT32:
+            break;
+
+        default: {
+            char str[256];
+            sprintf(str, "unsupported pixel format (%i)", (int)pxFormat);
+            LXErrorSet(outError, 4002, str);
+            return NULL;
+        }
+    }
+
+    LXPixelBufferRef pixbuf = LXPixelBufferCreate(pool, w, h, pxFormat, outError);
+    if ( !pixbuf)
+        return NULL;
+
+    LXSurfaceCPUImpl *imp = _lx_calloc(sizeof(LXSurfaceCPUImpl), 1);
+    LXREF_INIT(imp, LXSurfaceTypeID(), LXSurfaceRetain, LXSurfaceRelease);
+
+    imp->sourcePool = pool;
+    imp->w = w;
+    imp->h = h;
+    imp->pixelFormat = pxFormat;
+    imp->hasZBuffer = hasZBuffer;
+    imp->pixbuf = pixbuf;
+
+    LXSurfaceClear((LXSurfaceRef)imp);
+
+    return (LXSurfaceRef)imp;
+}
+
+
+LXTextureRef LXSurfaceGetTexture(LXSurfaceRef r)
+{
+    if ( !r) return NULL;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    if (NULL == imp->lxTexture) {
+        imp->lxTexture = LXTextureCreateWithSurface_(r);
+
+        LXTextureSetImagePlaneRegion(imp->lxTexture, LXSurfaceGetImagePlaneRegion(r));
+    }
+
+    return imp->lxTexture;
+}
+
+LXPixelFormat LXSurfaceGetPixelFormat(LXSurfaceRef r)
+{
+    if ( !r) return 0;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+    return imp->pixelFormat;
+}
+
+
+
+#pragma mark --- native object ---
+
+LXBool LXSurfaceNativeYAxisIsFlipped(LXSurfaceRef r)
+{
+    // row 0 of the pixel buffer is at window y = 0, same as OpenGL readback
+    return NO;
+}
+
+LXBool LXSurfaceHasDefaultPixelOrthoProjection(LXSurfaceRef r)
+{
+    return YES;
+}
+
+LXUnidentifiedNativeObj LXSurfaceLockPlatformNativeObj(LXSurfaceRef r)
+{
+    if ( !r) return (LXUnidentifiedNativeObj)NULL;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    return (LXUnidentifiedNativeObj)(imp->pixbuf);
+}
+
+void LXSurfaceUnlockPlatformNativeObj(LXSurfaceRef r)
+{
+}
+
+LXUnidentifiedNativeObj LXSurfaceBeginPlatformNativeDrawing(LXSurfaceRef r)
+{
+    return LXSurfaceLockPlatformNativeObj(r);
+}
+
+void LXSurfaceEndPlatformNativeDrawing(LXSurfaceRef r)
+{
+}
+
+void LXSurfaceFlush(LXSurfaceRef r)
+{
+    // drawing is synchronous, so there's nothing pending
+}
+
+
+
+#pragma mark --- drawing ---
+
+void LXSurfaceClear(LXSurfaceRef r)
+{
+    if ( !r) return;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    size_t rowBytes = 0;
+    uint8_t *data = LXPixelBufferLockPixels(imp->pixbuf, &rowBytes, NULL, NULL);
+    if ( !data) return;
+
+    memset(data, 0, rowBytes * imp->h);
+
+    LXPixelBufferUnlockPixels(imp->pixbuf);
+}
+
+void LXSurfaceClearRegionWithRGBA(LXSurfaceRef r, LXRect rect, LXRGBA c)
+{
+    if ( !r) return;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    const int32_t x0 = MAX(0, (int32_t)floor(rect.x));
+    const int32_t y0 = MAX(0, (int32_t)floor(rect.y));
+    const int32_t x1 = MIN(imp->w, (int32_t)ceil(rect.x + rect.w));
+    const int32_t y1 = MIN(imp->h, (int32_t)ceil(rect.y + rect.h));
+    if (x0 >= x1 || y0 >= y1) return;
+
+    // convert the color once, then replicate it
+    const size_t bpp = LXBytesPerPixelForPixelFormat(imp->pixelFormat);
+    float srcPx[4] = { c.r, c.g, c.b, c.a };
+    uint8_t px[16];
+    if ( !LXPxConvert_Any_((uint8_t *)srcPx, 1, 1, sizeof(srcPx), kLX_RGBA_FLOAT32,
+                           px, 1, 1, bpp, imp->pixelFormat,
+                           0, 0, 0, 0, NULL))
+        return;
+
+    size_t rowBytes = 0;
+    uint8_t *data = LXPixelBufferLockPixels(imp->pixbuf, &rowBytes, NULL, NULL);
+    if ( !data) return;
+
+    int32_t x, y;
+    for (y = y0; y < y1; y++) {
+        uint8_t *d = data + y * rowBytes + x0 * bpp;
+        for (x = x0; x < x1; x++) {
+            memcpy(d, px, bpp);
+            d += bpp;
+        }
+    }
+
+    LXPixelBufferUnlockPixels(imp->pixbuf);
+}
+
+void LXSurfaceDrawPrimitive(LXSurfaceRef r,
+                            LXPrimitiveType primitiveType,
+                            void *vertices,
+                            LXUInteger vertexCount,
+                            LXVertexType vertexType,
+                            LXDrawContextRef drawCtx)
+{
+    if ( !r || !vertices || vertexCount < 1) return;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    LXDrawContextRef tempCtx = (drawCtx) ? NULL : LXDrawContextCreate();
+    if (tempCtx) drawCtx = tempCtx;
+
+    LXDrawContextActiveState *drawState = NULL;
+
+    LXDrawContextBeginForSurface_(drawCtx, r, &drawState);
+
+    LXDECLERROR(err)
+
+    if ( !LXDrawCPURenderPrimitive_(imp->pixbuf, primitiveType, vertices, vertexCount, vertexType, drawCtx, drawState, &err)) {
+        if (err.errorID != 0) {
+            LXPrintf("*** %s: drawing failed (%i): %s\n", __func__, (int)err.errorID, err.description);
+        }
+        LXErrorDestroyOnStack(err);
+    }
+
+    LXDrawContextFinish_(drawCtx, &drawState);
+
+    if (tempCtx) LXDrawContextRelease(tempCtx);
+}
+
+
+
+#pragma mark --- readback ---
+
+LXSuccess LXSurfaceCopyContentsIntoPixelBuffer(LXSurfaceRef r, LXPixelBufferRef pixBuf,
+                                                        LXError *outError)
+{
+    if ( !r) return NO;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    if ( !pixBuf) {
+        LXErrorSet(outError, 4830, "no pixelbuffer to copy into");
+        return NO;
+    }
+    return LXPixelBufferCopyPixelBufferWithPixelFormatConversion(pixBuf, imp->pixbuf, outError);
+}
+
+LXSuccess LXSurfaceCopyRegionIntoPixelBuffer(LXSurfaceRef r, LXRect region, LXPixelBufferRef pixbuf,
+                                                        LXError *outError)
+{
+    if ( !r || !pixbuf) return NO;
+    LXSurfaceCPUImpl *imp = (LXSurfaceCPUImpl *)r;
+
+    LXInteger dstPxf = LXPixelBufferGetPixelFormat(pixbuf);
+    size_t dstRowBytes = 0;
+    LXBool ok = NO;
+    uint8_t *dstBuf = LXPixelBufferLockPixels(pixbuf, &dstRowBytes, NULL, outError);
+    if (dstBuf) {
+        ok = LXPixelBufferGetRegionWithPixelFormatConversion(imp->pixbuf, region, dstBuf, dstRowBytes, dstPxf, NULL, outError);
+        LXPixelBufferUnlockPixels(pixbuf);
+    }
+    return ok;
+}
+
+
+
+#pragma mark --- async readback ---
+
+/*
+  There's no GPU to overlap with, so the "async" readback is performed immediately and always has data.
+*/
+
+typedef struct {
+    int w;
+    int h;
+    LXPixelFormat pixelFormat;
+
+    size_t rowBytes;
+    uint8_t *readbackBuffer;
+} LXSurfaceCPUAsyncReadBuffer;
+
+
+LXSurfaceAsyncReadBufferPtr LXSurfaceAsyncReadBufferCreateForSurface(LXSurfaceRef r)
+{
+    if ( !r) return NULL;
+    LXSurfaceCPUImpl *surf = (LXSurfaceCPUImpl *)r;
+
+    LXSurfaceCPUAsyncReadBuffer *asyncBuf = _lx_calloc(sizeof(LXSurfaceCPUAsyncReadBuffer), 1);
+
+    asyncBuf->w = surf->w;
+    asyncBuf->h = surf->h;
+    asyncBuf->pixelFormat = surf->pixelFormat;
+    asyncBuf->rowBytes = LXAlignedRowBytes(surf->w * LXBytesPerPixelForPixelFormat(surf->pixelFormat));
+    asyncBuf->readbackBuffer = _lx_calloc(asyncBuf->rowBytes * surf->h, 1);
+
+    return asyncBuf;
+}
+
+void LXSurfaceAsyncReadBufferDestroy(LXSurfaceAsyncReadBufferPtr aobj)
+{
+    if ( !aobj) return;
+    LXSurfaceCPUAsyncReadBuffer *asyncBuf = (LXSurfaceCPUAsyncReadBuffer *)aobj;
+
+    _lx_free(asyncBuf->readbackBuffer);
+    _lx_free(asyncBuf);
+}
+
+LXPixelFormat LXSurfaceAsyncReadBufferGetPixelFormat(LXSurfaceAsyncReadBufferPtr aobj)
+{
+    if ( !aobj) return 0;
+    LXSurfaceCPUAsyncReadBuffer *asyncBuf = (LXSurfaceCPUAsyncReadBuffer *)aobj;
+    return asyncBuf->pixelFormat;
+}
+
+LXSuccess LXSurfacePerformAsyncReadbackIntoPixelBuffer(LXSurfaceRef r, LXSurfaceAsyncReadBufferPtr aobj, LXBool *outHasData,
+                                                                LXPixelBufferRef pixBuf,
+                                                                LXError *outError)
+{
+    if (outHasData) *outHasData = NO;
+    if ( !r || !aobj) return NO;
+
+    if ( !LXSurfaceCopyContentsIntoPixelBuffer(r, pixBuf, outError))
+        return NO;
+
+    if (outHasData) *outHasData = YES;
+    return YES;
+}
+
+LXSuccess LXSurfacePerformAsyncReadback(LXSurfaceRef r, LXSurfaceAsyncReadBufferPtr aobj, LXBool *outHasData,
+                                                    uint8_t **outReadbackBuffer, size_t *outReadbackRowBytes,
+                                                    LXError *outError)
+{
+    if (outHasData) *outHasData = NO;
+    if ( !r || !aobj) return NO;
+    LXSurfaceCPUImpl *surf = (LXSurfaceCPUImpl *)r;
+    LXSurfaceCPUAsyncReadBuffer *asyncBuf = (LXSurfaceCPUAsyncReadBuffer *)aobj;
+
+    if (asyncBuf->w != surf->w || asyncBuf->h != surf->h) {
+        LXErrorSet(outError, 4832, "mismatched buffer size for readback");
+        return NO;
+    }
+
+    if ( !LXPixelBufferGetRegionWithPixelFormatConversion(surf->pixbuf, LXMakeRect(0, 0, surf->w, surf->h),
+                                                          asyncBuf->readbackBuffer, asyncBuf->rowBytes, asyncBuf->pixelFormat,
+                                                          NULL, outError))
+        return NO;
+
+    if (outReadbackBuffer) *outReadbackBuffer = asyncBuf->readbackBuffer;
+    if (outReadbackRowBytes) *outReadbackRowBytes = asyncBuf->rowBytes;
+    if (outHasData) *outHasData = YES;
+    return YES;
+}
+
+
+#endif  // LXPLATFORM_LINUX
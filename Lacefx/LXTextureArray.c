@@ -15,6 +15,7 @@
 #include "LXTextureArray.h"
 #include "LXRef_Impl.h"
 #include "LXTexture.h"
+#include "LXPixelBuffer.h"
 
 #include "stdarg.h"
 
@@ -27,6 +28,9 @@ typedef struct {
     
     LXUInteger samplings[8];
     LXUInteger wrapModes[8];
+    
+    // for arrays created from pixel buffers; the textures are created on demand
+    LXPixelBufferRef pixelBuffers[8];
 } LXTexArrayImpl;
 
 
@@ -43,6 +47,11 @@ void LXTextureArrayRemoveAll(LXTextureArrayRef r)
             LXTextureRelease(tex);
         }
         imp->textures[i] = NULL;
+        
+        if (imp->pixelBuffers[i]) {
+            LXPixelBufferRelease(imp->pixelBuffers[i]);
+            imp->pixelBuffers[i] = NULL;
+        }
     }
     
     imp->count = 0;
@@ -56,7 +65,7 @@ void LXTextureArrayForEach(LXTextureArrayRef r, LXRefEnumerationFuncPtr enumFunc
 
     LXInteger i;
     for (i = 0; i < 8; i++) {
-        LXTextureRef tex = imp->textures[i];
+        LXTextureRef tex = (imp->pixelBuffers[i]) ? LXTextureArrayAt(r, i) : imp->textures[i];
         if (tex)
             enumFunc(tex, i, userData);
     }    
@@ -181,6 +190,28 @@ LXTextureArrayRef LXTextureArrayCreateWithTexturesAndCount(LXTextureRef *texture
 }
 
 
+LXTextureArrayRef LXTextureArrayCreateWithPixelBuffers(LXPixelBufferRef *pixbufs, LXInteger count)
+{
+    LXTextureArrayRef texArray = LXTextureArrayCreate();
+    LXTexArrayImpl *imp = (LXTexArrayImpl *)texArray;
+    
+    if (imp && pixbufs) {
+        if (count > 8) count = 8;
+        LXInteger i;
+        LXInteger n = 0;
+        for (i = 0; i < count; i++) {
+            imp->pixelBuffers[i] = LXPixelBufferRetain(pixbufs[i]);
+            if (imp->pixelBuffers[i] != NULL) {
+                n = i + 1;
+            }
+        }
+        imp->count = n;
+    }
+    
+    return texArray;
+}
+
+
 LXInteger LXTextureArraySlotCount(LXTextureArrayRef texArray)
 {
     return 8;
@@ -205,9 +236,26 @@ LXTextureRef LXTextureArrayAt(LXTextureArrayRef texArray, LXInteger index)
         return NULL;
     }
     
+    if ( !imp->textures[index] && imp->pixelBuffers[index]) {
+        imp->textures[index] = LXTextureRetain(LXPixelBufferGetTexture(imp->pixelBuffers[index], NULL));
+    }
+    
     return imp->textures[index];
 }
 
+LXPixelBufferRef LXTextureArrayPixelBufferAt(LXTextureArrayRef texArray, LXInteger index)
+{
+    if ( !texArray) return NULL;
+    LXTexArrayImpl *imp = (LXTexArrayImpl *)texArray;
+    
+    if (index > 7 || index < 0) {
+        LXPrintf("** %s: index out of bounds (%i)\n", __func__, (int)index);
+        return NULL;
+    }
+    
+    return imp->pixelBuffers[index];
+}
+
 LXUInteger LXTextureArrayGetSamplingAt(LXTextureArrayRef texArray, LXInteger index)
 {
     if ( !texArray) return kLXNotFound;
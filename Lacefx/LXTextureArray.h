@@ -32,6 +32,10 @@ LXEXPORT LXTextureArrayRef LXTextureArrayCreateWithTexture(LXTextureRef texture)
 LXEXPORT LXTextureArrayRef LXTextureArrayCreateWithTextures(LXInteger optionalCount, ...);
 LXEXPORT LXTextureArrayRef LXTextureArrayCreateWithTexturesAndCount(LXTextureRef *textures, LXInteger count);
 
+// an array of pixel buffers can be sampled by the CPU shader engine (LXShaderEvaluateIntoPixelBuffer).
+// LXTextureArrayAt() creates textures for the pixel buffers on demand, so the array can also be used for drawing.
+LXEXPORT LXTextureArrayRef LXTextureArrayCreateWithPixelBuffers(LXPixelBufferRef *pixbufs, LXInteger count);
+
 LXEXPORT LXTextureArrayRef LXTextureArrayRetain(LXTextureArrayRef r);
 LXEXPORT void LXTextureArrayRelease(LXTextureArrayRef texArray);
 
@@ -39,6 +43,9 @@ LXEXPORT LXInteger LXTextureArraySlotCount(LXTextureArrayRef texArray);
 LXEXPORT LXInteger LXTextureArrayInUseCount(LXTextureArrayRef texArray);
 LXEXPORT LXTextureRef LXTextureArrayAt(LXTextureArrayRef texArray, LXInteger index);
 
+// returns NULL if the array wasn't created with pixel buffers
+LXEXPORT LXPixelBufferRef LXTextureArrayPixelBufferAt(LXTextureArrayRef texArray, LXInteger index);
+
 LXEXPORT void LXTextureArrayForEach(LXTextureArrayRef, LXRefEnumerationFuncPtr enumFunc, void *userData);
 
 // returns kLXNotFound if a sampling override is not specified for the texture
@@ -0,0 +1,215 @@
+/*
+ *  LXTexture_cpu.c
+ *  Lacefx
+ *
+ *  Copyright 2026 Lacquer oy/ltd.
+ *
+
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+ */
+
+#include "LXTexture.h"
+#include "LXSurface.h"
+#include "LXPixelBuffer.h"
+#include "LXRef_Impl.h"
+
+/*
+  Software renderer textures: the texture's contents live in a pixel buffer,
+  which is also the native object returned by LXTextureLockPlatformNativeObj().
+*/
+
+#if defined(LXPLATFORM_LINUX)
+
+
+typedef struct {
+    LXREF_STRUCT_HEADER
+
+    uint32_t w;
+    uint32_t h;
+    LXPixelFormat pf;
+
+    LXPixelBufferRef pixbuf;    // retained; for client storage textures, this wraps the client's buffer
+    LXSurfaceRef surf;          // weak reference -- owned by the LXSurface that created us
+
+    // original spec for textures created from data
+    void *buffer;
+    size_t rowBytes;
+    LXUInteger storageHint;
+
+    // render properties
+    LXUInteger sampling;
+    LXRect imageRegion;
+} LXTextureCPUImpl;
+
+
+// platform-independent parts of the class
+#define LXTEXTUREIMPL LXTextureCPUImpl
+#include "LXTexture_baseinc.c"
+
+
+
+LXTextureRef LXTextureRetain(LXTextureRef r)
+{
+    if ( !r) return NULL;
+    LXTextureCPUImpl *imp = (LXTextureCPUImpl *)r;
+
+    LXAtomicInc_int32(&(imp->retCount));
+
+    return r;
+}
+
+void LXTextureRelease(LXTextureRef r)
+{
+    if ( !r) return;
+    LXTextureCPUImpl *imp = (LXTextureCPUImpl *)r;
+
+    int32_t refCount = LXAtomicDec_int32(&(imp->retCount));
+    if (refCount == 0) {
+        LXRefWillDestroyItself((LXRef)r);
+
+        LXPixelBufferRelease(imp->pixbuf);
+        imp->pixbuf = NULL;
+
+        _lx_free(imp);
+    }
+}
+
+
+// surfaces own their pixel buffer; the texture shares it
+LXTextureRef LXTextureCreateWithSurface_(LXSurfaceRef surf)
+{
+    LXPixelBufferRef pixbuf = (surf) ? (LXPixelBufferRef)LXSurfaceLockPlatformNativeObj(surf) : NULL;
+    LXSurfaceUnlockPlatformNativeObj(surf);
+    if ( !pixbuf)
+        return NULL;
+
+    LXTextureCPUImpl *imp = _lx_calloc(sizeof(LXTextureCPUImpl), 1);
+
+    LXREF_INIT(imp, LXTextureTypeID(), LXTextureRetain, LXTextureRelease);
+
+    imp->w = LXPixelBufferGetWidth(pixbuf);
+    imp->h = LXPixelBufferGetHeight(pixbuf);
+    imp->pf = LXPixelBufferGetPixelFormat(pixbuf);
+    imp->sampling = kLXNearestSampling;
+    imp->surf = surf;
+    imp->pixbuf = LXPixelBufferRetain(pixbuf);
+
+    return (LXTextureRef)imp;
+}
+
+
+static LXSuccess setTextureData(LXTextureCPUImpl *imp, uint8_t *buffer, size_t rowBytes, LXUInteger storageHint, LXError *outError)
+{
+    if (storageHint & kLXStorageHint_ClientStorage) {
+        // the client keeps the buffer alive and calls LXTextureRefreshWithData() when it changes,
+        // so it can be sampled in place
+        if (imp->pixbuf && imp->buffer == buffer && imp->rowBytes == rowBytes && (imp->storageHint & kLXStorageHint_ClientStorage))
+            return YES;
+
+        LXPixelBufferRef pixbuf = LXPixelBufferCreateForData(imp->w, imp->h, imp->pf, rowBytes, buffer, kLXStorageHint_ClientStorage, outError);
+        if ( !pixbuf)
+            return NO;
+
+        LXPixelBufferRelease(imp->pixbuf);
+        imp->pixbuf = pixbuf;
+    }
+    else {
+        if ( !imp->pixbuf || (imp->storageHint & kLXStorageHint_ClientStorage)) {
+            LXPixelBufferRef pixbuf = LXPixelBufferCreate(NULL, imp->w, imp->h, imp->pf, outError);
+            if ( !pixbuf)
+                return NO;
+
+            LXPixelBufferRelease(imp->pixbuf);
+            imp->pixbuf = pixbuf;
+        }
+        if ( !LXPixelBufferWriteDataWithPixelFormatConversion(imp->pixbuf, buffer, imp->w, imp->h, rowBytes, imp->pf, NULL, outError))
+            return NO;
+    }
+
+    imp->buffer = buffer;
+    imp->rowBytes = rowBytes;
+    imp->storageHint = storageHint;
+    return YES;
+}
+
+
+LXTextureRef LXTextureCreateWithData(uint32_t w, uint32_t h, LXPixelFormat pxFormat, uint8_t *buffer, size_t rowBytes,
+                                     LXUInteger storageHint,
+                                     LXError *outError)
+{
+    if (w < 1 || h < 1 || !buffer || rowBytes < 1) {
+        LXErrorSet(outError, 4001, "invalid texture data");
+        return NULL;
+    }
+    if (LXPlaneCountForPixelFormat(pxFormat) > 1 || LXBytesPerPixelForPixelFormat(pxFormat) < 1) {
+        char str[256];
+        sprintf(str, "unsupported pixel format (%i)", (int)pxFormat);
+        LXErrorSet(outError, 4002, str);
+        return NULL;
+    }
+
+    LXTextureCPUImpl *imp = _lx_calloc(sizeof(LXTextureCPUImpl), 1);
+
+    LXREF_INIT(imp, LXTextureTypeID(), LXTextureRetain, LXTextureRelease);
+
+    imp->w = w;
+    imp->h = h;
+    imp->pf = pxFormat;
+    imp->sampling = kLXNearestSampling;
+
+    if ( !setTextureData(imp, buffer, rowBytes, storageHint, outError)) {
+        LXTextureRelease((LXTextureRef)imp);
+        return NULL;
+    }
+    return (LXTextureRef)imp;
+}
+
+
+LXSuccess LXTextureWillModifyData(LXTextureRef r, uint8_t *buffer, size_t rowBytes, LXUInteger storageHint)
+{
+    // drawing is synchronous, so there are no pending reads of the buffer
+    return (r) ? YES : NO;
+}
+
+LXSuccess LXTextureRefreshWithData(LXTextureRef r, uint8_t *buffer, size_t rowBytes, LXUInteger storageHint)
+{
+    if ( !r || !buffer) return NO;
+    LXTextureCPUImpl *imp = (LXTextureCPUImpl *)r;
+
+    if (imp->surf) return NO;
+
+    return setTextureData(imp, buffer, rowBytes, storageHint, NULL);
+}
+
+
+LXSuccess LXTextureCopyContentsIntoPixelBuffer(LXTextureRef r, LXPixelBufferRef pixBuf,
+                                                        LXError *outError)
+{
+    if ( !r) return NO;
+    LXTextureCPUImpl *imp = (LXTextureCPUImpl *)r;
+
+    if ( !pixBuf) {
+        LXErrorSet(outError, 4830, "no pixelbuffer to copy into");
+        return NO;
+    }
+    return LXPixelBufferCopyPixelBufferWithPixelFormatConversion(pixBuf, imp->pixbuf, outError);
+}
+
+
+LXUnidentifiedNativeObj LXTextureLockPlatformNativeObj(LXTextureRef r)
+{
+    if ( !r) return (LXUnidentifiedNativeObj)NULL;
+    LXTextureCPUImpl *imp = (LXTextureCPUImpl *)r;
+
+    return (LXUnidentifiedNativeObj)(imp->pixbuf);
+}
+
+void LXTextureUnlockPlatformNativeObj(LXTextureRef r)
+{
+}
+
+
+#endif  // LXPLATFORM_LINUX
@@ -14,38 +14,19 @@
 
 #include "LXTransform3D.h"
 #include "LXRef_Impl.h"
+#include "LXParallel.h"
 
 #include <assert.h>
 #include <math.h>
 
 
 #if defined(__SSE2__)
-#include <xmmintrin.h>
-#include <pmmintrin.h>  // SSE3 intrinsics
-
-void lx_matmul_sse3_aligned(const float *in_A,
-                            const float *in_x,
-                            const float *out_y,
-                            LXInteger n)
-{
-    __m128 A0 = _mm_load_ps((const float *)(in_A + 0));
-    __m128 A1 = _mm_load_ps((const float *)(in_A + 4));
-    __m128 A2 = _mm_load_ps((const float *)(in_A + 8));
-    __m128 A3 = _mm_load_ps((const float *)(in_A + 12));
-    
-    for (LXInteger i = 0; i < n; i++) {
-        __m128 x =  _mm_load_ps((const float*)(in_x + i*4));
-        __m128 m0 = _mm_mul_ps(A0, x);
-        __m128 m1 = _mm_mul_ps(A1, x);
-        __m128 m2 = _mm_mul_ps(A2, x);
-        __m128 m3 = _mm_mul_ps(A3, x);
-        __m128 sum_01 = _mm_hadd_ps(m0, m1); 
-        __m128 sum_23 = _mm_hadd_ps(m2, m3);
-        __m128 result = _mm_hadd_ps(sum_01, sum_23);
-        _mm_store_ps((float*)(out_y + i*4), result);
-    }
-}
+#include <emmintrin.h>
+#endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LXTRANSFORM_AVX2 1
 #endif
 
 
@@ -57,13 +38,46 @@ static const LX4x4Matrix g_identityMatrix = { 1, 0, 0, 0,
 const LX4x4Matrix * const LXIdentity4x4Matrix = &g_identityMatrix;
 
 
+// a matrix set with LXTransform3DSetMatrix() is only classified once something needs the class
+enum {
+    kMatrixClassUnknown = 0xff
+};
+
 typedef struct {
     LXREF_STRUCT_HEADER
     
     LX4x4Matrix mat;
+    LXUInteger matClass;  // can be kMatrixClassUnknown; see getMatrixClass()
+    
+    // inverse of "mat", computed on demand; cleared by matrixDidChange()
+    LXBool hasCachedInverse;
+    LXBool cachedInverseIsValid;  // NO if the matrix is singular
+    LX4x4Matrix inverse;
 } LXTransform3DImpl;
 
 
+static void matrixDidChange(LXTransform3DImpl *imp, LXUInteger matClass)
+{
+    imp->matClass = matClass;
+    imp->hasCachedInverse = NO;
+}
+
+static LXUInteger getMatrixClass(LXTransform3DImpl *imp)
+{
+    if (imp->matClass == kMatrixClassUnknown)
+        imp->matClass = LX4x4MatrixGetClass(&(imp->mat));
+    return imp->matClass;
+}
+
+// same as getMatrixClass() but doesn't store the result, so it's safe on a transform that other threads are reading
+static LXUInteger peekMatrixClass(const LXTransform3DImpl *imp)
+{
+    return (imp->matClass == kMatrixClassUnknown) ? LX4x4MatrixGetClass(&(imp->mat)) : imp->matClass;
+}
+
+static void concatMatrixWithClass(LXTransform3DImpl *imp, const LX4x4Matrix *A, LXUInteger aClass);
+
+
 
 LXTransform3DRef LXTransform3DRetain(LXTransform3DRef r)
 {
@@ -122,10 +136,10 @@ LXTransform3DRef LXTransform3DCreateWithMatrix(LX4x4Matrix *matrix)
     LXTransform3DRef r = LXTransform3DCreateIdentity();
     LXTransform3DImpl *imp = (LXTransform3DImpl *)r;
     
-    if (matrix)
+    if (matrix) {
         imp->mat = *matrix;
-    else
-        setIdentityMatrix(&(imp->mat));
+        matrixDidChange(imp, kMatrixClassUnknown);
+    }
     
     return r;
 }
@@ -137,8 +151,13 @@ LXTransform3DRef LXTransform3DCopy(LXTransform3DRef orig)
     LXTransform3DImpl *newImp = (LXTransform3DImpl *)newR;
     LXTransform3DImpl *origImp = (LXTransform3DImpl *)orig;
     
-    if (newImp && origImp)
+    if (newImp && origImp) {
         newImp->mat = origImp->mat;
+        newImp->matClass = origImp->matClass;
+        newImp->hasCachedInverse = origImp->hasCachedInverse;
+        newImp->cachedInverseIsValid = origImp->cachedInverseIsValid;
+        newImp->inverse = origImp->inverse;
+    }
     
     return newR;
 }
@@ -160,6 +179,8 @@ LXTransform3DRef LXTransform3DCreateWith2DTransform(LXFloat m11, LXFloat m12, LX
     //imp->mat.m41 = 1.0;
     //imp->mat.m42 = 1.0;
     
+    matrixDidChange(imp, LX4x4MatrixGetClass(&(imp->mat)));
+    
     return r;
 }
 
@@ -196,6 +217,7 @@ void LXTransform3DSetIdentity(LXTransform3DRef r)
     LXTransform3DImpl *imp = (LXTransform3DImpl *)r;
     
     setIdentityMatrix(&(imp->mat));
+    matrixDidChange(imp, kLX4x4MatrixClass_Identity);
 }
 
 void LXTransform3DTranslate(LXTransform3DRef r, LXFloat tx, LXFloat ty, LXFloat tz)
@@ -209,7 +231,7 @@ void LXTransform3DTranslate(LXTransform3DRef r, LXFloat tx, LXFloat ty, LXFloat
     mm.m34 = tz;
     mm.m44 = 1.0;
     
-    LXTransform3DConcatMatrix(r, &mm);
+    concatMatrixWithClass((LXTransform3DImpl *)r, &mm, kLX4x4MatrixClass_Translate);
 }
 
 void LXTransform3DScale(LXTransform3DRef r, LXFloat sx, LXFloat sy, LXFloat sz)
@@ -223,7 +245,7 @@ void LXTransform3DScale(LXTransform3DRef r, LXFloat sx, LXFloat sy, LXFloat sz)
     mm.m33 = sz;
     mm.m44 = 1.0;
     
-    LXTransform3DConcatMatrix(r, &mm);
+    concatMatrixWithClass((LXTransform3DImpl *)r, &mm, kLX4x4MatrixClass_ScaleTranslate);
 }
 
 void LXTransform3DRotate(LXTransform3DRef r, LXFloat angle, LXFloat ax, LXFloat ay, LXFloat az)
@@ -282,6 +304,15 @@ void LXTransform3DSetMatrix(LXTransform3DRef t, LX4x4Matrix *matrix)
     LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
     
     imp->mat = *matrix;
+    matrixDidChange(imp, kMatrixClassUnknown);
+}
+
+LX4x4MatrixClass LXTransform3DGetMatrixClass(LXTransform3DRef t)
+{
+    if ( !t) return kLX4x4MatrixClass_Identity;
+    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
+    
+    return peekMatrixClass(imp);
 }
 
 
@@ -374,6 +405,47 @@ char *LX4x4MatrixCreateString(const LX4x4Matrix *m, LXBool insertLineBreaks)
 }
 
 
+#pragma mark --- matrix class ---
+
+LX4x4MatrixClass LX4x4MatrixGetClass(const LX4x4Matrix *m)
+{
+    if ( !m) return kLX4x4MatrixClass_Identity;
+    const LXFloat *mf = (const LXFloat *)m;
+    const LXFloat *idf = (const LXFloat *)&g_identityMatrix;
+    uint32_t diff = 0;  // bit n is set if element n differs from the identity matrix
+    int i;
+    
+    // this gets called for every LXTransform3DSetMatrix(), so it's done without branches
+#if defined(__SSE2__) && defined(LXFLOAT_IS_DOUBLE)
+    for (i = 0; i < 16; i += 2) {
+        diff |= (uint32_t)_mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(mf + i), _mm_loadu_pd(idf + i))) << i;
+    }
+#else
+    for (i = 0; i < 16; i++) {
+        diff |= (uint32_t)(mf[i] != idf[i]) << i;
+    }
+#endif
+    
+    if (diff & 0xf000)  // bottom row
+        return kLX4x4MatrixClass_Projective;
+    if ((diff & 0x344) || ((diff & 0x12) && (diff & 0xc00)))  // z rotation, or xy rotation with z scale/translation
+        return kLX4x4MatrixClass_Affine3D;
+    if (diff & 0x12)  // m12, m21
+        return kLX4x4MatrixClass_Affine2D;
+    if (diff & 0x421)  // m11, m22, m33
+        return kLX4x4MatrixClass_ScaleTranslate;
+    if (diff & 0x888)  // m14, m24, m34
+        return kLX4x4MatrixClass_Translate;
+    return kLX4x4MatrixClass_Identity;
+}
+
+// YES if the matrix doesn't touch z, i.e. it can be concatenated with a 2D affine as a 2x3 matrix
+LXINLINE LXBool isPlanarMatrix(const LX4x4Matrix *m, LXUInteger matClass)
+{
+    return (matClass <= kLX4x4MatrixClass_Affine2D && m->m33 == 1.0 && m->m34 == 0.0);
+}
+
+
 #pragma mark --- concat ---
 
 void LXTransform3DConcat(LXTransform3DRef a, LXTransform3DRef b)
@@ -385,38 +457,99 @@ void LXTransform3DConcat(LXTransform3DRef a, LXTransform3DRef b)
     }
     LXTransform3DImpl *bimp = (LXTransform3DImpl *)b;
     
-    LXTransform3DConcatMatrix(a, &(bimp->mat));
+    concatMatrixWithClass((LXTransform3DImpl *)a, &(bimp->mat), peekMatrixClass(bimp));
 }
 
-
 void LXTransform3DConcatMatrix(LXTransform3DRef r, LX4x4Matrix * LXRESTRICT A)
 {
     if (!r || !A) return;
-    LXTransform3DImpl *imp = (LXTransform3DImpl *)r;
-    LX4x4Matrix * LXRESTRICT B = &(imp->mat);
-    LX4x4Matrix dm;
-    
-    dm.m11 = A->m11 * B->m11  +  A->m12 * B->m21  +  A->m13 * B->m31  +  A->m14 * B->m41;
-    dm.m12 = A->m11 * B->m12  +  A->m12 * B->m22  +  A->m13 * B->m32  +  A->m14 * B->m42;
-    dm.m13 = A->m11 * B->m13  +  A->m12 * B->m23  +  A->m13 * B->m33  +  A->m14 * B->m43;
-    dm.m14 = A->m11 * B->m14  +  A->m12 * B->m24  +  A->m13 * B->m34  +  A->m14 * B->m44;
     
-    dm.m21 = A->m21 * B->m11  +  A->m22 * B->m21  +  A->m23 * B->m31  +  A->m24 * B->m41;
-    dm.m22 = A->m21 * B->m12  +  A->m22 * B->m22  +  A->m23 * B->m32  +  A->m24 * B->m42;
-    dm.m23 = A->m21 * B->m13  +  A->m22 * B->m23  +  A->m23 * B->m33  +  A->m24 * B->m43;
-    dm.m24 = A->m21 * B->m14  +  A->m22 * B->m24  +  A->m23 * B->m34  +  A->m24 * B->m44;
+    concatMatrixWithClass((LXTransform3DImpl *)r, A, LX4x4MatrixGetClass(A));
+}
 
-    dm.m31 = A->m31 * B->m11  +  A->m32 * B->m21  +  A->m33 * B->m31  +  A->m34 * B->m41;
-    dm.m32 = A->m31 * B->m12  +  A->m32 * B->m22  +  A->m33 * B->m32  +  A->m34 * B->m42;
-    dm.m33 = A->m31 * B->m13  +  A->m32 * B->m23  +  A->m33 * B->m33  +  A->m34 * B->m43;
-    dm.m34 = A->m31 * B->m14  +  A->m32 * B->m24  +  A->m33 * B->m34  +  A->m34 * B->m44;
+// class of A * B (without checking whether terms happen to cancel out); unknown if either class is unknown
+LXINLINE LXUInteger classOfProduct(const LX4x4Matrix *A, LXUInteger aClass, const LX4x4Matrix *B, LXUInteger bClass)
+{
+    const LXUInteger maxClass = MAX(aClass, bClass);
+    
+    // a 2D affine combined with a z scale or translation is no longer planar
+    if (maxClass == kLX4x4MatrixClass_Affine2D && !(isPlanarMatrix(A, aClass) && isPlanarMatrix(B, bClass)))
+        return kLX4x4MatrixClass_Affine3D;
+    
+    return maxClass;
+}
 
-    dm.m41 = A->m41 * B->m11  +  A->m42 * B->m21  +  A->m43 * B->m31  +  A->m44 * B->m41;
-    dm.m42 = A->m41 * B->m12  +  A->m42 * B->m22  +  A->m43 * B->m32  +  A->m44 * B->m42;
-    dm.m43 = A->m41 * B->m13  +  A->m42 * B->m23  +  A->m43 * B->m33  +  A->m44 * B->m43;
-    dm.m44 = A->m41 * B->m14  +  A->m42 * B->m24  +  A->m43 * B->m34  +  A->m44 * B->m44;
+// computes imp->mat = A * imp->mat in place. only the class of A needs to be known.
+// column j of the product only depends on column j of imp->mat, so each column is updated separately,
+// skipping the terms of A that are known to be zero or one for its class.
+// the results are the same as for the general product because the skipped terms only ever add zero.
+static void concatMatrixWithClass(LXTransform3DImpl *imp, const LX4x4Matrix *A, LXUInteger aClass)
+{
+    if (aClass == kLX4x4MatrixClass_Identity)
+        return;
+    
+    const LXUInteger newClass = classOfProduct(A, aClass, &(imp->mat), imp->matClass);
+    const LXFloat * LXRESTRICT a = (const LXFloat *)A;
+    LXFloat * LXRESTRICT b = (LXFloat *)&(imp->mat);
+    int j;
+    
+    if (imp->matClass == kLX4x4MatrixClass_Identity) {
+        imp->mat = *A;
+    }
+    else switch (aClass) {
+        case kLX4x4MatrixClass_Translate: {
+            const LXFloat a3 = a[3], a7 = a[7], a11 = a[11];
+            for (j = 0; j < 4; j++) {
+                const LXFloat w = b[12+j];
+                b[j]   += a3 * w;
+                b[4+j] += a7 * w;
+                b[8+j] += a11 * w;
+            }
+            break;
+        }
+        
+        case kLX4x4MatrixClass_ScaleTranslate: {
+            const LXFloat a0 = a[0], a3 = a[3], a5 = a[5], a7 = a[7], a10 = a[10], a11 = a[11];
+            for (j = 0; j < 4; j++) {
+                const LXFloat w = b[12+j];
+                b[j]   = a0 * b[j]    +  a3 * w;
+                b[4+j] = a5 * b[4+j]  +  a7 * w;
+                b[8+j] = a10 * b[8+j] +  a11 * w;
+            }
+            break;
+        }
+        
+        case kLX4x4MatrixClass_Affine2D: {
+            const LXFloat a0 = a[0], a1 = a[1], a3 = a[3], a4 = a[4], a5 = a[5], a7 = a[7];
+            for (j = 0; j < 4; j++) {
+                const LXFloat x = b[j], y = b[4+j], w = b[12+j];
+                b[j]   = a0 * x  +  a1 * y  +  a3 * w;
+                b[4+j] = a4 * x  +  a5 * y  +  a7 * w;
+            }
+            break;
+        }
+        
+        case kLX4x4MatrixClass_Affine3D:
+            for (j = 0; j < 4; j++) {
+                const LXFloat x = b[j], y = b[4+j], z = b[8+j], w = b[12+j];
+                b[j]   = a[0] * x  +  a[1] * y  +  a[2] * z  +  a[3] * w;
+                b[4+j] = a[4] * x  +  a[5] * y  +  a[6] * z  +  a[7] * w;
+                b[8+j] = a[8] * x  +  a[9] * y  +  a[10] * z +  a[11] * w;
+            }
+            break;
+        
+        default:
+            for (j = 0; j < 4; j++) {
+                const LXFloat x = b[j], y = b[4+j], z = b[8+j], w = b[12+j];
+                b[j]    = a[0] * x   +  a[1] * y   +  a[2] * z   +  a[3] * w;
+                b[4+j]  = a[4] * x   +  a[5] * y   +  a[6] * z   +  a[7] * w;
+                b[8+j]  = a[8] * x   +  a[9] * y   +  a[10] * z  +  a[11] * w;
+                b[12+j] = a[12] * x  +  a[13] * y  +  a[14] * z  +  a[15] * w;
+            }
+            break;
+    }
     
-    memcpy(&(imp->mat), &dm, sizeof(LX4x4Matrix));
+    matrixDidChange(imp, newClass);
 }
 
 
@@ -438,18 +571,6 @@ LXINLINE void transformVector(LXFloat * LXRESTRICT u, const LXFloat * LXRESTRICT
    u[3] = v0 * MAT(m,0,3) + v1 * MAT(m,1,3) + v2 * MAT(m,2,3) + v3 * MAT(m,3,3);
 }
 
-LXINLINE void transformVector_f(float * LXRESTRICT u, const float * LXRESTRICT v, const float * LXRESTRICT m)
-{
-   float v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
-   u[0] = v0 * (float)MAT(m,0,0) + v1 * (float)MAT(m,1,0) + v2 * (float)MAT(m,2,0) + v3 * (float)MAT(m,3,0);
-   
-   u[1] = v0 * (float)MAT(m,0,1) + v1 * (float)MAT(m,1,1) + v2 * (float)MAT(m,2,1) + v3 * (float)MAT(m,3,1);
-   
-   u[2] = v0 * (float)MAT(m,0,2) + v1 * (float)MAT(m,1,2) + v2 * (float)MAT(m,2,2) + v3 * (float)MAT(m,3,2);
-   
-   u[3] = v0 * (float)MAT(m,0,3) + v1 * (float)MAT(m,1,3) + v2 * (float)MAT(m,2,3) + v3 * (float)MAT(m,3,3);
-}
-
 LXINLINE void transformVectorTransposed(LXFloat * LXRESTRICT u, const LXFloat * LXRESTRICT v, const LXFloat * LXRESTRICT m)
 {
    LXFloat v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
@@ -462,6 +583,46 @@ LXINLINE void transformVectorTransposed(LXFloat * LXRESTRICT u, const LXFloat *
    u[3] = v0 * MAT(m,3,0) + v1 * MAT(m,3,1) + v2 * MAT(m,3,2) + v3 * MAT(m,3,3);
 }
 
+// same as transformVector(), but skips the terms that are known to be zero for the matrix class.
+// an unknown class isn't resolved here because classifying would cost about as much as the general transform
+LXINLINE void transformVectorWithClass(LXFloat * LXRESTRICT u, const LXFloat * LXRESTRICT v, const LX4x4Matrix * LXRESTRICT mm, LXUInteger matClass)
+{
+    const LXFloat v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+    
+    switch (matClass) {
+        case kLX4x4MatrixClass_Identity:
+            u[0] = v0;  u[1] = v1;  u[2] = v2;  u[3] = v3;
+            break;
+        case kLX4x4MatrixClass_Translate:
+            u[0] = v0 + v3 * mm->m14;
+            u[1] = v1 + v3 * mm->m24;
+            u[2] = v2 + v3 * mm->m34;
+            u[3] = v3;
+            break;
+        case kLX4x4MatrixClass_ScaleTranslate:
+            u[0] = v0 * mm->m11 + v3 * mm->m14;
+            u[1] = v1 * mm->m22 + v3 * mm->m24;
+            u[2] = v2 * mm->m33 + v3 * mm->m34;
+            u[3] = v3;
+            break;
+        case kLX4x4MatrixClass_Affine2D:
+            u[0] = v0 * mm->m11 + v1 * mm->m12 + v3 * mm->m14;
+            u[1] = v0 * mm->m21 + v1 * mm->m22 + v3 * mm->m24;
+            u[2] = v2;
+            u[3] = v3;
+            break;
+        case kLX4x4MatrixClass_Affine3D:
+            u[0] = v0 * mm->m11 + v1 * mm->m12 + v2 * mm->m13 + v3 * mm->m14;
+            u[1] = v0 * mm->m21 + v1 * mm->m22 + v2 * mm->m23 + v3 * mm->m24;
+            u[2] = v0 * mm->m31 + v1 * mm->m32 + v2 * mm->m33 + v3 * mm->m34;
+            u[3] = v3;
+            break;
+        default:
+            transformVector(u, v, (const LXFloat *)mm);
+            break;
+    }
+}
+
 
 void LXTransform3DTransformVector(LXTransform3DRef t, LXFloat *x, LXFloat *y, LXFloat *z)
 {
@@ -472,7 +633,7 @@ void LXTransform3DTransformVector(LXTransform3DRef t, LXFloat *x, LXFloat *y, LX
     LXFloat out[4] = { 0.0, 0.0, 0.0, 1.0 };
     LXFloat in[4] = { (x) ? *x : 0.0, (y) ? *y : 0.0, (z) ? *z : 0.0, 1.0 };
     
-    transformVector(out, in, (const LXFloat *)mm);
+    transformVectorWithClass(out, in, mm, imp->matClass);
     
     if (x) *x = out[0];
     if (y) *y = out[1];
@@ -487,7 +648,7 @@ void LXTransform3DTransformVector4Ptr(LXTransform3DRef t, LXFloat *vf)
 
     LXFloat out[4] = { 0.0, 0.0, 0.0, 1.0 };
     
-    transformVector(out, vf, (const LXFloat *)mm);
+    transformVectorWithClass(out, vf, mm, imp->matClass);
     
     vf[0] = out[0];
     vf[1] = out[1];
@@ -505,104 +666,612 @@ void LXTransform3DTransformDistance(LXTransform3DRef t, LXFloat *x, LXFloat *y,
     LXFloat outOrigin[4] = { 0.0, 0.0, 0.0, 1.0 };
     LXFloat inOrigin[4] = { 0.0, 0.0, 0.0, 1.0 };
     
-    transformVector(outOrigin, inOrigin, (const LXFloat *)mm);
+    transformVectorWithClass(outOrigin, inOrigin, mm, imp->matClass);
     
     // then the actual vector
     LXFloat out[4] = { 0.0, 0.0, 0.0, 1.0 };
     LXFloat in[4] = { (x) ? *x : 0.0, (y) ? *y : 0.0, (z) ? *z : 0.0, 1.0 };
     
-    transformVector(out, in, (const LXFloat *)mm);
+    transformVectorWithClass(out, in, mm, imp->matClass);
     
     if (x) *x = out[0] - outOrigin[0];
     if (y) *y = out[1] - outOrigin[1];
     if (z) *z = out[2] - outOrigin[2];
 }
 
-void LXTransform3DTransformVector4ArrayInPlace(LXTransform3DRef t, LXFloat *varr, size_t vecCount)
+#pragma mark --- batch transform kernels ---
+
+/*
+  The batch kernels compute the same as transformVector() above, but they take the transposed matrix:
+  the result is v0*m[0..3] + v1*m[4..7] + v2*m[8..11] + v3*m[12..15], so each input component is broadcast
+  and multiplied against a column of the original matrix.
+  Loads and stores are unaligned, and each vector is fully loaded before its result is stored, so src and dst can be the same.
+  
+  "vp" is the viewport mapping for the projecting variants (scale in vp[0..3], offset in vp[4..7]), or NULL.
+  The SoA kernels take the component arrays in "in"/"out"; in[3] can be NULL for w=1, and out[3] can be NULL.
+*/
+
+#if defined(LXTRANSFORM_AVX2)
+ #define LXTRANSFORM_AVX2_FUNC  __attribute__((target("avx2,fma")))
+
+static LXBool hasAVX2FMA()
 {
-    if ( !t) return;
-    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
-    LX4x4Matrix *mm = &(imp->mat);
+    static int s_has = -1;
+    if (s_has < 0) {
+        __builtin_cpu_init();
+        s_has = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? 1 : 0;
+    }
+    return (s_has) ? YES : NO;
+}
+#endif
 
-    LXFloat out[4] = { 0.0, 0.0, 0.0, 1.0 };
 
-    LXUInteger i;
-    for (i = 0; i < vecCount; i++) {
-        LXFloat * LXRESTRICT vf = varr + i*4;
-        
-        transformVector(out, vf, (const LXFloat *)mm);
-    
-        vf[0] = out[0];
-        vf[1] = out[1];
-        vf[2] = out[2];
-        vf[3] = out[3];
+LXINLINE void transformVectorBroadcast_f(float * LXRESTRICT u, const float * LXRESTRICT v, const float * LXRESTRICT m)
+{
+    const float v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+    int j;
+    for (j = 0; j < 4; j++) {
+        u[j] = v0 * m[j] + v1 * m[4+j] + v2 * m[8+j] + v3 * m[12+j];
     }
 }
 
-void LXTransform3DTransformVector4ArrayInPlace_f(LXTransform3DRef t, float *varr, size_t vecCount)
+LXINLINE void projectVector_f(float *u, const float *vp)
 {
-    if ( !t) return;
-    LXUInteger i;
-    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
-    LX4x4Matrix *mm = &(imp->mat);
-    float mm_f[16];
-    for (i = 0; i < 16; i++) {
-        mm_f[i] = (float)(((LXFloat *)mm)[i]);
+    const float inv = 1.0f / u[3];
+    u[0] = u[0] * inv * vp[0] + vp[4];
+    u[1] = u[1] * inv * vp[1] + vp[5];
+    u[2] = u[2] * inv * vp[2] + vp[6];
+    u[3] = inv;
+}
+
+static void transformAoS_f_scalar(const float *m, const float *src, float *dst, size_t n, const float *vp)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        float u[4];
+        transformVectorBroadcast_f(u, src + i*4, m);
+        if (vp) projectVector_f(u, vp);
+        memcpy(dst + i*4, u, 4*sizeof(float));
     }
+}
 
-    float out[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+#if !defined(__SSE2__)
+static void transformAoS_d_scalar(const double *m, const double *src, double *dst, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const double v0 = src[i*4+0], v1 = src[i*4+1], v2 = src[i*4+2], v3 = src[i*4+3];
+        int j;
+        for (j = 0; j < 4; j++) {
+            dst[i*4+j] = v0 * m[j] + v1 * m[4+j] + v2 * m[8+j] + v3 * m[12+j];
+        }
+    }
+}
+#endif
 
-    for (i = 0; i < vecCount; i++) {
-        float * LXRESTRICT vf = varr + i*4;
-        
-        transformVector_f(out, vf, mm_f);
-    
-        vf[0] = out[0];
-        vf[1] = out[1];
-        vf[2] = out[2];
-        vf[3] = out[3];
+static void transformSoA_f_scalar(const float *m, const float **in, float **out, size_t start, size_t n, const float *vp)
+{
+    size_t i;
+    for (i = start; i < start+n; i++) {
+        const float v[4] = { in[0][i], in[1][i], in[2][i], (in[3]) ? in[3][i] : 1.0f };
+        float u[4];
+        transformVectorBroadcast_f(u, v, m);
+        if (vp) projectVector_f(u, vp);
+        out[0][i] = u[0];
+        out[1][i] = u[1];
+        out[2][i] = u[2];
+        if (out[3]) out[3][i] = u[3];
     }
 }
 
-void LXTransform3DTransformVector4Array(LXTransform3DRef t, LXFloat * LXRESTRICT src, LXFloat * LXRESTRICT dst, size_t vecCount)
+static void transformSoA_d_scalar(const double *m, const double **in, double **out, size_t start, size_t n)
 {
-    if ( !t) return;
-    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
-    LX4x4Matrix *mm = &(imp->mat);
+    size_t i;
+    for (i = start; i < start+n; i++) {
+        const double v0 = in[0][i], v1 = in[1][i], v2 = in[2][i], v3 = (in[3]) ? in[3][i] : 1.0;
+        double u[4];
+        int j;
+        for (j = 0; j < 4; j++) {
+            u[j] = v0 * m[j] + v1 * m[4+j] + v2 * m[8+j] + v3 * m[12+j];
+        }
+        out[0][i] = u[0];
+        out[1][i] = u[1];
+        out[2][i] = u[2];
+        if (out[3]) out[3][i] = u[3];
+    }
+}
+
+
+#if defined(__SSE2__)
+
+static void transformAoS_f_sse(const float *m, const float *src, float *dst, size_t n, const float *vp)
+{
+    const __m128 r0 = _mm_loadu_ps(m + 0);
+    const __m128 r1 = _mm_loadu_ps(m + 4);
+    const __m128 r2 = _mm_loadu_ps(m + 8);
+    const __m128 r3 = _mm_loadu_ps(m + 12);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 vpScale = (vp) ? _mm_loadu_ps(vp) : one;
+    const __m128 vpOffset = (vp) ? _mm_loadu_ps(vp + 4) : one;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const __m128 v = _mm_loadu_ps(src + i*4);
+        __m128 u = _mm_mul_ps(r0, _mm_shuffle_ps(v, v, 0x00));
+        u = _mm_add_ps(u, _mm_mul_ps(r1, _mm_shuffle_ps(v, v, 0x55)));
+        u = _mm_add_ps(u, _mm_mul_ps(r2, _mm_shuffle_ps(v, v, 0xaa)));
+        u = _mm_add_ps(u, _mm_mul_ps(r3, _mm_shuffle_ps(v, v, 0xff)));
+        if (vp) {
+            const __m128 inv = _mm_div_ps(one, _mm_shuffle_ps(u, u, 0xff));
+            const __m128 p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(u, inv), vpScale), vpOffset);
+            u = _mm_or_ps(_mm_and_ps(xyzMask, p), _mm_andnot_ps(xyzMask, inv));
+        }
+        _mm_storeu_ps(dst + i*4, u);
+    }
+}
 
-    LXFloat * LXRESTRICT sf = src;
-    LXFloat * LXRESTRICT df = dst;
-    LXUInteger i;
-    for (i = 0; i < vecCount; i++) {
-        transformVector(df, sf, (const LXFloat *)mm);    
-        sf += 4;
-        df += 4;
+static void transformAoS_d_sse2(const double *m, const double *src, double *dst, size_t n)
+{
+    const __m128d r0a = _mm_loadu_pd(m + 0),  r0b = _mm_loadu_pd(m + 2);
+    const __m128d r1a = _mm_loadu_pd(m + 4),  r1b = _mm_loadu_pd(m + 6);
+    const __m128d r2a = _mm_loadu_pd(m + 8),  r2b = _mm_loadu_pd(m + 10);
+    const __m128d r3a = _mm_loadu_pd(m + 12), r3b = _mm_loadu_pd(m + 14);
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const __m128d v0 = _mm_load1_pd(src + i*4 + 0);
+        const __m128d v1 = _mm_load1_pd(src + i*4 + 1);
+        const __m128d v2 = _mm_load1_pd(src + i*4 + 2);
+        const __m128d v3 = _mm_load1_pd(src + i*4 + 3);
+        __m128d ua = _mm_mul_pd(r0a, v0);
+        __m128d ub = _mm_mul_pd(r0b, v0);
+        ua = _mm_add_pd(ua, _mm_mul_pd(r1a, v1));
+        ub = _mm_add_pd(ub, _mm_mul_pd(r1b, v1));
+        ua = _mm_add_pd(ua, _mm_mul_pd(r2a, v2));
+        ub = _mm_add_pd(ub, _mm_mul_pd(r2b, v2));
+        ua = _mm_add_pd(ua, _mm_mul_pd(r3a, v3));
+        ub = _mm_add_pd(ub, _mm_mul_pd(r3b, v3));
+        _mm_storeu_pd(dst + i*4 + 0, ua);
+        _mm_storeu_pd(dst + i*4 + 2, ub);
     }
 }
 
-void LXTransform3DTransformVector4Array_f(LXTransform3DRef t, float * LXRESTRICT src, float * LXRESTRICT dst, size_t vecCount)
+static void transformSoA_f_sse(const float *m, const float **in, float **out, size_t start, size_t n, const float *vp)
 {
-    if ( !t) return;
-    LXUInteger i;
-    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
-    LX4x4Matrix *mm = &(imp->mat);
-    float mm_f[16];
-    for (i = 0; i < 16; i++) {
-        mm_f[i] = (float)(((LXFloat *)mm)[i]);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 c[16];
+    size_t i;
+    int j;
+    for (j = 0; j < 16; j++) c[j] = _mm_set1_ps(m[j]);
+    
+    for (i = start; i+4 <= start+n; i += 4) {
+        const __m128 x = _mm_loadu_ps(in[0] + i);
+        const __m128 y = _mm_loadu_ps(in[1] + i);
+        const __m128 z = _mm_loadu_ps(in[2] + i);
+        const __m128 w = (in[3]) ? _mm_loadu_ps(in[3] + i) : one;
+        __m128 u[4];
+        for (j = 0; j < 4; j++) {
+            u[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, c[j]), _mm_mul_ps(y, c[4+j])),
+                              _mm_add_ps(_mm_mul_ps(z, c[8+j]), _mm_mul_ps(w, c[12+j])));
+        }
+        if (vp) {
+            const __m128 inv = _mm_div_ps(one, u[3]);
+            for (j = 0; j < 3; j++) {
+                u[j] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(u[j], inv), _mm_set1_ps(vp[j])), _mm_set1_ps(vp[4+j]));
+            }
+            u[3] = inv;
+        }
+        _mm_storeu_ps(out[0] + i, u[0]);
+        _mm_storeu_ps(out[1] + i, u[1]);
+        _mm_storeu_ps(out[2] + i, u[2]);
+        if (out[3]) _mm_storeu_ps(out[3] + i, u[3]);
+    }
+    if (i < start+n)
+        transformSoA_f_scalar(m, in, out, i, start+n - i, vp);
+}
+
+static void transformSoA_d_sse2(const double *m, const double **in, double **out, size_t start, size_t n)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d c[16];
+    size_t i;
+    int j;
+    for (j = 0; j < 16; j++) c[j] = _mm_set1_pd(m[j]);
+
+    for (i = start; i+2 <= start+n; i += 2) {
+        const __m128d x = _mm_loadu_pd(in[0] + i);
+        const __m128d y = _mm_loadu_pd(in[1] + i);
+        const __m128d z = _mm_loadu_pd(in[2] + i);
+        const __m128d w = (in[3]) ? _mm_loadu_pd(in[3] + i) : one;
+        __m128d u[4];
+        for (j = 0; j < 4; j++) {
+            u[j] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, c[j]), _mm_mul_pd(y, c[4+j])),
+                                         _mm_mul_pd(z, c[8+j])), _mm_mul_pd(w, c[12+j]));
+        }
+        _mm_storeu_pd(out[0] + i, u[0]);
+        _mm_storeu_pd(out[1] + i, u[1]);
+        _mm_storeu_pd(out[2] + i, u[2]);
+        if (out[3]) _mm_storeu_pd(out[3] + i, u[3]);
+    }
+    if (i < start+n)
+        transformSoA_d_scalar(m, in, out, i, start+n - i);
+}
+
+#endif  // __SSE2__
+
+
+#if defined(LXTRANSFORM_AVX2)
+
+// two vectors per iteration, one in each 128-bit lane
+LXTRANSFORM_AVX2_FUNC
+static void transformAoS_f_avx2(const float *m, const float *src, float *dst, size_t n, const float *vp)
+{
+    const __m256 r0 = _mm256_broadcast_ps((const __m128 *)(m + 0));
+    const __m256 r1 = _mm256_broadcast_ps((const __m128 *)(m + 4));
+    const __m256 r2 = _mm256_broadcast_ps((const __m128 *)(m + 8));
+    const __m256 r3 = _mm256_broadcast_ps((const __m128 *)(m + 12));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 vpScale = (vp) ? _mm256_broadcast_ps((const __m128 *)vp) : one;
+    const __m256 vpOffset = (vp) ? _mm256_broadcast_ps((const __m128 *)(vp + 4)) : one;
+    size_t i;
+    for (i = 0; i+2 <= n; i += 2) {
+        const __m256 v = _mm256_loadu_ps(src + i*4);
+        __m256 u = _mm256_mul_ps(r0, _mm256_permute_ps(v, 0x00));
+        u = _mm256_fmadd_ps(r1, _mm256_permute_ps(v, 0x55), u);
+        u = _mm256_fmadd_ps(r2, _mm256_permute_ps(v, 0xaa), u);
+        u = _mm256_fmadd_ps(r3, _mm256_permute_ps(v, 0xff), u);
+        if (vp) {
+            const __m256 inv = _mm256_div_ps(one, _mm256_permute_ps(u, 0xff));
+            const __m256 p = _mm256_fmadd_ps(_mm256_mul_ps(u, inv), vpScale, vpOffset);
+            u = _mm256_blend_ps(p, inv, 0x88);
+        }
+        _mm256_storeu_ps(dst + i*4, u);
+    }
+    if (i < n)
+        transformAoS_f_scalar(m, src + i*4, dst + i*4, n - i, vp);
+}
+
+LXTRANSFORM_AVX2_FUNC
+static void transformAoS_d_avx2(const double *m, const double *src, double *dst, size_t n)
+{
+    const __m256d r0 = _mm256_loadu_pd(m + 0);
+    const __m256d r1 = _mm256_loadu_pd(m + 4);
+    const __m256d r2 = _mm256_loadu_pd(m + 8);
+    const __m256d r3 = _mm256_loadu_pd(m + 12);
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const __m256d v0 = _mm256_broadcast_sd(src + i*4 + 0);
+        const __m256d v1 = _mm256_broadcast_sd(src + i*4 + 1);
+        const __m256d v2 = _mm256_broadcast_sd(src + i*4 + 2);
+        const __m256d v3 = _mm256_broadcast_sd(src + i*4 + 3);
+        __m256d u = _mm256_mul_pd(r0, v0);
+        u = _mm256_fmadd_pd(r1, v1, u);
+        u = _mm256_fmadd_pd(r2, v2, u);
+        u = _mm256_fmadd_pd(r3, v3, u);
+        _mm256_storeu_pd(dst + i*4, u);
+    }
+}
+
+LXTRANSFORM_AVX2_FUNC
+static void transformSoA_f_avx2(const float *m, const float **in, float **out, size_t start, size_t n, const float *vp)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 c[16];
+    size_t i;
+    int j;
+    for (j = 0; j < 16; j++) c[j] = _mm256_set1_ps(m[j]);
+
+    for (i = start; i+8 <= start+n; i += 8) {
+        const __m256 x = _mm256_loadu_ps(in[0] + i);
+        const __m256 y = _mm256_loadu_ps(in[1] + i);
+        const __m256 z = _mm256_loadu_ps(in[2] + i);
+        const __m256 w = (in[3]) ? _mm256_loadu_ps(in[3] + i) : one;
+        __m256 u[4];
+        for (j = 0; j < 4; j++) {
+            u[j] = _mm256_fmadd_ps(w, c[12+j], _mm256_fmadd_ps(z, c[8+j], _mm256_fmadd_ps(y, c[4+j], _mm256_mul_ps(x, c[j]))));
+        }
+        if (vp) {
+            const __m256 inv = _mm256_div_ps(one, u[3]);
+            for (j = 0; j < 3; j++) {
+                u[j] = _mm256_fmadd_ps(_mm256_mul_ps(u[j], inv), _mm256_set1_ps(vp[j]), _mm256_set1_ps(vp[4+j]));
+            }
+            u[3] = inv;
+        }
+        _mm256_storeu_ps(out[0] + i, u[0]);
+        _mm256_storeu_ps(out[1] + i, u[1]);
+        _mm256_storeu_ps(out[2] + i, u[2]);
+        if (out[3]) _mm256_storeu_ps(out[3] + i, u[3]);
     }
+    if (i < start+n)
+        transformSoA_f_scalar(m, in, out, i, start+n - i, vp);
+}
+
+LXTRANSFORM_AVX2_FUNC
+static void transformSoA_d_avx2(const double *m, const double **in, double **out, size_t start, size_t n)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d c[16];
+    size_t i;
+    int j;
+    for (j = 0; j < 16; j++) c[j] = _mm256_set1_pd(m[j]);
+
+    for (i = start; i+4 <= start+n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(in[0] + i);
+        const __m256d y = _mm256_loadu_pd(in[1] + i);
+        const __m256d z = _mm256_loadu_pd(in[2] + i);
+        const __m256d w = (in[3]) ? _mm256_loadu_pd(in[3] + i) : one;
+        __m256d u[4];
+        for (j = 0; j < 4; j++) {
+            u[j] = _mm256_fmadd_pd(w, c[12+j], _mm256_fmadd_pd(z, c[8+j], _mm256_fmadd_pd(y, c[4+j], _mm256_mul_pd(x, c[j]))));
+        }
+        _mm256_storeu_pd(out[0] + i, u[0]);
+        _mm256_storeu_pd(out[1] + i, u[1]);
+        _mm256_storeu_pd(out[2] + i, u[2]);
+        if (out[3]) _mm256_storeu_pd(out[3] + i, u[3]);
+    }
+    if (i < start+n)
+        transformSoA_d_scalar(m, in, out, i, start+n - i);
+}
+
+#endif  // LXTRANSFORM_AVX2
+
+
+#pragma mark --- batch transform ---
+
+enum {
+    kBatchAoS_f = 0,
+    kBatchAoS_d,
+    kBatchSoA_f,
+    kBatchSoA_d
+};
+
+#if defined(LXFLOAT_IS_DOUBLE)
+ #define kBatchAoS_LXFloat  kBatchAoS_d
+ #define kBatchSoA_LXFloat  kBatchSoA_d
+#else
+ #define kBatchAoS_LXFloat  kBatchAoS_f
+ #define kBatchSoA_LXFloat  kBatchSoA_f
+#endif
+
+// batches are split into chunks of this many vectors when run in parallel
+#define BATCH_CHUNKSIZE         16384
+#define BATCH_MINPARALLELCOUNT  (4 * BATCH_CHUNKSIZE)
+
+typedef struct {
+    LXInteger kind;
+    LXUInteger matClass;
+    float mf[16];  // transposed matrix
+    double md[16];
     
-#if defined(__SSE2__)
-    lx_matmul_sse3_aligned(mm_f, src, dst, vecCount);
+    const float *vp;
+    float vpData[8];
     
-#else
-    float * LXRESTRICT sf = src;
-    float * LXRESTRICT df = dst;
-    for (i = 0; i < vecCount; i++) {
-        transformVector_f(df, sf, mm_f);
-        sf += 4;
-        df += 4;
+    const void *src;  // AoS
+    void *dst;
+    const void *in[4];  // SoA
+    void *out[4];
+    size_t count;
+} LXTransformBatch;
+
+
+static void initBatch(LXTransformBatch *b, LXTransform3DImpl *imp, LXInteger kind, size_t count)
+{
+    const LXFloat *mm = (const LXFloat *)&(imp->mat);
+    int i;
+    memset(b, 0, sizeof(LXTransformBatch));
+    b->kind = kind;
+    b->matClass = imp->matClass;
+    b->count = count;
+    for (i = 0; i < 16; i++) {
+        b->mf[i] = (float)mm[(i % 4) * 4 + i / 4];
+        b->md[i] = (double)mm[(i % 4) * 4 + i / 4];
     }
+}
+
+static void setBatchViewport(LXTransformBatch *b, LXRect viewport)
+{
+    // same as OpenGL with glDepthRange(0, 1)
+    b->vpData[0] = 0.5f * viewport.w;
+    b->vpData[1] = 0.5f * viewport.h;
+    b->vpData[2] = 0.5f;
+    b->vpData[3] = 0.0f;
+    b->vpData[4] = viewport.x + 0.5f * viewport.w;
+    b->vpData[5] = viewport.y + 0.5f * viewport.h;
+    b->vpData[6] = 0.5f;
+    b->vpData[7] = 0.0f;
+    b->vp = b->vpData;
+}
+
+static void runBatchRange(const LXTransformBatch *b, size_t start, size_t n)
+{
+#if defined(LXTRANSFORM_AVX2)
+    const LXBool useAVX2 = hasAVX2FMA();
 #endif
+
+    switch (b->kind) {
+        case kBatchAoS_f: {
+            const float *src = (const float *)b->src + start*4;
+            float *dst = (float *)b->dst + start*4;
+#if defined(LXTRANSFORM_AVX2)
+            if (useAVX2) { transformAoS_f_avx2(b->mf, src, dst, n, b->vp); break; }
+#endif
+#if defined(__SSE2__)
+            transformAoS_f_sse(b->mf, src, dst, n, b->vp);
+#else
+            transformAoS_f_scalar(b->mf, src, dst, n, b->vp);
+#endif
+            break;
+        }
+        case kBatchAoS_d: {
+            const double *src = (const double *)b->src + start*4;
+            double *dst = (double *)b->dst + start*4;
+#if defined(LXTRANSFORM_AVX2)
+            if (useAVX2) { transformAoS_d_avx2(b->md, src, dst, n); break; }
+#endif
+#if defined(__SSE2__)
+            transformAoS_d_sse2(b->md, src, dst, n);
+#else
+            transformAoS_d_scalar(b->md, src, dst, n);
+#endif
+            break;
+        }
+        case kBatchSoA_f: {
+            const float **in = (const float **)b->in;
+            float **out = (float **)b->out;
+#if defined(LXTRANSFORM_AVX2)
+            if (useAVX2) { transformSoA_f_avx2(b->mf, in, out, start, n, b->vp); break; }
+#endif
+#if defined(__SSE2__)
+            transformSoA_f_sse(b->mf, in, out, start, n, b->vp);
+#else
+            transformSoA_f_scalar(b->mf, in, out, start, n, b->vp);
+#endif
+            break;
+        }
+        case kBatchSoA_d: {
+            const double **in = (const double **)b->in;
+            double **out = (double **)b->out;
+#if defined(LXTRANSFORM_AVX2)
+            if (useAVX2) { transformSoA_d_avx2(b->md, in, out, start, n); break; }
+#endif
+#if defined(__SSE2__)
+            transformSoA_d_sse2(b->md, in, out, start, n);
+#else
+            transformSoA_d_scalar(b->md, in, out, start, n);
+#endif
+            break;
+        }
+    }
+}
+
+static void batchItem(void *userData, LXInteger workerIndex, LXInteger itemIndex)
+{
+    const LXTransformBatch *b = (const LXTransformBatch *)userData;
+    const size_t start = (size_t)itemIndex * BATCH_CHUNKSIZE;
+    
+    runBatchRange(b, start, MIN(BATCH_CHUNKSIZE, b->count - start));
+}
+
+// for the identity matrix, the batch only needs to be copied to its destination
+static void copyBatch(const LXTransformBatch *b)
+{
+    const size_t elemSize = (b->kind == kBatchAoS_d || b->kind == kBatchSoA_d) ? sizeof(double) : sizeof(float);
+    size_t i;
+    int j;
+
+    if (b->kind == kBatchAoS_f || b->kind == kBatchAoS_d) {
+        if (b->src != b->dst)
+            memmove(b->dst, b->src, b->count * 4 * elemSize);
+        return;
+    }
+    for (j = 0; j < 4; j++) {
+        if ( !b->out[j] || b->in[j] == b->out[j])
+            continue;
+        if (b->in[j]) {
+            memmove(b->out[j], b->in[j], b->count * elemSize);
+        } else if (b->kind == kBatchSoA_d) {
+            for (i = 0; i < b->count; i++) ((double *)b->out[j])[i] = 1.0;
+        } else {
+            for (i = 0; i < b->count; i++) ((float *)b->out[j])[i] = 1.0f;
+        }
+    }
+}
+
+static void runBatch(LXTransformBatch *b)
+{
+    if (b->count < 1) return;
+    
+    if (b->matClass == kLX4x4MatrixClass_Identity && !b->vp) {
+        copyBatch(b);
+        return;
+    }
+    
+    if (b->count >= BATCH_MINPARALLELCOUNT && LXParallelGetWorkerCount() > 1) {
+        LXParallelApply((b->count + BATCH_CHUNKSIZE - 1) / BATCH_CHUNKSIZE, 0, batchItem, b);
+    } else {
+        runBatchRange(b, 0, b->count);
+    }
+}
+
+
+void LXTransform3DTransformVector4ArrayInPlace(LXTransform3DRef t, LXFloat *varr, size_t vecCount)
+{
+    LXTransform3DTransformVector4Array(t, varr, varr, vecCount);
+}
+
+void LXTransform3DTransformVector4ArrayInPlace_f(LXTransform3DRef t, float *varr, size_t vecCount)
+{
+    LXTransform3DTransformVector4Array_f(t, varr, varr, vecCount);
+}
+
+void LXTransform3DTransformVector4Array(LXTransform3DRef t, LXFloat *src, LXFloat *dst, size_t vecCount)
+{
+    if ( !t || !src || !dst) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchAoS_LXFloat, vecCount);
+    batch.src = src;
+    batch.dst = dst;
+    runBatch(&batch);
+}
+
+void LXTransform3DTransformVector4Array_f(LXTransform3DRef t, float *src, float *dst, size_t vecCount)
+{
+    if ( !t || !src || !dst) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchAoS_f, vecCount);
+    batch.src = src;
+    batch.dst = dst;
+    runBatch(&batch);
+}
+
+void LXTransform3DTransformVectorArraySoA(LXTransform3DRef t, const LXFloat *x, const LXFloat *y, const LXFloat *z, const LXFloat *w,
+                                          LXFloat *outX, LXFloat *outY, LXFloat *outZ, LXFloat *outW, size_t count)
+{
+    if ( !t || !x || !y || !z || !outX || !outY || !outZ) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchSoA_LXFloat, count);
+    batch.in[0] = x;  batch.in[1] = y;  batch.in[2] = z;  batch.in[3] = w;
+    batch.out[0] = outX;  batch.out[1] = outY;  batch.out[2] = outZ;  batch.out[3] = outW;
+    runBatch(&batch);
+}
+
+void LXTransform3DTransformVectorArraySoA_f(LXTransform3DRef t, const float *x, const float *y, const float *z, const float *w,
+                                            float *outX, float *outY, float *outZ, float *outW, size_t count)
+{
+    if ( !t || !x || !y || !z || !outX || !outY || !outZ) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchSoA_f, count);
+    batch.in[0] = x;  batch.in[1] = y;  batch.in[2] = z;  batch.in[3] = w;
+    batch.out[0] = outX;  batch.out[1] = outY;  batch.out[2] = outZ;  batch.out[3] = outW;
+    runBatch(&batch);
+}
+
+void LXTransform3DProjectVector4Array_f(LXTransform3DRef t, const float *src, float *dst, size_t vecCount, LXRect viewport)
+{
+    if ( !t || !src || !dst) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchAoS_f, vecCount);
+    setBatchViewport(&batch, viewport);
+    batch.src = src;
+    batch.dst = dst;
+    runBatch(&batch);
+}
+
+void LXTransform3DProjectVectorArraySoA_f(LXTransform3DRef t, const float *x, const float *y, const float *z, const float *w,
+                                          float *outX, float *outY, float *outZ, float *outW, size_t count, LXRect viewport)
+{
+    if ( !t || !x || !y || !z || !outX || !outY || !outZ) return;
+    LXTransformBatch batch;
+    
+    initBatch(&batch, (LXTransform3DImpl *)t, kBatchSoA_f, count);
+    setBatchViewport(&batch, viewport);
+    batch.in[0] = x;  batch.in[1] = y;  batch.in[2] = z;  batch.in[3] = w;
+    batch.out[0] = outX;  batch.out[1] = outY;  batch.out[2] = outZ;  batch.out[3] = outW;
+    runBatch(&batch);
 }
 
 
@@ -667,26 +1336,141 @@ static LXBool glstyle_invert_matrix_3d_general( LXFloat *mOut, LXFloat *mOrig )
    MAT(mOut,2,3) = - (MAT(mIn,0,3) * MAT(mOut,2,0) +
                       MAT(mIn,1,3) * MAT(mOut,2,1) +
                       MAT(mIn,2,3) * MAT(mOut,2,2) );
+   MAT(mOut,3,3) = 1.0;
    return YES;
 }
 
+// full 4x4 inverse using cofactors; works on either row ordering
+static LXBool invert_matrix_4x4_projective( LXFloat *inv, const LXFloat *m )
+{
+   LXFloat det;
+   int i;
+
+   inv[0] =   m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+   inv[4] =  -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+   inv[8] =   m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+   inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+   inv[1] =  -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+   inv[5] =   m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+   inv[9] =  -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+   inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+   inv[2] =   m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+   inv[6] =  -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+   inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+   inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+   inv[3] =  -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+   inv[7] =   m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+   inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+   inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+   det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+
+   if (det*det < 1e-25)
+      return NO;
+
+   det = 1.0 / det;
+   for (i = 0; i < 16; i++)
+      inv[i] *= det;
+
+   return YES;
+}
+
+
+// inverts using the cheapest method for the matrix class. returns NO if the matrix is singular
+static LXBool invertMatrixWithClass(LX4x4Matrix * LXRESTRICT dst, const LX4x4Matrix * LXRESTRICT m, LXUInteger matClass)
+{
+    LXFloat det;
+    
+    switch (matClass) {
+        case kLX4x4MatrixClass_Identity:
+            setIdentityMatrix(dst);
+            return YES;
+        
+        case kLX4x4MatrixClass_Translate:
+            setIdentityMatrix(dst);
+            dst->m14 = -m->m14;
+            dst->m24 = -m->m24;
+            dst->m34 = -m->m34;
+            return YES;
+        
+        case kLX4x4MatrixClass_ScaleTranslate:
+            det = m->m11 * m->m22 * m->m33;
+            if (det*det < 1e-25)
+                return NO;
+            setIdentityMatrix(dst);
+            dst->m11 = 1.0 / m->m11;
+            dst->m22 = 1.0 / m->m22;
+            dst->m33 = 1.0 / m->m33;
+            dst->m14 = -(m->m14 * dst->m11);
+            dst->m24 = -(m->m24 * dst->m22);
+            dst->m34 = -(m->m34 * dst->m33);
+            return YES;
+        
+        case kLX4x4MatrixClass_Affine2D:
+            det = m->m11 * m->m22 - m->m12 * m->m21;
+            if (det*det < 1e-25)
+                return NO;
+            det = 1.0 / det;
+            setIdentityMatrix(dst);
+            dst->m11 =  m->m22 * det;
+            dst->m12 = -m->m12 * det;
+            dst->m21 = -m->m21 * det;
+            dst->m22 =  m->m11 * det;
+            dst->m14 = -(m->m14 * dst->m11 + m->m24 * dst->m12);
+            dst->m24 = -(m->m14 * dst->m21 + m->m24 * dst->m22);
+            return YES;
+        
+        case kLX4x4MatrixClass_Affine3D: {
+            LX4x4Matrix tempM;
+            LX4x4Matrix newM;
+            LX4x4MatrixTranspose(&tempM, m);
+    
+            if ( !glstyle_invert_matrix_3d_general((LXFloat *)(&newM), (LXFloat *)(&tempM)))
+                return NO;
+            LX4x4MatrixTranspose(dst, &newM);
+            return YES;
+        }
+        
+        default:
+            return invert_matrix_4x4_projective((LXFloat *)dst, (const LXFloat *)m);
+    }
+}
+
+static LXBool updateCachedInverse(LXTransform3DImpl *imp)
+{
+    if ( !imp->hasCachedInverse) {
+        imp->cachedInverseIsValid = invertMatrixWithClass(&(imp->inverse), &(imp->mat), getMatrixClass(imp));
+        imp->hasCachedInverse = YES;
+    }
+    return imp->cachedInverseIsValid;
+}
+
 
 LXBool LXTransform3DInvert(LXTransform3DRef t)
 {
     if ( !t) return NO;
-
     LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
-    LX4x4Matrix *mm = &(imp->mat);
-    LX4x4Matrix tempM;
-    LX4x4Matrix newM;
     
-    LX4x4MatrixTranspose(&tempM, mm);
+    if ( !updateCachedInverse(imp))
+        return NO;
     
-    if (YES == glstyle_invert_matrix_3d_general((LXFloat *)(&newM), (LXFloat *)(&tempM))) {
-        LX4x4MatrixTranspose(mm, &newM);
-        return YES;
-    } else
+    // swap the matrix and its inverse, so that inverting back is free
+    LX4x4Matrix origM = imp->mat;
+    imp->mat = imp->inverse;
+    imp->inverse = origM;
+    return YES;  // the inverse has the same matrix class
+}
+
+LXBool LXTransform3DGetInverseMatrix(LXTransform3DRef t, LX4x4Matrix *outMatrix)
+{
+    if ( !t || !outMatrix) return NO;
+    LXTransform3DImpl *imp = (LXTransform3DImpl *)t;
+    
+    if ( !updateCachedInverse(imp))
         return NO;
+    
+    *outMatrix = imp->inverse;
+    return YES;
 }
 
 
@@ -29,6 +29,19 @@ typedef struct _LX4x4Matrix
 } LX4x4Matrix;
 
 
+// matrices are classified from the most specific to the most general.
+// LXTransform3D tracks the class of its matrix and picks faster code paths for concat, invert and transforms based on it.
+enum {
+    kLX4x4MatrixClass_Identity = 0,
+    kLX4x4MatrixClass_Translate,
+    kLX4x4MatrixClass_ScaleTranslate,   // axis-aligned scale and translation
+    kLX4x4MatrixClass_Affine2D,         // affine transform in the xy plane; z is unchanged
+    kLX4x4MatrixClass_Affine3D,         // bottom row is (0, 0, 0, 1)
+    kLX4x4MatrixClass_Projective
+};
+typedef LXUInteger LX4x4MatrixClass;
+
+
 #ifndef M_PI
 #define M_PI (3.1415926536)
 #endif
@@ -45,6 +58,8 @@ extern "C" {
 LXEXPORT void LX4x4MatrixTranspose(LX4x4Matrix *dst, const LX4x4Matrix *src);  // can be used for in-place operation
 LXEXPORT char *LX4x4MatrixCreateString(const LX4x4Matrix *m, LXBool insertLineBreaks);  // created string must be destroyed with _lx_free()
 
+LXEXPORT LX4x4MatrixClass LX4x4MatrixGetClass(const LX4x4Matrix *m);
+
 LXEXPORT_CONSTVAR LX4x4Matrix * const LXIdentity4x4Matrix;
 
 
@@ -72,24 +87,49 @@ LXEXPORT void LXTransform3DRotate(LXTransform3DRef r, LXFloat angleInRadians, LX
 LXEXPORT void LXTransform3DGetMatrix(LXTransform3DRef t, LX4x4Matrix *outMatrix);
 LXEXPORT void LXTransform3DSetMatrix(LXTransform3DRef t, LX4x4Matrix *matrix);
 
+// the class is tracked through concatenation, so it can be more general than LX4x4MatrixGetClass() would return
+// (e.g. if a translation was concatenated and then undone)
+LXEXPORT LX4x4MatrixClass LXTransform3DGetMatrixClass(LXTransform3DRef t);
+
 // apply transform to vector
 LXEXPORT void LXTransform3DTransformVector(LXTransform3DRef t, LXFloat *x, LXFloat *y, LXFloat *z);  // accepts NULL for x/y/z
 LXEXPORT void LXTransform3DTransformDistance(LXTransform3DRef t, LXFloat *x, LXFloat *y, LXFloat *z);
 
 LXEXPORT void LXTransform3DTransformVector4Ptr(LXTransform3DRef t, LXFloat *vf);
+
+// batch transforms for arrays of 4-component vectors. src and dst can be the same array; no alignment is required.
+// large batches are split between LXParallel worker threads.
 LXEXPORT void LXTransform3DTransformVector4ArrayInPlace(LXTransform3DRef t, LXFloat *vf, size_t vecCount);
-LXEXPORT void LXTransform3DTransformVector4Array(LXTransform3DRef t, LXFloat * LXRESTRICT src, LXFloat * LXRESTRICT dst, size_t vecCount);
+LXEXPORT void LXTransform3DTransformVector4Array(LXTransform3DRef t, LXFloat *src, LXFloat *dst, size_t vecCount);
 
 LXEXPORT void LXTransform3DTransformVector4ArrayInPlace_f(LXTransform3DRef t, float *vf, size_t vecCount);
-LXEXPORT void LXTransform3DTransformVector4Array_f(LXTransform3DRef t, float * LXRESTRICT src, float * LXRESTRICT dst, size_t vecCount);
-
-// a = a * b
+LXEXPORT void LXTransform3DTransformVector4Array_f(LXTransform3DRef t, float *src, float *dst, size_t vecCount);
+
+// structure-of-arrays variants: each component is in its own array.
+// "w" can be NULL to transform points (w = 1), and "outW" can be NULL if it's not needed. outputs can be the input arrays.
+LXEXPORT void LXTransform3DTransformVectorArraySoA(LXTransform3DRef t, const LXFloat *x, const LXFloat *y, const LXFloat *z, const LXFloat *w,
+                                                   LXFloat *outX, LXFloat *outY, LXFloat *outZ, LXFloat *outW, size_t count);
+LXEXPORT void LXTransform3DTransformVectorArraySoA_f(LXTransform3DRef t, const float *x, const float *y, const float *z, const float *w,
+                                                     float *outX, float *outY, float *outZ, float *outW, size_t count);
+
+// transform to clip space followed by perspective divide and viewport mapping, as in OpenGL with depth range 0-1.
+// the results are window coordinates: x and y are in the viewport's units, z is depth, and w is 1/w of the clip-space vector.
+// a negative viewport height flips the y axis. vectors with clip-space w of 0 produce non-finite results.
+LXEXPORT void LXTransform3DProjectVector4Array_f(LXTransform3DRef t, const float *src, float *dst, size_t vecCount, LXRect viewport);
+LXEXPORT void LXTransform3DProjectVectorArraySoA_f(LXTransform3DRef t, const float *x, const float *y, const float *z, const float *w,
+                                                   float *outX, float *outY, float *outZ, float *outW, size_t count, LXRect viewport);
+
+// a = a * b. only "a" is modified, so a shared "b" can be concatenated from several threads at once
 LXEXPORT void LXTransform3DConcat(LXTransform3DRef a, LXTransform3DRef b);
 LXEXPORT void LXTransform3DConcatMatrix(LXTransform3DRef a, LX4x4Matrix * LXRESTRICT matrix);
 
 // inverts the matrix, if possible
 LXEXPORT LXBool LXTransform3DInvert(LXTransform3DRef t);
 
+// returns the inverse without modifying the transform (NO if the matrix isn't invertible).
+// the inverse is cached in the object until the matrix changes, so this isn't safe to call on a transform shared between threads.
+LXEXPORT LXBool LXTransform3DGetInverseMatrix(LXTransform3DRef t, LX4x4Matrix *outMatrix);
+
 
 #pragma mark --- utilities ---
 
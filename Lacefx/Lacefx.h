@@ -21,8 +21,14 @@
 
 #include "LXAccumulator.h"
 #include "LXCList.h"
+#include "LXColorTransform.h"
 #include "LXConvolver.h"
+#include "LXCurveBake.h"
+#include "LXImageBlend.h"
+#include "LXImageStatistics.h"
+#include "LXLUT3D.h"
 #include "LXMap.h"
+#include "LXPathRaster.h"
 #include "LXPool.h"
 #include "LXPixelBuffer.h"
 #include "LXShader.h"